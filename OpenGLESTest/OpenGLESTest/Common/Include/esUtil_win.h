@@ -65,6 +65,13 @@ extern "C" {
 //
 GLboolean WinCreate ( ESContext *esContext, const char *title );
 
+///
+//  WinLoop()
+//
+//      Run the update and draw functions of esContext until the window is closed
+//
+void WinLoop ( ESContext *esContext );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,551 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esModel.c
+//
+//    Loader of POD scenes, whose meshes are read straight from the mapped file.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "esUtil_private.h"
+
+///
+// POD scenes
+//
+
+/// Blocks of a POD file, the other tags hold values
+static GLboolean esIsPODBlock ( GLuint name )
+{
+   return name == 1001 || ( name >= 2010 && name <= 2015 ) || name == 6003 || ( name >= 6006 && name <= 6013 );
+}
+
+static GLfloat esReadFloat ( const unsigned char *data )
+{
+   GLuint  bits = esReadU32 ( data );
+   GLfloat value;
+
+   memcpy ( &value, &bits, sizeof ( GLfloat ) );
+   return value;
+}
+
+/// A string tag, NULL unless it ends with its terminator
+static const char *esReadPODString ( const unsigned char *data, GLuint length )
+{
+   return length > 0 && data[length - 1] == '\0' ? ( const char * ) data : NULL;
+}
+
+///
+// esPODVertexType()
+//
+//    glVertexAttribPointer type of a POD data type, GL_NONE for the ones
+//    GL ES has none for.  Sets whether it is normalized and the size of
+//    one component, GL_FALSE and 0 for GL_NONE.
+//
+static GLenum esPODVertexType ( GLuint dataType, GLboolean *normalized, int *componentSize )
+{
+   static const struct
+   {
+      GLuint    dataType;
+      GLenum    type;
+      GLboolean normalized;
+      int       componentSize;
+   } types[] =
+   {
+      { 1, GL_FLOAT, GL_FALSE, 4 },
+      { 2, GL_INT, GL_FALSE, 4 },
+      { 3, GL_UNSIGNED_SHORT, GL_FALSE, 2 },
+      { 4, GL_UNSIGNED_BYTE, GL_TRUE, 1 },
+      { 7, GL_UNSIGNED_BYTE, GL_FALSE, 1 },
+      { 9, GL_FIXED, GL_FALSE, 4 },
+      { 10, GL_UNSIGNED_BYTE, GL_FALSE, 1 },
+      { 11, GL_SHORT, GL_FALSE, 2 },
+      { 12, GL_SHORT, GL_TRUE, 2 },
+      { 13, GL_BYTE, GL_FALSE, 1 },
+      { 14, GL_BYTE, GL_TRUE, 1 },
+      { 15, GL_UNSIGNED_BYTE, GL_TRUE, 1 },
+      { 16, GL_UNSIGNED_SHORT, GL_TRUE, 2 },
+      { 17, GL_UNSIGNED_INT, GL_FALSE, 4 },
+   };
+   int i;
+
+   for ( i = 0; i < ( int ) ( sizeof ( types ) / sizeof ( types[0] ) ); i++ )
+   {
+      if ( types[i].dataType == dataType )
+      {
+         *normalized = types[i].normalized;
+         *componentSize = types[i].componentSize;
+         return types[i].type;
+      }
+   }
+
+   *normalized = GL_FALSE;
+   *componentSize = 0;
+   return GL_NONE;
+}
+
+typedef struct
+{
+   /// The data block being read: POD data type, components, stride and the data tag
+   GLuint dataType;
+   GLuint components;
+   GLuint stride;
+   const unsigned char *data;
+   GLuint length;
+} ESPODData;
+
+///
+// esEndPODData()
+//
+//    Keep a data block of a mesh: the indices, or an attribute whose data
+//    tag is its offset into the interleaved vertices
+//
+static GLboolean esEndPODData ( ESPODMesh *mesh, GLuint block, const ESPODData *data, GLboolean firstUV )
+{
+   ESPODAttribute *attribute;
+   GLboolean       normalized;
+   int             componentSize;
+   GLenum          type = esPODVertexType ( data->dataType, &normalized, &componentSize );
+
+   if ( block == 6003 )
+   {
+      if ( data->length == 0 || ( type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT ) )
+      {
+         return data->length == 0;
+      }
+
+      mesh->indices = data->data;
+      mesh->indexBytes = data->length;
+      mesh->indexType = type;
+      return GL_TRUE;
+   }
+
+   switch ( block )
+   {
+      case 6006:
+         attribute = &mesh->attributes[ES_POD_POSITION];
+         break;
+
+      case 6007:
+         attribute = &mesh->attributes[ES_POD_NORMAL];
+         break;
+
+      case 6008:
+         attribute = &mesh->attributes[ES_POD_TANGENT];
+         break;
+
+      case 6009:
+         attribute = &mesh->attributes[ES_POD_BINORMAL];
+         break;
+
+      case 6010:
+         attribute = firstUV ? &mesh->attributes[ES_POD_UV0] : NULL;
+         break;
+
+      case 6011:
+         attribute = &mesh->attributes[ES_POD_COLOR];
+         break;
+
+      default:
+         // bone indices and weights are not kept
+         attribute = NULL;
+         break;
+   }
+
+   if ( attribute == NULL || data->components == 0 )
+   {
+      return GL_TRUE;
+   }
+
+   // only interleaved meshes hold an offset in the data tag
+   if ( type == GL_NONE || data->length != 4 || mesh->vertices == NULL || data->components > 4 ||
+         esReadU32 ( data->data ) + data->components * componentSize > data->stride )
+   {
+      return GL_FALSE;
+   }
+
+   attribute->size = data->components;
+   attribute->type = type;
+   attribute->normalized = normalized;
+   attribute->offset = esReadU32 ( data->data );
+   mesh->stride = data->stride;
+
+   return GL_TRUE;
+}
+
+///
+// esLoadPOD()
+//
+//    Map a POD file and walk its tags.  The counts of the scene come
+//    before its blocks, the arrays are allocated at the first block.
+//
+GLboolean ESUTIL_API esLoadPOD ( void *ioContext, const char *fileName, ESPODScene *scene )
+{
+   GLuint    blocks[8];
+   int       depth = 0;
+   int       meshNodeCount = 0;
+   int       uvCount = 0;
+   int       meshIndex = -1, nodeIndex = -1, materialIndex = -1, textureIndex = -1;
+   GLboolean allocated = GL_FALSE;
+   GLboolean valid;
+   ESPODData data;
+   size_t    offset = 0;
+   int       i;
+
+   memset ( scene, 0, sizeof ( ESPODScene ) );
+   memset ( &data, 0, sizeof ( ESPODData ) );
+
+   valid = esMapFile ( ioContext, fileName, &scene->file ) && scene->file.size >= 8 &&
+           esReadU32 ( scene->file.data ) == 1000;
+
+   while ( valid && offset < scene->file.size )
+   {
+      const unsigned char *value;
+      GLuint name, length, parent;
+
+      if ( scene->file.size - offset < 8 )
+      {
+         valid = GL_FALSE;
+         break;
+      }
+
+      name = esReadU32 ( scene->file.data + offset );
+      length = esReadU32 ( scene->file.data + offset + 4 );
+      value = scene->file.data + offset + 8;
+      offset += 8;
+      parent = depth > 0 ? blocks[depth - 1] : 0;
+
+      if ( ( name & 0x80000000 ) && !esIsPODBlock ( name & 0x7FFFFFFF ) )
+      {
+         // every value tag is closed as well
+         continue;
+      }
+
+      if ( name & 0x80000000 )
+      {
+         // end of a block
+         valid = depth > 0 && blocks[depth - 1] == ( name & 0x7FFFFFFF );
+         depth--;
+
+         if ( valid && depth > 0 && blocks[depth - 1] == 2012 )
+         {
+            name &= 0x7FFFFFFF;
+            valid = esEndPODData ( &scene->meshes[meshIndex], name, &data, name != 6010 || uvCount++ == 0 );
+            memset ( &data, 0, sizeof ( ESPODData ) );
+         }
+         else if ( valid && ( name & 0x7FFFFFFF ) == 2012 )
+         {
+            // the mesh must be an interleaved triangle list
+            ESPODMesh *mesh = &scene->meshes[meshIndex];
+            const unsigned char *indices = ( const unsigned char * ) mesh->indices;
+            int indexSize = mesh->indexType == GL_UNSIGNED_INT ? 4 : 2;
+
+            valid = mesh->vertices != NULL && mesh->attributes[ES_POD_POSITION].size > 0 &&
+                    mesh->stride > 0 && mesh->vertexCount <= mesh->vertexBytes / mesh->stride &&
+                    ( mesh->indices == NULL || mesh->indexCount <= mesh->indexBytes / indexSize );
+
+            // indices past the vertices would be read by the GPU
+            for ( i = 0; valid && indices != NULL && i < mesh->indexCount; i++ )
+            {
+               GLuint index = indexSize == 4 ? esReadU32 ( indices + i * 4 ) :
+                              ( GLuint ) ( indices[i * 2] | indices[i * 2 + 1] << 8 );
+
+               valid = index < ( GLuint ) mesh->vertexCount;
+            }
+         }
+
+         continue;
+      }
+
+      if ( length == 0 && esIsPODBlock ( name ) )
+      {
+         // start of a block
+         valid = depth < ( int ) ( sizeof ( blocks ) / sizeof ( blocks[0] ) );
+
+         if ( !valid )
+         {
+            break;
+         }
+
+         blocks[depth++] = name;
+
+         // meshes, nodes, textures and materials are in the scene, data blocks in a mesh
+         if ( name >= 2012 && name <= 2015 )
+         {
+            valid = parent == 1001;
+         }
+         else if ( name != 1001 && ( name < 2010 || name > 2011 ) )
+         {
+            valid = parent == 2012;
+         }
+
+         if ( valid && parent == 1001 && !allocated && name >= 2012 )
+         {
+            // one allocation for every array of the scene
+            size_t size = scene->meshCount * sizeof ( ESPODMesh ) + scene->nodeCount * sizeof ( ESPODNode ) +
+                          scene->materialCount * sizeof ( ESPODMaterial ) + scene->textureCount * sizeof ( char * );
+            unsigned char *arrays = ( unsigned char * ) calloc ( 1, size > 0 ? size : 1 );
+
+            allocated = GL_TRUE;
+            valid = arrays != NULL;
+            scene->meshes = ( ESPODMesh * ) arrays;
+            scene->nodes = ( ESPODNode * ) ( scene->meshes + scene->meshCount );
+            scene->materials = ( ESPODMaterial * ) ( scene->nodes + scene->nodeCount );
+            scene->textureFiles = ( const char ** ) ( scene->materials + scene->materialCount );
+         }
+
+         if ( name == 2012 )
+         {
+            valid = valid && ++meshIndex < scene->meshCount;
+            uvCount = 0;
+         }
+         else if ( name == 2013 )
+         {
+            valid = valid && ++nodeIndex < scene->nodeCount;
+
+            if ( valid )
+            {
+               ESPODNode *node = &scene->nodes[nodeIndex];
+
+               node->meshIndex = node->materialIndex = node->parentIndex = -1;
+               node->rotation[3] = 1.0f;
+               node->scale[0] = node->scale[1] = node->scale[2] = 1.0f;
+            }
+         }
+         else if ( name == 2014 )
+         {
+            valid = valid && ++textureIndex < scene->textureCount;
+         }
+         else if ( name == 2015 )
+         {
+            valid = valid && ++materialIndex < scene->materialCount;
+
+            if ( valid )
+            {
+               scene->materials[materialIndex].diffuseTexture = -1;
+               scene->materials[materialIndex].opacity = 1.0f;
+            }
+         }
+
+         continue;
+      }
+
+      if ( length > scene->file.size - offset )
+      {
+         valid = GL_FALSE;
+         break;
+      }
+
+      offset += length;
+
+      if ( parent == 1001 && length == 4 && name >= 2004 && name <= 2008 && !allocated )
+      {
+         // counts of the scene
+         GLuint count = esReadU32 ( value );
+
+         valid = count <= 0xFFFF;
+
+         switch ( name )
+         {
+            case 2004:
+               scene->meshCount = ( int ) count;
+               break;
+
+            case 2005:
+               scene->nodeCount = ( int ) count;
+               break;
+
+            case 2006:
+               meshNodeCount = ( int ) count;
+               break;
+
+            case 2007:
+               scene->textureCount = ( int ) count;
+               break;
+
+            case 2008:
+               scene->materialCount = ( int ) count;
+               break;
+         }
+      }
+      else if ( parent == 2012 )
+      {
+         ESPODMesh *mesh = &scene->meshes[meshIndex];
+
+         // counts an int can't hold would pass the size checks once negative
+         if ( name == 6000 && length == 4 )
+         {
+            valid = esReadU32 ( value ) <= INT_MAX;
+            mesh->vertexCount = valid ? ( int ) esReadU32 ( value ) : 0;
+         }
+         else if ( name == 6001 && length == 4 )
+         {
+            valid = esReadU32 ( value ) <= INT_MAX / 3;
+            mesh->indexCount = valid ? ( int ) ( esReadU32 ( value ) * 3 ) : 0;
+         }
+         else if ( name == 6005 && length == 4 )
+         {
+            // triangle strips are not supported
+            valid = esReadU32 ( value ) == 0;
+         }
+         else if ( name == 6014 )
+         {
+            mesh->vertices = value;
+            mesh->vertexBytes = length;
+         }
+      }
+      else if ( parent >= 6003 && parent <= 6013 && length > 0 )
+      {
+         if ( name == 9003 )
+         {
+            data.data = value;
+            data.length = length;
+         }
+         else if ( length == 4 )
+         {
+            GLuint number = esReadU32 ( value );
+
+            data.dataType = name == 9000 ? number : data.dataType;
+            data.components = name == 9001 ? number : data.components;
+            data.stride = name == 9002 ? number : data.stride;
+         }
+      }
+      else if ( parent == 2013 )
+      {
+         ESPODNode *node = &scene->nodes[nodeIndex];
+
+         if ( name == 5000 && length == 4 )
+         {
+            // the mesh of mesh nodes, lights and cameras follow them
+            node->meshIndex = nodeIndex < meshNodeCount ? ( int ) esReadU32 ( value ) : -1;
+            valid = nodeIndex >= meshNodeCount || esReadU32 ( value ) < ( GLuint ) scene->meshCount;
+         }
+         else if ( name == 5001 )
+         {
+            node->name = esReadPODString ( value, length );
+         }
+         else if ( name == 5002 && length == 4 )
+         {
+            node->materialIndex = esReadU32 ( value ) < ( GLuint ) scene->materialCount ? ( int ) esReadU32 ( value ) : -1;
+         }
+         else if ( name == 5003 && length == 4 )
+         {
+            node->parentIndex = esReadU32 ( value ) < ( GLuint ) scene->nodeCount ? ( int ) esReadU32 ( value ) : -1;
+         }
+         else if ( ( name == 5007 || name == 5009 ) && length >= 12 )
+         {
+            // the first frame, scale is followed by its own rotation
+            for ( i = 0; i < 3; i++ )
+            {
+               ( name == 5007 ? node->position : node->scale ) [i] = esReadFloat ( value + i * 4 );
+            }
+         }
+         else if ( name == 5008 && length >= 16 )
+         {
+            for ( i = 0; i < 4; i++ )
+            {
+               node->rotation[i] = esReadFloat ( value + i * 4 );
+            }
+         }
+      }
+      else if ( parent == 2014 && name == 4000 )
+      {
+         scene->textureFiles[textureIndex] = esReadPODString ( value, length );
+      }
+      else if ( parent == 2015 )
+      {
+         ESPODMaterial *material = &scene->materials[materialIndex];
+
+         if ( name == 3000 )
+         {
+            material->name = esReadPODString ( value, length );
+         }
+         else if ( name == 3001 && length == 4 )
+         {
+            material->diffuseTexture = esReadU32 ( value ) < ( GLuint ) scene->textureCount ? ( int ) esReadU32 ( value ) : -1;
+         }
+         else if ( name == 3002 && length == 4 )
+         {
+            material->opacity = esReadFloat ( value );
+         }
+         else if ( name >= 3003 && name <= 3005 && length == 12 )
+         {
+            for ( i = 0; i < 3; i++ )
+            {
+               ( name == 3003 ? material->ambient : name == 3004 ? material->diffuse : material->specular ) [i] =
+                  esReadFloat ( value + i * 4 );
+            }
+         }
+         else if ( name == 3006 && length == 4 )
+         {
+            material->shininess = esReadFloat ( value );
+         }
+         else if ( name == 3007 )
+         {
+            material->effectFile = esReadPODString ( value, length );
+         }
+         else if ( name == 3008 )
+         {
+            material->effectName = esReadPODString ( value, length );
+         }
+      }
+   }
+
+   if ( !valid || depth != 0 || meshIndex + 1 != scene->meshCount )
+   {
+      esLogMessage ( "esLoadPOD FAILED to load : { %s }\n", fileName );
+      esFreePOD ( scene );
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// esFreePOD()
+//
+//    Release the arrays and the mapping of a scene from esLoadPOD
+//
+void ESUTIL_API esFreePOD ( ESPODScene *scene )
+{
+   if ( scene == NULL )
+   {
+      return;
+   }
+
+   free ( scene->meshes );
+   esUnmapFile ( &scene->file );
+   memset ( scene, 0, sizeof ( ESPODScene ) );
+}
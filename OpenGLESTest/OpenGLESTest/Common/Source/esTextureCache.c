@@ -0,0 +1,322 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esTextureCache.c
+//
+//    A cache sharing the textures of files by reference count, with an
+//    LRU budget for the textures nothing references anymore.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil_private.h"
+
+///
+// Texture cache
+//
+typedef struct
+{
+   /// Key: file and sampler parameters
+   char           *fileName;
+   GLint           filter;
+   GLint           wrap;
+
+   GLuint          texture;
+   GLsizeiptr      bytes;
+
+   /// Unreferenced textures stay until the budget needs their memory, least recently used first
+   int             refCount;
+   unsigned int    lastUse;
+} ESCachedTexture;
+
+struct ESTextureCache
+{
+   void              *ioContext;
+   GLsizeiptr         budget;
+
+   ESCachedTexture   *textures;
+   int                textureCount;
+   int                textureCapacity;
+
+   /// Advanced by every acquire and release, orders lastUse
+   unsigned int       clock;
+
+   ESTextureCacheStats stats;
+};
+
+///
+// esTrimTextureCache()
+//
+//    Delete unreferenced textures, least recently used first, until the
+//    cache is within its budget
+//
+static void esTrimTextureCache ( ESTextureCache *cache )
+{
+   while ( cache->budget > 0 && cache->stats.residentBytes > cache->budget )
+   {
+      int oldest = -1;
+      int i;
+
+      for ( i = 0; i < cache->textureCount; i++ )
+      {
+         if ( cache->textures[i].refCount == 0 &&
+               ( oldest < 0 || cache->textures[i].lastUse < cache->textures[oldest].lastUse ) )
+         {
+            oldest = i;
+         }
+      }
+
+      if ( oldest < 0 )
+      {
+         // everything left is in use
+         return;
+      }
+
+      glDeleteTextures ( 1, &cache->textures[oldest].texture );
+      free ( cache->textures[oldest].fileName );
+      cache->stats.residentBytes -= cache->textures[oldest].bytes;
+      cache->stats.evictions++;
+      cache->textures[oldest] = cache->textures[--cache->textureCount];
+   }
+}
+
+///
+// esCreateTextureCache()
+//
+//    Create an empty cache, budget 0 never evicts
+//
+ESTextureCache *ESUTIL_API esCreateTextureCache ( void *ioContext, GLsizeiptr budget )
+{
+   ESTextureCache *cache = ( ESTextureCache * ) calloc ( 1, sizeof ( ESTextureCache ) );
+
+   if ( cache == NULL )
+   {
+      return NULL;
+   }
+
+   cache->ioContext = ioContext;
+   cache->budget = budget;
+
+   return cache;
+}
+
+///
+// esAcquireTexture()
+//
+//    Return the texture of a file with these sampler parameters, loading it
+//    only when the cache does not hold it already
+//
+GLuint ESUTIL_API esAcquireTexture ( ESTextureCache *cache, const char *fileName, GLint filter, GLint wrap )
+{
+   ESCachedTexture *cached;
+   ESImage          image;
+   ESTextureInfo    info;
+   GLuint           texture;
+   GLint            binding;
+   GLsizeiptr       pixelSize;
+   GLboolean        ktx, pvr;
+   size_t           length;
+   int              i;
+
+   for ( i = 0; i < cache->textureCount; i++ )
+   {
+      cached = &cache->textures[i];
+
+      if ( cached->filter == filter && cached->wrap == wrap && strcmp ( cached->fileName, fileName ) == 0 )
+      {
+         cached->refCount++;
+         cached->lastUse = ++cache->clock;
+         cache->stats.hits++;
+         return cached->texture;
+      }
+   }
+
+   cache->stats.misses++;
+
+   if ( cache->textureCount == cache->textureCapacity )
+   {
+      int              capacity = cache->textureCapacity > 0 ? cache->textureCapacity * 2 : 16;
+      ESCachedTexture *textures = ( ESCachedTexture * ) realloc ( cache->textures, capacity * sizeof ( ESCachedTexture ) );
+
+      if ( textures == NULL )
+      {
+         return 0;
+      }
+
+      cache->textures = textures;
+      cache->textureCapacity = capacity;
+   }
+
+   // KTX and PVR files are uploaded as they are with the levels they hold, TGA files are decoded
+   length = strlen ( fileName ) + 1;
+   pvr = length > 5 && strcmp ( fileName + length - 5, ".pvr" ) == 0;
+   ktx = pvr || ( length > 5 && strcmp ( fileName + length - 5, ".ktx" ) == 0 ) ||
+         ( length > 6 && strcmp ( fileName + length - 6, ".ktx2" ) == 0 );
+
+   if ( !ktx && !esMapTGA ( cache->ioContext, fileName, &image ) )
+   {
+      return 0;
+   }
+
+   cached = &cache->textures[cache->textureCount];
+   cached->fileName = ( char * ) malloc ( length );
+
+   if ( cached->fileName == NULL )
+   {
+      esFreeTGA ( ktx ? NULL : &image );
+      return 0;
+   }
+
+   memcpy ( cached->fileName, fileName, length );
+   cached->filter = filter;
+   cached->wrap = wrap;
+   cached->refCount = 1;
+   cached->lastUse = ++cache->clock;
+
+   glGetIntegerv ( GL_TEXTURE_BINDING_2D, &binding );
+   glGenTextures ( 1, &cached->texture );
+   glBindTexture ( GL_TEXTURE_2D, cached->texture );
+
+   if ( ktx )
+   {
+      if ( !( pvr ? esTexImagePVR ( cache->ioContext, fileName, GL_TEXTURE_2D, &info ) :
+              esTexImageKTX ( cache->ioContext, fileName, GL_TEXTURE_2D, &info ) ) )
+      {
+         glBindTexture ( GL_TEXTURE_2D, binding );
+         glDeleteTextures ( 1, &cached->texture );
+         free ( cached->fileName );
+         return 0;
+      }
+
+      cached->bytes = info.bytes;
+      cache->stats.uploadedBytes += info.bytes;
+   }
+   else
+   {
+      esTexImageTGA ( GL_TEXTURE_2D, 0, &image );
+
+      // RGB is counted as 4 bytes, drivers pad it
+      pixelSize = image.bytesPerPixel == 3 ? 4 : image.bytesPerPixel;
+      cached->bytes = pixelSize * image.width * image.height;
+      cache->stats.uploadedBytes += ( GLsizeiptr ) image.bytesPerPixel * image.width * image.height;
+
+      if ( filter != GL_NEAREST && filter != GL_LINEAR )
+      {
+         glGenerateMipmap ( GL_TEXTURE_2D );
+         cached->bytes += cached->bytes / 3;
+      }
+
+      esFreeTGA ( &image );
+   }
+
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+                     filter == GL_NEAREST || filter == GL_NEAREST_MIPMAP_NEAREST ||
+                     filter == GL_NEAREST_MIPMAP_LINEAR ? GL_NEAREST : GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap );
+   glBindTexture ( GL_TEXTURE_2D, binding );
+
+   // the new texture is referenced, trimming may move it but won't delete it
+   texture = cached->texture;
+   cache->textureCount++;
+   cache->stats.residentBytes += cached->bytes;
+   esTrimTextureCache ( cache );
+
+   return texture;
+}
+
+///
+// esReleaseTexture()
+//
+//    Drop a reference from esAcquireTexture
+//
+void ESUTIL_API esReleaseTexture ( ESTextureCache *cache, GLuint texture )
+{
+   int i;
+
+   for ( i = 0; i < cache->textureCount; i++ )
+   {
+      if ( cache->textures[i].texture == texture && cache->textures[i].refCount > 0 )
+      {
+         cache->textures[i].refCount--;
+         cache->textures[i].lastUse = ++cache->clock;
+         esTrimTextureCache ( cache );
+         return;
+      }
+   }
+}
+
+///
+// esGetTextureCacheStats()
+//
+//    Counters since esCreateTextureCache and the textures held now
+//
+void ESUTIL_API esGetTextureCacheStats ( const ESTextureCache *cache, ESTextureCacheStats *stats )
+{
+   int i;
+
+   *stats = cache->stats;
+   stats->textureCount = cache->textureCount;
+   stats->referencedCount = 0;
+
+   for ( i = 0; i < cache->textureCount; i++ )
+   {
+      stats->referencedCount += cache->textures[i].refCount > 0;
+   }
+}
+
+///
+// esDestroyTextureCache()
+//
+//    Delete every texture of the cache, referenced or not
+//
+void ESUTIL_API esDestroyTextureCache ( ESTextureCache *cache )
+{
+   int i;
+
+   if ( cache == NULL )
+   {
+      return;
+   }
+
+   for ( i = 0; i < cache->textureCount; i++ )
+   {
+      glDeleteTextures ( 1, &cache->textures[i].texture );
+      free ( cache->textures[i].fileName );
+   }
+
+   free ( cache->textures );
+   free ( cache );
+}
@@ -0,0 +1,783 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esTextureMip.c
+//
+//    Mip chains built on the CPU with SSE2 / NEON into one allocation.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil_private.h"
+
+///
+// Mipmaps
+//
+
+/// sRGB values to linear, the linear values half way between two sRGB values, and the sRGB
+/// value at the start of 4096 steps of linear values
+#define SRGB_ENCODE_STEPS 4096
+static float srgbToLinear[256];
+static float srgbThresholds[256];
+static GLubyte srgbEncode[SRGB_ENCODE_STEPS];
+static GLboolean srgbTablesReady = GL_FALSE;
+
+static float esSrgbDecode ( float value )
+{
+   return value <= 0.04045f ? value / 12.92f : powf ( ( value + 0.055f ) / 1.055f, 2.4f );
+}
+
+///
+// esInitSrgbTables()
+//
+//    Fill the sRGB tables on first use, every caller writes the same values
+//
+static void esInitSrgbTables ( void )
+{
+   int i;
+
+   if ( srgbTablesReady )
+   {
+      return;
+   }
+
+   for ( i = 0; i < 256; i++ )
+   {
+      srgbToLinear[i] = esSrgbDecode ( i / 255.0f );
+   }
+
+   for ( i = 0; i < 255; i++ )
+   {
+      srgbThresholds[i] = esSrgbDecode ( ( i + 0.5f ) / 255.0f );
+   }
+
+   // past every linear value
+   srgbThresholds[255] = 2.0f;
+
+   for ( i = 0; i < SRGB_ENCODE_STEPS; i++ )
+   {
+      int value = i == 0 ? 0 : srgbEncode[i - 1];
+
+      while ( ( float ) i / SRGB_ENCODE_STEPS > srgbThresholds[value] )
+      {
+         value++;
+      }
+
+      srgbEncode[i] = ( GLubyte ) value;
+   }
+
+   srgbTablesReady = GL_TRUE;
+}
+
+///
+// esSrgbEncode()
+//
+//    Nearest sRGB value of a linear value: the table gives the value at the
+//    start of its step, the thresholds move it up the one value a step of the
+//    darkest colors can span
+//
+static GLubyte esSrgbEncode ( float linear )
+{
+   int step = ( int ) ( linear * SRGB_ENCODE_STEPS );
+   int value;
+
+   step = step < 0 ? 0 : step >= SRGB_ENCODE_STEPS ? SRGB_ENCODE_STEPS - 1 : step;
+   value = srgbEncode[step];
+
+   while ( linear > srgbThresholds[value] )
+   {
+      value++;
+   }
+
+   return ( GLubyte ) value;
+}
+
+static int esMipChannels ( GLenum format )
+{
+   switch ( format )
+   {
+      case GL_LUMINANCE:
+         return 1;
+
+      case GL_LUMINANCE_ALPHA:
+         return 2;
+
+      case GL_RGB:
+         return 3;
+
+      case GL_RGBA:
+         return 4;
+
+      default:
+         return 0;
+   }
+}
+
+///
+// esMipTaps()
+//
+//    Source pixels and weights of pixel i of a level dstSize wide, box
+//    filtered from one srcSize wide.  An odd srcSize covers each destination
+//    pixel with a box 2 + 1 / dstSize wide, 3 taps with weights that follow
+//    where the box starts, so the last column or row is not dropped.
+//
+static int esMipTaps ( int srcSize, int dstSize, int i, int *first, float weights[3] )
+{
+   if ( srcSize == 1 )
+   {
+      *first = 0;
+      weights[0] = 1.0f;
+      return 1;
+   }
+
+   *first = 2 * i;
+
+   if ( srcSize % 2 == 0 )
+   {
+      weights[0] = weights[1] = 0.5f;
+      return 2;
+   }
+
+   weights[0] = ( float ) ( dstSize - i ) / srcSize;
+   weights[1] = ( float ) dstSize / srcSize;
+   weights[2] = ( float ) ( i + 1 ) / srcSize;
+   return 3;
+}
+
+///
+// esMipLevelFiltered()
+//
+//    Build a level with the taps of esMipTaps, for odd sizes.  The
+//    source rows under a destination row are filtered into row first (sRGB
+//    colors decoded to linear), then the columns of row into the destination.
+//
+static void esMipLevelFiltered ( const ESMipChain *chain, int level, float *row )
+{
+   const unsigned char *src = chain->pixels + chain->offset[level - 1];
+   unsigned char *dst = chain->pixels + chain->offset[level];
+   int srcWidth = chain->width[level - 1];
+   int srcHeight = chain->height[level - 1];
+   int dstWidth = chain->width[level];
+   int dstHeight = chain->height[level];
+   int channels = esMipChannels ( chain->format );
+   int values = srcWidth * channels;
+   GLboolean isFloat = chain->type == GL_FLOAT;
+
+   // alpha stays linear
+   int colorChannels = !chain->srgb ? 0 : channels == 2 || channels == 4 ? channels - 1 : channels;
+   int x, y, c, i, t;
+
+   for ( y = 0; y < dstHeight; y++ )
+   {
+      float weights[3];
+      int   first;
+      int   taps = esMipTaps ( srcHeight, dstHeight, y, &first, weights );
+
+      memset ( row, 0, values * sizeof ( float ) );
+
+      for ( t = 0; t < taps; t++ )
+      {
+         size_t start = ( size_t ) ( first + t ) * values;
+
+         if ( isFloat )
+         {
+            const GLfloat *srcRow = ( const GLfloat * ) src + start;
+
+            for ( i = 0; i < values; i++ )
+            {
+               row[i] += weights[t] * srcRow[i];
+            }
+         }
+         else if ( colorChannels == 0 )
+         {
+            const GLubyte *srcRow = src + start;
+
+            for ( i = 0; i < values; i++ )
+            {
+               row[i] += weights[t] * srcRow[i];
+            }
+         }
+         else
+         {
+            const GLubyte *srcRow = src + start;
+
+            for ( i = 0; i < values; i += channels )
+            {
+               for ( c = 0; c < channels; c++ )
+               {
+                  row[i + c] += weights[t] * ( c < colorChannels ? srgbToLinear[srcRow[i + c]] : srcRow[i + c] );
+               }
+            }
+         }
+      }
+
+      for ( x = 0; x < dstWidth; x++ )
+      {
+         size_t out = ( ( size_t ) y * dstWidth + x ) * channels;
+
+         taps = esMipTaps ( srcWidth, dstWidth, x, &first, weights );
+
+         for ( c = 0; c < channels; c++ )
+         {
+            float value = 0.0f;
+
+            for ( t = 0; t < taps; t++ )
+            {
+               value += weights[t] * row[( first + t ) * channels + c];
+            }
+
+            if ( isFloat )
+            {
+               ( ( GLfloat * ) dst ) [out + c] = value;
+            }
+            else if ( c < colorChannels )
+            {
+               dst[out + c] = esSrgbEncode ( value );
+            }
+            else
+            {
+               dst[out + c] = ( GLubyte ) ( value > 254.5f ? 255 : ( int ) ( value + 0.5f ) );
+            }
+         }
+      }
+   }
+}
+
+#if defined(ES_SSE2)
+///
+// esPairSumsSSE2()
+//
+//    Sums of 2x2 pixels under 16 bytes of two rows: 8 16-bit sums, the
+//    channels of 8 / 4 / 2 destination pixels of 1 / 2 / 4 bytes
+//
+static __m128i esPairSumsSSE2 ( const GLubyte *row0, const GLubyte *row1, int pixelSize )
+{
+   __m128i zero = _mm_setzero_si128 ();
+   __m128i a = _mm_loadu_si128 ( ( const __m128i * ) row0 );
+   __m128i b = _mm_loadu_si128 ( ( const __m128i * ) row1 );
+   __m128i lo = _mm_add_epi16 ( _mm_unpacklo_epi8 ( a, zero ), _mm_unpacklo_epi8 ( b, zero ) );
+   __m128i hi = _mm_add_epi16 ( _mm_unpackhi_epi8 ( a, zero ), _mm_unpackhi_epi8 ( b, zero ) );
+
+   switch ( pixelSize )
+   {
+      case 1:
+         // neighbouring 16-bit lanes
+         return _mm_packs_epi32 ( _mm_madd_epi16 ( lo, _mm_set1_epi16 ( 1 ) ),
+                                  _mm_madd_epi16 ( hi, _mm_set1_epi16 ( 1 ) ) );
+
+      case 2:
+         // even and odd pixels into separate halves first
+         lo = _mm_shuffle_epi32 ( lo, _MM_SHUFFLE ( 3, 1, 2, 0 ) );
+         hi = _mm_shuffle_epi32 ( hi, _MM_SHUFFLE ( 3, 1, 2, 0 ) );
+         return _mm_add_epi16 ( _mm_unpacklo_epi64 ( lo, hi ), _mm_unpackhi_epi64 ( lo, hi ) );
+
+      default:
+         return _mm_add_epi16 ( _mm_unpacklo_epi64 ( lo, hi ), _mm_unpackhi_epi64 ( lo, hi ) );
+   }
+}
+
+///
+// esPairSumsRGBSSE2()
+//
+//    Sums of 2x2 pixels under 12 bytes of two rows of 3-byte pixels, the
+//    channels of 2 destination pixels in the first 6 16-bit lanes, the last 2
+//    are 0.  16 bytes are read.
+//
+static __m128i esPairSumsRGBSSE2 ( const GLubyte *row0, const GLubyte *row1 )
+{
+   __m128i zero = _mm_setzero_si128 ();
+   __m128i a = _mm_loadu_si128 ( ( const __m128i * ) row0 );
+   __m128i b = _mm_loadu_si128 ( ( const __m128i * ) row1 );
+   __m128i lo = _mm_add_epi16 ( _mm_unpacklo_epi8 ( a, zero ), _mm_unpacklo_epi8 ( b, zero ) );
+   __m128i hi = _mm_add_epi16 ( _mm_unpackhi_epi8 ( a, zero ), _mm_unpackhi_epi8 ( b, zero ) );
+
+   // pixels 2 and 3 start in the middle of lo, moved to the first lanes
+   __m128i mid = _mm_or_si128 ( _mm_srli_si128 ( lo, 12 ), _mm_slli_si128 ( hi, 4 ) );
+   __m128i first = _mm_add_epi16 ( lo, _mm_srli_si128 ( lo, 6 ) );
+   __m128i second = _mm_add_epi16 ( mid, _mm_srli_si128 ( mid, 6 ) );
+
+   // the 3 sums of each out of the other lanes, which are left 0
+   return _mm_or_si128 ( _mm_srli_si128 ( _mm_slli_si128 ( first, 10 ), 10 ),
+                         _mm_srli_si128 ( _mm_slli_si128 ( second, 10 ), 4 ) );
+}
+#endif
+
+///
+// esMipRowU8()
+//
+//    Average 2x2 blocks of two 8-bit rows into count pixels, rounded
+//    ( a + b + c + d + 2 ) / 4 on every path
+//
+static void esMipRowU8 ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count, int pixelSize )
+{
+   int x = 0;
+   int c;
+
+#if defined(ES_SSE2)
+   if ( pixelSize == 3 )
+   {
+      const __m128i two = _mm_set1_epi16 ( 2 );
+
+      // 4 pixels a step, the last load of a step ends 4 bytes into the next one
+      for ( ; x + 5 <= count; x += 4 )
+      {
+         __m128i a = _mm_srli_epi16 ( _mm_add_epi16 ( esPairSumsRGBSSE2 ( row0 + 6 * x, row1 + 6 * x ), two ), 2 );
+         __m128i b = _mm_srli_epi16 ( _mm_add_epi16 ( esPairSumsRGBSSE2 ( row0 + 6 * x + 12, row1 + 6 * x + 12 ),
+                                      two ), 2 );
+         __m128i packed = _mm_packus_epi16 ( _mm_or_si128 ( a, _mm_slli_si128 ( b, 12 ) ), _mm_srli_si128 ( b, 4 ) );
+         int     last = _mm_cvtsi128_si32 ( _mm_srli_si128 ( packed, 8 ) );
+
+         _mm_storel_epi64 ( ( __m128i * ) ( dst + 3 * x ), packed );
+         memcpy ( dst + 3 * x + 8, &last, 4 );
+      }
+   }
+   else
+   {
+      const __m128i two = _mm_set1_epi16 ( 2 );
+      int bytes = count * pixelSize;
+      int i;
+
+      for ( i = 0; i + 16 <= bytes; i += 16 )
+      {
+         __m128i a = _mm_srli_epi16 ( _mm_add_epi16 ( esPairSumsSSE2 ( row0 + 2 * i, row1 + 2 * i, pixelSize ), two ), 2 );
+         __m128i b = _mm_srli_epi16 ( _mm_add_epi16 ( esPairSumsSSE2 ( row0 + 2 * i + 16, row1 + 2 * i + 16, pixelSize ),
+                                      two ), 2 );
+
+         _mm_storeu_si128 ( ( __m128i * ) ( dst + i ), _mm_packus_epi16 ( a, b ) );
+      }
+
+      x = i / pixelSize;
+   }
+#elif defined(ES_NEON)
+   // the loads split the pixels into channels, pairs are summed within each channel
+#define MIP_ROW_NEON(n)                                                               \
+   for ( ; x + 8 <= count; x += 8 )                                                   \
+   {                                                                                  \
+      uint8x16x##n##_t a = vld##n##q_u8 ( row0 + 2 * n * x );                         \
+      uint8x16x##n##_t b = vld##n##q_u8 ( row1 + 2 * n * x );                         \
+      uint8x8x##n##_t  d;                                                             \
+      for ( c = 0; c < n; c++ )                                                       \
+      {                                                                               \
+         d.val[c] = vrshrn_n_u16 ( vpadalq_u8 ( vpaddlq_u8 ( a.val[c] ), b.val[c] ), 2 ); \
+      }                                                                               \
+      vst##n##_u8 ( dst + n * x, d );                                                 \
+   }
+
+   switch ( pixelSize )
+   {
+      case 1:
+         for ( ; x + 8 <= count; x += 8 )
+         {
+            uint16x8_t sums = vpadalq_u8 ( vpaddlq_u8 ( vld1q_u8 ( row0 + 2 * x ) ), vld1q_u8 ( row1 + 2 * x ) );
+            vst1_u8 ( dst + x, vrshrn_n_u16 ( sums, 2 ) );
+         }
+
+         break;
+
+      case 2:
+         MIP_ROW_NEON ( 2 )
+         break;
+
+      case 3:
+         MIP_ROW_NEON ( 3 )
+         break;
+
+      default:
+         MIP_ROW_NEON ( 4 )
+         break;
+   }
+
+#undef MIP_ROW_NEON
+#endif
+
+   for ( ; x < count; x++ )
+   {
+      const GLubyte *a = row0 + 2 * x * pixelSize;
+      const GLubyte *b = row1 + 2 * x * pixelSize;
+
+      for ( c = 0; c < pixelSize; c++ )
+      {
+         dst[x * pixelSize + c] = ( GLubyte ) ( ( a[c] + a[c + pixelSize] + b[c] + b[c + pixelSize] + 2 ) >> 2 );
+      }
+   }
+}
+
+///
+// esMipRowSrgb()
+//
+//    Average 2x2 blocks of two sRGB rows into count pixels, the colors in
+//    linear space and alpha as it is
+//
+static void esMipRowSrgb ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count, int channels,
+                           int colorChannels )
+{
+   int x, c;
+
+   for ( x = 0; x < count; x++ )
+   {
+      const GLubyte *a = row0 + 2 * x * channels;
+      const GLubyte *b = row1 + 2 * x * channels;
+
+      for ( c = 0; c < colorChannels; c++ )
+      {
+         dst[x * channels + c] = esSrgbEncode ( ( srgbToLinear[a[c]] + srgbToLinear[a[c + channels]] +
+                                                  srgbToLinear[b[c]] + srgbToLinear[b[c + channels]] ) * 0.25f );
+      }
+
+      for ( ; c < channels; c++ )
+      {
+         dst[x * channels + c] = ( GLubyte ) ( ( a[c] + a[c + channels] + b[c] + b[c + channels] + 2 ) >> 2 );
+      }
+   }
+}
+
+///
+// esMipRowF32()
+//
+//    Average 2x2 blocks of two float rows into count pixels
+//
+static void esMipRowF32 ( const GLfloat *row0, const GLfloat *row1, GLfloat *dst, int count, int channels )
+{
+   int x = 0;
+   int c;
+
+#if defined(ES_SSE2)
+   const __m128 quarter = _mm_set1_ps ( 0.25f );
+
+   switch ( channels )
+   {
+      case 1:
+         for ( ; x + 4 <= count; x += 4 )
+         {
+            __m128 a = _mm_add_ps ( _mm_loadu_ps ( row0 + 2 * x ), _mm_loadu_ps ( row1 + 2 * x ) );
+            __m128 b = _mm_add_ps ( _mm_loadu_ps ( row0 + 2 * x + 4 ), _mm_loadu_ps ( row1 + 2 * x + 4 ) );
+            __m128 sums = _mm_add_ps ( _mm_shuffle_ps ( a, b, _MM_SHUFFLE ( 2, 0, 2, 0 ) ),
+                                       _mm_shuffle_ps ( a, b, _MM_SHUFFLE ( 3, 1, 3, 1 ) ) );
+            _mm_storeu_ps ( dst + x, _mm_mul_ps ( sums, quarter ) );
+         }
+
+         break;
+
+      case 2:
+         for ( ; x + 2 <= count; x += 2 )
+         {
+            __m128 a = _mm_add_ps ( _mm_loadu_ps ( row0 + 2 * x * 2 ), _mm_loadu_ps ( row1 + 2 * x * 2 ) );
+            __m128 b = _mm_add_ps ( _mm_loadu_ps ( row0 + 2 * x * 2 + 4 ), _mm_loadu_ps ( row1 + 2 * x * 2 + 4 ) );
+            __m128 sums = _mm_add_ps ( _mm_movelh_ps ( a, b ), _mm_movehl_ps ( b, a ) );
+            _mm_storeu_ps ( dst + x * 2, _mm_mul_ps ( sums, quarter ) );
+         }
+
+         break;
+
+      case 4:
+         for ( ; x < count; x++ )
+         {
+            __m128 a = _mm_add_ps ( _mm_loadu_ps ( row0 + 8 * x ), _mm_loadu_ps ( row1 + 8 * x ) );
+            __m128 b = _mm_add_ps ( _mm_loadu_ps ( row0 + 8 * x + 4 ), _mm_loadu_ps ( row1 + 8 * x + 4 ) );
+            _mm_storeu_ps ( dst + 4 * x, _mm_mul_ps ( _mm_add_ps ( a, b ), quarter ) );
+         }
+
+         break;
+   }
+#elif defined(ES_NEON)
+   const float32x4_t quarter = vdupq_n_f32 ( 0.25f );
+
+   switch ( channels )
+   {
+      case 1:
+         for ( ; x + 4 <= count; x += 4 )
+         {
+            float32x4x2_t a = vld2q_f32 ( row0 + 2 * x );
+            float32x4x2_t b = vld2q_f32 ( row1 + 2 * x );
+            float32x4_t sums = vaddq_f32 ( vaddq_f32 ( a.val[0], a.val[1] ), vaddq_f32 ( b.val[0], b.val[1] ) );
+            vst1q_f32 ( dst + x, vmulq_f32 ( sums, quarter ) );
+         }
+
+         break;
+
+      case 2:
+         // every other pixel in val[0] / val[1], the ones between in val[2] / val[3]
+         for ( ; x + 4 <= count; x += 4 )
+         {
+            float32x4x4_t a = vld4q_f32 ( row0 + 2 * x * 2 );
+            float32x4x4_t b = vld4q_f32 ( row1 + 2 * x * 2 );
+            float32x4x2_t d;
+
+            for ( c = 0; c < 2; c++ )
+            {
+               d.val[c] = vmulq_f32 ( vaddq_f32 ( vaddq_f32 ( a.val[c], a.val[c + 2] ),
+                                                  vaddq_f32 ( b.val[c], b.val[c + 2] ) ), quarter );
+            }
+
+            vst2q_f32 ( dst + x * 2, d );
+         }
+
+         break;
+
+      case 4:
+         for ( ; x < count; x++ )
+         {
+            float32x4_t a = vaddq_f32 ( vld1q_f32 ( row0 + 8 * x ), vld1q_f32 ( row1 + 8 * x ) );
+            float32x4_t b = vaddq_f32 ( vld1q_f32 ( row0 + 8 * x + 4 ), vld1q_f32 ( row1 + 8 * x + 4 ) );
+            vst1q_f32 ( dst + 4 * x, vmulq_f32 ( vaddq_f32 ( a, b ), quarter ) );
+         }
+
+         break;
+   }
+#endif
+
+   for ( ; x < count; x++ )
+   {
+      const GLfloat *a = row0 + 2 * x * channels;
+      const GLfloat *b = row1 + 2 * x * channels;
+
+      for ( c = 0; c < channels; c++ )
+      {
+         dst[x * channels + c] = ( a[c] + b[c] + a[c + channels] + b[c + channels] ) * 0.25f;
+      }
+   }
+}
+
+///
+// esBuildMipChain()
+//
+//    Copy level 0 into one allocation with room for every level and
+//    build the others from the one above.  Even sizes take the 2x2 row
+//    averages, odd sizes esMipLevelFiltered.
+//
+GLboolean ESUTIL_API esBuildMipChain ( ESMipChain *chain, const void *pixels, int width, int height,
+                                       GLenum format, GLenum type, GLboolean srgb )
+{
+   int    channels = esMipChannels ( format );
+   size_t size = 0;
+   float *row;
+   int    level;
+
+   memset ( chain, 0, sizeof ( ESMipChain ) );
+
+   if ( channels == 0 || ( type != GL_UNSIGNED_BYTE && type != GL_FLOAT ) || width <= 0 || height <= 0 )
+   {
+      return GL_FALSE;
+   }
+
+   chain->format = format;
+   chain->type = type;
+   chain->srgb = srgb && type == GL_UNSIGNED_BYTE;
+   chain->pixelSize = channels * ( type == GL_FLOAT ? sizeof ( GLfloat ) : 1 );
+
+   // halved and rounded down like GL does, every level starting 16-byte aligned
+   for ( level = 0; level < ES_MAX_MIP_LEVELS; level++ )
+   {
+      chain->width[level] = width;
+      chain->height[level] = height;
+      chain->offset[level] = size;
+      chain->levelCount = level + 1;
+      size += ( ( size_t ) width * height * chain->pixelSize + 15 ) & ~( size_t ) 15;
+
+      if ( width == 1 && height == 1 )
+      {
+         break;
+      }
+
+      width = width > 1 ? width / 2 : 1;
+      height = height > 1 ? height / 2 : 1;
+   }
+
+   if ( level == ES_MAX_MIP_LEVELS )
+   {
+      memset ( chain, 0, sizeof ( ESMipChain ) );
+      return GL_FALSE;
+   }
+
+   chain->pixels = malloc ( size );
+   chain->size = size;
+   row = malloc ( ( size_t ) chain->width[0] * channels * sizeof ( float ) );
+
+   if ( chain->pixels == NULL || row == NULL )
+   {
+      free ( row );
+      esFreeMipChain ( chain );
+      return GL_FALSE;
+   }
+
+   memcpy ( chain->pixels, pixels, ( size_t ) chain->width[0] * chain->height[0] * chain->pixelSize );
+
+   if ( chain->srgb )
+   {
+      esInitSrgbTables ();
+   }
+
+   for ( level = 1; level < chain->levelCount; level++ )
+   {
+      const unsigned char *src = chain->pixels + chain->offset[level - 1];
+      unsigned char *dst = chain->pixels + chain->offset[level];
+      size_t srcPitch = ( size_t ) chain->width[level - 1] * chain->pixelSize;
+      size_t dstPitch = ( size_t ) chain->width[level] * chain->pixelSize;
+      int    y;
+
+      if ( chain->width[level - 1] % 2 != 0 || chain->height[level - 1] % 2 != 0 )
+      {
+         esMipLevelFiltered ( chain, level, row );
+         continue;
+      }
+
+      for ( y = 0; y < chain->height[level]; y++ )
+      {
+         const unsigned char *row0 = src + 2 * y * srcPitch;
+
+         if ( type == GL_FLOAT )
+         {
+            esMipRowF32 ( ( const GLfloat * ) row0, ( const GLfloat * ) ( row0 + srcPitch ),
+                          ( GLfloat * ) ( dst + y * dstPitch ), chain->width[level], channels );
+         }
+         else if ( chain->srgb )
+         {
+            // alpha stays linear
+            esMipRowSrgb ( row0, row0 + srcPitch, dst + y * dstPitch, chain->width[level], channels,
+                           channels == 2 || channels == 4 ? channels - 1 : channels );
+         }
+         else
+         {
+            esMipRowU8 ( row0, row0 + srcPitch, dst + y * dstPitch, chain->width[level], channels );
+         }
+      }
+   }
+
+   free ( row );
+   return GL_TRUE;
+}
+
+///
+// esFormatMipChain()
+//
+//    Sized format of a chain and the swizzle spreading L / LA over RGBA.
+//    Floats are stored as half floats, which unlike 32-bit ones can be
+//    filtered in OpenGL ES 3.0.
+//
+static GLboolean esFormatMipChain ( const ESMipChain *chain, GLenum *internalFormat, GLenum *format,
+                                    GLint swizzle[4] )
+{
+   GLboolean isFloat = chain->type == GL_FLOAT;
+
+   swizzle[0] = GL_RED;
+   swizzle[1] = GL_GREEN;
+   swizzle[2] = GL_BLUE;
+   swizzle[3] = GL_ALPHA;
+
+   switch ( chain->format )
+   {
+      case GL_LUMINANCE:
+         *internalFormat = isFloat ? GL_R16F : GL_R8;
+         *format = GL_RED;
+         swizzle[1] = swizzle[2] = GL_RED;
+         swizzle[3] = GL_ONE;
+         return GL_TRUE;
+
+      case GL_LUMINANCE_ALPHA:
+         *internalFormat = isFloat ? GL_RG16F : GL_RG8;
+         *format = GL_RG;
+         swizzle[1] = swizzle[2] = GL_RED;
+         swizzle[3] = GL_GREEN;
+         return GL_TRUE;
+
+      case GL_RGB:
+         *internalFormat = isFloat ? GL_RGB16F : chain->srgb ? GL_SRGB8 : GL_RGB8;
+         *format = GL_RGB;
+         return GL_TRUE;
+
+      case GL_RGBA:
+         *internalFormat = isFloat ? GL_RGBA16F : chain->srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+         *format = GL_RGBA;
+         return GL_TRUE;
+
+      default:
+         return GL_FALSE;
+   }
+}
+
+///
+// esTexImageMipChain()
+//
+//    glTexImage2D of every level of a chain into the bound texture
+//
+GLboolean ESUTIL_API esTexImageMipChain ( GLenum target, const ESMipChain *chain )
+{
+   GLint  saved[UNPACK_STATE_COUNT];
+   GLenum parameterTarget = target;
+   GLenum internalFormat, format;
+   GLint  swizzle[4];
+   int    level;
+
+   if ( chain->pixels == NULL || !esFormatMipChain ( chain, &internalFormat, &format, swizzle ) )
+   {
+      return GL_FALSE;
+   }
+
+   if ( target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z )
+   {
+      parameterTarget = GL_TEXTURE_CUBE_MAP;
+   }
+
+   esSaveUnpackState ( saved );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+   for ( level = 0; level < chain->levelCount; level++ )
+   {
+      glPixelStorei ( GL_UNPACK_ALIGNMENT, esUnpackAlignment ( chain->width[level] * chain->pixelSize ) );
+      glTexImage2D ( target, level, internalFormat, chain->width[level], chain->height[level], 0, format,
+                     chain->type, chain->pixels + chain->offset[level] );
+   }
+
+   esSwizzle ( parameterTarget, swizzle );
+   esRestoreUnpackState ( saved );
+
+   return GL_TRUE;
+}
+
+///
+// esFreeMipChain()
+//
+//    Release the levels of a chain from esBuildMipChain
+//
+void ESUTIL_API esFreeMipChain ( ESMipChain *chain )
+{
+   if ( chain == NULL )
+   {
+      return;
+   }
+
+   free ( chain->pixels );
+   memset ( chain, 0, sizeof ( ESMipChain ) );
+}
@@ -0,0 +1,299 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esTexturePVR.c
+//
+//    Loader of PowerVR textures (PVR v2 and v3), which uploads every level
+//    straight from the mapped file.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil_private.h"
+
+///
+// PVR
+//
+
+#ifndef GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG
+#define GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG      0x8C00
+#define GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG      0x8C01
+#define GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG     0x8C02
+#define GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG     0x8C03
+#endif
+
+/// Pixel format of a PVR v3 file that is not compressed: 4 channel names, then the bits of each
+#define ES_PVR_CHANNELS( c0, c1, c2, c3, b0, b1, b2, b3 ) \
+   ( ( unsigned long long ) ( ( GLuint ) ( c0 ) | ( GLuint ) ( c1 ) << 8 | ( GLuint ) ( c2 ) << 16 | ( GLuint ) ( c3 ) << 24 ) | \
+     ( unsigned long long ) ( ( GLuint ) ( b0 ) | ( GLuint ) ( b1 ) << 8 | ( GLuint ) ( b2 ) << 16 | ( GLuint ) ( b3 ) << 24 ) << 32 )
+
+typedef struct
+{
+   unsigned long long pixelFormat;
+
+   /// glTexImage2D formats, format GL_NONE for the compressed ones, the internal format of sRGB files
+   GLenum internalFormat;
+   GLenum format;
+   GLenum type;
+   GLenum srgbInternalFormat;
+
+   /// Pixels of a block, bytes of a block and the fewest blocks across a level
+   int    blockWidth;
+   int    blockHeight;
+   int    blockBytes;
+   int    minBlocks;
+} ESPVRFormat;
+
+/// Formats GL ES 3.0 takes, PVRTC only with GL_IMG_texture_compression_pvrtc
+static const ESPVRFormat pvrFormats[] =
+{
+   { 0, GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG, GL_NONE, GL_NONE, GL_NONE, 8, 4, 8, 2 },
+   { 1, GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG, GL_NONE, GL_NONE, GL_NONE, 8, 4, 8, 2 },
+   { 2, GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG, GL_NONE, GL_NONE, GL_NONE, 4, 4, 8, 2 },
+   { 3, GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG, GL_NONE, GL_NONE, GL_NONE, 4, 4, 8, 2 },
+   // ETC1 blocks are ETC2 blocks
+   { 6, GL_COMPRESSED_RGB8_ETC2, GL_NONE, GL_NONE, GL_COMPRESSED_SRGB8_ETC2, 4, 4, 8, 1 },
+   { 22, GL_COMPRESSED_RGB8_ETC2, GL_NONE, GL_NONE, GL_COMPRESSED_SRGB8_ETC2, 4, 4, 8, 1 },
+   { 23, GL_COMPRESSED_RGBA8_ETC2_EAC, GL_NONE, GL_NONE, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 4, 4, 16, 1 },
+   { 24, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, GL_NONE, GL_NONE, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 4, 4, 8, 1 },
+   { 25, GL_COMPRESSED_R11_EAC, GL_NONE, GL_NONE, GL_NONE, 4, 4, 8, 1 },
+   { 26, GL_COMPRESSED_RG11_EAC, GL_NONE, GL_NONE, GL_NONE, 4, 4, 16, 1 },
+   { ES_PVR_CHANNELS ( 'r', 'g', 'b', 'a', 8, 8, 8, 8 ), GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_SRGB8_ALPHA8, 1, 1, 4, 1 },
+   { ES_PVR_CHANNELS ( 'r', 'g', 'b', 0, 8, 8, 8, 0 ), GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, GL_SRGB8, 1, 1, 3, 1 },
+   { ES_PVR_CHANNELS ( 'r', 'g', 0, 0, 8, 8, 0, 0 ), GL_RG8, GL_RG, GL_UNSIGNED_BYTE, GL_NONE, 1, 1, 2, 1 },
+   { ES_PVR_CHANNELS ( 'r', 0, 0, 0, 8, 0, 0, 0 ), GL_R8, GL_RED, GL_UNSIGNED_BYTE, GL_NONE, 1, 1, 1, 1 },
+   { ES_PVR_CHANNELS ( 'l', 'a', 0, 0, 8, 8, 0, 0 ), GL_LUMINANCE_ALPHA, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, GL_NONE, 1, 1, 2, 1 },
+   { ES_PVR_CHANNELS ( 'l', 0, 0, 0, 8, 0, 0, 0 ), GL_LUMINANCE, GL_LUMINANCE, GL_UNSIGNED_BYTE, GL_NONE, 1, 1, 1, 1 },
+   { ES_PVR_CHANNELS ( 'a', 0, 0, 0, 8, 0, 0, 0 ), GL_ALPHA, GL_ALPHA, GL_UNSIGNED_BYTE, GL_NONE, 1, 1, 1, 1 },
+   { ES_PVR_CHANNELS ( 'r', 'g', 'b', 'a', 4, 4, 4, 4 ), GL_RGBA4, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, GL_NONE, 1, 1, 2, 1 },
+   { ES_PVR_CHANNELS ( 'r', 'g', 'b', 'a', 5, 5, 5, 1 ), GL_RGB5_A1, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, GL_NONE, 1, 1, 2, 1 },
+   { ES_PVR_CHANNELS ( 'r', 'g', 'b', 0, 5, 6, 5, 0 ), GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, GL_NONE, 1, 1, 2, 1 },
+};
+
+///
+// esLegacyPVRFormat()
+//
+//    PVR v3 pixel format of the pixel type of a PVR v2 file, -1 for the
+//    ones without a GL ES 3.0 format
+//
+static unsigned long long esLegacyPVRFormat ( GLuint pixelType, GLboolean alpha )
+{
+   switch ( pixelType )
+   {
+      case 0x10:
+         return ES_PVR_CHANNELS ( 'r', 'g', 'b', 'a', 4, 4, 4, 4 );
+
+      case 0x11:
+         return ES_PVR_CHANNELS ( 'r', 'g', 'b', 'a', 5, 5, 5, 1 );
+
+      case 0x12:
+         return ES_PVR_CHANNELS ( 'r', 'g', 'b', 'a', 8, 8, 8, 8 );
+
+      case 0x13:
+         return ES_PVR_CHANNELS ( 'r', 'g', 'b', 0, 5, 6, 5, 0 );
+
+      case 0x15:
+         return ES_PVR_CHANNELS ( 'r', 'g', 'b', 0, 8, 8, 8, 0 );
+
+      case 0x16:
+         return ES_PVR_CHANNELS ( 'l', 0, 0, 0, 8, 0, 0, 0 );
+
+      case 0x17:
+         return ES_PVR_CHANNELS ( 'l', 'a', 0, 0, 8, 8, 0, 0 );
+
+      case 0x18:
+         return alpha ? 1 : 0;
+
+      case 0x19:
+         return alpha ? 3 : 2;
+
+      case 0x1B:
+         return ES_PVR_CHANNELS ( 'a', 0, 0, 0, 8, 0, 0, 0 );
+
+      case 0x36:
+         return 6;
+
+      default:
+         return ( unsigned long long ) - 1;
+   }
+}
+
+///
+// esTexImagePVR()
+//
+//    Map a PVR v3 file, or a v2 one with the older header, and upload
+//    every level and face of it straight from the mapping.  v3 files store
+//    the faces of a level together, v2 files the levels of a face.
+//
+GLboolean ESUTIL_API esTexImagePVR ( void *ioContext, const char *fileName, GLenum target, ESTextureInfo *info )
+{
+   const ESPVRFormat *pvrFormat = NULL;
+   size_t        levelSizes[ES_MAX_MIP_LEVELS];
+   size_t        levelStarts[ES_MAX_MIP_LEVELS + 1];
+   size_t        dataOffset;
+   ESMappedFile  file;
+   ESTextureInfo fileInfo;
+   GLint         saved[UNPACK_STATE_COUNT];
+   GLboolean     legacy;
+   GLboolean     supported = GL_TRUE;
+   GLuint        width, height, faceCount, levelCount, colorSpace = 0;
+   unsigned long long pixelFormat;
+   int           level, face, i;
+
+   memset ( &fileInfo, 0, sizeof ( ESTextureInfo ) );
+
+   if ( !esMapFile ( ioContext, fileName, &file ) || file.size < 52 ||
+         ( esReadU32 ( file.data ) != 0x03525650 && esReadU32 ( file.data + 44 ) != 0x21525650 ) )
+   {
+      esLogMessage ( "esTexImagePVR FAILED to load : { %s }\n", fileName );
+      esUnmapFile ( &file );
+      return GL_FALSE;
+   }
+
+   legacy = esReadU32 ( file.data ) != 0x03525650;
+
+   if ( legacy )
+   {
+      // header size, height, width, mip levels past the first, flags, data size, bits per pixel,
+      // red, green, blue and alpha masks, "PVR!", surfaces
+      GLuint flags = esReadU32 ( file.data + 16 );
+
+      height = esReadU32 ( file.data + 4 );
+      width = esReadU32 ( file.data + 8 );
+      levelCount = esReadU32 ( file.data + 12 ) + 1;
+      faceCount = flags & 0x1000 ? 6 : 1;
+      pixelFormat = esLegacyPVRFormat ( flags & 0xFF, esReadU32 ( file.data + 40 ) != 0 );
+      dataOffset = esReadU32 ( file.data );
+   }
+   else
+   {
+      // version, flags, pixel format, color space, channel type, height, width, depth, surfaces, faces,
+      // mip levels, metadata size
+      pixelFormat = ( unsigned long long ) esReadU32 ( file.data + 12 ) << 32 | esReadU32 ( file.data + 8 );
+      colorSpace = esReadU32 ( file.data + 16 );
+      height = esReadU32 ( file.data + 24 );
+      width = esReadU32 ( file.data + 28 );
+      faceCount = esReadU32 ( file.data + 40 );
+      levelCount = esReadU32 ( file.data + 44 );
+      dataOffset = 52 + ( size_t ) esReadU32 ( file.data + 48 );
+
+      // signed and float channels have no format here, nor do volumes and arrays
+      supported = ( esReadU32 ( file.data + 20 ) & ~6u ) == 0 && esReadU32 ( file.data + 32 ) <= 1 &&
+                  esReadU32 ( file.data + 36 ) <= 1;
+   }
+
+   for ( i = 0; i < ( int ) ( sizeof ( pvrFormats ) / sizeof ( pvrFormats[0] ) ); i++ )
+   {
+      if ( pvrFormats[i].pixelFormat == pixelFormat )
+      {
+         pvrFormat = &pvrFormats[i];
+      }
+   }
+
+   if ( pvrFormat != NULL && pvrFormat->pixelFormat <= 3 )
+   {
+      const char *extensions = ( const char * ) glGetString ( GL_EXTENSIONS );
+
+      supported = supported && extensions != NULL && strstr ( extensions, "GL_IMG_texture_compression_pvrtc" ) != NULL;
+   }
+
+   if ( !supported || pvrFormat == NULL || width == 0 || height == 0 || levelCount == 0 ||
+         levelCount > ES_MAX_MIP_LEVELS || faceCount != ( target == GL_TEXTURE_CUBE_MAP ? 6u : 1u ) )
+   {
+      esLogMessage ( "esTexImagePVR: %s is not a %s in a format this GL ES takes\n", fileName,
+                     target == GL_TEXTURE_CUBE_MAP ? "cube map" : "2D texture" );
+      esUnmapFile ( &file );
+      return GL_FALSE;
+   }
+
+   // the size of each level, in whole blocks
+   levelStarts[0] = 0;
+
+   for ( level = 0; level < ( int ) levelCount; level++ )
+   {
+      GLuint levelWidth = width >> level > 0 ? width >> level : 1;
+      GLuint levelHeight = height >> level > 0 ? height >> level : 1;
+      size_t blocksX = ( levelWidth + pvrFormat->blockWidth - 1 ) / pvrFormat->blockWidth;
+      size_t blocksY = ( levelHeight + pvrFormat->blockHeight - 1 ) / pvrFormat->blockHeight;
+
+      blocksX = blocksX > ( size_t ) pvrFormat->minBlocks ? blocksX : ( size_t ) pvrFormat->minBlocks;
+      blocksY = blocksY > ( size_t ) pvrFormat->minBlocks ? blocksY : ( size_t ) pvrFormat->minBlocks;
+      levelSizes[level] = blocksX * blocksY * pvrFormat->blockBytes;
+      levelStarts[level + 1] = levelStarts[level] + levelSizes[level];
+   }
+
+   if ( dataOffset > file.size || ( file.size - dataOffset ) / faceCount < levelStarts[levelCount] )
+   {
+      esLogMessage ( "esTexImagePVR: %s is truncated\n", fileName );
+      esUnmapFile ( &file );
+      return GL_FALSE;
+   }
+
+   fileInfo.internalFormat = colorSpace == 1 && pvrFormat->srgbInternalFormat != GL_NONE ?
+                             pvrFormat->srgbInternalFormat : pvrFormat->internalFormat;
+
+   esSaveUnpackState ( saved );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   for ( level = 0; level < ( int ) levelCount; level++ )
+   {
+      for ( face = 0; face < ( int ) faceCount; face++ )
+      {
+         size_t offset = legacy ? face * levelStarts[levelCount] + levelStarts[level] :
+                         levelStarts[level] * faceCount + face * levelSizes[level];
+
+         esTexImageLevel ( faceCount == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D, level,
+                           fileInfo.internalFormat, pvrFormat->format, pvrFormat->type, width, height,
+                           file.data + dataOffset + offset, levelSizes[level] );
+         fileInfo.bytes += levelSizes[level];
+      }
+   }
+
+   glTexParameteri ( target, GL_TEXTURE_MAX_LEVEL, levelCount - 1 );
+   esRestoreUnpackState ( saved );
+   esUnmapFile ( &file );
+
+   fileInfo.target = target;
+   fileInfo.width = width;
+   fileInfo.height = height;
+   fileInfo.levelCount = levelCount;
+
+   if ( info != NULL )
+   {
+      *info = fileInfo;
+   }
+
+   return GL_TRUE;
+}
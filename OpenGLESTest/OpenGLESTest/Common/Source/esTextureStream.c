@@ -0,0 +1,613 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esTextureStream.c
+//
+//    Streaming of TGA textures, read on a background thread into a ring
+//    of pixel unpack buffers and uploaded within a budget per frame.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil_private.h"
+
+///
+// Texture stream
+//
+enum
+{
+   SLOT_FREE,       // ready to be mapped for the next band of rows
+   SLOT_MAPPED,     // waiting for the thread to copy the rows in
+   SLOT_FILLED,     // waiting for esUpdateTextureStream to upload it
+   SLOT_UPLOADED    // waiting for the GPU to be done with it
+};
+
+enum
+{
+   STREAM_QUEUED,   // waiting for the thread to open the file
+   STREAM_OPEN,     // rows being copied and uploaded
+   STREAM_READY,
+   STREAM_FAILED
+};
+
+typedef struct
+{
+   /// Pixel unpack buffer and its size in bytes
+   GLuint          buffer;
+   GLsizeiptr      size;
+
+   /// Pointer from glMapBufferRange while the slot is mapped
+   unsigned char  *mapped;
+
+   /// Fence after the glTexSubImage2D reading the buffer
+   GLsync          fence;
+
+   int             state;
+
+   /// Band of rows of an image, counted from the bottom
+   int             image;
+   int             firstRow;
+   int             rowCount;
+} ESStreamSlot;
+
+typedef struct
+{
+   char           *fileName;
+   GLuint          texture;
+   int             state;
+
+   /// Opened by the thread, freed by it once the last band is copied
+   ESImage         image;
+
+   /// Size and format of image, kept once it is freed
+   int             width;
+   int             height;
+   int             bytesPerPixel;
+
+   /// Rows handed out to slots and rows uploaded
+   int             scheduledRows;
+   int             uploadedRows;
+
+   /// Set with STREAM_READY, but only touched by the render thread, so it
+   /// can be read without the lock the thread writes state under
+   GLboolean       ready;
+} ESStreamImage;
+
+struct ESTextureStream
+{
+   void           *ioContext;
+   GLsizeiptr      frameBudget;
+   GLuint          placeholder;
+
+   /// Ring of buffers, each slot goes through the states in ring order
+   ESStreamSlot   *slots;
+   int             slotCount;
+   int             mapSlot;
+   int             fillSlot;
+   int             uploadSlot;
+   int             retireSlot;
+
+   /// Images in the order they are opened and uploaded
+   ESStreamImage  *images;
+   int             imageCount;
+   int             imageCapacity;
+   int             nextOpen;
+   int             nextSchedule;
+
+   int             quit;
+
+#ifdef _WIN32
+   HANDLE             thread;
+   CRITICAL_SECTION   lock;
+   CONDITION_VARIABLE wake;
+#else
+   pthread_t          thread;
+   pthread_mutex_t    lock;
+   pthread_cond_t     wake;
+#endif
+};
+
+///
+// esStreamCopyRows()
+//
+//    Copy a band of rows of image into a mapped buffer, bottom row first
+//
+static void esStreamCopyRows ( const ESImage *image, int firstRow, int rowCount, unsigned char *dst )
+{
+   size_t pitch = ( size_t ) image->width * image->bytesPerPixel;
+   int    i;
+
+   if ( !image->topDown )
+   {
+      memcpy ( dst, image->pixels + firstRow * pitch, rowCount * pitch );
+      return;
+   }
+
+   for ( i = 0; i < rowCount; i++ )
+   {
+      memcpy ( dst + i * pitch, image->pixels + ( image->height - 1 - firstRow - i ) * pitch, pitch );
+   }
+}
+
+///
+// esStreamWorker()
+//
+//    Fill the mapped slots in ring order, open the queued files when no
+//    slot is waiting.  No GL call is made on this thread.
+//
+#ifdef _WIN32
+static DWORD WINAPI esStreamWorker ( LPVOID param )
+#else
+static void *esStreamWorker ( void *param )
+#endif
+{
+   ESTextureStream *stream = ( ESTextureStream * ) param;
+
+   esPoolLock ( stream );
+
+   for ( ;; )
+   {
+      ESStreamSlot *slot = &stream->slots[stream->fillSlot];
+      ESImage       image;
+
+      while ( !stream->quit && slot->state != SLOT_MAPPED && stream->nextOpen == stream->imageCount )
+      {
+         esPoolWait ( stream, wake );
+      }
+
+      if ( stream->quit )
+      {
+         break;
+      }
+
+      if ( slot->state == SLOT_MAPPED )
+      {
+         // the image array may grow meanwhile, work on a copy of the image
+         ESStreamImage *streamImage = &stream->images[slot->image];
+         int            last = slot->firstRow + slot->rowCount == streamImage->height;
+
+         image = streamImage->image;
+
+         if ( last )
+         {
+            memset ( &streamImage->image, 0, sizeof ( ESImage ) );
+         }
+
+         esPoolUnlock ( stream );
+         esStreamCopyRows ( &image, slot->firstRow, slot->rowCount, slot->mapped );
+
+         if ( last )
+         {
+            esFreeTGA ( &image );
+         }
+
+         esPoolLock ( stream );
+         slot->state = SLOT_FILLED;
+         stream->fillSlot = ( stream->fillSlot + 1 ) % stream->slotCount;
+      }
+      else
+      {
+         int         index = stream->nextOpen++;
+         const char *fileName = stream->images[index].fileName;
+         GLboolean   opened;
+
+         esPoolUnlock ( stream );
+         opened = esMapTGA ( stream->ioContext, fileName, &image );
+         esPoolLock ( stream );
+
+         stream->images[index].image = image;
+         stream->images[index].width = image.width;
+         stream->images[index].height = image.height;
+         stream->images[index].bytesPerPixel = image.bytesPerPixel;
+         stream->images[index].state = opened ? STREAM_OPEN : STREAM_FAILED;
+      }
+   }
+
+   esPoolUnlock ( stream );
+   return 0;
+}
+
+///
+// esCreateTextureStream()
+//
+//    Create the placeholder texture and the ring of buffers and start the thread
+//
+ESTextureStream *ESUTIL_API esCreateTextureStream ( void *ioContext, int slotCount, GLsizeiptr frameBudget )
+{
+   // 2x2 checkerboard with alpha 0: flat as a heightmap, invisible as a sprite
+   static const GLubyte placeholderPixels[] =
+   {
+      0x60, 0x60, 0x60, 0x00,   0xa0, 0xa0, 0xa0, 0x00,
+      0xa0, 0xa0, 0xa0, 0x00,   0x60, 0x60, 0x60, 0x00
+   };
+   ESTextureStream *stream;
+   GLint            saved[UNPACK_STATE_COUNT];
+   int              i;
+
+   if ( slotCount < 1 || frameBudget < 1 )
+   {
+      return NULL;
+   }
+
+   stream = ( ESTextureStream * ) calloc ( 1, sizeof ( ESTextureStream ) );
+
+   if ( stream == NULL )
+   {
+      return NULL;
+   }
+
+   stream->slots = ( ESStreamSlot * ) calloc ( slotCount, sizeof ( ESStreamSlot ) );
+
+   if ( stream->slots == NULL )
+   {
+      free ( stream );
+      return NULL;
+   }
+
+   stream->ioContext = ioContext;
+   stream->frameBudget = frameBudget;
+   stream->slotCount = slotCount;
+
+   esSaveUnpackState ( saved );
+
+   for ( i = 0; i < slotCount; i++ )
+   {
+      glGenBuffers ( 1, &stream->slots[i].buffer );
+   }
+
+   glGenTextures ( 1, &stream->placeholder );
+   glBindTexture ( GL_TEXTURE_2D, stream->placeholder );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 4 );
+   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixels );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+   esRestoreUnpackState ( saved );
+
+#ifdef _WIN32
+   InitializeCriticalSection ( &stream->lock );
+   InitializeConditionVariable ( &stream->wake );
+   stream->thread = CreateThread ( NULL, 0, esStreamWorker, stream, 0, NULL );
+
+   if ( stream->thread == NULL )
+#else
+   pthread_mutex_init ( &stream->lock, NULL );
+   pthread_cond_init ( &stream->wake, NULL );
+
+   if ( pthread_create ( &stream->thread, NULL, esStreamWorker, stream ) != 0 )
+#endif
+   {
+      // nothing to join, the rest is released like a running stream
+      stream->quit = 1;
+      esDestroyTextureStream ( stream );
+      return NULL;
+   }
+
+   return stream;
+}
+
+///
+// esStreamTexture()
+//
+//    Queue a TGA file, its texture is filtered GL_LINEAR and clamped to edge
+//
+int ESUTIL_API esStreamTexture ( ESTextureStream *stream, const char *fileName )
+{
+   ESStreamImage *image;
+   GLint          texture;
+   size_t         length = strlen ( fileName ) + 1;
+   char          *name = ( char * ) malloc ( length );
+
+   if ( name == NULL )
+   {
+      return -1;
+   }
+
+   memcpy ( name, fileName, length );
+
+   esPoolLock ( stream );
+
+   if ( stream->imageCount == stream->imageCapacity )
+   {
+      int            capacity = stream->imageCapacity > 0 ? stream->imageCapacity * 2 : 8;
+      ESStreamImage *images = ( ESStreamImage * ) realloc ( stream->images, capacity * sizeof ( ESStreamImage ) );
+
+      if ( images == NULL )
+      {
+         esPoolUnlock ( stream );
+         free ( name );
+         return -1;
+      }
+
+      stream->images = images;
+      stream->imageCapacity = capacity;
+   }
+
+   image = &stream->images[stream->imageCount];
+   memset ( image, 0, sizeof ( ESStreamImage ) );
+   image->fileName = name;
+   image->state = STREAM_QUEUED;
+
+   glGetIntegerv ( GL_TEXTURE_BINDING_2D, &texture );
+   glGenTextures ( 1, &image->texture );
+   glBindTexture ( GL_TEXTURE_2D, image->texture );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glBindTexture ( GL_TEXTURE_2D, texture );
+
+   stream->imageCount++;
+   esPoolWakeAll ( stream, wake );
+   esPoolUnlock ( stream );
+
+   return stream->imageCount - 1;
+}
+
+///
+// esGetStreamTexture()
+//
+//    The texture of an image once all of it is uploaded, the placeholder until then
+//
+GLuint ESUTIL_API esGetStreamTexture ( const ESTextureStream *stream, int texture )
+{
+   if ( texture < 0 || texture >= stream->imageCount || !stream->images[texture].ready )
+   {
+      return stream->placeholder;
+   }
+
+   return stream->images[texture].texture;
+}
+
+///
+// esUpdateTextureStream()
+//
+//    Free the slots the GPU is done with, upload the filled ones within the
+//    frame budget and map the free ones for the next bands of rows
+//
+int ESUTIL_API esUpdateTextureStream ( ESTextureStream *stream )
+{
+   GLint      saved[UNPACK_STATE_COUNT];
+   GLsizeiptr uploaded = 0;
+   int        pending = 0;
+   int        i;
+
+   esSaveUnpackState ( saved );
+   esPoolLock ( stream );
+
+   for ( ;; )
+   {
+      ESStreamSlot *slot = &stream->slots[stream->retireSlot];
+
+      if ( slot->state != SLOT_UPLOADED || glClientWaitSync ( slot->fence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+      {
+         break;
+      }
+
+      glDeleteSync ( slot->fence );
+      slot->fence = NULL;
+      slot->state = SLOT_FREE;
+      stream->retireSlot = ( stream->retireSlot + 1 ) % stream->slotCount;
+   }
+
+   for ( ;; )
+   {
+      ESStreamSlot  *slot = &stream->slots[stream->uploadSlot];
+      ESStreamImage *image;
+      GLenum         internalFormat, format, type;
+      GLint          swizzle[4];
+      int            pitch;
+
+      if ( slot->state != SLOT_FILLED )
+      {
+         break;
+      }
+
+      // at least one band per frame, however small the budget
+      image = &stream->images[slot->image];
+      pitch = image->width * image->bytesPerPixel;
+
+      if ( uploaded > 0 && uploaded + ( GLsizeiptr ) pitch * slot->rowCount > stream->frameBudget )
+      {
+         break;
+      }
+
+      esFormatTGA ( image->bytesPerPixel, &internalFormat, &format, &type, swizzle );
+
+      glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, slot->buffer );
+      glUnmapBuffer ( GL_PIXEL_UNPACK_BUFFER );
+      slot->mapped = NULL;
+
+      glBindTexture ( GL_TEXTURE_2D, image->texture );
+      glPixelStorei ( GL_UNPACK_ALIGNMENT, esUnpackAlignment ( pitch ) );
+      glTexSubImage2D ( GL_TEXTURE_2D, 0, 0, slot->firstRow, image->width, slot->rowCount,
+                        format, type, ( const void * ) 0 );
+
+      slot->fence = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      slot->state = SLOT_UPLOADED;
+      stream->uploadSlot = ( stream->uploadSlot + 1 ) % stream->slotCount;
+      uploaded += ( GLsizeiptr ) pitch * slot->rowCount;
+
+      image->uploadedRows += slot->rowCount;
+
+      if ( image->uploadedRows == image->height )
+      {
+         image->state = STREAM_READY;
+         image->ready = GL_TRUE;
+      }
+   }
+
+   while ( stream->slots[stream->mapSlot].state == SLOT_FREE && stream->nextSchedule < stream->imageCount )
+   {
+      ESStreamSlot  *slot = &stream->slots[stream->mapSlot];
+      ESStreamImage *image = &stream->images[stream->nextSchedule];
+      GLenum         internalFormat, format, type;
+      GLint          swizzle[4];
+      GLsizeiptr     pitch, size;
+      int            rows;
+
+      if ( image->state == STREAM_QUEUED )
+      {
+         break;
+      }
+
+      if ( image->state == STREAM_FAILED || image->scheduledRows == image->height )
+      {
+         stream->nextSchedule++;
+         continue;
+      }
+
+      pitch = ( GLsizeiptr ) image->width * image->bytesPerPixel;
+      esFormatTGA ( image->bytesPerPixel, &internalFormat, &format, &type, swizzle );
+
+      if ( image->scheduledRows == 0 )
+      {
+         glBindTexture ( GL_TEXTURE_2D, image->texture );
+         glTexStorage2D ( GL_TEXTURE_2D, 1, internalFormat, image->width, image->height );
+         esSwizzle ( GL_TEXTURE_2D, swizzle );
+      }
+
+      // a band of as many rows as the frame budget holds
+      rows = ( int ) ( stream->frameBudget / pitch );
+      rows = rows < 1 ? 1 : rows;
+      rows = rows < image->height - image->scheduledRows ? rows : image->height - image->scheduledRows;
+      size = pitch * rows;
+
+      glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, slot->buffer );
+
+      if ( slot->size < size )
+      {
+         glBufferData ( GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW );
+         slot->size = size;
+      }
+
+      // the fence has signaled, nothing reads the buffer anymore
+      slot->mapped = ( unsigned char * ) glMapBufferRange ( GL_PIXEL_UNPACK_BUFFER, 0, size,
+                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+
+      if ( slot->mapped == NULL )
+      {
+         break;
+      }
+
+      slot->image = stream->nextSchedule;
+      slot->firstRow = image->scheduledRows;
+      slot->rowCount = rows;
+      slot->state = SLOT_MAPPED;
+      stream->mapSlot = ( stream->mapSlot + 1 ) % stream->slotCount;
+      image->scheduledRows += rows;
+      esPoolWakeAll ( stream, wake );
+   }
+
+   for ( i = 0; i < stream->imageCount; i++ )
+   {
+      pending += stream->images[i].state == STREAM_QUEUED || stream->images[i].state == STREAM_OPEN;
+   }
+
+   esPoolUnlock ( stream );
+   esRestoreUnpackState ( saved );
+
+   return pending;
+}
+
+///
+// esDestroyTextureStream()
+//
+//    Stop the thread and delete the buffers and every texture of the stream
+//
+void ESUTIL_API esDestroyTextureStream ( ESTextureStream *stream )
+{
+   int i;
+
+   if ( stream == NULL )
+   {
+      return;
+   }
+
+   if ( !stream->quit )
+   {
+      esPoolLock ( stream );
+      stream->quit = 1;
+      esPoolWakeAll ( stream, wake );
+      esPoolUnlock ( stream );
+
+#ifdef _WIN32
+      WaitForSingleObject ( stream->thread, INFINITE );
+      CloseHandle ( stream->thread );
+#else
+      pthread_join ( stream->thread, NULL );
+#endif
+   }
+
+   for ( i = 0; i < stream->slotCount; i++ )
+   {
+      ESStreamSlot *slot = &stream->slots[i];
+
+      if ( slot->mapped != NULL )
+      {
+         glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, slot->buffer );
+         glUnmapBuffer ( GL_PIXEL_UNPACK_BUFFER );
+      }
+
+      if ( slot->fence != NULL )
+      {
+         glDeleteSync ( slot->fence );
+      }
+
+      glDeleteBuffers ( 1, &slot->buffer );
+   }
+
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+   for ( i = 0; i < stream->imageCount; i++ )
+   {
+      esFreeTGA ( &stream->images[i].image );
+      free ( stream->images[i].fileName );
+      glDeleteTextures ( 1, &stream->images[i].texture );
+   }
+
+   glDeleteTextures ( 1, &stream->placeholder );
+
+#ifdef _WIN32
+   DeleteCriticalSection ( &stream->lock );
+#else
+   pthread_cond_destroy ( &stream->wake );
+   pthread_mutex_destroy ( &stream->lock );
+#endif
+
+   free ( stream->images );
+   free ( stream->slots );
+   free ( stream );
+}
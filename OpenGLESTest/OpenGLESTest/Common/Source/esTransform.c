@@ -42,35 +42,57 @@
 #include "esUtil.h"
 #include <math.h>
 #include <string.h>
+#include "esVec4.h"
 
 #define PI 3.1415926535897932384626433832795f
 
-void ESUTIL_API
-esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz )
+// A row of a matrix at a time.  Rows are summed in the order of the scalar
+// loop, without fused multiply-adds, so every path gives the same bits.
+
+// a[0] * b[0] + a[1] * b[1] + a[2] * b[2], the first three terms of a row of a product
+#if defined(ES_SSE2) || defined(ES_NEON)
+static ESVec4 esMatrixRow3 ( const GLfloat a[3], const ESVec4 b[3] )
+{
+   return esVecAdd ( esVecAdd ( esVecMul ( esVecSet ( a[0] ), b[0] ), esVecMul ( esVecSet ( a[1] ), b[1] ) ),
+                     esVecMul ( esVecSet ( a[2] ), b[2] ) );
+}
+#else
+static ESVec4 esMatrixRow3 ( const GLfloat a[3], const ESVec4 b[3] )
 {
-   result->m[0][0] *= sx;
-   result->m[0][1] *= sx;
-   result->m[0][2] *= sx;
-   result->m[0][3] *= sx;
+   ESVec4 r;
+   int    j;
 
-   result->m[1][0] *= sy;
-   result->m[1][1] *= sy;
-   result->m[1][2] *= sy;
-   result->m[1][3] *= sy;
+   for ( j = 0; j < 4; j++ )
+   {
+      r.v[j] = a[0] * b[0].v[j] + a[1] * b[1].v[j] + a[2] * b[2].v[j];
+   }
 
-   result->m[2][0] *= sz;
-   result->m[2][1] *= sz;
-   result->m[2][2] *= sz;
-   result->m[2][3] *= sz;
+   return r;
+}
+#endif
+
+void ESUTIL_API
+esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz )
+{
+   esVecStore ( result->m[0], esVecMul ( esVecLoad ( result->m[0] ), esVecSet ( sx ) ) );
+   esVecStore ( result->m[1], esVecMul ( esVecLoad ( result->m[1] ), esVecSet ( sy ) ) );
+   esVecStore ( result->m[2], esVecMul ( esVecLoad ( result->m[2] ), esVecSet ( sz ) ) );
 }
 
 void ESUTIL_API
 esTranslate ( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat tz )
 {
-   result->m[3][0] += ( result->m[0][0] * tx + result->m[1][0] * ty + result->m[2][0] * tz );
-   result->m[3][1] += ( result->m[0][1] * tx + result->m[1][1] * ty + result->m[2][1] * tz );
-   result->m[3][2] += ( result->m[0][2] * tx + result->m[1][2] * ty + result->m[2][2] * tz );
-   result->m[3][3] += ( result->m[0][3] * tx + result->m[1][3] * ty + result->m[2][3] * tz );
+   GLfloat t[3];
+   ESVec4  rows[3];
+
+   t[0] = tx;
+   t[1] = ty;
+   t[2] = tz;
+   rows[0] = esVecLoad ( result->m[0] );
+   rows[1] = esVecLoad ( result->m[1] );
+   rows[2] = esVecLoad ( result->m[2] );
+
+   esVecStore ( result->m[3], esVecAdd ( esVecLoad ( result->m[3] ), esMatrixRow3 ( t, rows ) ) );
 }
 
 void ESUTIL_API
@@ -86,7 +108,9 @@ esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
    {
       GLfloat xx, yy, zz, xy, yz, zx, xs, ys, zs;
       GLfloat oneMinusCos;
-      ESMatrix rotMat;
+      GLfloat rotMat[3][3];
+      ESVec4  rows[3];
+      int     i;
 
       x /= mag;
       y /= mag;
@@ -103,27 +127,28 @@ esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
       zs = z * sinAngle;
       oneMinusCos = 1.0f - cosAngle;
 
-      rotMat.m[0][0] = ( oneMinusCos * xx ) + cosAngle;
-      rotMat.m[0][1] = ( oneMinusCos * xy ) - zs;
-      rotMat.m[0][2] = ( oneMinusCos * zx ) + ys;
-      rotMat.m[0][3] = 0.0F;
+      rotMat[0][0] = ( oneMinusCos * xx ) + cosAngle;
+      rotMat[0][1] = ( oneMinusCos * xy ) - zs;
+      rotMat[0][2] = ( oneMinusCos * zx ) + ys;
 
-      rotMat.m[1][0] = ( oneMinusCos * xy ) + zs;
-      rotMat.m[1][1] = ( oneMinusCos * yy ) + cosAngle;
-      rotMat.m[1][2] = ( oneMinusCos * yz ) - xs;
-      rotMat.m[1][3] = 0.0F;
+      rotMat[1][0] = ( oneMinusCos * xy ) + zs;
+      rotMat[1][1] = ( oneMinusCos * yy ) + cosAngle;
+      rotMat[1][2] = ( oneMinusCos * yz ) - xs;
 
-      rotMat.m[2][0] = ( oneMinusCos * zx ) - ys;
-      rotMat.m[2][1] = ( oneMinusCos * yz ) + xs;
-      rotMat.m[2][2] = ( oneMinusCos * zz ) + cosAngle;
-      rotMat.m[2][3] = 0.0F;
+      rotMat[2][0] = ( oneMinusCos * zx ) - ys;
+      rotMat[2][1] = ( oneMinusCos * yz ) + xs;
+      rotMat[2][2] = ( oneMinusCos * zz ) + cosAngle;
 
-      rotMat.m[3][0] = 0.0F;
-      rotMat.m[3][1] = 0.0F;
-      rotMat.m[3][2] = 0.0F;
-      rotMat.m[3][3] = 1.0F;
+      // the rotation is the upper 3x3 of an affine matrix, the last row of result stays
+      for ( i = 0; i < 3; i++ )
+      {
+         rows[i] = esVecLoad ( result->m[i] );
+      }
 
-      esMatrixMultiply ( result, &rotMat, result );
+      for ( i = 0; i < 3; i++ )
+      {
+         esVecStore ( result->m[i], esMatrixRow3 ( rotMat[i], rows ) );
+      }
    }
 }
 
@@ -198,33 +223,41 @@ esOrtho ( ESMatrix *result, float left, float right, float bottom, float top, fl
 void ESUTIL_API
 esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
 {
-   ESMatrix    tmp;
+   ESVec4      rows[4];
    int         i;
 
+   // row i of result only depends on row i of srcA, srcB is read up front
+   for ( i = 0; i < 4; i++ )
+   {
+      rows[i] = esVecLoad ( srcB->m[i] );
+   }
+
    for ( i = 0; i < 4; i++ )
    {
-      tmp.m[i][0] =  ( srcA->m[i][0] * srcB->m[0][0] ) +
-                     ( srcA->m[i][1] * srcB->m[1][0] ) +
-                     ( srcA->m[i][2] * srcB->m[2][0] ) +
-                     ( srcA->m[i][3] * srcB->m[3][0] ) ;
+      esVecStore ( result->m[i], esVecAdd ( esMatrixRow3 ( srcA->m[i], rows ),
+                                            esVecMul ( esVecSet ( srcA->m[i][3] ), rows[3] ) ) );
+   }
+}
 
-      tmp.m[i][1] =  ( srcA->m[i][0] * srcB->m[0][1] ) +
-                     ( srcA->m[i][1] * srcB->m[1][1] ) +
-                     ( srcA->m[i][2] * srcB->m[2][1] ) +
-                     ( srcA->m[i][3] * srcB->m[3][1] ) ;
 
-      tmp.m[i][2] =  ( srcA->m[i][0] * srcB->m[0][2] ) +
-                     ( srcA->m[i][1] * srcB->m[1][2] ) +
-                     ( srcA->m[i][2] * srcB->m[2][2] ) +
-                     ( srcA->m[i][3] * srcB->m[3][2] ) ;
+void ESUTIL_API
+esMatrixMultiplyAffine ( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB )
+{
+   ESVec4      rows[4];
+   int         i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      rows[i] = esVecLoad ( srcB->m[i] );
+   }
 
-      tmp.m[i][3] =  ( srcA->m[i][0] * srcB->m[0][3] ) +
-                     ( srcA->m[i][1] * srcB->m[1][3] ) +
-                     ( srcA->m[i][2] * srcB->m[2][3] ) +
-                     ( srcA->m[i][3] * srcB->m[3][3] ) ;
+   // the last column of srcA is 0, 0, 0, 1
+   for ( i = 0; i < 3; i++ )
+   {
+      esVecStore ( result->m[i], esMatrixRow3 ( srcA->m[i], rows ) );
    }
 
-   memcpy ( result, &tmp, sizeof ( ESMatrix ) );
+   esVecStore ( result->m[3], esVecAdd ( esMatrixRow3 ( srcA->m[3], rows ), rows[3] ) );
 }
 
 
@@ -292,19 +325,20 @@ esMatrixLookAt ( ESMatrix *result,
       axisY[2] /= length;
    }
 
-   memset ( result, 0x0, sizeof ( ESMatrix ) );
-
    result->m[0][0] = -axisX[0];
    result->m[0][1] =  axisY[0];
    result->m[0][2] = -axisZ[0];
+   result->m[0][3] = 0.0f;
 
    result->m[1][0] = -axisX[1];
    result->m[1][1] =  axisY[1];
    result->m[1][2] = -axisZ[1];
+   result->m[1][3] = 0.0f;
 
    result->m[2][0] = -axisX[2];
    result->m[2][1] =  axisY[2];
    result->m[2][2] = -axisZ[2];
+   result->m[2][3] = 0.0f;
 
    // translate (-posX, -posY, -posZ)
    result->m[3][0] =  axisX[0] * posX + axisX[1] * posY + axisX[2] * posZ;
@@ -312,3 +346,789 @@ esMatrixLookAt ( ESMatrix *result,
    result->m[3][2] =  axisZ[0] * posX + axisZ[1] * posY + axisZ[2] * posZ;
    result->m[3][3] = 1.0f;
 }
+
+
+// a * b as quaternions.  The rotation matrices of esQuaternionToMatrix multiply in the same order,
+// so the product is the rotation of a followed by the one of b.
+static ESQuaternion esQuaternionProduct ( const ESQuaternion *a, const ESQuaternion *b )
+{
+   ESQuaternion r;
+
+   r.x = a->w * b->x + a->x * b->w + a->y * b->z - a->z * b->y;
+   r.y = a->w * b->y + a->y * b->w + a->z * b->x - a->x * b->z;
+   r.z = a->w * b->z + a->z * b->w + a->x * b->y - a->y * b->x;
+   r.w = a->w * b->w - a->x * b->x - a->y * b->y - a->z * b->z;
+   return r;
+}
+
+// The rotation of esRotate from a quaternion of any length, 2 / |q|^2 in place of normalizing q
+static void esQuaternionRotation ( const ESQuaternion *q, GLfloat rotMat[3][3] )
+{
+   GLfloat k = 2.0f / ( q->x * q->x + q->y * q->y + q->z * q->z + q->w * q->w );
+   GLfloat x2 = q->x * k, y2 = q->y * k, z2 = q->z * k;
+   GLfloat xx = q->x * x2, yy = q->y * y2, zz = q->z * z2;
+   GLfloat xy = q->x * y2, xz = q->x * z2, yz = q->y * z2;
+   GLfloat wx = q->w * x2, wy = q->w * y2, wz = q->w * z2;
+
+   rotMat[0][0] = 1.0f - ( yy + zz );
+   rotMat[0][1] = xy - wz;
+   rotMat[0][2] = xz + wy;
+
+   rotMat[1][0] = xy + wz;
+   rotMat[1][1] = 1.0f - ( xx + zz );
+   rotMat[1][2] = yz - wx;
+
+   rotMat[2][0] = xz - wy;
+   rotMat[2][1] = yz + wx;
+   rotMat[2][2] = 1.0f - ( xx + yy );
+}
+
+// Rows 0 to 2 of result from a rotation, the last column 0
+static void esLoadRotation ( ESMatrix *result, const GLfloat rotMat[3][3] )
+{
+   int i;
+
+   for ( i = 0; i < 3; i++ )
+   {
+      result->m[i][0] = rotMat[i][0];
+      result->m[i][1] = rotMat[i][1];
+      result->m[i][2] = rotMat[i][2];
+      result->m[i][3] = 0.0f;
+   }
+}
+
+void ESUTIL_API
+esQuaternionFromAxisAngle ( ESQuaternion *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
+{
+   GLfloat mag = sqrtf ( x * x + y * y + z * z );
+
+   if ( mag > 0.0f )
+   {
+      GLfloat s = sinf ( angle * PI / 360.0f ) / mag;
+
+      result->x = x * s;
+      result->y = y * s;
+      result->z = z * s;
+      result->w = cosf ( angle * PI / 360.0f );
+   }
+   else
+   {
+      result->x = result->y = result->z = 0.0f;
+      result->w = 1.0f;
+   }
+}
+
+void ESUTIL_API
+esQuaternionMultiply ( ESQuaternion *result, const ESQuaternion *srcA, const ESQuaternion *srcB )
+{
+   *result = esQuaternionProduct ( srcA, srcB );
+}
+
+void ESUTIL_API
+esQuaternionNormalize ( ESQuaternion *result )
+{
+   GLfloat length = sqrtf ( result->x * result->x + result->y * result->y +
+                            result->z * result->z + result->w * result->w );
+
+   if ( length > 0.0f )
+   {
+      result->x /= length;
+      result->y /= length;
+      result->z /= length;
+      result->w /= length;
+   }
+}
+
+void ESUTIL_API
+esQuaternionSlerp ( ESQuaternion *result, const ESQuaternion *srcA, const ESQuaternion *srcB, GLfloat t )
+{
+   ESQuaternion b = *srcB;
+   GLfloat      cosTheta = srcA->x * b.x + srcA->y * b.y + srcA->z * b.z + srcA->w * b.w;
+   GLfloat      scaleA, scaleB;
+
+   // q and -q are the same rotation, take the one closer to srcA
+   if ( cosTheta < 0.0f )
+   {
+      cosTheta = -cosTheta;
+      b.x = -b.x;
+      b.y = -b.y;
+      b.z = -b.z;
+      b.w = -b.w;
+   }
+
+   if ( cosTheta > 0.9995f )
+   {
+      // nearly the same rotation, sin ( theta ) is too small to divide by
+      scaleA = 1.0f - t;
+      scaleB = t;
+   }
+   else
+   {
+      GLfloat theta = acosf ( cosTheta );
+      GLfloat sinTheta = sqrtf ( 1.0f - cosTheta * cosTheta );
+
+      scaleA = sinf ( ( 1.0f - t ) * theta ) / sinTheta;
+      scaleB = sinf ( t * theta ) / sinTheta;
+   }
+
+   result->x = scaleA * srcA->x + scaleB * b.x;
+   result->y = scaleA * srcA->y + scaleB * b.y;
+   result->z = scaleA * srcA->z + scaleB * b.z;
+   result->w = scaleA * srcA->w + scaleB * b.w;
+   esQuaternionNormalize ( result );
+}
+
+void ESUTIL_API
+esQuaternionRotateVector ( GLfloat result[3], const ESQuaternion *q, const GLfloat vec[3] )
+{
+   // vec times the matrix of q is the conjugate of q applied to vec:
+   // vec + k * ( w * ( u x vec ) + u x ( u x vec ) ) with u = -( x, y, z ) and k = 2 / |q|^2
+   GLfloat k = 2.0f / ( q->x * q->x + q->y * q->y + q->z * q->z + q->w * q->w );
+   GLfloat ux = -q->x, uy = -q->y, uz = -q->z;
+   GLfloat cx = uy * vec[2] - uz * vec[1];
+   GLfloat cy = uz * vec[0] - ux * vec[2];
+   GLfloat cz = ux * vec[1] - uy * vec[0];
+   GLfloat dx = q->w * cx + uy * cz - uz * cy;
+   GLfloat dy = q->w * cy + uz * cx - ux * cz;
+   GLfloat dz = q->w * cz + ux * cy - uy * cx;
+
+   result[0] = vec[0] + k * dx;
+   result[1] = vec[1] + k * dy;
+   result[2] = vec[2] + k * dz;
+}
+
+void ESUTIL_API
+esQuaternionToMatrix ( ESMatrix *result, const ESQuaternion *q )
+{
+   GLfloat rotMat[3][3];
+
+   esQuaternionRotation ( q, rotMat );
+   esLoadRotation ( result, rotMat );
+   result->m[3][0] = result->m[3][1] = result->m[3][2] = 0.0f;
+   result->m[3][3] = 1.0f;
+}
+
+void ESUTIL_API
+esRotateQuaternion ( ESMatrix *result, const ESQuaternion *q )
+{
+   GLfloat rotMat[3][3];
+   ESVec4  rows[3];
+   int     i;
+
+   esQuaternionRotation ( q, rotMat );
+
+   for ( i = 0; i < 3; i++ )
+   {
+      rows[i] = esVecLoad ( result->m[i] );
+   }
+
+   for ( i = 0; i < 3; i++ )
+   {
+      esVecStore ( result->m[i], esMatrixRow3 ( rotMat[i], rows ) );
+   }
+}
+
+// The translation of a dual quaternion, -2 * conjugate ( real ) * dual / |real|^2
+static void esDualQuaternionTranslation ( const ESDualQuaternion *dq, GLfloat t[3] )
+{
+   const ESQuaternion *r = &dq->real;
+   const ESQuaternion *d = &dq->dual;
+   GLfloat             k = -2.0f / ( r->x * r->x + r->y * r->y + r->z * r->z + r->w * r->w );
+
+   t[0] = k * ( r->w * d->x - r->x * d->w - r->y * d->z + r->z * d->y );
+   t[1] = k * ( r->w * d->y - r->y * d->w - r->z * d->x + r->x * d->z );
+   t[2] = k * ( r->w * d->z - r->z * d->w - r->x * d->y + r->y * d->x );
+}
+
+void ESUTIL_API
+esDualQuaternionFromRotationTranslation ( ESDualQuaternion *result, const ESQuaternion *rotation,
+                                          GLfloat tx, GLfloat ty, GLfloat tz )
+{
+   ESQuaternion t;
+
+   t.x = -0.5f * tx;
+   t.y = -0.5f * ty;
+   t.z = -0.5f * tz;
+   t.w = 0.0f;
+
+   result->real = *rotation;
+   result->dual = esQuaternionProduct ( rotation, &t );
+}
+
+void ESUTIL_API
+esDualQuaternionMultiply ( ESDualQuaternion *result, const ESDualQuaternion *srcA, const ESDualQuaternion *srcB )
+{
+   ESQuaternion real = esQuaternionProduct ( &srcA->real, &srcB->real );
+   ESQuaternion ab = esQuaternionProduct ( &srcA->real, &srcB->dual );
+   ESQuaternion ba = esQuaternionProduct ( &srcA->dual, &srcB->real );
+
+   result->real = real;
+   result->dual.x = ab.x + ba.x;
+   result->dual.y = ab.y + ba.y;
+   result->dual.z = ab.z + ba.z;
+   result->dual.w = ab.w + ba.w;
+}
+
+void ESUTIL_API
+esDualQuaternionNormalize ( ESDualQuaternion *result )
+{
+   GLfloat length = sqrtf ( result->real.x * result->real.x + result->real.y * result->real.y +
+                            result->real.z * result->real.z + result->real.w * result->real.w );
+
+   if ( length > 0.0f )
+   {
+      result->real.x /= length;
+      result->real.y /= length;
+      result->real.z /= length;
+      result->real.w /= length;
+      result->dual.x /= length;
+      result->dual.y /= length;
+      result->dual.z /= length;
+      result->dual.w /= length;
+   }
+}
+
+void ESUTIL_API
+esDualQuaternionTransformPoint ( GLfloat result[3], const ESDualQuaternion *dq, const GLfloat point[3] )
+{
+   GLfloat t[3];
+
+   esDualQuaternionTranslation ( dq, t );
+   esQuaternionRotateVector ( result, &dq->real, point );
+   result[0] += t[0];
+   result[1] += t[1];
+   result[2] += t[2];
+}
+
+void ESUTIL_API
+esDualQuaternionToMatrix ( ESMatrix *result, const ESDualQuaternion *dq )
+{
+   GLfloat rotMat[3][3];
+
+   esQuaternionRotation ( &dq->real, rotMat );
+   esLoadRotation ( result, rotMat );
+   esDualQuaternionTranslation ( dq, result->m[3] );
+   result->m[3][3] = 1.0f;
+}
+
+
+// Instances of one task of esMatrixMultiplyBatch / esComposeTRSBatch, a multiple of 4
+#define BATCH_TASK_SIZE 4096
+
+typedef struct
+{
+   ESMatrix          *result;
+   const ESMatrix    *srcA;
+   const ESTRSArrays *trs;
+   ESMatrix           srcB;
+   int                count;
+} ESMatrixBatch;
+
+static void ESCALLBACK esMatrixMultiplyTask ( void *userData, int task )
+{
+   const ESMatrixBatch *batch = ( const ESMatrixBatch * ) userData;
+   int                  first = task * BATCH_TASK_SIZE;
+   int                  last = first + BATCH_TASK_SIZE < batch->count ? first + BATCH_TASK_SIZE : batch->count;
+   ESVec4               rows[4];
+   int                  i, j;
+
+   for ( j = 0; j < 4; j++ )
+   {
+      rows[j] = esVecLoad ( batch->srcB.m[j] );
+   }
+
+   for ( i = first; i < last; i++ )
+   {
+      const ESMatrix *a = &batch->srcA[i];
+
+      for ( j = 0; j < 4; j++ )
+      {
+         esVecStream ( batch->result[i].m[j], esVecAdd ( esMatrixRow3 ( a->m[j], rows ),
+                                                         esVecMul ( esVecSet ( a->m[j][3] ), rows[3] ) ) );
+      }
+   }
+
+   esVecFence ();
+}
+
+void ESUTIL_API
+esMatrixMultiplyBatch ( ESThreadPool *pool, ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+   ESMatrixBatch batch;
+
+   if ( count <= 0 )
+   {
+      return;
+   }
+
+   batch.result = result;
+   batch.srcA = srcA;
+   batch.trs = NULL;
+   batch.srcB = *srcB;
+   batch.count = count;
+
+   esRunTasks ( pool, ( count + BATCH_TASK_SIZE - 1 ) / BATCH_TASK_SIZE, esMatrixMultiplyTask, &batch );
+}
+
+// Four instances, one in every lane: t, q and s are the components of the translation,
+// rotation and scale, vp[i][j] is element j of row i of viewProjection in every lane.
+// Returns out[i][j], row i of the matrix of instance j.
+static void esComposeTRS4 ( const ESVec4 t[3], const ESVec4 q[4], const ESVec4 s[3],
+                            const ESVec4 vp[4][4], ESVec4 out[4][4] )
+{
+   ESVec4 k, x2, y2, z2, xx, yy, zz, xy, xz, yz, wx, wy, wz;
+   ESVec4 one = esVecSet ( 1.0f );
+   ESVec4 r[3][3];
+   int    i, j;
+
+   // 2 / |q|^2 in place of normalizing q
+   k = esVecDiv ( esVecSet ( 2.0f ),
+                  esVecAdd ( esVecAdd ( esVecMul ( q[0], q[0] ), esVecMul ( q[1], q[1] ) ),
+                             esVecAdd ( esVecMul ( q[2], q[2] ), esVecMul ( q[3], q[3] ) ) ) );
+   x2 = esVecMul ( q[0], k );
+   y2 = esVecMul ( q[1], k );
+   z2 = esVecMul ( q[2], k );
+   xx = esVecMul ( q[0], x2 );
+   yy = esVecMul ( q[1], y2 );
+   zz = esVecMul ( q[2], z2 );
+   xy = esVecMul ( q[0], y2 );
+   xz = esVecMul ( q[0], z2 );
+   yz = esVecMul ( q[1], z2 );
+   wx = esVecMul ( q[3], x2 );
+   wy = esVecMul ( q[3], y2 );
+   wz = esVecMul ( q[3], z2 );
+
+   // the rotation of esRotate, row i scaled by s[i]
+   r[0][0] = esVecMul ( s[0], esVecSub ( one, esVecAdd ( yy, zz ) ) );
+   r[0][1] = esVecMul ( s[0], esVecSub ( xy, wz ) );
+   r[0][2] = esVecMul ( s[0], esVecAdd ( xz, wy ) );
+
+   r[1][0] = esVecMul ( s[1], esVecAdd ( xy, wz ) );
+   r[1][1] = esVecMul ( s[1], esVecSub ( one, esVecAdd ( xx, zz ) ) );
+   r[1][2] = esVecMul ( s[1], esVecSub ( yz, wx ) );
+
+   r[2][0] = esVecMul ( s[2], esVecSub ( xz, wy ) );
+   r[2][1] = esVecMul ( s[2], esVecAdd ( yz, wx ) );
+   r[2][2] = esVecMul ( s[2], esVecSub ( one, esVecAdd ( xx, yy ) ) );
+
+   // model * viewProjection, the model matrix is affine with t as its last row
+   for ( j = 0; j < 4; j++ )
+   {
+      for ( i = 0; i < 3; i++ )
+      {
+         out[i][j] = esVecAdd ( esVecAdd ( esVecMul ( r[i][0], vp[0][j] ), esVecMul ( r[i][1], vp[1][j] ) ),
+                                esVecMul ( r[i][2], vp[2][j] ) );
+      }
+
+      out[3][j] = esVecAdd ( esVecAdd ( esVecAdd ( esVecMul ( t[0], vp[0][j] ), esVecMul ( t[1], vp[1][j] ) ),
+                                        esVecMul ( t[2], vp[2][j] ) ), vp[3][j] );
+   }
+
+   // from a component of four instances per vector to a row of one
+   for ( i = 0; i < 4; i++ )
+   {
+      esVecTranspose ( out[i] );
+   }
+}
+
+// Components of instances first to first + 3 of trs, the identity for NULL arrays
+static void esLoadTRS4 ( const ESTRSArrays *trs, int first, ESVec4 t[3], ESVec4 q[4], ESVec4 s[3] )
+{
+   t[0] = esVecLoad ( trs->translateX + first );
+   t[1] = esVecLoad ( trs->translateY + first );
+   t[2] = esVecLoad ( trs->translateZ + first );
+
+   if ( trs->rotateX != NULL )
+   {
+      q[0] = esVecLoad ( trs->rotateX + first );
+      q[1] = esVecLoad ( trs->rotateY + first );
+      q[2] = esVecLoad ( trs->rotateZ + first );
+      q[3] = esVecLoad ( trs->rotateW + first );
+   }
+   else
+   {
+      q[0] = q[1] = q[2] = esVecSet ( 0.0f );
+      q[3] = esVecSet ( 1.0f );
+   }
+
+   if ( trs->scaleX != NULL )
+   {
+      s[0] = esVecLoad ( trs->scaleX + first );
+      s[1] = esVecLoad ( trs->scaleY + first );
+      s[2] = esVecLoad ( trs->scaleZ + first );
+   }
+   else
+   {
+      s[0] = s[1] = s[2] = esVecSet ( 1.0f );
+   }
+}
+
+static void ESCALLBACK esComposeTRSTask ( void *userData, int task )
+{
+   const ESMatrixBatch *batch = ( const ESMatrixBatch * ) userData;
+   const ESTRSArrays   *trs = batch->trs;
+   int                  first = task * BATCH_TASK_SIZE;
+   int                  last = first + BATCH_TASK_SIZE < batch->count ? first + BATCH_TASK_SIZE : batch->count;
+   ESVec4               vp[4][4];
+   ESVec4               t[3], q[4], s[3];
+   ESVec4               out[4][4];
+   int                  i, j, k;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      for ( j = 0; j < 4; j++ )
+      {
+         vp[i][j] = esVecSet ( batch->srcB.m[i][j] );
+      }
+   }
+
+   for ( i = first; i + 4 <= last; i += 4 )
+   {
+      esLoadTRS4 ( trs, i, t, q, s );
+      esComposeTRS4 ( t, q, s, vp, out );
+
+      // whole matrices in address order, so the stores fill write-combining lines
+      for ( j = 0; j < 4; j++ )
+      {
+         for ( k = 0; k < 4; k++ )
+         {
+            esVecStream ( batch->result[i + j].m[k], out[k][j] );
+         }
+      }
+   }
+
+   if ( i < last )
+   {
+      // the last 1 to 3 instances, padded to 4 with the identity
+      GLfloat     tail[10][4] = { { 0.0f } };
+      ESTRSArrays padded;
+      int         n = last - i;
+
+      for ( j = 0; j < 4; j++ )
+      {
+         tail[6][j] = tail[7][j] = tail[8][j] = tail[9][j] = 1.0f;
+      }
+
+      for ( j = 0; j < n; j++ )
+      {
+         tail[0][j] = trs->translateX[i + j];
+         tail[1][j] = trs->translateY[i + j];
+         tail[2][j] = trs->translateZ[i + j];
+
+         if ( trs->rotateX != NULL )
+         {
+            tail[3][j] = trs->rotateX[i + j];
+            tail[4][j] = trs->rotateY[i + j];
+            tail[5][j] = trs->rotateZ[i + j];
+            tail[6][j] = trs->rotateW[i + j];
+         }
+
+         if ( trs->scaleX != NULL )
+         {
+            tail[7][j] = trs->scaleX[i + j];
+            tail[8][j] = trs->scaleY[i + j];
+            tail[9][j] = trs->scaleZ[i + j];
+         }
+      }
+
+      padded.translateX = tail[0];
+      padded.translateY = tail[1];
+      padded.translateZ = tail[2];
+      padded.rotateX = tail[3];
+      padded.rotateY = tail[4];
+      padded.rotateZ = tail[5];
+      padded.rotateW = tail[6];
+      padded.scaleX = tail[7];
+      padded.scaleY = tail[8];
+      padded.scaleZ = tail[9];
+
+      esLoadTRS4 ( &padded, 0, t, q, s );
+      esComposeTRS4 ( t, q, s, vp, out );
+
+      for ( j = 0; j < n; j++ )
+      {
+         for ( k = 0; k < 4; k++ )
+         {
+            esVecStore ( batch->result[i + j].m[k], out[k][j] );
+         }
+      }
+   }
+
+   esVecFence ();
+}
+
+void ESUTIL_API
+esComposeTRSBatch ( ESThreadPool *pool, ESMatrix *result, const ESTRSArrays *trs,
+                    const ESMatrix *viewProjection, int count )
+{
+   ESMatrixBatch batch;
+
+   if ( count <= 0 )
+   {
+      return;
+   }
+
+   batch.result = result;
+   batch.srcA = NULL;
+   batch.trs = trs;
+   batch.srcB = *viewProjection;
+   batch.count = count;
+
+   esRunTasks ( pool, ( count + BATCH_TASK_SIZE - 1 ) / BATCH_TASK_SIZE, esComposeTRSTask, &batch );
+}
+
+//
+// Culling
+//
+
+void ESUTIL_API
+esFrustumPlanesFromMatrix ( ESFrustumPlanes *result, const ESMatrix *mvp )
+{
+   int p, k;
+
+   // clip = position * mvp, a point is inside when -w <= x, y, z <= w:
+   // the planes are the last column of mvp plus / minus the first three
+   for ( p = 0; p < 6; p++ )
+   {
+      int     column = p / 2;
+      GLfloat sign = ( p & 1 ) ? -1.0f : 1.0f;
+      GLfloat *plane = result->planes[p];
+      GLfloat length;
+
+      for ( k = 0; k < 4; k++ )
+      {
+         plane[k] = mvp->m[k][3] + sign * mvp->m[k][column];
+      }
+
+      length = sqrtf ( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+
+      if ( length > 0.0f )
+      {
+         for ( k = 0; k < 4; k++ )
+         {
+            plane[k] /= length;
+         }
+      }
+   }
+}
+
+void ESUTIL_API
+esComputeBounds ( ESBounds *result, const GLfloat *positions, int stride, int count )
+{
+   GLfloat radius2 = 0.0f;
+   int     i, k;
+
+   memset ( result, 0, sizeof ( ESBounds ) );
+
+   if ( count <= 0 )
+   {
+      return;
+   }
+
+   memcpy ( result->min, positions, sizeof ( result->min ) );
+   memcpy ( result->max, positions, sizeof ( result->max ) );
+
+   for ( i = 1; i < count; i++ )
+   {
+      const GLfloat *p = positions + ( size_t ) i * stride;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         result->min[k] = p[k] < result->min[k] ? p[k] : result->min[k];
+         result->max[k] = p[k] > result->max[k] ? p[k] : result->max[k];
+      }
+   }
+
+   for ( k = 0; k < 3; k++ )
+   {
+      result->center[k] = ( result->min[k] + result->max[k] ) * 0.5f;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      const GLfloat *p = positions + ( size_t ) i * stride;
+      GLfloat dx = p[0] - result->center[0];
+      GLfloat dy = p[1] - result->center[1];
+      GLfloat dz = p[2] - result->center[2];
+      GLfloat d2 = dx * dx + dy * dy + dz * dz;
+
+      radius2 = d2 > radius2 ? d2 : radius2;
+   }
+
+   result->radius = sqrtf ( radius2 );
+}
+
+void ESUTIL_API
+esTransformBounds ( ESBounds *result, const ESBounds *bounds, const ESMatrix *model )
+{
+   GLfloat boxCenter[3], extent[3], center[3];
+   GLfloat scale2 = 0.0f;
+   int     j, k;
+
+   // the center of the box moves with the model, its half extents along each
+   // axis add up over the absolute values of the rows
+   for ( j = 0; j < 3; j++ )
+   {
+      boxCenter[j] = model->m[3][j];
+      extent[j] = 0.0f;
+      center[j] = model->m[3][j];
+
+      for ( k = 0; k < 3; k++ )
+      {
+         boxCenter[j] += ( bounds->min[k] + bounds->max[k] ) * 0.5f * model->m[k][j];
+         extent[j] += ( bounds->max[k] - bounds->min[k] ) * 0.5f * fabsf ( model->m[k][j] );
+         center[j] += bounds->center[k] * model->m[k][j];
+      }
+   }
+
+   // the sphere grows by the longest axis of the model
+   for ( k = 0; k < 3; k++ )
+   {
+      GLfloat length2 = model->m[k][0] * model->m[k][0] + model->m[k][1] * model->m[k][1] +
+                        model->m[k][2] * model->m[k][2];
+
+      scale2 = length2 > scale2 ? length2 : scale2;
+   }
+
+   result->radius = bounds->radius * sqrtf ( scale2 );
+
+   for ( j = 0; j < 3; j++ )
+   {
+      result->min[j] = boxCenter[j] - extent[j];
+      result->max[j] = boxCenter[j] + extent[j];
+      result->center[j] = center[j];
+   }
+}
+
+// Append the objects of the four starting at first whose bit is set in mask
+static int esCullCompact ( int mask, int first, int count, int *visible, int numVisible )
+{
+   int i;
+
+   if ( count - first < 4 )
+   {
+      for ( i = 0; i < count - first; i++ )
+      {
+         if ( mask & ( 1 << i ) )
+         {
+            visible[numVisible++] = first + i;
+         }
+      }
+
+      return numVisible;
+   }
+
+   // without branches, every index is written and kept only when its bit is set
+   visible[numVisible] = first;
+   numVisible += mask & 1;
+   visible[numVisible] = first + 1;
+   numVisible += ( mask >> 1 ) & 1;
+   visible[numVisible] = first + 2;
+   numVisible += ( mask >> 2 ) & 1;
+   visible[numVisible] = first + 3;
+   numVisible += ( mask >> 3 ) & 1;
+   return numVisible;
+}
+
+// Four values of an array from first, the missing ones 0 past the end of it
+static ESVec4 esCullLoad ( const GLfloat *a, int first, int count )
+{
+   GLfloat tail[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+   if ( count - first >= 4 )
+   {
+      return esVecLoad ( a + first );
+   }
+
+   memcpy ( tail, a + first, sizeof ( GLfloat ) * ( count - first ) );
+   return esVecLoad ( tail );
+}
+
+int ESUTIL_API
+esCullSpheres ( const ESFrustumPlanes *frustum, const ESSphereArrays *spheres, int count, int *visible )
+{
+   ESVec4 planes[6][4];
+   int    numVisible = 0;
+   int    i, p, k;
+
+   for ( p = 0; p < 6; p++ )
+   {
+      for ( k = 0; k < 4; k++ )
+      {
+         planes[p][k] = esVecSet ( frustum->planes[p][k] );
+      }
+   }
+
+   // a sphere is visible when its center is no further than its radius
+   // outside of every plane
+   for ( i = 0; i < count; i += 4 )
+   {
+      ESVec4 x = esCullLoad ( spheres->centerX, i, count );
+      ESVec4 y = esCullLoad ( spheres->centerY, i, count );
+      ESVec4 z = esCullLoad ( spheres->centerZ, i, count );
+      ESVec4 r = esCullLoad ( spheres->radius, i, count );
+      ESVec4 nearest;
+
+      for ( p = 0; p < 6; p++ )
+      {
+         ESVec4 d = esVecAdd ( esVecAdd ( esVecAdd ( esVecMul ( x, planes[p][0] ), esVecMul ( y, planes[p][1] ) ),
+                                          esVecAdd ( esVecMul ( z, planes[p][2] ), planes[p][3] ) ), r );
+
+         nearest = p == 0 ? d : esVecMin ( nearest, d );
+      }
+
+      numVisible = esCullCompact ( esVecNonNegativeMask ( nearest ), i, count, visible, numVisible );
+   }
+
+   return numVisible;
+}
+
+int ESUTIL_API
+esCullBoxes ( const ESFrustumPlanes *frustum, const ESBoxArrays *boxes, int count, int *visible )
+{
+   ESVec4 planes[6][4], extents[6][3];
+   ESVec4 half = esVecSet ( 0.5f );
+   int    numVisible = 0;
+   int    i, p, k;
+
+   for ( p = 0; p < 6; p++ )
+   {
+      for ( k = 0; k < 4; k++ )
+      {
+         planes[p][k] = esVecSet ( frustum->planes[p][k] );
+      }
+
+      for ( k = 0; k < 3; k++ )
+      {
+         extents[p][k] = esVecSet ( fabsf ( frustum->planes[p][k] ) );
+      }
+   }
+
+   // a box is visible when its center is no further outside of every plane than
+   // the half extents reach along the normal of the plane
+   for ( i = 0; i < count; i += 4 )
+   {
+      ESVec4 minX = esCullLoad ( boxes->minX, i, count ), maxX = esCullLoad ( boxes->maxX, i, count );
+      ESVec4 minY = esCullLoad ( boxes->minY, i, count ), maxY = esCullLoad ( boxes->maxY, i, count );
+      ESVec4 minZ = esCullLoad ( boxes->minZ, i, count ), maxZ = esCullLoad ( boxes->maxZ, i, count );
+      ESVec4 x = esVecMul ( esVecAdd ( minX, maxX ), half ), ex = esVecMul ( esVecSub ( maxX, minX ), half );
+      ESVec4 y = esVecMul ( esVecAdd ( minY, maxY ), half ), ey = esVecMul ( esVecSub ( maxY, minY ), half );
+      ESVec4 z = esVecMul ( esVecAdd ( minZ, maxZ ), half ), ez = esVecMul ( esVecSub ( maxZ, minZ ), half );
+      ESVec4 nearest;
+
+      for ( p = 0; p < 6; p++ )
+      {
+         ESVec4 d = esVecAdd ( esVecAdd ( esVecMul ( x, planes[p][0] ), esVecMul ( y, planes[p][1] ) ),
+                               esVecAdd ( esVecMul ( z, planes[p][2] ), planes[p][3] ) );
+         ESVec4 r = esVecAdd ( esVecAdd ( esVecMul ( ex, extents[p][0] ), esVecMul ( ey, extents[p][1] ) ),
+                               esVecMul ( ez, extents[p][2] ) );
+
+         d = esVecAdd ( d, r );
+         nearest = p == 0 ? d : esVecMin ( nearest, d );
+      }
+
+      numVisible = esCullCompact ( esVecNonNegativeMask ( nearest ), i, count, visible, numVisible );
+   }
+
+   return numVisible;
+}
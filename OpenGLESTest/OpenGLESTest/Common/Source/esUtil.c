@@ -43,22 +43,28 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <math.h>
+#include <limits.h>
 #include "esUtil.h"
 #include "esUtil_win.h"
+#include "esUtil_private.h"
 
 #ifdef ANDROID
 #include <android/log.h>
 #include <android_native_app_glue.h>
 #include <android/asset_manager.h>
-typedef AAsset esFile;
-#else
-typedef FILE esFile;
 #endif
 
 #ifdef __APPLE__
 #include "FileWrapper.h"
 #endif
 
+#if !defined(_WIN32) && !defined(ANDROID)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 ///
 //  Macros
 //
@@ -306,118 +312,941 @@ void ESUTIL_API esLogMessage ( const char *formatStr, ... )
 }
 
 ///
-// esFileRead()
+// esMapFile()
 //
-//    Wrapper for platform specific File open
+//    Map a whole file read-only into memory.  The file stays mapped until
+//    esUnmapFile is called, so callers can parse it or hand pointers into it
+//    straight to GL without an intermediate copy.
 //
-static esFile *esFileOpen ( void *ioContext, const char *fileName )
+GLboolean ESUTIL_API esMapFile ( void *ioContext, const char *fileName, ESMappedFile *mappedFile )
 {
-   esFile *pFile = NULL;
+   memset ( mappedFile, 0, sizeof ( ESMappedFile ) );
 
-#ifdef ANDROID
+#if !defined(ANDROID)
+   // only the Android asset manager opens files through it
+   ( void ) ioContext;
+#endif
 
-   if ( ioContext != NULL )
+#if defined(ANDROID)
    {
-      AAssetManager *assetManager = ( AAssetManager * ) ioContext;
-      pFile = AAssetManager_open ( assetManager, fileName, AASSET_MODE_BUFFER );
+      AAsset *asset;
+
+      if ( ioContext == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      asset = AAssetManager_open ( ( AAssetManager * ) ioContext, fileName, AASSET_MODE_BUFFER );
+
+      if ( asset == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      mappedFile->data = ( const unsigned char * ) AAsset_getBuffer ( asset );
+      mappedFile->size = ( size_t ) AAsset_getLength ( asset );
+      mappedFile->fileHandle = asset;
+
+      if ( mappedFile->data == NULL && mappedFile->size != 0 )
+      {
+         AAsset_close ( asset );
+         mappedFile->fileHandle = NULL;
+         return GL_FALSE;
+      }
    }
+#elif defined(_WIN32)
+   {
+      HANDLE        file;
+      HANDLE        mapping;
+      LARGE_INTEGER fileSize;
+
+      file = CreateFileA ( fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
 
+      if ( file == INVALID_HANDLE_VALUE )
+      {
+         return GL_FALSE;
+      }
+
+      if ( !GetFileSizeEx ( file, &fileSize ) )
+      {
+         CloseHandle ( file );
+         return GL_FALSE;
+      }
+
+      mappedFile->fileHandle = file;
+
+      if ( fileSize.QuadPart == 0 )
+      {
+         // CreateFileMapping refuses empty files, an empty view is still valid
+         return GL_TRUE;
+      }
+
+      mapping = CreateFileMappingA ( file, NULL, PAGE_READONLY, 0, 0, NULL );
+
+      if ( mapping == NULL )
+      {
+         CloseHandle ( file );
+         mappedFile->fileHandle = NULL;
+         return GL_FALSE;
+      }
+
+      mappedFile->mapHandle = mapping;
+      mappedFile->data = ( const unsigned char * ) MapViewOfFile ( mapping, FILE_MAP_READ, 0, 0, 0 );
+      mappedFile->size = ( size_t ) fileSize.QuadPart;
+
+      if ( mappedFile->data == NULL )
+      {
+         esUnmapFile ( mappedFile );
+         return GL_FALSE;
+      }
+   }
 #else
+   {
+      int         fd;
+      struct stat st;
+      void       *view;
+
 #ifdef __APPLE__
-   // iOS: Remap the filename to a path that can be opened from the bundle.
-   fileName = GetBundleFileName ( fileName );
+      fileName = GetBundleFileName ( fileName );
 #endif
 
-   pFile = fopen ( fileName, "rb" );
+      fd = open ( fileName, O_RDONLY );
+
+      if ( fd < 0 )
+      {
+         return GL_FALSE;
+      }
+
+      if ( fstat ( fd, &st ) != 0 )
+      {
+         close ( fd );
+         return GL_FALSE;
+      }
+
+      if ( st.st_size > 0 )
+      {
+         view = mmap ( NULL, ( size_t ) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+         if ( view == MAP_FAILED )
+         {
+            close ( fd );
+            return GL_FALSE;
+         }
+
+         mappedFile->data = ( const unsigned char * ) view;
+         mappedFile->size = ( size_t ) st.st_size;
+      }
+
+      // the mapping keeps its own reference to the file
+      close ( fd );
+   }
 #endif
 
-   return pFile;
+   return GL_TRUE;
 }
 
 ///
-// esFileRead()
+// esUnmapFile()
 //
-//    Wrapper for platform specific File close
+//    Release a mapping created by esMapFile
 //
-static void esFileClose ( esFile *pFile )
+void ESUTIL_API esUnmapFile ( ESMappedFile *mappedFile )
 {
-   if ( pFile != NULL )
+   if ( mappedFile == NULL )
    {
-#ifdef ANDROID
-      AAsset_close ( pFile );
+      return;
+   }
+
+#if defined(ANDROID)
+   if ( mappedFile->fileHandle != NULL )
+   {
+      AAsset_close ( ( AAsset * ) mappedFile->fileHandle );
+   }
+#elif defined(_WIN32)
+   if ( mappedFile->data != NULL )
+   {
+      UnmapViewOfFile ( mappedFile->data );
+   }
+
+   if ( mappedFile->mapHandle != NULL )
+   {
+      CloseHandle ( ( HANDLE ) mappedFile->mapHandle );
+   }
+
+   if ( mappedFile->fileHandle != NULL )
+   {
+      CloseHandle ( ( HANDLE ) mappedFile->fileHandle );
+   }
+#else
+   if ( mappedFile->data != NULL )
+   {
+      munmap ( ( void * ) mappedFile->data, mappedFile->size );
+   }
+#endif
+
+   memset ( mappedFile, 0, sizeof ( ESMappedFile ) );
+}
+
+///
+// Thread pool
+//
+struct ESThreadPool
+{
+   /// Worker threads plus the thread calling esRunTasks
+   int          threadCount;
+
+   /// Batch handed out by esRunTasks, guarded by lock
+   void ( ESCALLBACK *taskFunc ) ( void *, int );
+   void        *userData;
+   int          taskCount;
+   int          nextTask;
+   int          pendingTasks;
+   unsigned int batch;
+   int          quit;
+
+#ifdef _WIN32
+   HANDLE             *threads;
+   CRITICAL_SECTION    lock;
+   CONDITION_VARIABLE  wake;
+   CONDITION_VARIABLE  done;
+#else
+   pthread_t          *threads;
+   pthread_mutex_t     lock;
+   pthread_cond_t      wake;
+   pthread_cond_t      done;
+#endif
+};
+
+///
+// esPoolDrain()
+//
+//    Run tasks of the current batch until none is left to start.  Called with
+//    the lock held, the lock is released while a task runs.
+//
+static void esPoolDrain ( ESThreadPool *pool )
+{
+   while ( pool->nextTask < pool->taskCount )
+   {
+      int task = pool->nextTask++;
+
+      esPoolUnlock ( pool );
+      pool->taskFunc ( pool->userData, task );
+      esPoolLock ( pool );
+
+      if ( --pool->pendingTasks == 0 )
+      {
+         esPoolWakeAll ( pool, done );
+      }
+   }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI esPoolWorker ( LPVOID param )
 #else
-      fclose ( pFile );
-      pFile = NULL;
+static void *esPoolWorker ( void *param )
 #endif
+{
+   ESThreadPool *pool = ( ESThreadPool * ) param;
+   unsigned int  batch = 0;
+
+   esPoolLock ( pool );
+
+   for ( ;; )
+   {
+      while ( !pool->quit && pool->batch == batch )
+      {
+         esPoolWait ( pool, wake );
+      }
+
+      if ( pool->quit )
+      {
+         break;
+      }
+
+      batch = pool->batch;
+      esPoolDrain ( pool );
    }
+
+   esPoolUnlock ( pool );
+   return 0;
 }
 
 ///
-// esFileRead()
+// esGetProcessorCount()
 //
-//    Wrapper for platform specific File read
+//    Number of logical processors the process can run on
 //
-static int esFileRead ( esFile *pFile, int bytesToRead, void *buffer )
+int ESUTIL_API esGetProcessorCount ( void )
 {
-   int bytesRead = 0;
+#ifdef _WIN32
+   SYSTEM_INFO info;
+
+   GetSystemInfo ( &info );
+   return info.dwNumberOfProcessors > 0 ? ( int ) info.dwNumberOfProcessors : 1;
+#else
+   long count = sysconf ( _SC_NPROCESSORS_ONLN );
+
+   return count > 0 ? ( int ) count : 1;
+#endif
+}
 
-   if ( pFile == NULL )
+///
+// esCreateThreadPool()
+//
+//    Start threadCount - 1 worker threads, the caller of esRunTasks is the last one
+//
+ESThreadPool *ESUTIL_API esCreateThreadPool ( int threadCount )
+{
+   ESThreadPool *pool;
+   int           i;
+
+   if ( threadCount < 1 )
    {
-      return bytesRead;
+      threadCount = esGetProcessorCount ();
    }
 
-#ifdef ANDROID
-   bytesRead = AAsset_read ( pFile, buffer, bytesToRead );
+   pool = ( ESThreadPool * ) calloc ( 1, sizeof ( ESThreadPool ) );
+
+   if ( pool == NULL )
+   {
+      return NULL;
+   }
+
+   pool->threads = calloc ( threadCount, sizeof ( pool->threads[0] ) );
+
+   if ( pool->threads == NULL )
+   {
+      free ( pool );
+      return NULL;
+   }
+
+#ifdef _WIN32
+   InitializeCriticalSection ( &pool->lock );
+   InitializeConditionVariable ( &pool->wake );
+   InitializeConditionVariable ( &pool->done );
+#else
+   pthread_mutex_init ( &pool->lock, NULL );
+   pthread_cond_init ( &pool->wake, NULL );
+   pthread_cond_init ( &pool->done, NULL );
+#endif
+
+   // a worker which can't be started only makes the pool smaller
+   pool->threadCount = 1;
+
+   for ( i = 1; i < threadCount; i++ )
+   {
+#ifdef _WIN32
+      HANDLE thread = CreateThread ( NULL, 0, esPoolWorker, pool, 0, NULL );
+
+      if ( thread == NULL )
+      {
+         break;
+      }
+
+      pool->threads[pool->threadCount - 1] = thread;
+#else
+      if ( pthread_create ( &pool->threads[pool->threadCount - 1], NULL, esPoolWorker, pool ) != 0 )
+      {
+         break;
+      }
+#endif
+      pool->threadCount++;
+   }
+
+   return pool;
+}
+
+///
+// esGetThreadCount()
+//
+//    Number of threads running the tasks of the pool, the calling thread included
+//
+int ESUTIL_API esGetThreadCount ( const ESThreadPool *pool )
+{
+   return pool != NULL ? pool->threadCount : 1;
+}
+
+///
+// esRunTasks()
+//
+//    Call taskFunc ( userData, i ) for every i in [0, taskCount) on the threads
+//    of the pool and return once all of them have finished.  Tasks are handed
+//    out in index order to whichever thread is free first.
+//
+void ESUTIL_API esRunTasks ( ESThreadPool *pool, int taskCount,
+                             void ( ESCALLBACK *taskFunc ) ( void *, int ), void *userData )
+{
+   int i;
+
+   if ( pool == NULL || pool->threadCount == 1 || taskCount == 1 )
+   {
+      for ( i = 0; i < taskCount; i++ )
+      {
+         taskFunc ( userData, i );
+      }
+
+      return;
+   }
+
+   if ( taskCount <= 0 )
+   {
+      return;
+   }
+
+   esPoolLock ( pool );
+
+   pool->taskFunc = taskFunc;
+   pool->userData = userData;
+   pool->taskCount = taskCount;
+   pool->nextTask = 0;
+   pool->pendingTasks = taskCount;
+   pool->batch++;
+   esPoolWakeAll ( pool, wake );
+
+   esPoolDrain ( pool );
+
+   while ( pool->pendingTasks > 0 )
+   {
+      esPoolWait ( pool, done );
+   }
+
+   esPoolUnlock ( pool );
+}
+
+///
+// esDestroyThreadPool()
+//
+//    Stop and join the worker threads
+//
+void ESUTIL_API esDestroyThreadPool ( ESThreadPool *pool )
+{
+   int i;
+
+   if ( pool == NULL )
+   {
+      return;
+   }
+
+   esPoolLock ( pool );
+   pool->quit = 1;
+   esPoolWakeAll ( pool, wake );
+   esPoolUnlock ( pool );
+
+   for ( i = 0; i < pool->threadCount - 1; i++ )
+   {
+#ifdef _WIN32
+      WaitForSingleObject ( pool->threads[i], INFINITE );
+      CloseHandle ( pool->threads[i] );
+#else
+      pthread_join ( pool->threads[i], NULL );
+#endif
+   }
+
+#ifdef _WIN32
+   DeleteCriticalSection ( &pool->lock );
 #else
-   bytesRead = fread ( buffer, bytesToRead, 1, pFile );
+   pthread_cond_destroy ( &pool->done );
+   pthread_cond_destroy ( &pool->wake );
+   pthread_mutex_destroy ( &pool->lock );
 #endif
 
-   return bytesRead;
+   free ( pool->threads );
+   free ( pool );
+}
+
+/// Bytes esDecodeTGARLE may write past the end of the pixels
+#define RLE_SLACK 16
+
+///
+// esExpandRun()
+//
+//    Fill count pixels of size bytes at dst with pixel.  A 16 byte pattern
+//    of whole pixels is built once and stored over and over, one unaligned
+//    vector store per step for the short runs photos are made of, and no
+//    per pixel loop for the long ones.  Up to RLE_SLACK bytes past the run
+//    are overwritten.
+//
+static void esExpandRun ( unsigned char *dst, const unsigned char *pixel, int size, int count )
+{
+   unsigned char pattern[RLE_SLACK + 4];
+   size_t total = ( size_t ) size * count;
+   size_t step = RLE_SLACK - RLE_SLACK % size;
+   size_t done;
+   int    i;
+
+   switch ( size )
+   {
+      case 1:
+         memset ( pattern, pixel[0], RLE_SLACK );
+         break;
+
+      case 2:
+         for ( i = 0; i < RLE_SLACK; i += 2 )
+         {
+            memcpy ( pattern + i, pixel, 2 );
+         }
+
+         break;
+
+      case 3:
+         for ( i = 0; i < RLE_SLACK; i += 3 )
+         {
+            memcpy ( pattern + i, pixel, 3 );
+         }
+
+         break;
+
+      default:
+         for ( i = 0; i < RLE_SLACK; i += 4 )
+         {
+            memcpy ( pattern + i, pixel, 4 );
+         }
+
+         break;
+   }
+
+   for ( done = 0; done < total; done += step )
+   {
+      memcpy ( dst + done, pattern, RLE_SLACK );
+   }
+}
+
+///
+// esDecodeTGARLE()
+//
+//    Expand the run-length packets of an image type 10 / 11 TGA into
+//    pixelCount pixels at dst, which needs RLE_SLACK bytes to spare after
+//    them.  Packets may run across rows.  Raw packets are copied 16 bytes
+//    at a time as well while the file has bytes to spare after them.
+//
+static GLboolean esDecodeTGARLE ( const unsigned char *src, const unsigned char *end,
+                                  unsigned char *dst, int pixelSize, size_t pixelCount )
+{
+   size_t done = 0;
+
+   while ( done < pixelCount )
+   {
+      size_t count;
+      size_t bytes;
+      int    header;
+
+      if ( src >= end )
+      {
+         return GL_FALSE;
+      }
+
+      header = *src++;
+      count = ( header & 0x7f ) + 1;
+
+      if ( count > pixelCount - done )
+      {
+         count = pixelCount - done;
+      }
+
+      bytes = count * pixelSize;
+
+      if ( header & 0x80 )
+      {
+         // run packet: one pixel repeated
+         if ( end - src < pixelSize )
+         {
+            return GL_FALSE;
+         }
+
+         esExpandRun ( dst + done * pixelSize, src, pixelSize, ( int ) count );
+         src += pixelSize;
+      }
+      else
+      {
+         // raw packet: count pixels as they are
+         if ( ( size_t ) ( end - src ) < bytes )
+         {
+            return GL_FALSE;
+         }
+
+         if ( ( size_t ) ( end - src ) >= bytes + RLE_SLACK )
+         {
+            size_t copied;
+
+            for ( copied = 0; copied < bytes; copied += RLE_SLACK )
+            {
+               memcpy ( dst + done * pixelSize + copied, src + copied, RLE_SLACK );
+            }
+         }
+         else
+         {
+            memcpy ( dst + done * pixelSize, src, bytes );
+         }
+
+         src += bytes;
+      }
+
+      done += count;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// esMapTGA()
+//
+//    Map a TGA file and find its pixels.  Uncompressed 8, 24 and 32-bit
+//    images point into the mapping, RLE and 16-bit ones are decoded once.
+//
+GLboolean ESUTIL_API esMapTGA ( void *ioContext, const char *fileName, ESImage *image )
+{
+   TGA_HEADER     Header;
+   const unsigned char *data;
+   const unsigned char *end;
+   size_t         pixelCount;
+   int            pixelSize;
+   GLboolean      rle;
+
+   memset ( image, 0, sizeof ( ESImage ) );
+
+   if ( !esMapFile ( ioContext, fileName, &image->file ) || image->file.size < sizeof ( TGA_HEADER ) )
+   {
+      esLogMessage ( "esMapTGA FAILED to load : { %s }\n", fileName );
+      esUnmapFile ( &image->file );
+      return GL_FALSE;
+   }
+
+   memcpy ( &Header, image->file.data, sizeof ( TGA_HEADER ) );
+   end = image->file.data + image->file.size;
+   data = image->file.data + sizeof ( TGA_HEADER ) + Header.IdSize;
+
+   // a palette is skipped, colormapped images themselves are not supported
+   if ( Header.MapType != 0 )
+   {
+      data += Header.PaletteSize * ( ( Header.PaletteEntryDepth + 7 ) / 8 );
+   }
+
+   rle = Header.ImageType == 10 || Header.ImageType == 11;
+   pixelSize = ( Header.ColorDepth + 7 ) / 8;
+
+   if ( ( Header.ImageType != 2 && Header.ImageType != 3 && Header.ImageType != 10 && Header.ImageType != 11 ) ||
+         ( ( Header.ImageType == 3 || Header.ImageType == 11 ) && pixelSize != 1 ) ||
+         ( ( Header.ImageType == 2 || Header.ImageType == 10 ) && pixelSize != 2 && pixelSize != 3 && pixelSize != 4 ) ||
+         Header.Width == 0 || Header.Height == 0 || data > end )
+   {
+      esLogMessage ( "esMapTGA FAILED to load : { %s }, image type %d with %d bits per pixel is not supported\n",
+                     fileName, Header.ImageType, Header.ColorDepth );
+      esUnmapFile ( &image->file );
+      return GL_FALSE;
+   }
+
+   image->width = Header.Width;
+   image->height = Header.Height;
+   image->bytesPerPixel = pixelSize;
+   image->topDown = ( Header.Descriptor & INVERTED_BIT ) ? GL_TRUE : GL_FALSE;
+   pixelCount = ( size_t ) image->width * image->height;
+
+   if ( !rle && pixelSize != 2 )
+   {
+      if ( ( size_t ) ( end - data ) < pixelCount * pixelSize )
+      {
+         esLogMessage ( "esMapTGA FAILED to load : { %s }, the file is truncated\n", fileName );
+         esUnmapFile ( &image->file );
+         return GL_FALSE;
+      }
+
+      image->pixels = data;
+      return GL_TRUE;
+   }
+
+   image->decoded = ( unsigned char * ) malloc ( pixelCount * pixelSize + RLE_SLACK );
+
+   if ( image->decoded == NULL )
+   {
+      esFreeTGA ( image );
+      return GL_FALSE;
+   }
+
+   if ( rle )
+   {
+      if ( !esDecodeTGARLE ( data, end, image->decoded, pixelSize, pixelCount ) )
+      {
+         esLogMessage ( "esMapTGA FAILED to load : { %s }, the file is truncated\n", fileName );
+         esFreeTGA ( image );
+         return GL_FALSE;
+      }
+   }
+   else
+   {
+      if ( ( size_t ) ( end - data ) < pixelCount * pixelSize )
+      {
+         esLogMessage ( "esMapTGA FAILED to load : { %s }, the file is truncated\n", fileName );
+         esFreeTGA ( image );
+         return GL_FALSE;
+      }
+
+      memcpy ( image->decoded, data, pixelCount * pixelSize );
+   }
+
+   if ( pixelSize == 2 )
+   {
+      // A1R5G5B5 little endian to the R5G5B5A1 shorts GL_UNSIGNED_SHORT_5_5_5_1 reads,
+      // alpha is opaque unless the descriptor gives it a bit
+      int       hasAlpha = ( Header.Descriptor & 0x0f ) != 0;
+      size_t    i;
+      GLushort *shorts = ( GLushort * ) image->decoded;
+
+      for ( i = 0; i < pixelCount; i++ )
+      {
+         unsigned int value = image->decoded[i * 2] | ( image->decoded[i * 2 + 1] << 8 );
+         unsigned int alpha = hasAlpha ? ( value >> 15 ) & 1 : 1;
+
+         shorts[i] = ( GLushort ) ( ( ( value >> 10 ) & 0x1f ) << 11 | ( ( value >> 5 ) & 0x1f ) << 6 |
+                                    ( value & 0x1f ) << 1 | alpha );
+      }
+   }
+
+   image->pixels = image->decoded;
+   esUnmapFile ( &image->file );
+
+   return GL_TRUE;
+}
+
+///
+// esFormatTGA()
+//
+//    GL format of the pixels of an image from esMapTGA and the swizzle
+//    putting its channels in RGBA order
+//
+GLboolean esFormatTGA ( int bytesPerPixel, GLenum *internalFormat, GLenum *format, GLenum *type,
+                        GLint swizzle[4] )
+{
+   swizzle[0] = GL_RED;
+   swizzle[1] = GL_GREEN;
+   swizzle[2] = GL_BLUE;
+   swizzle[3] = GL_ALPHA;
+   *internalFormat = GL_NONE;
+   *format = GL_NONE;
+   *type = GL_UNSIGNED_BYTE;
+
+   switch ( bytesPerPixel )
+   {
+      case 1:
+         // gray in every channel, so it samples like GL_LUMINANCE and GL_ALPHA alike
+         *internalFormat = GL_R8;
+         *format = GL_RED;
+         swizzle[1] = swizzle[2] = swizzle[3] = GL_RED;
+         return GL_TRUE;
+
+      case 2:
+         *internalFormat = GL_RGB5_A1;
+         *format = GL_RGBA;
+         *type = GL_UNSIGNED_SHORT_5_5_5_1;
+         return GL_TRUE;
+
+      case 3:
+         *internalFormat = GL_RGB8;
+         *format = GL_RGB;
+         swizzle[0] = GL_BLUE;
+         swizzle[2] = GL_RED;
+         return GL_TRUE;
+
+      case 4:
+         *internalFormat = GL_RGBA8;
+         *format = GL_RGBA;
+         swizzle[0] = GL_BLUE;
+         swizzle[2] = GL_RED;
+         return GL_TRUE;
+
+      default:
+         return GL_FALSE;
+   }
+}
+
+void esSwizzle ( GLenum target, const GLint swizzle[4] )
+{
+   glTexParameteri ( target, GL_TEXTURE_SWIZZLE_R, swizzle[0] );
+   glTexParameteri ( target, GL_TEXTURE_SWIZZLE_G, swizzle[1] );
+   glTexParameteri ( target, GL_TEXTURE_SWIZZLE_B, swizzle[2] );
+   glTexParameteri ( target, GL_TEXTURE_SWIZZLE_A, swizzle[3] );
+}
+
+/// Unpack state changed by the uploads of Common, saved and restored around them
+static const GLenum unpackState[UNPACK_STATE_COUNT] = { GL_UNPACK_ALIGNMENT, GL_UNPACK_ROW_LENGTH, GL_UNPACK_SKIP_ROWS,
+                                                        GL_UNPACK_SKIP_PIXELS, GL_PIXEL_UNPACK_BUFFER_BINDING,
+                                                        GL_TEXTURE_BINDING_2D
+                                                      };
+
+void esSaveUnpackState ( GLint saved[UNPACK_STATE_COUNT] )
+{
+   int i;
+
+   for ( i = 0; i < ( int ) UNPACK_STATE_COUNT; i++ )
+   {
+      glGetIntegerv ( unpackState[i], &saved[i] );
+   }
+
+   // tightly packed rows
+   glPixelStorei ( GL_UNPACK_ROW_LENGTH, 0 );
+   glPixelStorei ( GL_UNPACK_SKIP_ROWS, 0 );
+   glPixelStorei ( GL_UNPACK_SKIP_PIXELS, 0 );
+}
+
+void esRestoreUnpackState ( const GLint saved[UNPACK_STATE_COUNT] )
+{
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, saved[0] );
+   glPixelStorei ( GL_UNPACK_ROW_LENGTH, saved[1] );
+   glPixelStorei ( GL_UNPACK_SKIP_ROWS, saved[2] );
+   glPixelStorei ( GL_UNPACK_SKIP_PIXELS, saved[3] );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, saved[4] );
+   glBindTexture ( GL_TEXTURE_2D, saved[5] );
+}
+
+///
+// esUnpackAlignment()
+//
+//    Largest GL_UNPACK_ALIGNMENT rows of pitch bytes are aligned to
+//
+GLint esUnpackAlignment ( int pitch )
+{
+   return pitch % 8 == 0 ? 8 : pitch % 4 == 0 ? 4 : pitch % 2 == 0 ? 2 : 1;
+}
+
+///
+// esTexImageTGA()
+//
+//    Upload an image from esMapTGA straight from its pixels.  The channel
+//    order is fixed up by the texture swizzle instead of a copy, and rows
+//    stored top down are uploaded one by one so the bottom row ends up at t = 0.
+//
+GLboolean ESUTIL_API esTexImageTGA ( GLenum target, GLint level, const ESImage *image )
+{
+   GLint  saved[UNPACK_STATE_COUNT];
+   GLenum parameterTarget = target;
+   GLenum internalFormat, format, type;
+   GLint  swizzle[4];
+   int    pitch = image->width * image->bytesPerPixel;
+   int    i;
+
+   if ( !esFormatTGA ( image->bytesPerPixel, &internalFormat, &format, &type, swizzle ) )
+   {
+      return GL_FALSE;
+   }
+
+   if ( target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z )
+   {
+      parameterTarget = GL_TEXTURE_CUBE_MAP;
+   }
+
+   // the pixels are client memory
+   esSaveUnpackState ( saved );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, esUnpackAlignment ( pitch ) );
+
+   if ( !image->topDown )
+   {
+      glTexImage2D ( target, level, internalFormat, image->width, image->height, 0, format, type, image->pixels );
+   }
+   else
+   {
+      glTexImage2D ( target, level, internalFormat, image->width, image->height, 0, format, type, NULL );
+
+      for ( i = 0; i < image->height; i++ )
+      {
+         glTexSubImage2D ( target, level, 0, image->height - 1 - i, image->width, 1, format, type,
+                           image->pixels + ( size_t ) i * pitch );
+      }
+   }
+
+   esSwizzle ( parameterTarget, swizzle );
+   esRestoreUnpackState ( saved );
+
+   return GL_TRUE;
+}
+
+///
+// esFreeTGA()
+//
+//    Release the decoded pixels and the mapping of an image from esMapTGA
+//
+void ESUTIL_API esFreeTGA ( ESImage *image )
+{
+   if ( image == NULL )
+   {
+      return;
+   }
+
+   free ( image->decoded );
+   esUnmapFile ( &image->file );
+   memset ( image, 0, sizeof ( ESImage ) );
 }
 
 ///
 // esLoadTGA()
 //
-//    Loads a 8-bit, 24-bit or 32-bit TGA image from a file
+//    Loads a 8-bit, 16-bit, 24-bit or 32-bit TGA image from a file, uncompressed
+//    or RLE, into a copy with RGB(A) channels and the bottom row first
 //
 char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height )
 {
-   char        *buffer;
-   esFile      *fp;
-   TGA_HEADER   Header;
-   int          bytesRead;
+   ESImage  image;
+   char    *buffer;
+   int      outSize;
+   int      x, y;
 
-   // Open the file for reading
-   fp = esFileOpen ( ioContext, fileName );
-
-   if ( fp == NULL )
+   if ( !esMapTGA ( ioContext, fileName, &image ) )
    {
-      // Log error as 'error in opening the input file from apk'
       esLogMessage ( "esLoadTGA FAILED to load : { %s }\n", fileName );
       return NULL;
    }
 
-   bytesRead = esFileRead ( fp, sizeof ( TGA_HEADER ), &Header );
+   *width = image.width;
+   *height = image.height;
 
-   *width = Header.Width;
-   *height = Header.Height;
+   // 16-bit images become RGB like 24-bit ones
+   outSize = image.bytesPerPixel == 2 ? 3 : image.bytesPerPixel;
+   buffer = ( char * ) malloc ( ( size_t ) image.width * image.height * outSize );
 
-   if ( Header.ColorDepth == 8 ||
-         Header.ColorDepth == 24 || Header.ColorDepth == 32 )
+   if ( buffer == NULL )
    {
-      int bytesToRead = sizeof ( char ) * ( *width ) * ( *height ) * Header.ColorDepth / 8;
+      esFreeTGA ( &image );
+      return NULL;
+   }
 
-      // Allocate the image data buffer
-      buffer = ( char * ) malloc ( bytesToRead );
+   for ( y = 0; y < image.height; y++ )
+   {
+      const unsigned char *src = image.pixels + ( size_t ) y * image.width * image.bytesPerPixel;
+      unsigned char *dst = ( unsigned char * ) buffer +
+                           ( size_t ) ( image.topDown ? image.height - 1 - y : y ) * image.width * outSize;
 
-      if ( buffer )
+      if ( image.bytesPerPixel == 1 )
       {
-         bytesRead = esFileRead ( fp, bytesToRead, buffer );
-         esFileClose ( fp );
+         memcpy ( dst, src, image.width );
+         continue;
+      }
+
+      for ( x = 0; x < image.width; x++, dst += outSize )
+      {
+         if ( image.bytesPerPixel == 2 )
+         {
+            unsigned int value = ( ( const GLushort * ) src ) [x];
+            unsigned int r = ( value >> 11 ) & 0x1f, g = ( value >> 6 ) & 0x1f, b = ( value >> 1 ) & 0x1f;
+
+            dst[0] = ( unsigned char ) ( r << 3 | r >> 2 );
+            dst[1] = ( unsigned char ) ( g << 3 | g >> 2 );
+            dst[2] = ( unsigned char ) ( b << 3 | b >> 2 );
+         }
+         else
+         {
+            // BGR(A) to RGB(A)
+            dst[0] = src[x * outSize + 2];
+            dst[1] = src[x * outSize + 1];
+            dst[2] = src[x * outSize];
 
-         return ( buffer );
+            if ( outSize == 4 )
+            {
+               dst[3] = src[x * outSize + 3];
+            }
+         }
       }
    }
 
-   return ( NULL );
+   esFreeTGA ( &image );
+   return buffer;
 }
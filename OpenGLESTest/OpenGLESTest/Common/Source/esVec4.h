@@ -0,0 +1,458 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esVec4.h
+//
+//    Four floats at a time with SSE2, NEON or plain C, private to the
+//    source files of the Common library.  Every path does the same
+//    operations in the same order without fused multiply-adds, so they
+//    give the same bits, apart from the refined estimates 32-bit NEON
+//    takes for esVecDiv and esVecSqrt.
+
+#ifndef ESVEC4_H
+#define ESVEC4_H
+
+///
+//  Includes
+//
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define ES_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ES_NEON
+#include <arm_neon.h>
+#endif
+
+///
+//  Macros
+//
+
+/// Helpers a file doesn't call are dropped without a warning
+#ifdef _MSC_VER
+#define ES_INLINE __inline
+#else
+#define ES_INLINE inline
+#endif
+
+///
+//  Functions
+//
+#if defined(ES_SSE2)
+typedef __m128 ESVec4;
+
+static ES_INLINE ESVec4 esVecSet ( float a )
+{
+   return _mm_set1_ps ( a );
+}
+
+static ES_INLINE ESVec4 esVecStep ( float first, float step )
+{
+   return _mm_add_ps ( _mm_set1_ps ( first ), _mm_mul_ps ( _mm_set_ps ( 3.0f, 2.0f, 1.0f, 0.0f ), _mm_set1_ps ( step ) ) );
+}
+
+static ES_INLINE ESVec4 esVecAdd ( ESVec4 a, ESVec4 b )
+{
+   return _mm_add_ps ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecSub ( ESVec4 a, ESVec4 b )
+{
+   return _mm_sub_ps ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecMul ( ESVec4 a, ESVec4 b )
+{
+   return _mm_mul_ps ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecDiv ( ESVec4 a, ESVec4 b )
+{
+   return _mm_div_ps ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecMin ( ESVec4 a, ESVec4 b )
+{
+   return _mm_min_ps ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecMax ( ESVec4 a, ESVec4 b )
+{
+   return _mm_max_ps ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecLoad ( const float *a )
+{
+   return _mm_loadu_ps ( a );
+}
+
+static ES_INLINE void esVecStore ( float *a, ESVec4 b )
+{
+   _mm_storeu_ps ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecSqrt ( ESVec4 a )
+{
+   return _mm_sqrt_ps ( a );
+}
+
+static ES_INLINE void esVecQuantize ( ESVec4 a, int q[4] )
+{
+   // NaN goes to 0 on the max
+   a = _mm_min_ps ( _mm_max_ps ( a, _mm_setzero_ps () ), _mm_set1_ps ( 1.0f ) );
+   _mm_storeu_si128 ( ( __m128i * ) q, _mm_cvttps_epi32 ( _mm_add_ps ( _mm_mul_ps ( a, _mm_set1_ps ( 255.0f ) ),
+                      _mm_set1_ps ( 0.5f ) ) ) );
+}
+
+// Lane j of r[i] becomes lane i of r[j]
+static ES_INLINE void esVecTranspose ( ESVec4 r[4] )
+{
+   _MM_TRANSPOSE4_PS ( r[0], r[1], r[2], r[3] );
+}
+
+// A store past the caches when a is 16 byte aligned, for memory that is
+// written once and not read back, such as a mapped buffer object
+static ES_INLINE void esVecStream ( float *a, ESVec4 b )
+{
+   if ( ( ( size_t ) a & 15 ) == 0 )
+   {
+      _mm_stream_ps ( a, b );
+   }
+   else
+   {
+      _mm_storeu_ps ( a, b );
+   }
+}
+
+// Orders the streamed stores before anything written after
+static ES_INLINE void esVecFence ( void )
+{
+   _mm_sfence ();
+}
+
+// Bit i set when lane i is 0 or more
+static ES_INLINE int esVecNonNegativeMask ( ESVec4 a )
+{
+   return _mm_movemask_ps ( _mm_cmpge_ps ( a, _mm_setzero_ps () ) );
+}
+#elif defined(ES_NEON)
+typedef float32x4_t ESVec4;
+
+static ES_INLINE ESVec4 esVecSet ( float a )
+{
+   return vdupq_n_f32 ( a );
+}
+
+static ES_INLINE ESVec4 esVecStep ( float first, float step )
+{
+   static const float lanes[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+
+   return vmlaq_n_f32 ( vdupq_n_f32 ( first ), vld1q_f32 ( lanes ), step );
+}
+
+static ES_INLINE ESVec4 esVecAdd ( ESVec4 a, ESVec4 b )
+{
+   return vaddq_f32 ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecSub ( ESVec4 a, ESVec4 b )
+{
+   return vsubq_f32 ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecMul ( ESVec4 a, ESVec4 b )
+{
+   return vmulq_f32 ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecDiv ( ESVec4 a, ESVec4 b )
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+   return vdivq_f32 ( a, b );
+#else
+   // two Newton-Raphson steps on the reciprocal estimate
+   ESVec4 r = vrecpeq_f32 ( b );
+
+   r = vmulq_f32 ( r, vrecpsq_f32 ( b, r ) );
+   r = vmulq_f32 ( r, vrecpsq_f32 ( b, r ) );
+   return vmulq_f32 ( a, r );
+#endif
+}
+
+static ES_INLINE ESVec4 esVecMin ( ESVec4 a, ESVec4 b )
+{
+   return vminq_f32 ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecMax ( ESVec4 a, ESVec4 b )
+{
+   return vmaxq_f32 ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecLoad ( const float *a )
+{
+   return vld1q_f32 ( a );
+}
+
+static ES_INLINE void esVecStore ( float *a, ESVec4 b )
+{
+   vst1q_f32 ( a, b );
+}
+
+static ES_INLINE ESVec4 esVecSqrt ( ESVec4 a )
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+   return vsqrtq_f32 ( a );
+#else
+   // no square root on 32-bit NEON, a * 1 / sqrt ( a ) refined twice, 0 stays 0
+   float32x4_t r = vrsqrteq_f32 ( vmaxq_f32 ( a, vdupq_n_f32 ( 1e-30f ) ) );
+
+   r = vmulq_f32 ( r, vrsqrtsq_f32 ( vmulq_f32 ( a, r ), r ) );
+   r = vmulq_f32 ( r, vrsqrtsq_f32 ( vmulq_f32 ( a, r ), r ) );
+   return vmulq_f32 ( a, r );
+#endif
+}
+
+static ES_INLINE void esVecQuantize ( ESVec4 a, int q[4] )
+{
+   a = vminq_f32 ( vmaxq_f32 ( a, vdupq_n_f32 ( 0.0f ) ), vdupq_n_f32 ( 1.0f ) );
+   vst1q_s32 ( q, vcvtq_s32_f32 ( vmlaq_n_f32 ( vdupq_n_f32 ( 0.5f ), a, 255.0f ) ) );
+}
+
+// Lane j of r[i] becomes lane i of r[j]
+static ES_INLINE void esVecTranspose ( ESVec4 r[4] )
+{
+   float32x4x2_t r01 = vtrnq_f32 ( r[0], r[1] );
+   float32x4x2_t r23 = vtrnq_f32 ( r[2], r[3] );
+
+   r[0] = vcombine_f32 ( vget_low_f32 ( r01.val[0] ), vget_low_f32 ( r23.val[0] ) );
+   r[1] = vcombine_f32 ( vget_low_f32 ( r01.val[1] ), vget_low_f32 ( r23.val[1] ) );
+   r[2] = vcombine_f32 ( vget_high_f32 ( r01.val[0] ), vget_high_f32 ( r23.val[0] ) );
+   r[3] = vcombine_f32 ( vget_high_f32 ( r01.val[1] ), vget_high_f32 ( r23.val[1] ) );
+}
+
+static ES_INLINE void esVecStream ( float *a, ESVec4 b )
+{
+   vst1q_f32 ( a, b );
+}
+
+static ES_INLINE void esVecFence ( void )
+{
+}
+
+// Bit i set when lane i is 0 or more
+static ES_INLINE int esVecNonNegativeMask ( ESVec4 a )
+{
+   static const uint32_t bits[4] = { 1, 2, 4, 8 };
+   uint32x4_t m = vandq_u32 ( vcgeq_f32 ( a, vdupq_n_f32 ( 0.0f ) ), vld1q_u32 ( bits ) );
+   uint32x2_t sum = vadd_u32 ( vget_low_u32 ( m ), vget_high_u32 ( m ) );
+
+   return ( int ) vget_lane_u32 ( vpadd_u32 ( sum, sum ), 0 );
+}
+#else
+typedef struct
+{
+   float v[4];
+} ESVec4;
+
+static ES_INLINE ESVec4 esVecSet ( float a )
+{
+   ESVec4 r;
+
+   r.v[0] = r.v[1] = r.v[2] = r.v[3] = a;
+   return r;
+}
+
+static ES_INLINE ESVec4 esVecStep ( float first, float step )
+{
+   ESVec4 r;
+   int    i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      r.v[i] = first + i * step;
+   }
+
+   return r;
+}
+
+static ES_INLINE ESVec4 esVecAdd ( ESVec4 a, ESVec4 b )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      a.v[i] += b.v[i];
+   }
+
+   return a;
+}
+
+static ES_INLINE ESVec4 esVecSub ( ESVec4 a, ESVec4 b )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      a.v[i] -= b.v[i];
+   }
+
+   return a;
+}
+
+static ES_INLINE ESVec4 esVecMul ( ESVec4 a, ESVec4 b )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      a.v[i] *= b.v[i];
+   }
+
+   return a;
+}
+
+static ES_INLINE ESVec4 esVecDiv ( ESVec4 a, ESVec4 b )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      a.v[i] /= b.v[i];
+   }
+
+   return a;
+}
+
+static ES_INLINE ESVec4 esVecMin ( ESVec4 a, ESVec4 b )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      a.v[i] = b.v[i] < a.v[i] ? b.v[i] : a.v[i];
+   }
+
+   return a;
+}
+
+static ES_INLINE ESVec4 esVecMax ( ESVec4 a, ESVec4 b )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      a.v[i] = b.v[i] > a.v[i] ? b.v[i] : a.v[i];
+   }
+
+   return a;
+}
+
+static ES_INLINE ESVec4 esVecLoad ( const float *a )
+{
+   ESVec4 r;
+
+   memcpy ( r.v, a, sizeof ( r.v ) );
+   return r;
+}
+
+static ES_INLINE void esVecStore ( float *a, ESVec4 b )
+{
+   memcpy ( a, b.v, sizeof ( b.v ) );
+}
+
+static ES_INLINE ESVec4 esVecSqrt ( ESVec4 a )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      a.v[i] = sqrtf ( a.v[i] );
+   }
+
+   return a;
+}
+
+static ES_INLINE void esVecQuantize ( ESVec4 a, int q[4] )
+{
+   int i;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      float value = a.v[i] > 0.0f ? a.v[i] : 0.0f;
+
+      q[i] = ( int ) ( ( value < 1.0f ? value : 1.0f ) * 255.0f + 0.5f );
+   }
+}
+
+// Lane j of r[i] becomes lane i of r[j]
+static ES_INLINE void esVecTranspose ( ESVec4 r[4] )
+{
+   int   i, j;
+   float t;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      for ( j = i + 1; j < 4; j++ )
+      {
+         t = r[i].v[j];
+         r[i].v[j] = r[j].v[i];
+         r[j].v[i] = t;
+      }
+   }
+}
+
+static ES_INLINE void esVecStream ( float *a, ESVec4 b )
+{
+   memcpy ( a, b.v, sizeof ( b.v ) );
+}
+
+static ES_INLINE void esVecFence ( void )
+{
+}
+
+// Bit i set when lane i is 0 or more
+static ES_INLINE int esVecNonNegativeMask ( ESVec4 a )
+{
+   int i, mask = 0;
+
+   for ( i = 0; i < 4; i++ )
+   {
+      mask |= ( a.v[i] >= 0.0f ) << i;
+   }
+
+   return mask;
+}
+#endif
+
+#endif // ESVEC4_H
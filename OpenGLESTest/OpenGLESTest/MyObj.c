@@ -42,6 +42,7 @@
 #include <math.h>
 #include "esUtil.h"
 #include "myUtil.h"
+#include "myMesh.h"
 
 #define PI 3.14159265
 
@@ -69,10 +70,7 @@ struct
 	int* face_counts; // [3,3,3,3,3,4,4,4,4,3...]
 	int updated_face_num;
 
-	GLfloat** vArr; //ŵĶά
-	GLfloat** vnArr; //ŷߵĶά
-	int** fvArr; //涥Ķά
-	int** fnArr; //淨ߵĶά
+	MeshData mesh; // contiguous streams of the model, all in one arena allocation (myMesh.c)
 
 	GLfloat* vertices; 
 	GLuint* indices;
@@ -141,231 +139,22 @@ GLuint LoadShader(GLenum type, const char* shaderSrc)
 
 }
 
-void getDataNum(const char* filename, int* v_num, int* vt_num, int* vn_num, int* f_num)
-{
-	char line[1024];
-	FILE* file;
-
-	file = fopen(filename, "r");
-	if (file == NULL)
-	{
-		printf("file cannot open \n");
-	}
-	while (!feof(file))
-	{
-		for (int i = 0; i < 1024; i++)
-			line[i] = 0;
-		fgets(line, 1024, file);
-
-		// process file, consider the format is correct
-		// (not including empty line and so on)
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				ObjData.vn_num++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-				ObjData.vt_num++;
-			}
-			else							// v
-			{
-				ObjData.v_num++;
-			}
-		}
-		else if (line[0] == 'f')
-		{
-			ObjData.f_num++;
-		}
-	}
-	fclose(file);
-}
-
+// load filename with LoadObjMesh (myMesh.c), which reads the file once
+// and keeps positions, texcoords, normals and faces as flat arrays in a single allocation
 int LoadDataFromFile(const char* filename)
 {
-	char line[1024];
-	FILE* file;
-
-	// allocate memory to all arrays
-	ObjData.vArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.v_num);
-	for (int i = 0; i < ObjData.v_num; i++)
-	{
-		ObjData.vArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.vnArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.vn_num);
-	for (int i = 0; i < ObjData.vn_num; i++)
-	{
-		ObjData.vnArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.fvArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	ObjData.fnArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	for (int i = 0; i < ObjData.f_num; i++)
-	{
-		// for the "f" part of ailian.obj, the max num of vertex an f contain is 4
-		ObjData.fvArr[i] = (int*)malloc(sizeof(int) * 4);
-		ObjData.fnArr[i] = (int*)malloc(sizeof(int) * 4);
-	}
-
-	file = fopen(filename, "r");
-	if (file == NULL)
-	{
-		printf("file cannot open \n");
-	}
-
-	// store data to arrays
-	int vnRow = 0, vRow = 0, fRow = 0;
-	while (!feof(file))
-	{
-		fgets(line, 1024, file);
-
-		char* token = NULL;
-		char* next_token = NULL;
-		token = strtok_s(line, " ", &next_token);
-		int count = 0;
-
-		
-
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				printf("vn:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						// filter the first token
-						ObjData.vnArr[vnRow][count - 1] = atof(token);
-						printf("%f\n", ObjData.vnArr[vnRow][count - 1]);
-					}
-					printf("\n");
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-				}
-				printf("\n");
-				vnRow++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-
-			}
-			else							// v
-			{
-				printf("v:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						ObjData.vArr[vRow][count - 1] = atof(token);
-						printf("%f\n", ObjData.vArr[vRow][count - 1]);
-					}
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-					printf("\n");
-				}
-				vRow++;
-			}
-		}
-		else if (line[0] == 'f') // fv, fn
-		{
-			// ["3/13/5", "4/14/6", "5/15/7" or "1/3" or "160//12"]
-			
-			while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-			{
-				int face_count = 0; // 0--"3" 1--"13" 2--"5"
-				if (count > 0)
-				{
-					char* face_token = NULL;
-					char* face_next_token = NULL;
-					face_token = strtok_s(token, "/", &face_next_token);
-
-					while (face_token != NULL)
-					{
-						if (face_count == 0) // fvArr
-						{
-							ObjData.fvArr[fRow][count - 1] = atoi(face_token);
-							//printf("%s\n", face_token);
-							printf("%d\n", ObjData.fvArr[fRow][count - 1]);
-						} 
-						else if (face_count == 1) // ftArr
-						{
-
-						}
-						else if (face_count == 2) // fnArr
-						{
-
-						}
-
-						//printf("%s\n", face_token);
-						face_token = strtok_s(NULL, "/", &face_next_token);
-						face_count++;
-					}
-				}
-				token = strtok_s(NULL, " ", &next_token);
-				count++;
-				printf("\n");
-			}
-
-			ObjData.face_counts[fRow] = count - 1;
-			fRow++;
-		}
-		printf("count: %d\n\n\n", count);
-	}
-	
-	fclose(file);
-
-	return 0;
-}
-
-// [[0.5, 0.5, 0.5], [-0.5, 0.5, 0.5]...] --> [0.5, 0.5, 0.5, -0.5, 0.5, 0.5...]
-void transVArr(const GLfloat** source, GLfloat* ret)
-{
-	for (int i = 0; i < ObjData.v_num; i++)
+	if (!LoadObjMesh(filename, &ObjData.mesh))
 	{
-		for (int j = 0; j < 3; j++)
-		{
-			ret[i * 3 + j] = source[i][j];
-		}
+		return FALSE;
 	}
-}
 
-// [[7,1,5,N],     [7,1,5,
-//  [5,1,3,7], -->  5,1,3, 5,3,7,
-//  [4,8,6,N]]      4,8,6]
-void transFvArr(const int** source, GLuint* ret)
-{
-	int row = 0;
-	int capacity = ObjData.face_counts[row];
-	int ret_index = 0;
+	ObjData.v_num = ObjData.mesh.v_num;
+	ObjData.vt_num = ObjData.mesh.vt_num;
+	ObjData.vn_num = ObjData.mesh.vn_num;
+	ObjData.f_num = ObjData.mesh.f_num;
+	ObjData.face_counts = ObjData.mesh.face_counts;
 
-	// ret_index < 3 * ObjData.updated_face_num
-	for (; row < ObjData.f_num; row++, capacity += ObjData.face_counts[row])
-	{
-		if (ObjData.face_counts[row] == 3) // [7,1,5,N]
-		{
-			for (int i = 0; i < 3; i++, ret_index++)
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-		}
-		else if (ObjData.face_counts[row] == 4) // [5,1,3,7] --> [5,1,3, 5,3,7]
-		{
-			for (int i = 0; i < 3; i++, ret_index++) // [5,1,3]
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-			// [5,3,7]
-			ret[ret_index] = source[row][0] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][2] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][3] - 1;
-			ret_index++;
-		}
-	}
+	return TRUE;
 }
 
 ///
@@ -375,17 +164,15 @@ int Init(ESContext* esContext)
 {
 	// init ObjData
 	const char* filename = "bear.obj";
-	getDataNum(filename, ObjData.v_num, ObjData.vt_num, ObjData.vn_num, ObjData.f_num);
-	ObjData.vertices = malloc(sizeof(GLfloat) * 3 * ObjData.v_num);
-	
-	ObjData.face_counts = malloc(sizeof(int) * ObjData.f_num);
-
-	LoadDataFromFile(filename);
+	if (!LoadDataFromFile(filename))
+	{
+		return FALSE;
+	}
+	ObjData.vertices = ObjData.mesh.positions; // already [x0, y0, z0, x1, y1, z1...]
 	ObjData.updated_face_num = updatedFaceNum(ObjData.face_counts, ObjData.f_num);
 	ObjData.indices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
 
-	transVArr(ObjData.vArr, ObjData.vertices);
-	transFvArr(ObjData.fvArr, ObjData.indices);
+	TransFArr(&ObjData.mesh, ObjData.mesh.fvIndices, ObjData.indices);
 
 	
 
@@ -42,6 +42,7 @@
 #include <math.h>
 #include "esUtil.h"
 #include "myUtil.h"
+#include "myMeshCache.h"
 
 #define PI 3.14159265
 
@@ -61,37 +62,17 @@ typedef struct
 	// Sampler locations
 	GLint ailianMapLoc;
 
-	// Texture handle
-	GLuint ailianMapTexId;
-	GLuint floorMapTexId;
+	// Texture handle, the model texture and the floor color share one atlas
+	GLuint atlasTexId;
+
+	// floor texture coordinates, moved into the region of the floor in the atlas
+	GLfloat floorTexCoords[6 * 2];
 
 } UserData;
 
 struct
 {
-	int v_num;
-	int vt_num;
-	int vn_num;
-	int f_num;
-	int* face_counts; // [3,3,3,3,3,4,4,4,4,3...]
-	int updated_face_num;
-
-	GLfloat** vArr; //ŵĶά
-	GLfloat** vtArr; //Ķά
-	GLfloat** vnArr; //ŷߵĶά
-	int** fvArr; //涥Ķά
-	int** ftArr; //Ķά
-	int** fnArr; //淨ߵĶά
-
-	GLfloat* vertices;
-	GLuint* indices;
-
-	GLfloat* updatedVertices;
-	GLfloat* texCoords;
-	GLuint* texIndices;
-
-	GLfloat* updatedTexCoords;
-	GLfloat* updatedAgainVertices;
+	IndexedMesh welded; // unique (v, vt) vertices and the index buffer drawing them, mapped from the .mesh cache when possible
 
 	GLfloat* midbot;
 } ObjData;
@@ -160,276 +141,90 @@ GLuint LoadShader(GLenum type, const char* shaderSrc)
 
 }
 
-void GetDataNum(const char* filename, int* v_num, int* vt_num, int* vn_num, int* f_num)
+// load filename with LoadCachedMesh (myMeshCache.c): the welded, optimized model is mapped from the
+// .mesh file next to filename when that is up to date, otherwise filename is parsed and the .mesh written
+int LoadDataFromFile(const char* filename)
 {
-	char line[1024];
-	FILE* file;
-
-	file = fopen(filename, "r");
-	if (file == NULL)
+	if (!LoadCachedMesh(filename, MESH_ATTRIB_TEXCOORD, &ObjData.welded))
 	{
-		printf("file cannot open \n");
+		return FALSE;
 	}
-	while (!feof(file))
-	{
-		for (int i = 0; i < 1024; i++)
-			line[i] = 0;
-
-		fgets(line, 1024, file);
+	PrintWeldStats(filename, &ObjData.welded);
 
-		// process file, consider the format is correct
-		// (not including empty line and so on)
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				ObjData.vn_num++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-				ObjData.vt_num++;
-			}
-			else							// v
-			{
-				ObjData.v_num++;
-			}
-		}
-		else if (line[0] == 'f')
-		{
-			ObjData.f_num++;
-		}
-	}
-	fclose(file);
+	return TRUE;
 }
 
-int LoadDataFromFile(const char* filename)
+// pack the model texture and the floor color into one atlas (esBuildAtlas), so a frame binds a
+// single texture, and move the texture coordinates of both into their regions
+int LoadAtlas(ESContext* esContext, const char* modelTexture)
 {
-	char line[1024];
-	FILE* file;
-
-	// allocate memory to all arrays
-	ObjData.vArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.v_num);
-	for (int i = 0; i < ObjData.v_num; i++)
-	{
-		ObjData.vArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.vtArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.vt_num);
-	for (int i = 0; i < ObjData.vt_num; i++)
-	{
-		ObjData.vtArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 2); // ignore the third value of vt
-	}
-	ObjData.texCoords = (GLfloat *)malloc(sizeof(GLfloat) * 2 * ObjData.vt_num);
+	UserData* userData = esContext->userData;
 
-	ObjData.vnArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.vn_num);
-	for (int i = 0; i < ObjData.vn_num; i++)
+	// the color of CreateSimpleTexture2D, 2x2 BGR pixels like a 24-bit TGA
+	static const unsigned char floorPixels[4 * 3] =
 	{
-		ObjData.vnArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.fvArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	ObjData.ftArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	ObjData.fnArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	for (int i = 0; i < ObjData.f_num; i++)
+		230,240,250,
+		230,240,250,
+		230,240,250,
+		230,240,250,
+	};
+	static const GLfloat floorTexCoords[6 * 2] =
 	{
-		// for the "f" part of ailian.obj, the max num of vertex an f contain is 4
-		ObjData.fvArr[i] = (int*)malloc(sizeof(int) * 4);
-		ObjData.ftArr[i] = (int*)malloc(sizeof(int) * 4);
-		ObjData.fnArr[i] = (int*)malloc(sizeof(int) * 4);
-	}
+		1.0f, 0.0f,
+		0.0f, 0.0f,
+		0.0f, 1.0f,
 
-	file = fopen(filename, "r");
-	if (file == NULL)
-	{
-		printf("file cannot open \n");
-	}
+		1.0f, 0.0f,
+		0.0f, 1.0f,
+		1.0f, 1.0f
+	};
+	ESImage images[2];
+	ESAtlas atlas;
+	GLint maxSize;
 
-	// store data to arrays
-	int vnRow = 0, vtRow = 0, vRow = 0, fRow = 0;
-	int vtIndex = 0;
-	while (!feof(file))
+	memset(images, 0, sizeof(images));
+	if (!esMapTGA(esContext->platformData, modelTexture, &images[0]))
 	{
-		fgets(line, 1024, file);
-
-		char* token = NULL;
-		char* next_token = NULL;
-		token = strtok_s(line, " ", &next_token);
-		int count = 0;
-
-
-
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				//printf("vn:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						// filter the first token
-						ObjData.vnArr[vnRow][count - 1] = atof(token);
-						//printf("%f\n", ObjData.vnArr[vnRow][count - 1]);
-					}
-					//printf("\n");
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-				}
-				//printf("\n");
-				vnRow++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-				// sometimes vt has three value, we ignore the third in this case
-				// [ 0.01992, 0.01992,
-				//   0.998,   0.998,
-				//   ...              ]
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0 && count < 3)
-					{
-						// filter the first token and ignore the third value of vt
-						ObjData.texCoords[vtIndex] = atof(token);
-						ObjData.vtArr[vtRow][count - 1] = atof(token);
-						vtIndex++;
-						//printf("%f\n", ObjData.vnArr[vnRow][count - 1]);
-					}
-					//printf("\n");
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-				}
-				vtRow++;
-			}
-			else							// v
-			{
-				//printf("v:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						ObjData.vArr[vRow][count - 1] = atof(token);
-						//printf("%f\n", ObjData.vArr[vRow][count - 1]);
-					}
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-					//printf("\n");
-				}
-				vRow++;
-			}
-		}
-		else if (line[0] == 'f') // fv, fn
-		{
-			// ["3/13/5", "4/14/6", "5/15/7" or "1/3" or "160//12"]
-
-			while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-			{
-				int face_count = 0; // 0--"3" 1--"13" 2--"5"
-				if (count > 0)
-				{
-					char* face_token = NULL;
-					char* face_next_token = NULL;
-					face_token = strtok_s(token, "/", &face_next_token);
-
-					while (face_token != NULL)
-					{
-						if (face_count == 0) // fvArr
-						{
-							ObjData.fvArr[fRow][count - 1] = atoi(face_token);
-							//printf("%d\n", ObjData.fvArr[fRow][count - 1]);
-						}
-						else if (face_count == 1) // ftArr
-						{
-							ObjData.ftArr[fRow][count - 1] = atoi(face_token);
-						}
-						else if (face_count == 2) // fnArr
-						{
-
-						}
-
-						face_token = strtok_s(NULL, "/", &face_next_token);
-						face_count++;
-					}
-				}
-				token = strtok_s(NULL, " ", &next_token);
-				count++;
-				printf("\n");
-			}
-
-			ObjData.face_counts[fRow] = count - 1;
-			fRow++;
-		}
-		//printf("count: %d\n\n\n", count);
+		esLogMessage("Error loading (%s) image.\n", modelTexture);
+		return FALSE;
 	}
-
-	fclose(file);
-
-	return 0;
-}
-
-// [[0.5, 0.5, 0.5], [-0.5, 0.5, 0.5]...] --> [0.5, 0.5, 0.5, -0.5, 0.5, 0.5...]
-void TransVArr(const GLfloat** source, GLfloat* ret)
-{
-	for (int i = 0; i < ObjData.v_num; i++)
+	images[1].width = 2;
+	images[1].height = 2;
+	images[1].bytesPerPixel = 3;
+	images[1].pixels = floorPixels;
+
+	// bilinear filtering only, like LoadTexture
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (!esBuildAtlas(&atlas, images, 2, maxSize, 1, GL_FALSE))
 	{
-		for (int j = 0; j < 3; j++)
-		{
-			ret[i * 3 + j] = source[i][j];
-		}
+		esFreeTGA(&images[0]);
+		return FALSE;
 	}
-}
-
-// [[7,1,5,N],     [7,1,5,
-//  [5,1,3,7], -->  5,1,3, 5,3,7,
-//  [4,8,6,N]]      4,8,6]
-void TransFArr(const int** source, GLuint* ret)
-{
-	int row = 0;
-	int capacity = ObjData.face_counts[row];
-	int ret_index = 0;
-
-	// ret_index < 3 * ObjData.updated_face_num
-	for (; row < ObjData.f_num; row++, capacity += ObjData.face_counts[row])
+	esFreeTGA(&images[0]);
+	printf("atlas: %d images in %dx%d, %.1f%% of it used\n", atlas.regionCount, atlas.width, atlas.height,
+		100.0f * atlas.efficiency);
+
+	glGenTextures(1, &userData->atlasTexId);
+	glBindTexture(GL_TEXTURE_2D, userData->atlasTexId);
+	esTexImageAtlas(GL_TEXTURE_2D, &atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	memcpy(userData->floorTexCoords, floorTexCoords, sizeof(floorTexCoords));
+	RemapTexCoords(userData->floorTexCoords, 6, 2, &atlas.regions[1]);
+	if (!RemapMeshTexCoords(&ObjData.welded, &atlas.regions[0]))
 	{
-		if (ObjData.face_counts[row] == 3) // [7,1,5,N]
-		{
-			for (int i = 0; i < 3; i++, ret_index++)
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-		}
-		else if (ObjData.face_counts[row] == 4) // [5,1,3,7] --> [5,1,3, 5,3,7]
-		{
-			for (int i = 0; i < 3; i++, ret_index++) // [5,1,3]
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-			// [5,3,7]
-			ret[ret_index] = source[row][0] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][2] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][3] - 1;
-			ret_index++;
-		}
+		esFreeAtlas(&atlas);
+		return FALSE;
 	}
-}
-
 
-void UpdateVertices(GLfloat* ret)
-{
-	for (int i = 0; i < 3 * ObjData.updated_face_num; i++)
-	{
-		for (int j = 0; j < 3; j++)
-		{
-			ret[ObjData.texIndices[i] * 3 + j] = ObjData.vertices[ObjData.indices[i] * 3 + j];
-		}
-	}
+	esFreeAtlas(&atlas);
+	return TRUE;
 }
 
 
-
-
-
 ///
 // Initialize the shader and program object
 //
@@ -438,50 +233,20 @@ int Init(ESContext* esContext)
 	// init ObjData
 
 	const char* filename = "bear.obj";
-	GetDataNum(filename, ObjData.v_num, ObjData.vt_num, ObjData.vn_num, ObjData.f_num);
-	ObjData.vertices = malloc(sizeof(GLfloat) * 3 * ObjData.v_num);
-
-	ObjData.face_counts = malloc(sizeof(int) * ObjData.f_num);
-
-	LoadDataFromFile(filename);
-	ObjData.updated_face_num = updatedFaceNum(ObjData.face_counts, ObjData.f_num);
-	
-	ObjData.indices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
-
-	TransVArr(ObjData.vArr, ObjData.vertices);
-	TransFArr(ObjData.fvArr, ObjData.indices);
-	
-
-	ObjData.texIndices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
-	ObjData.updatedVertices = malloc(sizeof(GLfloat) * 3 * ObjData.vt_num);
-	TransFArr(ObjData.ftArr, ObjData.texIndices);
-	UpdateVertices(ObjData.updatedVertices);
-
-
-	ObjData.updatedAgainVertices = malloc(sizeof(GLfloat) * 3 * 3 * ObjData.updated_face_num); // three float num makes a vertex, three vertices make a face
-	ObjData.updatedTexCoords = malloc(sizeof(int) * 2 * 3 * ObjData.updated_face_num); // two float num makes a texcoord, three texcoords make a face
-
-	for (int i = 0; i < ObjData.updated_face_num * 3; i++)
+	if (!LoadDataFromFile(filename))
 	{
-		for (int j = 0; j < 3; j++)
-		{
-			ObjData.updatedAgainVertices[i * 3 + j] = ObjData.vArr[ObjData.indices[i]][j];
-		}
-		for (int j = 0; j < 2; j++)
-		{
-			ObjData.updatedTexCoords[i * 2 + j] = ObjData.vtArr[ObjData.texIndices[i]][j];
-		}
+		return FALSE;
 	}
 
 	ObjData.midbot = malloc(sizeof(GLfloat) * 3);
-	GetMidBotPosition(ObjData.vArr, ObjData.v_num, ObjData.midbot);
+	MeshMidBotPosition(&ObjData.welded, ObjData.midbot);
 
 	// print out data for testing
-	/*for (int i = 0; i < 3 * ObjData.updated_face_num; i++)
+	/*for (int i = 0; i < ObjData.welded.vertex_num; i++)
 	{
-		for (int j = 0; j < 3; j++)
+		for (int j = 0; j < ObjData.welded.stride; j++)
 		{
-			printf("%f\t", ObjData.updatedAgainVertices[i * 3 + j]);
+			printf("%f\t", ObjData.welded.vertices[i * ObjData.welded.stride + j]);
 		}
 		printf("\n");
 	}*/
@@ -594,9 +359,7 @@ int Init(ESContext* esContext)
 
 	userData->ailianMapLoc = glGetUniformLocation(userData->programObject, "s_ailianMap");
 
-	userData->ailianMapTexId = LoadTexture(esContext->platformData, "bear.tga");
-
-	if (userData->ailianMapTexId == 0)
+	if (!LoadAtlas(esContext, "bear.tga"))
 	{
 		return FALSE;
 	}
@@ -653,28 +416,10 @@ void DrawFloor(ESContext* esContext, const GLfloat* origin, const GLfloat length
 		originX - length,	originY,	originZ + length,
 		originX + length,	originY,	originZ + length
 	};
-	GLfloat groundTexCoords[4 * 2] =
-	{
-		0.0f, 0.0f,
-		1.0f, 0.0f,
-		0.0f, 1.0f,
-		1.0f, 1.0f
-	};
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, floorVertices);
 
-	userData->floorMapTexId = CreateSimpleTexture2D();
-
-	if (userData->floorMapTexId == 0)
-	{
-		return FALSE;
-	}
-
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, groundTexCoords);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, userData->floorMapTexId);
-
-	glUniform1i(userData->ailianMapLoc, 1);
+	// the atlas bound for the model holds the floor too
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, userData->floorTexCoords);
 
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 }
@@ -698,28 +443,26 @@ void Draw(ESContext* esContext)
 	// Load the vertex data
 
 	// corresponding relation
-	// updatedVertices -- texCoords -- texIndices
-	// updatedAgainVertices -- updatedTexCoords -- glDrawArrays
+	// welded.vertices [px, py, pz, s, t, ...] -- welded.indices -- glDrawElements
 
 
 	// draw model
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, ObjData.updatedAgainVertices);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * ObjData.welded.stride, ObjData.welded.vertices);
 	glEnableVertexAttribArray(0);
 
 	glUniformMatrix4fv(userData->mvpLoc, 1, GL_FALSE, (GLfloat*)& CameraData.mvpMatrix.m[0][0]);
 
 	// stick texture on ailian
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, ObjData.updatedTexCoords);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * ObjData.welded.stride,
+		ObjData.welded.vertices + ObjData.welded.texcoord_offset);
 	glEnableVertexAttribArray(1);
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, userData->ailianMapTexId);
+	glBindTexture(GL_TEXTURE_2D, userData->atlasTexId);
 
 	glUniform1i(userData->ailianMapLoc, 0);
 
-	//glDrawElements(GL_TRIANGLES, 3 * ObjData.updated_face_num, GL_UNSIGNED_INT, ObjData.texIndices);
-
-	glDrawArrays(GL_TRIANGLES, 0, 3 * ObjData.updated_face_num);
+	glDrawElements(GL_TRIANGLES, ObjData.welded.index_num, ObjData.welded.index_type, ObjData.welded.indices);
 
 	// draw floor
 	DrawFloor(esContext, ObjData.midbot, 4.0f);
@@ -729,6 +472,8 @@ void Shutdown(ESContext* esContext)
 {
 	UserData* userData = esContext->userData;
 
+	glDeleteTextures(1, &userData->atlasTexId);
+
 	glDeleteProgram(userData->programObject);
 }
 
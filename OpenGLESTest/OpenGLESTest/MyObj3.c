@@ -42,9 +42,17 @@
 #include <math.h>
 #include "esUtil.h"
 #include "myUtil.h"
+#include "myMeshCache.h"
+#include "myMeshlet.h"
+#include "myScene.h"
 
 #define PI 3.14159265
 
+// what the passes cull, in the order of their bounding spheres
+#define MODEL 0
+#define FLOOR 1
+#define NUM_OBJECTS 2
+
 
 
 typedef struct
@@ -78,12 +86,27 @@ typedef struct
 	GLuint ailianMapTexId;
 	GLuint floorMapTexId;
 
-	// MVP matrices
-	ESMatrix  groundMvpMatrix;
-	ESMatrix  groundMvpLightMatrix;
+	// the ground, the model standing on it and where the model casts its shadow from, see InitMVP
+	Scene scene;
+	int groundNode;
+	int modelNode;
+	int shadowNode;
+	SceneView lightView;
+
+	// MVP matrices, recomputed only when their node or view moved
+	SceneMVP  groundMvp;
+	SceneMVP  groundMvpLight;
 	GLfloat* floorVertices;
 
-	ESMatrix  mvpLightMatrix; // for depth texture of model
+	SceneMVP  mvpLight; // for depth texture of model
+	MeshletView lightMeshletView; // clusters of the model in the shadow map
+
+	// bounds of the model from the OBJ and of the floor, and the world spheres of both in each pass:
+	// center x, y, z and radius
+	ESBounds modelBounds;
+	ESBounds floorBounds;
+	GLfloat  sceneSpheres[4][NUM_OBJECTS];
+	GLfloat  lightSpheres[4][NUM_OBJECTS];
 
 
 	float lightPosition[3];
@@ -91,29 +114,8 @@ typedef struct
 
 struct
 {
-	int v_num;
-	int vt_num;
-	int vn_num;
-	int f_num;
-	int* face_counts; // [3,3,3,3,3,4,4,4,4,3...]
-	int updated_face_num;
-
-	GLfloat** vArr; //ŵĶά
-	GLfloat** vtArr; //Ķά
-	GLfloat** vnArr; //ŷߵĶά
-	int** fvArr; //涥Ķά
-	int** ftArr; //Ķά
-	int** fnArr; //淨ߵĶά
-
-	GLfloat* vertices;
-	GLuint* indices;
-
-	GLfloat* updatedVertices;
-	GLfloat* texCoords;
-	GLuint* texIndices;
-
-	GLfloat* updatedTexCoords;
-	GLfloat* updatedAgainVertices;
+	IndexedMesh welded; // unique (v, vt) vertices and the index buffer drawing them, mapped from the .mesh cache when possible
+	MeshletMesh meshlets; // clusters of welded for culling, the model is drawn from their index buffer
 
 	GLfloat* midbot;
 } ObjData;
@@ -126,290 +128,29 @@ struct
 	GLfloat* up;
 	GLfloat  fov;
 	GLfloat  aspect;
-	ESMatrix  mvpMatrix; // for real render of model
+	SceneView view;
+	SceneMVP  mvp; // for real render of model
+	MeshletView meshletView; // clusters of the model in view
 } CameraData;
 
 
-void GetDataNum(const char* filename, int* v_num, int* vt_num, int* vn_num, int* f_num)
-{
-	char line[1024];
-	FILE* file;
-
-	file = fopen(filename, "r");
-	if (file == NULL)
-	{
-		printf("file cannot open \n");
-	}
-	while (!feof(file))
-	{
-		for (int i = 0; i < 1024; i++)
-			line[i] = 0;
-
-		fgets(line, 1024, file);
-
-		// process file, consider the format is correct
-		// (not including empty line and so on)
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				ObjData.vn_num++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-				ObjData.vt_num++;
-			}
-			else							// v
-			{
-				ObjData.v_num++;
-			}
-		}
-		else if (line[0] == 'f')
-		{
-			ObjData.f_num++;
-		}
-	}
-	fclose(file);
-}
-
+// load filename with LoadCachedMesh (myMeshCache.c): the welded, optimized model is mapped from the
+// .mesh file next to filename when that is up to date, otherwise filename is parsed and the .mesh written
 int LoadDataFromFile(const char* filename)
 {
-	char line[1024];
-	FILE* file;
-
-	// allocate memory to all arrays
-	ObjData.vArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.v_num);
-	for (int i = 0; i < ObjData.v_num; i++)
-	{
-		ObjData.vArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.vtArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.vt_num);
-	for (int i = 0; i < ObjData.vt_num; i++)
-	{
-		ObjData.vtArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 2); // ignore the third value of vt
-	}
-	ObjData.texCoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * ObjData.vt_num);
-
-	ObjData.vnArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.vn_num);
-	for (int i = 0; i < ObjData.vn_num; i++)
-	{
-		ObjData.vnArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.fvArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	ObjData.ftArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	ObjData.fnArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	for (int i = 0; i < ObjData.f_num; i++)
-	{
-		// for the "f" part of ailian.obj, the max num of vertex an f contain is 4
-		ObjData.fvArr[i] = (int*)malloc(sizeof(int) * 4);
-		ObjData.ftArr[i] = (int*)malloc(sizeof(int) * 4);
-		ObjData.fnArr[i] = (int*)malloc(sizeof(int) * 4);
-	}
-
-	file = fopen(filename, "r");
-	if (file == NULL)
-	{
-		printf("file cannot open \n");
-	}
-
-	// store data to arrays
-	int vnRow = 0, vtRow = 0, vRow = 0, fRow = 0;
-	int vtIndex = 0;
-	while (!feof(file))
-	{
-		fgets(line, 1024, file);
-
-		char* token = NULL;
-		char* next_token = NULL;
-		token = strtok_s(line, " ", &next_token);
-		int count = 0;
-
-
-
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				//printf("vn:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						// filter the first token
-						ObjData.vnArr[vnRow][count - 1] = atof(token);
-						//printf("%f\n", ObjData.vnArr[vnRow][count - 1]);
-					}
-					//printf("\n");
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-				}
-				//printf("\n");
-				vnRow++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-				// sometimes vt has three value, we ignore the third in this case
-				// [ 0.01992, 0.01992,
-				//   0.998,   0.998,
-				//   ...              ]
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0 && count < 3)
-					{
-						// filter the first token and ignore the third value of vt
-						ObjData.texCoords[vtIndex] = atof(token);
-						ObjData.vtArr[vtRow][count - 1] = atof(token);
-						vtIndex++;
-						//printf("%f\n", ObjData.vnArr[vnRow][count - 1]);
-					}
-					//printf("\n");
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-				}
-				vtRow++;
-			}
-			else							// v
-			{
-				//printf("v:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						ObjData.vArr[vRow][count - 1] = atof(token);
-						//printf("%f\n", ObjData.vArr[vRow][count - 1]);
-					}
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-					//printf("\n");
-				}
-				vRow++;
-			}
-		}
-		else if (line[0] == 'f') // fv, fn
-		{
-			// ["3/13/5", "4/14/6", "5/15/7" or "1/3" or "160//12"]
-
-			while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-			{
-				int face_count = 0; // 0--"3" 1--"13" 2--"5"
-				if (count > 0)
-				{
-					char* face_token = NULL;
-					char* face_next_token = NULL;
-					face_token = strtok_s(token, "/", &face_next_token);
-
-					while (face_token != NULL)
-					{
-						if (face_count == 0) // fvArr
-						{
-							ObjData.fvArr[fRow][count - 1] = atoi(face_token);
-							//printf("%d\n", ObjData.fvArr[fRow][count - 1]);
-						}
-						else if (face_count == 1) // ftArr
-						{
-							ObjData.ftArr[fRow][count - 1] = atoi(face_token);
-						}
-						else if (face_count == 2) // fnArr
-						{
-
-						}
-
-						face_token = strtok_s(NULL, "/", &face_next_token);
-						face_count++;
-					}
-				}
-				token = strtok_s(NULL, " ", &next_token);
-				count++;
-				printf("\n");
-			}
-
-			ObjData.face_counts[fRow] = count - 1;
-			fRow++;
-		}
-		//printf("count: %d\n\n\n", count);
-	}
-
-	fclose(file);
-
-	return 0;
-}
-
-// [[0.5, 0.5, 0.5], [-0.5, 0.5, 0.5]...] --> [0.5, 0.5, 0.5, -0.5, 0.5, 0.5...]
-void TransVArr(const GLfloat** source, GLfloat* ret)
-{
-	for (int i = 0; i < ObjData.v_num; i++)
+	if (!LoadCachedMesh(filename, MESH_ATTRIB_TEXCOORD, &ObjData.welded))
 	{
-		for (int j = 0; j < 3; j++)
-		{
-			ret[i * 3 + j] = source[i][j];
-		}
+		return FALSE;
 	}
-}
+	PrintWeldStats(filename, &ObjData.welded);
 
-// [[7,1,5,N],     [7,1,5,
-//  [5,1,3,7], -->  5,1,3, 5,3,7,
-//  [4,8,6,N]]      4,8,6]
-void TransFArr(const int** source, GLuint* ret)
-{
-	int row = 0;
-	int capacity = ObjData.face_counts[row];
-	int ret_index = 0;
-
-	// ret_index < 3 * ObjData.updated_face_num
-	for (; row < ObjData.f_num; row++, capacity += ObjData.face_counts[row])
+	if (!BuildMeshlets(&ObjData.welded, &ObjData.meshlets))
 	{
-		if (ObjData.face_counts[row] == 3) // [7,1,5,N]
-		{
-			for (int i = 0; i < 3; i++, ret_index++)
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-		}
-		else if (ObjData.face_counts[row] == 4) // [5,1,3,7] --> [5,1,3, 5,3,7]
-		{
-			for (int i = 0; i < 3; i++, ret_index++) // [5,1,3]
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-			// [5,3,7]
-			ret[ret_index] = source[row][0] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][2] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][3] - 1;
-			ret_index++;
-		}
-	}
-}
-
-void UpdateVertices(GLfloat* ret)
-{
-	for (int i = 0; i < 3 * ObjData.updated_face_num; i++)
-	{
-		for (int j = 0; j < 3; j++)
-		{
-			ret[ObjData.texIndices[i] * 3 + j] = ObjData.vertices[ObjData.indices[i] * 3 + j];
-		}
+		return FALSE;
 	}
-}
+	PrintMeshletStats(filename, &ObjData.meshlets);
 
-// rearrange vetices again cuz the pair, updatedVertices -- texCoords -- texIndices
-// causes part of vetices lost
-void UpdatedAgainVertices()
-{
-	for (int i = 0; i < ObjData.updated_face_num * 3; i++)
-	{
-		for (int j = 0; j < 3; j++)
-		{
-			ObjData.updatedAgainVertices[i * 3 + j] = ObjData.vArr[ObjData.indices[i]][j];
-		}
-		for (int j = 0; j < 2; j++)
-		{
-			ObjData.updatedTexCoords[i * 2 + j] = ObjData.vtArr[ObjData.texIndices[i]][j];
-		}
-	}
+	return TRUE;
 }
 
 ///
@@ -462,71 +203,98 @@ GLuint LoadShader(GLenum type, const char* shaderSrc)
 
 }
 
+// build the scene and the views once, Update and Draw only bring up to date what moved
 int InitMVP(ESContext* esContext)
 {
 	UserData* userData = esContext->userData;
-	ESMatrix perspective;
-	ESMatrix ortho;
-	ESMatrix modelview;
 	ESMatrix model;
-	ESMatrix view;
 
-	// Generate a perspective matrix with a 45 degree FOV for the scene rendering
-	esMatrixLoadIdentity(&perspective);
-	esPerspective(&perspective, CameraData.fov, CameraData.aspect, 1.0f, 250.0f);
+	if (!CreateScene(&userData->scene, 3))
+	{
+		return FALSE;
+	}
 
-	// Generate an orthographic projection matrix for the shadow map rendering
-	esMatrixLoadIdentity(&ortho);
-	esOrtho(&ortho, -20, 20, -20, 20, -60, 60);
+	// GROUND at the origin, the model stands on it
+	userData->groundNode = AddSceneNode(&userData->scene, SCENE_NO_PARENT, NULL);
+	userData->modelNode = AddSceneNode(&userData->scene, userData->groundNode, NULL);
 
-	// MODEL
+	// MODEL as the shadow map sees it, 2 back along z: as a child of the model it follows it
 	esMatrixLoadIdentity(&model);
-
 	esTranslate(&model, 0.0f, 0.0f, -2.0f);
+	userData->shadowNode = AddSceneNode(&userData->scene, userData->modelNode, &model);
 
-	// create view matrix transformation from the light position
-	esMatrixLookAt(&view,
-		userData->lightPosition[0], userData->lightPosition[1], userData->lightPosition[2],
-		0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f);
-	esMatrixMultiply(&modelview, &model, &view);
-
-	esMatrixMultiply(&userData->mvpLightMatrix, &modelview, &ortho);
+	// view matrix transformation from the light position and an orthographic projection matrix for
+	// the shadow map rendering, the light does not move
+	InitSceneView(&userData->lightView);
+	SetSceneViewLookAt(&userData->lightView, userData->lightPosition, CameraData.target, CameraData.up);
+	SetSceneViewOrtho(&userData->lightView, -20, 20, -20, 20, -60, 60);
 
+	// a perspective matrix with a CameraData.fov FOV for the scene rendering, the eye moves in Update
+	Redirection(CameraData.lookAt, CameraData.target, CameraData.eye);
+	InitSceneView(&CameraData.view);
+	SetSceneViewLookAt(&CameraData.view, CameraData.eye, CameraData.lookAt, CameraData.up);
+	SetSceneViewPerspective(&CameraData.view, CameraData.fov, CameraData.aspect, 1.0f, 250.0f);
 
+	memset(&userData->groundMvp, 0, sizeof(SceneMVP));
+	memset(&userData->groundMvpLight, 0, sizeof(SceneMVP));
+	memset(&userData->mvpLight, 0, sizeof(SceneMVP));
+	memset(&CameraData.mvp, 0, sizeof(SceneMVP));
 
-	// GROUND
-   // Generate a model view matrix to rotate/translate the ground
-	esMatrixLoadIdentity(&model);
+	return TRUE;
+}
 
-	// Center the ground
-	//esTranslate(&model, -2.0f, -2.0f, 0.0f);
+// based on the origin, a square plat floor with given side length and its bounds
+void InitFloor(ESContext* esContext, const GLfloat* origin, const GLfloat length)
+{
+	UserData* userData = esContext->userData;
 
-	// create view matrix transformation from the eye position
-	esMatrixLookAt(&view,
-		CameraData.eye[0], CameraData.eye[1], CameraData.eye[2],
-		0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f);
+	GLfloat originX = origin[0];
+	GLfloat originY = origin[1];
+	GLfloat originZ = origin[2];
+	GLfloat floorVertices[] =
+	{
+		originX + length,	originY,	originZ - length,
+		originX - length,	originY,	originZ - length,
+		originX - length,	originY,	originZ + length,
 
-	esMatrixMultiply(&modelview, &model, &view);
+		originX + length,	originY,	originZ - length,
+		originX - length,	originY,	originZ + length,
+		originX + length,	originY,	originZ + length
+	};
+	memcpy(userData->floorVertices, &floorVertices, sizeof(GLfloat) * 3 * 6);
+	esComputeBounds(&userData->floorBounds, userData->floorVertices, 3, 6);
+}
 
-	// Compute the final ground MVP for the scene rendering by multiplying the 
-	// modelview and perspective matrices together
-	esMatrixMultiply(&userData->groundMvpMatrix, &modelview, &perspective);
+// the world spheres of the model, drawn with the world of modelNode, and of the floor, drawn with the ground's
+void SetPassSpheres(ESContext* esContext, int modelNode, GLfloat spheres[4][NUM_OBJECTS])
+{
+	UserData* userData = esContext->userData;
+	ESBounds world[NUM_OBJECTS];
 
-	// create view matrix transformation from the light position
-	esMatrixLookAt(&view,
-		userData->lightPosition[0], userData->lightPosition[1], userData->lightPosition[2],
-		0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f);
+	esTransformBounds(&world[MODEL], &userData->modelBounds, GetSceneNodeWorld(&userData->scene, modelNode));
+	esTransformBounds(&world[FLOOR], &userData->floorBounds, GetSceneNodeWorld(&userData->scene, userData->groundNode));
+	for (int i = 0; i < NUM_OBJECTS; i++)
+	{
+		for (int k = 0; k < 3; k++)
+			spheres[k][i] = world[i].center[k];
+		spheres[3][i] = world[i].radius;
+	}
+}
 
-	esMatrixMultiply(&modelview, &model, &view);
+// which objects are in the frustum of viewProjection, every sphere in world space
+void CullObjects(const ESMatrix* viewProjection, GLfloat spheres[4][NUM_OBJECTS], GLboolean* inView)
+{
+	ESSphereArrays arrays = { spheres[0], spheres[1], spheres[2], spheres[3] };
+	ESFrustumPlanes frustum;
+	int visible[NUM_OBJECTS];
+	int numVisible;
 
-	// Compute the final ground MVP for the shadow map rendering by multiplying the 
-	// modelview and ortho matrices together
-	esMatrixMultiply(&userData->groundMvpLightMatrix, &modelview, &ortho);
+	esFrustumPlanesFromMatrix(&frustum, viewProjection);
+	numVisible = esCullSpheres(&frustum, &arrays, NUM_OBJECTS, visible);
 
-	return TRUE;
+	memset(inView, 0, sizeof(GLboolean) * NUM_OBJECTS);
+	for (int i = 0; i < numVisible; i++)
+		inView[visible[i]] = GL_TRUE;
 }
 
 int InitShadowMap(ESContext* esContext)
@@ -587,36 +355,18 @@ int Init(ESContext* esContext)
 	// init ObjData
 
 	const char* filename = "bear.obj";
-	GetDataNum(filename, ObjData.v_num, ObjData.vt_num, ObjData.vn_num, ObjData.f_num);
-	ObjData.vertices = malloc(sizeof(GLfloat) * 3 * ObjData.v_num);
-
-	ObjData.face_counts = malloc(sizeof(int) * ObjData.f_num);
-
-	LoadDataFromFile(filename);
-	ObjData.updated_face_num = updatedFaceNum(ObjData.face_counts, ObjData.f_num);
-
-	ObjData.indices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
-
-	TransVArr(ObjData.vArr, ObjData.vertices);
-	TransFArr(ObjData.fvArr, ObjData.indices);
-
-
-	ObjData.texIndices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
-	ObjData.updatedVertices = malloc(sizeof(GLfloat) * 3 * ObjData.vt_num);
-	TransFArr(ObjData.ftArr, ObjData.texIndices);
-	UpdateVertices(ObjData.updatedVertices);
-
-
-	ObjData.updatedAgainVertices = malloc(sizeof(GLfloat) * 3 * 3 * ObjData.updated_face_num); // three float num makes a vertex, three vertices make a face
-	ObjData.updatedTexCoords = malloc(sizeof(int) * 2 * 3 * ObjData.updated_face_num); // two float num makes a texcoord, three texcoords make a face
-
-	UpdatedAgainVertices();
+	if (!LoadDataFromFile(filename))
+	{
+		return FALSE;
+	}
 
 	ObjData.midbot = malloc(sizeof(GLfloat) * 3);
-	GetMidBotPosition(ObjData.vArr, ObjData.v_num, ObjData.midbot);
+	MeshMidBotPosition(&ObjData.welded, ObjData.midbot);
+	MeshBounds(&ObjData.welded, &userData->modelBounds);
 
 	
 	userData->floorVertices = malloc(sizeof(GLfloat) * 3 * 6);
+	InitFloor(esContext, ObjData.midbot, 4.0f);
 
 
 
@@ -787,6 +537,19 @@ int Init(ESContext* esContext)
 		return FALSE;
 	}
 
+	// the floor texture is made once here, DrawFloor only binds it
+	userData->floorMapTexId = CreateSimpleTexture2D();
+
+	if (userData->floorMapTexId == 0)
+	{
+		return FALSE;
+	}
+
+	if (!InitMVP(esContext))
+	{
+		return FALSE;
+	}
+
 	// create depth texture
 	if (!InitShadowMap(esContext))
 	{
@@ -807,61 +570,29 @@ void Update(ESContext* esContext, float deltaTime)
 {
 	UserData* userData = esContext->userData;
 
-	ESMatrix perspective;
-	ESMatrix modelview;
-	ESMatrix eyeview;
-
-
-	esMatrixLoadIdentity(&perspective);
-	esMatrixLoadIdentity(&modelview);
-
-	esPerspective(&perspective, CameraData.fov, CameraData.aspect, 1.0f, 250.0f);
-
 	Rotate(CameraData.eye, userData->angle);
 	Redirection(CameraData.lookAt, CameraData.target, CameraData.eye);
 
-	esMatrixLookAt(&eyeview,
-		CameraData.eye[0], CameraData.eye[1], CameraData.eye[2],
-		CameraData.lookAt[0], CameraData.lookAt[1], CameraData.lookAt[2],
-		CameraData.up[0], CameraData.up[1], CameraData.up[2]);
-
-	esMatrixMultiply(&perspective, &eyeview, &perspective);
-
-	//esTranslate(&modelview, 0.0, 0.0, -5.0);
+	// only flags the camera, its matrices are rebuilt when Draw asks for them
+	SetSceneViewLookAt(&CameraData.view, CameraData.eye, CameraData.lookAt, CameraData.up);
 
-	esMatrixMultiply(&CameraData.mvpMatrix, &modelview, &perspective);
+	// the spheres follow the nodes, when they moved
+	if (UpdateScene(&userData->scene) > 0)
+	{
+		SetPassSpheres(esContext, userData->modelNode, userData->sceneSpheres);
+		SetPassSpheres(esContext, userData->shadowNode, userData->lightSpheres);
+	}
 }
 
-// based on the origin, draw a square plat floor with given side length 
-void DrawFloor(ESContext* esContext, const GLfloat* origin, const GLfloat length)
+// draw the floor set up by InitFloor
+void DrawFloor(ESContext* esContext)
 {
 	UserData* userData = esContext->userData;
 
-	GLfloat originX = origin[0];
-	GLfloat originY = origin[1];
-	GLfloat originZ = origin[2];
-	GLfloat floorVertices[] =
-	{
-		originX + length,	originY,	originZ - length,
-		originX - length,	originY,	originZ - length,
-		originX - length,	originY,	originZ + length,
-
-		originX + length,	originY,	originZ - length,
-		originX - length,	originY,	originZ + length,
-		originX + length,	originY,	originZ + length
-	};
-	memcpy(userData->floorVertices, &floorVertices, sizeof(GLfloat) * 3 * 6);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, userData->floorVertices);
 
-	glUniformMatrix4fv(userData->sceneMvpLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvpMatrix.m[0][0]);
-	glUniformMatrix4fv(userData->sceneMvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvpLightMatrix.m[0][0]);
-
-	userData->floorMapTexId = CreateSimpleTexture2D();
-
-	if (userData->floorMapTexId == 0)
-	{
-		return FALSE;
-	}
+	glUniformMatrix4fv(userData->sceneMvpLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvp.matrix.m[0][0]);
+	glUniformMatrix4fv(userData->sceneMvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvpLight.matrix.m[0][0]);
 
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, userData->floorVertices);
 
@@ -873,24 +604,25 @@ void DrawFloor(ESContext* esContext, const GLfloat* origin, const GLfloat length
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
-
-void DrawScene(ESContext* esContext, GLint mvpLoc, GLint mvpLightLoc)
+void DrawScene(ESContext* esContext, GLint mvpLoc, GLint mvpLightLoc, const GLboolean* inView)
 {
 	UserData* userData = esContext->userData;
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, ObjData.updatedAgainVertices);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * ObjData.welded.stride, ObjData.welded.vertices);
 	glEnableVertexAttribArray(0);
 
-	glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, (GLfloat*)& CameraData.mvpMatrix.m[0][0]);
-	glUniformMatrix4fv(mvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->mvpLightMatrix.m[0][0]);
+	glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, (GLfloat*)& CameraData.mvp.matrix.m[0][0]);
+	glUniformMatrix4fv(mvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->mvpLight.matrix.m[0][0]);
 
-	glDrawArrays(GL_TRIANGLES, 0, 3 * ObjData.updated_face_num);
+	if (inView[MODEL])
+		DrawMeshlets(&ObjData.meshlets, &userData->lightMeshletView, ObjData.meshlets.indices);
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, userData->floorVertices);
-	glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvpMatrix.m[0][0]);
-	glUniformMatrix4fv(mvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvpLightMatrix.m[0][0]);
+	glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvp.matrix.m[0][0]);
+	glUniformMatrix4fv(mvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->groundMvpLight.matrix.m[0][0]);
 
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	if (inView[FLOOR])
+		glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
 ///
@@ -900,8 +632,19 @@ void Draw(ESContext* esContext)
 {
 	UserData* userData = esContext->userData;
 	GLint defaultFramebuffer = 0;
+	GLboolean inView[NUM_OBJECTS];
 
-	InitMVP(esContext);
+	// only the MVPs whose node or view moved since the last frame are recomputed, with the light
+	// still the shadow pass keeps its matrices and its clusters
+	UpdateSceneMVP(&userData->scene, userData->groundNode, &CameraData.view, &userData->groundMvp);
+	UpdateSceneMVP(&userData->scene, userData->groundNode, &userData->lightView, &userData->groundMvpLight);
+
+	// the model matrix is the identity: clusters are culled against the eye as it is.
+	// Every cluster in view of the light casts a shadow, facing it or not
+	if (UpdateSceneMVP(&userData->scene, userData->shadowNode, &userData->lightView, &userData->mvpLight))
+		MeshletViewFromMatrix(&userData->mvpLight.matrix, NULL, &userData->lightMeshletView);
+	if (UpdateSceneMVP(&userData->scene, userData->modelNode, &CameraData.view, &CameraData.mvp))
+		MeshletViewFromMatrix(&CameraData.mvp.matrix, CameraData.eye, &CameraData.meshletView);
 
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFramebuffer);
 
@@ -921,8 +664,10 @@ void Draw(ESContext* esContext)
 	glEnable(GL_POLYGON_OFFSET_FILL);
 	glPolygonOffset(5.0f, 100.0f);
 
+	// only what the light sees casts a shadow
 	glUseProgram(userData->shadowMapProgramObject);
-	DrawScene(esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc);
+	CullObjects(&userData->lightView.view_projection, userData->lightSpheres, inView);
+	DrawScene(esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc, inView);
 
 	glDisable(GL_POLYGON_OFFSET_FILL);
 
@@ -943,6 +688,7 @@ void Draw(ESContext* esContext)
 
 	// Use the program object
 	glUseProgram(userData->sceneProgramObject);
+	CullObjects(&CameraData.view.view_projection, userData->sceneSpheres, inView);
 
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, userData->shadowMapTextureId);
@@ -951,19 +697,19 @@ void Draw(ESContext* esContext)
 	// Load the vertex data
 
 	// corresponding relation
-	// updatedVertices -- texCoords -- texIndices
-	// updatedAgainVertices -- updatedTexCoords -- glDrawArrays
+	// welded.vertices [px, py, pz, s, t, ...] -- meshlets.indices -- glDrawRangeElements per run of visible clusters
 
 
 	//// draw model
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, ObjData.updatedAgainVertices);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * ObjData.welded.stride, ObjData.welded.vertices);
 	glEnableVertexAttribArray(0);
 
-	glUniformMatrix4fv(userData->sceneMvpLoc, 1, GL_FALSE, (GLfloat*)& CameraData.mvpMatrix.m[0][0]);
-	glUniformMatrix4fv(userData->sceneMvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->mvpLightMatrix.m[0][0]);
+	glUniformMatrix4fv(userData->sceneMvpLoc, 1, GL_FALSE, (GLfloat*)& CameraData.mvp.matrix.m[0][0]);
+	glUniformMatrix4fv(userData->sceneMvpLightLoc, 1, GL_FALSE, (GLfloat*)& userData->mvpLight.matrix.m[0][0]);
 
 	// stick texture on ailian
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, ObjData.updatedTexCoords);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * ObjData.welded.stride,
+		ObjData.welded.vertices + ObjData.welded.texcoord_offset);
 	glEnableVertexAttribArray(1);
 
 	glActiveTexture(GL_TEXTURE0);
@@ -972,20 +718,29 @@ void Draw(ESContext* esContext)
 	glUniform1i(userData->ailianMapLoc, 0);
 	
 
-	glDrawArrays(GL_TRIANGLES, 0, 3 * ObjData.updated_face_num);
+	// only the clusters in view and facing the eye, when the model is in view at all
+	if (inView[MODEL])
+		DrawMeshlets(&ObjData.meshlets, &CameraData.meshletView, ObjData.meshlets.indices);
 	glBindTexture(GL_TEXTURE_2D, 0); // clear GL_TEXTURE_2D status
 
 	
 
 	// draw floor
-	DrawFloor(esContext, ObjData.midbot, 4.0f);
+	if (inView[FLOOR])
+		DrawFloor(esContext);
 }
 
 void Shutdown(ESContext* esContext)
 {
 	UserData* userData = esContext->userData;
 
+	glDeleteTextures(1, &userData->floorMapTexId);
+	ReleaseTexture(userData->ailianMapTexId);
+	PrintTextureCacheStats();
+	FreeTextureCache();
+
 	glDeleteProgram(userData->sceneProgramObject);
+	FreeScene(&userData->scene);
 }
 
 int esMain(ESContext* esContext)
@@ -41,6 +41,9 @@
 #include <stdio.h>
 #include "esUtil.h"
 #include "myUtil.h"
+#include "myMeshCache.h"
+#include "myMeshQuantize.h"
+#include "myMeshlet.h"
 
 #define POSITION_LOC    0
 #define COLOR_LOC       1
@@ -85,15 +88,19 @@ typedef struct
 	ESMatrix  groundMvpLightMatrix;
 	ESMatrix  modelMvpMatrix;
 	ESMatrix  modelMvpLightMatrix;
+
+	// clusters of the model in view of the eye and of the light
+	MeshletView modelMeshletView;
+	MeshletView modelLightMeshletView;
 	
 	float eyePosition[3];
 	float lightPosition[3];
 
 	// Sampler location
 	GLint modelSamplerLoc;
-	// Texture handle
-	GLuint modelTexId;
-	GLuint modelTexcoordVBO;
+	// Textures loaded in the background, the model texture is a handle of the stream
+	ESTextureStream* textureStream;
+	int modelTexture;
 
 	GLuint groundTexId;
 	GLuint groundTexcoordVBO;
@@ -103,29 +110,9 @@ typedef struct
 
 struct
 {
-	int v_num;
-	int vt_num;
-	int vn_num;
-	int f_num;
-	int* face_counts; // [3,3,3,3,3,4,4,4,4,3...]
-	int updated_face_num;
-
-	GLfloat** vArr; //ŵĶά
-	GLfloat** vtArr; //Ķά
-	GLfloat** vnArr; //ŷߵĶά
-	int** fvArr; //涥Ķά
-	int** ftArr; //Ķά
-	int** fnArr; //淨ߵĶά
-
-	GLfloat* vertices;
-	GLuint* indices;
-
-	GLfloat* updatedVertices;
-	GLfloat* texCoords;
-	GLuint* texIndices;
-
-	GLfloat* updatedTexCoords;
-	GLfloat* updatedAgainVertices;
+	IndexedMesh welded; // unique (v, vt) vertices and the index buffer drawing them, mapped from the .mesh cache when possible
+	QuantizedMesh quantized; // the vertices of welded packed to 12 bytes, what the VBO holds
+	MeshletMesh meshlets; // clusters of welded for culling, what the IBO holds
 
 	GLfloat* midbot;
 
@@ -143,286 +130,30 @@ struct
 	ESMatrix  mvpMatrix; // for real render of model
 } CameraData;
 
-void GetDataNum(const char* filename, int* v_num, int* vt_num, int* vn_num, int* f_num)
-{
-	char line[1024];
-	FILE* file;
-
-	file = fopen(filename, "r");
-	if (file == NULL)
-	{
-		printf("file cannot open \n");
-	}
-	while (!feof(file))
-	{
-		for (int i = 0; i < 1024; i++)
-			line[i] = 0;
-
-		fgets(line, 1024, file);
-
-		// process file, consider the format is correct
-		// (not including empty line and so on)
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				ObjData.vn_num++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-				ObjData.vt_num++;
-			}
-			else							// v
-			{
-				ObjData.v_num++;
-			}
-		}
-		else if (line[0] == 'f')
-		{
-			ObjData.f_num++;
-		}
-	}
-	fclose(file);
-}
-
+// load filename with LoadCachedMesh (myMeshCache.c): the welded, optimized model is mapped from the
+// .mesh file next to filename when that is up to date, otherwise filename is parsed and the .mesh written
 int LoadDataFromFile(const char* filename)
 {
-	char line[1024];
-	FILE* file;
-
-	// allocate memory to all arrays
-	ObjData.vArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.v_num);
-	for (int i = 0; i < ObjData.v_num; i++)
-	{
-		ObjData.vArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.vtArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.vt_num);
-	for (int i = 0; i < ObjData.vt_num; i++)
-	{
-		ObjData.vtArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 2); // ignore the third value of vt
-	}
-	ObjData.texCoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * ObjData.vt_num);
-
-	ObjData.vnArr = (GLfloat * *)malloc(sizeof(GLfloat*) * ObjData.vn_num);
-	for (int i = 0; i < ObjData.vn_num; i++)
+	if (!LoadCachedMesh(filename, MESH_ATTRIB_TEXCOORD, &ObjData.welded))
 	{
-		ObjData.vnArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
-	}
-
-	ObjData.fvArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	ObjData.ftArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	ObjData.fnArr = (int**)malloc(sizeof(int*) * ObjData.f_num);
-	for (int i = 0; i < ObjData.f_num; i++)
-	{
-		// for the "f" part of ailian.obj, the max num of vertex an f contain is 4
-		ObjData.fvArr[i] = (int*)malloc(sizeof(int) * 4);
-		ObjData.ftArr[i] = (int*)malloc(sizeof(int) * 4);
-		ObjData.fnArr[i] = (int*)malloc(sizeof(int) * 4);
-	}
-
-	file = fopen(filename, "r");
-	if (file == NULL)
-	{
-		printf("file cannot open \n");
+		return FALSE;
 	}
+	PrintWeldStats(filename, &ObjData.welded);
 
-	// store data to arrays
-	int vnRow = 0, vtRow = 0, vRow = 0, fRow = 0;
-	int vtIndex = 0;
-	while (!feof(file))
+	// snorm16 positions and half float texcoords, the half floats need no scale in the shader
+	if (!QuantizeMesh(&ObjData.welded, QUANTIZE_TEXCOORD_HALF, QUANTIZE_NORMAL_OCT16, &ObjData.quantized))
 	{
-		fgets(line, 1024, file);
-
-		char* token = NULL;
-		char* next_token = NULL;
-		token = strtok_s(line, " ", &next_token);
-		int count = 0;
-
-
-
-		if (line[0] == 'v')
-		{
-			if (line[1] == 'n')				// vn
-			{
-				//printf("vn:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						// filter the first token
-						ObjData.vnArr[vnRow][count - 1] = atof(token);
-						//printf("%f\n", ObjData.vnArr[vnRow][count - 1]);
-					}
-					//printf("\n");
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-				}
-				//printf("\n");
-				vnRow++;
-			}
-			else if (line[1] == 't')		// vt
-			{
-				// sometimes vt has three value, we ignore the third in this case
-				// [ 0.01992, 0.01992,
-				//   0.998,   0.998,
-				//   ...              ]
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0 && count < 3)
-					{
-						// filter the first token and ignore the third value of vt
-						ObjData.texCoords[vtIndex] = atof(token);
-						ObjData.vtArr[vtRow][count - 1] = atof(token);
-						vtIndex++;
-						//printf("%f\n", ObjData.vnArr[vnRow][count - 1]);
-					}
-					//printf("\n");
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-				}
-				vtRow++;
-			}
-			else							// v
-			{
-				//printf("v:\n");
-				while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-				{
-					if (count > 0)
-					{
-						ObjData.vArr[vRow][count - 1] = atof(token);
-						//printf("%f\n", ObjData.vArr[vRow][count - 1]);
-					}
-					token = strtok_s(NULL, " ", &next_token);
-					count++;
-					//printf("\n");
-				}
-				vRow++;
-			}
-		}
-		else if (line[0] == 'f') // fv, fn
-		{
-			// ["3/13/5", "4/14/6", "5/15/7" or "1/3" or "160//12"]
-
-			while (token != NULL && strcmp(token, "\n") != 0) // the last token would be "\n"
-			{
-				int face_count = 0; // 0--"3" 1--"13" 2--"5"
-				if (count > 0)
-				{
-					char* face_token = NULL;
-					char* face_next_token = NULL;
-					face_token = strtok_s(token, "/", &face_next_token);
-
-					while (face_token != NULL)
-					{
-						if (face_count == 0) // fvArr
-						{
-							ObjData.fvArr[fRow][count - 1] = atoi(face_token);
-							//printf("%d\n", ObjData.fvArr[fRow][count - 1]);
-						}
-						else if (face_count == 1) // ftArr
-						{
-							ObjData.ftArr[fRow][count - 1] = atoi(face_token);
-						}
-						else if (face_count == 2) // fnArr
-						{
-
-						}
-
-						face_token = strtok_s(NULL, "/", &face_next_token);
-						face_count++;
-					}
-				}
-				token = strtok_s(NULL, " ", &next_token);
-				count++;
-				printf("\n");
-			}
-
-			ObjData.face_counts[fRow] = count - 1;
-			fRow++;
-		}
-		//printf("count: %d\n\n\n", count);
-	}
-
-	fclose(file);
-
-	return 0;
-}
-
-// [[0.5, 0.5, 0.5], [-0.5, 0.5, 0.5]...] --> [0.5, 0.5, 0.5, -0.5, 0.5, 0.5...]
-void TransVArr(const GLfloat** source, GLfloat* ret)
-{
-	for (int i = 0; i < ObjData.v_num; i++)
-	{
-		for (int j = 0; j < 3; j++)
-		{
-			ret[i * 3 + j] = source[i][j];
-		}
-	}
-}
-
-// [[7,1,5,N],     [7,1,5,
-//  [5,1,3,7], -->  5,1,3, 5,3,7,
-//  [4,8,6,N]]      4,8,6]
-void TransFArr(const int** source, GLuint* ret)
-{
-	int row = 0;
-	int capacity = ObjData.face_counts[row];
-	int ret_index = 0;
-
-	// ret_index < 3 * ObjData.updated_face_num
-	for (; row < ObjData.f_num; row++, capacity += ObjData.face_counts[row])
-	{
-		if (ObjData.face_counts[row] == 3) // [7,1,5,N]
-		{
-			for (int i = 0; i < 3; i++, ret_index++)
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-		}
-		else if (ObjData.face_counts[row] == 4) // [5,1,3,7] --> [5,1,3, 5,3,7]
-		{
-			for (int i = 0; i < 3; i++, ret_index++) // [5,1,3]
-			{
-				ret[ret_index] = source[row][i] - 1;
-			}
-			// [5,3,7]
-			ret[ret_index] = source[row][0] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][2] - 1;
-			ret_index++;
-			ret[ret_index] = source[row][3] - 1;
-			ret_index++;
-		}
+		return FALSE;
 	}
-}
+	PrintQuantizeStats(filename, &ObjData.welded, &ObjData.quantized);
 
-void UpdateVertices(GLfloat* ret)
-{
-	for (int i = 0; i < 3 * ObjData.updated_face_num; i++)
+	if (!BuildMeshlets(&ObjData.welded, &ObjData.meshlets))
 	{
-		for (int j = 0; j < 3; j++)
-		{
-			ret[ObjData.texIndices[i] * 3 + j] = ObjData.vertices[ObjData.indices[i] * 3 + j];
-		}
+		return FALSE;
 	}
-}
+	PrintMeshletStats(filename, &ObjData.meshlets);
 
-// rearrange vetices again cuz the pair, updatedVertices -- texCoords -- texIndices
-// causes part of vetices lost
-void UpdatedAgainVertices()
-{
-	for (int i = 0; i < ObjData.updated_face_num * 3; i++)
-	{
-		for (int j = 0; j < 3; j++)
-		{
-			ObjData.updatedAgainVertices[i * 3 + j] = ObjData.vArr[ObjData.indices[i]][j];
-		}
-		for (int j = 0; j < 2; j++)
-		{
-			ObjData.updatedTexCoords[i * 2 + j] = ObjData.vtArr[ObjData.texIndices[i]][j];
-		}
-	}
+	return TRUE;
 }
 
 ///
@@ -464,11 +195,13 @@ int InitMVP(ESContext* esContext)
 		0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f);
 
-	esMatrixMultiply(&modelview, &model, &view);
+	// model, view and dequantize all end in a column of 0, 0, 0, 1 and so do their products,
+	// the affine multiply does for every product here and in Draw
+	esMatrixMultiplyAffine(&modelview, &model, &view);
 
 	// Compute the final ground MVP for the scene rendering by multiplying the 
 	// modelview and perspective matrices together
-	esMatrixMultiply(&userData->groundMvpMatrix, &modelview, &perspective);
+	esMatrixMultiplyAffine(&userData->groundMvpMatrix, &modelview, &perspective);
 
 	// create view matrix transformation from the light position
 	esMatrixLookAt(&view,
@@ -476,11 +209,11 @@ int InitMVP(ESContext* esContext)
 		0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f);
 
-	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiplyAffine(&modelview, &model, &view);
 
 	// Compute the final ground MVP for the shadow map rendering by multiplying the 
 	// modelview and ortho matrices together
-	esMatrixMultiply(&userData->groundMvpLightMatrix, &modelview, &ortho);
+	esMatrixMultiplyAffine(&userData->groundMvpLightMatrix, &modelview, &ortho);
 
 
 
@@ -493,6 +226,8 @@ int InitMVP(ESContext* esContext)
 	esTranslate(&model, 5.0f, -2.0f, -3.0f);
 	//esScale(&model, 1.0f, 2.5f, 1.0f);
 	esRotate(&model, 45.0f, 0.0f, 1.0f, 0.0f);
+	// the packed positions are in [-1,1], back onto the bounding box first
+	esMatrixMultiplyAffine(&model, &ObjData.quantized.dequantize, &model);
 
 	// create view matrix transformation from the eye position
 	esMatrixLookAt(&view,
@@ -500,11 +235,11 @@ int InitMVP(ESContext* esContext)
 		0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f);
 
-	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiplyAffine(&modelview, &model, &view);
 
 	// Compute the final model MVP for scene rendering by multiplying the 
 	// modelview and perspective matrices together
-	esMatrixMultiply(&userData->modelMvpMatrix, &modelview, &perspective);
+	esMatrixMultiplyAffine(&userData->modelMvpMatrix, &modelview, &perspective);
 
 	// create view matrix transformation from the light position
 	esMatrixLookAt(&view,
@@ -512,11 +247,11 @@ int InitMVP(ESContext* esContext)
 		0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f);
 
-	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiplyAffine(&modelview, &model, &view);
 
 	// Compute the final cube MVP for shadow map rendering by multiplying the 
 	// modelview and ortho matrices together
-	esMatrixMultiply(&userData->modelMvpLightMatrix, &modelview, &ortho);
+	esMatrixMultiplyAffine(&userData->modelMvpLightMatrix, &modelview, &ortho);
 
 	return TRUE;
 }
@@ -582,33 +317,13 @@ int Init(ESContext* esContext)
 	// init ObjData
 
 	const char* filename = "bear.obj";
-	GetDataNum(filename, ObjData.v_num, ObjData.vt_num, ObjData.vn_num, ObjData.f_num);
-	ObjData.vertices = malloc(sizeof(GLfloat) * 3 * ObjData.v_num);
-
-	ObjData.face_counts = malloc(sizeof(int) * ObjData.f_num);
-
-	LoadDataFromFile(filename);
-	ObjData.updated_face_num = updatedFaceNum(ObjData.face_counts, ObjData.f_num);
-
-	ObjData.indices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
-
-	TransVArr(ObjData.vArr, ObjData.vertices);
-	TransFArr(ObjData.fvArr, ObjData.indices);
-
-
-	ObjData.texIndices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
-	ObjData.updatedVertices = malloc(sizeof(GLfloat) * 3 * ObjData.vt_num);
-	TransFArr(ObjData.ftArr, ObjData.texIndices);
-	UpdateVertices(ObjData.updatedVertices);
-
-
-	ObjData.updatedAgainVertices = malloc(sizeof(GLfloat) * 3 * 3 * ObjData.updated_face_num); // three float num makes a vertex, three vertices make a face
-	ObjData.updatedTexCoords = malloc(sizeof(GLfloat) * 2 * 3 * ObjData.updated_face_num); // two float num makes a texcoord, three texcoords make a face
-
-	UpdatedAgainVertices();
+	if (!LoadDataFromFile(filename))
+	{
+		return FALSE;
+	}
 
 	ObjData.midbot = malloc(sizeof(GLfloat) * 3);
-	GetMidBotPosition(ObjData.vArr, ObjData.v_num, ObjData.midbot);
+	MeshMidBotPosition(&ObjData.welded, ObjData.midbot);
 
 
 	const char vShadowMapShaderStr[] =
@@ -699,9 +414,14 @@ int Init(ESContext* esContext)
 	userData->shadowMapSamplerLoc = glGetUniformLocation(userData->sceneProgramObject, "s_shadowMap");
 	userData->modelSamplerLoc = glGetUniformLocation(userData->sceneProgramObject, "s_modelMap");
 
-	// Load the texture and get the ID
-	userData->modelTexId = LoadTexture(esContext->platformData, "bear.tga");
-	if (userData->modelTexId == 0)
+	// Queue the texture, a placeholder is drawn until it is uploaded, 1 MB per frame at most
+	userData->textureStream = esCreateTextureStream(esContext->platformData, 4, 1 << 20);
+	if (userData->textureStream == NULL)
+	{
+		return FALSE;
+	}
+	userData->modelTexture = esStreamTexture(userData->textureStream, "bear.tga");
+	if (userData->modelTexture < 0)
 	{
 		return FALSE;
 	}
@@ -748,30 +468,16 @@ int Init(ESContext* esContext)
 
 
 
-	// Generate the vertex and index date for the model
-	indices = malloc(sizeof(GLuint) * 3 * ObjData.updated_face_num);
-	for (GLuint i = 0; i < 3 * ObjData.updated_face_num; i++)
-	{
-		indices[i] = i;
-	}
-
-	// Index buffer object for the model
+	// Index buffer object for the model, cluster by cluster, 16 bit indices whenever the welded vertices allow it
 	glGenBuffers(1, &userData->modelIndicesIBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, userData->modelIndicesIBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * 3 * ObjData.updated_face_num, indices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, ObjData.meshlets.index_size * ObjData.meshlets.index_num, ObjData.meshlets.indices, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	free(indices);
 
-	// Position VBO for model
+	// Interleaved position / texcoord VBO for the model, packed by QuantizeMesh
 	glGenBuffers(1, &userData->modelPositionVBO);
 	glBindBuffer(GL_ARRAY_BUFFER, userData->modelPositionVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 3 * 3 * ObjData.updated_face_num, ObjData.updatedAgainVertices, GL_STATIC_DRAW);
-	//free(positions);
-
-	// Texcoord buffer object for the model
-	glGenBuffers(1, &userData->modelTexcoordVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, userData->modelTexcoordVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 2 * 3 * ObjData.updated_face_num, ObjData.updatedTexCoords, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, ObjData.quantized.vertex_size * ObjData.quantized.vertex_num, ObjData.quantized.vertices, GL_STATIC_DRAW);
 
 	// setup transformation matrices
 	userData->eyePosition[0] = -5.0f;
@@ -813,6 +519,7 @@ void Update(ESContext* esContext, float deltaTime)
 	ESMatrix modelview;
 	ESMatrix model;
 	ESMatrix view;
+	GLfloat  eye[3];
 	float    aspect;
 	UserData* userData = esContext->userData;
 
@@ -847,11 +554,16 @@ void Update(ESContext* esContext, float deltaTime)
 		0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f);
 
-	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiplyAffine(&modelview, &model, &view);
 
 	// Compute the final model MVP for scene rendering by multiplying the 
 	// modelview and perspective matrices together
-	esMatrixMultiply(&userData->modelMvpMatrix, &modelview, &perspective);
+	esMatrixMultiplyAffine(&userData->modelMvpMatrix, &modelview, &perspective);
+
+	// clusters are culled in model space, the packed positions in [-1,1] are put back onto it after that
+	MeshletEyeFromModelview(&modelview, eye);
+	MeshletViewFromMatrix(&userData->modelMvpMatrix, eye, &userData->modelMeshletView);
+	esMatrixMultiplyAffine(&userData->modelMvpMatrix, &ObjData.quantized.dequantize, &userData->modelMvpMatrix);
 
 	// create view matrix transformation from the light position
 	esMatrixLookAt(&view,
@@ -859,11 +571,15 @@ void Update(ESContext* esContext, float deltaTime)
 		0.0f, 0.0f, 0.0f,
 		0.0f, 1.0f, 0.0f);
 
-	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiplyAffine(&modelview, &model, &view);
 
 	// Compute the final cube MVP for shadow map rendering by multiplying the 
 	// modelview and ortho matrices together
-	esMatrixMultiply(&userData->modelMvpLightMatrix, &modelview, &ortho);
+	esMatrixMultiplyAffine(&userData->modelMvpLightMatrix, &modelview, &ortho);
+
+	// every cluster in view of the light casts a shadow, facing it or not
+	MeshletViewFromMatrix(&userData->modelMvpLightMatrix, NULL, &userData->modelLightMeshletView);
+	esMatrixMultiplyAffine(&userData->modelMvpLightMatrix, &ObjData.quantized.dequantize, &userData->modelMvpLightMatrix);
 }
 
 ///
@@ -871,7 +587,8 @@ void Update(ESContext* esContext, float deltaTime)
 //
 void DrawScene(ESContext* esContext,
 	GLint mvpLoc,
-	GLint mvpLightLoc)
+	GLint mvpLightLoc,
+	const MeshletView* modelMeshletView)
 {
 	UserData* userData = esContext->userData;
 
@@ -908,13 +625,9 @@ void DrawScene(ESContext* esContext,
 	// Draw the model
 	// Load the vertex position
 	glBindBuffer(GL_ARRAY_BUFFER, userData->modelPositionVBO);
-	glVertexAttribPointer(POSITION_LOC, 3, GL_FLOAT,
-		GL_FALSE, 3 * sizeof(GLfloat), (const void*)NULL);
-	
 
-	// Load the vertex coordinate
-	glBindBuffer(GL_ARRAY_BUFFER, userData->modelTexcoordVBO);
-	glVertexAttribPointer(TEXTURE_LOC, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (const void*)NULL);
+	// Load the snorm16 position and the half float texture coordinate interleaved after it
+	QuantizedAttribPointers(&ObjData.quantized, POSITION_LOC, TEXTURE_LOC, -1);
 	
 
 	// Bind the index buffer
@@ -932,10 +645,11 @@ void DrawScene(ESContext* esContext,
 	// Draw model texture
 	// Assign texture data to the sampler
 	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, userData->modelTexId);
+	glBindTexture(GL_TEXTURE_2D, esGetStreamTexture(userData->textureStream, userData->modelTexture));
 	glUniform1i(userData->modelSamplerLoc, 1);
 
-	glDrawElements(GL_TRIANGLES, 3 * ObjData.updated_face_num, GL_UNSIGNED_INT, (const void*)NULL);
+	// only the clusters of the model in view
+	DrawMeshlets(&ObjData.meshlets, modelMeshletView, NULL);
 }
 
 void Draw(ESContext* esContext)
@@ -946,6 +660,9 @@ void Draw(ESContext* esContext)
 	//// Initialize matrices
 	//InitMVP(esContext);
 
+	// Upload what has been loaded of the textures since the last frame
+	esUpdateTextureStream(userData->textureStream);
+
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFramebuffer);
 
 	// FIRST PASS: Render the scene from light position to generate the shadow map texture
@@ -966,7 +683,7 @@ void Draw(ESContext* esContext)
 
 	glUseProgram(userData->shadowMapProgramObject);
 
-	DrawScene ( esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc );
+	DrawScene ( esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc, &userData->modelLightMeshletView );
 
 	glDisable(GL_POLYGON_OFFSET_FILL);
 
@@ -998,7 +715,7 @@ void Draw(ESContext* esContext)
 	// Set the sampler texture unit to 0
 	glUniform1i(userData->shadowMapSamplerLoc, 0);
 
-	DrawScene(esContext, userData->sceneMvpLoc, userData->sceneMvpLightLoc);
+	DrawScene(esContext, userData->sceneMvpLoc, userData->sceneMvpLightLoc, &userData->modelMeshletView);
 	
 }
 
@@ -1022,6 +739,9 @@ void Shutdown(ESContext* esContext)
 	glDeleteFramebuffers(1, &userData->shadowMapBufferId);
 	glDeleteTextures(1, &userData->shadowMapTextureId);
 
+	// Delete the streamed textures
+	esDestroyTextureStream(userData->textureStream);
+
 	// Delete program object
 	glDeleteProgram(userData->sceneProgramObject);
 	glDeleteProgram(userData->shadowMapProgramObject);
@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef MYBENCH_H
+#define MYBENCH_H
+
+// Helpers shared by the *Bench.c programs.
+// A benchmark is built like any other sample: put it in the project instead of MyObj3.c,
+// its esMain runs the measurements, prints a table and exits before the render loop starts.
+// The helpers are static inline, a benchmark which leaves one of them unused compiles without a warning.
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+// seconds from an arbitrary origin, only differences between two calls are meaningful
+static inline double BenchNow(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// peak resident memory of the process so far in bytes, 0 where it can't be queried.
+// It never goes down, measurements in one process have to go from the smallest to the largest.
+static inline size_t BenchPeakMemory(void)
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss;
+#else
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// a grid x grid vertex height field written to filename, two triangles per cell:
+// v / vt / vn per grid vertex, "f v/vt/vn" triangles with 1-based indices like an exported scan
+static inline int BenchWriteSyntheticObj(const char* filename, int grid)
+{
+	FILE* file = fopen(filename, "wb");
+	int ok;
+
+	if (file == NULL)
+		return FALSE;
+
+	fprintf(file, "# synthetic height field, %d x %d vertices\n", grid, grid);
+	for (int z = 0; z < grid; z++)
+	{
+		for (int x = 0; x < grid; x++)
+		{
+			float height = (float)((x * 7 + z * 13) % 101) * 0.001f;
+			fprintf(file, "v %.6f %.6f %.6f\n", x * 0.01f, height, z * 0.01f);
+		}
+	}
+	for (int z = 0; z < grid; z++)
+		for (int x = 0; x < grid; x++)
+			fprintf(file, "vt %.6f %.6f\n", (float)x / (grid - 1), (float)z / (grid - 1));
+	for (int z = 0; z < grid; z++)
+		for (int x = 0; x < grid; x++)
+			fprintf(file, "vn %.4f %.4f %.4f\n", 0.0f, 1.0f, 0.0f);
+
+	fprintf(file, "g grid\nusemtl default\n");
+	for (int z = 0; z + 1 < grid; z++)
+	{
+		for (int x = 0; x + 1 < grid; x++)
+		{
+			int a = z * grid + x + 1;
+			int b = a + 1;
+			int c = a + grid;
+			int d = c + 1;
+			fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b);
+			fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, c, c, c, d, d, d);
+		}
+	}
+
+	ok = !ferror(file);
+	ok = (fclose(file) == 0) && ok;
+	return ok;
+}
+
+#endif
@@ -0,0 +1,303 @@
+// myCullBench.c
+//
+//    Objects tested a microsecond against the frustum of a camera: the one-object-at-a-time test of
+//    MeshletVisible in myMeshlet.c (a struct a sphere, the six planes in turn with an early out) and
+//    the same for boxes (the corner furthest along each plane), against esCullSpheres and esCullBoxes
+//    testing four objects at a time from one array per component.
+//    Random objects in a cube around the camera, from a hundred to a million of them, the lists of
+//    visible objects are checked against each other: they may only differ for objects touching a
+//    plane, where the two add up the distance in a different order.
+//    Put this file in the project instead of MyObj3.c.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myBench.h"
+
+#define MAX_COUNT 1000000
+#define MIN_SECONDS 0.25
+#define TOLERANCE 1e-3f
+
+// the camera at the origin, the objects in a cube of twice FIELD around it
+#define FIELD 500.0f
+
+typedef struct
+{
+	GLfloat center[3];
+	GLfloat radius;
+} Sphere;
+
+typedef struct
+{
+	GLfloat min[3];
+	GLfloat max[3];
+} Box;
+
+// the objects both ways: a struct each and one array per component
+typedef struct
+{
+	Sphere* spheres;
+	Box* boxes;
+	GLfloat* components[10];   // center x, y, z and radius, then min x, y, z and max x, y, z
+	ESSphereArrays sphereArrays;
+	ESBoxArrays boxArrays;
+} Objects;
+
+typedef int (*CullOp)(const ESFrustumPlanes* frustum, const Objects* objects, int count, int* visible);
+
+// as MeshletVisible
+static int OldCullSpheres(const ESFrustumPlanes* frustum, const Objects* objects, int count, int* visible)
+{
+	int visibleNum = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		const Sphere* sphere = &objects->spheres[i];
+		int inside = TRUE;
+
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			const GLfloat* plane = frustum->planes[p];
+			inside = plane[0] * sphere->center[0] + plane[1] * sphere->center[1] + plane[2] * sphere->center[2] +
+				plane[3] >= -sphere->radius;
+		}
+		if (inside)
+			visible[visibleNum++] = i;
+	}
+	return visibleNum;
+}
+
+// the corner of the box furthest along each plane
+static int OldCullBoxes(const ESFrustumPlanes* frustum, const Objects* objects, int count, int* visible)
+{
+	int visibleNum = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		const Box* box = &objects->boxes[i];
+		int inside = TRUE;
+
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			const GLfloat* plane = frustum->planes[p];
+			GLfloat distance = plane[3];
+
+			for (int k = 0; k < 3; k++)
+				distance += plane[k] * (plane[k] >= 0.0f ? box->max[k] : box->min[k]);
+			inside = distance >= 0.0f;
+		}
+		if (inside)
+			visible[visibleNum++] = i;
+	}
+	return visibleNum;
+}
+
+static int NewCullSpheres(const ESFrustumPlanes* frustum, const Objects* objects, int count, int* visible)
+{
+	return esCullSpheres(frustum, &objects->sphereArrays, count, visible);
+}
+
+static int NewCullBoxes(const ESFrustumPlanes* frustum, const Objects* objects, int count, int* visible)
+{
+	return esCullBoxes(frustum, &objects->boxArrays, count, visible);
+}
+
+// how far the object is inside the frustum, negative outside
+static float Margin(const ESFrustumPlanes* frustum, const Objects* objects, int boxes, int i)
+{
+	float margin = INFINITY;
+
+	for (int p = 0; p < 6; p++)
+	{
+		const GLfloat* plane = frustum->planes[p];
+		float distance = plane[3];
+
+		for (int k = 0; k < 3; k++)
+		{
+			if (boxes)
+				distance += plane[k] * (plane[k] >= 0.0f ? objects->boxes[i].max[k] : objects->boxes[i].min[k]);
+			else
+				distance += plane[k] * objects->spheres[i].center[k];
+		}
+		if (!boxes)
+			distance += objects->spheres[i].radius;
+		margin = fminf(margin, distance);
+	}
+	return margin;
+}
+
+static float Random(unsigned int* state, float low, float high)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return low + (high - low) * (float)(*state >> 8) / 16777216.0f;
+}
+
+static int MakeObjects(Objects* objects)
+{
+	unsigned int state = 12345;
+
+	objects->spheres = malloc(sizeof(Sphere) * MAX_COUNT);
+	objects->boxes = malloc(sizeof(Box) * MAX_COUNT);
+	for (int c = 0; c < 10; c++)
+		objects->components[c] = malloc(sizeof(GLfloat) * MAX_COUNT);
+	if (objects->spheres == NULL || objects->boxes == NULL || objects->components[9] == NULL)
+		return FALSE;
+
+	for (int i = 0; i < MAX_COUNT; i++)
+	{
+		Sphere* sphere = &objects->spheres[i];
+		Box* box = &objects->boxes[i];
+
+		for (int k = 0; k < 3; k++)
+		{
+			GLfloat extent = Random(&state, 0.5f, 5.0f);
+
+			sphere->center[k] = Random(&state, -FIELD, FIELD);
+			box->min[k] = sphere->center[k] - extent;
+			box->max[k] = sphere->center[k] + extent;
+		}
+		sphere->radius = Random(&state, 0.5f, 5.0f);
+
+		for (int k = 0; k < 3; k++)
+		{
+			objects->components[k][i] = sphere->center[k];
+			objects->components[4 + k][i] = box->min[k];
+			objects->components[7 + k][i] = box->max[k];
+		}
+		objects->components[3][i] = sphere->radius;
+	}
+
+	objects->sphereArrays.centerX = objects->components[0];
+	objects->sphereArrays.centerY = objects->components[1];
+	objects->sphereArrays.centerZ = objects->components[2];
+	objects->sphereArrays.radius = objects->components[3];
+	objects->boxArrays.minX = objects->components[4];
+	objects->boxArrays.minY = objects->components[5];
+	objects->boxArrays.minZ = objects->components[6];
+	objects->boxArrays.maxX = objects->components[7];
+	objects->boxArrays.maxY = objects->components[8];
+	objects->boxArrays.maxZ = objects->components[9];
+	return TRUE;
+}
+
+static void FreeObjects(Objects* objects)
+{
+	free(objects->spheres);
+	free(objects->boxes);
+	for (int c = 0; c < 10; c++)
+		free(objects->components[c]);
+}
+
+// objects tested a microsecond, culling the first count of them for at least MIN_SECONDS
+static double TimeOp(CullOp op, const ESFrustumPlanes* frustum, const Objects* objects, int count, int* visible,
+	int* visibleNum)
+{
+	double start = BenchNow(), seconds;
+	int runs = 0;
+
+	do
+	{
+		*visibleNum = op(frustum, objects, count, visible);
+		runs++;
+		seconds = BenchNow() - start;
+	} while (seconds < MIN_SECONDS);
+	return (double)runs * count / seconds * 1e-6;
+}
+
+// objects in one list and not the other, FAILED for any of them further than TOLERANCE from the frustum
+static int CompareVisible(const ESFrustumPlanes* frustum, const Objects* objects, int boxes,
+	const int* expected, int expectedNum, const int* actual, int actualNum, int* failed)
+{
+	int differ = 0;
+	int i = 0, j = 0;
+
+	while (i < expectedNum || j < actualNum)
+	{
+		int object;
+
+		if (j == actualNum || (i < expectedNum && expected[i] < actual[j]))
+			object = expected[i++];
+		else if (i == expectedNum || actual[j] < expected[i])
+			object = actual[j++];
+		else
+		{
+			i++;
+			j++;
+			continue;
+		}
+		differ++;
+		*failed += fabsf(Margin(frustum, objects, boxes, object)) > TOLERANCE;
+	}
+	return differ;
+}
+
+int esMain(ESContext* esContext)
+{
+	static const struct
+	{
+		const char* name;
+		int boxes;
+		CullOp reference;
+		CullOp op;
+	} cases[] =
+	{
+		{ "spheres", FALSE, OldCullSpheres, NewCullSpheres },
+		{ "boxes", TRUE, OldCullBoxes, NewCullBoxes },
+	};
+	static const int counts[] = { 100, 1000, 10000, 100000, 1000000 };
+	Objects objects;
+	ESMatrix view, projection, viewProjection;
+	ESFrustumPlanes frustum;
+	int* expected = malloc(sizeof(int) * MAX_COUNT);
+	int* actual = malloc(sizeof(int) * MAX_COUNT);
+	int failed = 0;
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	memset(&objects, 0, sizeof(Objects));
+	if (expected == NULL || actual == NULL || !MakeObjects(&objects))
+	{
+		printf("out of memory\n");
+		exit(1);
+	}
+
+	// the camera turned off the axes, so the frustum crosses the cube at an angle
+	esMatrixLookAt(&view, 0.0f, 0.0f, 0.0f, 1.0f, 0.2f, -2.0f, 0.0f, 1.0f, 0.0f);
+	esMatrixLoadIdentity(&projection);
+	esPerspective(&projection, 60.0f, 4.0f / 3.0f, 0.1f, FIELD);
+	esMatrixMultiply(&viewProjection, &view, &projection);
+	esFrustumPlanesFromMatrix(&frustum, &viewProjection);
+
+	printf("objects tested a microsecond\n");
+	printf("%-8s %8s %8s %10s %10s %8s   %s\n", "", "objects", "visible", "one by one", "four wide", "speedup",
+		"lists");
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+	{
+		for (int n = 0; n < (int)(sizeof(counts) / sizeof(counts[0])); n++)
+		{
+			int expectedNum, actualNum, caseFailed = 0;
+			double before = TimeOp(cases[c].reference, &frustum, &objects, counts[n], expected, &expectedNum);
+			double after = TimeOp(cases[c].op, &frustum, &objects, counts[n], actual, &actualNum);
+			int differ = CompareVisible(&frustum, &objects, cases[c].boxes, expected, expectedNum, actual, actualNum,
+				&caseFailed);
+
+			if (differ == 0)
+				printf("%-8s %8d %8d %10.1f %10.1f %7.1fx   identical\n", cases[c].name, counts[n], expectedNum, before,
+					after, after / before);
+			else
+				printf("%-8s %8d %8d %10.1f %10.1f %7.1fx   %d on a plane%s\n", cases[c].name, counts[n], expectedNum,
+					before, after, after / before, differ, caseFailed ? " FAILED" : "");
+			failed += caseFailed;
+		}
+	}
+
+	FreeObjects(&objects);
+	free(expected);
+	free(actual);
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
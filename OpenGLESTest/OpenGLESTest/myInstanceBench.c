@@ -0,0 +1,298 @@
+// myInstanceBench.c
+//
+//    Nanoseconds per instance to compute the MVP matrices of an instanced draw, from a hundred to a
+//    million instances: the loop of Chapter_7/Instancing with a scale added (esMatrixLoadIdentity,
+//    esTranslate, esRotate, esScale and esMatrixMultiply per instance) against esComposeTRSBatch on
+//    the calling thread and on a pool of one thread per processor, and a loop of esMatrixMultiply
+//    against esMatrixMultiplyBatch.
+//    Every batch is checked against its loop.
+//    With a window the MVPs are written into a mapped GL_ARRAY_BUFFER as the sample does.
+//    Put this file in the project instead of MyObj3.c.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myBench.h"
+
+#define MAX_INSTANCES 1000000
+#define MIN_SECONDS 0.25
+#define TOLERANCE 1e-5f
+
+#define PI 3.1415926535897932384626433832795f
+
+typedef struct
+{
+	// what the loop is given, an angle in degrees about an axis
+	GLfloat* angle;
+	GLfloat* axis[3];
+
+	// the same rotation as a quaternion, translations and scales for both
+	GLfloat* translate[3];
+	GLfloat* rotate[4];
+	GLfloat* scale[3];
+	ESTRSArrays trs;
+
+	ESMatrix* models;
+	ESMatrix viewProjection;
+} Instances;
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+static void MakeInstances(Instances* in)
+{
+	ESMatrix view;
+
+	in->angle = malloc(sizeof(GLfloat) * MAX_INSTANCES);
+	for (int k = 0; k < 3; k++)
+	{
+		in->axis[k] = malloc(sizeof(GLfloat) * MAX_INSTANCES);
+		in->translate[k] = malloc(sizeof(GLfloat) * MAX_INSTANCES);
+		in->scale[k] = malloc(sizeof(GLfloat) * MAX_INSTANCES);
+	}
+	for (int k = 0; k < 4; k++)
+		in->rotate[k] = malloc(sizeof(GLfloat) * MAX_INSTANCES);
+	in->models = malloc(sizeof(ESMatrix) * MAX_INSTANCES);
+
+	srand(1);
+	for (int i = 0; i < MAX_INSTANCES; i++)
+	{
+		float axis[3], length, halfSin;
+
+		do
+		{
+			for (int k = 0; k < 3; k++)
+				axis[k] = Random(-1.0f, 1.0f);
+			length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		} while (length < 0.1f);
+
+		in->angle[i] = Random(0.0f, 360.0f);
+		halfSin = sinf(in->angle[i] * PI / 360.0f) / length;
+		for (int k = 0; k < 3; k++)
+		{
+			in->axis[k][i] = axis[k];
+			in->rotate[k][i] = axis[k] * halfSin;
+			in->translate[k][i] = Random(-10.0f, 10.0f);
+			in->scale[k][i] = Random(0.5f, 2.0f);
+		}
+		in->rotate[3][i] = cosf(in->angle[i] * PI / 360.0f);
+	}
+
+	in->trs.translateX = in->translate[0];
+	in->trs.translateY = in->translate[1];
+	in->trs.translateZ = in->translate[2];
+	in->trs.rotateX = in->rotate[0];
+	in->trs.rotateY = in->rotate[1];
+	in->trs.rotateZ = in->rotate[2];
+	in->trs.rotateW = in->rotate[3];
+	in->trs.scaleX = in->scale[0];
+	in->trs.scaleY = in->scale[1];
+	in->trs.scaleZ = in->scale[2];
+
+	esMatrixLoadIdentity(&in->viewProjection);
+	esPerspective(&in->viewProjection, 60.0f, 4.0f / 3.0f, 1.0f, 50.0f);
+	esMatrixLookAt(&view, 0.0f, 5.0f, 25.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+	esMatrixMultiply(&in->viewProjection, &view, &in->viewProjection);
+}
+
+static void FreeInstances(Instances* in)
+{
+	free(in->angle);
+	for (int k = 0; k < 3; k++)
+	{
+		free(in->axis[k]);
+		free(in->translate[k]);
+		free(in->scale[k]);
+	}
+	for (int k = 0; k < 4; k++)
+		free(in->rotate[k]);
+	free(in->models);
+}
+
+// the model matrix of instance i as the sample builds it
+static void LoopModel(const Instances* in, int i, ESMatrix* model)
+{
+	esMatrixLoadIdentity(model);
+	esTranslate(model, in->translate[0][i], in->translate[1][i], in->translate[2][i]);
+	esRotate(model, in->angle[i], in->axis[0][i], in->axis[1][i], in->axis[2][i]);
+	esScale(model, in->scale[0][i], in->scale[1][i], in->scale[2][i]);
+}
+
+typedef void (*InstanceOp)(ESThreadPool* pool, const Instances* in, int count, ESMatrix* result);
+
+static void LoopCompose(ESThreadPool* pool, const Instances* in, int count, ESMatrix* result)
+{
+	ESMatrix viewProjection = in->viewProjection;
+
+	// the scalar references run on the calling thread only
+	(void)pool;
+
+	for (int i = 0; i < count; i++)
+	{
+		ESMatrix model;
+
+		LoopModel(in, i, &model);
+		esMatrixMultiply(&result[i], &model, &viewProjection);
+	}
+}
+
+static void BatchCompose(ESThreadPool* pool, const Instances* in, int count, ESMatrix* result)
+{
+	esComposeTRSBatch(pool, result, &in->trs, &in->viewProjection, count);
+}
+
+static void LoopMultiply(ESThreadPool* pool, const Instances* in, int count, ESMatrix* result)
+{
+	ESMatrix viewProjection = in->viewProjection;
+
+	(void)pool;
+
+	for (int i = 0; i < count; i++)
+		esMatrixMultiply(&result[i], &in->models[i], &viewProjection);
+}
+
+static void BatchMultiply(ESThreadPool* pool, const Instances* in, int count, ESMatrix* result)
+{
+	esMatrixMultiplyBatch(pool, result, in->models, &in->viewProjection, count);
+}
+
+// nanoseconds per instance
+static double TimeOp(InstanceOp op, ESThreadPool* pool, const Instances* in, int count, ESMatrix* result)
+{
+	int iterations = 0;
+	double start = BenchNow();
+	double elapsed;
+
+	do
+	{
+		op(pool, in, count, result);
+		iterations++;
+		elapsed = BenchNow() - start;
+	} while (elapsed < MIN_SECONDS);
+	return elapsed / ((double)iterations * count) * 1e9;
+}
+
+// largest difference relative to the largest element of the matrix
+static float MaxError(const ESMatrix* expected, const ESMatrix* actual, int count)
+{
+	float worst = 0.0f;
+
+	for (int i = 0; i < count; i++)
+	{
+		float largest = 0.0f, error = 0.0f;
+
+		for (int j = 0; j < 16; j++)
+		{
+			float e = (&expected[i].m[0][0])[j];
+			float a = (&actual[i].m[0][0])[j];
+
+			largest = fmaxf(largest, fabsf(e));
+			error = fmaxf(error, fabsf(e - a));
+		}
+		if (largest > 0.0f && error / largest > worst)
+			worst = error / largest;
+	}
+	return worst;
+}
+
+// nanoseconds per instance to map a buffer of count matrices, fill it and unmap it
+static double TimeMapped(ESThreadPool* pool, const Instances* in, int count, GLboolean batch)
+{
+	int iterations = 0;
+	double start = BenchNow();
+	double elapsed;
+	GLuint buffer;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(ESMatrix) * count, NULL, GL_DYNAMIC_DRAW);
+	do
+	{
+		ESMatrix* matrixBuf = (ESMatrix*)glMapBufferRange(GL_ARRAY_BUFFER, 0, sizeof(ESMatrix) * count,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+		if (matrixBuf == NULL)
+			break;
+		if (batch)
+			BatchCompose(pool, in, count, matrixBuf);
+		else
+			LoopCompose(pool, in, count, matrixBuf);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glFinish();
+		iterations++;
+		elapsed = BenchNow() - start;
+	} while (elapsed < MIN_SECONDS);
+	glDeleteBuffers(1, &buffer);
+	return iterations == 0 ? 0.0 : elapsed / ((double)iterations * count) * 1e9;
+}
+
+int esMain(ESContext* esContext)
+{
+	static const struct
+	{
+		const char* name;
+		InstanceOp loop;
+		InstanceOp batch;
+	} cases[] =
+	{
+		{ "esComposeTRSBatch", LoopCompose, BatchCompose },
+		{ "esMatrixMultiplyBatch", LoopMultiply, BatchMultiply },
+	};
+	int window = esCreateWindow(esContext, "myInstanceBench", 64, 64, ES_WINDOW_RGB);
+	ESThreadPool* pool = esCreateThreadPool(0);
+	Instances* in = malloc(sizeof(Instances));
+	ESMatrix* expected = malloc(sizeof(ESMatrix) * MAX_INSTANCES);
+	ESMatrix* actual = malloc(sizeof(ESMatrix) * MAX_INSTANCES);
+	int failed = 0;
+
+	MakeInstances(in);
+	for (int i = 0; i < MAX_INSTANCES; i++)
+		LoopModel(in, i, &in->models[i]);
+
+	printf("nanoseconds an instance, %d threads in the pool\n", esGetThreadCount(pool));
+	printf("%-22s %9s %10s %10s %10s %8s   %s\n", "", "instances", "loop", "1 thread", "pool", "speedup",
+		"off the loop by");
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+	{
+		for (int count = 100; count <= MAX_INSTANCES; count *= 10)
+		{
+			double loop = TimeOp(cases[c].loop, NULL, in, count, expected);
+			double single = TimeOp(cases[c].batch, NULL, in, count, actual);
+			double parallel = TimeOp(cases[c].batch, pool, in, count, actual);
+			float error = MaxError(expected, actual, count);
+
+			if (memcmp(expected, actual, sizeof(ESMatrix) * count) == 0)
+				printf("%-22s %9d %10.2f %10.2f %10.2f %7.1fx   identical\n", cases[c].name, count, loop, single,
+					parallel, loop / parallel);
+			else
+				printf("%-22s %9d %10.2f %10.2f %10.2f %7.1fx   %g%s\n", cases[c].name, count, loop, single,
+					parallel, loop / parallel, error, error > TOLERANCE ? " FAILED" : "");
+			failed += error > TOLERANCE;
+		}
+	}
+
+	if (window)
+	{
+		printf("\nnanoseconds an instance into a mapped GL_ARRAY_BUFFER, until glFinish returns\n");
+		printf("%-22s %9s %10s %10s\n", "", "instances", "loop", "pool");
+		for (int count = 100; count <= MAX_INSTANCES; count *= 10)
+		{
+			double loop = TimeMapped(pool, in, count, GL_FALSE);
+
+			printf("%-22s %9d %10.2f %10.2f\n", "Instancing Update", count, loop, TimeMapped(pool, in, count, GL_TRUE));
+		}
+	}
+
+	FreeInstances(in);
+	free(in);
+	free(expected);
+	free(actual);
+	esDestroyThreadPool(pool);
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
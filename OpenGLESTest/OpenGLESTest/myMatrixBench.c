@@ -0,0 +1,368 @@
+// myMatrixBench.c
+//
+//    Nanoseconds per call of the ESMatrix functions of esTransform.c against the scalar versions
+//    they replace (a temporary matrix and a memcpy per product, a full rotation matrix per esRotate,
+//    three divisions per axis in esMatrixLookAt), on 1024 different matrices so nothing is hoisted
+//    out of the loop. Every result is checked against its scalar version, and the InitMVP chain of
+//    MyObj4 (two LookAt and four products per object) is timed as a whole.
+//    Put this file in the project instead of MyObj3.c.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myBench.h"
+
+#define COUNT 1024
+#define MIN_SECONDS 0.25
+#define TOLERANCE 1e-5f
+
+#define PI 3.1415926535897932384626433832795f
+
+// esTransform.c as it was
+static void RefMultiply(ESMatrix* result, const ESMatrix* srcA, const ESMatrix* srcB)
+{
+	ESMatrix tmp;
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			tmp.m[i][j] = (srcA->m[i][0] * srcB->m[0][j]) +
+				(srcA->m[i][1] * srcB->m[1][j]) +
+				(srcA->m[i][2] * srcB->m[2][j]) +
+				(srcA->m[i][3] * srcB->m[3][j]);
+		}
+	}
+	memcpy(result, &tmp, sizeof(ESMatrix));
+}
+
+static void RefScale(ESMatrix* result, GLfloat sx, GLfloat sy, GLfloat sz)
+{
+	for (int j = 0; j < 4; j++)
+	{
+		result->m[0][j] *= sx;
+		result->m[1][j] *= sy;
+		result->m[2][j] *= sz;
+	}
+}
+
+static void RefTranslate(ESMatrix* result, GLfloat tx, GLfloat ty, GLfloat tz)
+{
+	for (int j = 0; j < 4; j++)
+		result->m[3][j] += (result->m[0][j] * tx + result->m[1][j] * ty + result->m[2][j] * tz);
+}
+
+static void RefRotate(ESMatrix* result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
+{
+	GLfloat sinAngle = sinf(angle * PI / 180.0f);
+	GLfloat cosAngle = cosf(angle * PI / 180.0f);
+	GLfloat mag = sqrtf(x * x + y * y + z * z);
+	GLfloat oneMinusCos = 1.0f - cosAngle;
+	GLfloat xx, yy, zz, xy, yz, zx, xs, ys, zs;
+	ESMatrix rotMat;
+
+	if (mag <= 0.0f)
+		return;
+	x /= mag;
+	y /= mag;
+	z /= mag;
+	xx = x * x;
+	yy = y * y;
+	zz = z * z;
+	xy = x * y;
+	yz = y * z;
+	zx = z * x;
+	xs = x * sinAngle;
+	ys = y * sinAngle;
+	zs = z * sinAngle;
+
+	rotMat.m[0][0] = (oneMinusCos * xx) + cosAngle;
+	rotMat.m[0][1] = (oneMinusCos * xy) - zs;
+	rotMat.m[0][2] = (oneMinusCos * zx) + ys;
+	rotMat.m[0][3] = 0.0f;
+	rotMat.m[1][0] = (oneMinusCos * xy) + zs;
+	rotMat.m[1][1] = (oneMinusCos * yy) + cosAngle;
+	rotMat.m[1][2] = (oneMinusCos * yz) - xs;
+	rotMat.m[1][3] = 0.0f;
+	rotMat.m[2][0] = (oneMinusCos * zx) - ys;
+	rotMat.m[2][1] = (oneMinusCos * yz) + xs;
+	rotMat.m[2][2] = (oneMinusCos * zz) + cosAngle;
+	rotMat.m[2][3] = 0.0f;
+	rotMat.m[3][0] = rotMat.m[3][1] = rotMat.m[3][2] = 0.0f;
+	rotMat.m[3][3] = 1.0f;
+	RefMultiply(result, &rotMat, result);
+}
+
+static void Normalize(float v[3])
+{
+	float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+	if (length != 0.0f)
+	{
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+static void RefLookAt(ESMatrix* result, const float pos[3], const float lookAt[3], const float up[3])
+{
+	float axisX[3], axisY[3], axisZ[3];
+
+	for (int k = 0; k < 3; k++)
+		axisZ[k] = lookAt[k] - pos[k];
+	Normalize(axisZ);
+	axisX[0] = up[1] * axisZ[2] - up[2] * axisZ[1];
+	axisX[1] = up[2] * axisZ[0] - up[0] * axisZ[2];
+	axisX[2] = up[0] * axisZ[1] - up[1] * axisZ[0];
+	Normalize(axisX);
+	axisY[0] = axisZ[1] * axisX[2] - axisZ[2] * axisX[1];
+	axisY[1] = axisZ[2] * axisX[0] - axisZ[0] * axisX[2];
+	axisY[2] = axisZ[0] * axisX[1] - axisZ[1] * axisX[0];
+	Normalize(axisY);
+
+	memset(result, 0x0, sizeof(ESMatrix));
+	for (int k = 0; k < 3; k++)
+	{
+		result->m[k][0] = -axisX[k];
+		result->m[k][1] = axisY[k];
+		result->m[k][2] = -axisZ[k];
+	}
+	result->m[3][0] = axisX[0] * pos[0] + axisX[1] * pos[1] + axisX[2] * pos[2];
+	result->m[3][1] = -axisY[0] * pos[0] - axisY[1] * pos[1] - axisY[2] * pos[2];
+	result->m[3][2] = axisZ[0] * pos[0] + axisZ[1] * pos[1] + axisZ[2] * pos[2];
+	result->m[3][3] = 1.0f;
+}
+
+// inputs of every call: a, b and 9 parameters
+typedef struct
+{
+	ESMatrix a[COUNT];
+	ESMatrix b[COUNT];
+	GLfloat p[COUNT][9];
+	ESMatrix projection;
+} Inputs;
+
+typedef void (*MatrixOp)(ESMatrix* out, const Inputs* in, int i);
+
+static void OldMultiply(ESMatrix* out, const Inputs* in, int i)
+{
+	RefMultiply(out, &in->a[i], &in->b[i]);
+}
+
+static void NewMultiply(ESMatrix* out, const Inputs* in, int i)
+{
+	esMatrixMultiply(out, (ESMatrix*)&in->a[i], (ESMatrix*)&in->b[i]);
+}
+
+static void OldModelviewProjection(ESMatrix* out, const Inputs* in, int i)
+{
+	RefMultiply(out, &in->a[i], &in->projection);
+}
+
+static void NewModelviewProjection(ESMatrix* out, const Inputs* in, int i)
+{
+	esMatrixMultiplyAffine(out, &in->a[i], &in->projection);
+}
+
+static void OldRotate(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	RefRotate(out, in->p[i][0], in->p[i][1], in->p[i][2], in->p[i][3]);
+}
+
+static void NewRotate(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	esRotate(out, in->p[i][0], in->p[i][1], in->p[i][2], in->p[i][3]);
+}
+
+static void OldTranslate(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	RefTranslate(out, in->p[i][0], in->p[i][1], in->p[i][2]);
+}
+
+static void NewTranslate(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	esTranslate(out, in->p[i][0], in->p[i][1], in->p[i][2]);
+}
+
+static void OldScale(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	RefScale(out, in->p[i][0], in->p[i][1], in->p[i][2]);
+}
+
+static void NewScale(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	esScale(out, in->p[i][0], in->p[i][1], in->p[i][2]);
+}
+
+static void OldLookAt(ESMatrix* out, const Inputs* in, int i)
+{
+	static const float up[3] = { 0.0f, 1.0f, 0.0f };
+
+	RefLookAt(out, in->p[i], in->p[i] + 3, up);
+}
+
+static void NewLookAt(ESMatrix* out, const Inputs* in, int i)
+{
+	const GLfloat* p = in->p[i];
+
+	esMatrixLookAt(out, p[0], p[1], p[2], p[3], p[4], p[5], 0.0f, 1.0f, 0.0f);
+}
+
+// InitMVP of MyObj4 for one object: the model, then its MVP from the eye and from the light
+static void OldInitMVP(ESMatrix* out, const Inputs* in, int i)
+{
+	static const float up[3] = { 0.0f, 1.0f, 0.0f };
+	ESMatrix model, view, modelview, mvp;
+	const GLfloat* p = in->p[i];
+
+	esMatrixLoadIdentity(&model);
+	RefTranslate(&model, p[0], p[1], p[2]);
+	RefRotate(&model, p[6], 0.0f, 1.0f, 0.0f);
+	RefLookAt(&view, p + 3, p, up);
+	RefMultiply(&modelview, &model, &view);
+	RefMultiply(&mvp, &modelview, &in->projection);
+	RefLookAt(&view, p + 6, p, up);
+	RefMultiply(&modelview, &model, &view);
+	RefMultiply(out, &modelview, &in->projection);
+	out->m[0][0] += mvp.m[0][0];
+}
+
+static void NewInitMVP(ESMatrix* out, const Inputs* in, int i)
+{
+	ESMatrix model, view, modelview, mvp;
+	const GLfloat* p = in->p[i];
+
+	esMatrixLoadIdentity(&model);
+	esTranslate(&model, p[0], p[1], p[2]);
+	esRotate(&model, p[6], 0.0f, 1.0f, 0.0f);
+	esMatrixLookAt(&view, p[3], p[4], p[5], p[0], p[1], p[2], 0.0f, 1.0f, 0.0f);
+	esMatrixMultiplyAffine(&modelview, &model, &view);
+	esMatrixMultiplyAffine(&mvp, &modelview, (ESMatrix*)&in->projection);
+	esMatrixLookAt(&view, p[6], p[7], p[8], p[0], p[1], p[2], 0.0f, 1.0f, 0.0f);
+	esMatrixMultiplyAffine(&modelview, &model, &view);
+	esMatrixMultiplyAffine(out, &modelview, (ESMatrix*)&in->projection);
+	out->m[0][0] += mvp.m[0][0];
+}
+
+static float Random(unsigned int* state, float low, float high)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return low + (high - low) * (float)(*state >> 8) / 16777216.0f;
+}
+
+static void MakeInputs(Inputs* in)
+{
+	unsigned int state = 12345;
+
+	esMatrixLoadIdentity(&in->projection);
+	esPerspective(&in->projection, 45.0f, 4.0f / 3.0f, 0.1f, 100.0f);
+	for (int i = 0; i < COUNT; i++)
+	{
+		for (int k = 0; k < 9; k++)
+			in->p[i][k] = Random(&state, -20.0f, 20.0f);
+
+		// a an affine model matrix, b anything
+		esMatrixLoadIdentity(&in->a[i]);
+		RefTranslate(&in->a[i], in->p[i][0], in->p[i][1], in->p[i][2]);
+		RefScale(&in->a[i], Random(&state, 0.1f, 4.0f), Random(&state, 0.1f, 4.0f), Random(&state, 0.1f, 4.0f));
+		RefRotate(&in->a[i], in->p[i][3], in->p[i][4], in->p[i][5], in->p[i][6]);
+		for (int k = 0; k < 16; k++)
+			in->b[i].m[k / 4][k % 4] = Random(&state, -2.0f, 2.0f);
+	}
+}
+
+// average nanoseconds of one call, repeated over all the inputs for at least MIN_SECONDS
+static double TimeOp(MatrixOp op, const Inputs* in, ESMatrix* out)
+{
+	double start = BenchNow(), seconds;
+	int runs = 0;
+
+	do
+	{
+		for (int i = 0; i < COUNT; i++)
+			op(&out[i], in, i);
+		runs++;
+		seconds = BenchNow() - start;
+	} while (seconds < MIN_SECONDS);
+	return seconds / ((double)runs * COUNT) * 1e9;
+}
+
+// largest difference between two sets of results, relative to the size of the expected one
+static float MaxError(const ESMatrix* expected, const ESMatrix* actual, int* differ)
+{
+	float error = 0.0f;
+
+	*differ = 0;
+	for (int i = 0; i < COUNT; i++)
+	{
+		for (int k = 0; k < 16; k++)
+		{
+			float e = expected[i].m[k / 4][k % 4], a = actual[i].m[k / 4][k % 4];
+			float d = fabsf(e - a) / (fabsf(e) > 1.0f ? fabsf(e) : 1.0f);
+
+			*differ += e != a;
+			error = d > error ? d : error;
+		}
+	}
+	return error;
+}
+
+int esMain(ESContext* esContext)
+{
+	static const struct
+	{
+		const char* name;
+		MatrixOp reference;
+		MatrixOp op;
+	} cases[] =
+	{
+		{ "esMatrixMultiply", OldMultiply, NewMultiply },
+		{ "esMatrixMultiplyAffine", OldModelviewProjection, NewModelviewProjection },
+		{ "esRotate", OldRotate, NewRotate },
+		{ "esTranslate", OldTranslate, NewTranslate },
+		{ "esScale", OldScale, NewScale },
+		{ "esMatrixLookAt", OldLookAt, NewLookAt },
+		{ "InitMVP of one object", OldInitMVP, NewInitMVP },
+	};
+	Inputs* in = malloc(sizeof(Inputs));
+	ESMatrix* expected = malloc(sizeof(ESMatrix) * COUNT);
+	ESMatrix* actual = malloc(sizeof(ESMatrix) * COUNT);
+	int failed = 0;
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	MakeInputs(in);
+	printf("nanoseconds a call over %d matrices\n", COUNT);
+	printf("%-24s %10s %12s %8s   %s\n", "", "scalar", "esTransform", "speedup", "off the scalar version by");
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+	{
+		double before = TimeOp(cases[c].reference, in, expected);
+		double after = TimeOp(cases[c].op, in, actual);
+		int differ;
+		float error = MaxError(expected, actual, &differ);
+
+		if (differ == 0)
+			printf("%-24s %10.2f %12.2f %7.1fx   identical\n", cases[c].name, before, after, before / after);
+		else
+			printf("%-24s %10.2f %12.2f %7.1fx   %g in %d values%s\n", cases[c].name, before, after, before / after,
+				error, differ, error > TOLERANCE ? " FAILED" : "");
+		failed += error > TOLERANCE;
+	}
+
+	free(in);
+	free(expected);
+	free(actual);
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,495 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "myMesh.h"
+#include "myUtil.h"
+
+// every stream starts on a 16 byte boundary so it can be handed to SIMD code or glBufferData as is
+#define MESH_ALIGNMENT 16
+
+static size_t AlignSize(size_t size)
+{
+	return (size + MESH_ALIGNMENT - 1) & ~(size_t)(MESH_ALIGNMENT - 1);
+}
+
+int ArenaInit(MeshArena* arena, size_t size)
+{
+	memset(arena, 0, sizeof(MeshArena));
+	if (size == 0)
+		return TRUE;
+
+	// malloc only guarantees 8 byte alignment on 32 bit platforms, keep room to round up
+	arena->base = (unsigned char*)malloc(size + MESH_ALIGNMENT);
+	if (arena->base == NULL)
+		return FALSE;
+
+	arena->size = size + MESH_ALIGNMENT;
+	arena->used = AlignSize((size_t)arena->base) - (size_t)arena->base;
+	return TRUE;
+}
+
+void* ArenaAlloc(MeshArena* arena, size_t size)
+{
+	void* ret;
+
+	size = AlignSize(size);
+	if (arena->base == NULL || size > arena->size - arena->used)
+		return NULL;
+
+	ret = arena->base + arena->used;
+	arena->used += size;
+	return ret;
+}
+
+void ArenaFree(MeshArena* arena)
+{
+	free(arena->base);
+	memset(arena, 0, sizeof(MeshArena));
+}
+
+int MeshFromObj(const ObjFile* obj, MeshData* mesh)
+{
+	size_t positionsSize = sizeof(GLfloat) * 3 * obj->v_num;
+	size_t texCoordsSize = sizeof(GLfloat) * 2 * obj->vt_num;
+	size_t normalsSize = sizeof(GLfloat) * 3 * obj->vn_num;
+	size_t facesSize = sizeof(int) * obj->f_num;
+	size_t cornersSize = sizeof(int) * obj->corner_num;
+
+	memset(mesh, 0, sizeof(MeshData));
+
+	if (!ArenaInit(&mesh->arena,
+		AlignSize(positionsSize) + AlignSize(texCoordsSize) + AlignSize(normalsSize) +
+		AlignSize(facesSize) + 3 * AlignSize(cornersSize)))
+	{
+		printf("out of memory for a mesh of %d vertices\n", obj->v_num);
+		return FALSE;
+	}
+
+	mesh->v_num = obj->v_num;
+	mesh->vt_num = obj->vt_num;
+	mesh->vn_num = obj->vn_num;
+	mesh->f_num = obj->f_num;
+	mesh->corner_num = obj->corner_num;
+
+	// the arena was sized for exactly these streams, none of the allocations can fail
+	mesh->positions = (GLfloat*)ArenaAlloc(&mesh->arena, positionsSize);
+	mesh->texCoords = (GLfloat*)ArenaAlloc(&mesh->arena, texCoordsSize);
+	mesh->normals = (GLfloat*)ArenaAlloc(&mesh->arena, normalsSize);
+	mesh->face_counts = (int*)ArenaAlloc(&mesh->arena, facesSize);
+	mesh->fvIndices = (int*)ArenaAlloc(&mesh->arena, cornersSize);
+	mesh->ftIndices = (int*)ArenaAlloc(&mesh->arena, cornersSize);
+	mesh->fnIndices = (int*)ArenaAlloc(&mesh->arena, cornersSize);
+
+	// empty arrays of obj are NULL, memcpy must not see them even with a size of 0
+	if (positionsSize > 0)
+		memcpy(mesh->positions, obj->vArr, positionsSize);
+	if (texCoordsSize > 0)
+		memcpy(mesh->texCoords, obj->vtArr, texCoordsSize);
+	if (normalsSize > 0)
+		memcpy(mesh->normals, obj->vnArr, normalsSize);
+	if (facesSize > 0)
+		memcpy(mesh->face_counts, obj->face_counts, facesSize);
+	if (cornersSize > 0)
+	{
+		memcpy(mesh->fvIndices, obj->fvArr, cornersSize);
+		memcpy(mesh->ftIndices, obj->ftArr, cornersSize);
+		memcpy(mesh->fnIndices, obj->fnArr, cornersSize);
+	}
+
+	return TRUE;
+}
+
+int LoadObjMesh(const char* filename, MeshData* mesh)
+{
+	ObjFile obj;
+	int ret;
+
+	if (!LoadObjFile(filename, &obj))
+	{
+		memset(mesh, 0, sizeof(MeshData));
+		return FALSE;
+	}
+
+	ret = MeshFromObj(&obj, mesh);
+
+	FreeObjFile(&obj);
+	return ret;
+}
+
+void FreeMesh(MeshData* mesh)
+{
+	ArenaFree(&mesh->arena);
+	memset(mesh, 0, sizeof(MeshData));
+}
+
+// 2d cross product of (b - a) and (c - b), positive when a, b, c turn counter-clockwise
+static float Turn(const float* a, const float* b, const float* c)
+{
+	return (b[0] - a[0]) * (c[1] - b[1]) - (b[1] - a[1]) * (c[0] - b[0]);
+}
+
+static int InTriangle(const float* p, const float* a, const float* b, const float* c, float orientation)
+{
+	return Turn(a, b, p) * orientation >= 0.0f && Turn(b, c, p) * orientation >= 0.0f &&
+		Turn(c, a, p) * orientation >= 0.0f;
+}
+
+void TriangulatePolygon(const GLfloat* positions, int count, unsigned short* tris)
+{
+	float points[MESH_MAX_CLIP_CORNERS][2];
+	unsigned short remaining[MESH_MAX_CLIP_CORNERS];
+	float normal[3] = { 0.0f, 0.0f, 0.0f };
+	float orientation = 0.0f;
+	int axisX = 0, axisY = 1;
+	int convex = TRUE;
+	int left, out = 0;
+
+	if (positions != NULL && count > 3 && count <= MESH_MAX_CLIP_CORNERS)
+	{
+		float nx, ny, nz;
+
+		// Newell's normal of the face
+		for (int i = 0; i < count; i++)
+		{
+			const GLfloat* a = positions + i * 3;
+			const GLfloat* b = positions + ((i + 1) % count) * 3;
+			normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+			normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+			normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+		}
+
+		// project onto the plane of the two smaller normal components, keeping the winding
+		nx = fabsf(normal[0]);
+		ny = fabsf(normal[1]);
+		nz = fabsf(normal[2]);
+		if (nx >= ny && nx >= nz)
+		{
+			axisX = 1;
+			axisY = 2;
+			orientation = normal[0];
+		}
+		else if (ny >= nz)
+		{
+			axisX = 2;
+			axisY = 0;
+			orientation = normal[1];
+		}
+		else
+		{
+			orientation = normal[2];
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			points[i][0] = positions[i * 3 + axisX];
+			points[i][1] = positions[i * 3 + axisY];
+		}
+		for (int i = 0; i < count && convex; i++)
+			convex = Turn(points[i], points[(i + 1) % count], points[(i + 2) % count]) * orientation >= 0.0f;
+	}
+
+	// triangles, convex faces, flat or degenerate ones and faces without positions are fanned
+	if (orientation == 0.0f || convex)
+	{
+		for (int i = 1; i + 1 < count; i++)
+		{
+			tris[out++] = 0;
+			tris[out++] = (unsigned short)i;
+			tris[out++] = (unsigned short)(i + 1);
+		}
+		return;
+	}
+
+	for (int i = 0; i < count; i++)
+		remaining[i] = (unsigned short)i;
+
+	for (left = count; left > 3; left--)
+	{
+		int ear = 0;
+
+		for (int i = 0; i < left; i++)
+		{
+			const float* a = points[remaining[(i + left - 1) % left]];
+			const float* b = points[remaining[i]];
+			const float* c = points[remaining[(i + 1) % left]];
+			int empty = Turn(a, b, c) * orientation > 0.0f;
+
+			// an ear is convex and no other corner lies in it
+			for (int j = 0; j < left && empty; j++)
+			{
+				if (j != i && j != (i + left - 1) % left && j != (i + 1) % left)
+					empty = !InTriangle(points[remaining[j]], a, b, c, orientation);
+			}
+			if (empty)
+			{
+				ear = i;
+				break;
+			}
+		}
+		// no ear at all only happens on self-intersecting faces, the first corner is cut off anyway
+
+		tris[out++] = remaining[(ear + left - 1) % left];
+		tris[out++] = remaining[ear];
+		tris[out++] = remaining[(ear + 1) % left];
+		memmove(remaining + ear, remaining + ear + 1, sizeof(unsigned short) * (left - ear - 1));
+	}
+
+	tris[out++] = remaining[0];
+	tris[out++] = remaining[1];
+	tris[out++] = remaining[2];
+}
+
+void TransFArr(const MeshData* mesh, const int* corners, GLuint* ret)
+{
+	unsigned short tris[(MESH_MAX_CLIP_CORNERS - 2) * 3];
+	GLfloat facePositions[MESH_MAX_CLIP_CORNERS * 3];
+	const int* fv = mesh->fvIndices;
+	int ret_index = 0;
+
+	for (int row = 0; row < mesh->f_num; fv += mesh->face_counts[row], corners += mesh->face_counts[row], row++)
+	{
+		int count = mesh->face_counts[row];
+		int valid = TRUE;
+
+		if (count < 3)
+			continue;
+
+		if (count == 3) // [7,1,5]
+		{
+			ret[ret_index++] = corners[0];
+			ret[ret_index++] = corners[1];
+			ret[ret_index++] = corners[2];
+			continue;
+		}
+
+		// [5,1,3,7] --> [5,1,3, 5,3,7], longer faces likewise
+		if (count > MESH_MAX_CLIP_CORNERS)
+		{
+			for (int i = 1; i + 1 < count; i++)
+			{
+				ret[ret_index++] = corners[0];
+				ret[ret_index++] = corners[i];
+				ret[ret_index++] = corners[i + 1];
+			}
+			continue;
+		}
+
+		// a corner with a broken index leaves the face without positions
+		for (int i = 0; i < count && valid; i++)
+		{
+			valid = fv[i] >= 0 && fv[i] < mesh->v_num;
+			if (valid)
+				memcpy(facePositions + i * 3, mesh->positions + fv[i] * 3, sizeof(GLfloat) * 3);
+		}
+		TriangulatePolygon(valid ? facePositions : NULL, count, tris);
+		for (int i = 0; i < (count - 2) * 3; i++)
+			ret[ret_index++] = corners[tris[i]];
+	}
+}
+
+// the key of a welded vertex, hashed into a table of twice the corner count
+static unsigned int HashCorner(int v, int vt, int vn)
+{
+	unsigned int h = (unsigned int)v * 73856093u ^ (unsigned int)vt * 19349663u ^ (unsigned int)vn * 83492791u;
+	return h ^ (h >> 16);
+}
+
+// corner index or -1 when it does not address an element of a stream of count elements
+static int ValidIndex(int index, int count)
+{
+	return (index >= 0 && index < count) ? index : -1;
+}
+
+int WeldMesh(const MeshData* mesh, int attribs, IndexedMesh* ret)
+{
+	int index_num = 3 * updatedFaceNum(mesh->face_counts, mesh->f_num);
+	int vt_num = (attribs & MESH_ATTRIB_TEXCOORD) ? mesh->vt_num : 0;
+	int vn_num = (attribs & MESH_ATTRIB_NORMAL) ? mesh->vn_num : 0;
+	unsigned int tableSize = 16;
+	MeshArena scratch;
+	int* table;
+	int* keys;
+	int* remap;
+	GLuint* triangles;
+
+	memset(ret, 0, sizeof(IndexedMesh));
+
+	while (tableSize < 2u * (unsigned int)mesh->corner_num)
+		tableSize *= 2;
+
+	// hash table, unique keys, the vertex of every corner and the triangulated corners
+	if (!ArenaInit(&scratch, AlignSize(sizeof(int) * tableSize) + AlignSize(sizeof(int) * 3 * mesh->corner_num) +
+		AlignSize(sizeof(int) * mesh->corner_num) + AlignSize(sizeof(GLuint) * index_num)))
+	{
+		printf("out of memory while welding %d corners\n", mesh->corner_num);
+		return FALSE;
+	}
+	table = (int*)ArenaAlloc(&scratch, sizeof(int) * tableSize);
+	keys = (int*)ArenaAlloc(&scratch, sizeof(int) * 3 * mesh->corner_num);
+	remap = (int*)ArenaAlloc(&scratch, sizeof(int) * mesh->corner_num);
+	triangles = (GLuint*)ArenaAlloc(&scratch, sizeof(GLuint) * index_num);
+	memset(table, 0xff, sizeof(int) * tableSize);
+
+	for (int corner = 0; corner < mesh->corner_num; corner++)
+	{
+		int v = ValidIndex(mesh->fvIndices[corner], mesh->v_num);
+		int vt = ValidIndex(mesh->ftIndices[corner], vt_num);
+		int vn = ValidIndex(mesh->fnIndices[corner], vn_num);
+		unsigned int slot = HashCorner(v, vt, vn) & (tableSize - 1);
+
+		// linear probing, the table is never more than half full
+		for (;;)
+		{
+			int vertex = table[slot];
+			if (vertex < 0)
+			{
+				vertex = ret->vertex_num++;
+				keys[vertex * 3 + 0] = v;
+				keys[vertex * 3 + 1] = vt;
+				keys[vertex * 3 + 2] = vn;
+				table[slot] = vertex;
+				remap[corner] = vertex;
+				break;
+			}
+			if (keys[vertex * 3 + 0] == v && keys[vertex * 3 + 1] == vt && keys[vertex * 3 + 2] == vn)
+			{
+				remap[corner] = vertex;
+				break;
+			}
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+
+	ret->index_num = index_num;
+	ret->stride = 3;
+	ret->texcoord_offset = -1;
+	ret->normal_offset = -1;
+	if (vt_num > 0)
+	{
+		ret->texcoord_offset = ret->stride;
+		ret->stride += 2;
+	}
+	if (vn_num > 0)
+	{
+		ret->normal_offset = ret->stride;
+		ret->stride += 3;
+	}
+	// a 16 bit index reaches vertex 65535
+	ret->index_type = ret->vertex_num <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	ret->index_size = ret->index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+	if (!ArenaInit(&ret->arena, AlignSize(sizeof(GLfloat) * ret->stride * ret->vertex_num) +
+		AlignSize((size_t)ret->index_size * index_num)))
+	{
+		printf("out of memory for %d welded vertices\n", ret->vertex_num);
+		ArenaFree(&scratch);
+		memset(ret, 0, sizeof(IndexedMesh));
+		return FALSE;
+	}
+	ret->vertices = (GLfloat*)ArenaAlloc(&ret->arena, sizeof(GLfloat) * ret->stride * ret->vertex_num);
+	ret->indices = ArenaAlloc(&ret->arena, (size_t)ret->index_size * index_num);
+
+	for (int i = 0; i < ret->vertex_num; i++)
+	{
+		GLfloat* vertex = ret->vertices + i * ret->stride;
+		const int* key = keys + i * 3;
+
+		for (int j = 0; j < 3; j++)
+			vertex[j] = key[0] >= 0 ? mesh->positions[key[0] * 3 + j] : 0.0f;
+		if (ret->texcoord_offset >= 0)
+			for (int j = 0; j < 2; j++)
+				vertex[ret->texcoord_offset + j] = key[1] >= 0 ? mesh->texCoords[key[1] * 2 + j] : 0.0f;
+		if (ret->normal_offset >= 0)
+			for (int j = 0; j < 3; j++)
+				vertex[ret->normal_offset + j] = key[2] >= 0 ? mesh->normals[key[2] * 3 + j] : 0.0f;
+	}
+
+	for (int j = 0; j < 3; j++)
+	{
+		ret->bbox_min[j] = ret->vertex_num > 0 ? ret->vertices[j] : 0.0f;
+		ret->bbox_max[j] = ret->bbox_min[j];
+	}
+	for (int i = 1; i < ret->vertex_num; i++)
+	{
+		const GLfloat* position = ret->vertices + i * ret->stride;
+		for (int j = 0; j < 3; j++)
+		{
+			if (position[j] < ret->bbox_min[j])
+				ret->bbox_min[j] = position[j];
+			if (position[j] > ret->bbox_max[j])
+				ret->bbox_max[j] = position[j];
+		}
+	}
+
+	// same triangles as TransFArr, on the welded vertex of every corner
+	TransFArr(mesh, remap, triangles);
+	if (ret->index_type == GL_UNSIGNED_SHORT)
+	{
+		GLushort* indices = (GLushort*)ret->indices;
+		for (int i = 0; i < index_num; i++)
+			indices[i] = (GLushort)triangles[i];
+	}
+	else if (index_num > 0)
+	{
+		memcpy(ret->indices, triangles, sizeof(GLuint) * index_num);
+	}
+
+	ArenaFree(&scratch);
+	return TRUE;
+}
+
+void FreeIndexedMesh(IndexedMesh* welded)
+{
+	ArenaFree(&welded->arena);
+	esUnmapFile(&welded->mapping);
+	memset(welded, 0, sizeof(IndexedMesh));
+}
+
+int RemapMeshTexCoords(IndexedMesh* welded, const ESAtlasRegion* region)
+{
+	size_t size = sizeof(GLfloat) * welded->stride * welded->vertex_num;
+
+	if (welded->texcoord_offset < 0)
+		return FALSE;
+
+	if (welded->arena.base == NULL)
+	{
+		// vertices are in the read-only mapping of the cache, the indices stay there
+		GLfloat* vertices;
+
+		if (!ArenaInit(&welded->arena, size) || (vertices = (GLfloat*)ArenaAlloc(&welded->arena, size)) == NULL)
+			return FALSE;
+		memcpy(vertices, welded->vertices, size);
+		welded->vertices = vertices;
+	}
+
+	RemapTexCoords(welded->vertices + welded->texcoord_offset, welded->vertex_num, welded->stride, region);
+	return TRUE;
+}
+
+void MeshMidBotPosition(const IndexedMesh* welded, GLfloat* ret)
+{
+	ret[0] = (welded->bbox_min[0] + welded->bbox_max[0]) * 0.5f;
+	ret[1] = welded->bbox_min[1] < 0.0f ? welded->bbox_min[1] : 0.0f;
+	ret[2] = (welded->bbox_min[2] + welded->bbox_max[2]) * 0.5f;
+}
+
+void MeshBounds(const IndexedMesh* welded, ESBounds* ret)
+{
+	esComputeBounds(ret, welded->vertices, welded->stride, welded->vertex_num);
+}
+
+void PrintWeldStats(const char* name, const IndexedMesh* welded)
+{
+	// one vertex per triangle corner and a 0..N-1 GLuint index buffer, what UpdatedAgainVertices produced
+	double deindexedBytes = (double)welded->index_num * (sizeof(GLfloat) * welded->stride + sizeof(GLuint));
+	double weldedBytes = (double)welded->vertex_num * sizeof(GLfloat) * welded->stride +
+		(double)welded->index_num * welded->index_size;
+
+	printf("%s: %d triangle corners welded into %d vertices (%.1f%% unique), %s indices, %.1f KB -> %.1f KB, %.1f KB saved\n",
+		name, welded->index_num, welded->vertex_num,
+		welded->index_num > 0 ? 100.0 * welded->vertex_num / welded->index_num : 0.0,
+		welded->index_type == GL_UNSIGNED_SHORT ? "16 bit" : "32 bit",
+		deindexedBytes / 1024.0, weldedBytes / 1024.0, (deindexedBytes - weldedBytes) / 1024.0);
+}
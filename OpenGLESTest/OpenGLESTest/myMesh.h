@@ -0,0 +1,133 @@
+#pragma once
+
+#ifndef MYMESH_H
+#define MYMESH_H
+
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+#include "myObjLoader.h"
+
+// One block of memory handed out front to back, everything in it is released at once.
+typedef struct
+{
+	unsigned char* base;
+	size_t size;
+	size_t used;
+} MeshArena;
+
+// allocate size bytes for the arena, return TRUE on success
+int ArenaInit(MeshArena* arena, size_t size);
+
+// next 16 byte aligned piece of the arena, NULL when the arena is full
+void* ArenaAlloc(MeshArena* arena, size_t size);
+
+void ArenaFree(MeshArena* arena);
+
+// Mesh stored as structure of arrays, every stream is contiguous and all of them live in one arena.
+// Streams and indices follow the layout of ObjFile (myObjLoader.h):
+//
+// positions   [x0, y0, z0, x1, y1, z1, ...]        (3 floats per v)
+// texCoords   [s0, t0, s1, t1, ...]                (2 floats per vt)
+// normals     [x0, y0, z0, ...]                    (3 floats per vn)
+// face_counts [3, 4, 3, ...]                       (corners of every face)
+// fvIndices   [7, 1, 5,  5, 1, 3, 7,  4, 8, 6...]  (0-based, corner_num of them)
+// ftIndices, fnIndices likewise, -1 where the corner has no vt / vn
+typedef struct
+{
+	int v_num;
+	int vt_num;
+	int vn_num;
+	int f_num;
+	int corner_num;
+
+	GLfloat* positions;
+	GLfloat* texCoords;
+	GLfloat* normals;
+
+	int* face_counts;
+	int* fvIndices;
+	int* ftIndices;
+	int* fnIndices;
+
+	MeshArena arena;
+} MeshData;
+
+// copy the arrays of obj into a single arena allocation of mesh
+int MeshFromObj(const ObjFile* obj, MeshData* mesh);
+
+// LoadObjFile + MeshFromObj, the growable arrays of the loader are released before returning
+int LoadObjMesh(const char* filename, MeshData* mesh);
+
+void FreeMesh(MeshData* mesh);
+
+// split the faces of mesh into triangles, corners is one of fvIndices / ftIndices / fnIndices
+// or any other per-corner array. The cut is made on the positions of the face, so every corner
+// array is split the same way: convex faces into a fan, concave ones by ear clipping.
+// ret needs room for 3 * updatedFaceNum(mesh->face_counts, mesh->f_num) indices.
+// [7,1,5 | 5,1,3,7 | 4,8,6] --> [7,1,5, 5,1,3, 5,3,7, 4,8,6]
+void TransFArr(const MeshData* mesh, const int* corners, GLuint* ret);
+
+// faces with more corners than this are always cut into a fan
+#define MESH_MAX_CLIP_CORNERS 256
+
+// the cut TransFArr makes: the triangles of a face of count corners as corner numbers [0..count)
+// in tris, count - 2 of them. Convex faces become the fan [0,1,2, 0,2,3, ...] the MyObj samples always
+// drew, concave ones are ear clipped in the plane the face is most parallel to.
+// positions holds count * 3 floats, NULL fans the face. count is at most MESH_MAX_CLIP_CORNERS.
+void TriangulatePolygon(const GLfloat* positions, int count, unsigned short* tris);
+
+// Mesh welded into unique vertices and a real index buffer, ready for glBufferData.
+// Every distinct (v, vt, vn) triplet of the faces becomes one interleaved vertex:
+//
+// vertices [px, py, pz, s, t, nx, ny, nz,  px, py, pz, s, t, nx, ny, nz, ...]
+//
+// texcoord and normal are only present when they are asked for and the obj has vt / vn lines,
+// a corner without vt or vn gets zeros in that slot.
+#define MESH_ATTRIB_TEXCOORD 0x1
+#define MESH_ATTRIB_NORMAL   0x2
+
+typedef struct
+{
+	int vertex_num;
+	int index_num;       // 3 per triangle
+	int stride;          // floats per vertex
+	int texcoord_offset; // in floats, -1 when there are no texcoords
+	int normal_offset;   // in floats, -1 when there are no normals
+
+	GLfloat* vertices;
+
+	GLenum index_type;   // GL_UNSIGNED_SHORT whenever vertex_num allows it, GL_UNSIGNED_INT otherwise
+	int index_size;      // bytes of one index, 2 or 4
+	void* indices;
+
+	GLfloat bbox_min[3]; // bounding box of the positions
+	GLfloat bbox_max[3];
+
+	// vertices and indices live either in the arena or, for a model read from
+	// its .mesh cache (myMeshCache.c), in the read-only mapping of that file
+	MeshArena arena;
+	ESMappedFile mapping;
+} IndexedMesh;
+
+// weld the faces of mesh with a hash table on (v, vt, vn), return TRUE on success.
+// attribs is a mask of MESH_ATTRIB_*, attributes left out don't split vertices either.
+int WeldMesh(const MeshData* mesh, int attribs, IndexedMesh* ret);
+
+void FreeIndexedMesh(IndexedMesh* welded);
+
+// RemapTexCoords (myObjLoader.h) on the texcoords of welded. The .mesh cache is shared by every
+// sample loading the model, so it stays as it is: a mesh mapped from it gets its vertices copied
+// into its arena first. Return FALSE when welded has no texcoords or the copy fails.
+int RemapMeshTexCoords(IndexedMesh* welded, const ESAtlasRegion* region);
+
+// the middle of the bounding box of welded, at its bottom but never above the origin
+// used to put a floor under the model
+void MeshMidBotPosition(const IndexedMesh* welded, GLfloat* ret);
+
+// bounding box and sphere of the positions of welded, for esCullSpheres and esCullBoxes
+void MeshBounds(const IndexedMesh* welded, ESBounds* ret);
+
+// print the unique-vertex ratio of welded and the bytes it saves against one vertex per triangle corner
+void PrintWeldStats(const char* name, const IndexedMesh* welded);
+
+#endif
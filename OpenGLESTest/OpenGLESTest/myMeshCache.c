@@ -0,0 +1,339 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "myMeshCache.h"
+#include "myMeshOptimizer.h"
+
+#define MESH_CACHE_ALIGNMENT 16
+
+static unsigned long long AlignOffset(unsigned long long offset)
+{
+	return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(unsigned long long)(MESH_CACHE_ALIGNMENT - 1);
+}
+
+// size and modification time of filename, FALSE when it doesn't exist
+static int SourceStat(const char* filename, unsigned long long* size, long long* mtime)
+{
+#ifdef _MSC_VER
+	struct __stat64 st;
+	if (_stat64(filename, &st) != 0)
+		return FALSE;
+#else
+	struct stat st;
+	if (stat(filename, &st) != 0)
+		return FALSE;
+#endif
+	*size = (unsigned long long)st.st_size;
+	*mtime = (long long)st.st_mtime;
+	return TRUE;
+}
+
+// 64 bit FNV-1a
+static unsigned long long HashBytes(const unsigned char* data, size_t size)
+{
+	unsigned long long hash = 14695981039346656037ull;
+
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ data[i]) * 1099511628211ull;
+	return hash;
+}
+
+static int SourceHash(const char* filename, unsigned long long* hash)
+{
+	ESMappedFile file;
+
+	if (!esMapFile(NULL, filename, &file))
+		return FALSE;
+	*hash = HashBytes(file.data, file.size);
+	esUnmapFile(&file);
+	return TRUE;
+}
+
+void MeshCacheFilename(const char* objFilename, char* ret, size_t size)
+{
+	const char* dot = strrchr(objFilename, '.');
+	const char* slash = strrchr(objFilename, '/');
+	const char* backslash = strrchr(objFilename, '\\');
+	size_t length = strlen(objFilename);
+
+	// only an extension of the file name itself is replaced, not a dot in a directory name
+	if (dot != NULL && (slash == NULL || dot > slash) && (backslash == NULL || dot > backslash))
+		length = dot - objFilename;
+
+	if (length + sizeof(".mesh") > size)
+	{
+		ret[0] = '\0';
+		return;
+	}
+	memcpy(ret, objFilename, length);
+	memcpy(ret + length, ".mesh", sizeof(".mesh"));
+}
+
+static void AddAttrib(MeshCacheHeader* header, unsigned int semantic, unsigned int components, int floatOffset)
+{
+	MeshCacheAttrib* attrib = &header->attrib_desc[header->attrib_count++];
+
+	attrib->semantic = semantic;
+	attrib->type = GL_FLOAT;
+	attrib->components = components;
+	attrib->offset = (unsigned int)(floatOffset * sizeof(GLfloat));
+}
+
+static int WritePadding(FILE* file, unsigned long long offset)
+{
+	static const unsigned char zeros[MESH_CACHE_ALIGNMENT] = { 0 };
+	long position = ftell(file);
+
+	return position >= 0 && fwrite(zeros, 1, (size_t)(offset - position), file) == (size_t)(offset - position);
+}
+
+int WriteMeshCache(const char* cacheFilename, const char* objFilename, int attribs, const IndexedMesh* welded)
+{
+	MeshCacheHeader header;
+	size_t vertexBytes = sizeof(GLfloat) * welded->stride * welded->vertex_num;
+	size_t indexBytes = (size_t)welded->index_size * welded->index_num;
+	FILE* file;
+	int ok;
+
+	memset(&header, 0, sizeof(MeshCacheHeader));
+	header.version = MESH_CACHE_VERSION;
+	header.header_size = sizeof(MeshCacheHeader);
+	header.attribs = attribs;
+	if (!SourceStat(objFilename, &header.source_size, &header.source_mtime) ||
+		!SourceHash(objFilename, &header.source_hash))
+		return FALSE;
+
+	header.vertex_num = welded->vertex_num;
+	header.vertex_size = sizeof(GLfloat) * welded->stride;
+	AddAttrib(&header, MESH_SEMANTIC_POSITION, 3, 0);
+	if (welded->texcoord_offset >= 0)
+		AddAttrib(&header, MESH_SEMANTIC_TEXCOORD, 2, welded->texcoord_offset);
+	if (welded->normal_offset >= 0)
+		AddAttrib(&header, MESH_SEMANTIC_NORMAL, 3, welded->normal_offset);
+
+	header.index_num = welded->index_num;
+	header.index_type = welded->index_type;
+	memcpy(header.bbox_min, welded->bbox_min, sizeof(header.bbox_min));
+	memcpy(header.bbox_max, welded->bbox_max, sizeof(header.bbox_max));
+
+	header.vertex_offset = AlignOffset(sizeof(MeshCacheHeader));
+	header.index_offset = AlignOffset(header.vertex_offset + vertexBytes);
+
+	file = fopen(cacheFilename, "wb");
+	if (file == NULL)
+	{
+		printf("cannot write mesh cache: %s\n", cacheFilename);
+		return FALSE;
+	}
+
+	// the magic goes in last, a file cut short on the way is never taken for a cache
+	ok = fwrite(&header, sizeof(MeshCacheHeader), 1, file) == 1 &&
+		WritePadding(file, header.vertex_offset) &&
+		(vertexBytes == 0 || fwrite(welded->vertices, vertexBytes, 1, file) == 1) &&
+		WritePadding(file, header.index_offset) &&
+		(indexBytes == 0 || fwrite(welded->indices, indexBytes, 1, file) == 1) &&
+		fflush(file) == 0;
+
+	header.magic = MESH_CACHE_MAGIC;
+	ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header.magic, sizeof(header.magic), 1, file) == 1;
+	ok = (fclose(file) == 0) && ok;
+
+	if (!ok)
+	{
+		printf("cannot write mesh cache: %s\n", cacheFilename);
+		remove(cacheFilename);
+	}
+	return ok;
+}
+
+// TRUE when header describes a cache of objFilename as it is now.
+// mtime gets the modification time of objFilename, it differs from the header when only the hash matched.
+static int CacheIsCurrent(const MeshCacheHeader* header, const char* objFilename, int attribs, long long* mtime)
+{
+	unsigned long long size, hash;
+
+	if (header->magic != MESH_CACHE_MAGIC || header->version != MESH_CACHE_VERSION ||
+		header->header_size != sizeof(MeshCacheHeader) || header->attribs != (unsigned int)attribs)
+		return FALSE;
+
+	if (!SourceStat(objFilename, &size, mtime) || size != header->source_size)
+		return FALSE;
+	if (*mtime == header->source_mtime)
+		return TRUE;
+
+	return SourceHash(objFilename, &hash) && hash == header->source_hash;
+}
+
+// stamp a new source time into the header of a cache whose content is still current
+static int UpdateCacheMtime(const char* cacheFilename, long long mtime)
+{
+	FILE* file = fopen(cacheFilename, "r+b");
+	int ok;
+
+	if (file == NULL)
+		return FALSE;
+	ok = fseek(file, (long)offsetof(MeshCacheHeader, source_mtime), SEEK_SET) == 0 &&
+		fwrite(&mtime, sizeof(mtime), 1, file) == 1;
+	ok = (fclose(file) == 0) && ok;
+	return ok;
+}
+
+// TRUE when blob of blobSize bytes at offset lies in a file of fileSize bytes, behind the header
+static int BlobInFile(unsigned long long offset, unsigned long long blobSize, size_t fileSize)
+{
+	return offset >= sizeof(MeshCacheHeader) && offset % sizeof(GLuint) == 0 &&
+		offset <= fileSize && blobSize <= fileSize - offset;
+}
+
+// TRUE when the layout in header can be read out of a file of fileSize bytes the way WeldMesh lays it out:
+// interleaved floats starting with the position, whole triangles of 16 or 32 bit indices
+static int CacheLayoutIsSound(const MeshCacheHeader* header, size_t fileSize)
+{
+	unsigned int indexSize;
+	int hasPosition = FALSE;
+
+	if (header->index_type == GL_UNSIGNED_SHORT)
+		indexSize = sizeof(GLushort);
+	else if (header->index_type == GL_UNSIGNED_INT)
+		indexSize = sizeof(GLuint);
+	else
+		return FALSE;
+
+	if (header->vertex_num > INT_MAX || header->index_num > INT_MAX || header->index_num % 3 != 0 ||
+		header->vertex_size < 3 * sizeof(GLfloat) || header->vertex_size % sizeof(GLfloat) != 0 ||
+		header->attrib_count == 0 || header->attrib_count > MESH_CACHE_MAX_ATTRIBS)
+		return FALSE;
+
+	for (unsigned int i = 0; i < header->attrib_count; i++)
+	{
+		const MeshCacheAttrib* attrib = &header->attrib_desc[i];
+		unsigned int expected = attrib->semantic == MESH_SEMANTIC_TEXCOORD ? 2 : 3;
+
+		if (attrib->semantic > MESH_SEMANTIC_NORMAL || attrib->type != GL_FLOAT || attrib->components != expected ||
+			attrib->offset % sizeof(GLfloat) != 0 || attrib->offset > header->vertex_size ||
+			attrib->components * sizeof(GLfloat) > header->vertex_size - attrib->offset)
+			return FALSE;
+		if (attrib->semantic == MESH_SEMANTIC_POSITION)
+			hasPosition = hasPosition || attrib->offset == 0;
+	}
+
+	return hasPosition &&
+		BlobInFile(header->vertex_offset, (unsigned long long)header->vertex_size * header->vertex_num, fileSize) &&
+		BlobInFile(header->index_offset, (unsigned long long)indexSize * header->index_num, fileSize);
+}
+
+// TRUE when every index of the cache points at one of its vertices
+static int CacheIndicesAreSound(const MeshCacheHeader* header, const unsigned char* data)
+{
+	const void* indices = data + header->index_offset;
+
+	for (unsigned int i = 0; i < header->index_num; i++)
+	{
+		unsigned int index = header->index_type == GL_UNSIGNED_SHORT ?
+			((const GLushort*)indices)[i] : ((const GLuint*)indices)[i];
+		if (index >= header->vertex_num)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+int MapMeshCache(const char* cacheFilename, const char* objFilename, int attribs, IndexedMesh* welded)
+{
+	ESMappedFile file;
+	const MeshCacheHeader* header;
+	unsigned int indexSize;
+	long long mtime;
+
+	memset(welded, 0, sizeof(IndexedMesh));
+
+	if (!esMapFile(NULL, cacheFilename, &file))
+		return FALSE;
+
+	header = (const MeshCacheHeader*)file.data;
+	if (file.size < sizeof(MeshCacheHeader) || !CacheIsCurrent(header, objFilename, attribs, &mtime))
+	{
+		esUnmapFile(&file);
+		return FALSE;
+	}
+
+	// same content under a new time (a fresh checkout): store the time, so the next run skips the hash.
+	// Windows keeps a mapped file locked against writers, the header is updated between two mappings.
+	if (mtime != header->source_mtime)
+	{
+		esUnmapFile(&file);
+		UpdateCacheMtime(cacheFilename, mtime);
+		if (!esMapFile(NULL, cacheFilename, &file))
+			return FALSE;
+		header = (const MeshCacheHeader*)file.data;
+		if (file.size < sizeof(MeshCacheHeader) || !CacheIsCurrent(header, objFilename, attribs, &mtime))
+		{
+			esUnmapFile(&file);
+			return FALSE;
+		}
+	}
+
+	// a stale or damaged cache never gets past here, the mesh code trusts every offset and index
+	if (!CacheLayoutIsSound(header, file.size) || !CacheIndicesAreSound(header, file.data))
+	{
+		printf("broken mesh cache: %s\n", cacheFilename);
+		esUnmapFile(&file);
+		return FALSE;
+	}
+
+	indexSize = header->index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	welded->vertex_num = header->vertex_num;
+	welded->index_num = header->index_num;
+	welded->stride = header->vertex_size / sizeof(GLfloat);
+	welded->texcoord_offset = -1;
+	welded->normal_offset = -1;
+	for (unsigned int i = 0; i < header->attrib_count; i++)
+	{
+		const MeshCacheAttrib* attrib = &header->attrib_desc[i];
+		if (attrib->semantic == MESH_SEMANTIC_TEXCOORD)
+			welded->texcoord_offset = attrib->offset / sizeof(GLfloat);
+		else if (attrib->semantic == MESH_SEMANTIC_NORMAL)
+			welded->normal_offset = attrib->offset / sizeof(GLfloat);
+	}
+
+	// read-only, straight out of the mapping
+	welded->vertices = (GLfloat*)(file.data + header->vertex_offset);
+	welded->index_type = header->index_type;
+	welded->index_size = indexSize;
+	welded->indices = (void*)(file.data + header->index_offset);
+	memcpy(welded->bbox_min, header->bbox_min, sizeof(welded->bbox_min));
+	memcpy(welded->bbox_max, header->bbox_max, sizeof(welded->bbox_max));
+	welded->mapping = file;
+
+	return TRUE;
+}
+
+int LoadCachedMesh(const char* objFilename, int attribs, IndexedMesh* welded)
+{
+	char cacheFilename[1024];
+	MeshData mesh;
+
+	MeshCacheFilename(objFilename, cacheFilename, sizeof(cacheFilename));
+	if (cacheFilename[0] != '\0' && MapMeshCache(cacheFilename, objFilename, attribs, welded))
+		return TRUE;
+
+	if (!LoadObjMesh(objFilename, &mesh))
+		return FALSE;
+
+	// triangles in post-transform cache order, vertices in the order they are fetched
+	if (!WeldMesh(&mesh, attribs, welded) ||
+		!OptimizeVertexCache(welded) || !OptimizeVertexFetch(welded))
+	{
+		FreeIndexedMesh(welded);
+		FreeMesh(&mesh);
+		return FALSE;
+	}
+	FreeMesh(&mesh);
+
+	if (cacheFilename[0] != '\0')
+		WriteMeshCache(cacheFilename, objFilename, attribs, welded);
+	return TRUE;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef MYMESHCACHE_H
+#define MYMESHCACHE_H
+
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+#include "myMesh.h"
+
+// Binary cache of a welded, optimized model, written next to the .obj it was built from.
+// The file is mapped as is, the vertex and index blobs go to glBufferData without any parsing.
+//
+// [MeshCacheHeader][padding][vertex blob][padding][index blob]
+//
+// The header is written as is, in the byte order of the machine which built the cache: a cache
+// from a machine of the other order fails the magic check and is built again.
+// Blobs start at 16 byte aligned offsets, the version changes whenever the layout of the file changes.
+// A mapped cache is checked before use: its blobs must lie in the file, its attributes in the vertex
+// and its indices below vertex_num, anything else is taken for a broken cache.
+#define MESH_CACHE_MAGIC   0x4853454D // "MESH"
+#define MESH_CACHE_VERSION 2
+
+#define MESH_SEMANTIC_POSITION 0
+#define MESH_SEMANTIC_TEXCOORD 1
+#define MESH_SEMANTIC_NORMAL   2
+
+#define MESH_CACHE_MAX_ATTRIBS 4
+
+// one attribute of the interleaved vertex blob, enough for a glVertexAttribPointer call
+typedef struct
+{
+	unsigned int semantic;   // MESH_SEMANTIC_*
+	unsigned int type;       // GL_FLOAT
+	unsigned int components;
+	unsigned int offset;     // bytes from the start of the vertex
+} MeshCacheAttrib;
+
+typedef struct
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int header_size;         // sizeof(MeshCacheHeader)
+	unsigned int attribs;             // MESH_ATTRIB_* mask the model was welded with
+
+	// the .obj the cache was built from
+	unsigned long long source_size;
+	long long source_mtime;
+	unsigned long long source_hash;   // FNV-1a of the whole file
+
+	// vertex layout
+	unsigned int vertex_num;
+	unsigned int vertex_size;         // bytes
+	unsigned int attrib_count;
+	MeshCacheAttrib attrib_desc[MESH_CACHE_MAX_ATTRIBS];
+
+	unsigned int index_num;
+	unsigned int index_type;          // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+
+	float bbox_min[3];
+	float bbox_max[3];
+	unsigned int reserved;            // keeps the offsets below 8 byte aligned
+
+	unsigned long long vertex_offset; // from the start of the file
+	unsigned long long index_offset;
+} MeshCacheHeader;
+
+// "models/bear.obj" --> "models/bear.mesh"
+void MeshCacheFilename(const char* objFilename, char* ret, size_t size);
+
+// write welded to cacheFilename, stamped with the size, time and hash of objFilename
+int WriteMeshCache(const char* cacheFilename, const char* objFilename, int attribs, const IndexedMesh* welded);
+
+// map cacheFilename into welded without copying anything, as long as it was built from the current
+// content of objFilename with the same attribs. The cache is trusted when size and modification time
+// of objFilename match. When only the time differs (a fresh checkout), the content hash decides
+// and a matching cache gets the new time, later runs trust it without hashing again.
+int MapMeshCache(const char* cacheFilename, const char* objFilename, int attribs, IndexedMesh* welded);
+
+// the loading pipeline of the MyObj samples with the cache in front of it:
+// map the .mesh next to objFilename, or parse, weld, optimize and write the .mesh for the next run.
+// A cache which can't be written only costs the next run its parsing.
+int LoadCachedMesh(const char* objFilename, int attribs, IndexedMesh* welded);
+
+#endif
@@ -0,0 +1,134 @@
+// myMeshConverter.c
+//
+//    Batch converter: builds the .mesh cache (myMeshCache.h) of every .obj in the directory
+//    given as the first argument (the working directory without one), the same file the
+//    MyObj samples would write on their first run.
+//    Caches which are still up to date are only checked, not rebuilt.
+//    A console program of its own, built by MeshConverter.vcxproj without the window loop of
+//    Common: run it as "MeshConverter models".
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "esUtil.h"
+#include "myMeshCache.h"
+#include "myBench.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// the attributes the MyObj samples draw with, a cache welded with others is rebuilt by them
+#define CONVERT_ATTRIBS MESH_ATTRIB_TEXCOORD
+
+static int converted, upToDate, failed;
+
+static int IsObjFile(const char* name)
+{
+	size_t length = strlen(name);
+	return length > 4 && (strcmp(name + length - 4, ".obj") == 0 || strcmp(name + length - 4, ".OBJ") == 0);
+}
+
+static void ConvertModel(const char* filename)
+{
+	char cacheFilename[1024];
+	IndexedMesh welded;
+	double start, elapsed;
+
+	MeshCacheFilename(filename, cacheFilename, sizeof(cacheFilename));
+	if (cacheFilename[0] == '\0')
+	{
+		printf("%-16s file name too long\n", filename);
+		failed++;
+		return;
+	}
+
+	if (MapMeshCache(cacheFilename, filename, CONVERT_ATTRIBS, &welded))
+	{
+		printf("%-16s up to date\n", cacheFilename);
+		FreeIndexedMesh(&welded);
+		upToDate++;
+		return;
+	}
+
+	// LoadCachedMesh finds no valid cache and writes a new one
+	start = BenchNow();
+	if (!LoadCachedMesh(filename, CONVERT_ATTRIBS, &welded))
+	{
+		printf("%-16s cannot be loaded\n", filename);
+		failed++;
+		return;
+	}
+	elapsed = BenchNow() - start;
+	FreeIndexedMesh(&welded);
+
+	// a cache which can't be mapped back was not written
+	start = BenchNow();
+	if (!MapMeshCache(cacheFilename, filename, CONVERT_ATTRIBS, &welded))
+	{
+		printf("%-16s cannot be written\n", cacheFilename);
+		failed++;
+		return;
+	}
+	printf("%-16s %6d vertices %7d indices  parse + weld + optimize %8.3f ms, map %6.3f ms\n",
+		cacheFilename, welded.vertex_num, welded.index_num, elapsed * 1000.0, (BenchNow() - start) * 1000.0);
+	FreeIndexedMesh(&welded);
+	converted++;
+}
+
+// directory + name in path, FALSE when it doesn't fit
+static int JoinPath(char* path, size_t size, const char* directory, const char* name)
+{
+	int length = snprintf(path, size, "%s/%s", directory, name);
+	return length > 0 && (size_t)length < size;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* directory = argc > 1 ? argv[1] : ".";
+	char path[1024];
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE find = INVALID_HANDLE_VALUE;
+
+	if (JoinPath(path, sizeof(path), directory, "*.obj"))
+		find = FindFirstFileA(path, &found);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && JoinPath(path, sizeof(path), directory, found.cFileName))
+				ConvertModel(path);
+		} while (FindNextFileA(find, &found));
+		FindClose(find);
+	}
+	else
+	{
+		printf("cannot list %s\n", directory);
+		failed++;
+	}
+#else
+	DIR* dir = opendir(directory);
+	struct dirent* entry;
+
+	if (dir != NULL)
+	{
+		while ((entry = readdir(dir)) != NULL)
+		{
+			if (IsObjFile(entry->d_name) && JoinPath(path, sizeof(path), directory, entry->d_name))
+				ConvertModel(path);
+		}
+		closedir(dir);
+	}
+	else
+	{
+		printf("cannot list %s\n", directory);
+		failed++;
+	}
+#endif
+
+	printf("%d converted, %d up to date, %d failed\n", converted, upToDate, failed);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "myMeshOptimizer.h"
+
+// scoring constants of the original article
+#define CACHE_DECAY_POWER    1.5f
+#define LAST_TRI_SCORE       0.75f
+#define VALENCE_BOOST_SCALE  2.0f
+#define VALENCE_BOOST_POWER  0.5f
+
+static GLuint GetIndex(const IndexedMesh* welded, int i)
+{
+	if (welded->index_type == GL_UNSIGNED_SHORT)
+		return ((const GLushort*)welded->indices)[i];
+	return ((const GLuint*)welded->indices)[i];
+}
+
+static void SetIndex(IndexedMesh* welded, int i, GLuint index)
+{
+	if (welded->index_type == GL_UNSIGNED_SHORT)
+		((GLushort*)welded->indices)[i] = (GLushort)index;
+	else
+		((GLuint*)welded->indices)[i] = index;
+}
+
+// room for count allocations of size bytes together with their alignment padding
+static size_t ScratchSize(size_t size, int count)
+{
+	return size + 16 * (size_t)count;
+}
+
+// VertexScore is called for every cache entry after every triangle, the powf results are kept in tables
+#define VALENCE_TABLE_SIZE 32
+
+static float cacheScoreTable[VERTEX_CACHE_SIZE];
+static float valenceScoreTable[VALENCE_TABLE_SIZE];
+
+static void InitScoreTables(void)
+{
+	float scaler = 1.0f / (VERTEX_CACHE_SIZE - 3);
+
+	if (valenceScoreTable[1] != 0.0f)
+		return;
+
+	for (int i = 0; i < VERTEX_CACHE_SIZE; i++)
+	{
+		// the vertices of the last triangle score the same, whichever came first
+		if (i < 3)
+			cacheScoreTable[i] = LAST_TRI_SCORE;
+		else
+			cacheScoreTable[i] = powf(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+	}
+	for (int i = 1; i < VALENCE_TABLE_SIZE; i++)
+		valenceScoreTable[i] = VALENCE_BOOST_SCALE * powf((float)i, -VALENCE_BOOST_POWER);
+}
+
+// how much drawing a triangle of this vertex now is worth
+static float VertexScore(int cachePosition, int liveTris)
+{
+	float score = 0.0f;
+
+	// no triangle left to draw
+	if (liveTris == 0)
+		return -1.0f;
+
+	if (cachePosition >= 0)
+		score = cacheScoreTable[cachePosition];
+
+	// vertices with few triangles left are finished first so they never have to come back
+	if (liveTris < VALENCE_TABLE_SIZE)
+		score += valenceScoreTable[liveTris];
+	else
+		score += VALENCE_BOOST_SCALE * powf((float)liveTris, -VALENCE_BOOST_POWER);
+	return score;
+}
+
+int OptimizeVertexCache(IndexedMesh* welded)
+{
+	int index_num = welded->index_num;
+	int tri_num = index_num / 3;
+	int vertex_num = welded->vertex_num;
+	int cache[VERTEX_CACHE_SIZE + 3];
+	int newCache[VERTEX_CACHE_SIZE + 3];
+	int cacheCount = 0;
+	int bestTri = -1;
+	int nextScan = 0;
+	MeshArena scratch;
+	GLuint* indices;
+	int* liveTris;
+	int* triOffsets;
+	int* triList;
+	int* cachePos;
+	float* vertexScore;
+	float* triScore;
+	unsigned char* triAdded;
+
+	if (tri_num == 0)
+		return TRUE;
+
+	if (!ArenaInit(&scratch, ScratchSize(sizeof(GLuint) * index_num + sizeof(int) * 3 * vertex_num +
+		sizeof(int) * (vertex_num + 1) + sizeof(int) * index_num + sizeof(float) * vertex_num +
+		sizeof(float) * tri_num + tri_num, 9)))
+	{
+		printf("out of memory while optimizing %d triangles\n", tri_num);
+		return FALSE;
+	}
+	indices = (GLuint*)ArenaAlloc(&scratch, sizeof(GLuint) * index_num);
+	liveTris = (int*)ArenaAlloc(&scratch, sizeof(int) * vertex_num);
+	triOffsets = (int*)ArenaAlloc(&scratch, sizeof(int) * (vertex_num + 1));
+	triList = (int*)ArenaAlloc(&scratch, sizeof(int) * index_num);
+	cachePos = (int*)ArenaAlloc(&scratch, sizeof(int) * vertex_num);
+	vertexScore = (float*)ArenaAlloc(&scratch, sizeof(float) * vertex_num);
+	triScore = (float*)ArenaAlloc(&scratch, sizeof(float) * tri_num);
+	triAdded = (unsigned char*)ArenaAlloc(&scratch, tri_num);
+
+	InitScoreTables();
+	for (int i = 0; i < index_num; i++)
+		indices[i] = GetIndex(welded, i);
+
+	// triangles of every vertex, the first liveTris[v] entries of its list are not drawn yet
+	memset(liveTris, 0, sizeof(int) * vertex_num);
+	for (int i = 0; i < tri_num * 3; i++)
+		liveTris[indices[i]]++;
+
+	triOffsets[0] = 0;
+	for (int v = 0; v < vertex_num; v++)
+	{
+		triOffsets[v + 1] = triOffsets[v] + liveTris[v];
+		cachePos[v] = triOffsets[v]; // fill cursor for now
+	}
+	for (int i = 0; i < tri_num * 3; i++)
+		triList[cachePos[indices[i]]++] = i / 3;
+
+	for (int v = 0; v < vertex_num; v++)
+	{
+		cachePos[v] = -1;
+		vertexScore[v] = VertexScore(-1, liveTris[v]);
+	}
+	for (int t = 0; t < tri_num; t++)
+	{
+		triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		triAdded[t] = 0;
+		if (bestTri < 0 || triScore[t] > triScore[bestTri])
+			bestTri = t;
+	}
+
+	for (int out = 0; out < tri_num; out++)
+	{
+		int newCount = 0;
+		const GLuint* tri;
+
+		// nothing left around the cache, continue with the next triangle not drawn yet
+		if (bestTri < 0)
+		{
+			while (triAdded[nextScan])
+				nextScan++;
+			bestTri = nextScan;
+		}
+
+		tri = indices + bestTri * 3;
+		triAdded[bestTri] = 1;
+		SetIndex(welded, out * 3 + 0, tri[0]);
+		SetIndex(welded, out * 3 + 1, tri[1]);
+		SetIndex(welded, out * 3 + 2, tri[2]);
+
+		for (int k = 0; k < 3; k++)
+		{
+			int v = tri[k];
+			int* list = triList + triOffsets[v];
+
+			// swap the triangle behind the live ones
+			for (int j = 0; j < liveTris[v]; j++)
+			{
+				if (list[j] == bestTri)
+				{
+					list[j] = list[liveTris[v] - 1];
+					list[liveTris[v] - 1] = bestTri;
+					break;
+				}
+			}
+			liveTris[v]--;
+
+			// the vertices of the triangle go to the front of the cache
+			if (newCount == 0 || (newCache[0] != v && (newCount < 2 || newCache[1] != v)))
+				newCache[newCount++] = v;
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			int v = cache[i];
+			if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// new positions, entries past VERTEX_CACHE_SIZE fall out of the cache
+		bestTri = -1;
+		for (int i = 0; i < newCount; i++)
+		{
+			int v = newCache[i];
+			float oldScore = vertexScore[v];
+			float delta;
+			const int* list = triList + triOffsets[v];
+
+			cachePos[v] = i < VERTEX_CACHE_SIZE ? i : -1;
+			vertexScore[v] = VertexScore(cachePos[v], liveTris[v]);
+			delta = vertexScore[v] - oldScore;
+
+			for (int j = 0; j < liveTris[v]; j++)
+			{
+				triScore[list[j]] += delta;
+				if (cachePos[v] >= 0 && (bestTri < 0 || triScore[list[j]] > triScore[bestTri]))
+					bestTri = list[j];
+			}
+		}
+
+		cacheCount = newCount < VERTEX_CACHE_SIZE ? newCount : VERTEX_CACHE_SIZE;
+		memcpy(cache, newCache, sizeof(int) * cacheCount);
+	}
+
+	ArenaFree(&scratch);
+	return TRUE;
+}
+
+int OptimizeVertexFetch(IndexedMesh* welded)
+{
+	int* remap;
+	GLfloat* vertices;
+	GLuint* indices;
+	int used = 0;
+	size_t vertexSize = sizeof(GLfloat) * welded->stride;
+	MeshArena scratch;
+
+	if (welded->index_num == 0)
+		return TRUE;
+
+	if (!ArenaInit(&scratch, ScratchSize(sizeof(int) * welded->vertex_num + vertexSize * welded->vertex_num +
+		sizeof(GLuint) * welded->index_num, 3)))
+	{
+		printf("out of memory while reordering %d vertices\n", welded->vertex_num);
+		return FALSE;
+	}
+	remap = (int*)ArenaAlloc(&scratch, sizeof(int) * welded->vertex_num);
+	vertices = (GLfloat*)ArenaAlloc(&scratch, vertexSize * welded->vertex_num);
+	indices = (GLuint*)ArenaAlloc(&scratch, sizeof(GLuint) * welded->index_num);
+	memset(remap, 0xff, sizeof(int) * welded->vertex_num);
+
+	for (int i = 0; i < welded->index_num; i++)
+	{
+		GLuint index = GetIndex(welded, i);
+		if (remap[index] < 0)
+		{
+			memcpy(vertices + used * welded->stride, welded->vertices + index * welded->stride, vertexSize);
+			remap[index] = used++;
+		}
+		indices[i] = remap[index];
+	}
+
+	memcpy(welded->vertices, vertices, vertexSize * used);
+	welded->vertex_num = used;
+
+	// the index buffer was sized for 32 bit indices, 16 bit ones fit in its front half
+	if (welded->index_type == GL_UNSIGNED_INT && used <= 65536)
+	{
+		welded->index_type = GL_UNSIGNED_SHORT;
+		welded->index_size = sizeof(GLushort);
+	}
+	for (int i = 0; i < welded->index_num; i++)
+		SetIndex(welded, i, indices[i]);
+
+	ArenaFree(&scratch);
+	return TRUE;
+}
+
+VertexCacheStats SimulateVertexCache(const IndexedMesh* welded, int cacheSize, int lru)
+{
+	VertexCacheStats stats;
+	int* cache = (int*)malloc(sizeof(int) * cacheSize);
+	int* insertedAt = (int*)malloc(sizeof(int) * welded->vertex_num);
+	int count = 0;
+
+	memset(&stats, 0, sizeof(VertexCacheStats));
+	if (cache == NULL || insertedAt == NULL)
+	{
+		free(cache);
+		free(insertedAt);
+		return stats;
+	}
+
+	for (int v = 0; v < welded->vertex_num; v++)
+		insertedAt[v] = -cacheSize - 1;
+
+	for (int i = 0; i < welded->index_num; i++)
+	{
+		int v = GetIndex(welded, i);
+
+		if (!lru)
+		{
+			// a FIFO entry lives for the next cacheSize misses after it came in
+			if (stats.misses - insertedAt[v] > cacheSize)
+			{
+				insertedAt[v] = stats.misses;
+				stats.misses++;
+			}
+		}
+		else
+		{
+			int pos = 0;
+			while (pos < count && cache[pos] != v)
+				pos++;
+
+			if (pos == count)
+			{
+				stats.misses++;
+				if (count < cacheSize)
+					count++;
+				pos = count - 1;
+			}
+			// move to the front, the least recently used entry drops off the back
+			memmove(cache + 1, cache, sizeof(int) * pos);
+			cache[0] = v;
+		}
+	}
+
+	stats.acmr = welded->index_num > 0 ? stats.misses / (welded->index_num / 3.0) : 0.0;
+	stats.atvr = welded->vertex_num > 0 ? (double)stats.misses / welded->vertex_num : 0.0;
+
+	free(cache);
+	free(insertedAt);
+	return stats;
+}
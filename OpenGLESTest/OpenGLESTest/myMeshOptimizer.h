@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef MYMESHOPTIMIZER_H
+#define MYMESHOPTIMIZER_H
+
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+#include "myMesh.h"
+
+// size of the post-transform cache OptimizeVertexCache is tuned for
+#define VERTEX_CACHE_SIZE 32
+
+// reorder the triangles of welded so consecutive triangles share vertices while they are still
+// in the post-transform cache (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation").
+// The triangles themselves and their winding don't change. Return TRUE on success.
+int OptimizeVertexCache(IndexedMesh* welded);
+
+// renumber the vertices of welded in the order the index buffer first uses them, so vertex fetch
+// walks the vertex buffer front to back. Vertices no triangle uses are dropped, 32 bit indices
+// become 16 bit when the remaining vertices allow it. Return TRUE on success.
+int OptimizeVertexFetch(IndexedMesh* welded);
+
+// Result of replaying the index buffer through a simulated post-transform cache
+// ACMR: vertex shader runs per triangle (0.5 is the ideal for a large regular grid, 3 means no reuse)
+// ATVR: vertex shader runs per vertex (1 is the ideal)
+typedef struct
+{
+	int misses;
+	double acmr;
+	double atvr;
+} VertexCacheStats;
+
+// replay welded through a FIFO (lru == FALSE) or LRU (lru == TRUE) cache of cacheSize vertices
+VertexCacheStats SimulateVertexCache(const IndexedMesh* welded, int cacheSize, int lru);
+
+#endif
@@ -0,0 +1,99 @@
+// myMeshOptimizerBench.c
+//
+//    ACMR / ATVR of the welded models before and after OptimizeVertexCache + OptimizeVertexFetch,
+//    measured by replaying the index buffer through FIFO and LRU post-transform caches on the CPU.
+//    Put this file in the project instead of MyObj3.c (together with myObjLoader.c, myMesh.c
+//    and myMeshOptimizer.c).
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "esUtil.h"
+#include "myMesh.h"
+#include "myMeshOptimizer.h"
+#include "myBench.h"
+
+static const int cacheSizes[] = { 16, 32 };
+
+// order independent fingerprint of the triangles, reordering must keep it
+static unsigned long long TriangleFingerprint(const IndexedMesh* welded)
+{
+	unsigned long long sum = 0;
+
+	for (int t = 0; t < welded->index_num / 3; t++)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint index = welded->index_type == GL_UNSIGNED_SHORT ?
+				((const GLushort*)welded->indices)[t * 3 + k] : ((const GLuint*)welded->indices)[t * 3 + k];
+			const unsigned char* bytes = (const unsigned char*)(welded->vertices + index * welded->stride);
+
+			for (size_t i = 0; i < sizeof(GLfloat) * welded->stride; i++)
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		sum += hash;
+	}
+	return sum;
+}
+
+static void PrintCacheStats(const char* label, const IndexedMesh* welded)
+{
+	printf("  %-10s", label);
+	for (int i = 0; i < (int)(sizeof(cacheSizes) / sizeof(cacheSizes[0])); i++)
+	{
+		VertexCacheStats fifo = SimulateVertexCache(welded, cacheSizes[i], FALSE);
+		VertexCacheStats lru = SimulateVertexCache(welded, cacheSizes[i], TRUE);
+		printf("  FIFO%-2d %.3f / %.3f  LRU%-2d %.3f / %.3f",
+			cacheSizes[i], fifo.acmr, fifo.atvr, cacheSizes[i], lru.acmr, lru.atvr);
+	}
+	printf("\n");
+}
+
+static void BenchModel(const char* filename)
+{
+	MeshData mesh;
+	IndexedMesh welded;
+	unsigned long long before;
+	double start, cacheTime, fetchTime;
+
+	if (!LoadObjMesh(filename, &mesh) || !WeldMesh(&mesh, MESH_ATTRIB_TEXCOORD, &welded))
+	{
+		printf("%-12s cannot be loaded\n", filename);
+		return;
+	}
+
+	printf("%s: %d triangles, %d vertices (ACMR / ATVR)\n", filename, welded.index_num / 3, welded.vertex_num);
+	PrintCacheStats("file order", &welded);
+	before = TriangleFingerprint(&welded);
+
+	start = BenchNow();
+	OptimizeVertexCache(&welded);
+	cacheTime = BenchNow() - start;
+
+	start = BenchNow();
+	OptimizeVertexFetch(&welded);
+	fetchTime = BenchNow() - start;
+
+	PrintCacheStats("optimized", &welded);
+	printf("  vertex cache %.3f ms, vertex fetch %.3f ms, %s\n",
+		cacheTime * 1000.0, fetchTime * 1000.0,
+		before == TriangleFingerprint(&welded) ? "same triangles" : "TRIANGLES CHANGED");
+
+	FreeIndexedMesh(&welded);
+	FreeMesh(&mesh);
+}
+
+int esMain(ESContext* esContext)
+{
+	const char* models[] = { "ailian.obj", "bear.obj", "stone.obj" };
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	for (int i = 0; i < (int)(sizeof(models) / sizeof(models[0])); i++)
+		BenchModel(models[i]);
+
+	// nothing to render
+	exit(0);
+}
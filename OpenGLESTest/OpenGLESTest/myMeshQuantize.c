@@ -0,0 +1,413 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "myMeshQuantize.h"
+
+#define SNORM16_MAX 32767.0f
+#define UNORM16_MAX 65535.0f
+#define SNORM10_MAX 511.0f
+
+#define RADIANS_TO_DEGREES (180.0f / 3.14159265f)
+
+// round to nearest even like the GPU converts, infinity above 65504, subnormals below 2^-14
+static GLushort FloatToHalf(GLfloat value)
+{
+	union { GLfloat f; unsigned int u; } bits;
+	unsigned int sign, exponent, mantissa, half, rest, halfway;
+	int shift;
+
+	bits.f = value;
+	sign = (bits.u >> 16) & 0x8000;
+	exponent = (bits.u >> 23) & 0xff;
+	mantissa = bits.u & 0x7fffff;
+
+	if (exponent == 0xff)
+		return (GLushort)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	if (exponent > 127 + 15)
+		return (GLushort)(sign | 0x7c00);
+
+	if (exponent >= 127 - 14)
+	{
+		// normal half, a carry out of the mantissa moves on into the exponent
+		half = ((exponent - 127 + 15) << 10) | (mantissa >> 13);
+		rest = mantissa & 0x1fff;
+		if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+			half++;
+		return (GLushort)(sign | half);
+	}
+
+	// subnormal half, steps of 2^-24
+	shift = 126 - (int)exponent;
+	if (shift > 24)
+		return (GLushort)sign;
+	mantissa |= 0x800000;
+	half = mantissa >> shift;
+	rest = mantissa & ((1u << shift) - 1);
+	halfway = 1u << (shift - 1);
+	if (rest > halfway || (rest == halfway && (half & 1)))
+		half++;
+	return (GLushort)(sign | half);
+}
+
+static GLfloat HalfToFloat(GLushort half)
+{
+	int exponent = (half >> 10) & 0x1f;
+	int mantissa = half & 0x3ff;
+	GLfloat value;
+
+	if (exponent == 0)
+		value = ldexpf((GLfloat)mantissa, -24);
+	else if (exponent == 0x1f)
+		value = mantissa == 0 ? HUGE_VALF : NAN;
+	else
+		value = ldexpf((GLfloat)(mantissa | 0x400), exponent - 25);
+	return (half & 0x8000) ? -value : value;
+}
+
+static GLshort ToSnorm16(GLfloat value)
+{
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return (GLshort)lrintf(value * SNORM16_MAX);
+}
+
+// the spacing of floats around value
+static GLfloat FloatUlp(GLfloat value)
+{
+	int exponent;
+	frexpf(value, &exponent);
+	return ldexpf(1.0f, exponent - 24);
+}
+
+// what the GPU reads from a normalized GL_SHORT
+static GLfloat FromSnorm16(int value)
+{
+	GLfloat ret = (GLfloat)value / SNORM16_MAX;
+	return ret < -1.0f ? -1.0f : ret;
+}
+
+static void Normalize(GLfloat* n)
+{
+	GLfloat length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (length > 0.0f)
+	{
+		n[0] /= length;
+		n[1] /= length;
+		n[2] /= length;
+	}
+}
+
+static GLfloat Sign(GLfloat value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// the unit normal n onto the octahedron, folded into [-1,1]^2
+static void OctEncode(const GLfloat* n, GLfloat* e)
+{
+	GLfloat l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	GLfloat x = l1 > 0.0f ? n[0] / l1 : 0.0f;
+	GLfloat y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+
+	if (n[2] < 0.0f)
+	{
+		e[0] = (1.0f - fabsf(y)) * Sign(x);
+		e[1] = (1.0f - fabsf(x)) * Sign(y);
+	}
+	else
+	{
+		e[0] = x;
+		e[1] = y;
+	}
+}
+
+// the shader's octDecode
+static void OctDecode(GLfloat ex, GLfloat ey, GLfloat* n)
+{
+	n[0] = ex;
+	n[1] = ey;
+	n[2] = 1.0f - fabsf(ex) - fabsf(ey);
+	if (n[2] < 0.0f)
+	{
+		n[0] = (1.0f - fabsf(ey)) * Sign(ex);
+		n[1] = (1.0f - fabsf(ex)) * Sign(ey);
+	}
+	Normalize(n);
+}
+
+// acos of the dot product can't resolve angles below 0.02 degrees in float, atan2 of sine and cosine can
+static GLfloat AngleBetween(const GLfloat* a, const GLfloat* b)
+{
+	GLfloat cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+	GLfloat sine = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+	return atan2f(sine, a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) * RADIANS_TO_DEGREES;
+}
+
+// rounding both coordinates to the nearest step is not the closest normal after the decode,
+// the four steps around the encoded point are tried instead
+static void PackOct16(const GLfloat* n, GLshort* ret)
+{
+	GLfloat e[2], decoded[3];
+	GLfloat best = 5.0f;
+
+	OctEncode(n, e);
+	GLfloat x = floorf(e[0] * SNORM16_MAX);
+	GLfloat y = floorf(e[1] * SNORM16_MAX);
+
+	for (int i = 0; i < 4; i++)
+	{
+		GLfloat qx = x + (i & 1);
+		GLfloat qy = y + (i >> 1);
+		if (qx > SNORM16_MAX || qy > SNORM16_MAX)
+			continue;
+
+		OctDecode(FromSnorm16((int)qx), FromSnorm16((int)qy), decoded);
+		GLfloat d[3] = { decoded[0] - n[0], decoded[1] - n[1], decoded[2] - n[2] };
+		GLfloat distance = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (distance < best)
+		{
+			best = distance;
+			ret[0] = (GLshort)qx;
+			ret[1] = (GLshort)qy;
+		}
+	}
+}
+
+static GLuint Pack1010102(const GLfloat* n)
+{
+	GLuint ret = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		GLfloat value = n[k] < -1.0f ? -1.0f : (n[k] > 1.0f ? 1.0f : n[k]);
+		ret |= ((GLuint)lrintf(value * SNORM10_MAX) & 0x3ff) << (10 * k);
+	}
+	return ret | (1u << 30); // w = 1
+}
+
+static void Unpack1010102(GLuint packed, GLfloat* n)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		int value = (int)((packed >> (10 * k)) & 0x3ff);
+		if (value & 0x200)
+			value -= 0x400;
+		n[k] = (GLfloat)value / SNORM10_MAX;
+		if (n[k] < -1.0f)
+			n[k] = -1.0f;
+	}
+	Normalize(n);
+}
+
+int QuantizeMesh(const IndexedMesh* welded, int texcoordFormat, int normalFormat, QuantizedMesh* ret)
+{
+	GLfloat center[3], halfExtent[3];
+	GLfloat texcoordMin[2] = { 0.0f, 0.0f };
+	GLfloat texcoordMax[2] = { 0.0f, 0.0f };
+	GLfloat texcoordRange[2];
+	GLfloat bound;
+
+	memset(ret, 0, sizeof(QuantizedMesh));
+	ret->vertex_num = welded->vertex_num;
+
+	ret->position.size = 4;
+	ret->position.type = GL_SHORT;
+	ret->position.normalized = GL_TRUE;
+	ret->position.offset = 0;
+	ret->vertex_size = 4 * sizeof(GLshort);
+
+	ret->texcoord.offset = -1;
+	if (welded->texcoord_offset >= 0)
+	{
+		ret->texcoord.size = 2;
+		ret->texcoord.type = texcoordFormat == QUANTIZE_TEXCOORD_UNORM16 ? GL_UNSIGNED_SHORT : GL_HALF_FLOAT;
+		ret->texcoord.normalized = texcoordFormat == QUANTIZE_TEXCOORD_UNORM16 ? GL_TRUE : GL_FALSE;
+		ret->texcoord.offset = ret->vertex_size;
+		ret->vertex_size += 2 * sizeof(GLushort);
+	}
+
+	ret->normal.offset = -1;
+	if (welded->normal_offset >= 0)
+	{
+		ret->normal.size = normalFormat == QUANTIZE_NORMAL_1010102 ? 4 : 2;
+		ret->normal.type = normalFormat == QUANTIZE_NORMAL_1010102 ? GL_INT_2_10_10_10_REV : GL_SHORT;
+		ret->normal.normalized = GL_TRUE;
+		ret->normal.offset = ret->vertex_size;
+		ret->vertex_size += 4;
+	}
+
+	if (!ArenaInit(&ret->arena, (size_t)ret->vertex_size * ret->vertex_num))
+	{
+		return FALSE;
+	}
+	ret->vertices = ArenaAlloc(&ret->arena, (size_t)ret->vertex_size * ret->vertex_num);
+
+	// positions: the bounding box onto [-1,1] on every axis
+	for (int k = 0; k < 3; k++)
+	{
+		center[k] = (welded->bbox_min[k] + welded->bbox_max[k]) * 0.5f;
+		halfExtent[k] = (welded->bbox_max[k] - welded->bbox_min[k]) * 0.5f;
+		// plus the float rounding of scaling and moving back at the magnitude of the coordinates
+		bound = halfExtent[k] * 0.5f / SNORM16_MAX + FloatUlp(halfExtent[k] + fabsf(center[k]));
+		if (bound > ret->position_bound)
+			ret->position_bound = bound;
+	}
+
+	esMatrixLoadIdentity(&ret->dequantize);
+	for (int k = 0; k < 3; k++)
+	{
+		ret->dequantize.m[k][k] = halfExtent[k];
+		ret->dequantize.m[3][k] = center[k];
+	}
+
+	// texcoords: bounds for unorm16, the largest magnitude sets the step of half floats
+	ret->texcoord_scale_bias[0] = 1.0f;
+	ret->texcoord_scale_bias[1] = 1.0f;
+	if (ret->texcoord.offset >= 0)
+	{
+		for (int i = 0; i < welded->vertex_num; i++)
+		{
+			const GLfloat* texcoord = welded->vertices + i * welded->stride + welded->texcoord_offset;
+			for (int k = 0; k < 2; k++)
+			{
+				if (i == 0 || texcoord[k] < texcoordMin[k])
+					texcoordMin[k] = texcoord[k];
+				if (i == 0 || texcoord[k] > texcoordMax[k])
+					texcoordMax[k] = texcoord[k];
+			}
+		}
+
+		for (int k = 0; k < 2; k++)
+		{
+			texcoordRange[k] = texcoordMax[k] - texcoordMin[k];
+			if (texcoordFormat == QUANTIZE_TEXCOORD_UNORM16)
+			{
+				ret->texcoord_scale_bias[k] = texcoordRange[k];
+				ret->texcoord_scale_bias[2 + k] = texcoordMin[k];
+				bound = texcoordRange[k] * 0.5f / UNORM16_MAX + FloatUlp(texcoordRange[k] + fabsf(texcoordMin[k]));
+				if (bound > ret->texcoord_bound)
+					ret->texcoord_bound = bound;
+			}
+			else
+			{
+				GLfloat largest = fmaxf(fabsf(texcoordMin[k]), fabsf(texcoordMax[k]));
+				int exponent;
+				frexpf(largest, &exponent);
+				// half a step of the 10 bit mantissa at the largest value, never below the subnormal step
+				bound = fmaxf(ldexpf(1.0f, exponent - 12), ldexpf(1.0f, -25));
+				if (bound > ret->texcoord_bound)
+					ret->texcoord_bound = bound;
+			}
+		}
+	}
+
+	for (int i = 0; i < welded->vertex_num; i++)
+	{
+		const GLfloat* vertex = welded->vertices + i * welded->stride;
+		unsigned char* packed = (unsigned char*)ret->vertices + (size_t)i * ret->vertex_size;
+		GLshort* position = (GLshort*)packed;
+
+		for (int k = 0; k < 3; k++)
+		{
+			GLfloat scaled = halfExtent[k] > 0.0f ? (vertex[k] - center[k]) / halfExtent[k] : 0.0f;
+			position[k] = ToSnorm16(scaled);
+
+			GLfloat error = fabsf(FromSnorm16(position[k]) * halfExtent[k] + center[k] - vertex[k]);
+			if (error > ret->position_error)
+				ret->position_error = error;
+		}
+		position[3] = (GLshort)SNORM16_MAX;
+
+		if (ret->texcoord.offset >= 0)
+		{
+			const GLfloat* texcoord = vertex + welded->texcoord_offset;
+			GLushort* packedTexcoord = (GLushort*)(packed + ret->texcoord.offset);
+
+			for (int k = 0; k < 2; k++)
+			{
+				GLfloat unpacked;
+				if (texcoordFormat == QUANTIZE_TEXCOORD_UNORM16)
+				{
+					GLfloat scaled = texcoordRange[k] > 0.0f ? (texcoord[k] - texcoordMin[k]) / texcoordRange[k] : 0.0f;
+					packedTexcoord[k] = (GLushort)lrintf(scaled * UNORM16_MAX);
+					unpacked = packedTexcoord[k] / UNORM16_MAX * texcoordRange[k] + texcoordMin[k];
+				}
+				else
+				{
+					packedTexcoord[k] = FloatToHalf(texcoord[k]);
+					unpacked = HalfToFloat(packedTexcoord[k]);
+				}
+
+				if (fabsf(unpacked - texcoord[k]) > ret->texcoord_error)
+					ret->texcoord_error = fabsf(unpacked - texcoord[k]);
+			}
+		}
+
+		if (ret->normal.offset >= 0)
+		{
+			GLfloat normal[3], unpacked[3];
+			memcpy(normal, vertex + welded->normal_offset, sizeof(normal));
+			Normalize(normal);
+
+			if (normalFormat == QUANTIZE_NORMAL_1010102)
+			{
+				GLuint value = Pack1010102(normal);
+				memcpy(packed + ret->normal.offset, &value, sizeof(value));
+				Unpack1010102(value, unpacked);
+			}
+			else
+			{
+				GLshort* octahedral = (GLshort*)(packed + ret->normal.offset);
+				PackOct16(normal, octahedral);
+				OctDecode(FromSnorm16(octahedral[0]), FromSnorm16(octahedral[1]), unpacked);
+			}
+
+			// corners without vn have a zero normal, nothing to compare with
+			if (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f)
+			{
+				GLfloat error = AngleBetween(normal, unpacked);
+				if (error > ret->normal_error)
+					ret->normal_error = error;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static void QuantizedAttribPointer(GLuint index, const QuantizedAttrib* attrib, int stride)
+{
+	glVertexAttribPointer(index, attrib->size, attrib->type, attrib->normalized, stride,
+		(const void*)(size_t)attrib->offset);
+}
+
+void QuantizedAttribPointers(const QuantizedMesh* quantized, GLuint positionIndex, GLint texcoordIndex, GLint normalIndex)
+{
+	QuantizedAttribPointer(positionIndex, &quantized->position, quantized->vertex_size);
+	if (texcoordIndex >= 0 && quantized->texcoord.offset >= 0)
+		QuantizedAttribPointer(texcoordIndex, &quantized->texcoord, quantized->vertex_size);
+	if (normalIndex >= 0 && quantized->normal.offset >= 0)
+		QuantizedAttribPointer(normalIndex, &quantized->normal, quantized->vertex_size);
+}
+
+void FreeQuantizedMesh(QuantizedMesh* quantized)
+{
+	ArenaFree(&quantized->arena);
+	memset(quantized, 0, sizeof(QuantizedMesh));
+}
+
+void PrintQuantizeStats(const char* name, const IndexedMesh* welded, const QuantizedMesh* quantized)
+{
+	double floatBytes = (double)welded->vertex_num * sizeof(GLfloat) * welded->stride;
+	double packedBytes = (double)quantized->vertex_num * quantized->vertex_size;
+
+	printf("%s: %d bytes per vertex -> %d, %.1f KB -> %.1f KB (%.1f%% of the vertex fetch bandwidth saved)\n",
+		name, (int)(sizeof(GLfloat) * welded->stride), quantized->vertex_size, floatBytes / 1024.0, packedBytes / 1024.0,
+		floatBytes > 0.0 ? 100.0 * (floatBytes - packedBytes) / floatBytes : 0.0);
+	printf("  position snorm16: error %g (bound %g) model units\n", quantized->position_error, quantized->position_bound);
+	if (quantized->texcoord.offset >= 0)
+		printf("  texcoord %s: error %g (bound %g)\n", quantized->texcoord.type == GL_HALF_FLOAT ? "half" : "unorm16",
+			quantized->texcoord_error, quantized->texcoord_bound);
+	if (quantized->normal.offset >= 0)
+		printf("  normal %s: error %.4f degrees\n", quantized->normal.type == GL_SHORT ? "octahedral snorm16" : "10_10_10_2",
+			quantized->normal_error);
+}
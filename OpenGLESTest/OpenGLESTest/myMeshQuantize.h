@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef MYMESHQUANTIZE_H
+#define MYMESHQUANTIZE_H
+
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+#include "myMesh.h"
+
+// Packing stage for a welded mesh: the float vertices of IndexedMesh become 12 to 16 bytes each,
+// the index buffer stays the one of the welded mesh.
+//
+// position  4 x GL_SHORT normalized, the bounding box mapped onto [-1,1] and w = 1,
+//           dequantize takes them back to model space
+// texcoord  2 x GL_HALF_FLOAT, or 2 x GL_UNSIGNED_SHORT normalized over the texcoord bounds
+// normal    octahedral 2 x GL_SHORT normalized, decoded with QUANTIZE_OCT_DECODE_GLSL,
+//           or GL_INT_2_10_10_10_REV normalized, read as it is
+#define QUANTIZE_TEXCOORD_HALF    0
+#define QUANTIZE_TEXCOORD_UNORM16 1
+
+#define QUANTIZE_NORMAL_OCT16     0
+#define QUANTIZE_NORMAL_1010102   1
+
+// paste into a vertex shader using QUANTIZE_NORMAL_OCT16: vec3 octDecode(vec2 e)
+#define QUANTIZE_OCT_DECODE_GLSL \
+	"vec3 octDecode(vec2 e)                                          \n" \
+	"{                                                               \n" \
+	"   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));                 \n" \
+	"   if (n.z < 0.0)                                               \n" \
+	"      n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0,  \n" \
+	"                                      n.y >= 0.0 ? 1.0 : -1.0); \n" \
+	"   return normalize(n);                                         \n" \
+	"}                                                               \n"
+
+// what glVertexAttribPointer needs for one attribute of the packed vertices
+typedef struct
+{
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	int offset;                    // bytes into the vertex, -1 when the attribute is not there
+} QuantizedAttrib;
+
+typedef struct
+{
+	int vertex_num;
+	int vertex_size;               // bytes per vertex, a multiple of 4
+	void* vertices;
+
+	QuantizedAttrib position;
+	QuantizedAttrib texcoord;
+	QuantizedAttrib normal;
+
+	// premultiply into the model matrix (esMatrixMultiply(&model, &dequantize, &model)),
+	// it scales and moves the [-1,1] positions back onto the bounding box
+	ESMatrix dequantize;
+
+	// texcoord = a_texCoord * texcoord_scale_bias.xy + texcoord_scale_bias.zw, identity for half floats
+	GLfloat texcoord_scale_bias[4];
+
+	// error of the packed attributes, measured by unpacking every vertex like the GPU does.
+	// The bounds are what the formats guarantee: half a step on the coarsest axis, plus one float
+	// ulp at the magnitude of the coordinates for the scale and bias of the normalized formats.
+	GLfloat position_error;        // model units
+	GLfloat position_bound;
+	GLfloat texcoord_error;
+	GLfloat texcoord_bound;
+	GLfloat normal_error;          // degrees
+
+	MeshArena arena;
+} QuantizedMesh;
+
+// pack the vertices of welded, texcoordFormat is one of QUANTIZE_TEXCOORD_*, normalFormat one of
+// QUANTIZE_NORMAL_*. Attributes welded doesn't have are left out of the packed vertex as well.
+int QuantizeMesh(const IndexedMesh* welded, int texcoordFormat, int normalFormat, QuantizedMesh* ret);
+
+// glVertexAttribPointer for every attribute of the mesh, with its vertices in the bound GL_ARRAY_BUFFER
+// from offset 0. texcoordIndex / normalIndex are -1 for attributes the program doesn't use.
+void QuantizedAttribPointers(const QuantizedMesh* quantized, GLuint positionIndex, GLint texcoordIndex, GLint normalIndex);
+
+void FreeQuantizedMesh(QuantizedMesh* quantized);
+
+// print the error of every attribute and the vertex bytes saved against the float vertices of welded
+void PrintQuantizeStats(const char* name, const IndexedMesh* welded, const QuantizedMesh* quantized);
+
+#endif
@@ -0,0 +1,70 @@
+// myMeshQuantizeBench.c
+//
+//    Error and vertex bytes of QuantizeMesh on every model of the samples, for the four
+//    texcoord / normal format pairs, against the float vertices of WeldMesh.
+//    Put this file in the project instead of MyObj3.c (together with myObjLoader.c, myMesh.c
+//    and myMeshQuantize.c) and run it in the directory of the models.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include "esUtil.h"
+#include "myMesh.h"
+#include "myMeshQuantize.h"
+#include "myBench.h"
+
+static const char* models[] = { "cube.obj", "bear.obj", "ailian.obj", "stone.obj" };
+
+static const int texcoordFormats[] = { QUANTIZE_TEXCOORD_HALF, QUANTIZE_TEXCOORD_UNORM16 };
+static const int normalFormats[] = { QUANTIZE_NORMAL_OCT16, QUANTIZE_NORMAL_1010102 };
+
+int esMain(ESContext* esContext)
+{
+	int failed = 0;
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	for (int m = 0; m < (int)(sizeof(models) / sizeof(models[0])); m++)
+	{
+		MeshData mesh;
+		IndexedMesh welded;
+
+		if (!LoadObjMesh(models[m], &mesh) || !WeldMesh(&mesh, MESH_ATTRIB_TEXCOORD | MESH_ATTRIB_NORMAL, &welded))
+		{
+			printf("%s cannot be loaded\n", models[m]);
+			failed++;
+			continue;
+		}
+		FreeMesh(&mesh);
+
+		for (int t = 0; t < (int)(sizeof(texcoordFormats) / sizeof(texcoordFormats[0])); t++)
+		{
+			for (int n = 0; n < (int)(sizeof(normalFormats) / sizeof(normalFormats[0])); n++)
+			{
+				QuantizedMesh quantized;
+				double start = BenchNow();
+
+				if (!QuantizeMesh(&welded, texcoordFormats[t], normalFormats[n], &quantized))
+				{
+					printf("%s cannot be quantized\n", models[m]);
+					failed++;
+					continue;
+				}
+				double elapsed = BenchNow() - start;
+
+				PrintQuantizeStats(models[m], &welded, &quantized);
+				printf("  packed in %.3f ms\n", elapsed * 1000.0);
+				if (quantized.position_error > quantized.position_bound || quantized.texcoord_error > quantized.texcoord_bound)
+				{
+					printf("  error above its bound\n");
+					failed++;
+				}
+				FreeQuantizedMesh(&quantized);
+			}
+		}
+		FreeIndexedMesh(&welded);
+	}
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
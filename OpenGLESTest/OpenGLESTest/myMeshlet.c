@@ -0,0 +1,551 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "myMeshlet.h"
+
+static GLuint IndexAt(const void* indices, GLenum type, int i)
+{
+	return type == GL_UNSIGNED_SHORT ? ((const GLushort*)indices)[i] : ((const GLuint*)indices)[i];
+}
+
+static void SetIndex(void* indices, GLenum type, int i, GLuint index)
+{
+	if (type == GL_UNSIGNED_SHORT)
+		((GLushort*)indices)[i] = (GLushort)index;
+	else
+		((GLuint*)indices)[i] = index;
+}
+
+static void Normalize(GLfloat* v)
+{
+	GLfloat length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length > 0.0f)
+	{
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+static void FaceNormal(const GLfloat* a, const GLfloat* b, const GLfloat* c, GLfloat* ret)
+{
+	GLfloat ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	GLfloat ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+	ret[0] = ab[1] * ac[2] - ab[2] * ac[1];
+	ret[1] = ab[2] * ac[0] - ab[0] * ac[2];
+	ret[2] = ab[0] * ac[1] - ab[1] * ac[0];
+	Normalize(ret);
+}
+
+// bounding sphere around the box of the positions and the cone around the mean face normal
+static void MeshletBounds(const IndexedMesh* welded, const void* indices, GLenum type, Meshlet* meshlet)
+{
+	GLfloat boxMin[3], boxMax[3];
+	GLfloat axis[3] = { 0.0f, 0.0f, 0.0f };
+	GLfloat radius2 = 0.0f;
+	GLfloat minDot = 1.0f;
+	int end = meshlet->index_offset + meshlet->index_num;
+
+	meshlet->vertex_min = IndexAt(indices, type, meshlet->index_offset);
+	meshlet->vertex_max = meshlet->vertex_min;
+	memcpy(boxMin, welded->vertices + meshlet->vertex_min * welded->stride, sizeof(boxMin));
+	memcpy(boxMax, boxMin, sizeof(boxMax));
+
+	for (int i = meshlet->index_offset; i < end; i++)
+	{
+		GLuint index = IndexAt(indices, type, i);
+		const GLfloat* position = welded->vertices + index * welded->stride;
+
+		if (index < meshlet->vertex_min)
+			meshlet->vertex_min = index;
+		if (index > meshlet->vertex_max)
+			meshlet->vertex_max = index;
+		for (int k = 0; k < 3; k++)
+		{
+			boxMin[k] = position[k] < boxMin[k] ? position[k] : boxMin[k];
+			boxMax[k] = position[k] > boxMax[k] ? position[k] : boxMax[k];
+		}
+	}
+
+	for (int k = 0; k < 3; k++)
+		meshlet->center[k] = (boxMin[k] + boxMax[k]) * 0.5f;
+
+	for (int i = meshlet->index_offset; i < end; i++)
+	{
+		const GLfloat* position = welded->vertices + IndexAt(indices, type, i) * welded->stride;
+		GLfloat d[3] = { position[0] - meshlet->center[0], position[1] - meshlet->center[1], position[2] - meshlet->center[2] };
+		GLfloat distance2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+		if (distance2 > radius2)
+			radius2 = distance2;
+	}
+	meshlet->radius = sqrtf(radius2);
+
+	for (int i = meshlet->index_offset; i < end; i += 3)
+	{
+		GLfloat normal[3];
+		FaceNormal(welded->vertices + IndexAt(indices, type, i) * welded->stride,
+			welded->vertices + IndexAt(indices, type, i + 1) * welded->stride,
+			welded->vertices + IndexAt(indices, type, i + 2) * welded->stride, normal);
+		for (int k = 0; k < 3; k++)
+			axis[k] += normal[k];
+	}
+	Normalize(axis);
+	memcpy(meshlet->cone_axis, axis, sizeof(axis));
+
+	for (int i = meshlet->index_offset; i < end; i += 3)
+	{
+		GLfloat normal[3];
+		FaceNormal(welded->vertices + IndexAt(indices, type, i) * welded->stride,
+			welded->vertices + IndexAt(indices, type, i + 1) * welded->stride,
+			welded->vertices + IndexAt(indices, type, i + 2) * welded->stride, normal);
+
+		// degenerate triangles have no normal and face nowhere
+		if (normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f)
+			continue;
+		GLfloat dot = normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2];
+		if (dot < minDot)
+			minDot = dot;
+	}
+
+	// no cone when the normals spread over half the sphere or cancel each other out
+	meshlet->cone_cutoff = minDot <= 0.0f || (axis[0] == 0.0f && axis[1] == 0.0f && axis[2] == 0.0f) ?
+		1.0f : sqrtf(1.0f - minDot * minDot);
+}
+
+// Scratch of BuildMeshlets: triangles around every position (offsets into a list, like a CSR matrix),
+// the unit normal of every triangle and the state of the cluster being grown
+typedef struct
+{
+	int* remap;                // first vertex with the same position, vertices split by texcoords are one for the adjacency
+	int* adjacencyOffsets;     // vertex_num + 1
+	int* adjacency;            // triangles around remap[v] in adjacency[adjacencyOffsets[remap[v]] .. adjacencyOffsets[remap[v] + 1])
+	GLfloat* normals;          // 3 per triangle
+	unsigned char* emitted;
+
+	int* stamps;               // cluster that last used every vertex
+	int cluster;
+	int vertices[MESHLET_MAX_VERTICES];
+	int vertexNum;
+	int triangles[MESHLET_MAX_TRIANGLES];
+	int triangleNum;
+	GLfloat normalSum[3];
+} MeshletBuilder;
+
+// vertices of triangle t not yet in the cluster
+static int NewVertices(const MeshletBuilder* builder, const GLuint* corner)
+{
+	int added = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		if (builder->stamps[corner[k]] != builder->cluster && (k == 0 || corner[k] != corner[0]) &&
+			(k < 2 || corner[2] != corner[1]))
+			added++;
+	}
+	return added;
+}
+
+static void AddTriangle(MeshletBuilder* builder, const IndexedMesh* welded, int t)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		GLuint index = IndexAt(welded->indices, welded->index_type, t * 3 + k);
+		if (builder->stamps[index] != builder->cluster)
+		{
+			builder->stamps[index] = builder->cluster;
+			builder->vertices[builder->vertexNum++] = index;
+		}
+		builder->normalSum[k] += builder->normals[t * 3 + k];
+	}
+	builder->triangles[builder->triangleNum++] = t;
+	builder->emitted[t] = TRUE;
+}
+
+// the neighbour of the cluster to add next, -1 when none fits
+static int NextTriangle(const MeshletBuilder* builder, const IndexedMesh* welded)
+{
+	GLfloat axis[3], bestScore = 1e30f;
+	int best = -1;
+
+	memcpy(axis, builder->normalSum, sizeof(axis));
+	Normalize(axis);
+
+	for (int i = 0; i < builder->vertexNum; i++)
+	{
+		int v = builder->remap[builder->vertices[i]];
+		for (int a = builder->adjacencyOffsets[v]; a < builder->adjacencyOffsets[v + 1]; a++)
+		{
+			int t = builder->adjacency[a];
+			GLuint corner[3];
+			if (builder->emitted[t])
+				continue;
+
+			for (int k = 0; k < 3; k++)
+				corner[k] = IndexAt(welded->indices, welded->index_type, t * 3 + k);
+			int added = NewVertices(builder, corner);
+			if (builder->vertexNum + added > MESHLET_MAX_VERTICES)
+				continue;
+
+			// a shared vertex more is worth as much as a normal turned all the way round
+			const GLfloat* normal = builder->normals + t * 3;
+			GLfloat score = added + (1.0f - (normal[0] * axis[0] + normal[1] * axis[1] + normal[2] * axis[2])) * 0.5f;
+			if (score < bestScore)
+			{
+				bestScore = score;
+				best = t;
+			}
+		}
+	}
+	return best;
+}
+
+static unsigned int HashPosition(const GLfloat* position)
+{
+	const unsigned char* bytes = (const unsigned char*)position;
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(GLfloat) * 3; i++)
+		hash = (hash ^ bytes[i]) * 16777619u;
+	return hash;
+}
+
+// remap every vertex of welded to the first one at its position, with an open addressing table
+static void RemapPositions(const IndexedMesh* welded, int* table, unsigned int tableMask, int* remap)
+{
+	for (unsigned int i = 0; i <= tableMask; i++)
+		table[i] = -1;
+
+	for (int v = 0; v < welded->vertex_num; v++)
+	{
+		const GLfloat* position = welded->vertices + v * welded->stride;
+		unsigned int slot = HashPosition(position) & tableMask;
+
+		while (table[slot] >= 0 && memcmp(welded->vertices + table[slot] * welded->stride, position, sizeof(GLfloat) * 3) != 0)
+			slot = (slot + 1) & tableMask;
+		if (table[slot] < 0)
+			table[slot] = v;
+		remap[v] = table[slot];
+	}
+}
+
+// the positions of the corners of triangle t, FALSE when two of them are the same and t covers nothing
+static int TriangleCorners(const MeshletBuilder* builder, const IndexedMesh* welded, int t, int* corner)
+{
+	for (int k = 0; k < 3; k++)
+		corner[k] = builder->remap[IndexAt(welded->indices, welded->index_type, t * 3 + k)];
+	return corner[0] != corner[1] && corner[1] != corner[2] && corner[2] != corner[0];
+}
+
+// a back face is only hidden behind the front of the mesh when the surface has no holes and faces
+// one way: every edge is shared by exactly two triangles, which run along it in opposite directions
+static int IsClosed(const MeshletBuilder* builder, const IndexedMesh* welded, int triangleNum)
+{
+	for (int t = 0; t < triangleNum; t++)
+	{
+		int corner[3];
+		if (!TriangleCorners(builder, welded, t, corner))
+			continue;
+
+		for (int k = 0; k < 3; k++)
+		{
+			int from = corner[k], to = corner[(k + 1) % 3];
+			int along = 0, against = 0;
+
+			for (int a = builder->adjacencyOffsets[from]; a < builder->adjacencyOffsets[from + 1]; a++)
+			{
+				int other[3];
+				if (!TriangleCorners(builder, welded, builder->adjacency[a], other))
+					continue;
+				for (int j = 0; j < 3; j++)
+				{
+					along += other[j] == from && other[(j + 1) % 3] == to;
+					against += other[j] == to && other[(j + 1) % 3] == from;
+				}
+			}
+			if (along != 1 || against != 1)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static int CompareInts(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+int BuildMeshlets(const IndexedMesh* welded, MeshletMesh* ret)
+{
+	int triangleNum = welded->index_num / 3;
+	int vertexNum = welded->vertex_num;
+	int capacity = 64;
+	int seed = 0;
+	int written = 0;
+	MeshletBuilder builder;
+	MeshArena scratch;
+	Meshlet* meshlets;
+	void* indices;
+	int* table;
+	unsigned int tableSize = 1;
+
+	memset(ret, 0, sizeof(MeshletMesh));
+	ret->index_num = triangleNum * 3;
+	ret->index_type = welded->index_type;
+	ret->index_size = welded->index_size;
+
+	while (tableSize < (unsigned int)vertexNum * 2)
+		tableSize *= 2;
+
+	if (!ArenaInit(&scratch, sizeof(int) * (vertexNum + 1) + sizeof(int) * ret->index_num + sizeof(GLfloat) * 3 * triangleNum +
+		triangleNum + sizeof(int) * vertexNum * 2 + (size_t)ret->index_num * ret->index_size + sizeof(int) * tableSize + 8 * 16))
+	{
+		return FALSE;
+	}
+	memset(&builder, 0, sizeof(MeshletBuilder));
+	builder.remap = ArenaAlloc(&scratch, sizeof(int) * vertexNum);
+	table = ArenaAlloc(&scratch, sizeof(int) * tableSize);
+	builder.adjacencyOffsets = ArenaAlloc(&scratch, sizeof(int) * (vertexNum + 1));
+	builder.adjacency = ArenaAlloc(&scratch, sizeof(int) * ret->index_num);
+	builder.normals = ArenaAlloc(&scratch, sizeof(GLfloat) * 3 * triangleNum);
+	builder.emitted = ArenaAlloc(&scratch, triangleNum);
+	builder.stamps = ArenaAlloc(&scratch, sizeof(int) * vertexNum);
+	indices = ArenaAlloc(&scratch, (size_t)ret->index_num * ret->index_size);
+	meshlets = malloc(sizeof(Meshlet) * capacity);
+	if (meshlets == NULL)
+	{
+		ArenaFree(&scratch);
+		return FALSE;
+	}
+
+	// triangles around every position, counted, prefix summed, then filled
+	RemapPositions(welded, table, tableSize - 1, builder.remap);
+	memset(builder.adjacencyOffsets, 0, sizeof(int) * (vertexNum + 1));
+	for (int i = 0; i < ret->index_num; i++)
+		builder.adjacencyOffsets[builder.remap[IndexAt(welded->indices, welded->index_type, i)] + 1]++;
+	for (int v = 0; v < vertexNum; v++)
+		builder.adjacencyOffsets[v + 1] += builder.adjacencyOffsets[v];
+	for (int i = 0; i < ret->index_num; i++)
+	{
+		int position = builder.remap[IndexAt(welded->indices, welded->index_type, i)];
+		builder.adjacency[builder.adjacencyOffsets[position]++] = i / 3;
+	}
+	for (int v = vertexNum; v > 0; v--)
+		builder.adjacencyOffsets[v] = builder.adjacencyOffsets[v - 1];
+	builder.adjacencyOffsets[0] = 0;
+
+	for (int t = 0; t < triangleNum; t++)
+	{
+		FaceNormal(welded->vertices + IndexAt(welded->indices, welded->index_type, t * 3) * welded->stride,
+			welded->vertices + IndexAt(welded->indices, welded->index_type, t * 3 + 1) * welded->stride,
+			welded->vertices + IndexAt(welded->indices, welded->index_type, t * 3 + 2) * welded->stride,
+			builder.normals + t * 3);
+	}
+	memset(builder.emitted, 0, triangleNum);
+	for (int v = 0; v < vertexNum; v++)
+		builder.stamps[v] = -1;
+	ret->closed = IsClosed(&builder, welded, triangleNum);
+
+	// the clusters go into a growing array first, their number is only known at the end
+	while (TRUE)
+	{
+		while (seed < triangleNum && builder.emitted[seed])
+			seed++;
+		if (seed == triangleNum)
+			break;
+
+		builder.vertexNum = 0;
+		builder.triangleNum = 0;
+		memset(builder.normalSum, 0, sizeof(builder.normalSum));
+		AddTriangle(&builder, welded, seed);
+
+		while (builder.triangleNum < MESHLET_MAX_TRIANGLES)
+		{
+			int next = NextTriangle(&builder, welded);
+			if (next < 0)
+				break;
+			AddTriangle(&builder, welded, next);
+		}
+
+		if (ret->meshlet_num == capacity)
+		{
+			Meshlet* grown = realloc(meshlets, sizeof(Meshlet) * capacity * 2);
+			if (grown == NULL)
+			{
+				free(meshlets);
+				ArenaFree(&scratch);
+				return FALSE;
+			}
+			meshlets = grown;
+			capacity *= 2;
+		}
+
+		// back into the order of the index buffer, for the post-transform cache
+		qsort(builder.triangles, builder.triangleNum, sizeof(int), CompareInts);
+		meshlets[ret->meshlet_num].index_offset = written;
+		meshlets[ret->meshlet_num].index_num = builder.triangleNum * 3;
+		meshlets[ret->meshlet_num].vertex_num = builder.vertexNum;
+		for (int i = 0; i < builder.triangleNum; i++)
+		{
+			for (int k = 0; k < 3; k++)
+				SetIndex(indices, ret->index_type, written++,
+					IndexAt(welded->indices, welded->index_type, builder.triangles[i] * 3 + k));
+		}
+		ret->meshlet_num++;
+		builder.cluster++;
+	}
+
+	// indices, clusters and visibility flags in one arena
+	if (!ArenaInit(&ret->arena, (size_t)ret->index_num * ret->index_size + (sizeof(Meshlet) + 1) * ret->meshlet_num + 3 * 16))
+	{
+		free(meshlets);
+		ArenaFree(&scratch);
+		return FALSE;
+	}
+	ret->indices = ArenaAlloc(&ret->arena, (size_t)ret->index_num * ret->index_size);
+	ret->meshlets = ArenaAlloc(&ret->arena, sizeof(Meshlet) * ret->meshlet_num);
+	ret->visible = ArenaAlloc(&ret->arena, ret->meshlet_num);
+	memcpy(ret->indices, indices, (size_t)ret->index_num * ret->index_size);
+	memcpy(ret->meshlets, meshlets, sizeof(Meshlet) * ret->meshlet_num);
+	free(meshlets);
+	ArenaFree(&scratch);
+
+	for (int i = 0; i < ret->meshlet_num; i++)
+		MeshletBounds(welded, ret->indices, ret->index_type, &ret->meshlets[i]);
+
+	return TRUE;
+}
+
+void FreeMeshlets(MeshletMesh* meshlets)
+{
+	ArenaFree(&meshlets->arena);
+	memset(meshlets, 0, sizeof(MeshletMesh));
+}
+
+void MeshletViewFromMatrix(const ESMatrix* mvp, const GLfloat* eye, MeshletView* view)
+{
+	// clip = position * mvp, a point is inside when -w <= x, y, z <= w:
+	// the planes are the last column of mvp plus / minus the first three
+	for (int p = 0; p < 6; p++)
+	{
+		int column = p / 2;
+		GLfloat sign = (p & 1) ? -1.0f : 1.0f;
+		GLfloat length;
+
+		for (int k = 0; k < 4; k++)
+			view->planes[p][k] = mvp->m[k][3] + sign * mvp->m[k][column];
+
+		length = sqrtf(view->planes[p][0] * view->planes[p][0] + view->planes[p][1] * view->planes[p][1] +
+			view->planes[p][2] * view->planes[p][2]);
+		if (length > 0.0f)
+		{
+			for (int k = 0; k < 4; k++)
+				view->planes[p][k] /= length;
+		}
+	}
+
+	view->coneCulling = eye != NULL;
+	if (eye != NULL)
+		memcpy(view->eye, eye, sizeof(view->eye));
+}
+
+void MeshletEyeFromModelview(const ESMatrix* modelview, GLfloat* eye)
+{
+	// the camera sits at the origin of view space, back through the transposed rotation
+	for (int i = 0; i < 3; i++)
+	{
+		eye[i] = -(modelview->m[3][0] * modelview->m[i][0] + modelview->m[3][1] * modelview->m[i][1] +
+			modelview->m[3][2] * modelview->m[i][2]);
+	}
+}
+
+static int MeshletVisible(const Meshlet* meshlet, const MeshletView* view, int coneCulling)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const GLfloat* plane = view->planes[p];
+		if (plane[0] * meshlet->center[0] + plane[1] * meshlet->center[1] + plane[2] * meshlet->center[2] + plane[3] < -meshlet->radius)
+			return FALSE;
+	}
+
+	// every face points away from every point of the sphere when the direction to its center is
+	// within 90 degrees minus the cone angle of the axis, with the sphere radius as margin
+	if (coneCulling && meshlet->cone_cutoff < 1.0f)
+	{
+		GLfloat d[3] = { meshlet->center[0] - view->eye[0], meshlet->center[1] - view->eye[1], meshlet->center[2] - view->eye[2] };
+		GLfloat distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+		if (d[0] * meshlet->cone_axis[0] + d[1] * meshlet->cone_axis[1] + d[2] * meshlet->cone_axis[2] >=
+			meshlet->cone_cutoff * distance + meshlet->radius)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+int CullMeshlets(MeshletMesh* meshlets, const MeshletView* view)
+{
+	int triangles = 0;
+	int coneCulling = view->coneCulling && meshlets->closed;
+
+	for (int i = 0; i < meshlets->meshlet_num; i++)
+	{
+		meshlets->visible[i] = (unsigned char)MeshletVisible(&meshlets->meshlets[i], view, coneCulling);
+		if (meshlets->visible[i])
+			triangles += meshlets->meshlets[i].index_num / 3;
+	}
+	return triangles;
+}
+
+int DrawMeshlets(MeshletMesh* meshlets, const MeshletView* view, const void* indices)
+{
+	int triangles = CullMeshlets(meshlets, view);
+	int i = 0;
+
+	while (i < meshlets->meshlet_num)
+	{
+		if (!meshlets->visible[i])
+		{
+			i++;
+			continue;
+		}
+
+		// one draw for the whole run of visible clusters
+		const Meshlet* first = &meshlets->meshlets[i];
+		GLuint vertexMin = first->vertex_min;
+		GLuint vertexMax = first->vertex_max;
+		int indexNum = 0;
+
+		for (; i < meshlets->meshlet_num && meshlets->visible[i]; i++)
+		{
+			const Meshlet* meshlet = &meshlets->meshlets[i];
+			vertexMin = meshlet->vertex_min < vertexMin ? meshlet->vertex_min : vertexMin;
+			vertexMax = meshlet->vertex_max > vertexMax ? meshlet->vertex_max : vertexMax;
+			indexNum += meshlet->index_num;
+		}
+
+		glDrawRangeElements(GL_TRIANGLES, vertexMin, vertexMax, indexNum, meshlets->index_type,
+			(const void*)((size_t)indices + (size_t)first->index_offset * meshlets->index_size));
+	}
+	return triangles;
+}
+
+void PrintMeshletStats(const char* name, const MeshletMesh* meshlets)
+{
+	double vertices = 0.0, triangles = 0.0;
+	int cones = 0;
+
+	for (int i = 0; i < meshlets->meshlet_num; i++)
+	{
+		vertices += meshlets->meshlets[i].vertex_num;
+		triangles += meshlets->meshlets[i].index_num / 3;
+		if (meshlets->meshlets[i].cone_cutoff < 1.0f)
+			cones++;
+	}
+
+	printf("%s: %d clusters of %.1f vertices and %.1f triangles on average, %d (%.1f%%) with a normal cone%s\n",
+		name, meshlets->meshlet_num,
+		meshlets->meshlet_num > 0 ? vertices / meshlets->meshlet_num : 0.0,
+		meshlets->meshlet_num > 0 ? triangles / meshlets->meshlet_num : 0.0,
+		cones, meshlets->meshlet_num > 0 ? 100.0 * cones / meshlets->meshlet_num : 0.0,
+		meshlets->closed ? "" : ", not closed: no cone culling");
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef MYMESHLET_H
+#define MYMESHLET_H
+
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+#include "myMesh.h"
+
+// Clusters of a welded mesh for culling on the CPU, at most MESHLET_MAX_VERTICES vertices and
+// MESHLET_MAX_TRIANGLES triangles each. A cluster starts at the first triangle left in the order of
+// the index buffer and grows over shared vertices, always taking the neighbour that brings in the
+// fewest new vertices and whose normal is closest to the ones already in, so clusters stay compact
+// and their normal cones narrow.
+// The clusters come with their own copy of the index buffer in which every cluster is a contiguous
+// range, its triangles still in the order OptimizeVertexCache gave them, so visible clusters next
+// to each other are drawn with a single glDrawRangeElements. The vertices are not touched.
+#define MESHLET_MAX_VERTICES  64
+#define MESHLET_MAX_TRIANGLES 124
+
+typedef struct
+{
+	int index_offset;          // first index of the cluster in indices
+	int index_num;
+	int vertex_num;            // distinct vertices of the cluster
+	GLuint vertex_min;         // the vertices the indices use, for glDrawRangeElements
+	GLuint vertex_max;
+
+	GLfloat center[3];         // bounding sphere of the positions
+	GLfloat radius;
+
+	// normal cone: every face normal is within some angle of cone_axis and cone_cutoff is the sine
+	// of that angle, 1 when the normals spread over more than 90 degrees and the cone never culls
+	GLfloat cone_axis[3];
+	GLfloat cone_cutoff;
+} Meshlet;
+
+typedef struct
+{
+	int meshlet_num;
+	Meshlet* meshlets;
+
+	int index_num;             // the triangles of the welded mesh, reordered cluster by cluster
+	GLenum index_type;         // same type as the welded mesh
+	int index_size;
+	void* indices;
+
+	unsigned char* visible;    // one flag per cluster, written by CullMeshlets
+	int closed;                // every edge between two triangles wound opposite ways, else the cones never cull
+
+	MeshArena arena;
+} MeshletMesh;
+
+// split the index buffer of welded into clusters, return TRUE on success
+int BuildMeshlets(const IndexedMesh* welded, MeshletMesh* ret);
+
+void FreeMeshlets(MeshletMesh* meshlets);
+
+// what the clusters are tested against, everything in the model space of the mesh
+typedef struct
+{
+	GLfloat planes[6][4];      // frustum, normalized and pointing inside
+	GLfloat eye[3];            // camera position for the normal cones
+	int coneCulling;           // FALSE when back-facing clusters have to be kept (shadow casters)
+} MeshletView;
+
+// the frustum of mvp, the model-view-projection matrix the mesh is drawn with.
+// eye is the camera position in model space, NULL to test the frustum only.
+void MeshletViewFromMatrix(const ESMatrix* mvp, const GLfloat* eye, MeshletView* view);
+
+// camera position in the model space of modelview, which has to be a rotation and translation
+void MeshletEyeFromModelview(const ESMatrix* modelview, GLfloat* eye);
+
+// flag the clusters inside the frustum and not facing away from the eye, return the triangles they hold.
+// The normal cones only cull on a closed mesh: the samples draw with GL_CULL_FACE off, and the back
+// faces of an open or inconsistently wound one show.
+int CullMeshlets(MeshletMesh* meshlets, const MeshletView* view);
+
+// cull, then draw the visible clusters from indices: meshlets->indices as a client array, or NULL
+// for the bound GL_ELEMENT_ARRAY_BUFFER holding a copy of them. Return the triangles submitted.
+int DrawMeshlets(MeshletMesh* meshlets, const MeshletView* view, const void* indices);
+
+// print the cluster count, their average fill and how many normal cones are able to cull
+void PrintMeshletStats(const char* name, const MeshletMesh* meshlets);
+
+#endif
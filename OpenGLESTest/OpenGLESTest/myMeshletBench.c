@@ -0,0 +1,235 @@
+// myMeshletBench.c
+//
+//    Triangles submitted per frame with and without cluster culling (myMeshlet.h), on a camera path
+//    that circles every model of the samples, moving from close up (part of the model off screen)
+//    out to the whole model in view, and around a generated high-poly sphere. Every culled cluster is checked triangle by triangle:
+//    each one has to be outside the frustum or facing away from the camera.
+//    Put this file in the project instead of MyObj3.c (together with myObjLoader.c, myMesh.c,
+//    myMeshOptimizer.c and myMeshlet.c) and run it in the directory of the models.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myMesh.h"
+#include "myMeshOptimizer.h"
+#include "myMeshlet.h"
+#include "myBench.h"
+
+#define PATH_FRAMES 720
+#define PATH_FOV    60.0f
+#define PATH_ASPECT (4.0f / 3.0f)
+
+// a bumpy sphere of SPHERE_RINGS x SPHERE_SEGMENTS quads stands in for a scanned high-poly model
+#define SPHERE_RINGS    256
+#define SPHERE_SEGMENTS 512
+
+static const char* models[] = { "cube.obj", "bear.obj", "ailian.obj", "stone.obj", "sphere" };
+
+// corner i of the cluster index buffer
+static const GLfloat* Position(const IndexedMesh* welded, const MeshletMesh* meshlets, int i)
+{
+	GLuint index = meshlets->index_type == GL_UNSIGNED_SHORT ?
+		((const GLushort*)meshlets->indices)[i] : ((const GLuint*)meshlets->indices)[i];
+	return welded->vertices + index * welded->stride;
+}
+
+// the sphere built straight into an IndexedMesh (positions only), then optimized like a loaded model
+static int BuildSphere(IndexedMesh* welded)
+{
+	int vertexNum = (SPHERE_RINGS + 1) * (SPHERE_SEGMENTS + 1);
+	int indexNum = SPHERE_RINGS * SPHERE_SEGMENTS * 6;
+	GLuint* indices;
+
+	memset(welded, 0, sizeof(IndexedMesh));
+	if (!ArenaInit(&welded->arena, sizeof(GLfloat) * 3 * vertexNum + sizeof(GLuint) * indexNum + 2 * 16))
+		return FALSE;
+	welded->vertices = ArenaAlloc(&welded->arena, sizeof(GLfloat) * 3 * vertexNum);
+	indices = ArenaAlloc(&welded->arena, sizeof(GLuint) * indexNum);
+	welded->vertex_num = vertexNum;
+	welded->index_num = indexNum;
+	welded->stride = 3;
+	welded->texcoord_offset = -1;
+	welded->normal_offset = -1;
+	welded->index_type = GL_UNSIGNED_INT;
+	welded->index_size = sizeof(GLuint);
+	welded->indices = indices;
+
+	for (int r = 0; r <= SPHERE_RINGS; r++)
+	{
+		for (int s = 0; s <= SPHERE_SEGMENTS; s++)
+		{
+			GLfloat theta = 3.14159265f * r / SPHERE_RINGS;
+			GLfloat phi = 2.0f * 3.14159265f * (s % SPHERE_SEGMENTS) / SPHERE_SEGMENTS;
+			GLfloat radius = 1.0f + 0.02f * sinf(theta * 40.0f) * cosf(phi * 40.0f);
+			GLfloat* position = welded->vertices + (r * (SPHERE_SEGMENTS + 1) + s) * 3;
+
+			// the seam repeats the first column and every pole vertex is the same point, bit for bit,
+			// so the sphere is closed for BuildMeshlets and the normal cones cull
+			if (r == 0 || r == SPHERE_RINGS)
+			{
+				position[0] = 0.0f;
+				position[1] = r == 0 ? 1.0f : -1.0f;
+				position[2] = 0.0f;
+				continue;
+			}
+			position[0] = radius * sinf(theta) * cosf(phi);
+			position[1] = radius * cosf(theta);
+			position[2] = -radius * sinf(theta) * sinf(phi);
+		}
+	}
+
+	for (int r = 0; r < SPHERE_RINGS; r++)
+	{
+		for (int s = 0; s < SPHERE_SEGMENTS; s++)
+		{
+			GLuint a = r * (SPHERE_SEGMENTS + 1) + s;
+			GLuint b = a + SPHERE_SEGMENTS + 1;
+			GLuint quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+			memcpy(indices + (r * SPHERE_SEGMENTS + s) * 6, quad, sizeof(quad));
+		}
+	}
+
+	for (int k = 0; k < 3; k++)
+	{
+		welded->bbox_min[k] = -1.02f;
+		welded->bbox_max[k] = 1.02f;
+	}
+	return OptimizeVertexCache(welded) && OptimizeVertexFetch(welded);
+}
+
+static GLfloat PlaneDistance(const GLfloat* plane, const GLfloat* p)
+{
+	return plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3];
+}
+
+// a triangle which might show: inside every plane with at least one corner and not facing away
+static int TriangleMayShow(const GLfloat* a, const GLfloat* b, const GLfloat* c, const MeshletView* view)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		if (PlaneDistance(view->planes[p], a) < 0.0f && PlaneDistance(view->planes[p], b) < 0.0f &&
+			PlaneDistance(view->planes[p], c) < 0.0f)
+			return FALSE;
+	}
+
+	GLfloat ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	GLfloat ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	GLfloat normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+	GLfloat toEye[3] = { view->eye[0] - a[0], view->eye[1] - a[1], view->eye[2] - a[2] };
+
+	return normal[0] * toEye[0] + normal[1] * toEye[1] + normal[2] * toEye[2] > 0.0f;
+}
+
+static void RunPath(const char* name, const IndexedMesh* welded, MeshletMesh* meshlets)
+{
+	GLfloat center[3], size = 0.0f;
+	double frustumOnly = 0.0, withCones = 0.0, cullTime = 0.0;
+	int wrong = 0;
+
+	for (int k = 0; k < 3; k++)
+	{
+		center[k] = (welded->bbox_min[k] + welded->bbox_max[k]) * 0.5f;
+		if (welded->bbox_max[k] - welded->bbox_min[k] > size)
+			size = welded->bbox_max[k] - welded->bbox_min[k];
+	}
+
+	for (int f = 0; f < PATH_FRAMES; f++)
+	{
+		GLfloat angle = 2.0f * 3.14159265f * f / PATH_FRAMES;
+		GLfloat distance = size * (1.25f - 0.75f * cosf(angle * 2.0f)); // 0.5 to 2 model sizes away
+		GLfloat eye[3] = { center[0] + distance * sinf(angle), center[1] + size * 0.4f * sinf(angle * 3.0f),
+			center[2] + distance * cosf(angle) };
+		ESMatrix perspective, view, mvp;
+		MeshletView meshletView;
+
+		esMatrixLoadIdentity(&perspective);
+		esPerspective(&perspective, PATH_FOV, PATH_ASPECT, size * 0.01f, size * 10.0f);
+		esMatrixLookAt(&view, eye[0], eye[1], eye[2], center[0], center[1], center[2], 0.0f, 1.0f, 0.0f);
+		esMatrixMultiply(&mvp, &view, &perspective);
+
+		MeshletViewFromMatrix(&mvp, NULL, &meshletView);
+		frustumOnly += CullMeshlets(meshlets, &meshletView);
+
+		double start = BenchNow();
+		MeshletViewFromMatrix(&mvp, eye, &meshletView);
+		withCones += CullMeshlets(meshlets, &meshletView);
+		cullTime += BenchNow() - start;
+
+		for (int i = 0; i < meshlets->meshlet_num; i++)
+		{
+			const Meshlet* meshlet = &meshlets->meshlets[i];
+			if (meshlets->visible[i])
+				continue;
+			for (int t = meshlet->index_offset; t < meshlet->index_offset + meshlet->index_num; t += 3)
+			{
+				if (TriangleMayShow(Position(welded, meshlets, t), Position(welded, meshlets, t + 1),
+					Position(welded, meshlets, t + 2), &meshletView))
+					wrong++;
+			}
+		}
+	}
+
+	int triangles = welded->index_num / 3;
+	printf("%-10s %8d %10.0f (%5.1f%%) %10.0f (%5.1f%%) %9.2f us %s\n", name, triangles,
+		frustumOnly / PATH_FRAMES, 100.0 * frustumOnly / PATH_FRAMES / triangles,
+		withCones / PATH_FRAMES, 100.0 * withCones / PATH_FRAMES / triangles,
+		cullTime / PATH_FRAMES * 1e6, wrong == 0 ? "" : "VISIBLE TRIANGLES CULLED");
+}
+
+int esMain(ESContext* esContext)
+{
+	MeshletMesh meshlets[sizeof(models) / sizeof(models[0])];
+	IndexedMesh welded[sizeof(models) / sizeof(models[0])];
+	int loaded[sizeof(models) / sizeof(models[0])];
+	int failed = 0;
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	// welded and optimized like LoadCachedMesh does for the samples
+	for (int m = 0; m < (int)(sizeof(models) / sizeof(models[0])); m++)
+	{
+		MeshData mesh;
+
+		loaded[m] = FALSE;
+		if (m == sizeof(models) / sizeof(models[0]) - 1)
+		{
+			loaded[m] = BuildSphere(&welded[m]) && BuildMeshlets(&welded[m], &meshlets[m]);
+			if (loaded[m])
+				PrintMeshletStats(models[m], &meshlets[m]);
+			continue;
+		}
+		if (!LoadObjMesh(models[m], &mesh))
+		{
+			printf("%s cannot be loaded\n", models[m]);
+			failed++;
+			continue;
+		}
+		loaded[m] = WeldMesh(&mesh, MESH_ATTRIB_TEXCOORD, &welded[m]) && OptimizeVertexCache(&welded[m]) &&
+			OptimizeVertexFetch(&welded[m]) && BuildMeshlets(&welded[m], &meshlets[m]);
+		FreeMesh(&mesh);
+		if (!loaded[m])
+		{
+			printf("%s cannot be clustered\n", models[m]);
+			failed++;
+			continue;
+		}
+		PrintMeshletStats(models[m], &meshlets[m]);
+	}
+
+	printf("\ntriangles submitted per frame on a %d frame camera path\n", PATH_FRAMES);
+	printf("%-10s %8s %19s %19s %12s\n", "model", "all", "frustum culled", "frustum + cones", "cull time");
+	for (int m = 0; m < (int)(sizeof(models) / sizeof(models[0])); m++)
+	{
+		if (!loaded[m])
+			continue;
+		RunPath(models[m], &welded[m], &meshlets[m]);
+		FreeMeshlets(&meshlets[m]);
+		FreeIndexedMesh(&welded[m]);
+	}
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,324 @@
+// myMipBench.c
+//
+//    Time to build the mip levels of a texture: the GenMipMap2D loop of Chapter_9/MipMap2D (RGB8,
+//    one malloc per level, float per texel), esBuildMipChain for every format it takes, and with a
+//    window both uploads: level 0 + glGenerateMipmap against esBuildMipChain + esTexImageMipChain.
+//    Every chain is checked against a plain C average of 2x2 pixels (in linear space for sRGB), and
+//    the average of the image has to stay the same on every level (no row or column dropped).
+//    Put this file in the project instead of MyObj3.c.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myBench.h"
+
+#define ITERATIONS 20
+#define SIZE 1024
+
+// GenMipMap2D of Chapter_9/MipMap2D
+static GLboolean GenMipMap2D(GLubyte* src, GLubyte** dst, int srcWidth, int srcHeight, int* dstWidth, int* dstHeight)
+{
+	int texelSize = 3;
+
+	*dstWidth = srcWidth / 2;
+	if (*dstWidth <= 0)
+		*dstWidth = 1;
+	*dstHeight = srcHeight / 2;
+	if (*dstHeight <= 0)
+		*dstHeight = 1;
+
+	*dst = malloc(sizeof(GLubyte) * texelSize * (*dstWidth) * (*dstHeight));
+	if (*dst == NULL)
+		return GL_FALSE;
+
+	for (int y = 0; y < *dstHeight; y++)
+	{
+		for (int x = 0; x < *dstWidth; x++)
+		{
+			int srcIndex[4];
+			float r = 0.0f, g = 0.0f, b = 0.0f;
+
+			srcIndex[0] = (((y * 2) * srcWidth) + (x * 2)) * texelSize;
+			srcIndex[1] = (((y * 2) * srcWidth) + (x * 2 + 1)) * texelSize;
+			srcIndex[2] = ((((y * 2) + 1) * srcWidth) + (x * 2)) * texelSize;
+			srcIndex[3] = ((((y * 2) + 1) * srcWidth) + (x * 2 + 1)) * texelSize;
+			for (int sample = 0; sample < 4; sample++)
+			{
+				r += src[srcIndex[sample]];
+				g += src[srcIndex[sample] + 1];
+				b += src[srcIndex[sample] + 2];
+			}
+			r /= 4.0;
+			g /= 4.0;
+			b /= 4.0;
+
+			(*dst)[(y * (*dstWidth) + x) * texelSize] = (GLubyte)(r);
+			(*dst)[(y * (*dstWidth) + x) * texelSize + 1] = (GLubyte)(g);
+			(*dst)[(y * (*dstWidth) + x) * texelSize + 2] = (GLubyte)(b);
+		}
+	}
+	return GL_TRUE;
+}
+
+// the whole chain the way CreateMipMappedTexture2D built it, without the uploads
+static void GenMipMapChain(const GLubyte* pixels, int width, int height)
+{
+	GLubyte* prevImage = malloc((size_t)width * height * 3);
+	GLubyte* newImage = NULL;
+
+	memcpy(prevImage, pixels, (size_t)width * height * 3);
+	while (width > 1 && height > 1)
+	{
+		int newWidth, newHeight;
+
+		GenMipMap2D(prevImage, &newImage, width, height, &newWidth, &newHeight);
+		free(prevImage);
+		prevImage = newImage;
+		width = newWidth;
+		height = newHeight;
+	}
+	free(prevImage);
+}
+
+// smooth gradients with a little noise, bytes of channels 8-bit channels or floats in [0, 1]
+static void* MakeImage(int width, int height, int channels, GLenum type)
+{
+	size_t count = (size_t)width * height * channels;
+	void* pixels = malloc(count * (type == GL_FLOAT ? sizeof(GLfloat) : 1));
+	unsigned int seed = 12345;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t pixel = i / channels;
+		int x = (int)(pixel % width);
+		int y = (int)(pixel / width);
+		int value;
+
+		seed = seed * 1664525u + 1013904223u;
+		value = (x * 255 / width + y * 255 / height + (int)(i % channels) * 60 + (int)(seed >> 28)) & 255;
+		if (type == GL_FLOAT)
+			((GLfloat*)pixels)[i] = value / 255.0f;
+		else
+			((GLubyte*)pixels)[i] = (GLubyte)value;
+	}
+	return pixels;
+}
+
+static double SrgbToLinear(double value)
+{
+	return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+}
+
+static double LinearToSrgb(double value)
+{
+	return value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+}
+
+// largest difference of the levels of a chain with even sizes from a plain C 2x2 average,
+// of the colors in linear space for an sRGB chain
+static double CheckAverages(const ESMipChain* chain)
+{
+	int channels = chain->pixelSize / (chain->type == GL_FLOAT ? (int)sizeof(GLfloat) : 1);
+	int colorChannels = !chain->srgb ? 0 : channels == 2 || channels == 4 ? channels - 1 : channels;
+	double worst = 0.0;
+
+	for (int level = 1; level < chain->levelCount; level++)
+	{
+		int srcWidth = chain->width[level - 1];
+
+		if (srcWidth % 2 != 0 || chain->height[level - 1] % 2 != 0)
+			break;
+		for (int y = 0; y < chain->height[level]; y++)
+		{
+			for (int x = 0; x < chain->width[level] * channels; x++)
+			{
+				int c = x % channels;
+				size_t s0 = ((size_t)2 * y * srcWidth + 2 * (x / channels)) * channels + c;
+				size_t s1 = s0 + (size_t)srcWidth * channels;
+				size_t d = (size_t)y * chain->width[level] * channels + x;
+				double expected, actual;
+
+				if (chain->type == GL_FLOAT)
+				{
+					const GLfloat* src = (const GLfloat*)(chain->pixels + chain->offset[level - 1]);
+					expected = (src[s0] + src[s0 + channels] + src[s1] + src[s1 + channels]) * 0.25;
+					actual = ((const GLfloat*)(chain->pixels + chain->offset[level]))[d];
+				}
+				else
+				{
+					const GLubyte* src = chain->pixels + chain->offset[level - 1];
+					if (c < colorChannels)
+						expected = floor(LinearToSrgb((SrgbToLinear(src[s0] / 255.0) + SrgbToLinear(src[s0 + channels] / 255.0) +
+							SrgbToLinear(src[s1] / 255.0) + SrgbToLinear(src[s1 + channels] / 255.0)) * 0.25) * 255.0 + 0.5);
+					else
+						expected = (src[s0] + src[s0 + channels] + src[s1] + src[s1 + channels] + 2) >> 2;
+					actual = chain->pixels[chain->offset[level] + d];
+				}
+				if (fabs(expected - actual) > worst)
+					worst = fabs(expected - actual);
+			}
+		}
+	}
+	return worst;
+}
+
+// largest difference of the average of a level from the average of level 0, in 8-bit steps.
+// A box filter keeps it, up to the rounding of 8-bit values.
+static double CheckMeans(const ESMipChain* chain)
+{
+	int valueSize = chain->type == GL_FLOAT ? (int)sizeof(GLfloat) : 1;
+	double mean0 = 0.0, worst = 0.0;
+
+	for (int level = 0; level < chain->levelCount; level++)
+	{
+		size_t count = (size_t)chain->width[level] * chain->height[level] * chain->pixelSize / valueSize;
+		double sum = 0.0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (chain->type == GL_FLOAT)
+				sum += ((const GLfloat*)(chain->pixels + chain->offset[level]))[i] * 255.0;
+			else
+				sum += chain->pixels[chain->offset[level] + i];
+		}
+		if (level == 0)
+			mean0 = sum / count;
+		else if (fabs(sum / count - mean0) > worst)
+			worst = fabs(sum / count - mean0);
+	}
+	return worst;
+}
+
+// average milliseconds of building one chain
+static double TimeChain(const void* pixels, int width, int height, GLenum format, GLenum type, GLboolean srgb)
+{
+	double start = BenchNow();
+
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		ESMipChain chain;
+
+		esBuildMipChain(&chain, pixels, width, height, format, type, srgb);
+		esFreeMipChain(&chain);
+	}
+	return (BenchNow() - start) / ITERATIONS * 1000.0;
+}
+
+// average milliseconds of having a complete mipmapped texture, until the GL is done
+static double TimeUpload(const void* pixels, int width, int height, GLenum format, int generate)
+{
+	double start = BenchNow();
+
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		GLuint texId;
+
+		glGenTextures(1, &texId);
+		glBindTexture(GL_TEXTURE_2D, texId);
+		if (generate)
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		else
+		{
+			ESMipChain chain;
+
+			esBuildMipChain(&chain, pixels, width, height, format, GL_UNSIGNED_BYTE, GL_FALSE);
+			esTexImageMipChain(GL_TEXTURE_2D, &chain);
+			esFreeMipChain(&chain);
+		}
+		glFinish();
+		glDeleteTextures(1, &texId);
+	}
+	return (BenchNow() - start) / ITERATIONS * 1000.0;
+}
+
+int esMain(ESContext* esContext)
+{
+	static const struct
+	{
+		const char* name;
+		GLenum format;
+		int channels;
+		GLenum type;
+		GLboolean srgb;
+		int width, height;
+	} cases[] =
+	{
+		{ "RGB8", GL_RGB, 3, GL_UNSIGNED_BYTE, GL_FALSE, SIZE, SIZE },
+		{ "RGBA8", GL_RGBA, 4, GL_UNSIGNED_BYTE, GL_FALSE, SIZE, SIZE },
+		{ "L8", GL_LUMINANCE, 1, GL_UNSIGNED_BYTE, GL_FALSE, SIZE, SIZE },
+		{ "LA8", GL_LUMINANCE_ALPHA, 2, GL_UNSIGNED_BYTE, GL_FALSE, SIZE, SIZE },
+		{ "SRGB8_ALPHA8", GL_RGBA, 4, GL_UNSIGNED_BYTE, GL_TRUE, SIZE, SIZE },
+		{ "RGBA float", GL_RGBA, 4, GL_FLOAT, GL_FALSE, SIZE, SIZE },
+		{ "L float", GL_LUMINANCE, 1, GL_FLOAT, GL_FALSE, SIZE, SIZE },
+		{ "RGB8 1000x600", GL_RGB, 3, GL_UNSIGNED_BYTE, GL_FALSE, 1000, 600 },
+		{ "RGBA8 999x333", GL_RGBA, 4, GL_UNSIGNED_BYTE, GL_FALSE, 999, 333 },
+		{ "RGBA float 999x333", GL_RGBA, 4, GL_FLOAT, GL_FALSE, 999, 333 },
+		{ "L float 1x777", GL_LUMINANCE, 1, GL_FLOAT, GL_FALSE, 1, 777 },
+	};
+	int window = esCreateWindow(esContext, "myMipBench", 64, 64, ES_WINDOW_RGB);
+	int failed = 0;
+
+	printf("milliseconds to build every level, average of %d runs\n", ITERATIONS);
+	{
+		GLubyte* pixels = MakeImage(SIZE, SIZE, 3, GL_UNSIGNED_BYTE);
+		double start = BenchNow();
+
+		for (int i = 0; i < ITERATIONS; i++)
+			GenMipMapChain(pixels, SIZE, SIZE);
+		printf("%-20s %-16s %10.2f\n", "RGB8", "GenMipMap2D", (BenchNow() - start) / ITERATIONS * 1000.0);
+		free(pixels);
+	}
+
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+	{
+		void* pixels = MakeImage(cases[c].width, cases[c].height, cases[c].channels, cases[c].type);
+		ESMipChain chain;
+		double averages, means;
+
+		if (!esBuildMipChain(&chain, pixels, cases[c].width, cases[c].height, cases[c].format, cases[c].type,
+			cases[c].srgb))
+		{
+			printf("%-20s cannot be built\n", cases[c].name);
+			failed++;
+			free(pixels);
+			continue;
+		}
+
+		averages = CheckAverages(&chain);
+		means = cases[c].srgb ? 0.0 : CheckMeans(&chain);
+		printf("%-20s %-16s %10.2f   %2d levels, off the C average by %g, level means off by %.4f\n",
+			cases[c].name, "esBuildMipChain", TimeChain(pixels, cases[c].width, cases[c].height, cases[c].format,
+			cases[c].type, cases[c].srgb), chain.levelCount, averages, means);
+		// an 8-bit level can be off by half a step from the one above, rounding up half the time
+		// sRGB can round the other way on a tie within float precision
+		if (averages > (cases[c].type == GL_FLOAT ? 1e-6 : cases[c].srgb ? 1.0 : 0.0) ||
+			means > (cases[c].type == GL_FLOAT ? 1e-3 : chain.levelCount / 2.0))
+			failed++;
+
+		esFreeMipChain(&chain);
+		free(pixels);
+	}
+
+	if (window)
+	{
+		GLubyte* pixels = MakeImage(SIZE, SIZE, 4, GL_UNSIGNED_BYTE);
+
+		// once each for the shaders and allocations of the driver
+		TimeUpload(pixels, SIZE, SIZE, GL_RGBA, TRUE);
+		TimeUpload(pixels, SIZE, SIZE, GL_RGBA, FALSE);
+
+		printf("\nmilliseconds to a complete %dx%d RGBA8 texture, until glFinish returns\n", SIZE, SIZE);
+		printf("%-40s %10.2f\n", "glTexImage2D + glGenerateMipmap", TimeUpload(pixels, SIZE, SIZE, GL_RGBA, TRUE));
+		printf("%-40s %10.2f\n", "esBuildMipChain + esTexImageMipChain", TimeUpload(pixels, SIZE, SIZE, GL_RGBA, FALSE));
+		free(pixels);
+	}
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,329 @@
+// myNoiseVolumeBench.c
+//
+//    Time to build the 3D noise textures of Chapter_14: the noise3D loop of Create3DNoiseTexture
+//    (one evaluation per voxel, a float buffer, then a second pass normalizing into bytes) against
+//    esBuildNoiseVolume on the calling thread and on a pool of one thread per processor.  Both use
+//    the same lattice, and every volume has to come out byte for byte the same.
+//    With a window the whole upload is timed as well, until glFinish returns, and the fractal
+//    volumes of the samples built every time against mapped from the noise cache in the current
+//    directory.
+//    Put this file in the project instead of MyObj3.c.
+//
+#define _USE_MATH_DEFINES
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myBench.h"
+
+#define MIN_SECONDS 0.5
+
+#ifdef _WIN32
+#define srandom srand
+#define random rand
+#endif
+
+// the noise of Chapter_14/Noise3D as it was
+#define NOISE_TABLE_MASK   255
+
+#define FLOOR(x)           ((int)(x) - ((x) < 0 && (x) != (int)(x)))
+#define smoothstep(t)      ( t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f ) )
+#define lerp(t, a, b)      ( a + t * (b - a) )
+
+static float gradientTable[256 * 3];
+
+static unsigned char permTable[256] =
+{
+	0xE1, 0x9B, 0xD2, 0x6C, 0xAF, 0xC7, 0xDD, 0x90, 0xCB, 0x74, 0x46, 0xD5, 0x45, 0x9E, 0x21, 0xFC,
+	0x05, 0x52, 0xAD, 0x85, 0xDE, 0x8B, 0xAE, 0x1B, 0x09, 0x47, 0x5A, 0xF6, 0x4B, 0x82, 0x5B, 0xBF,
+	0xA9, 0x8A, 0x02, 0x97, 0xC2, 0xEB, 0x51, 0x07, 0x19, 0x71, 0xE4, 0x9F, 0xCD, 0xFD, 0x86, 0x8E,
+	0xF8, 0x41, 0xE0, 0xD9, 0x16, 0x79, 0xE5, 0x3F, 0x59, 0x67, 0x60, 0x68, 0x9C, 0x11, 0xC9, 0x81,
+	0x24, 0x08, 0xA5, 0x6E, 0xED, 0x75, 0xE7, 0x38, 0x84, 0xD3, 0x98, 0x14, 0xB5, 0x6F, 0xEF, 0xDA,
+	0xAA, 0xA3, 0x33, 0xAC, 0x9D, 0x2F, 0x50, 0xD4, 0xB0, 0xFA, 0x57, 0x31, 0x63, 0xF2, 0x88, 0xBD,
+	0xA2, 0x73, 0x2C, 0x2B, 0x7C, 0x5E, 0x96, 0x10, 0x8D, 0xF7, 0x20, 0x0A, 0xC6, 0xDF, 0xFF, 0x48,
+	0x35, 0x83, 0x54, 0x39, 0xDC, 0xC5, 0x3A, 0x32, 0xD0, 0x0B, 0xF1, 0x1C, 0x03, 0xC0, 0x3E, 0xCA,
+	0x12, 0xD7, 0x99, 0x18, 0x4C, 0x29, 0x0F, 0xB3, 0x27, 0x2E, 0x37, 0x06, 0x80, 0xA7, 0x17, 0xBC,
+	0x6A, 0x22, 0xBB, 0x8C, 0xA4, 0x49, 0x70, 0xB6, 0xF4, 0xC3, 0xE3, 0x0D, 0x23, 0x4D, 0xC4, 0xB9,
+	0x1A, 0xC8, 0xE2, 0x77, 0x1F, 0x7B, 0xA8, 0x7D, 0xF9, 0x44, 0xB7, 0xE6, 0xB1, 0x87, 0xA0, 0xB4,
+	0x0C, 0x01, 0xF3, 0x94, 0x66, 0xA6, 0x26, 0xEE, 0xFB, 0x25, 0xF0, 0x7E, 0x40, 0x4A, 0xA1, 0x28,
+	0xB8, 0x95, 0xAB, 0xB2, 0x65, 0x42, 0x1D, 0x3B, 0x92, 0x3D, 0xFE, 0x6B, 0x2A, 0x56, 0x9A, 0x04,
+	0xEC, 0xE8, 0x78, 0x15, 0xE9, 0xD1, 0x2D, 0x62, 0xC1, 0x72, 0x4E, 0x13, 0xCE, 0x0E, 0x76, 0x7F,
+	0x30, 0x4F, 0x93, 0x55, 0x1E, 0xCF, 0xDB, 0x36, 0x58, 0xEA, 0xBE, 0x7A, 0x5F, 0x43, 0x8F, 0x6D,
+	0x89, 0xD6, 0x91, 0x5D, 0x5C, 0x64, 0xF5, 0x00, 0xD8, 0xBA, 0x3C, 0x53, 0x69, 0x61, 0xCC, 0x34,
+};
+
+static void initNoiseTable(void)
+{
+	float gradients[256 * 3];
+
+	srandom(0);
+	for (int i = 0; i < 256; i++)
+	{
+		float a = (random() % 32768) / 32768.0f;
+		float z = (1.0f - 2.0f * a);
+		float r = sqrtf(1.0f - z * z);
+
+		a = (random() % 32768) / 32768.0f;
+		gradients[i * 3] = r * cosf(a);
+		gradients[i * 3 + 1] = r * sinf(a);
+		gradients[i * 3 + 2] = z;
+	}
+	for (int i = 0; i < 256; i++)
+		memcpy(&gradientTable[i * 3], &gradients[permTable[i] * 3], 3 * sizeof(float));
+}
+
+static float glattice3D(int ix, int iy, int iz, float fx, float fy, float fz)
+{
+	float* g;
+	int indx, y, z;
+
+	z = permTable[iz & NOISE_TABLE_MASK];
+	y = permTable[(iy + z) & NOISE_TABLE_MASK];
+	indx = (ix + y) & NOISE_TABLE_MASK;
+	g = &gradientTable[indx * 3];
+	return (g[0] * fx + g[1] * fy + g[2] * fz);
+}
+
+static float noise3D(float* f)
+{
+	int ix, iy, iz;
+	float fx0, fx1, fy0, fy1, fz0, fz1;
+	float wx, wy, wz;
+	float vx0, vx1, vy0, vy1, vz0, vz1;
+
+	ix = FLOOR(f[0]);
+	fx0 = f[0] - ix;
+	fx1 = fx0 - 1;
+	wx = smoothstep(fx0);
+	iy = FLOOR(f[1]);
+	fy0 = f[1] - iy;
+	fy1 = fy0 - 1;
+	wy = smoothstep(fy0);
+	iz = FLOOR(f[2]);
+	fz0 = f[2] - iz;
+	fz1 = fz0 - 1;
+	wz = smoothstep(fz0);
+
+	vx0 = glattice3D(ix, iy, iz, fx0, fy0, fz0);
+	vx1 = glattice3D(ix + 1, iy, iz, fx1, fy0, fz0);
+	vy0 = lerp(wx, vx0, vx1);
+	vx0 = glattice3D(ix, iy + 1, iz, fx0, fy1, fz0);
+	vx1 = glattice3D(ix + 1, iy + 1, iz, fx1, fy1, fz0);
+	vy1 = lerp(wx, vx0, vx1);
+	vz0 = lerp(wy, vy0, vy1);
+
+	vx0 = glattice3D(ix, iy, iz + 1, fx0, fy0, fz1);
+	vx1 = glattice3D(ix + 1, iy, iz + 1, fx1, fy0, fz1);
+	vy0 = lerp(wx, vx0, vx1);
+	vx0 = glattice3D(ix, iy + 1, iz + 1, fx0, fy1, fz1);
+	vx1 = glattice3D(ix + 1, iy + 1, iz + 1, fx1, fy1, fz1);
+	vy1 = lerp(wx, vx0, vx1);
+	vz1 = lerp(wy, vy0, vy1);
+	return lerp(wz, vz0, vz1);
+}
+
+// the texels of Create3DNoiseTexture, without the upload
+static GLubyte* OldNoiseVolume(int textureSize, float frequency)
+{
+	GLfloat* texBuf = malloc(sizeof(GLfloat) * textureSize * textureSize * textureSize);
+	GLubyte* texBufUbyte = malloc(sizeof(GLubyte) * textureSize * textureSize * textureSize);
+	int index = 0;
+	float min = 1000, max = -1000, range;
+
+	initNoiseTable();
+	for (int z = 0; z < textureSize; z++)
+		for (int y = 0; y < textureSize; y++)
+			for (int x = 0; x < textureSize; x++)
+			{
+				float pos[3] = { (float)x / (float)textureSize, (float)y / (float)textureSize, (float)z / (float)textureSize };
+				float noiseVal;
+
+				pos[0] *= frequency;
+				pos[1] *= frequency;
+				pos[2] *= frequency;
+				noiseVal = noise3D(pos);
+				if (noiseVal < min)
+					min = noiseVal;
+				if (noiseVal > max)
+					max = noiseVal;
+				texBuf[index++] = noiseVal;
+			}
+
+	range = (max - min);
+	for (index = 0; index < textureSize * textureSize * textureSize; index++)
+		texBufUbyte[index] = (GLubyte)(((texBuf[index] - min) / range) * 255.0f);
+	free(texBuf);
+	return texBufUbyte;
+}
+
+// the lattice above in the layout of esBuildNoiseVolume
+static void MakeLattice(ESNoiseLattice* lattice)
+{
+	initNoiseTable();
+	memcpy(lattice->permutation, permTable, sizeof(permTable));
+	memcpy(lattice->gradients, gradientTable, sizeof(gradientTable));
+}
+
+// average milliseconds of building one volume, repeated for at least MIN_SECONDS
+static double TimeOld(int size, float frequency)
+{
+	double start = BenchNow(), seconds;
+	int runs = 0;
+
+	do
+	{
+		free(OldNoiseVolume(size, frequency));
+		runs++;
+		seconds = BenchNow() - start;
+	} while (seconds < MIN_SECONDS);
+	return seconds / runs * 1000.0;
+}
+
+static double TimeNew(ESThreadPool* pool, const ESNoiseLattice* lattice, int size, float frequency, GLubyte* texels)
+{
+	double start = BenchNow(), seconds;
+	int runs = 0;
+
+	do
+	{
+		esBuildNoiseVolume(pool, lattice, size, frequency, texels);
+		runs++;
+		seconds = BenchNow() - start;
+	} while (seconds < MIN_SECONDS);
+	return seconds / runs * 1000.0;
+}
+
+// milliseconds to a complete GL_R8 3D texture until glFinish returns
+static double TimeUpload(ESThreadPool* pool, const ESNoiseLattice* lattice, int size, float frequency, int old)
+{
+	const int iterations = 5;
+	double start = BenchNow();
+
+	for (int i = 0; i < iterations; i++)
+	{
+		GLuint texId;
+
+		glGenTextures(1, &texId);
+		glBindTexture(GL_TEXTURE_3D, texId);
+		if (old)
+		{
+			GLubyte* texels = OldNoiseVolume(size, frequency);
+
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, size, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, texels);
+			free(texels);
+		}
+		else
+			esTexImageNoiseVolume(pool, lattice, size, frequency);
+		glFinish();
+		glDeleteTextures(1, &texId);
+	}
+	return (BenchNow() - start) / iterations * 1000.0;
+}
+
+// milliseconds to a complete fractal volume until glFinish returns, cacheDir as for esTexImageFbmVolume
+static double TimeFbmUpload(ESThreadPool* pool, const ESNoiseLattice* lattice, const ESNoiseVolume* volume,
+	const char* cacheDir)
+{
+	const int iterations = 5;
+	double start = BenchNow();
+
+	for (int i = 0; i < iterations; i++)
+	{
+		GLuint texId;
+
+		glGenTextures(1, &texId);
+		glBindTexture(GL_TEXTURE_3D, texId);
+		esTexImageFbmVolume(pool, lattice, volume, cacheDir);
+		glFinish();
+		glDeleteTextures(1, &texId);
+	}
+	return (BenchNow() - start) / iterations * 1000.0;
+}
+
+int esMain(ESContext* esContext)
+{
+	static const struct
+	{
+		const char* name;
+		int size;
+		float frequency;
+	} cases[] =
+	{
+		{ "Noise3D", 64, 5.0f },
+		{ "ParticleSystemTF", 128, 50.0f },
+		{ "Noise3D 256^3", 256, 5.0f },
+		{ "odd size", 77, 3.3f },
+	};
+	// the fog of Noise3D and the random values of ParticleSystemTransformFeedback
+	static const ESNoiseVolume volumes[] =
+	{
+		{ 64, 4.0f, 4, 2.0f, 0.5f, GL_TRUE },
+		{ 128, 50.0f, 2, 2.0f, 0.5f, GL_TRUE },
+	};
+	int window = esCreateWindow(esContext, "myNoiseVolumeBench", 64, 64, ES_WINDOW_RGB);
+	ESThreadPool* pool = esCreateThreadPool(0);
+	ESNoiseLattice lattice;
+	int failed = 0;
+
+	MakeLattice(&lattice);
+	printf("milliseconds to build a GL_R8 noise volume, %d threads in the pool\n", esGetThreadCount(pool));
+	printf("%-18s %6s %10s %10s %10s %8s   %s\n", "", "size", "noise3D", "1 thread", "pool", "speedup", "texels");
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+	{
+		int size = cases[c].size;
+		size_t count = (size_t)size * size * size;
+		GLubyte* expected = OldNoiseVolume(size, cases[c].frequency);
+		GLubyte* texels = malloc(count);
+		double old, single, parallel;
+		size_t differ = 0;
+
+		esBuildNoiseVolume(pool, &lattice, size, cases[c].frequency, texels);
+		for (size_t i = 0; i < count; i++)
+			differ += expected[i] != texels[i];
+
+		old = TimeOld(size, cases[c].frequency);
+		single = TimeNew(NULL, &lattice, size, cases[c].frequency, texels);
+		parallel = TimeNew(pool, &lattice, size, cases[c].frequency, texels);
+		if (differ == 0)
+			printf("%-18s %6d %10.2f %10.2f %10.2f %7.1fx   identical\n", cases[c].name, size, old, single, parallel,
+				old / parallel);
+		else
+		{
+			printf("%-18s %6d %10.2f %10.2f %10.2f %7.1fx   %zu DIFFERENT\n", cases[c].name, size, old, single,
+				parallel, old / parallel, differ);
+			failed++;
+		}
+		free(expected);
+		free(texels);
+	}
+
+	if (window)
+	{
+		// once each for the allocations of the driver
+		TimeUpload(pool, &lattice, 64, 5.0f, TRUE);
+		TimeUpload(pool, &lattice, 64, 5.0f, FALSE);
+
+		printf("\nmilliseconds to a complete 64^3 GL_R8 texture, until glFinish returns\n");
+		printf("%-40s %10.2f\n", "Create3DNoiseTexture before", TimeUpload(pool, &lattice, 64, 5.0f, TRUE));
+		printf("%-40s %10.2f\n", "esTexImageNoiseVolume", TimeUpload(pool, &lattice, 64, 5.0f, FALSE));
+
+		printf("\nmilliseconds to a complete fractal volume, built against mapped from the cache\n");
+		printf("%-18s %6s %8s %10s %10s\n", "", "size", "octaves", "built", "cached");
+		for (int v = 0; v < (int)(sizeof(volumes) / sizeof(volumes[0])); v++)
+		{
+			double built = TimeFbmUpload(pool, &lattice, &volumes[v], NULL);
+
+			// the first one writes the file
+			TimeFbmUpload(pool, &lattice, &volumes[v], ".");
+			printf("%-18s %6d %8d %10.2f %10.2f\n", cases[v].name, volumes[v].size, volumes[v].octaves, built,
+				TimeFbmUpload(pool, &lattice, &volumes[v], "."));
+		}
+	}
+
+	esDestroyThreadPool(pool);
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,615 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "myObjLoader.h"
+
+// initial capacity of every array, they double whenever they are full
+#define OBJ_INITIAL_CAPACITY 1024
+
+// size of the pieces a file is cut into for ParseObjTextParallel, a smaller file is parsed in one piece
+#define OBJ_CHUNK_SIZE (1 << 20)
+
+// exact powers of ten in double precision, larger exponents go through repeated multiplication
+static const double powersOf10[] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// corners of a chunk which hold a relative (negative) index. The chunk resolves them against its own
+// element counts, they are moved by the number of elements in front of the chunk once that is known.
+typedef struct
+{
+	int* corners; // corner * 3 + stream, stream 0 for v, 1 for vt, 2 for vn
+	int num;
+	int cap;
+
+	// elements of each stream an index of the chunk needs in front of it and the line of that index,
+	// checked once the counts of the chunks in front are known
+	int need[3];
+	int needLine[3];
+	int lines;
+} ObjRelative;
+
+typedef struct
+{
+	int vCap;
+	int vtCap;
+	int vnCap;
+	int fCap;
+	int fvCap;
+	int ftCap;
+	int fnCap;
+	int* alloc_count;
+	ObjRelative* relative; // NULL when the whole file is parsed at once
+	int line; // 1-based, of the line being parsed
+} ObjCapacity;
+
+// make sure *arr can hold needed elements, doubling the capacity when it can't
+static int Reserve(ObjCapacity* cap, void** arr, int* capacity, int needed, size_t elemSize)
+{
+	void* grown;
+	int newCapacity = *capacity;
+
+	if (needed <= *capacity)
+		return TRUE;
+
+	if (newCapacity < OBJ_INITIAL_CAPACITY)
+		newCapacity = OBJ_INITIAL_CAPACITY;
+	while (newCapacity < needed)
+		newCapacity *= 2;
+
+	grown = realloc(*arr, elemSize * newCapacity);
+	if (grown == NULL)
+		return FALSE;
+	(*cap->alloc_count)++;
+
+	*arr = grown;
+	*capacity = newCapacity;
+	return TRUE;
+}
+
+static const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+// hand-written replacement of atof, never allocates and stops at the first character
+// which can't be part of the number. The result is the same as atof for the numbers
+// found in obj files (up to 19 significant digits, exponent within +-22).
+static const char* ScanFloat(const char* p, const char* end, GLfloat* ret)
+{
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	int negative = 0;
+	double value;
+
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0)
+				digits++;
+		}
+		else
+		{
+			exponent++;
+		}
+	}
+
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0)
+					digits++;
+				exponent--;
+			}
+		}
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		int expNegative = 0;
+		int expValue = 0;
+
+		p++;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			expNegative = (*p == '-');
+			p++;
+		}
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			if (expValue < 10000)
+				expValue = expValue * 10 + (*p - '0');
+		}
+		exponent += expNegative ? -expValue : expValue;
+	}
+
+	value = (double)mantissa;
+	if (exponent < 0)
+	{
+		for (; exponent < -22; exponent += 22)
+			value /= powersOf10[22];
+		value /= powersOf10[-exponent];
+	}
+	else
+	{
+		for (; exponent > 22; exponent -= 22)
+			value *= powersOf10[22];
+		value *= powersOf10[exponent];
+	}
+
+	*ret = (GLfloat)(negative ? -value : value);
+	return p;
+}
+
+// hand-written replacement of atoi
+static const char* ScanInt(const char* p, const char* end, int* ret)
+{
+	int value = 0;
+	int negative = 0;
+
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+	// saturate instead of overflowing, a number this large is out of range anyway
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		value = value < 100000000 ? value * 10 + (*p - '0') : 1000000000;
+
+	*ret = negative ? -value : value;
+	return p;
+}
+
+void ScanObjFloats(const char* p, const char* end, GLfloat* ret, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		p = SkipSpaces(p, end);
+		if (p < end)
+			p = ScanFloat(p, end, &ret[i]);
+		else
+			ret[i] = 0.0f;
+	}
+}
+
+const char* ScanObjCorner(const char* p, const char* end, int* v, int* vt, int* vn)
+{
+	*vt = 0;
+	*vn = 0;
+
+	p = SkipSpaces(p, end);
+	if (p >= end || !((*p >= '0' && *p <= '9') || *p == '-' || *p == '+'))
+		return NULL;
+
+	p = ScanInt(p, end, v);
+	if (p < end && *p == '/')
+	{
+		p++;
+		if (p < end && *p != '/')
+			p = ScanInt(p, end, vt);
+		if (p < end && *p == '/')
+			p = ScanInt(p + 1, end, vn);
+	}
+	// skip anything unexpected so a broken corner can't stall the loop
+	while (p < end && *p != ' ' && *p != '\t')
+		p++;
+	return p;
+}
+
+static const char* streamNames[] = { "v", "vt", "vn" };
+
+// 0-based index of a corner into a stream of count elements so far, -1 when the corner has none.
+// 1 is the first element of the file, -1 the last one read before the face.
+// An index past the elements read so far is rejected, in a chunk it is up to the elements in front of it.
+static int ResolveIndex(ObjCapacity* cap, int index, int count, int corner, int stream, int* ret)
+{
+	ObjRelative* relative = cap->relative;
+	int need;
+
+	if (index == 0)
+	{
+		*ret = -1;
+		return TRUE;
+	}
+
+	// elements in front of the ones read so far which the index needs to be valid
+	need = index > 0 ? index - count : -(count + index);
+	if (relative == NULL && need > 0)
+	{
+		printf("line %d: %s index %d out of range\n", cap->line, streamNames[stream], index);
+		return FALSE;
+	}
+	if (relative != NULL && need > relative->need[stream])
+	{
+		relative->need[stream] = need;
+		relative->needLine[stream] = cap->line;
+	}
+
+	if (index > 0)
+	{
+		*ret = index - 1;
+		return TRUE;
+	}
+
+	*ret = count + index;
+	if (relative != NULL)
+	{
+		if (!Reserve(cap, (void**)&relative->corners, &relative->cap, relative->num + 1, sizeof(int)))
+			return FALSE;
+		relative->corners[relative->num++] = corner * 3 + stream;
+	}
+	return TRUE;
+}
+
+// read the corners of an f line, any number of them
+// ["3/13/5", "4/14/6", "5/15/7" or "1/3" or "160//12" or "-4/-4/-1"]
+static int ScanFace(const char* p, const char* end, ObjFile* obj, ObjCapacity* cap)
+{
+	int count = 0;
+
+	for (;;)
+	{
+		int v, vt, vn;
+		int corner = obj->corner_num;
+
+		p = ScanObjCorner(p, end, &v, &vt, &vn);
+		if (p == NULL)
+			break;
+
+		if (!Reserve(cap, (void**)&obj->fvArr, &cap->fvCap, corner + 1, sizeof(int)) ||
+			!Reserve(cap, (void**)&obj->ftArr, &cap->ftCap, corner + 1, sizeof(int)) ||
+			!Reserve(cap, (void**)&obj->fnArr, &cap->fnCap, corner + 1, sizeof(int)))
+			return FALSE;
+
+		if (!ResolveIndex(cap, v, obj->v_num, corner, 0, &obj->fvArr[corner]) ||
+			!ResolveIndex(cap, vt, obj->vt_num, corner, 1, &obj->ftArr[corner]) ||
+			!ResolveIndex(cap, vn, obj->vn_num, corner, 2, &obj->fnArr[corner]))
+			return FALSE;
+		obj->corner_num++;
+		count++;
+	}
+
+	if (count == 0)
+		return TRUE;
+
+	if (!Reserve(cap, (void**)&obj->face_counts, &cap->fCap, obj->f_num + 1, sizeof(int)))
+		return FALSE;
+	obj->face_counts[obj->f_num] = count;
+	obj->f_num++;
+
+	return TRUE;
+}
+
+// ParseObjText, relative indices of a chunk are listed in relative when it is not NULL
+static int ParseObjRange(const char* text, size_t length, ObjFile* obj, ObjRelative* relative)
+{
+	const char* p = text;
+	const char* end = text + length;
+	ObjCapacity cap;
+
+	memset(obj, 0, sizeof(ObjFile));
+	memset(&cap, 0, sizeof(ObjCapacity));
+	cap.alloc_count = &obj->alloc_count;
+	cap.relative = relative;
+
+	while (p < end)
+	{
+		const char* lineEnd = memchr(p, '\n', end - p);
+		if (lineEnd == NULL)
+			lineEnd = end;
+		cap.line++;
+
+		p = SkipSpaces(p, lineEnd);
+
+		if (lineEnd - p >= 2 && p[0] == 'v')
+		{
+			if (p[1] == ' ' || p[1] == '\t')			// v
+			{
+				if (!Reserve(&cap, (void**)&obj->vArr, &cap.vCap, (obj->v_num + 1) * 3, sizeof(GLfloat)))
+					goto fail;
+				ScanObjFloats(p + 2, lineEnd, obj->vArr + obj->v_num * 3, 3);
+				obj->v_num++;
+			}
+			else if (p[1] == 't')						// vt
+			{
+				if (!Reserve(&cap, (void**)&obj->vtArr, &cap.vtCap, (obj->vt_num + 1) * 2, sizeof(GLfloat)))
+					goto fail;
+				ScanObjFloats(p + 2, lineEnd, obj->vtArr + obj->vt_num * 2, 2);
+				obj->vt_num++;
+			}
+			else if (p[1] == 'n')						// vn
+			{
+				if (!Reserve(&cap, (void**)&obj->vnArr, &cap.vnCap, (obj->vn_num + 1) * 3, sizeof(GLfloat)))
+					goto fail;
+				ScanObjFloats(p + 2, lineEnd, obj->vnArr + obj->vn_num * 3, 3);
+				obj->vn_num++;
+			}
+		}
+		else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			if (!ScanFace(p + 2, lineEnd, obj, &cap))
+				goto fail;
+		}
+		// comments, g, s, o, usemtl, mtllib... are skipped
+
+		p = lineEnd + 1;
+	}
+
+	if (relative != NULL)
+		relative->lines = cap.line;
+	return TRUE;
+
+fail:
+	FreeObjFile(obj);
+	return FALSE;
+}
+
+int ParseObjText(const char* text, size_t length, ObjFile* obj)
+{
+	return ParseObjRange(text, length, obj, NULL);
+}
+
+// a line-aligned piece of the file, parsed on its own into part
+typedef struct
+{
+	const char* text;
+	size_t length;
+	ObjFile part;
+	ObjRelative relative;
+	int ok;
+
+	// first element of each array of part in the merged arrays
+	int vBase;
+	int vtBase;
+	int vnBase;
+	int fBase;
+	int cornerBase;
+} ObjChunk;
+
+typedef struct
+{
+	ObjChunk* chunks;
+	ObjFile* obj;
+} ObjChunkJob;
+
+static void ESCALLBACK ParseChunkTask(void* userData, int i)
+{
+	ObjChunk* chunk = &((ObjChunkJob*)userData)->chunks[i];
+
+	chunk->ok = ParseObjRange(chunk->text, chunk->length, &chunk->part, &chunk->relative);
+}
+
+// copy a parsed chunk to its place in the merged arrays and release it.
+// Positive face indices count from the start of the file, they are copied unchanged.
+static void ESCALLBACK MergeChunkTask(void* userData, int i)
+{
+	ObjChunkJob* job = (ObjChunkJob*)userData;
+	ObjChunk* chunk = &job->chunks[i];
+	ObjFile* part = &chunk->part;
+	ObjFile* obj = job->obj;
+
+	if (part->v_num > 0)
+		memcpy(obj->vArr + chunk->vBase * 3, part->vArr, sizeof(GLfloat) * 3 * part->v_num);
+	if (part->vt_num > 0)
+		memcpy(obj->vtArr + chunk->vtBase * 2, part->vtArr, sizeof(GLfloat) * 2 * part->vt_num);
+	if (part->vn_num > 0)
+		memcpy(obj->vnArr + chunk->vnBase * 3, part->vnArr, sizeof(GLfloat) * 3 * part->vn_num);
+	if (part->f_num > 0)
+		memcpy(obj->face_counts + chunk->fBase, part->face_counts, sizeof(int) * part->f_num);
+	if (part->corner_num > 0)
+	{
+		memcpy(obj->fvArr + chunk->cornerBase, part->fvArr, sizeof(int) * part->corner_num);
+		memcpy(obj->ftArr + chunk->cornerBase, part->ftArr, sizeof(int) * part->corner_num);
+		memcpy(obj->fnArr + chunk->cornerBase, part->fnArr, sizeof(int) * part->corner_num);
+	}
+
+	for (int r = 0; r < chunk->relative.num; r++)
+	{
+		int corner = chunk->cornerBase + chunk->relative.corners[r] / 3;
+
+		switch (chunk->relative.corners[r] % 3)
+		{
+		case 0: obj->fvArr[corner] += chunk->vBase; break;
+		case 1: obj->ftArr[corner] += chunk->vtBase; break;
+		case 2: obj->fnArr[corner] += chunk->vnBase; break;
+		}
+	}
+
+	FreeObjFile(part);
+	free(chunk->relative.corners);
+	chunk->relative.corners = NULL;
+}
+
+// exact size allocation of a merged array, NULL when it stays empty like it does in ParseObjText
+static int AllocMerged(ObjFile* obj, void** arr, int count, size_t elemSize)
+{
+	*arr = NULL;
+	if (count == 0)
+		return TRUE;
+
+	*arr = malloc(elemSize * count);
+	obj->alloc_count++;
+	return *arr != NULL;
+}
+
+int ParseObjTextParallel(const char* text, size_t length, ESThreadPool* pool, ObjFile* obj)
+{
+	size_t chunkCount = (length + OBJ_CHUNK_SIZE - 1) / OBJ_CHUNK_SIZE;
+	size_t start = 0;
+	ObjChunk* chunks;
+	ObjChunkJob job;
+	int allocs = 0;
+	int lines = 0;
+	int ok = TRUE;
+
+	if (pool == NULL || chunkCount <= 1)
+		return ParseObjText(text, length, obj);
+
+	memset(obj, 0, sizeof(ObjFile));
+	chunks = (ObjChunk*)calloc(chunkCount, sizeof(ObjChunk));
+	if (chunks == NULL)
+		return FALSE;
+
+	// every chunk ends right after a line break, a line longer than a chunk leaves the next one empty
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		size_t end = (i + 1) * OBJ_CHUNK_SIZE;
+
+		if (i + 1 == chunkCount || end >= length)
+		{
+			end = length;
+		}
+		else if (end < start)
+		{
+			end = start;
+		}
+		else
+		{
+			const char* lineEnd = memchr(text + end, '\n', length - end);
+			end = lineEnd != NULL ? (size_t)(lineEnd - text) + 1 : length;
+		}
+
+		chunks[i].text = text + start;
+		chunks[i].length = end - start;
+		start = end;
+	}
+
+	job.chunks = chunks;
+	job.obj = obj;
+	esRunTasks(pool, (int)chunkCount, ParseChunkTask, &job);
+
+	// prefix sums over the chunk counts, in file order
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		ObjFile* part = &chunks[i].part;
+		ObjRelative* relative = &chunks[i].relative;
+		int base[3] = { obj->v_num, obj->vt_num, obj->vn_num };
+
+		ok = ok && chunks[i].ok;
+		for (int s = 0; ok && s < 3; s++)
+		{
+			if (relative->need[s] > base[s])
+			{
+				printf("line %d: %s index out of range\n", lines + relative->needLine[s], streamNames[s]);
+				ok = FALSE;
+			}
+		}
+		lines += relative->lines;
+		chunks[i].vBase = obj->v_num;
+		chunks[i].vtBase = obj->vt_num;
+		chunks[i].vnBase = obj->vn_num;
+		chunks[i].fBase = obj->f_num;
+		chunks[i].cornerBase = obj->corner_num;
+		obj->v_num += part->v_num;
+		obj->vt_num += part->vt_num;
+		obj->vn_num += part->vn_num;
+		obj->f_num += part->f_num;
+		obj->corner_num += part->corner_num;
+		allocs += part->alloc_count;
+	}
+
+	ok = ok &&
+		AllocMerged(obj, (void**)&obj->vArr, obj->v_num * 3, sizeof(GLfloat)) &&
+		AllocMerged(obj, (void**)&obj->vtArr, obj->vt_num * 2, sizeof(GLfloat)) &&
+		AllocMerged(obj, (void**)&obj->vnArr, obj->vn_num * 3, sizeof(GLfloat)) &&
+		AllocMerged(obj, (void**)&obj->face_counts, obj->f_num, sizeof(int)) &&
+		AllocMerged(obj, (void**)&obj->fvArr, obj->corner_num, sizeof(int)) &&
+		AllocMerged(obj, (void**)&obj->ftArr, obj->corner_num, sizeof(int)) &&
+		AllocMerged(obj, (void**)&obj->fnArr, obj->corner_num, sizeof(int));
+
+	if (ok)
+	{
+		esRunTasks(pool, (int)chunkCount, MergeChunkTask, &job);
+		obj->alloc_count += allocs + 1;
+	}
+	else
+	{
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			FreeObjFile(&chunks[i].part);
+			free(chunks[i].relative.corners);
+		}
+		FreeObjFile(obj);
+	}
+
+	free(chunks);
+	return ok;
+}
+
+int LoadObjFile(const char* filename, ObjFile* obj)
+{
+	ESMappedFile file;
+	int ret;
+
+	if (!esMapFile(NULL, filename, &file))
+	{
+		printf("file cannot open: %s\n", filename);
+		memset(obj, 0, sizeof(ObjFile));
+		return FALSE;
+	}
+
+	// threads only pay off once there is more than one chunk to parse
+	if (file.size > OBJ_CHUNK_SIZE)
+	{
+		ESThreadPool* pool = esCreateThreadPool(0);
+		ret = ParseObjTextParallel((const char*)file.data, file.size, pool, obj);
+		esDestroyThreadPool(pool);
+	}
+	else
+	{
+		ret = ParseObjText((const char*)file.data, file.size, obj);
+	}
+
+	esUnmapFile(&file);
+	return ret;
+}
+
+void RemapTexCoords(GLfloat* texCoords, int count, int stride, const ESAtlasRegion* region)
+{
+	int i, j;
+
+	for (i = 0; i < count; i++)
+	{
+		for (j = 0; j < 2; j++)
+		{
+			GLfloat st = texCoords[(size_t)i * stride + j];
+
+			st = st < 0.0f ? 0.0f : st > 1.0f ? 1.0f : st;
+			texCoords[(size_t)i * stride + j] = st * region->scale[j] + region->offset[j];
+		}
+	}
+}
+
+void RemapObjTexCoords(ObjFile* obj, const ESAtlasRegion* region)
+{
+	RemapTexCoords(obj->vtArr, obj->vt_num, 2, region);
+}
+
+void FreeObjFile(ObjFile* obj)
+{
+	free(obj->vArr);
+	free(obj->vtArr);
+	free(obj->vnArr);
+	free(obj->face_counts);
+	free(obj->fvArr);
+	free(obj->ftArr);
+	free(obj->fnArr);
+	memset(obj, 0, sizeof(ObjFile));
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef MYOBJLOADER_H
+#define MYOBJLOADER_H
+
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+
+// Raw content of an obj file, read in a single pass over the memory mapped file.
+// All arrays are contiguous and all indices are 0-based.
+//
+// v  0.5 0.5 0.5          --> vArr  [..., 0.5, 0.5, 0.5, ...]       (3 floats per v)
+// vt 0.01992 0.998 0.0    --> vtArr [..., 0.01992, 0.998, ...]      (2 floats per vt, the third one is ignored)
+// vn 0.0 1.0 0.0          --> vnArr [..., 0.0, 1.0, 0.0, ...]       (3 floats per vn)
+// f 5/11/23 1/10/22 3/12/24 7/9/21
+//                         --> face_counts [..., 4, ...]
+//                             fvArr [..., 4, 0, 2, 6, ...]
+//                             ftArr [..., 10, 9, 11, 8, ...]
+//                             fnArr [..., 22, 21, 23, 20, ...]
+// a corner without vt or vn ("1/3" or "160//12") stores -1 in the missing slot.
+// Faces have any number of corners, relative indices ("f -3 -2 -1") are resolved while parsing.
+// An index to an element not read yet, or in front of the first one, fails the parse with its line number.
+typedef struct
+{
+	int v_num;
+	int vt_num;
+	int vn_num;
+	int f_num;
+	int corner_num; // sum of face_counts
+
+	GLfloat* vArr;
+	GLfloat* vtArr;
+	GLfloat* vnArr;
+
+	int* face_counts;
+	int* fvArr;
+	int* ftArr;
+	int* fnArr;
+
+	int alloc_count; // malloc / realloc calls made while parsing, for profiling
+} ObjFile;
+
+// parse filename into obj, return TRUE on success
+// there is no counting pass, arrays grow geometrically while the file is parsed.
+// Files larger than a chunk are parsed by ParseObjTextParallel on one thread per processor.
+int LoadObjFile(const char* filename, ObjFile* obj);
+
+// parse an obj file that is already in memory, text does not need to be null-terminated
+int ParseObjText(const char* text, size_t length, ObjFile* obj);
+
+// ParseObjText on the threads of pool: the text is cut into line-aligned chunks of about 1 MB,
+// every chunk is parsed into arrays of its own, then the chunks are copied behind each other
+// at offsets given by a prefix sum of their counts. The result is the same, bit for bit, as the
+// one of ParseObjText, only alloc_count differs. A NULL pool or a single chunk runs ParseObjText.
+int ParseObjTextParallel(const char* text, size_t length, ESThreadPool* pool, ObjFile* obj);
+
+// release every array of obj
+void FreeObjFile(ObjFile* obj);
+
+// move count texture coordinates, stride floats apart, into the region of an image in an atlas
+// (esBuildAtlas): s' = s * scale + offset. Coordinates outside [0, 1] are clamped to the image,
+// an atlas can't repeat it.
+void RemapTexCoords(GLfloat* texCoords, int count, int stride, const ESAtlasRegion* region);
+
+// RemapTexCoords on every vt of obj, right after LoadObjFile when the texture of the model is in an atlas
+void RemapObjTexCoords(ObjFile* obj, const ESAtlasRegion* region);
+
+// the number scanners of the loader, for code reading obj lines itself (myObjStream.c)
+// read count floats of a v/vt/vn line into ret, missing values are 0
+void ScanObjFloats(const char* p, const char* end, GLfloat* ret, int count);
+
+// read one corner of an f line ("3/13/5", "1/3", "160//12", "-1") as written in the file:
+// 1-based, negative when relative, 0 when vt or vn is missing.
+// Return the end of the corner, NULL when there is no corner left on the line.
+const char* ScanObjCorner(const char* p, const char* end, int* v, int* vt, int* vn);
+
+#endif
@@ -0,0 +1,406 @@
+// myObjLoaderBench.c
+//
+//    Compares the single pass loader of myObjLoader.c and the arena backed mesh of myMesh.c
+//    with the two pass GetDataNum/LoadDataFromFile code and GLfloat** rows the MyObj samples used before.
+//    Put this file in the project instead of MyObj3.c (together with myObjLoader.c and myMesh.c).
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myObjLoader.h"
+#include "myMesh.h"
+#include "myUtil.h"
+#include "myBench.h"
+
+#ifndef _MSC_VER
+#define strtok_s strtok_r
+#endif
+
+#define BENCH_ITERATIONS 20
+
+// every malloc of the legacy code below is counted
+static int legacyAllocCount;
+#define malloc(size) (legacyAllocCount++, malloc(size))
+
+typedef struct
+{
+	int v_num;
+	int vt_num;
+	int vn_num;
+	int f_num;
+	int* face_counts;
+
+	GLfloat** vArr;
+	GLfloat** vtArr;
+	GLfloat** vnArr;
+	int** fvArr;
+	int** ftArr;
+	int** fnArr;
+	GLfloat* texCoords;
+} LegacyObj;
+
+// GetDataNum of MyObj4.c, counting into obj instead of the global ObjData
+static int LegacyGetDataNum(const char* filename, LegacyObj* obj)
+{
+	char line[1024];
+	FILE* file;
+
+	file = fopen(filename, "r");
+	if (file == NULL)
+	{
+		printf("file cannot open \n");
+		return FALSE;
+	}
+	while (!feof(file))
+	{
+		for (int i = 0; i < 1024; i++)
+			line[i] = 0;
+
+		fgets(line, 1024, file);
+
+		if (line[0] == 'v')
+		{
+			if (line[1] == 'n')
+				obj->vn_num++;
+			else if (line[1] == 't')
+				obj->vt_num++;
+			else
+				obj->v_num++;
+		}
+		else if (line[0] == 'f')
+		{
+			obj->f_num++;
+		}
+	}
+	fclose(file);
+	return TRUE;
+}
+
+// LoadDataFromFile of MyObj4.c, without its per-corner printf so only parsing is measured.
+// The end of file check is done on fgets, the original loop parsed the last line twice.
+static int LegacyLoadDataFromFile(const char* filename, LegacyObj* obj)
+{
+	char line[1024];
+	FILE* file;
+
+	obj->vArr = (GLfloat**)malloc(sizeof(GLfloat*) * obj->v_num);
+	for (int i = 0; i < obj->v_num; i++)
+		obj->vArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
+
+	obj->vtArr = (GLfloat**)malloc(sizeof(GLfloat*) * obj->vt_num);
+	for (int i = 0; i < obj->vt_num; i++)
+		obj->vtArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 2);
+	obj->texCoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * obj->vt_num);
+
+	obj->vnArr = (GLfloat**)malloc(sizeof(GLfloat*) * obj->vn_num);
+	for (int i = 0; i < obj->vn_num; i++)
+		obj->vnArr[i] = (GLfloat*)malloc(sizeof(GLfloat) * 3);
+
+	obj->face_counts = (int*)malloc(sizeof(int) * obj->f_num);
+	obj->fvArr = (int**)malloc(sizeof(int*) * obj->f_num);
+	obj->ftArr = (int**)malloc(sizeof(int*) * obj->f_num);
+	obj->fnArr = (int**)malloc(sizeof(int*) * obj->f_num);
+	for (int i = 0; i < obj->f_num; i++)
+	{
+		obj->fvArr[i] = (int*)malloc(sizeof(int) * 4);
+		obj->ftArr[i] = (int*)malloc(sizeof(int) * 4);
+		obj->fnArr[i] = (int*)malloc(sizeof(int) * 4);
+	}
+
+	file = fopen(filename, "r");
+	if (file == NULL)
+	{
+		printf("file cannot open \n");
+		return FALSE;
+	}
+
+	int vnRow = 0, vtRow = 0, vRow = 0, fRow = 0;
+	int vtIndex = 0;
+	while (fgets(line, 1024, file) != NULL)
+	{
+		char* token = NULL;
+		char* next_token = NULL;
+		token = strtok_s(line, " ", &next_token);
+		int count = 0;
+
+		if (line[0] == 'v')
+		{
+			if (line[1] == 'n')
+			{
+				while (token != NULL && strcmp(token, "\n") != 0)
+				{
+					if (count > 0)
+						obj->vnArr[vnRow][count - 1] = atof(token);
+					token = strtok_s(NULL, " ", &next_token);
+					count++;
+				}
+				vnRow++;
+			}
+			else if (line[1] == 't')
+			{
+				while (token != NULL && strcmp(token, "\n") != 0)
+				{
+					if (count > 0 && count < 3)
+					{
+						obj->texCoords[vtIndex] = atof(token);
+						obj->vtArr[vtRow][count - 1] = atof(token);
+						vtIndex++;
+					}
+					token = strtok_s(NULL, " ", &next_token);
+					count++;
+				}
+				vtRow++;
+			}
+			else
+			{
+				while (token != NULL && strcmp(token, "\n") != 0)
+				{
+					if (count > 0)
+						obj->vArr[vRow][count - 1] = atof(token);
+					token = strtok_s(NULL, " ", &next_token);
+					count++;
+				}
+				vRow++;
+			}
+		}
+		else if (line[0] == 'f')
+		{
+			while (token != NULL && strcmp(token, "\n") != 0)
+			{
+				int face_count = 0;
+				if (count > 0)
+				{
+					char* face_token = NULL;
+					char* face_next_token = NULL;
+					face_token = strtok_s(token, "/", &face_next_token);
+
+					while (face_token != NULL)
+					{
+						if (face_count == 0)
+							obj->fvArr[fRow][count - 1] = atoi(face_token);
+						else if (face_count == 1)
+							obj->ftArr[fRow][count - 1] = atoi(face_token);
+
+						face_token = strtok_s(NULL, "/", &face_next_token);
+						face_count++;
+					}
+				}
+				token = strtok_s(NULL, " ", &next_token);
+				count++;
+			}
+
+			obj->face_counts[fRow] = count - 1;
+			fRow++;
+		}
+	}
+
+	fclose(file);
+	return TRUE;
+}
+
+static void LegacyFree(LegacyObj* obj)
+{
+	for (int i = 0; i < obj->v_num; i++)
+		free(obj->vArr[i]);
+	for (int i = 0; i < obj->vt_num; i++)
+		free(obj->vtArr[i]);
+	for (int i = 0; i < obj->vn_num; i++)
+		free(obj->vnArr[i]);
+	for (int i = 0; i < obj->f_num; i++)
+	{
+		free(obj->fvArr[i]);
+		free(obj->ftArr[i]);
+		free(obj->fnArr[i]);
+	}
+	free(obj->vArr);
+	free(obj->vtArr);
+	free(obj->vnArr);
+	free(obj->fvArr);
+	free(obj->ftArr);
+	free(obj->fnArr);
+	free(obj->face_counts);
+	free(obj->texCoords);
+	memset(obj, 0, sizeof(LegacyObj));
+}
+
+#undef malloc
+
+static int LegacyLoad(const char* filename, LegacyObj* obj)
+{
+	memset(obj, 0, sizeof(LegacyObj));
+	return LegacyGetDataNum(filename, obj) && LegacyLoadDataFromFile(filename, obj);
+}
+
+// GetMidBotPosition of myUtil.c as it was on the rows
+static void LegacyMidBot(const GLfloat** vArr, const int length, GLfloat* ret)
+{
+	GLfloat x = 0;
+	GLfloat y = 0;
+	GLfloat z = 0;
+
+	for (int i = 0; i < length; i++)
+	{
+		x += vArr[i][0];
+		if (vArr[i][1] < y)
+			y = vArr[i][1];
+		z += vArr[i][2];
+	}
+
+	ret[0] = x / length;
+	ret[1] = y;
+	ret[2] = z / length;
+}
+
+// both loaders have to agree before their speed is worth comparing
+static int SameContent(const LegacyObj* legacy, const ObjFile* obj)
+{
+	int corner = 0;
+
+	if (legacy->v_num != obj->v_num || legacy->vt_num != obj->vt_num ||
+		legacy->vn_num != obj->vn_num || legacy->f_num != obj->f_num)
+		return FALSE;
+
+	for (int i = 0; i < obj->v_num; i++)
+		for (int j = 0; j < 3; j++)
+			if (legacy->vArr[i][j] != obj->vArr[i * 3 + j])
+				return FALSE;
+
+	for (int i = 0; i < obj->vt_num; i++)
+		for (int j = 0; j < 2; j++)
+			if (legacy->vtArr[i][j] != obj->vtArr[i * 2 + j])
+				return FALSE;
+
+	for (int i = 0; i < obj->f_num; i++)
+	{
+		if (legacy->face_counts[i] != obj->face_counts[i])
+			return FALSE;
+		for (int j = 0; j < obj->face_counts[i]; j++, corner++)
+		{
+			if (legacy->fvArr[i][j] - 1 != obj->fvArr[corner] ||
+				legacy->ftArr[i][j] - 1 != obj->ftArr[corner])
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static int SameMesh(const ObjFile* obj, const MeshData* mesh)
+{
+	return obj->v_num == mesh->v_num && obj->vt_num == mesh->vt_num && obj->f_num == mesh->f_num &&
+		obj->corner_num == mesh->corner_num &&
+		memcmp(obj->vArr, mesh->positions, sizeof(GLfloat) * 3 * obj->v_num) == 0 &&
+		memcmp(obj->vtArr, mesh->texCoords, sizeof(GLfloat) * 2 * obj->vt_num) == 0 &&
+		memcmp(obj->face_counts, mesh->face_counts, sizeof(int) * obj->f_num) == 0 &&
+		memcmp(obj->fvArr, mesh->fvIndices, sizeof(int) * obj->corner_num) == 0 &&
+		memcmp(obj->ftArr, mesh->ftIndices, sizeof(int) * obj->corner_num) == 0;
+}
+
+static long FileSize(const char* filename)
+{
+	long size = -1;
+	FILE* file = fopen(filename, "rb");
+
+	if (file != NULL)
+	{
+		fseek(file, 0, SEEK_END);
+		size = ftell(file);
+		fclose(file);
+	}
+	return size;
+}
+
+static void BenchModel(const char* filename)
+{
+	double legacyBest = 1e30, newBest = 1e30, meshBest = 1e30;
+	double rowsBest = 1e30, flatBest = 1e30;
+	double megabytes;
+	long size = FileSize(filename);
+	LegacyObj legacy;
+	ObjFile obj;
+	MeshData mesh;
+	int legacyAllocs, objAllocs;
+	GLfloat midbot[3];
+	int same;
+
+	legacyAllocCount = 0;
+	if (size <= 0 || !LegacyLoad(filename, &legacy) || !LoadObjFile(filename, &obj) || !LoadObjMesh(filename, &mesh))
+	{
+		printf("%-12s cannot be loaded\n", filename);
+		return;
+	}
+	legacyAllocs = legacyAllocCount;
+	objAllocs = obj.alloc_count;
+	same = SameContent(&legacy, &obj) && SameMesh(&obj, &mesh);
+	FreeObjFile(&obj);
+
+	// walking every vertex once: rows of the legacy layout against the flat position stream
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		double start = BenchNow();
+		LegacyMidBot((const GLfloat**)legacy.vArr, legacy.v_num, midbot);
+		double elapsed = BenchNow() - start;
+		if (elapsed < rowsBest)
+			rowsBest = elapsed;
+
+		start = BenchNow();
+		GetMidBotPosition(mesh.positions, mesh.v_num, midbot);
+		elapsed = BenchNow() - start;
+		if (elapsed < flatBest)
+			flatBest = elapsed;
+	}
+	LegacyFree(&legacy);
+	FreeMesh(&mesh);
+
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		double start = BenchNow();
+		LegacyLoad(filename, &legacy);
+		double elapsed = BenchNow() - start;
+		LegacyFree(&legacy);
+		if (elapsed < legacyBest)
+			legacyBest = elapsed;
+
+		start = BenchNow();
+		LoadObjFile(filename, &obj);
+		elapsed = BenchNow() - start;
+		FreeObjFile(&obj);
+		if (elapsed < newBest)
+			newBest = elapsed;
+
+		start = BenchNow();
+		LoadObjMesh(filename, &mesh);
+		elapsed = BenchNow() - start;
+		FreeMesh(&mesh);
+		if (elapsed < meshBest)
+			meshBest = elapsed;
+	}
+
+	megabytes = (double)size / (1024.0 * 1024.0);
+	printf("%-12s %8.1f KB  two pass %8.3f ms %8.1f MB/s  single pass %8.3f ms %8.1f MB/s  x%5.1f  mesh %8.3f ms  %s\n",
+		filename, size / 1024.0,
+		legacyBest * 1000.0, megabytes / legacyBest,
+		newBest * 1000.0, megabytes / newBest,
+		legacyBest / newBest,
+		meshBest * 1000.0,
+		same ? "same data" : "DATA MISMATCH");
+	printf("%-12s allocations: two pass %8d  mesh %3d while loading, %d kept  |  vertex walk: rows %7.1f us  flat %7.1f us\n",
+		"", legacyAllocs, objAllocs + 1, 1,
+		rowsBest * 1e6, flatBest * 1e6);
+}
+
+int esMain(ESContext* esContext)
+{
+	const char* models[] = { "ailian.obj", "bear.obj", "stone.obj" };
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	printf("best of %d runs\n", BENCH_ITERATIONS);
+	for (int i = 0; i < (int)(sizeof(models) / sizeof(models[0])); i++)
+		BenchModel(models[i]);
+
+	// nothing to render
+	exit(0);
+}
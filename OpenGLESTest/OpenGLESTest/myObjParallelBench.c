@@ -0,0 +1,108 @@
+// myObjParallelBench.c
+//
+//    Scaling of ParseObjTextParallel at 1, 2, 4 and 8 threads against the single threaded ParseObjText,
+//    on a synthetic scan-sized model written to the working directory first (and removed afterwards).
+//    Every parallel result is compared with the serial one byte for byte.
+//    Put this file in the project instead of MyObj3.c (together with myObjLoader.c).
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "esUtil.h"
+#include "myObjLoader.h"
+#include "myBench.h"
+
+#define BENCH_ITERATIONS 3
+
+// a SYNTHETIC_GRID x SYNTHETIC_GRID vertex height field, two triangles per cell, 286 MB
+#define SYNTHETIC_GRID 1200
+#define SYNTHETIC_FILENAME "synthetic.obj"
+
+static const int threadCounts[] = { 1, 2, 4, 8 };
+
+// everything but alloc_count has to match
+static int SameObj(const ObjFile* a, const ObjFile* b)
+{
+	return a->v_num == b->v_num && a->vt_num == b->vt_num && a->vn_num == b->vn_num &&
+		a->f_num == b->f_num && a->corner_num == b->corner_num &&
+		memcmp(a->vArr, b->vArr, sizeof(GLfloat) * 3 * a->v_num) == 0 &&
+		memcmp(a->vtArr, b->vtArr, sizeof(GLfloat) * 2 * a->vt_num) == 0 &&
+		memcmp(a->vnArr, b->vnArr, sizeof(GLfloat) * 3 * a->vn_num) == 0 &&
+		memcmp(a->face_counts, b->face_counts, sizeof(int) * a->f_num) == 0 &&
+		memcmp(a->fvArr, b->fvArr, sizeof(int) * a->corner_num) == 0 &&
+		memcmp(a->ftArr, b->ftArr, sizeof(int) * a->corner_num) == 0 &&
+		memcmp(a->fnArr, b->fnArr, sizeof(int) * a->corner_num) == 0;
+}
+
+int esMain(ESContext* esContext)
+{
+	ESMappedFile file;
+	ObjFile serial, parallel;
+	double serialBest = 1e30;
+	double megabytes;
+	double start = BenchNow();
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	if (!BenchWriteSyntheticObj(SYNTHETIC_FILENAME, SYNTHETIC_GRID) || !esMapFile(NULL, SYNTHETIC_FILENAME, &file))
+	{
+		printf("cannot write %s\n", SYNTHETIC_FILENAME);
+		remove(SYNTHETIC_FILENAME);
+		exit(1);
+	}
+	megabytes = (double)file.size / (1024.0 * 1024.0);
+	printf("%s: %.1f MB written in %.1f s, %d processors, best of %d runs\n",
+		SYNTHETIC_FILENAME, megabytes, BenchNow() - start, esGetProcessorCount(), BENCH_ITERATIONS);
+
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+	{
+		if (i > 0)
+			FreeObjFile(&serial);
+		start = BenchNow();
+		if (!ParseObjText((const char*)file.data, file.size, &serial))
+		{
+			printf("%s cannot be parsed\n", SYNTHETIC_FILENAME);
+			esUnmapFile(&file);
+			remove(SYNTHETIC_FILENAME);
+			exit(1);
+		}
+		double elapsed = BenchNow() - start;
+		if (elapsed < serialBest)
+			serialBest = elapsed;
+	}
+	printf("%d v, %d vt, %d vn, %d faces\n", serial.v_num, serial.vt_num, serial.vn_num, serial.f_num);
+	printf("serial     %9.1f ms %8.1f MB/s\n", serialBest * 1000.0, megabytes / serialBest);
+
+	for (int t = 0; t < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); t++)
+	{
+		ESThreadPool* pool = esCreateThreadPool(threadCounts[t]);
+		double best = 1e30;
+		int same = TRUE;
+
+		for (int i = 0; i < BENCH_ITERATIONS; i++)
+		{
+			start = BenchNow();
+			int ok = ParseObjTextParallel((const char*)file.data, file.size, pool, &parallel);
+			double elapsed = BenchNow() - start;
+			if (elapsed < best)
+				best = elapsed;
+
+			same = same && ok && SameObj(&serial, &parallel);
+			FreeObjFile(&parallel);
+		}
+
+		printf("%d thread%s  %9.1f ms %8.1f MB/s  x%4.2f  %s\n",
+			esGetThreadCount(pool), esGetThreadCount(pool) == 1 ? " " : "s",
+			best * 1000.0, megabytes / best, serialBest / best,
+			same ? "identical" : "OUTPUT DIFFERS");
+		esDestroyThreadPool(pool);
+	}
+
+	FreeObjFile(&serial);
+	esUnmapFile(&file);
+	remove(SYNTHETIC_FILENAME);
+
+	// nothing to render
+	exit(0);
+}
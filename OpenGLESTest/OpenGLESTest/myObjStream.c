@@ -0,0 +1,605 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "myObjStream.h"
+#include "myObjLoader.h"
+
+// the largest batch, indices are 16 bit
+#define OBJ_STREAM_MAX_VERTICES 65536
+
+// indices per vertex a batch has room for, a closed triangle mesh uses about 6
+#define OBJ_STREAM_INDICES_PER_VERTEX 6
+
+#define LINE_NONE 0
+#define LINE_V    1
+#define LINE_VT   2
+#define LINE_VN   3
+#define LINE_F    4
+
+// next line of the file in stream->line, FALSE at the end of the file or on a read error
+static int ReadLine(ObjStream* stream)
+{
+	if (stream->keepLine)
+	{
+		stream->keepLine = FALSE;
+		return TRUE;
+	}
+
+	for (;;)
+	{
+		const char* start = stream->block + stream->cursor;
+		const char* newline = memchr(start, '\n', stream->blockUsed - stream->cursor);
+		size_t read;
+
+		if (newline != NULL)
+		{
+			stream->line = start;
+			stream->lineEnd = newline;
+			stream->cursor = newline - stream->block + 1;
+			return TRUE;
+		}
+
+		if (stream->eof)
+		{
+			// last line without a line break
+			if (stream->cursor == stream->blockUsed)
+				return FALSE;
+			stream->line = start;
+			stream->lineEnd = stream->block + stream->blockUsed;
+			stream->cursor = stream->blockUsed;
+			return TRUE;
+		}
+
+		if (stream->cursor == 0 && stream->blockUsed == OBJ_STREAM_BLOCK_SIZE)
+		{
+			printf("obj line longer than %d bytes\n", OBJ_STREAM_BLOCK_SIZE);
+			stream->error = TRUE;
+			return FALSE;
+		}
+
+		// move the unfinished line to the front and fill the rest of the block
+		memmove(stream->block, start, stream->blockUsed - stream->cursor);
+		stream->blockUsed -= stream->cursor;
+		stream->cursor = 0;
+
+		read = fread(stream->block + stream->blockUsed, 1, OBJ_STREAM_BLOCK_SIZE - stream->blockUsed, stream->file);
+		if (read == 0)
+		{
+			if (ferror(stream->file))
+			{
+				printf("obj read error\n");
+				stream->error = TRUE;
+				return FALSE;
+			}
+			stream->eof = TRUE;
+		}
+		stream->blockUsed += read;
+	}
+}
+
+static void Rewind(ObjStream* stream)
+{
+	fseek(stream->file, 0, SEEK_SET);
+	clearerr(stream->file);
+	stream->blockUsed = 0;
+	stream->cursor = 0;
+	stream->eof = FALSE;
+	stream->keepLine = FALSE;
+}
+
+// kind of the current line, *body is set to what follows the keyword
+static int LineType(const ObjStream* stream, const char** body)
+{
+	const char* p = stream->line;
+	const char* end = stream->lineEnd;
+
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	*body = p + 2;
+
+	if (end - p < 2)
+		return LINE_NONE;
+	if (p[0] == 'v')
+	{
+		if (p[1] == ' ' || p[1] == '\t')
+			return LINE_V;
+		if (p[1] == 't')
+			return LINE_VT;
+		if (p[1] == 'n')
+			return LINE_VN;
+	}
+	else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+	{
+		return LINE_F;
+	}
+	return LINE_NONE;
+}
+
+// 0-based index as written in a face, -1 when missing or not defined yet
+static int StreamIndex(int index, int count)
+{
+	if (index > 0)
+		index--;
+	else if (index < 0)
+		index += count;
+	else
+		return -1;
+	return index < count ? index : -1;
+}
+
+static unsigned int HashKey(int v, int vt, int vn)
+{
+	unsigned int h = (unsigned int)v * 73856093u ^ (unsigned int)vt * 19349663u ^ (unsigned int)vn * 83492791u;
+	return h ^ (h >> 16);
+}
+
+// triangles of the largest face TriangulatePolygon is called for
+static int ClipTriangles(const ObjStream* stream)
+{
+	int corners = stream->faceCornerMax < MESH_MAX_CLIP_CORNERS ? stream->faceCornerMax : MESH_MAX_CLIP_CORNERS;
+	return corners > 3 ? corners - 2 : 1;
+}
+
+// bytes a stream needs for its elements, the read block and the face scratch
+static size_t FixedBytes(const ObjStream* stream)
+{
+	size_t bytes = OBJ_STREAM_BLOCK_SIZE + sizeof(GLfloat) * 3 * (stream->v_num + 1);
+
+	if (stream->texcoord_offset >= 0)
+		bytes += sizeof(GLfloat) * 2 * stream->vt_num;
+	if (stream->normal_offset >= 0)
+		bytes += sizeof(GLfloat) * 3 * stream->vn_num;
+	bytes += (sizeof(int) + sizeof(GLfloat)) * 3 * (stream->faceCornerMax + 1) +
+		sizeof(unsigned short) * 3 * ClipTriangles(stream);
+	return bytes;
+}
+
+// bytes of a batch of vertices with its indices and weld table
+static size_t BatchBytes(const ObjStream* stream, int vertices, unsigned int slots)
+{
+	return sizeof(GLfloat) * stream->stride * vertices +
+		sizeof(GLushort) * OBJ_STREAM_INDICES_PER_VERTEX * vertices + sizeof(ObjStreamSlot) * slots;
+}
+
+static unsigned int SlotCount(int vertices)
+{
+	unsigned int slots = 16;
+
+	// the table is never more than half full
+	while (slots < 2u * (unsigned int)vertices)
+		slots *= 2;
+	return slots;
+}
+
+int OpenObjStream(const char* filename, int attribs, size_t memoryLimit, ObjStream* stream)
+{
+	const char* body;
+	size_t fixed;
+	int vertices = OBJ_STREAM_MAX_VERTICES;
+
+	memset(stream, 0, sizeof(ObjStream));
+	stream->attribs = attribs;
+
+	stream->file = fopen(filename, "rb");
+	if (stream->file == NULL)
+	{
+		printf("file cannot open: %s\n", filename);
+		return FALSE;
+	}
+	stream->block = (char*)malloc(OBJ_STREAM_BLOCK_SIZE);
+	if (stream->block == NULL)
+	{
+		CloseObjStream(stream);
+		return FALSE;
+	}
+
+	// counting pass, sizes everything that is allocated below
+	while (ReadLine(stream))
+	{
+		switch (LineType(stream, &body))
+		{
+		case LINE_V: stream->v_num++; break;
+		case LINE_VT: stream->vt_num++; break;
+		case LINE_VN: stream->vn_num++; break;
+		case LINE_F:
+		{
+			int count = 0, v, vt, vn;
+			while ((body = ScanObjCorner(body, stream->lineEnd, &v, &vt, &vn)) != NULL)
+				count++;
+			if (count >= 3)
+			{
+				stream->f_num++;
+				stream->triangle_num += count - 2;
+				if (count > stream->faceCornerMax)
+					stream->faceCornerMax = count;
+			}
+			break;
+		}
+		}
+	}
+	if (stream->error)
+	{
+		CloseObjStream(stream);
+		return FALSE;
+	}
+
+	stream->stride = 3;
+	stream->texcoord_offset = -1;
+	stream->normal_offset = -1;
+	if ((attribs & MESH_ATTRIB_TEXCOORD) && stream->vt_num > 0)
+	{
+		stream->texcoord_offset = stream->stride;
+		stream->stride += 2;
+	}
+	if ((attribs & MESH_ATTRIB_NORMAL) && stream->vn_num > 0)
+	{
+		stream->normal_offset = stream->stride;
+		stream->stride += 3;
+	}
+
+	// the largest batch the limit leaves room for, it still has to hold the largest face
+	fixed = FixedBytes(stream);
+	while (vertices >= stream->faceCornerMax && vertices > 16 &&
+		fixed + BatchBytes(stream, vertices, SlotCount(vertices)) > memoryLimit)
+		vertices -= vertices / 8;
+
+	if (fixed + BatchBytes(stream, vertices, SlotCount(vertices)) > memoryLimit || vertices < stream->faceCornerMax)
+	{
+		printf("%s: a memory limit of %.1f MB is too small, the elements and the read block alone take %.1f MB\n",
+			filename, memoryLimit / (1024.0 * 1024.0), fixed / (1024.0 * 1024.0));
+		CloseObjStream(stream);
+		return FALSE;
+	}
+	stream->batch_vertex_max = vertices;
+	stream->batch_index_max = vertices * OBJ_STREAM_INDICES_PER_VERTEX;
+	stream->slotMask = SlotCount(vertices) - 1;
+
+	stream->positions = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (stream->v_num + 1));
+	if (stream->texcoord_offset >= 0)
+		stream->texCoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * stream->vt_num);
+	if (stream->normal_offset >= 0)
+		stream->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * stream->vn_num);
+	stream->vertices = (GLfloat*)malloc(sizeof(GLfloat) * stream->stride * vertices);
+	stream->indices = (GLushort*)malloc(sizeof(GLushort) * stream->batch_index_max);
+	stream->slots = (ObjStreamSlot*)calloc(stream->slotMask + 1, sizeof(ObjStreamSlot));
+	stream->faceCorners = (int*)malloc(sizeof(int) * 3 * (stream->faceCornerMax + 1));
+	stream->facePositions = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (stream->faceCornerMax + 1));
+	stream->faceTris = (unsigned short*)malloc(sizeof(unsigned short) * 3 * ClipTriangles(stream));
+
+	if (stream->positions == NULL || (stream->texcoord_offset >= 0 && stream->texCoords == NULL) ||
+		(stream->normal_offset >= 0 && stream->normals == NULL) || stream->vertices == NULL ||
+		stream->indices == NULL || stream->slots == NULL || stream->faceCorners == NULL ||
+		stream->facePositions == NULL || stream->faceTris == NULL)
+	{
+		printf("out of memory for streaming %s\n", filename);
+		CloseObjStream(stream);
+		return FALSE;
+	}
+	stream->memory_used = fixed + BatchBytes(stream, vertices, stream->slotMask + 1);
+
+	Rewind(stream);
+	return TRUE;
+}
+
+// welded vertex of a corner in the current batch, added when it's new
+static int BatchVertex(ObjStream* stream, int* vertex_num, int v, int vt, int vn)
+{
+	unsigned int slot = HashKey(v, vt, vn) & stream->slotMask;
+	unsigned int batch = (unsigned int)stream->batch_num + 1; // slots start out at 0
+	GLfloat* vertex;
+
+	for (;;)
+	{
+		ObjStreamSlot* entry = &stream->slots[slot];
+
+		if (entry->batch != batch)
+		{
+			entry->batch = batch;
+			entry->v = v;
+			entry->vt = vt;
+			entry->vn = vn;
+			entry->index = (*vertex_num)++;
+			break;
+		}
+		if (entry->v == v && entry->vt == vt && entry->vn == vn)
+			return entry->index;
+		slot = (slot + 1) & stream->slotMask;
+	}
+
+	vertex = stream->vertices + stream->slots[slot].index * stream->stride;
+	for (int j = 0; j < 3; j++)
+		vertex[j] = v >= 0 ? stream->positions[v * 3 + j] : 0.0f;
+	if (stream->texcoord_offset >= 0)
+		for (int j = 0; j < 2; j++)
+			vertex[stream->texcoord_offset + j] = vt >= 0 ? stream->texCoords[vt * 2 + j] : 0.0f;
+	if (stream->normal_offset >= 0)
+		for (int j = 0; j < 3; j++)
+			vertex[stream->normal_offset + j] = vn >= 0 ? stream->normals[vn * 3 + j] : 0.0f;
+	return stream->slots[slot].index;
+}
+
+int NextObjBatch(ObjStream* stream, ObjStreamBatch* batch)
+{
+	const char* body;
+	int vertex_num = 0;
+	int index_num = 0;
+
+	memset(batch, 0, sizeof(ObjStreamBatch));
+	if (stream->error)
+		return FALSE;
+
+	while (ReadLine(stream))
+	{
+		int type = LineType(stream, &body);
+
+		if (type == LINE_V)
+		{
+			if (stream->vRead < stream->v_num)
+				ScanObjFloats(body, stream->lineEnd, stream->positions + stream->vRead * 3, 3);
+			stream->vRead++;
+		}
+		else if (type == LINE_VT)
+		{
+			if (stream->texCoords != NULL && stream->vtRead < stream->vt_num)
+				ScanObjFloats(body, stream->lineEnd, stream->texCoords + stream->vtRead * 2, 2);
+			stream->vtRead++;
+		}
+		else if (type == LINE_VN)
+		{
+			if (stream->normals != NULL && stream->vnRead < stream->vn_num)
+				ScanObjFloats(body, stream->lineEnd, stream->normals + stream->vnRead * 3, 3);
+			stream->vnRead++;
+		}
+		else if (type == LINE_F)
+		{
+			int* corners = stream->faceCorners;
+			int count = 0, v, vt, vn;
+			int hasPositions = TRUE;
+
+			while (count < stream->faceCornerMax && (body = ScanObjCorner(body, stream->lineEnd, &v, &vt, &vn)) != NULL)
+			{
+				corners[count * 3 + 0] = StreamIndex(v, stream->vRead);
+				corners[count * 3 + 1] = stream->texCoords != NULL ? StreamIndex(vt, stream->vtRead) : -1;
+				corners[count * 3 + 2] = stream->normals != NULL ? StreamIndex(vn, stream->vnRead) : -1;
+				count++;
+			}
+			if (count < 3)
+				continue;
+
+			// the face goes into the next batch, the line is read again
+			if (vertex_num + count > stream->batch_vertex_max || index_num + 3 * (count - 2) > stream->batch_index_max)
+			{
+				stream->keepLine = TRUE;
+				break;
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				int vertex = BatchVertex(stream, &vertex_num, corners[i * 3], corners[i * 3 + 1], corners[i * 3 + 2]);
+				hasPositions = hasPositions && corners[i * 3] >= 0;
+				if (hasPositions)
+					memcpy(stream->facePositions + i * 3, stream->positions + corners[i * 3] * 3, sizeof(GLfloat) * 3);
+				corners[i * 3] = vertex; // the key is no longer needed
+			}
+
+			// the same cut TransFArr makes
+			if (count > MESH_MAX_CLIP_CORNERS)
+			{
+				for (int i = 1; i + 1 < count; i++)
+				{
+					stream->indices[index_num++] = (GLushort)corners[0];
+					stream->indices[index_num++] = (GLushort)corners[i * 3];
+					stream->indices[index_num++] = (GLushort)corners[(i + 1) * 3];
+				}
+			}
+			else
+			{
+				TriangulatePolygon(hasPositions ? stream->facePositions : NULL, count, stream->faceTris);
+				for (int i = 0; i < (count - 2) * 3; i++)
+					stream->indices[index_num++] = (GLushort)corners[stream->faceTris[i] * 3];
+			}
+		}
+	}
+
+	if (stream->error || index_num == 0)
+		return FALSE;
+
+	stream->batch_num++;
+	batch->vertex_num = vertex_num;
+	batch->index_num = index_num;
+	batch->vertices = stream->vertices;
+	batch->indices = stream->indices;
+	return TRUE;
+}
+
+void CloseObjStream(ObjStream* stream)
+{
+	if (stream->file != NULL)
+		fclose(stream->file);
+	free(stream->block);
+	free(stream->positions);
+	free(stream->texCoords);
+	free(stream->normals);
+	free(stream->vertices);
+	free(stream->indices);
+	free(stream->slots);
+	free(stream->faceCorners);
+	free(stream->facePositions);
+	free(stream->faceTris);
+	memset(stream, 0, sizeof(ObjStream));
+}
+
+int StreamObjFile(const char* filename, int attribs, size_t memoryLimit, ObjBatchFunc func, void* userData)
+{
+	ObjStream stream;
+	ObjStreamBatch batch;
+	int ok = TRUE;
+
+	if (!OpenObjStream(filename, attribs, memoryLimit, &stream))
+		return FALSE;
+
+	while (ok && NextObjBatch(&stream, &batch))
+		ok = func(userData, &stream, &batch);
+
+	ok = ok && !stream.error;
+	CloseObjStream(&stream);
+	return ok;
+}
+
+// copy size bytes of data to offset in the buffer bound to target through a mapped view
+static int CopyToBuffer(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	void* view = glMapBufferRange(target, offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	if (view == NULL)
+		return FALSE;
+	memcpy(view, data, size);
+	return glUnmapBuffer(target) == GL_TRUE;
+}
+
+// move the vertex buffer to a larger one on the GPU, the old content is kept
+static int GrowVertexBuffer(ObjStreamMesh* mesh, GLsizeiptr used, GLsizeiptr* capacity, GLsizeiptr needed)
+{
+	GLuint grown;
+	GLsizeiptr newCapacity = *capacity;
+
+	while (newCapacity < needed)
+		newCapacity += newCapacity / 2 + 1;
+
+	glGenBuffers(1, &grown);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, NULL, GL_STATIC_DRAW);
+	if (used > 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, mesh->vertexBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+	}
+	glDeleteBuffers(1, &mesh->vertexBuffer);
+	mesh->vertexBuffer = grown;
+	*capacity = newCapacity;
+	return glGetError() == GL_NO_ERROR;
+}
+
+int UploadObjStream(const char* filename, int attribs, size_t memoryLimit, ObjStreamMesh* mesh)
+{
+	ObjStream stream;
+	ObjStreamBatch batch;
+	GLsizeiptr vertexSize, vertexCapacity, vertexUsed = 0;
+	int rangeCapacity = 0;
+	int ok = TRUE;
+
+	memset(mesh, 0, sizeof(ObjStreamMesh));
+	if (!OpenObjStream(filename, attribs, memoryLimit, &stream))
+		return FALSE;
+
+	mesh->stride = stream.stride;
+	mesh->texcoord_offset = stream.texcoord_offset;
+	mesh->normal_offset = stream.normal_offset;
+	vertexSize = sizeof(GLfloat) * stream.stride;
+
+	// every index is known up front, the welded vertex count only once the last batch is in
+	glGenBuffers(1, &mesh->indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * 3 * (GLsizeiptr)stream.triangle_num, NULL, GL_STATIC_DRAW);
+
+	vertexCapacity = vertexSize * (stream.v_num > 0 ? stream.v_num : 1);
+	glGenBuffers(1, &mesh->vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity, NULL, GL_STATIC_DRAW);
+
+	while (ok && NextObjBatch(&stream, &batch))
+	{
+		GLsizeiptr bytes = vertexSize * batch.vertex_num;
+		ObjStreamRange* range;
+
+		if (vertexUsed + bytes > vertexCapacity)
+			ok = GrowVertexBuffer(mesh, vertexUsed, &vertexCapacity, vertexUsed + bytes);
+
+		if (ok && mesh->range_num == rangeCapacity)
+		{
+			ObjStreamRange* grown;
+			rangeCapacity = rangeCapacity > 0 ? rangeCapacity * 2 : 16;
+			grown = (ObjStreamRange*)realloc(mesh->ranges, sizeof(ObjStreamRange) * rangeCapacity);
+			ok = grown != NULL;
+			if (ok)
+				mesh->ranges = grown;
+		}
+		if (!ok)
+			break;
+
+		range = &mesh->ranges[mesh->range_num++];
+		range->vertex_offset = (int)vertexUsed;
+		range->index_offset = (int)(sizeof(GLushort) * mesh->index_num);
+		range->index_num = batch.index_num;
+
+		glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+		ok = CopyToBuffer(GL_ARRAY_BUFFER, vertexUsed, bytes, batch.vertices) &&
+			CopyToBuffer(GL_ELEMENT_ARRAY_BUFFER, range->index_offset, sizeof(GLushort) * batch.index_num, batch.indices);
+
+		vertexUsed += bytes;
+		mesh->vertex_num += batch.vertex_num;
+		mesh->index_num += batch.index_num;
+	}
+
+	ok = ok && !stream.error;
+	CloseObjStream(&stream);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	if (!ok)
+	{
+		printf("cannot upload %s\n", filename);
+		FreeObjStreamMesh(mesh);
+	}
+	return ok;
+}
+
+void DrawObjStreamMesh(const ObjStreamMesh* mesh, GLuint positionIndex, GLint texcoordIndex, GLint normalIndex)
+{
+	GLsizei stride = sizeof(GLfloat) * mesh->stride;
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
+	glEnableVertexAttribArray(positionIndex);
+	if (texcoordIndex >= 0 && mesh->texcoord_offset >= 0)
+		glEnableVertexAttribArray(texcoordIndex);
+	if (normalIndex >= 0 && mesh->normal_offset >= 0)
+		glEnableVertexAttribArray(normalIndex);
+
+	for (int i = 0; i < mesh->range_num; i++)
+	{
+		const ObjStreamRange* range = &mesh->ranges[i];
+		size_t first = range->vertex_offset;
+
+		glVertexAttribPointer(positionIndex, 3, GL_FLOAT, GL_FALSE, stride, (const void*)first);
+		if (texcoordIndex >= 0 && mesh->texcoord_offset >= 0)
+			glVertexAttribPointer(texcoordIndex, 2, GL_FLOAT, GL_FALSE, stride,
+				(const void*)(first + sizeof(GLfloat) * mesh->texcoord_offset));
+		if (normalIndex >= 0 && mesh->normal_offset >= 0)
+			glVertexAttribPointer(normalIndex, 3, GL_FLOAT, GL_FALSE, stride,
+				(const void*)(first + sizeof(GLfloat) * mesh->normal_offset));
+
+		glDrawElements(GL_TRIANGLES, range->index_num, GL_UNSIGNED_SHORT,
+			(const void*)(size_t)range->index_offset);
+	}
+
+	glDisableVertexAttribArray(positionIndex);
+	if (texcoordIndex >= 0 && mesh->texcoord_offset >= 0)
+		glDisableVertexAttribArray(texcoordIndex);
+	if (normalIndex >= 0 && mesh->normal_offset >= 0)
+		glDisableVertexAttribArray(normalIndex);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void FreeObjStreamMesh(ObjStreamMesh* mesh)
+{
+	if (mesh->vertexBuffer != 0)
+		glDeleteBuffers(1, &mesh->vertexBuffer);
+	if (mesh->indexBuffer != 0)
+		glDeleteBuffers(1, &mesh->indexBuffer);
+	free(mesh->ranges);
+	memset(mesh, 0, sizeof(ObjStreamMesh));
+}
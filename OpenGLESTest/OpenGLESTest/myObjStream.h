@@ -0,0 +1,135 @@
+#pragma once
+
+#ifndef MYOBJSTREAM_H
+#define MYOBJSTREAM_H
+
+#include <stdio.h>
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+#include "myMesh.h"
+
+// Streaming obj reader for models whose full load (ObjFile + MeshData + IndexedMesh) doesn't fit
+// in the memory budget. The file is read through a fixed block instead of being mapped, only the
+// v / vt / vn elements are kept, and the faces come out as batches: at most 65536 welded vertices
+// (laid out like IndexedMesh) and their 16 bit indices, triangulated like TransFArr.
+// A batch lives until the next one is read, everything the stream allocates stays under memoryLimit.
+//
+// faces may only use elements defined above them, as every exporter writes them.
+#define OBJ_STREAM_BLOCK_SIZE (256 * 1024) // also the longest line the stream can read
+
+typedef struct
+{
+	int vertex_num;
+	int index_num;
+	const GLfloat* vertices;   // stride floats per vertex
+	const GLushort* indices;   // into the vertices of this batch
+} ObjStreamBatch;
+
+// one slot of the weld table of a batch
+typedef struct
+{
+	int v, vt, vn;
+	int index;
+	unsigned int batch;        // the slot is empty unless this is the batch being built
+} ObjStreamSlot;
+
+typedef struct
+{
+	// counted before the first batch
+	int v_num;
+	int vt_num;
+	int vn_num;
+	int f_num;
+	int triangle_num;          // of the whole file, 3 * triangle_num indices come out in total
+
+	int stride;                // floats per vertex
+	int texcoord_offset;       // in floats, -1 when there are no texcoords
+	int normal_offset;         // in floats, -1 when there are no normals
+
+	int batch_vertex_max;      // what the memory limit leaves room for
+	int batch_index_max;
+	size_t memory_used;        // bytes allocated by the stream, all of them up front
+
+	int batch_num;             // batches read so far
+	int error;                 // TRUE when the stream stopped on a read error
+
+	// reader
+	FILE* file;
+	char* block;
+	size_t blockUsed;          // bytes of the file in block
+	size_t cursor;             // start of the next line in block
+	int eof;
+	const char* line;          // the last line read, kept for the next batch when it didn't fit
+	const char* lineEnd;
+	int keepLine;
+
+	// elements read so far
+	int attribs;
+	GLfloat* positions;
+	GLfloat* texCoords;
+	GLfloat* normals;
+	int vRead;
+	int vtRead;
+	int vnRead;
+
+	// batch being built
+	GLfloat* vertices;
+	GLushort* indices;
+	ObjStreamSlot* slots;
+	unsigned int slotMask;
+	int* faceCorners;          // v, vt, vn of every corner of the current face
+	GLfloat* facePositions;
+	unsigned short* faceTris;
+	int faceCornerMax;
+} ObjStream;
+
+// count the elements and faces of filename and allocate everything the stream needs, at most
+// memoryLimit bytes. attribs is a mask of MESH_ATTRIB_* like for WeldMesh.
+// Fails when the elements alone or a batch holding the largest face don't fit in the limit.
+int OpenObjStream(const char* filename, int attribs, size_t memoryLimit, ObjStream* stream);
+
+// read faces until the next batch is full, FALSE at the end of the file or on a read error
+int NextObjBatch(ObjStream* stream, ObjStreamBatch* batch);
+
+void CloseObjStream(ObjStream* stream);
+
+// return FALSE to stop the stream
+typedef int (*ObjBatchFunc)(void* userData, const ObjStream* stream, const ObjStreamBatch* batch);
+
+// every batch of filename to func, TRUE when the whole file went through
+int StreamObjFile(const char* filename, int attribs, size_t memoryLimit, ObjBatchFunc func, void* userData);
+
+// A streamed model on the GPU. Without a base vertex in GLES 3.0 every batch is its own draw call
+// with the attribute pointers moved to its first vertex.
+typedef struct
+{
+	int vertex_offset;         // bytes into vertexBuffer
+	int index_offset;          // bytes into indexBuffer
+	int index_num;
+} ObjStreamRange;
+
+typedef struct
+{
+	GLuint vertexBuffer;
+	GLuint indexBuffer;
+	int stride;
+	int texcoord_offset;
+	int normal_offset;
+	int vertex_num;
+	int index_num;
+
+	int range_num;
+	ObjStreamRange* ranges;
+} ObjStreamMesh;
+
+// stream filename into a vertex and an index buffer: every batch is copied into its glMapBufferRange
+// view as soon as it is built. The index buffer has its exact size from the start, the vertex buffer
+// grows on the GPU with glCopyBufferSubData.
+int UploadObjStream(const char* filename, int attribs, size_t memoryLimit, ObjStreamMesh* mesh);
+
+// draw every batch, texcoordIndex / normalIndex are -1 for attributes the program doesn't use
+void DrawObjStreamMesh(const ObjStreamMesh* mesh, GLuint positionIndex, GLint texcoordIndex, GLint normalIndex);
+
+void FreeObjStreamMesh(ObjStreamMesh* mesh);
+
+#endif
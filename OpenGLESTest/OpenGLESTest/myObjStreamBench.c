@@ -0,0 +1,165 @@
+// myObjStreamBench.c
+//
+//    Peak resident memory of StreamObjFile under several memory limits against the full
+//    LoadObjMesh + WeldMesh load, on a synthetic model written to the working directory first
+//    (and removed afterwards). The peak of a process never goes down, so the runs go from the
+//    smallest limit up and the full load comes last.
+//    Every run has to produce the same triangles, compared by an order independent fingerprint.
+//    Put this file in the project instead of MyObj3.c (together with myObjLoader.c, myMesh.c,
+//    myObjStream.c and myUtil.c).
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "esUtil.h"
+#include "myMesh.h"
+#include "myObjStream.h"
+#include "myBench.h"
+
+// a SYNTHETIC_GRID x SYNTHETIC_GRID vertex height field, two triangles per cell, 198 MB
+#define SYNTHETIC_GRID 1000
+#define SYNTHETIC_FILENAME "synthetic.obj"
+
+// the attributes the MyObj samples draw with
+#define STREAM_ATTRIBS MESH_ATTRIB_TEXCOORD
+
+static const int memoryLimits[] = { 21, 22, 24 }; // MB, the elements alone take 20.3 MB
+
+typedef struct
+{
+	unsigned long long fingerprint;
+	int vertex_num;
+	int index_num;
+	int stride;
+} StreamTotals;
+
+static unsigned long long TriangleHash(const GLfloat* a, const GLfloat* b, const GLfloat* c, int stride)
+{
+	const GLfloat* corners[3] = { a, b, c };
+	unsigned long long hash = 14695981039346656037ull;
+
+	for (int k = 0; k < 3; k++)
+	{
+		const unsigned char* bytes = (const unsigned char*)corners[k];
+		for (size_t i = 0; i < sizeof(GLfloat) * stride; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static int AddBatch(void* userData, const ObjStream* stream, const ObjStreamBatch* batch)
+{
+	StreamTotals* totals = (StreamTotals*)userData;
+
+	for (int i = 0; i < batch->index_num; i += 3)
+	{
+		totals->fingerprint += TriangleHash(batch->vertices + batch->indices[i] * stream->stride,
+			batch->vertices + batch->indices[i + 1] * stream->stride,
+			batch->vertices + batch->indices[i + 2] * stream->stride, stream->stride);
+	}
+	totals->vertex_num += batch->vertex_num;
+	totals->index_num += batch->index_num;
+	totals->stride = stream->stride;
+	return TRUE;
+}
+
+static unsigned long long WeldedFingerprint(const IndexedMesh* welded)
+{
+	unsigned long long sum = 0;
+
+	for (int i = 0; i < welded->index_num; i += 3)
+	{
+		GLuint corner[3];
+		for (int k = 0; k < 3; k++)
+			corner[k] = welded->index_type == GL_UNSIGNED_SHORT ?
+				((const GLushort*)welded->indices)[i + k] : ((const GLuint*)welded->indices)[i + k];
+		sum += TriangleHash(welded->vertices + corner[0] * welded->stride, welded->vertices + corner[1] * welded->stride,
+			welded->vertices + corner[2] * welded->stride, welded->stride);
+	}
+	return sum;
+}
+
+static double Megabytes(double bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+int esMain(ESContext* esContext)
+{
+	StreamTotals totals[sizeof(memoryLimits) / sizeof(memoryLimits[0])];
+	double start = BenchNow();
+	size_t baseline;
+	MeshData mesh;
+	IndexedMesh welded;
+	unsigned long long weldedFingerprint;
+	double elapsed;
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	if (!BenchWriteSyntheticObj(SYNTHETIC_FILENAME, SYNTHETIC_GRID))
+	{
+		printf("cannot write %s\n", SYNTHETIC_FILENAME);
+		remove(SYNTHETIC_FILENAME);
+		exit(1);
+	}
+	baseline = BenchPeakMemory();
+	printf("%s written in %.1f s, peak resident memory before loading %.1f MB\n",
+		SYNTHETIC_FILENAME, BenchNow() - start, Megabytes(baseline));
+
+	for (int i = 0; i < (int)(sizeof(memoryLimits) / sizeof(memoryLimits[0])); i++)
+	{
+		ObjStream stream;
+		size_t limit = (size_t)memoryLimits[i] * 1024 * 1024;
+
+		memset(&totals[i], 0, sizeof(StreamTotals));
+		start = BenchNow();
+		if (!OpenObjStream(SYNTHETIC_FILENAME, STREAM_ATTRIBS, limit, &stream))
+			continue;
+		printf("limit %3d MB: batches of %5d vertices, %.1f MB allocated by the stream\n",
+			memoryLimits[i], stream.batch_vertex_max, Megabytes(stream.memory_used));
+		CloseObjStream(&stream);
+
+		if (!StreamObjFile(SYNTHETIC_FILENAME, STREAM_ATTRIBS, limit, AddBatch, &totals[i]))
+		{
+			printf("  stream failed\n");
+			continue;
+		}
+		elapsed = BenchNow() - start;
+		printf("  %8.1f ms  %d vertices %d indices (%.1f MB for the GPU)  peak resident %.1f MB\n",
+			elapsed * 1000.0, totals[i].vertex_num, totals[i].index_num,
+			Megabytes((double)totals[i].vertex_num * sizeof(GLfloat) * totals[i].stride +
+				(double)totals[i].index_num * sizeof(GLushort)),
+			Megabytes(BenchPeakMemory()));
+	}
+
+	start = BenchNow();
+	if (!LoadObjMesh(SYNTHETIC_FILENAME, &mesh) || !WeldMesh(&mesh, STREAM_ATTRIBS, &welded))
+	{
+		printf("%s cannot be loaded\n", SYNTHETIC_FILENAME);
+		remove(SYNTHETIC_FILENAME);
+		exit(1);
+	}
+	elapsed = BenchNow() - start;
+	FreeMesh(&mesh);
+	weldedFingerprint = WeldedFingerprint(&welded);
+
+	printf("full load:     %8.1f ms  %d vertices %d indices (%.1f MB for the GPU)  peak resident %.1f MB\n",
+		elapsed * 1000.0, welded.vertex_num, welded.index_num,
+		Megabytes((double)welded.vertex_num * sizeof(GLfloat) * welded.stride + (double)welded.index_num * welded.index_size),
+		Megabytes(BenchPeakMemory()));
+
+	for (int i = 0; i < (int)(sizeof(memoryLimits) / sizeof(memoryLimits[0])); i++)
+	{
+		if (totals[i].index_num > 0)
+			printf("limit %3d MB: %s\n", memoryLimits[i],
+				totals[i].fingerprint == weldedFingerprint && totals[i].index_num == welded.index_num ?
+				"same triangles as the full load" : "TRIANGLES DIFFER");
+	}
+
+	FreeIndexedMesh(&welded);
+	remove(SYNTHETIC_FILENAME);
+
+	// nothing to render
+	exit(0);
+}
@@ -0,0 +1,324 @@
+// myProceduralBench.c
+//
+//    Texels per second of every generator of esGenTexture, on the calling thread and on a pool of
+//    one thread per processor, next to the scalar loops they replace: GenCheckImage of
+//    Chapter_9/MipMap2D and one texel at a time versions of the noises. Every generator is checked
+//    against its scalar version, and the checkerboard against GenCheckImage byte for byte.
+//    With a window esTexImageProcedural, generating into the mapped pixel unpack buffer, is timed
+//    against esGenTexture into malloc'd memory + glTexImage2D.
+//    Put this file in the project instead of MyObj3.c.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myBench.h"
+
+#define SIZE 1024
+#define VOLUME 128
+#define MIN_SECONDS 0.25
+
+// GenCheckImage of Chapter_9/MipMap2D
+static GLubyte* GenCheckImage(int width, int height, int checkSize)
+{
+	int x, y;
+	GLubyte* pixels = malloc(width * height * 3);
+
+	if (pixels == NULL)
+		return NULL;
+	for (y = 0; y < height; y++)
+		for (x = 0; x < width; x++)
+		{
+			GLubyte rColor = 0;
+			GLubyte bColor = 0;
+
+			if ((x / checkSize) % 2 == 0)
+			{
+				rColor = 255 * ((y / checkSize) % 2);
+				bColor = 255 * (1 - ((y / checkSize) % 2));
+			}
+			else
+			{
+				bColor = 255 * ((y / checkSize) % 2);
+				rColor = 255 * (1 - ((y / checkSize) % 2));
+			}
+			pixels[(y * width + x) * 3] = rColor;
+			pixels[(y * width + x) * 3 + 1] = 0;
+			pixels[(y * width + x) * 3 + 2] = bColor;
+		}
+	return pixels;
+}
+
+// the lattice of esTextureProcedural.c
+static const float gradients[16][3] =
+{
+	{ 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 }, { 1, 0, 1 }, { -1, 0, 1 }, { 1, 0, -1 }, { -1, 0, -1 },
+	{ 0, 1, 1 }, { 0, -1, 1 }, { 0, 1, -1 }, { 0, -1, -1 }, { 1, 1, 0 }, { 0, -1, 1 }, { -1, 1, 0 }, { 0, -1, -1 },
+};
+
+static unsigned int Hash(unsigned int seed, int x, int y, int z)
+{
+	unsigned int h = seed ^ ((unsigned int)x * 0x8DA6B343u) ^ ((unsigned int)y * 0xD8163841u) ^ ((unsigned int)z * 0xCB1AB31Fu);
+
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+static float Fade(float t)
+{
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+// one texel at a time, all 8 corners of the cell around it
+static float ScalarNoise(const ESProceduralTexture* texture, float u, float v, float w, int is3D)
+{
+	int ix = (int)floorf(u), iy = (int)floorf(v), iz = (int)floorf(w);
+	float f[3] = { u - ix, v - iy, w - iz };
+	float s[3] = { Fade(f[0]), Fade(f[1]), Fade(f[2]) };
+	float sum = 0.0f;
+
+	for (int c = 0; c < (is3D ? 8 : 4); c++)
+	{
+		int d[3] = { c & 1, (c >> 1) & 1, c >> 2 };
+		float weight = 1.0f;
+		unsigned int h = Hash(texture->seed, ix + d[0], iy + d[1], iz + d[2]);
+
+		for (int a = 0; a < 3; a++)
+			weight *= d[a] ? s[a] : 1.0f - s[a];
+		if (texture->type == ES_PROCEDURAL_PERLIN_NOISE)
+			sum += weight * (gradients[h & 15][0] * (f[0] - d[0]) + gradients[h & 15][1] * (f[1] - d[1]) +
+				gradients[h & 15][2] * (f[2] - d[2]));
+		else
+			sum += weight * (h >> 8) / 16777215.0f;
+	}
+	return texture->type == ES_PROCEDURAL_PERLIN_NOISE ? sum * 0.5f + 0.5f : sum;
+}
+
+// nearest jittered point of the 9 / 27 cells around
+static float ScalarCellular(const ESProceduralTexture* texture, float u, float v, float w, int is3D)
+{
+	int ix = (int)floorf(u), iy = (int)floorf(v), iz = (int)floorf(w);
+	float nearest = 1e30f;
+
+	for (int dz = is3D ? -1 : 0; dz <= (is3D ? 1 : 0); dz++)
+		for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				unsigned int h = Hash(texture->seed, ix + dx, iy + dy, iz + dz);
+				float ex = u - (ix + dx + (h & 1023) / 1024.0f);
+				float ey = v - (iy + dy + ((h >> 10) & 1023) / 1024.0f);
+				float ez = is3D ? w - (iz + dz + ((h >> 20) & 1023) / 1024.0f) : 0.0f;
+
+				if (ex * ex + ey * ey + ez * ez < nearest)
+					nearest = ex * ex + ey * ey + ez * ez;
+			}
+	return sqrtf(nearest);
+}
+
+// every generator one texel at a time, single channel
+static void ScalarTexture(const ESProceduralTexture* texture, int width, int height, int depth, GLubyte* pixels)
+{
+	int is3D = depth > 1;
+
+	for (int z = 0; z < depth; z++)
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+			{
+				float u = (x + 0.5f) / texture->cellSize, v = (y + 0.5f) / texture->cellSize;
+				float w = is3D ? (z + 0.5f) / texture->cellSize : 0.0f;
+				float du = (x + 0.5f) / width - 0.5f, dv = (y + 0.5f) / height - 0.5f;
+				float dw = is3D ? (z + 0.5f) / depth - 0.5f : 0.0f;
+				float dx = cosf(texture->angle), dy = sinf(texture->angle);
+				float t;
+
+				switch (texture->type)
+				{
+				case ES_PROCEDURAL_CHECKER:
+					t = (float)(((int)floorf(u) + (int)floorf(v) + (int)floorf(w)) & 1);
+					break;
+				case ES_PROCEDURAL_LINEAR_GRADIENT:
+					t = (du * dx + dv * dy) / (fabsf(dx) + fabsf(dy)) + 0.5f;
+					break;
+				case ES_PROCEDURAL_RADIAL_GRADIENT:
+					t = 2.0f * sqrtf(du * du + dv * dv + dw * dw);
+					break;
+				case ES_PROCEDURAL_CELLULAR_NOISE:
+					t = ScalarCellular(texture, u, v, w, is3D);
+					break;
+				default:
+					t = ScalarNoise(texture, u, v, w, is3D);
+					break;
+				}
+				t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+				pixels[((size_t)z * height + y) * width + x] = (GLubyte)(t * 255.0f + 0.5f);
+			}
+}
+
+// largest difference of two single channel images
+static int MaxDifference(const GLubyte* a, const GLubyte* b, size_t count)
+{
+	int worst = 0;
+
+	for (size_t i = 0; i < count; i++)
+		if (abs(a[i] - b[i]) > worst)
+			worst = abs(a[i] - b[i]);
+	return worst;
+}
+
+// millions of texels a second of esGenTexture, repeated for at least MIN_SECONDS
+static double TimeGen(ESThreadPool* pool, const ESProceduralTexture* texture, int width, int height, int depth,
+	GLenum format, void* pixels)
+{
+	double start = BenchNow(), seconds;
+	int runs = 0;
+
+	do
+	{
+		esGenTexture(pool, texture, width, height, depth, format, pixels);
+		runs++;
+		seconds = BenchNow() - start;
+	} while (seconds < MIN_SECONDS);
+	return (double)width * height * depth * runs / seconds / 1e6;
+}
+
+// the same for the scalar versions
+static double TimeScalar(const ESProceduralTexture* texture, int width, int height, int depth, GLubyte* pixels)
+{
+	double start = BenchNow(), seconds;
+	int runs = 0;
+
+	do
+	{
+		ScalarTexture(texture, width, height, depth, pixels);
+		runs++;
+		seconds = BenchNow() - start;
+	} while (seconds < MIN_SECONDS);
+	return (double)width * height * depth * runs / seconds / 1e6;
+}
+
+// milliseconds to a complete RGBA8 texture until glFinish returns, generated into a mapped buffer or into memory
+static double TimeUpload(ESThreadPool* pool, const ESProceduralTexture* texture, int mapped)
+{
+	const int iterations = 10;
+	GLubyte* pixels = mapped ? NULL : malloc((size_t)SIZE * SIZE * 4);
+	double start = BenchNow();
+
+	for (int i = 0; i < iterations; i++)
+	{
+		GLuint texId;
+
+		glGenTextures(1, &texId);
+		glBindTexture(GL_TEXTURE_2D, texId);
+		if (mapped)
+			esTexImageProcedural(pool, GL_TEXTURE_2D, texture, SIZE, SIZE, 1, GL_RGBA);
+		else
+		{
+			esGenTexture(pool, texture, SIZE, SIZE, 1, GL_RGBA, pixels);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SIZE, SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		}
+		glFinish();
+		glDeleteTextures(1, &texId);
+	}
+	free(pixels);
+	return (BenchNow() - start) / iterations * 1000.0;
+}
+
+int esMain(ESContext* esContext)
+{
+	static const struct
+	{
+		const char* name;
+		ESProceduralTexture texture;
+	} cases[] =
+	{
+		{ "checker", { ES_PROCEDURAL_CHECKER, 8.0f, 0.0f, { 0 }, { 255 }, 0 } },
+		{ "linear gradient", { ES_PROCEDURAL_LINEAR_GRADIENT, 1.0f, 0.6f, { 0 }, { 255 }, 0 } },
+		{ "radial gradient", { ES_PROCEDURAL_RADIAL_GRADIENT, 1.0f, 0.0f, { 0 }, { 255 }, 0 } },
+		{ "value noise", { ES_PROCEDURAL_VALUE_NOISE, 16.0f, 0.0f, { 0 }, { 255 }, 7 } },
+		{ "Perlin noise", { ES_PROCEDURAL_PERLIN_NOISE, 16.0f, 0.0f, { 0 }, { 255 }, 7 } },
+		{ "cellular noise", { ES_PROCEDURAL_CELLULAR_NOISE, 16.0f, 0.0f, { 0 }, { 255 }, 7 } },
+		{ "checker cell 2.5", { ES_PROCEDURAL_CHECKER, 2.5f, 0.0f, { 0 }, { 255 }, 0 } },
+		{ "Perlin noise cell 2.5", { ES_PROCEDURAL_PERLIN_NOISE, 2.5f, 0.0f, { 0 }, { 255 }, 7 } },
+		{ "cellular noise cell 3", { ES_PROCEDURAL_CELLULAR_NOISE, 3.0f, 0.0f, { 0 }, { 255 }, 7 } },
+	};
+	static const struct
+	{
+		int width, height, depth;
+	} sizes[] = { { SIZE, SIZE, 1 }, { VOLUME, VOLUME, VOLUME }, { 333, 77, 1 } };
+	int window = esCreateWindow(esContext, "myProceduralBench", 64, 64, ES_WINDOW_RGB);
+	ESThreadPool* pool = esCreateThreadPool(0);
+	GLubyte* pixels = malloc((size_t)SIZE * SIZE * 4);
+	GLubyte* reference = malloc((size_t)SIZE * SIZE * 4);
+	int failed = 0;
+
+	printf("millions of texels a second, R8 %dx%d and %d^3, on %d threads\n", SIZE, SIZE, VOLUME,
+		esGetThreadCount(pool));
+	printf("%-22s %-10s %10s %10s %10s   %s\n", "", "", "scalar", "1 thread", "pool", "off the scalar version by");
+	{
+		ESProceduralTexture checker = { ES_PROCEDURAL_CHECKER, 8.0f, 0.0f, { 0, 0, 255 }, { 255, 0, 0 }, 0 };
+		GLubyte* check = GenCheckImage(SIZE, SIZE, 8);
+		double start = BenchNow(), seconds;
+		int runs = 0;
+
+		do
+		{
+			free(GenCheckImage(SIZE, SIZE, 8));
+			runs++;
+			seconds = BenchNow() - start;
+		} while (seconds < MIN_SECONDS);
+
+		esGenTexture(pool, &checker, SIZE, SIZE, 1, GL_RGB, pixels);
+		printf("%-22s %-10s %10.1f %10.1f %10.1f   %s\n", "GenCheckImage RGB8", "2D",
+			(double)SIZE * SIZE * runs / seconds / 1e6, TimeGen(NULL, &checker, SIZE, SIZE, 1, GL_RGB, pixels),
+			TimeGen(pool, &checker, SIZE, SIZE, 1, GL_RGB, pixels),
+			memcmp(check, pixels, (size_t)SIZE * SIZE * 3) == 0 ? "identical" : "DIFFERENT");
+		if (memcmp(check, pixels, (size_t)SIZE * SIZE * 3) != 0)
+			failed++;
+		free(check);
+	}
+
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+	{
+		for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++)
+		{
+			int width = sizes[s].width, height = sizes[s].height, depth = sizes[s].depth;
+			size_t count = (size_t)width * height * depth;
+			char size[32];
+			double scalar = TimeScalar(&cases[c].texture, width, height, depth, reference);
+			double single = TimeGen(NULL, &cases[c].texture, width, height, depth, GL_RED, pixels);
+			double parallel = TimeGen(pool, &cases[c].texture, width, height, depth, GL_RED, pixels);
+			int worst = MaxDifference(reference, pixels, count);
+
+			snprintf(size, sizeof(size), depth > 1 ? "%d^3" : "%dx%d", width, height);
+			printf("%-22s %-10s %10.1f %10.1f %10.1f   %d\n", cases[c].name, size, scalar, single, parallel, worst);
+			// the lattice cells are set up once per run of texels instead of per texel, 1 step of rounding
+			if (worst > 1)
+				failed++;
+		}
+	}
+
+	if (window)
+	{
+		ESProceduralTexture perlin = { ES_PROCEDURAL_PERLIN_NOISE, 32.0f, 0.0f, { 20, 40, 120, 255 }, { 240, 230, 200, 255 }, 1 };
+
+		// once each for the allocations of the driver
+		TimeUpload(pool, &perlin, TRUE);
+		TimeUpload(pool, &perlin, FALSE);
+
+		printf("\nmilliseconds to a complete %dx%d RGBA8 Perlin noise texture, until glFinish returns\n", SIZE, SIZE);
+		printf("%-40s %10.2f\n", "esGenTexture + glTexImage2D", TimeUpload(pool, &perlin, FALSE));
+		printf("%-40s %10.2f\n", "esTexImageProcedural", TimeUpload(pool, &perlin, TRUE));
+	}
+
+	free(reference);
+	free(pixels);
+	esDestroyThreadPool(pool);
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,294 @@
+// myQuaternionBench.c
+//
+//    Nanoseconds per call of the per-frame camera and model updates against the quaternion versions
+//    that replace them: the Rotate of myUtil.c (an ESMatrix3 from cos and sin every frame, then
+//    VecMatMultiply3) and the orbit of myRotatedCamera2.c (a 4x4 rotation and translation product
+//    every frame) against a quaternion and a dual quaternion made once, esRotate against
+//    esRotateQuaternion, and composing or interpolating rotations as matrices against quaternions.
+//    Every result is checked against the matrix version, and the MyObj orbit is run for a minute
+//    of frames both ways to see how far the eye drifts apart.
+//    Put this file in the project instead of MyObj3.c.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myUtil.h"
+#include "myBench.h"
+
+#define COUNT 1024
+#define MIN_SECONDS 0.25
+#define TOLERANCE 1e-5f
+
+// the orbit of MyObj3 and of myRotatedCamera2.c, in degrees a frame
+#define ORBIT_ANGLE 0.3f
+#define ORBIT2_ANGLE 3.0f
+#define ORBIT_FRAMES 3600
+
+// myUtil.c Rotate as it was
+static void RefRotate(GLfloat* eye, GLfloat angle)
+{
+	ESMatrix3 mat3;
+
+	mat3.m[0][0] = cos(angle * PI / 180.0f);
+	mat3.m[0][1] = 0.0f;
+	mat3.m[0][2] = -sin(angle * PI / 180.0f);
+	mat3.m[1][0] = 0.0f;
+	mat3.m[1][1] = 1.0f;
+	mat3.m[1][2] = 0.0f;
+	mat3.m[2][0] = sin(angle * PI / 180.0f);
+	mat3.m[2][1] = 0.0f;
+	mat3.m[2][2] = cos(angle * PI / 180.0f);
+	VecMatMultiply3(eye, mat3);
+}
+
+// myRotatedCamera2.c Rotate as it was: the rotation as a 4x4, times a translation, times ( x, y, z, 1 )
+static void RefOrbit(GLfloat* eye, GLfloat angle)
+{
+	ESMatrix mat4, translate;
+	GLfloat vec4[4] = { eye[0], eye[1], eye[2], 1.0f };
+
+	esMatrixLoadIdentity(&mat4);
+	mat4.m[0][0] = cos(angle * PI / 180.0f);
+	mat4.m[0][2] = -sin(angle * PI / 180.0f);
+	mat4.m[2][0] = sin(angle * PI / 180.0f);
+	mat4.m[2][2] = cos(angle * PI / 180.0f);
+	esMatrixLoadIdentity(&translate);
+	esTranslate(&translate, 0.0f, 0.0f, -5.0f);
+	esMatrixMultiply(&mat4, &translate, &mat4);
+	for (int j = 0; j < 3; j++)
+		eye[j] = vec4[0] * mat4.m[0][j] + vec4[1] * mat4.m[1][j] + vec4[2] * mat4.m[2][j] + vec4[3] * mat4.m[3][j];
+}
+
+// inputs of every call: a matrix, two rotations about one axis as angles and as quaternions
+typedef struct
+{
+	ESMatrix a[COUNT];
+	GLfloat p[COUNT][6];
+	ESQuaternion q[COUNT];
+	ESQuaternion q2[COUNT];
+	ESMatrix rotation[COUNT];
+	ESMatrix rotation2[COUNT];
+
+	// the orbit of myRotatedCamera2.c, made once
+	ESDualQuaternion orbit;
+} Inputs;
+
+typedef void (*FrameOp)(ESMatrix* out, const Inputs* in, int i);
+
+// the eye in the first row, the direction it looks at in the second
+static void OldOrbit(ESMatrix* out, const Inputs* in, int i)
+{
+	static const GLfloat target[3] = { 0.0f, 0.0f, 0.0f };
+
+	memset(out, 0, sizeof(ESMatrix));
+	memcpy(out->m[0], in->p[i], sizeof(GLfloat) * 3);
+	RefRotate(out->m[0], ORBIT_ANGLE);
+	Redirection(out->m[1], target, out->m[0]);
+}
+
+static void NewOrbit(ESMatrix* out, const Inputs* in, int i)
+{
+	static const GLfloat target[3] = { 0.0f, 0.0f, 0.0f };
+
+	memset(out, 0, sizeof(ESMatrix));
+	memcpy(out->m[0], in->p[i], sizeof(GLfloat) * 3);
+	Rotate(out->m[0], ORBIT_ANGLE);
+	Redirection(out->m[1], target, out->m[0]);
+}
+
+static void OldOrbit2(ESMatrix* out, const Inputs* in, int i)
+{
+	memset(out, 0, sizeof(ESMatrix));
+	memcpy(out->m[0], in->p[i], sizeof(GLfloat) * 3);
+	RefOrbit(out->m[0], ORBIT2_ANGLE);
+}
+
+static void NewOrbit2(ESMatrix* out, const Inputs* in, int i)
+{
+	memset(out, 0, sizeof(ESMatrix));
+	esDualQuaternionTransformPoint(out->m[0], &in->orbit, in->p[i]);
+}
+
+static void OldRotate(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	esRotate(out, in->p[i][3], in->p[i][0], in->p[i][1], in->p[i][2]);
+}
+
+static void NewRotate(ESMatrix* out, const Inputs* in, int i)
+{
+	*out = in->a[i];
+	esRotateQuaternion(out, &in->q[i]);
+}
+
+static void OldCompose(ESMatrix* out, const Inputs* in, int i)
+{
+	esMatrixMultiply(out, (ESMatrix*)&in->rotation[i], (ESMatrix*)&in->rotation2[i]);
+}
+
+static void NewCompose(ESMatrix* out, const Inputs* in, int i)
+{
+	ESQuaternion q;
+
+	esQuaternionMultiply(&q, &in->q[i], &in->q2[i]);
+	esQuaternionToMatrix(out, &q);
+}
+
+// a third of the way from the first rotation to the second, both about the same axis
+static void OldInterpolate(ESMatrix* out, const Inputs* in, int i)
+{
+	const GLfloat* p = in->p[i];
+
+	esMatrixLoadIdentity(out);
+	esRotate(out, p[3] + (p[4] - p[3]) / 3.0f, p[0], p[1], p[2]);
+}
+
+static void NewInterpolate(ESMatrix* out, const Inputs* in, int i)
+{
+	ESQuaternion q;
+
+	esQuaternionSlerp(&q, &in->q[i], &in->q2[i], 1.0f / 3.0f);
+	esQuaternionToMatrix(out, &q);
+}
+
+static float Random(unsigned int* state, float low, float high)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return low + (high - low) * (float)(*state >> 8) / 16777216.0f;
+}
+
+static void MakeInputs(Inputs* in)
+{
+	ESQuaternion identity = { 0.0f, 0.0f, 0.0f, 1.0f };
+	ESQuaternion rotation;
+	ESDualQuaternion translate, rotate;
+	unsigned int state = 12345;
+
+	for (int i = 0; i < COUNT; i++)
+	{
+		GLfloat* p = in->p[i];
+
+		// an axis (also the eye of the orbits), two angles less than half a turn apart
+		for (int k = 0; k < 3; k++)
+			p[k] = Random(&state, -20.0f, 20.0f);
+		p[3] = Random(&state, -180.0f, 180.0f);
+		p[4] = p[3] + Random(&state, -170.0f, 170.0f);
+		esQuaternionFromAxisAngle(&in->q[i], p[3], p[0], p[1], p[2]);
+		esQuaternionFromAxisAngle(&in->q2[i], p[4], p[0], p[1], p[2]);
+		esMatrixLoadIdentity(&in->rotation[i]);
+		esRotate(&in->rotation[i], p[3], p[0], p[1], p[2]);
+		esMatrixLoadIdentity(&in->rotation2[i]);
+		esRotate(&in->rotation2[i], p[4], p[0], p[1], p[2]);
+
+		esMatrixLoadIdentity(&in->a[i]);
+		esTranslate(&in->a[i], p[2], p[1], p[0]);
+		esScale(&in->a[i], Random(&state, 0.1f, 4.0f), Random(&state, 0.1f, 4.0f), Random(&state, 0.1f, 4.0f));
+	}
+
+	// as SetOrbit of myRotatedCamera2.c
+	esQuaternionFromAxisAngle(&rotation, ORBIT2_ANGLE, 0.0f, -1.0f, 0.0f);
+	esDualQuaternionFromRotationTranslation(&translate, &identity, 0.0f, 0.0f, -5.0f);
+	esDualQuaternionFromRotationTranslation(&rotate, &rotation, 0.0f, 0.0f, 0.0f);
+	esDualQuaternionMultiply(&in->orbit, &translate, &rotate);
+}
+
+// average nanoseconds of one call, repeated over all the inputs for at least MIN_SECONDS
+static double TimeOp(FrameOp op, const Inputs* in, ESMatrix* out)
+{
+	double start = BenchNow(), seconds;
+	int runs = 0;
+
+	do
+	{
+		for (int i = 0; i < COUNT; i++)
+			op(&out[i], in, i);
+		runs++;
+		seconds = BenchNow() - start;
+	} while (seconds < MIN_SECONDS);
+	return seconds / ((double)runs * COUNT) * 1e9;
+}
+
+// largest difference between two sets of results, relative to the size of the expected one
+static float MaxError(const ESMatrix* expected, const ESMatrix* actual, int* differ)
+{
+	float error = 0.0f;
+
+	*differ = 0;
+	for (int i = 0; i < COUNT; i++)
+	{
+		for (int k = 0; k < 16; k++)
+		{
+			float e = expected[i].m[k / 4][k % 4], a = actual[i].m[k / 4][k % 4];
+			float d = fabsf(e - a) / (fabsf(e) > 1.0f ? fabsf(e) : 1.0f);
+
+			*differ += e != a;
+			error = d > error ? d : error;
+		}
+	}
+	return error;
+}
+
+int esMain(ESContext* esContext)
+{
+	static const struct
+	{
+		const char* name;
+		FrameOp reference;
+		FrameOp op;
+	} cases[] =
+	{
+		{ "MyObj Rotate orbit", OldOrbit, NewOrbit },
+		{ "myRotatedCamera2 orbit", OldOrbit2, NewOrbit2 },
+		{ "esRotateQuaternion", OldRotate, NewRotate },
+		{ "compose, to a matrix", OldCompose, NewCompose },
+		{ "interpolate, to a matrix", OldInterpolate, NewInterpolate },
+	};
+	Inputs* in = malloc(sizeof(Inputs));
+	ESMatrix* expected = malloc(sizeof(ESMatrix) * COUNT);
+	ESMatrix* actual = malloc(sizeof(ESMatrix) * COUNT);
+	GLfloat oldEye[3] = { 0.0f, 10.0f, 50.0f };
+	GLfloat newEye[3] = { 0.0f, 10.0f, 50.0f };
+	float drift = 0.0f;
+	int failed = 0;
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	MakeInputs(in);
+	printf("nanoseconds a call over %d inputs\n", COUNT);
+	printf("%-24s %10s %12s %8s   %s\n", "", "matrices", "quaternions", "speedup", "off the matrix version by");
+	for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++)
+	{
+		double before = TimeOp(cases[c].reference, in, expected);
+		double after = TimeOp(cases[c].op, in, actual);
+		int differ;
+		float error = MaxError(expected, actual, &differ);
+
+		if (differ == 0)
+			printf("%-24s %10.2f %12.2f %7.1fx   identical\n", cases[c].name, before, after, before / after);
+		else
+			printf("%-24s %10.2f %12.2f %7.1fx   %g in %d values%s\n", cases[c].name, before, after, before / after,
+				error, differ, error > TOLERANCE ? " FAILED" : "");
+		failed += error > TOLERANCE;
+	}
+
+	// both orbits accumulate rounding, frame after frame
+	for (int frame = 0; frame < ORBIT_FRAMES; frame++)
+	{
+		RefRotate(oldEye, ORBIT_ANGLE);
+		Rotate(newEye, ORBIT_ANGLE);
+	}
+	for (int k = 0; k < 3; k++)
+		drift = fmaxf(drift, fabsf(oldEye[k] - newEye[k]));
+	printf("\nafter %d frames of the MyObj orbit at a distance of %.1f the eyes are %g apart\n", ORBIT_FRAMES,
+		sqrtf(oldEye[0] * oldEye[0] + oldEye[1] * oldEye[1] + oldEye[2] * oldEye[2]), drift);
+
+	free(in);
+	free(expected);
+	free(actual);
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
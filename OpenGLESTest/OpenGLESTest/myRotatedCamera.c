@@ -77,6 +77,10 @@ struct
 	GLfloat  aspect;
 	ESMatrix viewMat;
 	ESMatrix projMat;
+
+	// the orbit of one frame and the angle it was made for
+	ESQuaternion orbit;
+	GLfloat  orbitAngle;
 } CameraData;
 
 GLfloat* subVector(GLfloat* v1, GLfloat* v2)
@@ -199,32 +203,15 @@ ESMatrix setCamera(GLfloat* eye, GLfloat* target, GLfloat* up)
 }
 
 
-void VecMatMultiply(GLfloat* vec3, const ESMatrix3 mat3)
-{
-	GLfloat vecNew[3];
-	vecNew[0] = mat3.m[0][0] * vec3[0] + mat3.m[0][1] * vec3[1] + mat3.m[0][2] * vec3[2];
-	vecNew[1] = mat3.m[1][0] * vec3[0] + mat3.m[1][1] * vec3[1] + mat3.m[1][2] * vec3[2];
-	vecNew[2] = mat3.m[2][0] * vec3[0] + mat3.m[2][1] * vec3[1] + mat3.m[2][2] * vec3[2];
-	vec3[0] = vecNew[0];
-	vec3[1] = vecNew[1];
-	vec3[2] = vecNew[2];
-}
-
+// rotate eye along y axis, sin and cos are only taken when angle changes
 void Rotate(GLfloat* eye, GLfloat* target, GLfloat* up, GLfloat angle)
 {
-	// rotate along y axis mat
-	ESMatrix3 mat3;
-	mat3.m[0][0] = cos(angle * PI / 180.0f);
-	mat3.m[0][1] = 0.0f;
-	mat3.m[0][2] = -sin(angle * PI / 180.0f);
-	mat3.m[1][0] = 0.0f;
-	mat3.m[1][1] = 1.0f;
-	mat3.m[1][2] = 0.0f;
-	mat3.m[2][0] = sin(angle * PI / 180.0f);
-	mat3.m[2][1] = 0.0f;
-	mat3.m[2][2] = cos(angle * PI / 180.0f);
-
-	VecMatMultiply(eye, mat3);
+	if (angle != CameraData.orbitAngle)
+	{
+		esQuaternionFromAxisAngle(&CameraData.orbit, angle, 0.0f, 1.0f, 0.0f);
+		CameraData.orbitAngle = angle;
+	}
+	esQuaternionRotateVector(eye, &CameraData.orbit, eye);
 }
 
 void Redirection(GLfloat* target, const GLfloat* eye)
@@ -421,6 +408,8 @@ int Init(ESContext* esContext)
 	CameraData.target[0] = 0.0f;
 	CameraData.target[1] = 0.0f;
 	CameraData.target[2] = -5.0f;
+	esQuaternionFromAxisAngle(&CameraData.orbit, 0.0f, 0.0f, 1.0f, 0.0f);
+	CameraData.orbitAngle = 0.0f;
 
 
 	glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
@@ -69,13 +69,20 @@ typedef struct
 
 struct
 {
-	
-
+	GLfloat* eye;
+	GLfloat* target;
+	GLfloat* lookAt;
+	GLfloat* up;
+	GLfloat  fov;
 	GLfloat  aspect;
 	ESMatrix viewMat;
 	ESMatrix projMat;
 
 	int count;
+
+	// the move of eye in one frame and the angle it was made for
+	ESDualQuaternion orbit;
+	GLfloat  orbitAngle;
 } CameraData;
 
 GLfloat* subVector(GLfloat* v1, GLfloat* v2)
@@ -184,17 +191,20 @@ void VecMatMultiply4(GLfloat* vec4, const ESMatrix mat4)
 	vec4[3] = vecNew[3];
 }
 
-void VecMatMultiply4Another(GLfloat* vec4, const ESMatrix mat4)
+// translate eye along z, then rotate it along y axis.  The rigid transform is kept as a dual
+// quaternion and only made again, with sin and cos, when angle changes.
+void SetOrbit(GLfloat angle)
 {
-	GLfloat vecNew[4];
-	vecNew[0] = vec4[0] * mat4.m[0][0] + vec4[1] * mat4.m[1][0] + vec4[2] * mat4.m[2][0] + vec4[3] * mat4.m[3][0];
-	vecNew[1] = vec4[0] * mat4.m[0][1] + vec4[1] * mat4.m[1][1] + vec4[2] * mat4.m[2][1] + vec4[3] * mat4.m[3][1];
-	vecNew[2] = vec4[0] * mat4.m[0][2] + vec4[1] * mat4.m[1][2] + vec4[2] * mat4.m[2][2] + vec4[3] * mat4.m[3][2];
-	vecNew[3] = vec4[0] * mat4.m[0][3] + vec4[1] * mat4.m[1][3] + vec4[2] * mat4.m[2][3] + vec4[3] * mat4.m[3][3];
-	vec4[0] = vecNew[0];
-	vec4[1] = vecNew[1];
-	vec4[2] = vecNew[2];
-	vec4[3] = vecNew[3];
+	ESQuaternion identity = { 0.0f, 0.0f, 0.0f, 1.0f };
+	ESQuaternion rotation;
+	ESDualQuaternion translate, rotate;
+
+	// the same turn as the matrix cos, 0, -sin / 0, 1, 0 / sin, 0, cos (esRotate about -y)
+	esQuaternionFromAxisAngle(&rotation, angle, 0.0f, -1.0f, 0.0f);
+	esDualQuaternionFromRotationTranslation(&translate, &identity, 0.0f, 0.0f, -5.0f);
+	esDualQuaternionFromRotationTranslation(&rotate, &rotation, 0.0f, 0.0f, 0.0f);
+	esDualQuaternionMultiply(&CameraData.orbit, &translate, &rotate);
+	CameraData.orbitAngle = angle;
 }
 
 ///
@@ -350,64 +360,20 @@ int Init(ESContext* esContext)
 	CameraData.lookAt[2] = CameraData.target[2] - CameraData.eye[2];
 
 	CameraData.count = 0;
+	SetOrbit(0.0f);
 
 
 	glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
 	return TRUE;
 }
 
-ESMatrix Mat3ToMat4(const ESMatrix3 mat3)
-{
-	ESMatrix mat4;
-	mat4.m[0][0] = mat3.m[0][0]; mat4.m[0][1] = mat3.m[0][1]; mat4.m[0][2] = mat3.m[0][2]; mat4.m[0][3] = 0.0f;
-	mat4.m[1][0] = mat3.m[1][0]; mat4.m[1][1] = mat3.m[1][1]; mat4.m[1][2] = mat3.m[1][2]; mat4.m[1][3] = 0.0f;
-	mat4.m[2][0] = mat3.m[2][0]; mat4.m[2][1] = mat3.m[2][1]; mat4.m[2][2] = mat3.m[2][2]; mat4.m[2][3] = 0.0f;
-	mat4.m[3][0] = 0.0f;		 mat4.m[3][1] = 0.0f;		  mat4.m[3][2] = 0.0f;		   mat4.m[3][3] = 1.0f;
-	return mat4;
-}
-
 void TransEye(GLfloat* eye);
 void Rotate(GLfloat* eye, GLfloat* target, GLfloat* up, GLfloat angle)
 {
 	CameraData.count++;
-	// rotate along y axis mat
-	ESMatrix3 mat3;
-	mat3.m[0][0] = cos(angle * PI / 180.0f);
-	mat3.m[0][1] = 0.0f;
-	mat3.m[0][2] = -sin(angle * PI / 180.0f);
-	mat3.m[1][0] = 0.0f;
-	mat3.m[1][1] = 1.0f;
-	mat3.m[1][2] = 0.0f;
-	mat3.m[2][0] = sin(angle * PI / 180.0f);
-	mat3.m[2][1] = 0.0f;
-	mat3.m[2][2] = cos(angle * PI / 180.0f);
-
-	ESMatrix resultMat4 = Mat3ToMat4(mat3);
-	//esMatrixLoadIdentity(&resultMat4);
-	//esRotate(&resultMat4, angle, 0, 1, 0);
-	if (CameraData.count <= 100000000)
-	{
-		ESMatrix translateMat4;
-		esMatrixLoadIdentity(&translateMat4);
-		esTranslate(&translateMat4, 0.0f, 0.0f, -5.0f);
-
-
-		//esMatrixLoadIdentity(&resultMat4);
-		esMatrixMultiply(&resultMat4, &translateMat4, &resultMat4);
-	}
-	
-
-	VecMatMultiply4Another(eye, resultMat4); 
-	/*for (int i = 0; i < 4; i++)
-	{
-		for (int j = 0; j < 4; j++)
-		{
-			printf("%f\t", resultMat4.m[i][j]);
-		}
-		printf("%s", "\n");
-	}
-	printf("%s", "---------------------------------\n\n");*/
-	
+	if (angle != CameraData.orbitAngle)
+		SetOrbit(angle);
+	esDualQuaternionTransformPoint(eye, &CameraData.orbit, eye);
 }
 
 void Redirection(GLfloat* lookAt, const GLfloat* target, const GLfloat* eye)
@@ -636,8 +602,7 @@ int esMain(ESContext* esContext)
 {
 	esContext->userData = malloc(sizeof(UserData));
 
-	esCreateWindow(esContext, "Hello Triangle", 960, 640, ES_WINDOW_RGB | ES_WINDOW_ALPHA | ES_WINDOW_
-	);
+	esCreateWindow(esContext, "Hello Triangle", 960, 640, ES_WINDOW_RGB | ES_WINDOW_ALPHA | ES_WINDOW_DEPTH);
 
 	if (!Init(esContext))
 	{
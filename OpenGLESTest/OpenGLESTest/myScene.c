@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <string.h>
+#include "myScene.h"
+
+// streams of a scene and the sort scratch, each of them 16 byte aligned in the arena
+#define SCENE_STREAMS 9
+
+int CreateScene(Scene* ret, int node_max)
+{
+	size_t size = (sizeof(int) * 6 + sizeof(ESMatrix) * 3 + sizeof(unsigned int) + 1) * (size_t)node_max +
+		sizeof(int) + 16 * SCENE_STREAMS;
+
+	memset(ret, 0, sizeof(Scene));
+	if (node_max <= 0 || !ArenaInit(&ret->arena, size))
+	{
+		return FALSE;
+	}
+
+	ret->node_max = node_max;
+	ret->parent = ArenaAlloc(&ret->arena, sizeof(int) * node_max);
+	ret->depth = ArenaAlloc(&ret->arena, sizeof(int) * node_max);
+	ret->handle = ArenaAlloc(&ret->arena, sizeof(int) * node_max);
+	ret->local = ArenaAlloc(&ret->arena, sizeof(ESMatrix) * node_max);
+	ret->world = ArenaAlloc(&ret->arena, sizeof(ESMatrix) * node_max);
+	ret->version = ArenaAlloc(&ret->arena, sizeof(unsigned int) * node_max);
+	ret->dirty = ArenaAlloc(&ret->arena, node_max);
+	ret->position = ArenaAlloc(&ret->arena, sizeof(int) * node_max);
+
+	// a matrix and two ints a node, and one more int for the depth counts
+	ret->scratch = ArenaAlloc(&ret->arena, sizeof(ESMatrix) * node_max + sizeof(int) * (2 * node_max + 1));
+	if (ret->scratch == NULL)
+	{
+		FreeScene(ret);
+		return FALSE;
+	}
+
+	ret->sorted = TRUE;
+	return TRUE;
+}
+
+void FreeScene(Scene* scene)
+{
+	ArenaFree(&scene->arena);
+	memset(scene, 0, sizeof(Scene));
+}
+
+static void FlagNode(Scene* scene, int position)
+{
+	if (scene->dirty[position])
+	{
+		return;
+	}
+	scene->dirty[position] = 1;
+	if (scene->dirty_num++ == 0 || position < scene->first_dirty)
+	{
+		scene->first_dirty = position;
+	}
+}
+
+int AddSceneNode(Scene* scene, int parent, const ESMatrix* local)
+{
+	int position = scene->node_num;
+
+	if (position == scene->node_max || parent < SCENE_NO_PARENT || parent >= scene->node_num)
+	{
+		return -1;
+	}
+
+	scene->parent[position] = parent == SCENE_NO_PARENT ? SCENE_NO_PARENT : scene->position[parent];
+	scene->depth[position] = parent == SCENE_NO_PARENT ? 0 : scene->depth[scene->parent[position]] + 1;
+	scene->handle[position] = position;
+	scene->position[position] = position;
+	if (local)
+		scene->local[position] = *local;
+	else
+		esMatrixLoadIdentity(&scene->local[position]);
+	esMatrixLoadIdentity(&scene->world[position]);
+	scene->version[position] = 1;
+	scene->dirty[position] = 0;
+	scene->node_num++;
+
+	if (position > 0 && scene->depth[position] < scene->depth[position - 1])
+	{
+		scene->sorted = FALSE;
+	}
+	FlagNode(scene, position);
+	return position;
+}
+
+void SetSceneNodeLocal(Scene* scene, int node, const ESMatrix* local)
+{
+	int position = scene->position[node];
+
+	scene->local[position] = *local;
+	FlagNode(scene, position);
+}
+
+ESMatrix* EditSceneNode(Scene* scene, int node)
+{
+	int position = scene->position[node];
+
+	FlagNode(scene, position);
+	return &scene->local[position];
+}
+
+const ESMatrix* GetSceneNodeWorld(const Scene* scene, int node)
+{
+	return &scene->world[scene->position[node]];
+}
+
+// move stream, size bytes a node, to the new order through scratch
+static void Reorder(void* stream, size_t size, const int* order, int n, void* scratch)
+{
+	for (int i = 0; i < n; i++)
+		memcpy((unsigned char*)scratch + size * i, (unsigned char*)stream + size * order[i], size);
+	memcpy(stream, scratch, size * n);
+}
+
+// stable counting sort of the nodes by depth, nodes of the same depth keep the order they were added in
+static void SortScene(Scene* scene)
+{
+	int n = scene->node_num;
+	ESMatrix* scratch = scene->scratch;
+	int* order = (int*)(scratch + scene->node_max);   // old position of every new one
+	int* moved = order + scene->node_max;             // new position of every old one, depth counts first
+	int depthNum = 0;
+
+	for (int i = 0; i < n; i++)
+		depthNum = scene->depth[i] + 1 > depthNum ? scene->depth[i] + 1 : depthNum;
+
+	// the depths are counted in moved, which is then filled from the front
+	memset(moved, 0, sizeof(int) * (depthNum + 1));
+	for (int i = 0; i < n; i++)
+		moved[scene->depth[i] + 1]++;
+	for (int d = 1; d <= depthNum; d++)
+		moved[d] += moved[d - 1];
+	for (int i = 0; i < n; i++)
+		order[moved[scene->depth[i]]++] = i;
+	for (int i = 0; i < n; i++)
+		moved[order[i]] = i;
+
+	for (int i = 0; i < n; i++)
+	{
+		if (scene->parent[i] != SCENE_NO_PARENT)
+			scene->parent[i] = moved[scene->parent[i]];
+	}
+	Reorder(scene->parent, sizeof(int), order, n, scratch);
+	Reorder(scene->depth, sizeof(int), order, n, scratch);
+	Reorder(scene->handle, sizeof(int), order, n, scratch);
+	Reorder(scene->local, sizeof(ESMatrix), order, n, scratch);
+	Reorder(scene->world, sizeof(ESMatrix), order, n, scratch);
+	Reorder(scene->version, sizeof(unsigned int), order, n, scratch);
+	Reorder(scene->dirty, 1, order, n, scratch);
+	for (int i = 0; i < n; i++)
+		scene->position[scene->handle[i]] = i;
+
+	for (scene->first_dirty = 0; scene->dirty_num > 0 && !scene->dirty[scene->first_dirty]; scene->first_dirty++)
+		;
+	scene->sorted = TRUE;
+}
+
+int UpdateScene(Scene* scene)
+{
+	int updated = 0;
+
+	if (!scene->sorted)
+	{
+		SortScene(scene);
+	}
+	if (scene->dirty_num == 0)
+	{
+		return 0;
+	}
+
+	// a flag still set on a parent means its world changed in this walk, the children follow it
+	for (int i = scene->first_dirty; i < scene->node_num; i++)
+	{
+		int parent = scene->parent[i];
+
+		if (!scene->dirty[i] && (parent == SCENE_NO_PARENT || !scene->dirty[parent]))
+		{
+			continue;
+		}
+		scene->dirty[i] = 1;
+		if (parent == SCENE_NO_PARENT)
+			scene->world[i] = scene->local[i];
+		else
+			esMatrixMultiplyAffine(&scene->world[i], &scene->local[i], &scene->world[parent]);
+		scene->version[i]++;
+		updated++;
+	}
+
+	memset(scene->dirty + scene->first_dirty, 0, scene->node_num - scene->first_dirty);
+	scene->dirty_num = 0;
+	scene->matrix_ops += updated;
+	return updated;
+}
+
+void InitSceneView(SceneView* view)
+{
+	memset(view, 0, sizeof(SceneView));
+	esMatrixLoadIdentity(&view->view);
+	esMatrixLoadIdentity(&view->projection);
+	esMatrixLoadIdentity(&view->view_projection);
+	view->version = 1;
+}
+
+void SetSceneViewLookAt(SceneView* view, const GLfloat* eye, const GLfloat* target, const GLfloat* up)
+{
+	GLfloat lookAt[9] = { eye[0], eye[1], eye[2], target[0], target[1], target[2], up[0], up[1], up[2] };
+
+	if (memcmp(lookAt, view->look_at, sizeof(lookAt)) != 0)
+	{
+		memcpy(view->look_at, lookAt, sizeof(lookAt));
+		view->dirty |= SCENE_VIEW_DIRTY_VIEW;
+	}
+}
+
+static void SetFrustum(SceneView* view, const GLfloat* frustum)
+{
+	if (memcmp(frustum, view->frustum, sizeof(view->frustum)) != 0)
+	{
+		memcpy(view->frustum, frustum, sizeof(view->frustum));
+		view->dirty |= SCENE_VIEW_DIRTY_PROJECTION;
+	}
+}
+
+void SetSceneViewPerspective(SceneView* view, GLfloat fovy, GLfloat aspect, GLfloat nearZ, GLfloat farZ)
+{
+	GLfloat frustum[7] = { 1.0f, fovy, aspect, nearZ, farZ, 0.0f, 0.0f };
+
+	SetFrustum(view, frustum);
+}
+
+void SetSceneViewOrtho(SceneView* view, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top,
+	GLfloat nearZ, GLfloat farZ)
+{
+	GLfloat frustum[7] = { 2.0f, left, right, bottom, top, nearZ, farZ };
+
+	SetFrustum(view, frustum);
+}
+
+int UpdateSceneView(Scene* scene, SceneView* view)
+{
+	const GLfloat* l = view->look_at;
+	const GLfloat* f = view->frustum;
+
+	if (view->dirty == 0)
+	{
+		return FALSE;
+	}
+
+	if (view->dirty & SCENE_VIEW_DIRTY_VIEW)
+	{
+		esMatrixLookAt(&view->view, l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7], l[8]);
+		scene->matrix_ops++;
+	}
+	if (view->dirty & SCENE_VIEW_DIRTY_PROJECTION)
+	{
+		esMatrixLoadIdentity(&view->projection);
+		if (f[0] == 1.0f)
+			esPerspective(&view->projection, f[1], f[2], f[3], f[4]);
+		else
+			esOrtho(&view->projection, f[1], f[2], f[3], f[4], f[5], f[6]);
+		scene->matrix_ops++;
+	}
+	esMatrixMultiplyAffine(&view->view_projection, &view->view, &view->projection);
+	scene->matrix_ops++;
+
+	view->version++;
+	view->dirty = 0;
+	return TRUE;
+}
+
+int UpdateSceneMVP(Scene* scene, int node, SceneView* view, SceneMVP* mvp)
+{
+	int position = scene->position[node];
+
+	UpdateSceneView(scene, view);
+	if (mvp->view == view && mvp->node == node && mvp->world_version == scene->version[position] &&
+		mvp->view_version == view->version)
+	{
+		return FALSE;
+	}
+
+	esMatrixMultiplyAffine(&mvp->matrix, &scene->world[position], &view->view_projection);
+	mvp->view = view;
+	mvp->node = node;
+	mvp->world_version = scene->version[position];
+	mvp->view_version = view->version;
+	scene->matrix_ops++;
+	return TRUE;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#ifndef MYSCENE_H
+#define MYSCENE_H
+
+#include <GLES3/gl3.h>
+#include "esUtil.h"
+#include "myMesh.h"
+
+// Nodes with a parent and a local matrix, their world matrix is the local one times the world of the
+// parent (ESMatrix multiplies row vectors, so the local transform applies first). Every stream is a
+// flat array in one arena, sorted by depth so a parent always comes before its children and one walk
+// from front to back brings every world matrix up to date.
+// Changing a local matrix only flags the node: UpdateScene starts at the first flagged node and
+// recomputes it and the nodes under it, a scene where nothing moved costs one test.
+// Local matrices have to be affine (esTranslate, esScale, esRotate, esRotateQuaternion), worlds are
+// made with esMatrixMultiplyAffine.
+#define SCENE_NO_PARENT -1
+
+typedef struct
+{
+	int node_num;
+	int node_max;
+
+	// by position, positions change when nodes are sorted
+	int* parent;               // position of the parent, SCENE_NO_PARENT for a root
+	int* depth;                // 0 for a root
+	int* handle;               // handle of the node at a position
+	ESMatrix* local;
+	ESMatrix* world;           // valid after UpdateScene
+	unsigned int* version;     // counts the times world was recomputed, starts at 1
+	unsigned char* dirty;      // local changed since the last UpdateScene
+
+	int* position;             // position of a handle, handles are what AddSceneNode returns
+	void* scratch;             // what SortScene moves the streams through
+
+	int sorted;                // FALSE when a node was added above the depth of the last one
+	int dirty_num;
+	int first_dirty;           // lowest position flagged
+
+	unsigned int matrix_ops;   // matrices computed, worlds, views and MVPs, for the caller to reset
+	MeshArena arena;
+} Scene;
+
+// room for node_max nodes, return TRUE on success
+int CreateScene(Scene* ret, int node_max);
+
+void FreeScene(Scene* scene);
+
+// add a node under parent (a handle or SCENE_NO_PARENT) with local, NULL for the identity.
+// Return its handle, -1 when the scene is full or parent does not exist
+int AddSceneNode(Scene* scene, int parent, const ESMatrix* local);
+
+void SetSceneNodeLocal(Scene* scene, int node, const ESMatrix* local);
+
+// the local matrix of node to change in place, the node is flagged
+ESMatrix* EditSceneNode(Scene* scene, int node);
+
+const ESMatrix* GetSceneNodeWorld(const Scene* scene, int node);
+
+// recompute the world of every flagged node and of the nodes under them, return how many
+int UpdateScene(Scene* scene);
+
+// A camera or a light: the view and projection are only rebuilt when the parameters given differ
+// from the last ones, their product when either changed.
+#define SCENE_VIEW_DIRTY_VIEW       1
+#define SCENE_VIEW_DIRTY_PROJECTION 2
+
+typedef struct
+{
+	GLfloat look_at[9];        // eye, target and up last given
+	GLfloat frustum[7];        // 1 and fovy, aspect, near, far for a perspective, 2 and the box for an ortho
+
+	ESMatrix view;
+	ESMatrix projection;
+	ESMatrix view_projection;  // view times projection, valid after UpdateSceneView
+	int dirty;                 // SCENE_VIEW_DIRTY_ flags
+	unsigned int version;      // counts the times view_projection was recomputed, starts at 1
+} SceneView;
+
+// identity view and projection
+void InitSceneView(SceneView* view);
+
+void SetSceneViewLookAt(SceneView* view, const GLfloat* eye, const GLfloat* target, const GLfloat* up);
+
+void SetSceneViewPerspective(SceneView* view, GLfloat fovy, GLfloat aspect, GLfloat nearZ, GLfloat farZ);
+
+void SetSceneViewOrtho(SceneView* view, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top,
+	GLfloat nearZ, GLfloat farZ);
+
+// rebuild what changed, counted in the matrix_ops of scene. Return TRUE when view_projection changed
+int UpdateSceneView(Scene* scene, SceneView* view);
+
+// The MVP of one node seen from one view, remembering the versions it was made from. A zeroed
+// SceneMVP is out of date.
+typedef struct
+{
+	ESMatrix matrix;           // world of the node times the view-projection
+	const SceneView* view;
+	int node;
+	unsigned int world_version;
+	unsigned int view_version;
+} SceneMVP;
+
+// bring mvp up to date for node seen from view, updating view first. UpdateScene has to have run
+// since the node last changed. Return TRUE when the matrix was recomputed
+int UpdateSceneMVP(Scene* scene, int node, SceneView* view, SceneMVP* mvp);
+
+#endif
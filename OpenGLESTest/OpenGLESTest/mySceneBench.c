@@ -0,0 +1,398 @@
+// mySceneBench.c
+//
+//    Matrices computed and microseconds per frame to bring the MVPs of a scene up to date the way
+//    the samples do it, every world, view, projection and MVP from scratch every frame, against the
+//    scene graph of myScene.c, which only recomputes what moved. The scene has 1110 nodes, 10 roots
+//    with 10 children of 10 leaves each, drawn by a camera and a light. Nothing moves, the camera
+//    orbits, one leaf moves, one root moves with everything under it, everything moves.
+//    The frame of MyObj3 is counted the same way, InitMVP and Update as they were against the scene.
+//    Every MVP is checked against the ones computed from scratch.
+//    Put this file in the project instead of MyObj3.c.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+#include "myUtil.h"
+#include "myScene.h"
+#include "myBench.h"
+
+#define FANOUT 10
+#define NODE_NUM (FANOUT + FANOUT * FANOUT + FANOUT * FANOUT * FANOUT)
+#define FRAMES 2000
+#define TOLERANCE 1e-5f
+
+enum { STATIC, CAMERA, LEAF, SUBTREE, EVERYTHING, CASE_NUM };
+
+static const char* caseNames[CASE_NUM] =
+{
+	"nothing moves", "camera orbits", "one leaf moves", "one root moves", "everything moves"
+};
+
+typedef struct
+{
+	// the scene as the samples keep it, parents before children
+	int parent[NODE_NUM];
+	ESMatrix local[NODE_NUM];
+	ESMatrix world[NODE_NUM];
+	ESMatrix mvp[2][NODE_NUM];
+	GLfloat eye[3];
+	unsigned int matrix_ops;
+
+	// the same nodes in a scene graph, 0 the camera and 1 the light
+	Scene scene;
+	int node[NODE_NUM];
+	SceneView views[2];
+	SceneMVP mvps[2][NODE_NUM];
+} Bench;
+
+static const GLfloat target[3] = { 0.0f, 0.0f, 0.0f };
+static const GLfloat up[3] = { 0.0f, 1.0f, 0.0f };
+static const GLfloat light[3] = { 6.0f, 20.0f, 5.0f };
+
+// local matrix of node i at frame, the roots spread out, the children around them, the leaves spinning
+static void MakeLocal(int i, int frame, ESMatrix* local)
+{
+	float angle = (float)(i * 37 % 360) + 0.5f * frame;
+
+	esMatrixLoadIdentity(local);
+	esTranslate(local, (float)(i % 7) - 3.0f, (float)(i % 3), (float)(i % 5) - 2.0f);
+	esRotate(local, angle, 0.0f, 1.0f, 0.2f);
+	esScale(local, 0.9f, 0.9f, 0.9f);
+}
+
+static void OrbitEye(int frame, GLfloat* eye)
+{
+	float angle = 0.003f * frame;
+
+	eye[0] = 50.0f * sinf(angle);
+	eye[1] = 10.0f;
+	eye[2] = 50.0f * cosf(angle);
+}
+
+static void MakeBench(Bench* b)
+{
+	int n = 0;
+
+	CreateScene(&b->scene, NODE_NUM);
+
+	// added depth first, the scene graph sorts them by depth on the first update
+	for (int r = 0; r < FANOUT; r++)
+	{
+		int root = n++;
+
+		b->parent[root] = SCENE_NO_PARENT;
+		for (int c = 0; c < FANOUT; c++)
+		{
+			int child = n++;
+
+			b->parent[child] = root;
+			for (int l = 0; l < FANOUT; l++)
+				b->parent[n++] = child;
+		}
+	}
+	for (int i = 0; i < NODE_NUM; i++)
+	{
+		MakeLocal(i, 0, &b->local[i]);
+		b->node[i] = AddSceneNode(&b->scene, b->parent[i] == SCENE_NO_PARENT ? SCENE_NO_PARENT : b->node[b->parent[i]],
+			&b->local[i]);
+	}
+
+	OrbitEye(0, b->eye);
+	for (int v = 0; v < 2; v++)
+		InitSceneView(&b->views[v]);
+	SetSceneViewLookAt(&b->views[0], b->eye, target, up);
+	SetSceneViewPerspective(&b->views[0], 60.0f, 4.0f / 3.0f, 1.0f, 250.0f);
+	SetSceneViewLookAt(&b->views[1], light, target, up);
+	SetSceneViewOrtho(&b->views[1], -40.0f, 40.0f, -40.0f, 40.0f, -100.0f, 100.0f);
+	memset(b->mvps, 0, sizeof(b->mvps));
+}
+
+// what changes at frame, in the arrays of the samples or in the scene graph
+static void Move(Bench* b, int kind, int frame, int graph)
+{
+	int first = 0, last = 0;
+	ESMatrix local;
+
+	if (kind == CAMERA)
+	{
+		OrbitEye(frame, b->eye);
+		if (graph)
+			SetSceneViewLookAt(&b->views[0], b->eye, target, up);
+		return;
+	}
+	if (kind == LEAF)
+		first = NODE_NUM - 1, last = NODE_NUM;
+	else if (kind == SUBTREE)
+		first = 0, last = 1;
+	else if (kind == EVERYTHING)
+		first = 0, last = NODE_NUM;
+
+	for (int i = first; i < last; i++)
+	{
+		MakeLocal(i, frame, &local);
+		if (graph)
+			SetSceneNodeLocal(&b->scene, b->node[i], &local);
+		else
+			b->local[i] = local;
+	}
+}
+
+// every matrix of the frame computed again, as InitMVP does
+static void ScratchFrame(Bench* b)
+{
+	ESMatrix view, projection, viewProjection[2];
+
+	esMatrixLookAt(&view, b->eye[0], b->eye[1], b->eye[2], target[0], target[1], target[2], up[0], up[1], up[2]);
+	esMatrixLoadIdentity(&projection);
+	esPerspective(&projection, 60.0f, 4.0f / 3.0f, 1.0f, 250.0f);
+	esMatrixMultiplyAffine(&viewProjection[0], &view, &projection);
+
+	esMatrixLookAt(&view, light[0], light[1], light[2], target[0], target[1], target[2], up[0], up[1], up[2]);
+	esMatrixLoadIdentity(&projection);
+	esOrtho(&projection, -40.0f, 40.0f, -40.0f, 40.0f, -100.0f, 100.0f);
+	esMatrixMultiplyAffine(&viewProjection[1], &view, &projection);
+	b->matrix_ops += 6;
+
+	for (int i = 0; i < NODE_NUM; i++)
+	{
+		if (b->parent[i] == SCENE_NO_PARENT)
+			b->world[i] = b->local[i];
+		else
+			esMatrixMultiplyAffine(&b->world[i], &b->local[i], &b->world[b->parent[i]]);
+	}
+	for (int v = 0; v < 2; v++)
+	{
+		for (int i = 0; i < NODE_NUM; i++)
+			esMatrixMultiplyAffine(&b->mvp[v][i], &b->world[i], &viewProjection[v]);
+	}
+	b->matrix_ops += NODE_NUM * 3;
+}
+
+static void GraphFrame(Bench* b)
+{
+	UpdateScene(&b->scene);
+	for (int v = 0; v < 2; v++)
+	{
+		for (int i = 0; i < NODE_NUM; i++)
+			UpdateSceneMVP(&b->scene, b->node[i], &b->views[v], &b->mvps[v][i]);
+	}
+}
+
+// largest difference between the MVPs, relative to the size of the expected value
+static float MaxError(const Bench* b, int* differ)
+{
+	float error = 0.0f;
+
+	*differ = 0;
+	for (int v = 0; v < 2; v++)
+	{
+		for (int i = 0; i < NODE_NUM; i++)
+		{
+			for (int k = 0; k < 16; k++)
+			{
+				float e = b->mvp[v][i].m[k / 4][k % 4], a = b->mvps[v][i].matrix.m[k / 4][k % 4];
+				float d = fabsf(e - a) / (fabsf(e) > 1.0f ? fabsf(e) : 1.0f);
+
+				*differ += e != a;
+				error = d > error ? d : error;
+			}
+		}
+	}
+	return error;
+}
+
+// The frame of MyObj3: the ground and the model, seen from the orbiting eye and from the light
+typedef struct
+{
+	GLfloat eye[3];
+	GLfloat lookAt[3];
+	ESMatrix groundMvp, groundMvpLight, mvp, mvpLight;
+	unsigned int matrix_ops;
+
+	Scene scene;
+	int groundNode, modelNode, shadowNode;
+	SceneView view, lightView;
+	SceneMVP sceneGroundMvp, sceneGroundMvpLight, sceneMvp, sceneMvpLight;
+} Obj3;
+
+static const GLfloat obj3Light[3] = { 6.0f, 0.0f, 5.0f };
+
+static void MakeObj3(Obj3* o)
+{
+	ESMatrix model;
+
+	memset(o, 0, sizeof(Obj3));
+	o->eye[1] = 2.0f;
+	o->eye[2] = 5.0f;
+
+	CreateScene(&o->scene, 3);
+	o->groundNode = AddSceneNode(&o->scene, SCENE_NO_PARENT, NULL);
+	o->modelNode = AddSceneNode(&o->scene, o->groundNode, NULL);
+	esMatrixLoadIdentity(&model);
+	esTranslate(&model, 0.0f, 0.0f, -2.0f);
+	o->shadowNode = AddSceneNode(&o->scene, o->modelNode, &model);
+
+	InitSceneView(&o->lightView);
+	SetSceneViewLookAt(&o->lightView, obj3Light, target, up);
+	SetSceneViewOrtho(&o->lightView, -20, 20, -20, 20, -60, 60);
+	InitSceneView(&o->view);
+	SetSceneViewPerspective(&o->view, 90.0f, 4.0f / 3.0f, 1.0f, 250.0f);
+}
+
+// InitMVP and Update of MyObj3 as they were
+static void OldObj3Frame(Obj3* o)
+{
+	ESMatrix perspective, ortho, modelview, model, view;
+
+	Rotate(o->eye, 0.3f);
+	Redirection(o->lookAt, target, o->eye);
+
+	esMatrixLoadIdentity(&perspective);
+	esPerspective(&perspective, 90.0f, 4.0f / 3.0f, 1.0f, 250.0f);
+	esMatrixLoadIdentity(&ortho);
+	esOrtho(&ortho, -20, 20, -20, 20, -60, 60);
+
+	esMatrixLoadIdentity(&model);
+	esTranslate(&model, 0.0f, 0.0f, -2.0f);
+	esMatrixLookAt(&view, obj3Light[0], obj3Light[1], obj3Light[2], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiply(&o->mvpLight, &modelview, &ortho);
+
+	esMatrixLoadIdentity(&model);
+	esMatrixLookAt(&view, o->eye[0], o->eye[1], o->eye[2], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiply(&o->groundMvp, &modelview, &perspective);
+	esMatrixLookAt(&view, obj3Light[0], obj3Light[1], obj3Light[2], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+	esMatrixMultiply(&modelview, &model, &view);
+	esMatrixMultiply(&o->groundMvpLight, &modelview, &ortho);
+
+	esMatrixLoadIdentity(&perspective);
+	esPerspective(&perspective, 90.0f, 4.0f / 3.0f, 1.0f, 250.0f);
+	esMatrixLookAt(&view, o->eye[0], o->eye[1], o->eye[2], o->lookAt[0], o->lookAt[1], o->lookAt[2], up[0], up[1], up[2]);
+	esMatrixMultiply(&perspective, &view, &perspective);
+	esMatrixLoadIdentity(&modelview);
+	esMatrixMultiply(&o->mvp, &modelview, &perspective);
+
+	// the products, the views and projections, the translated model
+	o->matrix_ops += 16;
+}
+
+static void NewObj3Frame(Obj3* o)
+{
+	Rotate(o->eye, 0.3f);
+	Redirection(o->lookAt, target, o->eye);
+	SetSceneViewLookAt(&o->view, o->eye, o->lookAt, up);
+	UpdateScene(&o->scene);
+
+	UpdateSceneMVP(&o->scene, o->groundNode, &o->view, &o->sceneGroundMvp);
+	UpdateSceneMVP(&o->scene, o->groundNode, &o->lightView, &o->sceneGroundMvpLight);
+	UpdateSceneMVP(&o->scene, o->shadowNode, &o->lightView, &o->sceneMvpLight);
+	UpdateSceneMVP(&o->scene, o->modelNode, &o->view, &o->sceneMvp);
+}
+
+static float Obj3Error(const Obj3* o)
+{
+	const ESMatrix* expected[4] = { &o->groundMvp, &o->groundMvpLight, &o->mvp, &o->mvpLight };
+	const ESMatrix* actual[4] = { &o->sceneGroundMvp.matrix, &o->sceneGroundMvpLight.matrix, &o->sceneMvp.matrix,
+		&o->sceneMvpLight.matrix };
+	float error = 0.0f;
+
+	for (int j = 0; j < 4; j++)
+	{
+		for (int k = 0; k < 16; k++)
+		{
+			float e = expected[j]->m[k / 4][k % 4], a = actual[j]->m[k / 4][k % 4];
+			float d = fabsf(e - a) / (fabsf(e) > 1.0f ? fabsf(e) : 1.0f);
+
+			error = d > error ? d : error;
+		}
+	}
+	return error;
+}
+
+int esMain(ESContext* esContext)
+{
+	Bench* b = malloc(sizeof(Bench));
+	Obj3* o = malloc(sizeof(Obj3));
+	int frame = 1, failed = 0;
+	double start, scratch, graph;
+	float error;
+
+	// nothing is drawn, the window is never created
+	(void)esContext;
+
+	MakeBench(b);
+	printf("%d frames of a scene of %d nodes seen by a camera and a light, a frame\n", FRAMES, NODE_NUM);
+	printf("%-18s %14s %14s %10s %10s %8s   %s\n", "", "matrices, all", "matrices, graph", "us, all", "us, graph",
+		"speedup", "off the MVPs from scratch by");
+	for (int c = 0; c < CASE_NUM; c++)
+	{
+		unsigned int scratchOps, graphOps;
+		int differ;
+
+		// both start up to date
+		ScratchFrame(b);
+		GraphFrame(b);
+		b->matrix_ops = 0;
+		b->scene.matrix_ops = 0;
+
+		start = BenchNow();
+		for (int f = 0; f < FRAMES; f++)
+		{
+			Move(b, c, frame + f, GL_FALSE);
+			ScratchFrame(b);
+		}
+		scratch = (BenchNow() - start) / FRAMES * 1e6;
+		scratchOps = b->matrix_ops;
+
+		start = BenchNow();
+		for (int f = 0; f < FRAMES; f++)
+		{
+			Move(b, c, frame + f, GL_TRUE);
+			GraphFrame(b);
+		}
+		graph = (BenchNow() - start) / FRAMES * 1e6;
+		graphOps = b->scene.matrix_ops;
+		frame += FRAMES;
+
+		error = MaxError(b, &differ);
+		if (differ == 0)
+			printf("%-18s %14.1f %14.1f %10.2f %10.2f %7.1fx   identical\n", caseNames[c], (double)scratchOps / FRAMES,
+				(double)graphOps / FRAMES, scratch, graph, scratch / graph);
+		else
+			printf("%-18s %14.1f %14.1f %10.2f %10.2f %7.1fx   %g in %d values%s\n", caseNames[c],
+				(double)scratchOps / FRAMES, (double)graphOps / FRAMES, scratch, graph, scratch / graph, error, differ,
+				error > TOLERANCE ? " FAILED" : "");
+		failed += error > TOLERANCE;
+	}
+
+	// the eye of MyObj3 orbits every frame, the light and both nodes stay where they are
+	MakeObj3(o);
+	start = BenchNow();
+	for (int f = 0; f < FRAMES; f++)
+		OldObj3Frame(o);
+	scratch = (BenchNow() - start) / FRAMES * 1e6;
+
+	memset(o->eye, 0, sizeof(o->eye));
+	o->eye[1] = 2.0f;
+	o->eye[2] = 5.0f;
+	start = BenchNow();
+	for (int f = 0; f < FRAMES; f++)
+		NewObj3Frame(o);
+	graph = (BenchNow() - start) / FRAMES * 1e6;
+
+	error = Obj3Error(o);
+	printf("%-18s %14.1f %14.1f %10.2f %10.2f %7.1fx   %g%s\n", "MyObj3", (double)o->matrix_ops / FRAMES,
+		(double)o->scene.matrix_ops / FRAMES, scratch, graph, scratch / graph, error, error > TOLERANCE ? " FAILED" : "");
+	failed += error > TOLERANCE;
+
+	FreeScene(&b->scene);
+	FreeScene(&o->scene);
+	free(b);
+	free(o);
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,265 @@
+// myTGABench.c
+//
+//    Throughput of loading the TGA textures of the samples: the fread + malloc loader esLoadTGA
+//    used to be, esLoadTGA now (a converted copy) and esMapTGA (pixels used from the mapped file),
+//    each followed by one pass over the pixels like the upload does. Every image is also written
+//    RLE compressed and stored top down, both of which have to load to the same pixels.
+//    With a window, glTexImage2D of the converted copy is timed against esTexImageTGA.
+//    Put this file in the project instead of MyObj3.c and run it in the directory of the textures.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "esUtil.h"
+#include "myBench.h"
+
+#define ITERATIONS 20
+
+static const char* textures[] = { "basemap.tga", "bear.tga", "stone.tga" };
+
+// the loader before esMapTGA: the raw pixels of an uncompressed image read into a malloc'd copy
+static unsigned char* ReadTGA(const char* fileName, int* width, int* height, int* bytesPerPixel)
+{
+	unsigned char header[18];
+	unsigned char* buffer;
+	FILE* f = fopen(fileName, "rb");
+
+	if (f == NULL)
+		return NULL;
+	if (fread(header, sizeof(header), 1, f) != 1)
+	{
+		fclose(f);
+		return NULL;
+	}
+	*width = header[12] | header[13] << 8;
+	*height = header[14] | header[15] << 8;
+	*bytesPerPixel = header[16] / 8;
+	fseek(f, sizeof(header) + header[0], SEEK_SET);
+
+	buffer = malloc((size_t)*width * *height * *bytesPerPixel);
+	if (buffer != NULL && fread(buffer, (size_t)*width * *height * *bytesPerPixel, 1, f) != 1)
+	{
+		free(buffer);
+		buffer = NULL;
+	}
+	fclose(f);
+	return buffer;
+}
+
+// stands in for the driver reading the pixels
+static unsigned int Touch(const unsigned char* pixels, size_t size)
+{
+	unsigned int sum = 0;
+	for (size_t i = 0; i < size; i += 64)
+		sum += pixels[i];
+	return sum;
+}
+
+static int SamePixels(const char* a, const char* b)
+{
+	int widthA, heightA, widthB, heightB;
+	char* pixelsA = esLoadTGA(NULL, (char*)a, &widthA, &heightA);
+	char* pixelsB = esLoadTGA(NULL, (char*)b, &widthB, &heightB);
+	int same = pixelsA != NULL && pixelsB != NULL && widthA == widthB && heightA == heightB &&
+		memcmp(pixelsA, pixelsB, (size_t)widthA * heightA * 3) == 0;
+
+	free(pixelsA);
+	free(pixelsB);
+	return same;
+}
+
+// a copy of an uncompressed 24-bit image, RLE compressed (image type 10, packets within a row)
+// or with its rows in the other order and the origin flag set
+static int WriteVariant(const char* fileName, const char* variant, int rle)
+{
+	ESImage image;
+	unsigned char header[18];
+	int pitch;
+	FILE* f;
+
+	if (!esMapTGA(NULL, fileName, &image) || image.bytesPerPixel != 3)
+	{
+		esFreeTGA(&image);
+		return FALSE;
+	}
+	f = fopen(variant, "wb");
+	if (f == NULL)
+	{
+		esFreeTGA(&image);
+		return FALSE;
+	}
+
+	memset(header, 0, sizeof(header));
+	header[2] = rle ? 10 : 2;
+	header[12] = image.width & 0xff;
+	header[13] = image.width >> 8;
+	header[14] = image.height & 0xff;
+	header[15] = image.height >> 8;
+	header[16] = 24;
+	header[17] = rle ? 0 : 1 << 5;
+	fwrite(header, sizeof(header), 1, f);
+
+	pitch = image.width * 3;
+	for (int y = 0; y < image.height; y++)
+	{
+		const unsigned char* row = image.pixels + (size_t)(rle ? y : image.height - 1 - y) * pitch;
+
+		if (!rle)
+		{
+			fwrite(row, pitch, 1, f);
+			continue;
+		}
+		for (int x = 0; x < image.width;)
+		{
+			int count = 1;
+
+			while (x + count < image.width && count < 128 && memcmp(row + (x + count) * 3, row + x * 3, 3) == 0)
+				count++;
+			if (count > 1)
+			{
+				fputc(0x80 | (count - 1), f);
+				fwrite(row + x * 3, 3, 1, f);
+			}
+			else
+			{
+				// raw up to the next pair of equal pixels
+				while (x + count < image.width && count < 128 &&
+					(x + count + 1 >= image.width || memcmp(row + (x + count) * 3, row + (x + count + 1) * 3, 3) != 0))
+					count++;
+				fputc(count - 1, f);
+				fwrite(row + x * 3, (size_t)count * 3, 1, f);
+			}
+			x += count;
+		}
+	}
+	fclose(f);
+	esFreeTGA(&image);
+	return TRUE;
+}
+
+// average seconds of one load + pass over the pixels
+static double TimeFread(const char* fileName, size_t* bytes)
+{
+	double start = BenchNow();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		int width, height, bytesPerPixel;
+		unsigned char* pixels = ReadTGA(fileName, &width, &height, &bytesPerPixel);
+		if (pixels == NULL)
+			return 0.0;
+		*bytes = (size_t)width * height * bytesPerPixel;
+		Touch(pixels, *bytes);
+		free(pixels);
+	}
+	return (BenchNow() - start) / ITERATIONS;
+}
+
+static double TimeLoad(const char* fileName)
+{
+	double start = BenchNow();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		int width, height;
+		char* pixels = esLoadTGA(NULL, (char*)fileName, &width, &height);
+		if (pixels == NULL)
+			return 0.0;
+		Touch((unsigned char*)pixels, (size_t)width * height * 3);
+		free(pixels);
+	}
+	return (BenchNow() - start) / ITERATIONS;
+}
+
+static double TimeMap(const char* fileName)
+{
+	double start = BenchNow();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		ESImage image;
+		if (!esMapTGA(NULL, fileName, &image))
+			return 0.0;
+		Touch(image.pixels, (size_t)image.width * image.height * image.bytesPerPixel);
+		esFreeTGA(&image);
+	}
+	return (BenchNow() - start) / ITERATIONS;
+}
+
+// average seconds of loading and uploading into a new texture, until the upload is done
+static double TimeUpload(const char* fileName, int mapped)
+{
+	double start = BenchNow();
+	for (int i = 0; i < ITERATIONS; i++)
+	{
+		GLuint texId;
+
+		glGenTextures(1, &texId);
+		glBindTexture(GL_TEXTURE_2D, texId);
+		if (mapped)
+		{
+			ESImage image;
+			if (!esMapTGA(NULL, fileName, &image))
+				return 0.0;
+			esTexImageTGA(GL_TEXTURE_2D, 0, &image);
+			glFinish();
+			esFreeTGA(&image);
+		}
+		else
+		{
+			int width, height;
+			char* pixels = esLoadTGA(NULL, (char*)fileName, &width, &height);
+			if (pixels == NULL)
+				return 0.0;
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+			glFinish();
+			free(pixels);
+		}
+		glDeleteTextures(1, &texId);
+	}
+	return (BenchNow() - start) / ITERATIONS;
+}
+
+int esMain(ESContext* esContext)
+{
+	int failed = 0;
+	int window = esCreateWindow(esContext, "myTGABench", 64, 64, ES_WINDOW_RGB);
+
+	printf("MB/s of pixels, average of %d loads each followed by a pass over the pixels\n", ITERATIONS);
+	printf("%-12s %10s %10s %10s %10s %10s %10s %s\n", "texture", "size", "fread", "esLoadTGA", "esMapTGA",
+		"RLE", "RLE ratio", "top down");
+	for (int t = 0; t < (int)(sizeof(textures) / sizeof(textures[0])); t++)
+	{
+		const char* rleName = "myTGABench_rle.tga";
+		const char* topDownName = "myTGABench_topdown.tga";
+		size_t bytes = 0;
+		double freadTime = TimeFread(textures[t], &bytes);
+
+		if (freadTime == 0.0 || !WriteVariant(textures[t], rleName, TRUE) ||
+			!WriteVariant(textures[t], topDownName, FALSE))
+		{
+			printf("%s cannot be loaded\n", textures[t]);
+			failed++;
+			continue;
+		}
+
+		ESMappedFile rleFile;
+		double ratio = esMapFile(NULL, rleName, &rleFile) ? (double)rleFile.size / (bytes + 18) : 0.0;
+		esUnmapFile(&rleFile);
+
+		double mb = bytes / (1024.0 * 1024.0);
+		int same = SamePixels(textures[t], rleName) && SamePixels(textures[t], topDownName);
+		printf("%-12s %7.2f MB %10.0f %10.0f %10.0f %10.0f %9.1f%% %s\n", textures[t], mb, mb / freadTime,
+			mb / TimeLoad(textures[t]), mb / TimeMap(textures[t]), mb / TimeMap(rleName), ratio * 100.0,
+			same ? "same pixels" : "PIXELS DIFFER");
+		if (!same)
+			failed++;
+
+		if (window)
+			printf("  upload: esLoadTGA + glTexImage2D %.0f MB/s, esMapTGA + esTexImageTGA %.0f MB/s\n",
+				mb / TimeUpload(textures[t], FALSE), mb / TimeUpload(textures[t], TRUE));
+		remove(rleName);
+		remove(topDownName);
+	}
+
+	// nothing to render
+	exit(failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,159 @@
+// myTextureStreamBench.c
+//
+//    Time to first frame and to the last texture with LoadTexture in Init against esStreamTexture,
+//    for the textures of the samples (stone.tga alone is 3 MB). Every frame draws each texture on a
+//    quad and waits for the GPU, the longest frame after the first shows what the uploads of the
+//    stream cost the frames it is spread over.
+//    Put this file in the project instead of MyObj3.c (together with myUtil.c) and run it in the
+//    directory of the textures.
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include "esUtil.h"
+#include "myUtil.h"
+#include "myBench.h"
+
+#define RUNS 5
+#define MAX_FRAMES 1000
+
+// 1 MB per frame, the budget of the samples
+#define FRAME_BUDGET (1 << 20)
+
+static const char* textures[] = { "bear.tga", "basemap.tga", "stone.tga" };
+#define TEXTURE_NUM (int)(sizeof(textures) / sizeof(textures[0]))
+
+typedef struct
+{
+	double firstFrame;     // seconds from the start of Init to the end of the first frame
+	double allLoaded;      // to the end of the first frame with every texture
+	double longestFrame;   // longest frame after the first
+	int frames;
+} StartupTimes;
+
+static GLuint program;
+
+static void DrawFrame(ESContext* esContext, const GLuint* textureIds)
+{
+	glViewport(0, 0, esContext->width, esContext->height);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glUseProgram(program);
+	for (int t = 0; t < TEXTURE_NUM; t++)
+	{
+		glBindTexture(GL_TEXTURE_2D, textureIds[t]);
+		glVertexAttrib1f(0, -1.0f + 2.0f * t / TEXTURE_NUM);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+	eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);
+	glFinish();
+}
+
+static StartupTimes RunLoadTexture(ESContext* esContext)
+{
+	StartupTimes times = { 0.0, 0.0, 0.0, 1 };
+	GLuint textureIds[TEXTURE_NUM];
+	double start = BenchNow();
+
+	for (int t = 0; t < TEXTURE_NUM; t++)
+		textureIds[t] = LoadTexture(esContext->platformData, (char*)textures[t]);
+	DrawFrame(esContext, textureIds);
+
+	times.firstFrame = times.allLoaded = BenchNow() - start;
+	glDeleteTextures(TEXTURE_NUM, textureIds);
+	return times;
+}
+
+static StartupTimes RunStream(ESContext* esContext)
+{
+	StartupTimes times = { 0.0, 0.0, 0.0, 0 };
+	GLuint textureIds[TEXTURE_NUM];
+	int handles[TEXTURE_NUM];
+	double start = BenchNow();
+	ESTextureStream* stream = esCreateTextureStream(esContext->platformData, 4, FRAME_BUDGET);
+
+	if (stream == NULL)
+		return times;
+	for (int t = 0; t < TEXTURE_NUM; t++)
+		handles[t] = esStreamTexture(stream, textures[t]);
+
+	for (int pending = 1; pending > 0 && times.frames < MAX_FRAMES; times.frames++)
+	{
+		double frameStart = BenchNow();
+
+		pending = esUpdateTextureStream(stream);
+		for (int t = 0; t < TEXTURE_NUM; t++)
+			textureIds[t] = esGetStreamTexture(stream, handles[t]);
+		DrawFrame(esContext, textureIds);
+
+		double now = BenchNow();
+		if (times.frames == 0)
+			times.firstFrame = now - start;
+		else if (now - frameStart > times.longestFrame)
+			times.longestFrame = now - frameStart;
+		times.allLoaded = now - start;
+	}
+
+	esDestroyTextureStream(stream);
+	return times;
+}
+
+static void Print(const char* name, StartupTimes (*run)(ESContext*), ESContext* esContext)
+{
+	StartupTimes sum = { 0.0, 0.0, 0.0, 0 };
+
+	for (int r = 0; r < RUNS; r++)
+	{
+		StartupTimes times = run(esContext);
+		sum.firstFrame += times.firstFrame;
+		sum.allLoaded += times.allLoaded;
+		sum.longestFrame += times.longestFrame;
+		sum.frames += times.frames;
+	}
+	printf("%-16s %14.2f %14.2f %14.2f %8.1f\n", name, sum.firstFrame / RUNS * 1000.0,
+		sum.allLoaded / RUNS * 1000.0, sum.longestFrame / RUNS * 1000.0, (double)sum.frames / RUNS);
+}
+
+int esMain(ESContext* esContext)
+{
+	const char vShaderStr[] =
+		"#version 300 es                                           \n"
+		"layout(location = 0) in float a_left;                     \n"
+		"out vec2 v_texCoord;                                      \n"
+		"void main()                                               \n"
+		"{                                                         \n"
+		"   v_texCoord = vec2(gl_VertexID & 1, gl_VertexID >> 1);  \n"
+		"   gl_Position = vec4(a_left + v_texCoord.x * 0.6,        \n"
+		"                      v_texCoord.y * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}                                                         \n";
+	const char fShaderStr[] =
+		"#version 300 es                                           \n"
+		"precision mediump float;                                  \n"
+		"in vec2 v_texCoord;                                       \n"
+		"uniform sampler2D s_texture;                              \n"
+		"layout(location = 0) out vec4 outColor;                   \n"
+		"void main()                                               \n"
+		"{                                                         \n"
+		"   outColor = texture(s_texture, v_texCoord);             \n"
+		"}                                                         \n";
+
+	if (!esCreateWindow(esContext, "myTextureStreamBench", 640, 480, ES_WINDOW_RGB))
+	{
+		printf("no window to render to\n");
+		exit(1);
+	}
+	program = esLoadProgram(vShaderStr, fShaderStr);
+
+	// once each to have the files in the page cache and the shader compiled for every texture format
+	RunLoadTexture(esContext);
+	RunStream(esContext);
+
+	printf("milliseconds from the start of Init, average of %d runs, %d bytes uploaded per frame at most\n",
+		RUNS, FRAME_BUDGET);
+	printf("%-16s %14s %14s %14s %8s\n", "loader", "first frame", "all textures", "longest frame", "frames");
+	Print("LoadTexture", RunLoadTexture, esContext);
+	Print("esStreamTexture", RunStream, esContext);
+
+	glDeleteProgram(program);
+
+	// nothing to render
+	exit(0);
+}
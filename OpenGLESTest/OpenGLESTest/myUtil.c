@@ -18,22 +18,21 @@ void VecMatMultiply3(GLfloat* vec3, const ESMatrix3 mat3)
 	vec3[2] = vecNew[2];
 }
 
-// rotate along y axis, and change the position of eye ([x, y, z])
+// rotate along y axis, and change the position of eye ([x, y, z]).
+// The samples orbit by the same angle every frame, the quaternion of the last angle is kept
+// so that sin and cos are only taken when it changes.
 void Rotate(GLfloat* eye, GLfloat angle)
 {
-	// rotate along y axis mat
-	ESMatrix3 mat3;
-	mat3.m[0][0] = cos(angle * PI / 180.0f);
-	mat3.m[0][1] = 0.0f;
-	mat3.m[0][2] = -sin(angle * PI / 180.0f);
-	mat3.m[1][0] = 0.0f;
-	mat3.m[1][1] = 1.0f;
-	mat3.m[1][2] = 0.0f;
-	mat3.m[2][0] = sin(angle * PI / 180.0f);
-	mat3.m[2][1] = 0.0f;
-	mat3.m[2][2] = cos(angle * PI / 180.0f);
-
-	VecMatMultiply3(eye, mat3);
+	static GLfloat lastAngle = 0.0f;
+	static ESQuaternion rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	if (angle != lastAngle)
+	{
+		// the same turn as the matrix cos, 0, -sin / 0, 1, 0 / sin, 0, cos (esRotate about -y)
+		esQuaternionFromAxisAngle(&rotation, angle, 0.0f, -1.0f, 0.0f);
+		lastAngle = angle;
+	}
+	esQuaternionRotateVector(eye, &rotation, eye);
 }
 
 // any time the position of eye changes, the direction (lookAt) needs to be changed also
@@ -53,32 +52,35 @@ void Redirection(GLfloat* lookAt, const GLfloat* target, const GLfloat* eye)
 
 // in a obj file, if a face part is like this:
 // f 5/11/23 1/10/22 3/12/24 7/9/21
-// which is more than three vertex. In this case, it represents two faces instead of one.
+// which is more than three vertex. In this case, it represents two faces instead of one,
+// a face of n vertices represents n - 2 of them.
 // this method is for getting a correct number of face.
 int updatedFaceNum(const int* face_counts, const int f_num)
 {
-	int updatedFaceNum = f_num;
+	int updatedFaceNum = 0;
 	for (int i = 0; i < f_num; i++)
 	{
-		if (face_counts[i] == 4)
-			updatedFaceNum++;
+		// a polygon of n corners is cut into n - 2 triangles, points and lines draw nothing
+		if (face_counts[i] >= 3)
+			updatedFaceNum += face_counts[i] - 2;
 	}
 	return updatedFaceNum;
 }
 
-// assign value to ret (a,b,c) based on vArr, representing the very middle and bottom position of 
-// the model in order to draw a floor
-void GetMidBotPosition(const GLfloat** vArr, const int length, GLfloat* ret)
+// assign value to ret (a,b,c) based on positions [x0, y0, z0, x1, y1, z1...], representing the very
+// middle and bottom position of the model in order to draw a floor
+void GetMidBotPosition(const GLfloat* positions, const int length, GLfloat* ret)
 {
 	GLfloat x = 0;
 	GLfloat y = 0;
 	GLfloat z = 0;
 
-	for (int i = 0; i < length; i++)
+	for (int i = 0; i < length; i++, positions += 3)
 	{
-		x += vArr[i][0];
-		y = min(y, vArr[i][1]);
-		z += vArr[i][2];
+		x += positions[0];
+		if (positions[1] < y)
+			y = positions[1];
+		z += positions[2];
 	}
 
 	ret[0] = x / length;
@@ -86,35 +88,52 @@ void GetMidBotPosition(const GLfloat** vArr, const int length, GLfloat* ret)
 	ret[2] = z / length;
 }
 
+static ESTextureCache* textureCache = NULL;
+
 ///
 // Load texture from disk
 //
 GLuint LoadTexture(void* ioContext, char* fileName)
 {
-	int width,
-		height;
-
-	char* buffer = esLoadTGA(ioContext, fileName, &width, &height);
 	GLuint texId;
 
-	if (buffer == NULL)
+	if (textureCache == NULL)
 	{
-		esLogMessage("Error loading (%s) image.\n", fileName);
-		return 0;
+		textureCache = esCreateTextureCache(ioContext, TEXTURE_CACHE_BUDGET);
+		if (textureCache == NULL)
+			return 0;
 	}
 
-	glGenTextures(1, &texId);
-	glBindTexture(GL_TEXTURE_2D, texId);
+	texId = esAcquireTexture(textureCache, fileName, GL_LINEAR, GL_CLAMP_TO_EDGE);
+	if (texId == 0)
+	{
+		esLogMessage("Error loading (%s) image.\n", fileName);
+	}
+	return texId;
+}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+void ReleaseTexture(GLuint texId)
+{
+	if (textureCache != NULL)
+		esReleaseTexture(textureCache, texId);
+}
 
-	free(buffer);
+void PrintTextureCacheStats()
+{
+	ESTextureCacheStats stats;
+
+	if (textureCache == NULL)
+		return;
+	esGetTextureCacheStats(textureCache, &stats);
+	printf("textures: %d hits, %d misses, %d evicted, %d held (%d referenced), %.2f MB resident, %.2f MB uploaded\n",
+		stats.hits, stats.misses, stats.evictions, stats.textureCount, stats.referencedCount,
+		stats.residentBytes / (1024.0 * 1024.0), stats.uploadedBytes / (1024.0 * 1024.0));
+}
 
-	return texId;
+void FreeTextureCache()
+{
+	esDestroyTextureCache(textureCache);
+	textureCache = NULL;
 }
 
 ///
@@ -32,13 +32,19 @@ void Redirection(GLfloat* lookAt, const GLfloat* target, const GLfloat* eye);
 
 // in a obj file, if a face part is like this:
 // f 5/11/23 1/10/22 3/12/24 7/9/21
-// which is more than three vertex. In this case, it represents two faces instead of one.
+// which is more than three vertex. In this case, it represents two faces instead of one,
+// a face of n vertices represents n - 2 of them.
 // this method is for getting a correct number of face.
 int updatedFaceNum(const int* face_counts, const int f_num);
 
-// assign value to ret (a,b,c) based on vArr, representing the very middle and bottom position of 
-// the model in order to draw a floor
-void GetMidBotPosition(const GLfloat** vArr, const int length, GLfloat* ret);
+// assign value to ret (a,b,c) based on positions [x0, y0, z0, x1, y1, z1...], representing the very
+// middle and bottom position of the model in order to draw a floor
+void GetMidBotPosition(const GLfloat* positions, const int length, GLfloat* ret);
+
+// textures of LoadTexture are shared through an ESTextureCache (esUtil.h): a file is loaded once
+// however many times it is asked for, and kept after its last ReleaseTexture until the cache needs
+// more than TEXTURE_CACHE_BUDGET bytes
+#define TEXTURE_CACHE_BUDGET (64 * 1024 * 1024)
 
 ///
 // Load texture from disk
@@ -46,6 +52,15 @@ void GetMidBotPosition(const GLfloat** vArr, const int length, GLfloat* ret);
 //
 GLuint LoadTexture(void* ioContext, char* fileName);
 
+// drop a reference taken by LoadTexture
+void ReleaseTexture(GLuint texId);
+
+// print the hit, miss and memory counters of the texture cache
+void PrintTextureCacheStats();
+
+// delete every texture of the cache, at shutdown
+void FreeTextureCache();
+
 ///
 // Create a simple 2x2 texture image with four different colors
 // Used for drawing floor
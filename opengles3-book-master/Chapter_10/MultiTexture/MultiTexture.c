@@ -46,45 +46,13 @@ typedef struct
    GLint baseMapLoc;
    GLint lightMapLoc;
 
-   // Texture handle
+   // Texture handles, from the texture cache
+   ESTextureCache *textureCache;
    GLuint baseMapTexId;
    GLuint lightMapTexId;
 
 } UserData;
 
-///
-// Load texture from disk
-//
-GLuint LoadTexture ( void *ioContext, char *fileName )
-{
-   int width,
-       height;
-
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
-
-   if ( buffer == NULL )
-   {
-      esLogMessage ( "Error loading (%s) image.\n", fileName );
-      return 0;
-   }
-
-   glGenTextures ( 1, &texId );
-   glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-
-   free ( buffer );
-
-   return texId;
-}
-
-
-
 ///
 // Initialize the shader and program object
 //
@@ -127,8 +95,26 @@ int Init ( ESContext *esContext )
    userData->lightMapLoc = glGetUniformLocation ( userData->programObject, "s_lightMap" );
 
    // Load the textures
-   userData->baseMapTexId = LoadTexture ( esContext->platformData, "basemap.tga" );
-   userData->lightMapTexId = LoadTexture ( esContext->platformData, "lightmap.tga" );
+   userData->textureCache = esCreateTextureCache ( esContext->platformData, 0 );
+
+   if ( userData->textureCache == NULL )
+   {
+      return FALSE;
+   }
+
+   // The ETC2 copies made at build time, the TGAs if there are none
+   userData->baseMapTexId = esAcquireTexture ( userData->textureCache, "basemap.ktx", GL_LINEAR, GL_CLAMP_TO_EDGE );
+   userData->lightMapTexId = esAcquireTexture ( userData->textureCache, "lightmap.ktx", GL_LINEAR, GL_CLAMP_TO_EDGE );
+
+   if ( userData->baseMapTexId == 0 )
+   {
+      userData->baseMapTexId = esAcquireTexture ( userData->textureCache, "basemap.tga", GL_LINEAR, GL_CLAMP_TO_EDGE );
+   }
+
+   if ( userData->lightMapTexId == 0 )
+   {
+      userData->lightMapTexId = esAcquireTexture ( userData->textureCache, "lightmap.tga", GL_LINEAR, GL_CLAMP_TO_EDGE );
+   }
 
    if ( userData->baseMapTexId == 0 || userData->lightMapTexId == 0 )
    {
@@ -200,8 +186,7 @@ void ShutDown ( ESContext *esContext )
    UserData *userData = esContext->userData;
 
    // Delete texture object
-   glDeleteTextures ( 1, &userData->baseMapTexId );
-   glDeleteTextures ( 1, &userData->lightMapTexId );
+   esDestroyTextureCache ( userData->textureCache );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
@@ -14,6 +14,14 @@ LOCAL_SRC_FILES := $(COMMON_SRC_PATH)/esShader.c \
 				   $(COMMON_SRC_PATH)/esShapes.c \
 				   $(COMMON_SRC_PATH)/esTransform.c \
 				   $(COMMON_SRC_PATH)/esUtil.c \
+				   $(COMMON_SRC_PATH)/esTextureStream.c \
+				   $(COMMON_SRC_PATH)/esTextureCache.c \
+				   $(COMMON_SRC_PATH)/esTextureMip.c \
+				   $(COMMON_SRC_PATH)/esTextureKTX.c \
+				   $(COMMON_SRC_PATH)/esTexturePVR.c \
+				   $(COMMON_SRC_PATH)/esModel.c \
+				   $(COMMON_SRC_PATH)/esTextureAtlas.c \
+				   $(COMMON_SRC_PATH)/esTextureProcedural.c \
 				   $(COMMON_SRC_PATH)/Android/esUtil_Android.c \
 				   $(SRC_PATH)/MRTs.c
 				   
@@ -0,0 +1,404 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// EnvironmentMapping.c
+//
+//    This is an example that draws a bump mapped teapot reflecting
+//    a cube map, the mesh read from a POD file and the textures from
+//    PVR files.
+//
+#include <stdlib.h>
+#include <math.h>
+#include "esUtil.h"
+
+#define ATTRIB_LOCATION_COUNT  5
+
+typedef struct
+{
+   // Handle to a program object
+   GLuint programObject;
+
+   // Uniform locations
+   GLint  viewInverseLoc;
+   GLint  viewProjectionLoc;
+   GLint  lightPositionLoc;
+
+   // Sampler locations
+   GLint  baseMapLoc;
+   GLint  bumpMapLoc;
+   GLint  envMapLoc;
+
+   // Texture handles, the 2D ones from the texture cache
+   ESTextureCache *textureCache;
+   GLuint baseMapTexId;
+   GLuint bumpMapTexId;
+   GLuint envMapTexId;
+
+   // The mesh of the scene, copied from the file into buffers
+   GLuint vboId;
+   GLuint iboId;
+   GLuint vaoId;
+   GLenum indexType;
+   int    indexCount;
+
+   // Translation of the mesh node
+   GLfloat position[3];
+
+   // Rotation angle of the camera
+   GLfloat angle;
+
+   ESMatrix viewInverse;
+   ESMatrix viewProjection;
+
+} UserData;
+
+///
+// Load the POD scene into a vertex array object
+//
+static int LoadScene ( ESContext *esContext )
+{
+   // POD attributes bound to the attribute locations of the shader
+   static const int podAttributes[ATTRIB_LOCATION_COUNT] =
+   {
+      ES_POD_POSITION, ES_POD_UV0, ES_POD_NORMAL, ES_POD_BINORMAL, ES_POD_TANGENT
+   };
+   UserData   *userData = esContext->userData;
+   ESPODScene  scene;
+   ESPODMesh  *mesh;
+   int         i;
+
+   if ( !esLoadPOD ( esContext->platformData, "EnvironmentMapping.pod", &scene ) )
+   {
+      return GL_FALSE;
+   }
+
+   if ( scene.nodeCount == 0 || scene.nodes[0].meshIndex < 0 ||
+         scene.meshes[scene.nodes[0].meshIndex].indices == NULL )
+   {
+      esFreePOD ( &scene );
+      return GL_FALSE;
+   }
+
+   mesh = &scene.meshes[scene.nodes[0].meshIndex];
+
+   for ( i = 0; i < 3; i++ )
+   {
+      userData->position[i] = scene.nodes[0].position[i];
+   }
+
+   glGenVertexArrays ( 1, &userData->vaoId );
+   glBindVertexArray ( userData->vaoId );
+
+   // Both buffers are filled straight from the mapping of the file
+   glGenBuffers ( 1, &userData->vboId );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->vboId );
+   glBufferData ( GL_ARRAY_BUFFER, mesh->vertexBytes, mesh->vertices, GL_STATIC_DRAW );
+
+   glGenBuffers ( 1, &userData->iboId );
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->iboId );
+   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, mesh->indexBytes, mesh->indices, GL_STATIC_DRAW );
+
+   for ( i = 0; i < ATTRIB_LOCATION_COUNT; i++ )
+   {
+      const ESPODAttribute *attribute = &mesh->attributes[podAttributes[i]];
+
+      if ( attribute->size == 0 )
+      {
+         continue;
+      }
+
+      glEnableVertexAttribArray ( i );
+      glVertexAttribPointer ( i, attribute->size, attribute->type, attribute->normalized,
+                              mesh->stride, ( const void * ) ( size_t ) attribute->offset );
+   }
+
+   glBindVertexArray ( 0 );
+
+   userData->indexType = mesh->indexType;
+   userData->indexCount = mesh->indexCount;
+
+   // The buffers hold copies, the file is no longer needed
+   esFreePOD ( &scene );
+   return GL_TRUE;
+}
+
+///
+// Initialize the shader and program object
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   const char vShaderStr[] =
+      "#version 300 es                                                  \n"
+      "uniform mat4 u_matViewInverse;                                   \n"
+      "uniform mat4 u_matViewProjection;                                \n"
+      "uniform vec3 u_lightPosition;                                    \n"
+      "layout(location = 0) in vec4 a_vertex;                           \n"
+      "layout(location = 1) in vec2 a_texcoord0;                        \n"
+      "layout(location = 2) in vec3 a_normal;                           \n"
+      "layout(location = 3) in vec3 a_binormal;                         \n"
+      "layout(location = 4) in vec3 a_tangent;                          \n"
+      "out vec2 v_texcoord;                                             \n"
+      "out vec3 v_lightDirection;                                       \n"
+      "out vec3 v_normal;                                               \n"
+      "out vec3 v_binormal;                                             \n"
+      "out vec3 v_tangent;                                              \n"
+      "void main()                                                      \n"
+      "{                                                                \n"
+      "   // Transform light position into world space                  \n"
+      "   vec3 lightPositionWorld =                                     \n"
+      "      ( u_matViewInverse * vec4( u_lightPosition, 1.0 ) ).xyz;   \n"
+      "   v_lightDirection = lightPositionWorld - a_vertex.xyz;         \n"
+      "   gl_Position = u_matViewProjection * a_vertex;                 \n"
+      "   v_texcoord = a_texcoord0;                                     \n"
+      "   v_normal = a_normal;                                          \n"
+      "   v_binormal = a_binormal;                                      \n"
+      "   v_tangent = a_tangent;                                        \n"
+      "}                                                                \n";
+
+   const char fShaderStr[] =
+      "#version 300 es                                                  \n"
+      "precision mediump float;                                         \n"
+      "uniform sampler2D s_baseMap;                                     \n"
+      "uniform sampler2D s_bumpMap;                                     \n"
+      "uniform samplerCube s_envMap;                                    \n"
+      "in vec2 v_texcoord;                                              \n"
+      "in vec3 v_lightDirection;                                        \n"
+      "in vec3 v_normal;                                                \n"
+      "in vec3 v_binormal;                                              \n"
+      "in vec3 v_tangent;                                               \n"
+      "layout(location = 0) out vec4 fragColor;                         \n"
+      "void main()                                                      \n"
+      "{                                                                \n"
+      "   vec4 baseColor = texture( s_baseMap, v_texcoord );            \n"
+      "                                                                 \n"
+      "   // Tangent space normal from the normal map, to world space   \n"
+      "   vec3 normal = texture( s_bumpMap, v_texcoord ).xyz;           \n"
+      "   normal = normal * 2.0 - 1.0;                                  \n"
+      "   mat3 tangentToWorldMat = mat3( v_tangent,                     \n"
+      "                                  v_binormal,                    \n"
+      "                                  v_normal );                    \n"
+      "   normal = normalize( tangentToWorldMat * normal );             \n"
+      "                                                                 \n"
+      "   // Reflect the light direction to fetch the environment map   \n"
+      "   vec3 lightDirection = normalize( v_lightDirection );          \n"
+      "   float nDotL = dot( normal, lightDirection );                  \n"
+      "   vec3 reflection = ( 2.0 * normal * nDotL ) - lightDirection;  \n"
+      "   vec4 envColor = texture( s_envMap, reflection );              \n"
+      "   fragColor = 0.25 * baseColor + envColor;                      \n"
+      "}                                                                \n";
+
+   // Load the shaders and get a linked program object
+   userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
+
+   // Get the uniform locations
+   userData->viewInverseLoc = glGetUniformLocation ( userData->programObject, "u_matViewInverse" );
+   userData->viewProjectionLoc = glGetUniformLocation ( userData->programObject, "u_matViewProjection" );
+   userData->lightPositionLoc = glGetUniformLocation ( userData->programObject, "u_lightPosition" );
+
+   // Get the sampler locations
+   userData->baseMapLoc = glGetUniformLocation ( userData->programObject, "s_baseMap" );
+   userData->bumpMapLoc = glGetUniformLocation ( userData->programObject, "s_bumpMap" );
+   userData->envMapLoc = glGetUniformLocation ( userData->programObject, "s_envMap" );
+
+   // Load the 2D textures
+   userData->textureCache = esCreateTextureCache ( esContext->platformData, 0 );
+
+   if ( userData->textureCache == NULL )
+   {
+      return FALSE;
+   }
+
+   userData->baseMapTexId = esAcquireTexture ( userData->textureCache, "baseMap.pvr", GL_LINEAR, GL_REPEAT );
+   userData->bumpMapTexId = esAcquireTexture ( userData->textureCache, "bumpMap.pvr", GL_LINEAR, GL_REPEAT );
+
+   if ( userData->baseMapTexId == 0 || userData->bumpMapTexId == 0 )
+   {
+      return FALSE;
+   }
+
+   // Load the cube map, all six faces are in the one file
+   glGenTextures ( 1, &userData->envMapTexId );
+   glBindTexture ( GL_TEXTURE_CUBE_MAP, userData->envMapTexId );
+
+   if ( !esTexImagePVR ( esContext->platformData, "envMap.pvr", GL_TEXTURE_CUBE_MAP, NULL ) )
+   {
+      return FALSE;
+   }
+
+   glTexParameteri ( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+   if ( !LoadScene ( esContext ) )
+   {
+      return FALSE;
+   }
+
+   // Starting rotation angle of the camera
+   userData->angle = 0.0f;
+
+   glEnable ( GL_DEPTH_TEST );
+   glEnable ( GL_CULL_FACE );
+   glClearColor ( 1.0f, 1.0f, 1.0f, 0.0f );
+   return TRUE;
+}
+
+///
+// Orbit the camera around the teapot
+//
+void Update ( ESContext *esContext, float deltaTime )
+{
+   UserData *userData = esContext->userData;
+   ESMatrix  perspective;
+   ESMatrix  view;
+   ESMatrix  viewProjection;
+   GLfloat   eye[3];
+   float     aspect;
+   int       i;
+
+   userData->angle += deltaTime * 20.0f;
+
+   if ( userData->angle >= 360.0f )
+   {
+      userData->angle -= 360.0f;
+   }
+
+   eye[0] = 280.0f * sinf ( userData->angle * ( float ) M_PI / 180.0f );
+   eye[1] = 100.0f;
+   eye[2] = 280.0f * cosf ( userData->angle * ( float ) M_PI / 180.0f );
+
+   // Compute the window aspect ratio
+   aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
+
+   esMatrixLoadIdentity ( &perspective );
+   esPerspective ( &perspective, 60.0f, aspect, 10.0f, 1000.0f );
+
+   esMatrixLookAt ( &view, eye[0], eye[1], eye[2], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f );
+
+   // The view is a rotation and a translation, its inverse is the
+   // transposed rotation with the eye position
+   esMatrixLoadIdentity ( &userData->viewInverse );
+
+   for ( i = 0; i < 3; i++ )
+   {
+      userData->viewInverse.m[i][0] = view.m[0][i];
+      userData->viewInverse.m[i][1] = view.m[1][i];
+      userData->viewInverse.m[i][2] = view.m[2][i];
+      userData->viewInverse.m[3][i] = eye[i];
+   }
+
+   esMatrixMultiply ( &viewProjection, &view, &perspective );
+
+   // Place the mesh where its node is
+   esMatrixLoadIdentity ( &userData->viewProjection );
+   esTranslate ( &userData->viewProjection, userData->position[0], userData->position[1], userData->position[2] );
+   esMatrixMultiply ( &userData->viewProjection, &userData->viewProjection, &viewProjection );
+}
+
+///
+// Draw the teapot
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+
+   // Set the viewport
+   glViewport ( 0, 0, esContext->width, esContext->height );
+
+   // Clear the color and depth buffers
+   glClear ( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+   // Use the program object
+   glUseProgram ( userData->programObject );
+
+   glUniformMatrix4fv ( userData->viewInverseLoc, 1, GL_FALSE, ( GLfloat * ) &userData->viewInverse.m[0][0] );
+   glUniformMatrix4fv ( userData->viewProjectionLoc, 1, GL_FALSE, ( GLfloat * ) &userData->viewProjection.m[0][0] );
+
+   // A light above and to the left of the viewer
+   glUniform3f ( userData->lightPositionLoc, -200.0f, 300.0f, 0.0f );
+
+   // Bind the textures to units 0, 1 and 2
+   glActiveTexture ( GL_TEXTURE0 );
+   glBindTexture ( GL_TEXTURE_2D, userData->baseMapTexId );
+   glUniform1i ( userData->baseMapLoc, 0 );
+
+   glActiveTexture ( GL_TEXTURE1 );
+   glBindTexture ( GL_TEXTURE_2D, userData->bumpMapTexId );
+   glUniform1i ( userData->bumpMapLoc, 1 );
+
+   glActiveTexture ( GL_TEXTURE2 );
+   glBindTexture ( GL_TEXTURE_CUBE_MAP, userData->envMapTexId );
+   glUniform1i ( userData->envMapLoc, 2 );
+
+   glBindVertexArray ( userData->vaoId );
+   glDrawElements ( GL_TRIANGLES, userData->indexCount, userData->indexType, ( const void * ) 0 );
+   glBindVertexArray ( 0 );
+}
+
+///
+// Cleanup
+//
+void ShutDown ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+
+   // Delete the buffers and the vertex array object
+   glDeleteBuffers ( 1, &userData->vboId );
+   glDeleteBuffers ( 1, &userData->iboId );
+   glDeleteVertexArrays ( 1, &userData->vaoId );
+
+   // Delete texture objects
+   esDestroyTextureCache ( userData->textureCache );
+   glDeleteTextures ( 1, &userData->envMapTexId );
+
+   // Delete program object
+   glDeleteProgram ( userData->programObject );
+}
+
+int esMain ( ESContext *esContext )
+{
+   esContext->userData = calloc ( 1, sizeof ( UserData ) );
+
+   esCreateWindow ( esContext, "EnvironmentMapping", 640, 480, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
+
+   if ( !Init ( esContext ) )
+   {
+      return GL_FALSE;
+   }
+
+   esRegisterUpdateFunc ( esContext, Update );
+   esRegisterDrawFunc ( esContext, Draw );
+   esRegisterShutdownFunc ( esContext, ShutDown );
+
+   return GL_TRUE;
+}
@@ -56,8 +56,9 @@ typedef struct
    GLint centerPositionLoc;
    GLint samplerLoc;
 
-   // Texture handle
-   GLuint textureId;
+   // Texture loaded in the background, a handle of the stream
+   ESTextureStream *textureStream;
+   int textureId;
 
    // Particle vertex data
    float particleData[ NUM_PARTICLES * PARTICLE_SIZE ];
@@ -67,37 +68,6 @@ typedef struct
 
 } UserData;
 
-///
-// Load texture from disk
-//
-GLuint LoadTexture ( void *ioContext, char *fileName )
-{
-   int width,
-       height;
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
-
-   if ( buffer == NULL )
-   {
-      esLogMessage ( "Error loading (%s) image.\n", fileName );
-      return 0;
-   }
-
-   glGenTextures ( 1, &texId );
-   glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-
-   free ( buffer );
-
-   return texId;
-}
-
-
 ///
 // Initialize the shader and program object
 //
@@ -183,9 +153,17 @@ int Init ( ESContext *esContext )
    // Initialize time to cause reset on first update
    userData->time = 1.0f;
 
-   userData->textureId = LoadTexture ( esContext->platformData, "smoke.tga" );
+   // The particles are drawn with a placeholder until the texture is uploaded
+   userData->textureStream = esCreateTextureStream ( esContext->platformData, 2, 1 << 20 );
 
-   if ( userData->textureId <= 0 )
+   if ( userData->textureStream == NULL )
+   {
+      return FALSE;
+   }
+
+   userData->textureId = esStreamTexture ( userData->textureStream, "smoke.tga" );
+
+   if ( userData->textureId < 0 )
    {
       return FALSE;
    }
@@ -238,6 +216,9 @@ void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
+   // Upload what has been loaded of the texture since the last frame
+   esUpdateTextureStream ( userData->textureStream );
+
    // Set the viewport
    glViewport ( 0, 0, esContext->width, esContext->height );
 
@@ -271,7 +252,7 @@ void Draw ( ESContext *esContext )
 
    // Bind the texture
    glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_2D, userData->textureId );
+   glBindTexture ( GL_TEXTURE_2D, esGetStreamTexture ( userData->textureStream, userData->textureId ) );
 
    // Set the sampler texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );
@@ -287,7 +268,7 @@ void ShutDown ( ESContext *esContext )
    UserData *userData = esContext->userData;
 
    // Delete texture object
-   glDeleteTextures ( 1, &userData->textureId );
+   esDestroyTextureStream ( userData->textureStream );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
@@ -36,22 +36,23 @@
 //
 #define _USE_MATH_DEFINES
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "esUtil.h"
 
 
-#define NOISE_TABLE_MASK   255
-
-#define FLOOR(x)           ((int)(x) - ((x) < 0 && (x) != (int)(x)))
-#define smoothstep(t)      ( t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f ) )
-#define lerp(t, a, b)      ( a + t * (b - a) )
 #ifdef _WIN32
 #define srandom srand
 #define random rand
 #endif
 
-// lattice gradients 3D noise
-static float   gradientTable[256 * 3];
+// The working directory of the app isn't writable on Android and iOS, the
+// noise volume is built again on every run there
+#if defined(ANDROID) || defined(__APPLE__)
+#define NOISE_CACHE_DIR NULL
+#else
+#define NOISE_CACHE_DIR "."
+#endif
 
 // permTable describes a random permutatin of 8-bit values from 0 to 255.
 static unsigned char permTable[256] =
@@ -74,13 +75,12 @@ static unsigned char permTable[256] =
    0x89, 0xD6, 0x91, 0x5D, 0x5C, 0x64, 0xF5, 0x00, 0xD8, 0xBA, 0x3C, 0x53, 0x69, 0x61, 0xCC, 0x34,
 };
 
-void initNoiseTable()
+void initNoiseTable ( ESNoiseLattice *lattice )
 {
    int            i;
    float          a;
    float          x, y, z, r, theta;
    float          gradients[256 * 3];
-   unsigned int   *p, *psrc;
 
    srandom ( 0 );
 
@@ -106,157 +106,51 @@ void initNoiseTable()
    }
 
    // use the index in the permutation table to load the
-   // gradient values from gradients to gradientTable
-   p = ( unsigned int * ) gradientTable;
-   psrc = ( unsigned int * ) gradients;
-
+   // gradient values from gradients to the lattice
    for ( i = 0; i < 256; i++ )
    {
       int indx = permTable[i];
-      p[i * 3] = psrc[indx * 3];
-      p[i * 3 + 1] = psrc[indx * 3 + 1];
-      p[i * 3 + 2] = psrc[indx * 3 + 2];
+      lattice->gradients[i][0] = gradients[indx * 3];
+      lattice->gradients[i][1] = gradients[indx * 3 + 1];
+      lattice->gradients[i][2] = gradients[indx * 3 + 2];
    }
-}
-//
-// generate the value of gradient noise for a given lattice point
-//
-// (ix, iy, iz) specifies the 3D lattice position
-// (fx, fy, fz) specifies the fractional part
-//
-static float glattice3D ( int ix, int iy, int iz, float fx, float fy, float fz )
-{
-   float *g;
-   int   indx, y, z;
 
-   z = permTable[iz & NOISE_TABLE_MASK];
-   y = permTable[ ( iy + z ) & NOISE_TABLE_MASK];
-   indx = ( ix + y ) & NOISE_TABLE_MASK;
-   g = &gradientTable[indx * 3];
-
-   return ( g[0] * fx + g[1] * fy + g[2] * fz );
+   memcpy ( lattice->permutation, permTable, sizeof ( permTable ) );
 }
 
-//
-// generate the 3D noise value
-// f describes the input (x, y, z) position for which the noise value needs to be computed
-// noise3D returns the scalar noise value
-//
-float noise3D ( float *f )
-{
-   int   ix, iy, iz;
-   float fx0, fx1, fy0, fy1, fz0, fz1;
-   float wx, wy, wz;
-   float vx0, vx1, vy0, vy1, vz0, vz1;
-
-   ix = FLOOR ( f[0] );
-   fx0 = f[0] - ix;
-   fx1 = fx0 - 1;
-   wx = smoothstep ( fx0 );
-
-   iy = FLOOR ( f[1] );
-   fy0 = f[1] - iy;
-   fy1 = fy0 - 1;
-   wy = smoothstep ( fy0 );
-
-   iz = FLOOR ( f[2] );
-   fz0 = f[2] - iz;
-   fz1 = fz0 - 1;
-   wz = smoothstep ( fz0 );
-
-   vx0 = glattice3D ( ix, iy, iz, fx0, fy0, fz0 );
-   vx1 = glattice3D ( ix + 1, iy, iz, fx1, fy0, fz0 );
-   vy0 = lerp ( wx, vx0, vx1 );
-   vx0 = glattice3D ( ix, iy + 1, iz, fx0, fy1, fz0 );
-   vx1 = glattice3D ( ix + 1, iy + 1, iz, fx1, fy1, fz0 );
-   vy1 = lerp ( wx, vx0, vx1 );
-   vz0 = lerp ( wy, vy0, vy1 );
-
-   vx0 = glattice3D ( ix, iy, iz + 1, fx0, fy0, fz1 );
-   vx1 = glattice3D ( ix + 1, iy, iz + 1, fx1, fy0, fz1 );
-   vy0 = lerp ( wx, vx0, vx1 );
-   vx0 = glattice3D ( ix, iy + 1, iz + 1, fx0, fy1, fz1 );
-   vx1 = glattice3D ( ix + 1, iy + 1, iz + 1, fx1, fy1, fz1 );
-   vy1 = lerp ( wx, vx0, vx1 );
-   vz1 = lerp ( wy, vy0, vy1 );
-
-   return lerp ( wz, vz0, vz1 );;
-}
-
-unsigned int Create3DNoiseTexture ( int textureSize, float frequency )
+unsigned int Create3DNoiseTexture ( int textureSize, float frequency, int octaves )
 {
    GLuint textureId;
-   GLfloat *texBuf = ( GLfloat * ) malloc ( sizeof ( GLfloat ) * textureSize * textureSize * textureSize ) ;
-   GLubyte *uploadBuf = ( GLubyte * ) malloc ( sizeof ( GLubyte ) * textureSize * textureSize * textureSize ) ;
-   int x, y, z;
-   int index = 0;
-   float min = 1000;
-   float max = -1000;
-   float range;
+   ESNoiseVolume volume;
+   ESNoiseLattice lattice;
+   ESThreadPool *pool = esCreateThreadPool ( 0 );
 
-   initNoiseTable();
+   volume.size = textureSize;
+   volume.frequency = frequency;
+   volume.octaves = octaves;
+   volume.lacunarity = 2.0f;
+   volume.gain = 0.5f;
+   volume.tileable = GL_TRUE;
 
-   for ( z = 0; z < textureSize; z++ )
-   {
-      for ( y = 0; y < textureSize; y++ )
-      {
-         for ( x = 0; x < textureSize; x++ )
-         {
-            float noiseVal;
-            float pos[3] = { ( float ) x / ( float ) textureSize, ( float ) y / ( float ) textureSize, ( float ) z  / ( float ) textureSize };
-            pos[0] *= frequency;
-            pos[1] *= frequency;
-            pos[2] *= frequency;
-            noiseVal = noise3D ( pos );
-
-            if ( noiseVal < min )
-            {
-               min = noiseVal;
-            }
-
-            if ( noiseVal > max )
-            {
-               max = noiseVal;
-            }
-
-            texBuf[ index++ ] = noiseVal;
-         }
-      }
-   }
-
-   // Normalize to the [0, 1] range
-   range = ( max - min );
-   index = 0;
-
-   for ( z = 0; z < textureSize; z++ )
-   {
-      for ( y = 0; y < textureSize; y++ )
-      {
-         for ( x = 0; x < textureSize; x++ )
-         {
-            float noiseVal = texBuf[index];
-            noiseVal = ( noiseVal - min ) / range;
-            uploadBuf[index++] = ( GLubyte ) ( noiseVal * 255.0f );
-         }
-      }
-   }
+   initNoiseTable ( &lattice );
 
    glGenTextures ( 1, &textureId );
    glBindTexture ( GL_TEXTURE_3D, textureId );
-   glTexImage3D ( GL_TEXTURE_3D, 0, GL_R8, textureSize, textureSize, textureSize, 0,
-                  GL_RED, GL_UNSIGNED_BYTE, uploadBuf );
 
+   // Fractal noise normalized to the [0, 1] range, built on the first run and
+   // mapped from NOISE_CACHE_DIR on the next ones
+   esTexImageFbmVolume ( pool, &lattice, &volume, NOISE_CACHE_DIR );
+   esDestroyThreadPool ( pool );
+
+   // The volume tiles, the random values don't mirror back as the time wraps
    glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT );
-   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT );
-   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_MIRRORED_REPEAT );
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT );
 
    glBindTexture ( GL_TEXTURE_3D, 0 );
 
-   free ( texBuf );
-   free ( uploadBuf );
-
    return textureId;
 }
 
@@ -33,4 +33,4 @@
 //
 // Generates a 3D noise
 //
-unsigned int Create3DNoiseTexture ( int textureSize, float frequency );
+unsigned int Create3DNoiseTexture ( int textureSize, float frequency, int octaves );
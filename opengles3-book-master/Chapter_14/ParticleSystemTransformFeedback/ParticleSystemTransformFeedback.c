@@ -76,7 +76,8 @@ typedef struct
    GLint drawAccelerationLoc;
    GLint samplerLoc;
 
-   // Texture handles
+   // Texture handles, the smoke one from the texture cache
+   ESTextureCache *textureCache;
    GLuint textureId;
    GLuint noiseTextureId;
 
@@ -98,36 +99,6 @@ typedef struct
 
 } UserData;
 
-///
-// Load texture from disk
-//
-GLuint LoadTexture ( void *ioContext, char *fileName )
-{
-   int width,
-       height;
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
-
-   if ( buffer == NULL )
-   {
-      esLogMessage ( "Error loading (%s) image.\n", fileName );
-      return 0;
-   }
-
-   glGenTextures ( 1, &texId );
-   glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-
-   free ( buffer );
-
-   return texId;
-}
-
 void InitEmitParticles ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
@@ -294,15 +265,28 @@ int Init ( ESContext *esContext )
 
    glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
 
-   userData->textureId = LoadTexture ( esContext->platformData, "smoke.tga" );
+   userData->textureCache = esCreateTextureCache ( esContext->platformData, 0 );
+
+   if ( userData->textureCache == NULL )
+   {
+      return FALSE;
+   }
+
+   // The ETC2 copy made at build time, the TGA if there is none
+   userData->textureId = esAcquireTexture ( userData->textureCache, "smoke.ktx", GL_LINEAR, GL_CLAMP_TO_EDGE );
+
+   if ( userData->textureId == 0 )
+   {
+      userData->textureId = esAcquireTexture ( userData->textureCache, "smoke.tga", GL_LINEAR, GL_CLAMP_TO_EDGE );
+   }
 
-   if ( userData->textureId <= 0 )
+   if ( userData->textureId == 0 )
    {
       return FALSE;
    }
 
    // Create a 3D noise texture for random values
-   userData->noiseTextureId = Create3DNoiseTexture ( 128, 50.0 );
+   userData->noiseTextureId = Create3DNoiseTexture ( 128, 50.0, 2 );
 
    // Initialize particle data
    for ( i = 0; i < NUM_PARTICLES; i++ )
@@ -468,7 +452,7 @@ void ShutDown ( ESContext *esContext )
    UserData *userData = esContext->userData;
 
    // Delete texture object
-   glDeleteTextures ( 1, &userData->textureId );
+   esDestroyTextureCache ( userData->textureCache );
 
    // Delete program object
    glDeleteProgram ( userData->drawProgramObject );
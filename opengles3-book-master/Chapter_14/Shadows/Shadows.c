@@ -42,6 +42,11 @@
 #define POSITION_LOC    0
 #define COLOR_LOC       1
 
+// Objects of the scene, in the order of their bounding boxes
+#define GROUND          0
+#define CUBE            1
+#define NUM_OBJECTS     2
+
 typedef struct
 {
    // Handle to a program object
@@ -82,10 +87,39 @@ typedef struct
    ESMatrix  cubeMvpMatrix;
    ESMatrix  cubeMvpLightMatrix;
 
+   // Bounds of the models as generated
+   ESBounds  groundBounds;
+   ESBounds  cubeBounds;
+
+   // World space boxes of the objects, min x, y, z and max x, y, z
+   GLfloat   boxCorners[6][NUM_OBJECTS];
+   ESBoxArrays boxes;
+
+   // What the eye and the light see, in world space
+   ESFrustumPlanes eyeFrustum;
+   ESFrustumPlanes lightFrustum;
+
    float eyePosition[3];
    float lightPosition[3];
 } UserData;
 
+///
+// Store the world space box of an object drawn with model
+//
+void SetObjectBox ( UserData *userData, int object, const ESBounds *bounds, const ESMatrix *model )
+{
+   ESBounds world;
+   int i;
+
+   esTransformBounds ( &world, bounds, model );
+
+   for ( i = 0; i < 3; i++ )
+   {
+      userData->boxCorners[i][object] = world.min[i];
+      userData->boxCorners[i + 3][object] = world.max[i];
+   }
+}
+
 ///
 // Initialize the MVP matrix
 //
@@ -96,6 +130,7 @@ int InitMVP ( ESContext *esContext )
    ESMatrix modelview;
    ESMatrix model;
    ESMatrix view;
+   ESMatrix viewProjection;
    float    aspect;
    UserData *userData = esContext->userData;
    
@@ -118,6 +153,7 @@ int InitMVP ( ESContext *esContext )
    esTranslate ( &model, -2.0f, -2.0f, 0.0f );
    esScale ( &model, 10.0f, 10.0f, 10.0f );
    esRotate ( &model, 90.0f, 1.0f, 0.0f, 0.0f );
+   SetObjectBox ( userData, GROUND, &userData->groundBounds, &model );
 
    // create view matrix transformation from the eye position
    esMatrixLookAt ( &view, 
@@ -125,11 +161,17 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   // model and view end in a column of 0, 0, 0, 1 and so does modelview,
+   // the affine multiply does for every product here
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
+
+   // the frustum of the eye in world space, to cull the objects with
+   esMatrixMultiplyAffine ( &viewProjection, &view, &perspective );
+   esFrustumPlanesFromMatrix ( &userData->eyeFrustum, &viewProjection );
 
    // Compute the final ground MVP for the scene rendering by multiplying the 
    // modelview and perspective matrices together
-   esMatrixMultiply ( &userData->groundMvpMatrix, &modelview, &perspective );
+   esMatrixMultiplyAffine ( &userData->groundMvpMatrix, &modelview, &perspective );
 
    // create view matrix transformation from the light position
    esMatrixLookAt ( &view, 
@@ -137,11 +179,15 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
+
+   // the frustum of the light in world space
+   esMatrixMultiplyAffine ( &viewProjection, &view, &ortho );
+   esFrustumPlanesFromMatrix ( &userData->lightFrustum, &viewProjection );
 
    // Compute the final ground MVP for the shadow map rendering by multiplying the 
    // modelview and ortho matrices together
-   esMatrixMultiply ( &userData->groundMvpLightMatrix, &modelview, &ortho );
+   esMatrixMultiplyAffine ( &userData->groundMvpLightMatrix, &modelview, &ortho );
 
    // CUBE
    // position the cube
@@ -149,6 +195,7 @@ int InitMVP ( ESContext *esContext )
    esTranslate ( &model, 5.0f, -0.4f, -3.0f );
    esScale ( &model, 1.0f, 2.5f, 1.0f );
    esRotate ( &model, -15.0f, 0.0f, 1.0f, 0.0f );
+   SetObjectBox ( userData, CUBE, &userData->cubeBounds, &model );
 
    // create view matrix transformation from the eye position
    esMatrixLookAt ( &view, 
@@ -156,11 +203,11 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
    
    // Compute the final cube MVP for scene rendering by multiplying the 
    // modelview and perspective matrices together
-   esMatrixMultiply ( &userData->cubeMvpMatrix, &modelview, &perspective );
+   esMatrixMultiplyAffine ( &userData->cubeMvpMatrix, &modelview, &perspective );
 
    // create view matrix transformation from the light position
    esMatrixLookAt ( &view, 
@@ -168,11 +215,11 @@ int InitMVP ( ESContext *esContext )
                     0.0f, 0.0f, 0.0f,
                     0.0f, 1.0f, 0.0f );
 
-   esMatrixMultiply ( &modelview, &model, &view );
+   esMatrixMultiplyAffine ( &modelview, &model, &view );
    
    // Compute the final cube MVP for shadow map rendering by multiplying the 
    // modelview and ortho matrices together
-   esMatrixMultiply ( &userData->cubeMvpLightMatrix, &modelview, &ortho );
+   esMatrixMultiplyAffine ( &userData->cubeMvpLightMatrix, &modelview, &ortho );
 
    return TRUE;
 }
@@ -318,6 +365,7 @@ int Init ( ESContext *esContext )
    // Generate the vertex and index data for the ground
    userData->groundGridSize = 3;
    userData->groundNumIndices = esGenSquareGrid( userData->groundGridSize, &positions, &indices );
+   esComputeBounds ( &userData->groundBounds, positions, 3, userData->groundGridSize * userData->groundGridSize );
 
    // Index buffer object for the ground model
    glGenBuffers ( 1, &userData->groundIndicesIBO );
@@ -336,6 +384,7 @@ int Init ( ESContext *esContext )
    // Generate the vertex and index date for the cube model
    userData->cubeNumIndices = esGenCube ( 1.0f, &positions,
                                           NULL, NULL, &indices );
+   esComputeBounds ( &userData->cubeBounds, positions, 3, 24 );
 
    // Index buffer object for cube model
    glGenBuffers ( 1, &userData->cubeIndicesIBO );
@@ -350,6 +399,14 @@ int Init ( ESContext *esContext )
    glBufferData ( GL_ARRAY_BUFFER, 24 * sizeof( GLfloat ) * 3, positions, GL_STATIC_DRAW );
    free( positions );
 
+   // the boxes InitMVP fills in
+   userData->boxes.minX = userData->boxCorners[0];
+   userData->boxes.minY = userData->boxCorners[1];
+   userData->boxes.minZ = userData->boxCorners[2];
+   userData->boxes.maxX = userData->boxCorners[3];
+   userData->boxes.maxY = userData->boxCorners[4];
+   userData->boxes.maxZ = userData->boxCorners[5];
+
    // setup transformation matrices
    userData->eyePosition[0] = -5.0f;
    userData->eyePosition[1] = 3.0f;
@@ -376,11 +433,11 @@ int Init ( ESContext *esContext )
 }
 
 ///
-// Draw the model
+// Draw the ground
 //
-void DrawScene ( ESContext *esContext, 
-                 GLint mvpLoc, 
-                 GLint mvpLightLoc )
+void DrawGround ( ESContext *esContext, 
+                  GLint mvpLoc, 
+                  GLint mvpLightLoc )
 {
    UserData *userData = esContext->userData;
  
@@ -402,6 +459,16 @@ void DrawScene ( ESContext *esContext,
    glVertexAttrib4f ( COLOR_LOC, 0.9f, 0.9f, 0.9f, 1.0f );
 
    glDrawElements ( GL_TRIANGLES, userData->groundNumIndices, GL_UNSIGNED_INT, (const void*)NULL );
+}
+
+///
+// Draw the cube
+//
+void DrawCube ( ESContext *esContext, 
+                GLint mvpLoc, 
+                GLint mvpLightLoc )
+{
+   UserData *userData = esContext->userData;
 
    // Draw the cube
    // Load the vertex position
@@ -423,6 +490,32 @@ void DrawScene ( ESContext *esContext,
    glDrawElements ( GL_TRIANGLES, userData->cubeNumIndices, GL_UNSIGNED_INT, (const void*)NULL );
 }
 
+///
+// Draw the objects inside frustum
+//
+void DrawScene ( ESContext *esContext, 
+                 GLint mvpLoc, 
+                 GLint mvpLightLoc,
+                 const ESFrustumPlanes *frustum )
+{
+   UserData *userData = esContext->userData;
+   int visible[NUM_OBJECTS];
+   int numVisible = esCullBoxes ( frustum, &userData->boxes, NUM_OBJECTS, visible );
+   int i;
+
+   for ( i = 0; i < numVisible; i++ )
+   {
+      if ( visible[i] == GROUND )
+      {
+         DrawGround ( esContext, mvpLoc, mvpLightLoc );
+      }
+      else
+      {
+         DrawCube ( esContext, mvpLoc, mvpLightLoc );
+      }
+   }
+}
+
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
@@ -451,7 +544,7 @@ void Draw ( ESContext *esContext )
 
    glUseProgram ( userData->shadowMapProgramObject );
 
-   DrawScene ( esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc );
+   DrawScene ( esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc, &userData->lightFrustum );
 
    glDisable( GL_POLYGON_OFFSET_FILL );
 
@@ -482,7 +575,7 @@ void Draw ( ESContext *esContext )
    // Set the sampler texture unit to 0
    glUniform1i ( userData->shadowMapSamplerLoc, 0 );
 
-   DrawScene ( esContext, userData->sceneMvpLoc, userData->sceneMvpLightLoc );
+   DrawScene ( esContext, userData->sceneMvpLoc, userData->sceneMvpLightLoc, &userData->eyeFrustum );
 }
 
 ///
@@ -39,6 +39,12 @@
 
 #define POSITION_LOC    0
 
+// Rows of grid cells culled together, a strip is one range of the index buffer
+#define STRIP_ROWS      8
+
+// Highest the vertex shader lifts the grid, h / 2.5 for a height of 1
+#define MAX_HEIGHT      ( 1.0f / 2.5f )
+
 typedef struct
 {
    // Handle to a program object
@@ -51,8 +57,9 @@ typedef struct
    // Sampler location
    GLint samplerLoc;
 
-   // Texture handle
-   GLuint textureId;
+   // Texture loaded in the background, a handle of the stream
+   ESTextureStream *textureStream;
+   int textureId;
 
    // VBOs
    GLuint positionVBO;
@@ -64,41 +71,16 @@ typedef struct
    // dimension of grid
    int    gridSize;
 
+   // Boxes of the strips of the grid, min x, y, z and max x, y, z
+   int    numStrips;
+   GLfloat *stripCorners;
+   ESBoxArrays strips;
+   int    *visibleStrips;
+
    // MVP matrix
    ESMatrix  mvpMatrix;
 } UserData;
 
-///
-// Load texture from disk
-//
-GLuint LoadTexture (  void *ioContext, char *fileName )
-{
-   int width,
-       height;
-
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
-
-   if ( buffer == NULL )
-   {
-      esLogMessage ( "Error loading (%s) image.\n", fileName );
-      return 0;
-   }
-
-   glGenTextures ( 1, &texId );
-   glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0, GL_ALPHA, GL_UNSIGNED_BYTE, buffer );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-
-   free ( buffer );
-
-   return texId;
-}
-
 ///
 // Initialize the MVP matrix
 //
@@ -139,6 +121,7 @@ int Init ( ESContext *esContext )
 {
    GLfloat *positions;
    GLuint *indices;
+   int i, j;
 
    UserData *userData = esContext->userData;
    const char vShaderStr[] =
@@ -196,10 +179,17 @@ int Init ( ESContext *esContext )
    // Get the sampler location
    userData->samplerLoc = glGetUniformLocation ( userData->programObject, "s_texture" );
 
-   // Load the heightmap
-   userData->textureId = LoadTexture ( esContext->platformData, "heightmap.tga" );
+   // Load the heightmap, the terrain is flat until it is uploaded
+   userData->textureStream = esCreateTextureStream ( esContext->platformData, 2, 1 << 20 );
 
-   if ( userData->textureId == 0 )
+   if ( userData->textureStream == NULL )
+   {
+      return FALSE;
+   }
+
+   userData->textureId = esStreamTexture ( userData->textureStream, "heightmap.tga" );
+
+   if ( userData->textureId < 0 )
    {
       return FALSE;
    }
@@ -208,6 +198,40 @@ int Init ( ESContext *esContext )
    userData->gridSize = 200;
    userData->numIndices = esGenSquareGrid ( userData->gridSize, &positions, &indices );
 
+   // Bounds of the strips, from the flat grid up to the highest the terrain reaches
+   userData->numStrips = ( userData->gridSize - 1 + STRIP_ROWS - 1 ) / STRIP_ROWS;
+   userData->stripCorners = malloc ( sizeof ( GLfloat ) * 6 * userData->numStrips );
+   userData->visibleStrips = malloc ( sizeof ( int ) * userData->numStrips );
+
+   if ( userData->stripCorners == NULL || userData->visibleStrips == NULL )
+   {
+      return FALSE;
+   }
+
+   for ( i = 0; i < userData->numStrips; i++ )
+   {
+      int firstRow = i * STRIP_ROWS;
+      int lastRow = firstRow + STRIP_ROWS < userData->gridSize - 1 ? firstRow + STRIP_ROWS : userData->gridSize - 1;
+      ESBounds bounds;
+
+      esComputeBounds ( &bounds, positions + 3 * firstRow * userData->gridSize, 3,
+                        ( lastRow - firstRow + 1 ) * userData->gridSize );
+      bounds.max[2] += MAX_HEIGHT;
+
+      for ( j = 0; j < 3; j++ )
+      {
+         userData->stripCorners[j * userData->numStrips + i] = bounds.min[j];
+         userData->stripCorners[( j + 3 ) * userData->numStrips + i] = bounds.max[j];
+      }
+   }
+
+   userData->strips.minX = userData->stripCorners;
+   userData->strips.minY = userData->stripCorners + userData->numStrips;
+   userData->strips.minZ = userData->stripCorners + 2 * userData->numStrips;
+   userData->strips.maxX = userData->stripCorners + 3 * userData->numStrips;
+   userData->strips.maxY = userData->stripCorners + 4 * userData->numStrips;
+   userData->strips.maxZ = userData->stripCorners + 5 * userData->numStrips;
+
    // Index buffer for base terrain
    glGenBuffers ( 1, &userData->indicesIBO );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO );
@@ -235,9 +259,19 @@ int Init ( ESContext *esContext )
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   ESFrustumPlanes frustum;
+   int rowIndices, numVisible;
+   int i, j;
 
    InitMVP ( esContext );
 
+   // The strips in view, the grid is in the model space of the MVP
+   esFrustumPlanesFromMatrix ( &frustum, &userData->mvpMatrix );
+   numVisible = esCullBoxes ( &frustum, &userData->strips, userData->numStrips, userData->visibleStrips );
+
+   // Upload what has been loaded of the heightmap since the last frame
+   esUpdateTextureStream ( userData->textureStream );
+
    // Set the viewport
    glViewport ( 0, 0, esContext->width, esContext->height );
 
@@ -258,7 +292,7 @@ void Draw ( ESContext *esContext )
 
    // Bind the height map
    glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_2D, userData->textureId );
+   glBindTexture ( GL_TEXTURE_2D, esGetStreamTexture ( userData->textureStream, userData->textureId ) );
 
    // Load the MVP matrix
    glUniformMatrix4fv ( userData->mvpLoc, 1, GL_FALSE, ( GLfloat * ) &userData->mvpMatrix.m[0][0] );
@@ -269,8 +303,21 @@ void Draw ( ESContext *esContext )
    // Set the height map sampler to texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );
 
-   // Draw the grid
-   glDrawElements ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, ( const void * ) NULL );
+   // Draw the visible strips, the ones next to each other with one call
+   rowIndices = ( userData->gridSize - 1 ) * 6;
+
+   for ( i = 0; i < numVisible; i = j )
+   {
+      int first, last;
+
+      for ( j = i + 1; j < numVisible && userData->visibleStrips[j] == userData->visibleStrips[j - 1] + 1; j++ )
+         ;
+
+      first = userData->visibleStrips[i] * STRIP_ROWS * rowIndices;
+      last = ( userData->visibleStrips[j - 1] + 1 ) * STRIP_ROWS * rowIndices;
+      last = last < userData->numIndices ? last : userData->numIndices;
+      glDrawElements ( GL_TRIANGLES, last - first, GL_UNSIGNED_INT, ( const void * ) ( sizeof ( GLuint ) * first ) );
+   }
 }
 
 ///
@@ -283,6 +330,12 @@ void Shutdown ( ESContext *esContext )
    glDeleteBuffers ( 1, &userData->positionVBO );
    glDeleteBuffers ( 1, &userData->indicesIBO );
 
+   free ( userData->stripCorners );
+   free ( userData->visibleStrips );
+
+   // Delete texture object
+   esDestroyTextureStream ( userData->textureStream );
+
    // Delete program object
    glDeleteProgram ( userData->programObject );
 }
@@ -45,6 +45,7 @@
 
 
 #define NUM_INSTANCES   100
+#define PI              3.1415926535897932384626433832795f
 #define POSITION_LOC    0
 #define COLOR_LOC       1
 #define MVP_LOC         2
@@ -63,8 +64,13 @@ typedef struct
    // Number of indices
    int       numIndices;
 
-   // Rotation angle
-   GLfloat   angle[NUM_INSTANCES];
+   // Per-instance translation and rotation quaternion, one array per component
+   GLfloat   translate[3][NUM_INSTANCES];
+   GLfloat   rotate[4][NUM_INSTANCES];
+   ESTRSArrays trs;
+
+   // Threads computing the MVPs
+   ESThreadPool *pool;
 
 } UserData;
 
@@ -142,13 +148,37 @@ int Init ( ESContext *esContext )
    // Allocate storage to store MVP per instance
    {
       int instance;
+      int numRows = ( int ) sqrtf ( NUM_INSTANCES );
+      int numColumns = numRows;
 
-      // Random angle for each instance, compute the MVP later
       for ( instance = 0; instance < NUM_INSTANCES; instance++ )
       {
-         userData->angle[instance] = ( float ) ( random() % 32768 ) / 32767.0f * 360.0f;
+         // Random angle for each instance about the ( 1, 0, 1 ) axis, compute the MVP later
+         float halfAngle = ( float ) ( random() % 32768 ) / 32767.0f * PI;
+         float axis = sinf ( halfAngle ) * 0.70710678f;
+
+         userData->translate[0][instance] = ( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
+         userData->translate[1][instance] = ( ( float ) ( instance / numColumns ) / ( float ) numColumns ) * 2.0f - 1.0f;
+         userData->translate[2][instance] = -2.0f;
+
+         userData->rotate[0][instance] = axis;
+         userData->rotate[1][instance] = 0.0f;
+         userData->rotate[2][instance] = axis;
+         userData->rotate[3][instance] = cosf ( halfAngle );
       }
 
+      userData->trs.translateX = userData->translate[0];
+      userData->trs.translateY = userData->translate[1];
+      userData->trs.translateZ = userData->translate[2];
+      userData->trs.rotateX = userData->rotate[0];
+      userData->trs.rotateY = userData->rotate[1];
+      userData->trs.rotateZ = userData->rotate[2];
+      userData->trs.rotateW = userData->rotate[3];
+      userData->trs.scaleX = userData->trs.scaleY = userData->trs.scaleZ = NULL;
+
+      // Threads for esComposeTRSBatch, it runs on this thread if the pool is NULL
+      userData->pool = esCreateThreadPool ( 0 );
+
       glGenBuffers ( 1, &userData->mvpVBO );
       
 	  glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
@@ -170,9 +200,9 @@ void Update ( ESContext *esContext, float deltaTime )
    ESMatrix *matrixBuf;
    ESMatrix perspective;
    float    aspect;
+   float    halfAngle;
+   float    dx, dy, dz, dw;
    int      instance = 0;
-   int      numRows;
-   int      numColumns;
 
 
    // Compute the window aspect ratio
@@ -182,40 +212,34 @@ void Update ( ESContext *esContext, float deltaTime )
    esMatrixLoadIdentity ( &perspective );
    esPerspective ( &perspective, 60.0f, aspect, 1.0f, 20.0f );
 
-   glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
-   matrixBuf = ( ESMatrix * ) glMapBufferRange ( GL_ARRAY_BUFFER, 0, sizeof ( ESMatrix ) * NUM_INSTANCES, GL_MAP_WRITE_BIT );
-
-   // Compute a per-instance MVP that translates and rotates each instance differnetly
-   numRows = ( int ) sqrtf ( NUM_INSTANCES );
-   numColumns = numRows;
+   // Rotate every cube by deltaTime * 40 degrees about the ( 1, 0, 1 ) axis,
+   // the product of its quaternion with the one of this rotation
+   halfAngle = deltaTime * 40.0f * PI / 360.0f;
+   dx = dz = sinf ( halfAngle ) * 0.70710678f;
+   dy = 0.0f;
+   dw = cosf ( halfAngle );
 
    for ( instance = 0; instance < NUM_INSTANCES; instance++ )
    {
-      ESMatrix modelview;
-      float translateX = ( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
-      float translateY = ( ( float ) ( instance / numColumns ) / ( float ) numColumns ) * 2.0f - 1.0f;
-
-      // Generate a model view matrix to rotate/translate the cube
-      esMatrixLoadIdentity ( &modelview );
-
-      // Per-instance translation
-      esTranslate ( &modelview, translateX, translateY, -2.0f );
-
-      // Compute a rotation angle based on time to rotate the cube
-      userData->angle[instance] += ( deltaTime * 40.0f );
-
-      if ( userData->angle[instance] >= 360.0f )
-      {
-         userData->angle[instance] -= 360.0f;
-      }
+      float x = userData->rotate[0][instance];
+      float y = userData->rotate[1][instance];
+      float z = userData->rotate[2][instance];
+      float w = userData->rotate[3][instance];
+
+      userData->rotate[0][instance] = w * dx + x * dw + y * dz - z * dy;
+      userData->rotate[1][instance] = w * dy + y * dw + z * dx - x * dz;
+      userData->rotate[2][instance] = w * dz + z * dw + x * dy - y * dx;
+      userData->rotate[3][instance] = w * dw - x * dx - y * dy - z * dz;
+   }
 
-      // Rotate the cube
-      esRotate ( &modelview, userData->angle[instance], 1.0, 0.0, 1.0 );
+   // The whole buffer is rewritten, the driver need not keep its contents
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
+   matrixBuf = ( ESMatrix * ) glMapBufferRange ( GL_ARRAY_BUFFER, 0, sizeof ( ESMatrix ) * NUM_INSTANCES,
+                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
 
-      // Compute the final MVP by multiplying the
-      // modevleiw and perspective matrices together
-      esMatrixMultiply ( &matrixBuf[instance], &modelview, &perspective );
-   }
+   // Compute a per-instance MVP that translates and rotates each instance differently,
+   // four instances at a time straight into the buffer
+   esComposeTRSBatch ( userData->pool, matrixBuf, &userData->trs, &perspective, NUM_INSTANCES );
 
    glUnmapBuffer ( GL_ARRAY_BUFFER );
 }
@@ -289,6 +313,8 @@ void Shutdown ( ESContext *esContext )
    glDeleteBuffers ( 1, &userData->mvpVBO );
    glDeleteBuffers ( 1, &userData->indicesIBO );
 
+   esDestroyThreadPool ( userData->pool );
+
    // Delete program object
    glDeleteProgram ( userData->programObject );
 }
@@ -54,119 +54,6 @@ typedef struct
 } UserData;
 
 
-///
-//  From an RGB8 source image, generate the next level mipmap
-//
-GLboolean GenMipMap2D ( GLubyte *src, GLubyte **dst, int srcWidth, int srcHeight, int *dstWidth, int *dstHeight )
-{
-   int x,
-       y;
-   int texelSize = 3;
-
-   *dstWidth = srcWidth / 2;
-
-   if ( *dstWidth <= 0 )
-   {
-      *dstWidth = 1;
-   }
-
-   *dstHeight = srcHeight / 2;
-
-   if ( *dstHeight <= 0 )
-   {
-      *dstHeight = 1;
-   }
-
-   *dst = malloc ( sizeof ( GLubyte ) * texelSize * ( *dstWidth ) * ( *dstHeight ) );
-
-   if ( *dst == NULL )
-   {
-      return GL_FALSE;
-   }
-
-   for ( y = 0; y < *dstHeight; y++ )
-   {
-      for ( x = 0; x < *dstWidth; x++ )
-      {
-         int srcIndex[4];
-         float r = 0.0f,
-               g = 0.0f,
-               b = 0.0f;
-         int sample;
-
-         // Compute the offsets for 2x2 grid of pixels in previous
-         // image to perform box filter
-         srcIndex[0] =
-            ( ( ( y * 2 ) * srcWidth ) + ( x * 2 ) ) * texelSize;
-         srcIndex[1] =
-            ( ( ( y * 2 ) * srcWidth ) + ( x * 2 + 1 ) ) * texelSize;
-         srcIndex[2] =
-            ( ( ( ( y * 2 ) + 1 ) * srcWidth ) + ( x * 2 ) ) * texelSize;
-         srcIndex[3] =
-            ( ( ( ( y * 2 ) + 1 ) * srcWidth ) + ( x * 2 + 1 ) ) * texelSize;
-
-         // Sum all pixels
-         for ( sample = 0; sample < 4; sample++ )
-         {
-            r += src[srcIndex[sample]];
-            g += src[srcIndex[sample] + 1];
-            b += src[srcIndex[sample] + 2];
-         }
-
-         // Average results
-         r /= 4.0;
-         g /= 4.0;
-         b /= 4.0;
-
-         // Store resulting pixels
-         ( *dst ) [ ( y * ( *dstWidth ) + x ) * texelSize ] = ( GLubyte ) ( r );
-         ( *dst ) [ ( y * ( *dstWidth ) + x ) * texelSize + 1] = ( GLubyte ) ( g );
-         ( *dst ) [ ( y * ( *dstWidth ) + x ) * texelSize + 2] = ( GLubyte ) ( b );
-      }
-   }
-
-   return GL_TRUE;
-}
-
-///
-//  Generate an RGB8 checkerboard image
-//
-GLubyte *GenCheckImage ( int width, int height, int checkSize )
-{
-   int x,
-       y;
-   GLubyte *pixels = malloc ( width * height * 3 );
-
-   if ( pixels == NULL )
-   {
-      return NULL;
-   }
-
-   for ( y = 0; y < height; y++ )
-      for ( x = 0; x < width; x++ )
-      {
-         GLubyte rColor = 0;
-         GLubyte bColor = 0;
-
-         if ( ( x / checkSize ) % 2 == 0 )
-         {
-            rColor = 255 * ( ( y / checkSize ) % 2 );
-            bColor = 255 * ( 1 - ( ( y / checkSize ) % 2 ) );
-         }
-         else
-         {
-            bColor = 255 * ( ( y / checkSize ) % 2 );
-            rColor = 255 * ( 1 - ( ( y / checkSize ) % 2 ) );
-         }
-
-         pixels[ ( y * width + x ) * 3] = rColor;
-         pixels[ ( y * width + x ) * 3 + 1] = 0;
-         pixels[ ( y * width + x ) * 3 + 2] = bColor;
-      }
-
-   return pixels;
-}
-
 ///
 // Create a mipmapped 2D texture image
 //
@@ -176,58 +63,37 @@ GLuint CreateMipMappedTexture2D( )
    GLuint textureId;
    int    width = 256,
           height = 256;
-   int    level;
    GLubyte *pixels;
-   GLubyte *prevImage;
-   GLubyte *newImage;
+   ESMipChain chain;
+   ESProceduralTexture checker = { ES_PROCEDURAL_CHECKER, 8.0f, 0.0f, { 0, 0, 255, 255 }, { 255, 0, 0, 255 }, 0 };
+
+   // An RGB8 checkerboard, blue in the bottom left corner
+   pixels = malloc ( width * height * 3 );
 
-   pixels = GenCheckImage ( width, height, 8 );
+   if ( pixels == NULL || !esGenTexture ( NULL, &checker, width, height, 1, GL_RGB, pixels ) )
+   {
+      free ( pixels );
+      return 0;
+   }
 
-   if ( pixels == NULL )
+   // Generate all the mipmap levels, down to 1x1
+   if ( !esBuildMipChain ( &chain, pixels, width, height, GL_RGB, GL_UNSIGNED_BYTE, GL_FALSE ) )
    {
+      free ( pixels );
       return 0;
    }
 
+   free ( pixels );
+
    // Generate a texture object
    glGenTextures ( 1, &textureId );
 
    // Bind the texture object
    glBindTexture ( GL_TEXTURE_2D, textureId );
 
-   // Load mipmap level 0
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height,
-                  0, GL_RGB, GL_UNSIGNED_BYTE, pixels );
-
-   level = 1;
-   prevImage = &pixels[0];
-
-   while ( width > 1 && height > 1 )
-   {
-      int newWidth,
-          newHeight;
-
-      // Generate the next mipmap level
-      GenMipMap2D ( prevImage, &newImage, width, height,
-                    &newWidth, &newHeight );
-
-      // Load the mipmap level
-      glTexImage2D ( GL_TEXTURE_2D, level, GL_RGB,
-                     newWidth, newHeight, 0, GL_RGB,
-                     GL_UNSIGNED_BYTE, newImage );
-
-      // Free the previous image
-      free ( prevImage );
-
-      // Set the previous image for the next iteration
-      prevImage = newImage;
-      level++;
-
-      // Half the width and height
-      width = newWidth;
-      height = newHeight;
-   }
-
-   free ( newImage );
+   // Load the mipmap levels
+   esTexImageMipChain ( GL_TEXTURE_2D, &chain );
+   esFreeMipChain ( &chain );
 
    // Set the filtering mode
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );
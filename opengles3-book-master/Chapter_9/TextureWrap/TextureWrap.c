@@ -53,45 +53,6 @@ typedef struct
 
 } UserData;
 
-///
-//  Generate an RGB8 checkerboard image
-//
-GLubyte *GenCheckImage ( int width, int height, int checkSize )
-{
-   int x,
-       y;
-   GLubyte *pixels = malloc ( width * height * 3 );
-
-   if ( pixels == NULL )
-   {
-      return NULL;
-   }
-
-   for ( y = 0; y < height; y++ )
-      for ( x = 0; x < width; x++ )
-      {
-         GLubyte rColor = 0;
-         GLubyte bColor = 0;
-
-         if ( ( x / checkSize ) % 2 == 0 )
-         {
-            rColor = 255 * ( ( y / checkSize ) % 2 );
-            bColor = 255 * ( 1 - ( ( y / checkSize ) % 2 ) );
-         }
-         else
-         {
-            bColor = 255 * ( ( y / checkSize ) % 2 );
-            rColor = 255 * ( 1 - ( ( y / checkSize ) % 2 ) );
-         }
-
-         pixels[ ( y * width + x ) * 3] = rColor;
-         pixels[ ( y * width + x ) * 3 + 1] = 0;
-         pixels[ ( y * width + x ) * 3 + 2] = bColor;
-      }
-
-   return pixels;
-}
-
 ///
 // Create a mipmapped 2D texture image
 //
@@ -99,16 +60,7 @@ GLuint CreateTexture2D( )
 {
    // Texture object handle
    GLuint textureId;
-   int    width = 256,
-          height = 256;
-   GLubyte *pixels;
-
-   pixels = GenCheckImage ( width, height, 64 );
-
-   if ( pixels == NULL )
-   {
-      return 0;
-   }
+   ESProceduralTexture checker = { ES_PROCEDURAL_CHECKER, 64.0f, 0.0f, { 0, 0, 255, 255 }, { 255, 0, 0, 255 }, 0 };
 
    // Generate a texture object
    glGenTextures ( 1, &textureId );
@@ -116,9 +68,12 @@ GLuint CreateTexture2D( )
    // Bind the texture object
    glBindTexture ( GL_TEXTURE_2D, textureId );
 
-   // Load mipmap level 0
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height,
-                  0, GL_RGB, GL_UNSIGNED_BYTE, pixels );
+   // Load mipmap level 0, an RGB8 checkerboard generated into the pixel unpack buffer
+   if ( !esTexImageProcedural ( NULL, GL_TEXTURE_2D, &checker, 256, 256, 1, GL_RGB ) )
+   {
+      glDeleteTextures ( 1, &textureId );
+      return 0;
+   }
 
    // Set the filtering mode
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
@@ -90,11 +90,391 @@ extern "C" {
 #define TRUE 1
 #endif
 
-typedef struct
+/// 16 byte aligned, a row of a matrix never straddles a cache line.  Only on 64-bit targets
+/// and Apple, where malloc returns 16 byte aligned memory: the samples malloc the UserData
+/// holding their matrices, which is 8 byte aligned on 32-bit x86, ARM and Android.  Elsewhere
+/// ESMatrix keeps the alignment of a float, and the SIMD code loads its rows unaligned.
+#if defined(_MSC_VER) && defined(_WIN64)
+#define ES_ALIGN16 __declspec(align(16))
+#elif defined(__GNUC__) && ( defined(__x86_64__) || defined(__aarch64__) || defined(__APPLE__) )
+#define ES_ALIGN16 __attribute__ ((aligned (16)))
+#else
+#define ES_ALIGN16
+#endif
+
+typedef struct ES_ALIGN16
 {
    GLfloat   m[4][4];
 } ESMatrix;
 
+typedef struct
+{
+   /// Pointer to the first byte of the mapped file, NULL for an empty file
+   const unsigned char *data;
+
+   /// Size of the mapped file in bytes
+   size_t      size;
+
+   /// Platform specific handles, owned by esMapFile / esUnmapFile
+   void       *fileHandle;
+   void       *mapHandle;
+} ESMappedFile;
+
+typedef struct
+{
+   /// Size of the image in pixels
+   int         width;
+   int         height;
+
+   /// 1 (gray), 2 (R5G5B5A1 shorts), 3 (BGR) or 4 (BGRA)
+   int         bytesPerPixel;
+
+   /// GL_TRUE when the first row of pixels is the top of the image, GL wants the bottom one first
+   GLboolean   topDown;
+
+   /// Tightly packed rows, pointing into the mapped file for uncompressed 8, 24 and 32-bit images
+   const unsigned char *pixels;
+
+   /// Owned by esMapTGA / esFreeTGA: pixels decoded from RLE or 16-bit, the mapping of the file
+   unsigned char *decoded;
+   ESMappedFile file;
+} ESImage;
+
+/// Worker threads created by esCreateThreadPool, the layout is private to esUtil.c
+typedef struct ESThreadPool ESThreadPool;
+
+/// Textures loaded on a background thread, created by esCreateTextureStream, the layout is private to esTextureStream.c
+typedef struct ESTextureStream ESTextureStream;
+
+/// Rotation as a quaternion, the one esQuaternionFromAxisAngle makes of an angle and an axis.  It turns
+/// vectors the way the matrix of esRotate does, and of any nonzero length unless noted otherwise.
+typedef struct
+{
+   GLfloat   x;
+   GLfloat   y;
+   GLfloat   z;
+   GLfloat   w;
+} ESQuaternion;
+
+/// Rotation followed by a translation, a rigid transform that composes like a quaternion
+typedef struct
+{
+   /// The rotation
+   ESQuaternion real;
+
+   /// real * ( -translation, 0 ) / 2, built by esDualQuaternionFromRotationTranslation
+   ESQuaternion dual;
+} ESDualQuaternion;
+
+/// Per instance transforms for esComposeTRSBatch, one array per component
+typedef struct
+{
+   /// Translation, applied first like esTranslate
+   const GLfloat *translateX;
+   const GLfloat *translateY;
+   const GLfloat *translateZ;
+
+   /// Rotation quaternion, of any nonzero length.  esRotate ( m, angle, x, y, z ) for a unit axis is
+   /// ( x, y, z ) * sin ( angle / 2 ) and w = cos ( angle / 2 ).  All NULL for no rotation.
+   const GLfloat *rotateX;
+   const GLfloat *rotateY;
+   const GLfloat *rotateZ;
+   const GLfloat *rotateW;
+
+   /// Scale, applied last like esScale.  All NULL for a scale of 1.
+   const GLfloat *scaleX;
+   const GLfloat *scaleY;
+   const GLfloat *scaleZ;
+} ESTRSArrays;
+
+/// The six planes of a view frustum, made by esFrustumPlanesFromMatrix.  a * x + b * y + c * z + d is
+/// the distance of a point from the plane ( a, b, c, d ), positive on the inside.
+typedef struct
+{
+   /// Left, right, bottom, top, near and far
+   GLfloat   planes[6][4];
+} ESFrustumPlanes;
+
+/// Bounding box of some positions and the sphere around its center, made by esComputeBounds
+typedef struct
+{
+   GLfloat   min[3];
+   GLfloat   max[3];
+   GLfloat   center[3];
+   GLfloat   radius;
+} ESBounds;
+
+/// Bounding spheres for esCullSpheres, one array per component
+typedef struct
+{
+   const GLfloat *centerX;
+   const GLfloat *centerY;
+   const GLfloat *centerZ;
+   const GLfloat *radius;
+} ESSphereArrays;
+
+/// Axis aligned bounding boxes for esCullBoxes, one array per component
+typedef struct
+{
+   const GLfloat *minX;
+   const GLfloat *minY;
+   const GLfloat *minZ;
+   const GLfloat *maxX;
+   const GLfloat *maxY;
+   const GLfloat *maxZ;
+} ESBoxArrays;
+
+/// Textures shared by file name, created by esCreateTextureCache, the layout is private to esTextureCache.c
+typedef struct ESTextureCache ESTextureCache;
+
+typedef struct
+{
+   /// esAcquireTexture calls served from the cache and calls loading the file
+   int         hits;
+   int         misses;
+
+   /// Unreferenced textures deleted to stay within the budget
+   int         evictions;
+
+   /// Textures held now and how many of them are referenced
+   int         textureCount;
+   int         referencedCount;
+
+   /// Estimated memory of the textures held (RGB counted as RGBA, mip levels included)
+   GLsizeiptr  residentBytes;
+
+   /// Pixel bytes uploaded by all the misses
+   GLsizeiptr  uploadedBytes;
+} ESTextureCacheStats;
+
+typedef struct
+{
+   /// GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+   GLenum      target;
+
+   /// Sized internal format of the file, a compressed one for ETC2 / EAC
+   GLenum      internalFormat;
+
+   /// Size of level 0 and number of levels uploaded
+   int         width;
+   int         height;
+   int         levelCount;
+
+   /// Bytes of image data uploaded, every level and face
+   GLsizeiptr  bytes;
+} ESTextureInfo;
+
+/// Most levels of an ESMipChain, enough for 32768 pixels
+#define ES_MAX_MIP_LEVELS 16
+
+typedef struct
+{
+   /// GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA of GL_UNSIGNED_BYTE or GL_FLOAT
+   GLenum      format;
+   GLenum      type;
+
+   /// GL_TRUE when 8-bit colors are sRGB encoded and were filtered in linear space
+   GLboolean   srgb;
+
+   /// Bytes of one pixel
+   int         pixelSize;
+
+   /// Levels down to 1x1: size in pixels and byte offset into pixels of each one
+   int         levelCount;
+   int         width[ES_MAX_MIP_LEVELS];
+   int         height[ES_MAX_MIP_LEVELS];
+   size_t      offset[ES_MAX_MIP_LEVELS];
+
+   /// Tightly packed rows of all the levels in one allocation, owned by esBuildMipChain / esFreeMipChain
+   unsigned char *pixels;
+   size_t      size;
+} ESMipChain;
+
+/// Most layers of an atlas built for GL_TEXTURE_2D_ARRAY, the least any GL ES 3.0 allows
+#define ES_MAX_ATLAS_LAYERS 256
+
+typedef struct
+{
+   /// Layer holding the image, 0 in an atlas of one layer
+   int         layer;
+
+   /// Pixels of the image in its layer, the gutter around them excluded
+   int         x;
+   int         y;
+   int         width;
+   int         height;
+
+   /// Texture coordinates of the image map into the atlas as uv * scale + offset
+   GLfloat     scale[2];
+   GLfloat     offset[2];
+} ESAtlasRegion;
+
+typedef struct
+{
+   /// Size of every layer in pixels, and the number of layers
+   int         width;
+   int         height;
+   int         layerCount;
+
+   /// Levels that never mix texels of two images, GL_TEXTURE_MAX_LEVEL is levelCount - 1
+   int         levelCount;
+
+   /// One region per image, in the order the images were given
+   int         regionCount;
+   ESAtlasRegion *regions;
+
+   /// Pixels of the images over the pixels of all the layers
+   GLfloat     efficiency;
+
+   /// RGBA rows of level 0 of every layer, bottom row first, owned by esBuildAtlas / esFreeAtlas
+   unsigned char *pixels;
+} ESAtlas;
+
+/// Generators of esGenTexture
+#define ES_PROCEDURAL_CHECKER          0
+#define ES_PROCEDURAL_LINEAR_GRADIENT  1
+#define ES_PROCEDURAL_RADIAL_GRADIENT  2
+#define ES_PROCEDURAL_VALUE_NOISE      3
+#define ES_PROCEDURAL_PERLIN_NOISE     4
+#define ES_PROCEDURAL_CELLULAR_NOISE   5
+
+typedef struct
+{
+   /// One of the ES_PROCEDURAL_ generators
+   int         type;
+
+   /// Texels per checker square or noise lattice cell, along every axis
+   GLfloat     cellSize;
+
+   /// Direction of a linear gradient in radians, 0 runs from left to right
+   GLfloat     angle;
+
+   /// Colors at 0 and at 1: the two checker colors, the ends of a gradient or the range of a noise
+   GLubyte     color0[4];
+   GLubyte     color1[4];
+
+   /// Picks the lattice of the noises, the same seed gives the same texels
+   GLuint      seed;
+} ESProceduralTexture;
+
+typedef struct
+{
+   /// Permutation of 0 to 255 hashing the corners of a lattice cell
+   GLubyte     permutation[256];
+
+   /// Gradient at a corner, by its hash
+   GLfloat     gradients[256][3];
+} ESNoiseLattice;
+
+typedef struct
+{
+   /// Voxels along every axis
+   int         size;
+
+   /// Lattice cells along every axis in the first octave
+   GLfloat     frequency;
+
+   /// Octaves summed, each at lacunarity times the frequency and gain times the amplitude of the one before
+   int         octaves;
+   GLfloat     lacunarity;
+   GLfloat     gain;
+
+   /// GL_TRUE to round every octave to whole cells that wrap around, so the volume can be repeated
+   GLboolean   tileable;
+} ESNoiseVolume;
+
+/// Vertex attributes of a POD mesh
+#define ES_POD_POSITION         0
+#define ES_POD_NORMAL           1
+#define ES_POD_TANGENT          2
+#define ES_POD_BINORMAL         3
+#define ES_POD_UV0              4
+#define ES_POD_COLOR            5
+#define ES_POD_ATTRIBUTE_COUNT  6
+
+typedef struct
+{
+   /// Components, 0 when the mesh has no such attribute, and their type for glVertexAttribPointer
+   GLint       size;
+   GLenum      type;
+   GLboolean   normalized;
+
+   /// Byte offset of the attribute in a vertex
+   GLsizei     offset;
+} ESPODAttribute;
+
+typedef struct
+{
+   /// Interleaved vertices for glBufferData ( GL_ARRAY_BUFFER ), pointing into the mapped file
+   const void *vertices;
+   GLsizeiptr  vertexBytes;
+   GLsizei     stride;
+   int         vertexCount;
+
+   /// Triangle list for glBufferData ( GL_ELEMENT_ARRAY_BUFFER ), pointing into the mapped file,
+   /// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.  NULL when the vertices are drawn in order.
+   const void *indices;
+   GLsizeiptr  indexBytes;
+   GLenum      indexType;
+   int         indexCount;
+
+   /// Indexed by ES_POD_POSITION ... ES_POD_COLOR
+   ESPODAttribute attributes[ES_POD_ATTRIBUTE_COUNT];
+} ESPODMesh;
+
+typedef struct
+{
+   /// Strings point into the mapped file, NULL when the file has none
+   const char *name;
+
+   /// Indices into the arrays of the scene, -1 for none.  Only mesh nodes have a mesh.
+   int         meshIndex;
+   int         materialIndex;
+   int         parentIndex;
+
+   /// Transform of the first frame, the rotation a quaternion x, y, z, w
+   GLfloat     position[3];
+   GLfloat     rotation[4];
+   GLfloat     scale[3];
+} ESPODNode;
+
+typedef struct
+{
+   /// Strings point into the mapped file, NULL when the file has none
+   const char *name;
+   const char *effectFile;
+   const char *effectName;
+
+   /// Index into the texture files of the scene, -1 for none
+   int         diffuseTexture;
+
+   GLfloat     ambient[3];
+   GLfloat     diffuse[3];
+   GLfloat     specular[3];
+   GLfloat     shininess;
+   GLfloat     opacity;
+} ESPODMaterial;
+
+typedef struct
+{
+   int            meshCount;
+   ESPODMesh     *meshes;
+
+   /// Mesh nodes first, then lights and cameras
+   int            nodeCount;
+   ESPODNode     *nodes;
+
+   int            materialCount;
+   ESPODMaterial *materials;
+
+   /// File names pointing into the mapped file
+   int            textureCount;
+   const char   **textureFiles;
+
+   /// Owned by esLoadPOD / esFreePOD: the mapping of the file the meshes and strings point into
+   ESMappedFile   file;
+} ESPODScene;
+
 typedef struct ESContext ESContext;
 
 struct ESContext
@@ -249,15 +629,359 @@ int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
 int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices );
 
 //
-/// \brief Loads a 8-bit, 24-bit or 32-bit TGA image from a file
+/// \brief Loads a 8-bit, 16-bit, 24-bit or 32-bit TGA image from a file, uncompressed or RLE
 /// \param ioContext Context related to IO facility on the platform
 /// \param fileName Name of the file on disk
 /// \param width Width of loaded image in pixels
 /// \param height Height of loaded image in pixels
-///  \return Pointer to loaded image.  NULL on failure.
+///  \return Pointer to a copy of the image, RGB or RGBA (one byte for gray images, RGB for 16-bit ones)
+///          with the bottom row first.  NULL on failure.
 //
 char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height );
 
+//
+/// \brief Map a TGA file without copying it: uncompressed 8, 24 and 32-bit images are used
+///        straight from the mapping, RLE and 16-bit images are decoded once
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param image Receives the image, release it with esFreeTGA
+/// \return GL_TRUE if the file is a supported TGA image, GL_FALSE otherwise
+//
+GLboolean ESUTIL_API esMapTGA ( void *ioContext, const char *fileName, ESImage *image );
+
+//
+/// \brief glTexImage2D of an image from esMapTGA into the bound texture, with the unpack state it needs.
+///        BGR(A) is put right by the texture swizzle, gray is swizzled into every channel
+/// \param target GL_TEXTURE_2D or a cube map face
+/// \param level Mip level to define
+/// \param image The image to upload
+/// \return GL_TRUE if the image has a format GL can take
+//
+GLboolean ESUTIL_API esTexImageTGA ( GLenum target, GLint level, const ESImage *image );
+
+//
+/// \brief Release an image from esMapTGA
+/// \param image The image to release
+//
+void ESUTIL_API esFreeTGA ( ESImage *image );
+
+//
+/// \brief Upload a KTX 1.1 or KTX 2.0 file into the bound texture straight from a mapping of it, every
+///        level it holds with glCompressedTexImage2D for ETC2 / EAC and glTexImage2D otherwise.  Sets
+///        GL_TEXTURE_MAX_LEVEL to the last of them.  KTX 2.0 supercompression is not supported.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param target GL_TEXTURE_2D, or GL_TEXTURE_CUBE_MAP for a file of 6 faces
+/// \param info Receives the format and size of the texture, may be NULL
+/// \return GL_TRUE if the whole file was uploaded
+//
+GLboolean ESUTIL_API esTexImageKTX ( void *ioContext, const char *fileName, GLenum target, ESTextureInfo *info );
+
+//
+/// \brief Upload a PVR v3 file, or a v2 one, into the bound texture straight from a mapping of it,
+///        every level it holds.  Takes ETC1 / ETC2 / EAC, 8-bit and 16-bit uncompressed formats,
+///        PVRTC where the GL has GL_IMG_texture_compression_pvrtc.  Sets GL_TEXTURE_MAX_LEVEL.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param target GL_TEXTURE_2D, or GL_TEXTURE_CUBE_MAP for a file of 6 faces
+/// \param info Receives the format and size of the texture, may be NULL
+/// \return GL_TRUE if the whole file was uploaded
+//
+GLboolean ESUTIL_API esTexImagePVR ( void *ioContext, const char *fileName, GLenum target, ESTextureInfo *info );
+
+//
+/// \brief Start a thread loading TGA files for the GL thread to upload a little at a time: the thread
+///        copies the pixels into a ring of mapped pixel unpack buffers, esUpdateTextureStream only
+///        issues glTexSubImage2D from them.  Call with the GL context current.
+/// \param ioContext Context related to IO facility on the platform
+/// \param slotCount Number of pixel unpack buffers in the ring
+/// \param frameBudget Bytes uploaded by one esUpdateTextureStream at most, images bigger than that are
+///        uploaded in bands of rows over several frames
+/// \return The stream, NULL on failure
+//
+ESTextureStream *ESUTIL_API esCreateTextureStream ( void *ioContext, int slotCount, GLsizeiptr frameBudget );
+
+//
+/// \brief Queue a TGA file for loading, see esMapTGA for the formats
+/// \param stream The stream
+/// \param fileName Name of the file on disk
+/// \return Handle of the texture for esGetStreamTexture, -1 on failure
+//
+int ESUTIL_API esStreamTexture ( ESTextureStream *stream, const char *fileName );
+
+//
+/// \brief Texture to bind for a file queued with esStreamTexture: a 2x2 placeholder until the image is
+///        completely uploaded (for good if it fails to load), then the texture holding it, filtered
+///        GL_LINEAR and clamped to edge.  The stream owns both.
+/// \param stream The stream
+/// \param texture Handle from esStreamTexture
+//
+GLuint ESUTIL_API esGetStreamTexture ( const ESTextureStream *stream, int texture );
+
+//
+/// \brief Upload the rows the thread has copied, within the frame budget, and hand it the next ones.
+///        Call once per frame on the GL thread.
+/// \param stream The stream
+/// \return Number of files still loading
+//
+int ESUTIL_API esUpdateTextureStream ( ESTextureStream *stream );
+
+//
+/// \brief Stop the thread, delete the buffers and the textures of the stream
+/// \param stream The stream to destroy
+//
+void ESUTIL_API esDestroyTextureStream ( ESTextureStream *stream );
+
+//
+/// \brief Create a cache loading each TGA file once per set of sampler parameters
+/// \param ioContext Context related to IO facility on the platform
+/// \param budget Bytes of texture memory above which unreferenced textures are deleted, least
+///        recently used first.  0 keeps them until esDestroyTextureCache.
+/// \return The cache, NULL on failure
+//
+ESTextureCache *ESUTIL_API esCreateTextureCache ( void *ioContext, GLsizeiptr budget );
+
+//
+/// \brief Reference the texture of a file, loading it on a miss with esTexImageKTX for names ending in
+///        .ktx or .ktx2, esTexImagePVR for .pvr, with esMapTGA / esTexImageTGA otherwise
+/// \param cache The cache
+/// \param fileName Name of the file on disk
+/// \param filter GL_TEXTURE_MIN_FILTER, a mipmap filter generates the mip levels of TGA files.  The mag filter
+///        is GL_NEAREST or GL_LINEAR to match.
+/// \param wrap GL_TEXTURE_WRAP_S and GL_TEXTURE_WRAP_T
+/// \return The texture, 0 if the file can't be loaded
+//
+GLuint ESUTIL_API esAcquireTexture ( ESTextureCache *cache, const char *fileName, GLint filter, GLint wrap );
+
+//
+/// \brief Drop a reference taken by esAcquireTexture, the texture stays cached while the budget allows
+/// \param cache The cache
+/// \param texture Texture from esAcquireTexture
+//
+void ESUTIL_API esReleaseTexture ( ESTextureCache *cache, GLuint texture );
+
+//
+/// \brief Hit, miss and memory counters of a cache, for profiling
+/// \param cache The cache
+/// \param stats Receives the counters
+//
+void ESUTIL_API esGetTextureCacheStats ( const ESTextureCache *cache, ESTextureCacheStats *stats );
+
+//
+/// \brief Delete every texture of the cache, referenced or not
+/// \param cache The cache to destroy
+//
+void ESUTIL_API esDestroyTextureCache ( ESTextureCache *cache );
+
+//
+/// \brief Box filter an image down to 1x1 into one allocation holding every level.  Even sizes average
+///        2x2 pixels with SSE2 / NEON, odd sizes are filtered with 3 taps so no row or column is dropped.
+/// \param chain Receives the levels, release them with esFreeMipChain
+/// \param pixels Level 0, tightly packed rows
+/// \param width, height Size of level 0 in pixels
+/// \param format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA
+/// \param type GL_UNSIGNED_BYTE or GL_FLOAT
+/// \param srgb GL_TRUE to filter 8-bit colors in linear space and store them sRGB encoded, alpha
+///        stays linear.  Ignored for floats.
+/// \return GL_FALSE for an unsupported format or when out of memory
+//
+GLboolean ESUTIL_API esBuildMipChain ( ESMipChain *chain, const void *pixels, int width, int height,
+                                       GLenum format, GLenum type, GLboolean srgb );
+
+//
+/// \brief glTexImage2D of every level of a chain into the bound texture, with sized formats: RGB(A)8,
+///        SRGB8(_ALPHA8) or 16-bit floats, L / LA as R / RG swizzled
+/// \param target GL_TEXTURE_2D or a cube map face
+/// \param chain Levels from esBuildMipChain
+/// \return GL_FALSE if the chain holds no levels
+//
+GLboolean ESUTIL_API esTexImageMipChain ( GLenum target, const ESMipChain *chain );
+
+//
+/// \brief Release the levels of a chain from esBuildMipChain
+/// \param chain The chain to release
+//
+void ESUTIL_API esFreeMipChain ( ESMipChain *chain );
+
+//
+/// \brief Pack images into the layers of an atlas with a skyline packer, tallest first.  Every image
+///        sits in a cell of its edge pixels repeated 2^(levelCount - 1) times on each side, aligned
+///        to as many pixels, so neither bilinear filtering nor the first levelCount levels mix two
+///        images.  Layers get the size taking the least memory, a multiple of the gutter.
+/// \param atlas Receives the layers and the region of every image, release it with esFreeAtlas
+/// \param images Images from esMapTGA, or pixels of the caller in the same layout
+/// \param count Number of images
+/// \param maxSize Largest width and height of a layer, GL_MAX_TEXTURE_SIZE or less
+/// \param levelCount Mip levels that must stay clean, 1 for bilinear filtering only
+/// \param layered GL_TRUE to spread the images over up to ES_MAX_ATLAS_LAYERS layers of a
+///        GL_TEXTURE_2D_ARRAY, GL_FALSE to fail unless they fit into one layer
+/// \return GL_FALSE if the images don't fit or when out of memory
+//
+GLboolean ESUTIL_API esBuildAtlas ( ESAtlas *atlas, const ESImage *images, int count, int maxSize,
+                                    int levelCount, GLboolean layered );
+
+//
+/// \brief Upload an atlas into the bound texture with the levelCount levels of it that stay clean,
+///        sets GL_TEXTURE_MAX_LEVEL
+/// \param target GL_TEXTURE_2D for an atlas of one layer, or GL_TEXTURE_2D_ARRAY
+/// \param atlas The atlas from esBuildAtlas
+/// \return GL_FALSE if the atlas doesn't fit target or when out of memory
+//
+GLboolean ESUTIL_API esTexImageAtlas ( GLenum target, const ESAtlas *atlas );
+
+//
+/// \brief Release the layers and the regions of an atlas from esBuildAtlas
+/// \param atlas The atlas to release
+//
+void ESUTIL_API esFreeAtlas ( ESAtlas *atlas );
+
+//
+/// \brief Generate the texels of a procedural texture, rows of 4 texels at a time with SSE2 / NEON and
+///        bands of rows of every slice spread over the threads of a pool
+/// \param pool Thread pool from esCreateThreadPool, NULL to generate on the calling thread
+/// \param texture The generator and its parameters
+/// \param width, height, depth Size in texels, depth 1 for a 2D texture
+/// \param format GL_RED, GL_RG, GL_RGB or GL_RGBA of GL_UNSIGNED_BYTE
+/// \param pixels Receives tightly packed rows, bottom row of the first slice first
+/// \return GL_FALSE for an unsupported format or size
+//
+GLboolean ESUTIL_API esGenTexture ( ESThreadPool *pool, const ESProceduralTexture *texture,
+                                    int width, int height, int depth, GLenum format, void *pixels );
+
+//
+/// \brief Generate a procedural texture straight into a mapped GL_PIXEL_UNPACK_BUFFER and upload
+///        it to level 0 of the bound texture with a sized format: R8, RG8, RGB8 or RGBA8
+/// \param pool Thread pool from esCreateThreadPool, NULL to generate on the calling thread
+/// \param target GL_TEXTURE_2D or a cube map face for a depth of 1, GL_TEXTURE_3D or GL_TEXTURE_2D_ARRAY
+/// \param texture The generator and its parameters
+/// \param width, height, depth Size in texels
+/// \param format GL_RED, GL_RG, GL_RGB or GL_RGBA
+/// \return GL_FALSE for an unsupported format or when the buffer can't be mapped
+//
+GLboolean ESUTIL_API esTexImageProcedural ( ESThreadPool *pool, GLenum target, const ESProceduralTexture *texture,
+                                            int width, int height, int depth, GLenum format );
+
+//
+/// \brief Build a cube of gradient noise normalized to 0 - 255.  Voxel ( x, y, z ) is the noise at
+///        ( x, y, z ) / size * frequency with the corners of its cell hashed as
+///        permutation[( x + permutation[( y + permutation[z & 255] ) & 255] ) & 255], the result the
+///        same as one noise evaluation per voxel.  Slices run on the threads of a pool, 4 voxels at a
+///        time with SSE2 / NEON.
+/// \param pool Thread pool from esCreateThreadPool, NULL to build on the calling thread
+/// \param lattice Permutation and gradients of the lattice
+/// \param size Voxels along every axis
+/// \param frequency Lattice cells along every axis
+/// \param texels Receives size^3 bytes, x fastest then y then z
+/// \return GL_FALSE for an empty volume or when out of memory
+//
+GLboolean ESUTIL_API esBuildNoiseVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice, int size,
+                                          GLfloat frequency, GLubyte *texels );
+
+//
+/// \brief esBuildNoiseVolume straight into a mapped GL_PIXEL_UNPACK_BUFFER, uploaded as GL_R8 to level 0
+///        of the bound GL_TEXTURE_3D
+/// \param pool Thread pool from esCreateThreadPool, NULL to build on the calling thread
+/// \param lattice Permutation and gradients of the lattice
+/// \param size Voxels along every axis
+/// \param frequency Lattice cells along every axis
+/// \return GL_FALSE when the buffer can't be mapped or when out of memory
+//
+GLboolean ESUTIL_API esTexImageNoiseVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice, int size,
+                                             GLfloat frequency );
+
+//
+/// \brief Build a cube of fractal noise normalized to 0 - 255: the octaves of volume summed per voxel, the
+///        first one the noise of esBuildNoiseVolume
+/// \param pool Thread pool from esCreateThreadPool, NULL to build on the calling thread
+/// \param lattice Permutation and gradients of the lattice
+/// \param volume Size, octaves and tiling of the volume
+/// \param texels Receives size^3 bytes, x fastest then y then z
+/// \return GL_FALSE for an empty volume, no octave or when out of memory
+//
+GLboolean ESUTIL_API esBuildFbmVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice,
+                                        const ESNoiseVolume *volume, GLubyte *texels );
+
+//
+/// \brief esBuildFbmVolume uploaded as GL_R8 to level 0 of the bound GL_TEXTURE_3D.  With a cache
+///        directory the texels are kept in a file named after a hash of the lattice and the volume,
+///        mapped and uploaded instead of built on every later call.
+/// \param pool Thread pool from esCreateThreadPool, NULL to build on the calling thread
+/// \param lattice Permutation and gradients of the lattice
+/// \param volume Size, octaves and tiling of the volume
+/// \param cacheDir Writable directory of the cache files, NULL to build into a mapped
+///        GL_PIXEL_UNPACK_BUFFER every time
+/// \return GL_FALSE when the volume can't be built
+//
+GLboolean ESUTIL_API esTexImageFbmVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice,
+                                           const ESNoiseVolume *volume, const char *cacheDir );
+
+//
+/// \brief Map a POD scene and find its meshes, nodes, materials and textures without copying the
+///        vertex and index data: the meshes point into the mapping, ready for glBufferData.
+///        Meshes must be exported interleaved and as triangle lists.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param scene Receives the scene, release it with esFreePOD once the buffers are filled
+/// \return GL_TRUE if the file is a POD scene that can be drawn this way
+//
+GLboolean ESUTIL_API esLoadPOD ( void *ioContext, const char *fileName, ESPODScene *scene );
+
+//
+/// \brief Release a scene from esLoadPOD and unmap its file
+/// \param scene The scene to release
+//
+void ESUTIL_API esFreePOD ( ESPODScene *scene );
+
+//
+/// \brief Map a whole file read-only into the address space of the process
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param mappedFile Receives the mapped view of the file, release it with esUnmapFile
+/// \return GL_TRUE if the file could be mapped, GL_FALSE otherwise
+//
+GLboolean ESUTIL_API esMapFile ( void *ioContext, const char *fileName, ESMappedFile *mappedFile );
+
+//
+/// \brief Release a mapping created by esMapFile
+/// \param mappedFile The mapping to release, data is set to NULL
+//
+void ESUTIL_API esUnmapFile ( ESMappedFile *mappedFile );
+
+//
+/// \brief Return the number of logical processors, at least 1
+//
+int ESUTIL_API esGetProcessorCount ( void );
+
+//
+/// \brief Create a pool of threads for running independent tasks in parallel
+/// \param threadCount Number of threads running tasks, the thread calling esRunTasks included.
+///         0 or less uses one thread per logical processor
+/// \return The new pool, NULL on failure.  Release it with esDestroyThreadPool
+//
+ESThreadPool *ESUTIL_API esCreateThreadPool ( int threadCount );
+
+//
+/// \brief Return the number of threads running the tasks of pool, 1 for a NULL pool
+/// \param pool Thread pool, may be NULL
+//
+int ESUTIL_API esGetThreadCount ( const ESThreadPool *pool );
+
+//
+/// \brief Run taskFunc ( userData, taskIndex ) for every taskIndex in [0, taskCount) and wait for all of them
+/// \param pool Thread pool, a NULL pool runs every task on the calling thread
+/// \param taskCount Number of tasks
+/// \param taskFunc Task callback, it is called concurrently from several threads
+/// \param userData Passed to every call of taskFunc
+//
+void ESUTIL_API esRunTasks ( ESThreadPool *pool, int taskCount,
+                             void ( ESCALLBACK *taskFunc ) ( void *, int ), void *userData );
+
+//
+/// \brief Stop the threads of a pool created by esCreateThreadPool and release it
+/// \param pool Thread pool, may be NULL
+//
+void ESUTIL_API esDestroyThreadPool ( ESThreadPool *pool );
+
 
 //
 /// \brief Multiply matrix specified by result with a scaling matrix and return new matrix in result
@@ -316,6 +1040,179 @@ void ESUTIL_API esOrtho ( ESMatrix *result, float left, float right, float botto
 //
 void ESUTIL_API esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB );
 
+//
+/// \brief esMatrixMultiply for an affine srcA, one with a last column of 0, 0, 0, 1 like the model and
+///        view matrices built by esTranslate, esScale, esRotate and esMatrixLookAt.  srcB can be any
+///        matrix, a projection too.
+/// \param result Returns multiplied matrix, may be srcA or srcB
+/// \param srcA, srcB Input matrices to be multiplied
+//
+void ESUTIL_API esMatrixMultiplyAffine ( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB );
+
+//
+/// \brief result[i] = srcA[i] * srcB for count matrices.  16 byte aligned rows of result are written
+///        past the caches, so result can be a buffer object mapped with glMapBufferRange.
+/// \param pool Thread pool from esCreateThreadPool, NULL to multiply on the calling thread
+/// \param result Returns count multiplied matrices, must not overlap srcA or srcB
+/// \param srcA count matrices
+/// \param srcB Matrix every one of srcA is multiplied with
+/// \param count Number of matrices
+//
+void ESUTIL_API esMatrixMultiplyBatch ( ESThreadPool *pool, ESMatrix *result, const ESMatrix *srcA,
+                                        const ESMatrix *srcB, int count );
+
+//
+/// \brief Build the model matrix of count instances, what esTranslate, esRotate and esScale in that
+///        order make of an identity matrix, and multiply it with viewProjection.  Four instances are
+///        done at a time in SIMD lanes and written like esMatrixMultiplyBatch.
+/// \param pool Thread pool from esCreateThreadPool, NULL to build on the calling thread
+/// \param result Returns count model * viewProjection matrices
+/// \param trs Translation, rotation and scale of every instance
+/// \param viewProjection Matrix every model matrix is multiplied with, an identity for the model matrices
+/// \param count Number of instances
+//
+void ESUTIL_API esComposeTRSBatch ( ESThreadPool *pool, ESMatrix *result, const ESTRSArrays *trs,
+                                    const ESMatrix *viewProjection, int count );
+
+//
+/// \brief Make the quaternion of the rotation esRotate multiplies with
+/// \param result Returns the unit quaternion, the identity for a zero axis
+/// \param angle Specifies the angle of rotation, in degrees.
+/// \param x, y, z Specify the x, y and z coordinates of a vector, respectively
+//
+void ESUTIL_API esQuaternionFromAxisAngle ( ESQuaternion *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+
+//
+/// \brief Compose two rotations like esMatrixMultiply: the rotation of srcA followed by the one of srcB
+/// \param result Returns the composed rotation, may be srcA or srcB
+/// \param srcA, srcB Input rotations
+//
+void ESUTIL_API esQuaternionMultiply ( ESQuaternion *result, const ESQuaternion *srcA, const ESQuaternion *srcB );
+
+//
+/// \brief Scale a quaternion to unit length, against the drift of composing many rotations
+/// \param result Specifies the input quaternion.  Normalized quaternion is returned in result.
+//
+void ESUTIL_API esQuaternionNormalize ( ESQuaternion *result );
+
+//
+/// \brief Spherical linear interpolation between two unit quaternions along the shorter arc
+/// \param result Returns the interpolated unit quaternion
+/// \param srcA, srcB Rotations at t = 0 and t = 1
+/// \param t Position between srcA and srcB, from 0 to 1
+//
+void ESUTIL_API esQuaternionSlerp ( ESQuaternion *result, const ESQuaternion *srcA, const ESQuaternion *srcB, GLfloat t );
+
+//
+/// \brief Rotate a vector, what multiplying it by the matrix of esQuaternionToMatrix does
+/// \param result Returns the rotated vector, may be vec
+/// \param q Rotation
+/// \param vec Vector to rotate
+//
+void ESUTIL_API esQuaternionRotateVector ( GLfloat result[3], const ESQuaternion *q, const GLfloat vec[3] );
+
+//
+/// \brief Load the rotation matrix of a quaternion
+/// \param result Returns the rotation matrix
+/// \param q Rotation
+//
+void ESUTIL_API esQuaternionToMatrix ( ESMatrix *result, const ESQuaternion *q );
+
+//
+/// \brief esRotate with a quaternion in place of an angle and an axis, without sin and cos
+/// \param result Specifies the input matrix.  Rotated matrix is returned in result.
+/// \param q Rotation
+//
+void ESUTIL_API esRotateQuaternion ( ESMatrix *result, const ESQuaternion *q );
+
+//
+/// \brief Make the rigid transform that rotates and then translates
+/// \param result Returns the dual quaternion
+/// \param rotation Rotation, applied first
+/// \param tx, ty, tz Translation, applied last
+//
+void ESUTIL_API esDualQuaternionFromRotationTranslation ( ESDualQuaternion *result, const ESQuaternion *rotation,
+                                                          GLfloat tx, GLfloat ty, GLfloat tz );
+
+//
+/// \brief Compose two rigid transforms like esMatrixMultiply: the transform of srcA followed by the one of srcB
+/// \param result Returns the composed transform, may be srcA or srcB
+/// \param srcA, srcB Input transforms
+//
+void ESUTIL_API esDualQuaternionMultiply ( ESDualQuaternion *result, const ESDualQuaternion *srcA,
+                                           const ESDualQuaternion *srcB );
+
+//
+/// \brief Scale a dual quaternion to a unit rotation, against the drift of composing many transforms
+/// \param result Specifies the input transform.  Normalized transform is returned in result.
+//
+void ESUTIL_API esDualQuaternionNormalize ( ESDualQuaternion *result );
+
+//
+/// \brief Transform a point, what multiplying ( x, y, z, 1 ) by the matrix of esDualQuaternionToMatrix does
+/// \param result Returns the transformed point, may be point
+/// \param dq Transform
+/// \param point Point to transform
+//
+void ESUTIL_API esDualQuaternionTransformPoint ( GLfloat result[3], const ESDualQuaternion *dq, const GLfloat point[3] );
+
+//
+/// \brief Load the matrix of a rigid transform, the rotation with the translation in the last row
+/// \param result Returns the transformation matrix
+/// \param dq Transform
+//
+void ESUTIL_API esDualQuaternionToMatrix ( ESMatrix *result, const ESDualQuaternion *dq );
+
+//
+/// \brief Extract the frustum of a matrix, the planes every visible point is on the inside of
+/// \param result Returns the six planes, normalized
+/// \param mvp Matrix the geometry is drawn with, with a perspective or an ortho projection.  The planes
+///        are in the space mvp transforms from: world space for a view-projection, model space for an MVP.
+//
+void ESUTIL_API esFrustumPlanesFromMatrix ( ESFrustumPlanes *result, const ESMatrix *mvp );
+
+//
+/// \brief Bounding box of positions such as the vertices of esGenCube, esGenSphere and esGenSquareGrid,
+///        and the smallest sphere around the center of the box holding them all
+/// \param result Returns the bounds, all zero when count is 0
+/// \param positions x, y and z of the first position
+/// \param stride Floats from one position to the next, 3 for positions alone
+/// \param count Number of positions
+//
+void ESUTIL_API esComputeBounds ( ESBounds *result, const GLfloat *positions, int stride, int count );
+
+//
+/// \brief Bounds of positions drawn with a model matrix, a box and a sphere holding the transformed ones
+/// \param result Returns the transformed bounds, may be bounds
+/// \param bounds Bounds of the positions
+/// \param model Affine matrix the positions are transformed with
+//
+void ESUTIL_API esTransformBounds ( ESBounds *result, const ESBounds *bounds, const ESMatrix *model );
+
+//
+/// \brief Test count bounding spheres against a frustum, four at a time in SIMD lanes
+/// \param frustum Planes from esFrustumPlanesFromMatrix, in the space of the spheres
+/// \param spheres Centers and radii
+/// \param count Number of spheres
+/// \param visible Returns the indices of the spheres inside or crossing the frustum, in increasing
+///        order.  Room for count of them.
+/// \return Number of visible spheres
+//
+int ESUTIL_API esCullSpheres ( const ESFrustumPlanes *frustum, const ESSphereArrays *spheres, int count,
+                               int *visible );
+
+//
+/// \brief esCullSpheres for axis aligned boxes.  A box is kept unless it is entirely outside one of the
+///        planes, so a few boxes out near the corners of the frustum are kept too.
+/// \param frustum Planes from esFrustumPlanesFromMatrix, in the space of the boxes
+/// \param boxes Smallest and largest corners
+/// \param count Number of boxes
+/// \param visible Returns the indices of the boxes inside or crossing the frustum, in increasing order.
+///        Room for count of them.
+/// \return Number of visible boxes
+//
+int ESUTIL_API esCullBoxes ( const ESFrustumPlanes *frustum, const ESBoxArrays *boxes, int count, int *visible );
+
 //
 //// \brief Return an identity matrix
 //// \param result Returns identity matrix
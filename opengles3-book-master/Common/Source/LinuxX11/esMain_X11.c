@@ -0,0 +1,56 @@
+
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// esMain_X11.c
+//
+//    The LinuxX11 entry point: main() runs esMain and then the window loop.
+//    It is an object of its own, a tool linking Common with a main() of its own
+//    leaves it out and never enters the loop.
+
+///
+// Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+#include "esUtil_win.h"
+
+///
+//  Global extern.  The application must declsare this function
+//  that runs the application.
+//
+extern int esMain( ESContext *esContext );
+
+///
+//  main()
+//
+//      Main entrypoint for application
+//
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   
+   memset ( &esContext, 0, sizeof( esContext ) );
+
+
+   if ( esMain ( &esContext ) != GL_TRUE )
+      return 1;   
+ 
+   WinLoop ( &esContext );
+
+   if ( esContext.shutdownFunc != NULL )
+	   esContext.shutdownFunc ( &esContext );
+
+   if ( esContext.userData != NULL )
+	   free ( esContext.userData );
+
+   return 0;
+}
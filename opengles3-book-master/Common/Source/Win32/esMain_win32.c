@@ -0,0 +1,81 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esMain_win32.c
+//
+//    The Win32 entry point: main() runs esMain and then the window loop.
+//    It is an object of its own, a tool linking Common with a main() of its own
+//    leaves it out and never enters the loop.
+
+///
+// Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+#include "esUtil_win.h"
+
+///
+//  Global extern.  The application must declare this function
+//  that runs the application.
+//
+extern int esMain ( ESContext *esContext );
+
+///
+//  main()
+//
+//      Main entrypoint for application
+//
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+
+   memset ( &esContext, 0, sizeof ( ESContext ) );
+
+   if ( esMain ( &esContext ) != GL_TRUE )
+   {
+      return 1;
+   }
+
+   WinLoop ( &esContext );
+
+   if ( esContext.shutdownFunc != NULL )
+   {
+      esContext.shutdownFunc ( &esContext );
+   }
+
+   if ( esContext.userData != NULL )
+   {
+      free ( esContext.userData );
+   }
+
+   return 0;
+}
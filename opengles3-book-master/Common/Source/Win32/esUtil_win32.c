@@ -224,40 +224,3 @@ void WinLoop ( ESContext *esContext )
       }
    }
 }
-
-///
-//  Global extern.  The application must declare this function
-//  that runs the application.
-//
-extern int esMain ( ESContext *esContext );
-
-///
-//  main()
-//
-//      Main entrypoint for application
-//
-int main ( int argc, char *argv[] )
-{
-   ESContext esContext;
-
-   memset ( &esContext, 0, sizeof ( ESContext ) );
-
-   if ( esMain ( &esContext ) != GL_TRUE )
-   {
-      return 1;
-   }
-
-   WinLoop ( &esContext );
-
-   if ( esContext.shutdownFunc != NULL )
-   {
-      esContext.shutdownFunc ( &esContext );
-   }
-
-   if ( esContext.userData != NULL )
-   {
-      free ( esContext.userData );
-   }
-
-   return 0;
-}
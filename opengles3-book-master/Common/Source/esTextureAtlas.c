@@ -0,0 +1,520 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esTextureAtlas.c
+//
+//    Atlases packing many images into one texture, with the remapping of
+//    texture coordinates into them.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil_private.h"
+
+///
+// Atlases
+//
+
+typedef struct
+{
+   /// Index of the image and the size of its cell in pixels
+   int         index;
+   int         width;
+   int         height;
+} ESAtlasCell;
+
+typedef struct
+{
+   /// Left end and height of a segment of the skyline, it runs up to the next one
+   int         x;
+   int         y;
+} ESSkylineNode;
+
+static int esCompareCells ( const void *a, const void *b )
+{
+   const ESAtlasCell *cellA = ( const ESAtlasCell * ) a;
+   const ESAtlasCell *cellB = ( const ESAtlasCell * ) b;
+
+   if ( cellA->height != cellB->height )
+   {
+      return cellB->height - cellA->height;
+   }
+
+   if ( cellA->width != cellB->width )
+   {
+      return cellB->width - cellA->width;
+   }
+
+   return cellA->index - cellB->index;
+}
+
+///
+// esSkylineInsert()
+//
+//    Find the lowest place for a cell on the skyline of a layer, the
+//    leftmost of those, and raise the skyline over it.  nodes has room
+//    for a node per gutter of the width.  Returns GL_FALSE if the cell
+//    doesn't fit.
+//
+static GLboolean esSkylineInsert ( ESSkylineNode *nodes, int *nodeCount, int width, int height,
+                                   int cellWidth, int cellHeight, int *x, int *y )
+{
+   int bestNode = -1;
+   int bestY = height;
+   int cellEnd, rightY, keep;
+   int i, j;
+
+   for ( i = 0; i < *nodeCount && nodes[i].x + cellWidth <= width; i++ )
+   {
+      int top = 0;
+
+      // the cell rests on the highest segment under it
+      for ( j = i; j < *nodeCount && nodes[j].x < nodes[i].x + cellWidth; j++ )
+      {
+         top = nodes[j].y > top ? nodes[j].y : top;
+      }
+
+      if ( top + cellHeight <= height && top < bestY )
+      {
+         bestNode = i;
+         bestY = top;
+      }
+   }
+
+   if ( bestNode < 0 )
+   {
+      return GL_FALSE;
+   }
+
+   *x = nodes[bestNode].x;
+   *y = bestY;
+   cellEnd = *x + cellWidth;
+
+   // the segments under the cell are replaced by it, only what the last one reaches past it stays
+   for ( j = bestNode; j + 1 < *nodeCount && nodes[j + 1].x < cellEnd; j++ )
+   {
+   }
+
+   rightY = nodes[j].y;
+   keep = ( j + 1 < *nodeCount ? nodes[j + 1].x : width ) > cellEnd;
+   memmove ( &nodes[bestNode + 1 + keep], &nodes[j + 1], ( *nodeCount - j - 1 ) * sizeof ( ESSkylineNode ) );
+   *nodeCount = bestNode + 1 + keep + *nodeCount - j - 1;
+
+   if ( keep )
+   {
+      nodes[bestNode + 1].x = cellEnd;
+      nodes[bestNode + 1].y = rightY;
+   }
+
+   nodes[bestNode].y = bestY + cellHeight;
+
+   // merge the neighbours of the same height
+   for ( i = 0; i + 1 < *nodeCount; )
+   {
+      if ( nodes[i].y == nodes[i + 1].y )
+      {
+         memmove ( &nodes[i + 1], &nodes[i + 2], ( *nodeCount - i - 2 ) * sizeof ( ESSkylineNode ) );
+         ( *nodeCount )--;
+      }
+      else
+      {
+         i++;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// esPackAtlas()
+//
+//    Place the sorted cells into layers of width x height, a new layer
+//    when a cell fits into none of the others.  Returns the number of
+//    layers, 0 if they would be more than maxLayers.
+//
+static int esPackAtlas ( const ESAtlasCell *cells, int count, int width, int height, int maxLayers,
+                         ESSkylineNode *nodes, int nodeStride, int *nodeCounts, ESAtlasRegion *regions )
+{
+   int layerCount = 0;
+   int i, layer;
+
+   for ( i = 0; i < count; i++ )
+   {
+      ESAtlasRegion *region = &regions[cells[i].index];
+
+      for ( layer = 0; layer < layerCount; layer++ )
+      {
+         if ( esSkylineInsert ( nodes + ( size_t ) layer * nodeStride, &nodeCounts[layer], width, height,
+                                cells[i].width, cells[i].height, &region->x, &region->y ) )
+         {
+            break;
+         }
+      }
+
+      if ( layer == layerCount )
+      {
+         if ( layerCount == maxLayers )
+         {
+            return 0;
+         }
+
+         nodes[( size_t ) layer * nodeStride].x = 0;
+         nodes[( size_t ) layer * nodeStride].y = 0;
+         nodeCounts[layer] = 1;
+         layerCount++;
+
+         esSkylineInsert ( nodes + ( size_t ) layer * nodeStride, &nodeCounts[layer], width, height,
+                           cells[i].width, cells[i].height, &region->x, &region->y );
+      }
+
+      region->layer = layer;
+   }
+
+   return layerCount;
+}
+
+///
+// esAtlasSize()
+//
+//    Smallest size of a layer from size up: a multiple of the gutter,
+//    with four sizes between two powers of two, or maxSize.  0 past it.
+//
+static int esAtlasSize ( int size, int gutter, int maxSize )
+{
+   int step = gutter;
+
+   if ( size > maxSize )
+   {
+      return 0;
+   }
+
+   while ( step * 8 <= size )
+   {
+      step *= 2;
+   }
+
+   size = ( size + step - 1 ) / step * step;
+   return size < maxSize ? size : maxSize;
+}
+
+///
+// esAtlasPixel()
+//
+//    RGBA of a pixel of an image from esMapTGA, row 0 at the bottom
+//
+static void esAtlasPixel ( const ESImage *image, int x, int y, unsigned char *rgba )
+{
+   const unsigned char *pixel;
+   unsigned short       value;
+
+   if ( image->topDown )
+   {
+      y = image->height - 1 - y;
+   }
+
+   pixel = image->pixels + ( ( size_t ) y * image->width + x ) * image->bytesPerPixel;
+
+   switch ( image->bytesPerPixel )
+   {
+      case 1:
+         rgba[0] = rgba[1] = rgba[2] = rgba[3] = pixel[0];
+         break;
+
+      case 2:
+         memcpy ( &value, pixel, sizeof ( value ) );
+         rgba[0] = ( unsigned char ) ( ( value >> 11 & 31 ) * 255 / 31 );
+         rgba[1] = ( unsigned char ) ( ( value >> 6 & 31 ) * 255 / 31 );
+         rgba[2] = ( unsigned char ) ( ( value >> 1 & 31 ) * 255 / 31 );
+         rgba[3] = ( unsigned char ) ( ( value & 1 ) * 255 );
+         break;
+
+      default:
+         rgba[0] = pixel[2];
+         rgba[1] = pixel[1];
+         rgba[2] = pixel[0];
+         rgba[3] = image->bytesPerPixel == 4 ? pixel[3] : 255;
+         break;
+   }
+}
+
+///
+// esBuildAtlas()
+//
+//    Pack the cells into layers of every size from the smallest, cut
+//    them down to the cells and keep the size with the least pixels over
+//    all the layers.  Cells are then filled with their image, edge pixels
+//    repeated.
+//
+GLboolean ESUTIL_API esBuildAtlas ( ESAtlas *atlas, const ESImage *images, int count, int maxSize,
+                                    int levelCount, GLboolean layered )
+{
+   int            gutter, nodeStride;
+   int            maxLayers = layered ? ES_MAX_ATLAS_LAYERS : 1;
+   int            widest = 0, tallest = 0;
+   size_t         imagePixels = 0, cellPixels = 0, bestPixels = 0;
+   ESAtlasCell   *cells;
+   ESSkylineNode *nodes;
+   int           *nodeCounts;
+   ESAtlasRegion *regions;
+   int            width, height, layerCount;
+   int            i, x, y;
+
+   memset ( atlas, 0, sizeof ( ESAtlas ) );
+
+   if ( count <= 0 || levelCount < 1 || levelCount > ES_MAX_MIP_LEVELS )
+   {
+      return GL_FALSE;
+   }
+
+   // layers are multiples of the gutter, so every level of them is filtered from 2x2 pixels
+   gutter = 1 << ( levelCount - 1 );
+   maxSize = maxSize / gutter * gutter;
+
+   // cells start and end on multiples of the gutter, so do the segments of a skyline
+   nodeStride = maxSize / gutter + 1;
+   cells = ( ESAtlasCell * ) malloc ( count * sizeof ( ESAtlasCell ) );
+   nodes = ( ESSkylineNode * ) malloc ( ( size_t ) maxLayers * nodeStride * sizeof ( ESSkylineNode ) );
+   nodeCounts = ( int * ) malloc ( maxLayers * sizeof ( int ) );
+   regions = ( ESAtlasRegion * ) calloc ( count, sizeof ( ESAtlasRegion ) );
+   atlas->regions = ( ESAtlasRegion * ) calloc ( count, sizeof ( ESAtlasRegion ) );
+
+   if ( cells == NULL || nodes == NULL || nodeCounts == NULL || regions == NULL || atlas->regions == NULL )
+   {
+      free ( cells );
+      free ( nodes );
+      free ( nodeCounts );
+      free ( regions );
+      esFreeAtlas ( atlas );
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      cells[i].index = i;
+      cells[i].width = ( images[i].width + 3 * gutter - 1 ) / gutter * gutter;
+      cells[i].height = ( images[i].height + 3 * gutter - 1 ) / gutter * gutter;
+      widest = cells[i].width > widest ? cells[i].width : widest;
+      tallest = cells[i].height > tallest ? cells[i].height : tallest;
+      imagePixels += ( size_t ) images[i].width * images[i].height;
+      cellPixels += ( size_t ) cells[i].width * cells[i].height;
+   }
+
+   qsort ( cells, count, sizeof ( ESAtlasCell ), esCompareCells );
+
+   for ( width = esAtlasSize ( widest, gutter, maxSize ); width > 0; width = esAtlasSize ( width + 1, gutter, maxSize ) )
+   {
+      for ( height = esAtlasSize ( tallest, gutter, maxSize ); height > 0;
+            height = esAtlasSize ( height + 1, gutter, maxSize ) )
+      {
+         int    usedWidth = 0, usedHeight = 0;
+         size_t pixels;
+
+         if ( ( size_t ) width * height * maxLayers < cellPixels )
+         {
+            continue;
+         }
+
+         layerCount = esPackAtlas ( cells, count, width, height, maxLayers, nodes, nodeStride, nodeCounts, regions );
+
+         if ( layerCount == 0 )
+         {
+            continue;
+         }
+
+         // the layers end where their cells do
+         for ( i = 0; i < count; i++ )
+         {
+            const ESAtlasRegion *region = &regions[cells[i].index];
+
+            usedWidth = region->x + cells[i].width > usedWidth ? region->x + cells[i].width : usedWidth;
+            usedHeight = region->y + cells[i].height > usedHeight ? region->y + cells[i].height : usedHeight;
+         }
+
+         pixels = ( size_t ) layerCount * usedWidth * usedHeight;
+
+         if ( bestPixels == 0 || pixels < bestPixels )
+         {
+            bestPixels = pixels;
+            atlas->width = usedWidth;
+            atlas->height = usedHeight;
+            atlas->layerCount = layerCount;
+            memcpy ( atlas->regions, regions, count * sizeof ( ESAtlasRegion ) );
+         }
+
+         // taller layers of one only repeat the same packing
+         if ( layerCount == 1 )
+         {
+            break;
+         }
+      }
+   }
+
+   free ( cells );
+   free ( nodes );
+   free ( nodeCounts );
+   free ( regions );
+
+   if ( bestPixels > 0 )
+   {
+      atlas->pixels = ( unsigned char * ) malloc ( bestPixels * 4 );
+   }
+
+   if ( atlas->pixels == NULL )
+   {
+      esLogMessage ( "esBuildAtlas: %d images don't fit into %d layers of %dx%d\n", count, maxLayers, maxSize, maxSize );
+      esFreeAtlas ( atlas );
+      return GL_FALSE;
+   }
+
+   // unused space stays transparent black
+   memset ( atlas->pixels, 0, bestPixels * 4 );
+
+   for ( i = 0; i < count; i++ )
+   {
+      ESAtlasRegion *region = &atlas->regions[i];
+      unsigned char *layer = atlas->pixels + ( size_t ) region->layer * atlas->width * atlas->height * 4;
+      int            cellX = region->x;
+      int            cellY = region->y;
+      int            cellWidth = ( images[i].width + 3 * gutter - 1 ) / gutter * gutter;
+      int            cellHeight = ( images[i].height + 3 * gutter - 1 ) / gutter * gutter;
+
+      region->x = cellX + gutter;
+      region->y = cellY + gutter;
+      region->width = images[i].width;
+      region->height = images[i].height;
+      region->scale[0] = ( GLfloat ) region->width / atlas->width;
+      region->scale[1] = ( GLfloat ) region->height / atlas->height;
+      region->offset[0] = ( GLfloat ) region->x / atlas->width;
+      region->offset[1] = ( GLfloat ) region->y / atlas->height;
+
+      // the whole cell, the gutter repeats the nearest pixel of the image
+      for ( y = 0; y < cellHeight; y++ )
+      {
+         int            imageY = y - gutter < 0 ? 0 : y - gutter >= region->height ? region->height - 1 : y - gutter;
+         unsigned char *row = layer + ( ( size_t ) ( cellY + y ) * atlas->width + cellX ) * 4;
+
+         for ( x = 0; x < cellWidth; x++ )
+         {
+            int imageX = x - gutter < 0 ? 0 : x - gutter >= region->width ? region->width - 1 : x - gutter;
+
+            esAtlasPixel ( &images[i], imageX, imageY, row + x * 4 );
+         }
+      }
+   }
+
+   atlas->levelCount = levelCount;
+   atlas->regionCount = count;
+   atlas->efficiency = ( GLfloat ) ( ( double ) imagePixels / bestPixels );
+
+   return GL_TRUE;
+}
+
+///
+// esTexImageAtlas()
+//
+//    Box filter every layer with esBuildMipChain, its 2x2 averages never
+//    cross the aligned cells, and upload the levels that stay clean
+//
+GLboolean ESUTIL_API esTexImageAtlas ( GLenum target, const ESAtlas *atlas )
+{
+   GLint      saved[UNPACK_STATE_COUNT];
+   ESMipChain chain;
+   size_t     layerSize = ( size_t ) atlas->width * atlas->height * 4;
+   int        layer, level;
+
+   if ( atlas->pixels == NULL || ( target == GL_TEXTURE_2D && atlas->layerCount != 1 ) ||
+         ( target != GL_TEXTURE_2D && target != GL_TEXTURE_2D_ARRAY ) )
+   {
+      return GL_FALSE;
+   }
+
+   // cells are at least 2^levelCount pixels, so are the layers and they have all the levels
+   if ( target == GL_TEXTURE_2D_ARRAY )
+   {
+      glTexStorage3D ( target, atlas->levelCount, GL_RGBA8, atlas->width, atlas->height, atlas->layerCount );
+   }
+
+   esSaveUnpackState ( saved );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+   for ( layer = 0; layer < atlas->layerCount; layer++ )
+   {
+      if ( !esBuildMipChain ( &chain, atlas->pixels + layer * layerSize, atlas->width, atlas->height,
+                              GL_RGBA, GL_UNSIGNED_BYTE, GL_FALSE ) )
+      {
+         esRestoreUnpackState ( saved );
+         return GL_FALSE;
+      }
+
+      if ( target == GL_TEXTURE_2D )
+      {
+         chain.levelCount = atlas->levelCount;
+         esTexImageMipChain ( target, &chain );
+      }
+      else
+      {
+         glPixelStorei ( GL_UNPACK_ALIGNMENT, 4 );
+
+         for ( level = 0; level < atlas->levelCount; level++ )
+         {
+            glTexSubImage3D ( target, level, 0, 0, layer, chain.width[level], chain.height[level], 1,
+                              GL_RGBA, GL_UNSIGNED_BYTE, chain.pixels + chain.offset[level] );
+         }
+      }
+
+      esFreeMipChain ( &chain );
+   }
+
+   esRestoreUnpackState ( saved );
+   glTexParameteri ( target, GL_TEXTURE_MAX_LEVEL, atlas->levelCount - 1 );
+
+   return GL_TRUE;
+}
+
+///
+// esFreeAtlas()
+//
+//    Release the layers and the regions of an atlas from esBuildAtlas
+//
+void ESUTIL_API esFreeAtlas ( ESAtlas *atlas )
+{
+   if ( atlas == NULL )
+   {
+      return;
+   }
+
+   free ( atlas->regions );
+   free ( atlas->pixels );
+   memset ( atlas, 0, sizeof ( ESAtlas ) );
+}
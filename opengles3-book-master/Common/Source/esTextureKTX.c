@@ -0,0 +1,386 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esTextureKTX.c
+//
+//    Loader of KTX 1.1 / 2.0 textures, which uploads every level and face
+//    straight from the mapped file.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil_private.h"
+
+///
+// KTX
+//
+
+/// Identifiers at the start of KTX 1.1 and KTX 2.0 files
+static const unsigned char ktx1Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const unsigned char ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+/// Files are little endian like every platform of the samples, read byte by byte all the same
+GLuint esReadU32 ( const unsigned char *data )
+{
+   return ( GLuint ) data[0] | ( GLuint ) data[1] << 8 | ( GLuint ) data[2] << 16 | ( GLuint ) data[3] << 24;
+}
+
+static size_t esReadU64 ( const unsigned char *data )
+{
+   unsigned long long high = esReadU32 ( data + 4 );
+
+   // offsets past what size_t holds fail the bounds checks
+   return sizeof ( size_t ) < 8 && high != 0 ? ( size_t ) - 1 : ( size_t ) ( high << 32 | esReadU32 ( data ) );
+}
+
+///
+// esFormatVk()
+//
+//    GL formats of the Vulkan formats of KTX 2 files GL ES 3.0 can take,
+//    format GL_NONE for the compressed ones
+//
+static GLboolean esFormatVk ( GLuint vkFormat, GLenum *internalFormat, GLenum *format )
+{
+   static const struct
+   {
+      GLuint vkFormat;
+      GLenum internalFormat;
+      GLenum format;
+   } formats[] =
+   {
+      { 9, GL_R8, GL_RED },
+      { 16, GL_RG8, GL_RG },
+      { 23, GL_RGB8, GL_RGB },
+      { 29, GL_SRGB8, GL_RGB },
+      { 37, GL_RGBA8, GL_RGBA },
+      { 43, GL_SRGB8_ALPHA8, GL_RGBA },
+      { 147, GL_COMPRESSED_RGB8_ETC2, GL_NONE },
+      { 148, GL_COMPRESSED_SRGB8_ETC2, GL_NONE },
+      { 149, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, GL_NONE },
+      { 150, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, GL_NONE },
+      { 151, GL_COMPRESSED_RGBA8_ETC2_EAC, GL_NONE },
+      { 152, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, GL_NONE },
+      { 153, GL_COMPRESSED_R11_EAC, GL_NONE },
+      { 154, GL_COMPRESSED_SIGNED_R11_EAC, GL_NONE },
+      { 155, GL_COMPRESSED_RG11_EAC, GL_NONE },
+      { 156, GL_COMPRESSED_SIGNED_RG11_EAC, GL_NONE },
+   };
+   int i;
+
+   for ( i = 0; i < ( int ) ( sizeof ( formats ) / sizeof ( formats[0] ) ); i++ )
+   {
+      if ( formats[i].vkFormat == vkFormat )
+      {
+         *internalFormat = formats[i].internalFormat;
+         *format = formats[i].format;
+         return GL_TRUE;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+///
+// esTexelSize()
+//
+//    Bytes of one texel of glTexImage2D data in format and type, 0 for
+//    combinations GL ES 3.0 doesn't take
+//
+static size_t esTexelSize ( GLenum format, GLenum type )
+{
+   size_t components;
+
+   switch ( type )
+   {
+      case GL_UNSIGNED_SHORT_5_6_5:
+      case GL_UNSIGNED_SHORT_4_4_4_4:
+      case GL_UNSIGNED_SHORT_5_5_5_1:
+         return 2;
+
+      case GL_UNSIGNED_INT_2_10_10_10_REV:
+      case GL_UNSIGNED_INT_10F_11F_11F_REV:
+      case GL_UNSIGNED_INT_5_9_9_9_REV:
+      case GL_UNSIGNED_INT_24_8:
+         return 4;
+
+      case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+         return 8;
+   }
+
+   switch ( format )
+   {
+      case GL_RED:
+      case GL_RED_INTEGER:
+      case GL_ALPHA:
+      case GL_LUMINANCE:
+      case GL_DEPTH_COMPONENT:
+         components = 1;
+         break;
+
+      case GL_RG:
+      case GL_RG_INTEGER:
+      case GL_LUMINANCE_ALPHA:
+         components = 2;
+         break;
+
+      case GL_RGB:
+      case GL_RGB_INTEGER:
+         components = 3;
+         break;
+
+      case GL_RGBA:
+      case GL_RGBA_INTEGER:
+         components = 4;
+         break;
+
+      default:
+         return 0;
+   }
+
+   switch ( type )
+   {
+      case GL_UNSIGNED_BYTE:
+      case GL_BYTE:
+         return components;
+
+      case GL_UNSIGNED_SHORT:
+      case GL_SHORT:
+      case GL_HALF_FLOAT:
+         return components * 2;
+
+      case GL_UNSIGNED_INT:
+      case GL_INT:
+      case GL_FLOAT:
+         return components * 4;
+
+      default:
+         return 0;
+   }
+}
+
+///
+// esTexImageLevel()
+//
+//    Upload one face of one level, straight from the mapped file
+//
+void esTexImageLevel ( GLenum target, GLint level, GLenum internalFormat, GLenum format, GLenum type,
+                       int width, int height, const unsigned char *data, size_t size )
+{
+   width = width >> level > 0 ? width >> level : 1;
+   height = height >> level > 0 ? height >> level : 1;
+
+   if ( format == GL_NONE )
+   {
+      glCompressedTexImage2D ( target, level, internalFormat, width, height, 0, ( GLsizei ) size, data );
+   }
+   else
+   {
+      glTexImage2D ( target, level, internalFormat, width, height, 0, format, type, data );
+   }
+}
+
+///
+// esTexImageKTX()
+//
+//    Map a KTX 1.1 or KTX 2.0 file and upload every level and face of it
+//    straight from the mapping.  KTX 1.1 stores a size before each level,
+//    KTX 2.0 an index of where the levels are.  Every level is found and
+//    checked against the size of the file, and levels that are not compressed
+//    against the size of their rows, before anything is uploaded.
+//
+GLboolean ESUTIL_API esTexImageKTX ( void *ioContext, const char *fileName, GLenum target, ESTextureInfo *info )
+{
+   const unsigned char *levels[ES_MAX_MIP_LEVELS];
+   size_t        faceSizes[ES_MAX_MIP_LEVELS];
+   size_t        faceStrides[ES_MAX_MIP_LEVELS];
+   ESMappedFile  file;
+   ESTextureInfo fileInfo;
+   GLint         saved[UNPACK_STATE_COUNT];
+   GLenum        format = GL_NONE;
+   GLenum        type = GL_UNSIGNED_BYTE;
+   GLboolean     ktx2;
+   GLboolean     supported;
+   GLuint        width, height, depth, layerCount, faceCount, levelCount;
+   int           level, face;
+
+   memset ( &fileInfo, 0, sizeof ( ESTextureInfo ) );
+
+   if ( !esMapFile ( ioContext, fileName, &file ) || file.size < 80 ||
+         ( memcmp ( file.data, ktx1Identifier, 12 ) != 0 && memcmp ( file.data, ktx2Identifier, 12 ) != 0 ) )
+   {
+      esLogMessage ( "esTexImageKTX FAILED to load : { %s }\n", fileName );
+      esUnmapFile ( &file );
+      return GL_FALSE;
+   }
+
+   ktx2 = memcmp ( file.data, ktx2Identifier, 12 ) == 0;
+
+   if ( ktx2 )
+   {
+      // vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth, layerCount, faceCount, levelCount,
+      // supercompressionScheme, the index of the data and the one of the levels
+      width = esReadU32 ( file.data + 20 );
+      height = esReadU32 ( file.data + 24 );
+      depth = esReadU32 ( file.data + 28 );
+      layerCount = esReadU32 ( file.data + 32 );
+      faceCount = esReadU32 ( file.data + 36 );
+      levelCount = esReadU32 ( file.data + 40 );
+      supported = esFormatVk ( esReadU32 ( file.data + 12 ), &fileInfo.internalFormat, &format ) &&
+                  esReadU32 ( file.data + 44 ) == 0;
+   }
+   else
+   {
+      // endianness, glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat, pixelWidth,
+      // pixelHeight, pixelDepth, numberOfArrayElements, numberOfFaces, numberOfMipmapLevels,
+      // bytesOfKeyValueData
+      type = esReadU32 ( file.data + 16 );
+      format = type == 0 ? GL_NONE : esReadU32 ( file.data + 24 );
+      fileInfo.internalFormat = esReadU32 ( file.data + 28 );
+      width = esReadU32 ( file.data + 36 );
+      height = esReadU32 ( file.data + 40 );
+      depth = esReadU32 ( file.data + 44 );
+      layerCount = esReadU32 ( file.data + 48 );
+      faceCount = esReadU32 ( file.data + 52 );
+      levelCount = esReadU32 ( file.data + 56 );
+      supported = esReadU32 ( file.data + 12 ) == 0x04030201;
+   }
+
+   // 0 levels asks for glGenerateMipmap, which compressed formats can't have
+   levelCount = levelCount > 0 ? levelCount : 1;
+
+   if ( !supported || width == 0 || height == 0 || depth > 0 || layerCount > 0 || levelCount > ES_MAX_MIP_LEVELS ||
+         faceCount != ( target == GL_TEXTURE_CUBE_MAP ? 6u : 1u ) || ( format != GL_NONE && esTexelSize ( format, type ) == 0 ) )
+   {
+      esLogMessage ( "esTexImageKTX: %s is not a %s in a format GL ES 3.0 takes\n", fileName,
+                     target == GL_TEXTURE_CUBE_MAP ? "cube map" : "2D texture" );
+      esUnmapFile ( &file );
+      return GL_FALSE;
+   }
+
+   if ( ktx2 )
+   {
+      if ( file.size < 80 + ( size_t ) levelCount * 24 )
+      {
+         supported = GL_FALSE;
+      }
+
+      for ( level = 0; supported && level < ( int ) levelCount; level++ )
+      {
+         size_t offset = esReadU64 ( file.data + 80 + level * 24 );
+         size_t length = esReadU64 ( file.data + 80 + level * 24 + 8 );
+
+         supported = offset <= file.size && length <= file.size - offset;
+         levels[level] = file.data + offset;
+         faceSizes[level] = faceStrides[level] = length / faceCount;
+      }
+   }
+   else
+   {
+      // the levels follow the key / value data, each face padded to 4 bytes
+      size_t offset = 64 + ( size_t ) esReadU32 ( file.data + 60 );
+
+      for ( level = 0; supported && level < ( int ) levelCount; level++ )
+      {
+         supported = offset <= file.size && file.size - offset >= 4;
+
+         if ( supported )
+         {
+            faceSizes[level] = esReadU32 ( file.data + offset );
+            faceStrides[level] = ( faceSizes[level] + 3 ) & ~( size_t ) 3;
+            levels[level] = file.data + offset + 4;
+            offset += 4 + faceStrides[level] * faceCount;
+            supported = faceStrides[level] * faceCount <= file.size - ( levels[level] - file.data );
+         }
+      }
+   }
+
+   // glTexImage2D reads whole rows of the level from its face, whatever size the file gives it
+   for ( level = 0; supported && format != GL_NONE && level < ( int ) levelCount; level++ )
+   {
+      size_t levelWidth = width >> level > 0 ? width >> level : 1;
+      size_t levelHeight = height >> level > 0 ? height >> level : 1;
+      size_t texelSize = esTexelSize ( format, type );
+      size_t pitch;
+
+      supported = levelWidth <= faceSizes[level] / texelSize;
+
+      if ( supported )
+      {
+         pitch = levelWidth * texelSize;
+         pitch = ktx2 ? pitch : ( pitch + 3 ) & ~( size_t ) 3;
+         supported = levelHeight <= faceSizes[level] / pitch;
+      }
+   }
+
+   if ( !supported )
+   {
+      esLogMessage ( "esTexImageKTX: %s is truncated\n", fileName );
+      esUnmapFile ( &file );
+      return GL_FALSE;
+   }
+
+   esSaveUnpackState ( saved );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+   // rows of KTX 1.1 are padded to 4 bytes, the ones of KTX 2.0 are not
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, ktx2 ? 1 : 4 );
+
+   for ( level = 0; level < ( int ) levelCount; level++ )
+   {
+      for ( face = 0; face < ( int ) faceCount; face++ )
+      {
+         esTexImageLevel ( faceCount == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D, level,
+                           fileInfo.internalFormat, format, type, width, height,
+                           levels[level] + faceStrides[level] * face, faceSizes[level] );
+         fileInfo.bytes += faceSizes[level];
+      }
+   }
+
+   // complete with the levels the file has
+   glTexParameteri ( target, GL_TEXTURE_MAX_LEVEL, levelCount - 1 );
+   esRestoreUnpackState ( saved );
+   esUnmapFile ( &file );
+
+   fileInfo.target = target;
+   fileInfo.width = width;
+   fileInfo.height = height;
+   fileInfo.levelCount = levelCount;
+
+   if ( info != NULL )
+   {
+      *info = fileInfo;
+   }
+
+   return GL_TRUE;
+}
@@ -0,0 +1,1207 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esTextureProcedural.c
+//
+//    Procedural textures and fractal 3D noise volumes, generated by SIMD
+//    kernels on the thread pool.
+//
+
+///
+//  Includes
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil_private.h"
+
+///
+// Procedural textures
+//
+
+/// Texels generated by one task of esGenTexture, whole rows of one slice
+#define PROCEDURAL_TASK_TEXELS   16384
+
+typedef struct
+{
+   const ESProceduralTexture *texture;
+   int            width;
+   int            height;
+   int            depth;
+   int            pixelSize;
+   size_t         pitch;
+   int            rowsPerTask;
+   int            tasksPerSlice;
+   unsigned char *pixels;
+
+   /// Color of every quantized value between color0 and color1
+   GLubyte        ramp[256][4];
+} ESProceduralJob;
+
+/// Gradients of the Perlin lattice, the 12 edges of a cube padded to 16
+static const GLfloat perlinGradients[16][3] =
+{
+   {  1.0f,  1.0f,  0.0f }, { -1.0f,  1.0f,  0.0f }, {  1.0f, -1.0f,  0.0f }, { -1.0f, -1.0f,  0.0f },
+   {  1.0f,  0.0f,  1.0f }, { -1.0f,  0.0f,  1.0f }, {  1.0f,  0.0f, -1.0f }, { -1.0f,  0.0f, -1.0f },
+   {  0.0f,  1.0f,  1.0f }, {  0.0f, -1.0f,  1.0f }, {  0.0f,  1.0f, -1.0f }, {  0.0f, -1.0f, -1.0f },
+   {  1.0f,  1.0f,  0.0f }, {  0.0f, -1.0f,  1.0f }, { -1.0f,  1.0f,  0.0f }, {  0.0f, -1.0f, -1.0f },
+};
+
+///
+// esFade()
+//
+//    6t^5 - 15t^4 + 10t^3, the weight of the far corner of a lattice cell
+//
+static ESVec4 esFade ( ESVec4 t )
+{
+   ESVec4 poly = esVecAdd ( esVecMul ( t, esVecSub ( esVecMul ( t, esVecSet ( 6.0f ) ), esVecSet ( 15.0f ) ) ),
+                            esVecSet ( 10.0f ) );
+
+   return esVecMul ( esVecMul ( esVecMul ( t, t ), t ), poly );
+}
+
+static float esFadeScalar ( float t )
+{
+   return t * t * t * ( t * ( t * 6.0f - 15.0f ) + 10.0f );
+}
+
+///
+// esLatticeHash()
+//
+//    32 well mixed bits for a lattice point
+//
+static GLuint esLatticeHash ( GLuint seed, int x, int y, int z )
+{
+   GLuint h = seed ^ ( ( GLuint ) x * 0x8DA6B343u ) ^ ( ( GLuint ) y * 0xD8163841u ) ^ ( ( GLuint ) z * 0xCB1AB31Fu );
+
+   h ^= h >> 16;
+   h *= 0x7FEB352Du;
+   h ^= h >> 15;
+   h *= 0x846CA68Bu;
+   h ^= h >> 16;
+   return h;
+}
+
+///
+// esProceduralStore()
+//
+//    Colors of the first count of 4 values in [0, 1] into a row
+//
+static void esProceduralStore ( const ESProceduralJob *job, unsigned char *dst, ESVec4 t, int count )
+{
+   int q[4];
+   int i;
+
+   esVecQuantize ( t, q );
+
+   switch ( job->pixelSize )
+   {
+      case 1:
+         for ( i = 0; i < count; i++ )
+         {
+            dst[i] = job->ramp[q[i]][0];
+         }
+
+         break;
+
+      case 4:
+         for ( i = 0; i < count; i++ )
+         {
+            memcpy ( dst + 4 * i, job->ramp[q[i]], 4 );
+         }
+
+         break;
+
+      default:
+         for ( i = 0; i < count; i++ )
+         {
+            const GLubyte *color = job->ramp[q[i]];
+            unsigned char *texel = dst + i * job->pixelSize;
+
+            texel[0] = color[0];
+            texel[1] = color[1];
+
+            if ( job->pixelSize == 3 )
+            {
+               texel[2] = color[2];
+            }
+         }
+
+         break;
+   }
+}
+
+///
+// esProceduralFill()
+//
+//    count texels of the color of one value, the checker squares
+//
+static void esProceduralFill ( const ESProceduralJob *job, unsigned char *dst, int value, int count )
+{
+   const GLubyte *color = job->ramp[value ? 255 : 0];
+   int i;
+
+   if ( job->pixelSize == 1 )
+   {
+      memset ( dst, color[0], count );
+      return;
+   }
+
+   // one texel, then the filled part copied over the rest doubling every time
+   memcpy ( dst, color, job->pixelSize );
+
+   for ( i = 1; i < count; i *= 2 )
+   {
+      memcpy ( dst + i * job->pixelSize, dst, ( size_t ) ( count - i < i ? count - i : i ) * job->pixelSize );
+   }
+}
+
+///
+// esCellEnd()
+//
+//    The texels of a row from x on inside the same lattice cell, the cell
+//    along x returned in cell.  Both are positive, truncation is the floor.
+//
+static int esCellEnd ( int x, int width, float cellSize, float step, int *cell )
+{
+   int   i = ( int ) ( ( x + 0.5f ) * step );
+   float edge = ( i + 1 ) * cellSize - 0.5f;
+   int   end = ( int ) edge + ( ( float ) ( int ) edge < edge );
+
+   *cell = i;
+   return end <= x ? x + 1 : end > width ? width : end;
+}
+
+///
+// esNoiseColumn()
+//
+//    A row crosses a lattice cell at fixed y and z, so the 4 corners of
+//    column ix around it reduce to a * ( x - ix ) + b for Perlin noise and
+//    to b for value noise
+//
+static void esNoiseColumn ( GLuint seed, GLboolean perlin, int ix, int iy, int iz, float fy, float fz,
+                            int zCorners, float *a, float *b )
+{
+   float sy = esFadeScalar ( fy );
+   float sz = esFadeScalar ( fz );
+   int   dy, dz;
+
+   *a = 0.0f;
+   *b = 0.0f;
+
+   for ( dz = 0; dz < zCorners; dz++ )
+   {
+      for ( dy = 0; dy < 2; dy++ )
+      {
+         float  weight = ( dy ? sy : 1.0f - sy ) * ( dz ? sz : 1.0f - sz );
+         GLuint h = esLatticeHash ( seed, ix, iy + dy, iz + dz );
+
+         if ( perlin )
+         {
+            const GLfloat *g = perlinGradients[h & 15];
+
+            *a += weight * g[0];
+            *b += weight * ( g[1] * ( fy - dy ) + g[2] * ( fz - dz ) );
+         }
+         else
+         {
+            *b += weight * ( h >> 8 ) * ( 1.0f / 16777215.0f );
+         }
+      }
+   }
+}
+
+///
+// esProceduralRow()
+//
+//    One row of slice z: noises walk the row a lattice cell at a time,
+//    everything that only depends on the cell is set up once for it
+//
+static void esProceduralRow ( const ESProceduralJob *job, int y, int z, unsigned char *dst )
+{
+   const ESProceduralTexture *texture = job->texture;
+   int    width = job->width;
+   int    pixelSize = job->pixelSize;
+   float  cellSize = texture->cellSize > 0.0f ? texture->cellSize : 1.0f;
+   float  step = 1.0f / cellSize;
+   float  v = ( y + 0.5f ) * step;
+   float  w = job->depth > 1 ? ( z + 0.5f ) * step : 0.0f;
+   int    iy = ( int ) floorf ( v );
+   int    iz = ( int ) floorf ( w );
+   float  fy = v - iy;
+   float  fz = w - iz;
+   int    zCorners = job->depth > 1 ? 2 : 1;
+   int    x = 0;
+   int    x1, ix;
+
+   switch ( texture->type )
+   {
+      case ES_PROCEDURAL_CHECKER:
+      {
+         // with whole texels per square a row repeats every 2 squares, copied over the rest doubling
+         int period = cellSize < width && cellSize == floorf ( cellSize ) ? 2 * ( int ) cellSize : width;
+
+         period = period < width ? period : width;
+
+         for ( ; x < period; x = x1 )
+         {
+            x1 = esCellEnd ( x, width, cellSize, step, &ix );
+            esProceduralFill ( job, dst + x * pixelSize, ( ix + iy + iz ) & 1, x1 - x );
+         }
+
+         for ( ; x < width; x *= 2 )
+         {
+            memcpy ( dst + x * pixelSize, dst, ( size_t ) ( width - x < x ? width - x : x ) * pixelSize );
+         }
+
+         break;
+      }
+
+      case ES_PROCEDURAL_LINEAR_GRADIENT:
+      {
+         // 0 and 1 where the direction leaves the texture through its center
+         float dx = cosf ( texture->angle );
+         float dy = sinf ( texture->angle );
+         float scale = 1.0f / ( fabsf ( dx ) + fabsf ( dy ) );
+         float slope = dx * scale / width;
+         float start = ( ( ( y + 0.5f ) / job->height - 0.5f ) * dy + ( 0.5f / width - 0.5f ) * dx ) * scale + 0.5f;
+
+         for ( ; x < width; x += 4 )
+         {
+            esProceduralStore ( job, dst + x * pixelSize, esVecStep ( start + x * slope, slope ),
+                                width - x < 4 ? width - x : 4 );
+         }
+
+         break;
+      }
+
+      case ES_PROCEDURAL_RADIAL_GRADIENT:
+      {
+         // 0 in the center and 1 at the middle of the edges, a sphere in a 3D texture
+         float dv = ( y + 0.5f ) / job->height - 0.5f;
+         float dw = job->depth > 1 ? ( z + 0.5f ) / job->depth - 0.5f : 0.0f;
+         ESVec4 vw = esVecSet ( dv * dv + dw * dw );
+
+         for ( ; x < width; x += 4 )
+         {
+            ESVec4 du = esVecStep ( ( x + 0.5f ) / width - 0.5f, 1.0f / width );
+            ESVec4 t = esVecMul ( esVecSqrt ( esVecAdd ( esVecMul ( du, du ), vw ) ), esVecSet ( 2.0f ) );
+
+            esProceduralStore ( job, dst + x * pixelSize, t, width - x < 4 ? width - x : 4 );
+         }
+
+         break;
+      }
+
+      case ES_PROCEDURAL_VALUE_NOISE:
+      case ES_PROCEDURAL_PERLIN_NOISE:
+      {
+         GLboolean perlin = texture->type == ES_PROCEDURAL_PERLIN_NOISE;
+
+         for ( ; x < width; x = x1 )
+         {
+            float a0, b0, a1, b1;
+            ESVec4 va0, vb0, va1, vb1;
+
+            x1 = esCellEnd ( x, width, cellSize, step, &ix );
+            esNoiseColumn ( texture->seed, perlin, ix, iy, iz, fy, fz, zCorners, &a0, &b0 );
+            esNoiseColumn ( texture->seed, perlin, ix + 1, iy, iz, fy, fz, zCorners, &a1, &b1 );
+
+            // Perlin noise is in [-1, 1], value noise already in [0, 1]
+            if ( perlin )
+            {
+               a0 *= 0.5f;
+               a1 *= 0.5f;
+               b0 = b0 * 0.5f + 0.5f;
+               b1 = b1 * 0.5f - a1 + 0.5f;
+            }
+
+            va0 = esVecSet ( a0 );
+            vb0 = esVecSet ( b0 );
+            va1 = esVecSet ( a1 );
+            vb1 = esVecSet ( b1 );
+
+            for ( ; x < x1; x += 4 )
+            {
+               ESVec4 f = esVecStep ( ( x + 0.5f ) * step - ix, step );
+               ESVec4 n0 = esVecAdd ( esVecMul ( va0, f ), vb0 );
+               ESVec4 n1 = esVecAdd ( esVecMul ( va1, f ), vb1 );
+
+               esProceduralStore ( job, dst + x * pixelSize, esVecAdd ( n0, esVecMul ( esFade ( f ),
+                                   esVecSub ( n1, n0 ) ) ), x1 - x < 4 ? x1 - x : 4 );
+            }
+         }
+
+         break;
+      }
+
+      case ES_PROCEDURAL_CELLULAR_NOISE:
+      {
+         // distance to the nearest point of the cells around, one point jittered inside every cell
+         float px[27];
+         float d2[27];
+
+         for ( ; x < width; x = x1 )
+         {
+            int count = 0;
+            int dx, dy, dz, i;
+
+            x1 = esCellEnd ( x, width, cellSize, step, &ix );
+
+            for ( dz = 1 - zCorners; dz < zCorners; dz++ )
+            {
+               for ( dy = -1; dy <= 1; dy++ )
+               {
+                  for ( dx = -1; dx <= 1; dx++ )
+                  {
+                     GLuint h = esLatticeHash ( texture->seed, ix + dx, iy + dy, iz + dz );
+                     float  ey = fy - ( dy + ( ( h >> 10 ) & 1023 ) * ( 1.0f / 1024.0f ) );
+                     float  ez = zCorners > 1 ? fz - ( dz + ( ( h >> 20 ) & 1023 ) * ( 1.0f / 1024.0f ) ) : 0.0f;
+
+                     px[count] = dx + ( h & 1023 ) * ( 1.0f / 1024.0f );
+                     d2[count] = ey * ey + ez * ez;
+                     count++;
+                  }
+               }
+            }
+
+            for ( ; x < x1; x += 4 )
+            {
+               ESVec4 f = esVecStep ( ( x + 0.5f ) * step - ix, step );
+               ESVec4 nearest = esVecSet ( 1e30f );
+
+               for ( i = 0; i < count; i++ )
+               {
+                  ESVec4 d = esVecSub ( f, esVecSet ( px[i] ) );
+
+                  nearest = esVecMin ( nearest, esVecAdd ( esVecMul ( d, d ), esVecSet ( d2[i] ) ) );
+               }
+
+               esProceduralStore ( job, dst + x * pixelSize, esVecSqrt ( nearest ), x1 - x < 4 ? x1 - x : 4 );
+            }
+         }
+
+         break;
+      }
+
+      default:
+         memset ( dst, 0, ( size_t ) width * pixelSize );
+         break;
+   }
+}
+
+///
+// esProceduralRows()
+//
+//    Task of esGenTexture: a band of rows of one slice
+//
+static void ESCALLBACK esProceduralRows ( void *userData, int taskIndex )
+{
+   const ESProceduralJob *job = userData;
+   int z = taskIndex / job->tasksPerSlice;
+   int y = taskIndex % job->tasksPerSlice * job->rowsPerTask;
+   int end = y + job->rowsPerTask < job->height ? y + job->rowsPerTask : job->height;
+
+   for ( ; y < end; y++ )
+   {
+      esProceduralRow ( job, y, z, job->pixels + ( ( size_t ) z * job->height + y ) * job->pitch );
+   }
+}
+
+///
+// esProceduralPixelSize()
+//
+//    Bytes of a texel of format, 0 if esGenTexture doesn't write it
+//
+static int esProceduralPixelSize ( GLenum format )
+{
+   switch ( format )
+   {
+      case GL_RED:
+         return 1;
+
+      case GL_RG:
+         return 2;
+
+      case GL_RGB:
+         return 3;
+
+      case GL_RGBA:
+         return 4;
+
+      default:
+         return 0;
+   }
+}
+
+///
+// esGenTexture()
+//
+//    Split the rows of every slice into bands of about the same number of
+//    texels and generate them on the threads of the pool
+//
+GLboolean ESUTIL_API esGenTexture ( ESThreadPool *pool, const ESProceduralTexture *texture,
+                                    int width, int height, int depth, GLenum format, void *pixels )
+{
+   ESProceduralJob job;
+   int i, c;
+
+   job.pixelSize = esProceduralPixelSize ( format );
+
+   if ( job.pixelSize == 0 || width <= 0 || height <= 0 || depth <= 0 || pixels == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   job.texture = texture;
+   job.width = width;
+   job.height = height;
+   job.depth = depth;
+   job.pitch = ( size_t ) width * job.pixelSize;
+   job.rowsPerTask = width < PROCEDURAL_TASK_TEXELS ? PROCEDURAL_TASK_TEXELS / width : 1;
+   job.tasksPerSlice = ( height + job.rowsPerTask - 1 ) / job.rowsPerTask;
+   job.pixels = pixels;
+
+   for ( i = 0; i < 256; i++ )
+   {
+      for ( c = 0; c < 4; c++ )
+      {
+         job.ramp[i][c] = ( GLubyte ) ( ( texture->color0[c] * ( 255 - i ) + texture->color1[c] * i + 127 ) / 255 );
+      }
+   }
+
+   esRunTasks ( pool, job.tasksPerSlice * depth, esProceduralRows, &job );
+   return GL_TRUE;
+}
+
+///
+// esMapUnpackBuffer()
+//
+//    Bind a new GL_PIXEL_UNPACK_BUFFER of size bytes and map it for writing,
+//    the unpack state saved for esTexImageUnpackBuffer
+//
+static void *esMapUnpackBuffer ( GLsizeiptr size, GLint saved[UNPACK_STATE_COUNT], GLuint *buffer )
+{
+   esSaveUnpackState ( saved );
+   glGenBuffers ( 1, buffer );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, *buffer );
+   glBufferData ( GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW );
+
+   return glMapBufferRange ( GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+}
+
+///
+// esTexImageUnpackBuffer()
+//
+//    Unmap the buffer of esMapUnpackBuffer, upload level 0 of the bound
+//    texture from it when it was filled and delete it
+//
+static GLboolean esTexImageUnpackBuffer ( GLenum target, GLenum internalFormat, int width, int height, int depth,
+                                          GLenum format, int pitch, GLboolean filled,
+                                          const GLint saved[UNPACK_STATE_COUNT], GLuint buffer )
+{
+   // GL_FALSE from the unmap means the contents were lost
+   if ( !glUnmapBuffer ( GL_PIXEL_UNPACK_BUFFER ) )
+   {
+      filled = GL_FALSE;
+   }
+
+   if ( filled )
+   {
+      glPixelStorei ( GL_UNPACK_ALIGNMENT, esUnpackAlignment ( pitch ) );
+
+      if ( target == GL_TEXTURE_3D || target == GL_TEXTURE_2D_ARRAY )
+      {
+         glTexImage3D ( target, 0, internalFormat, width, height, depth, 0, format, GL_UNSIGNED_BYTE, NULL );
+      }
+      else
+      {
+         glTexImage2D ( target, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, NULL );
+      }
+   }
+
+   esRestoreUnpackState ( saved );
+   glDeleteBuffers ( 1, &buffer );
+
+   return filled;
+}
+
+///
+// esTexImageProcedural()
+//
+//    The texels are written once, into the mapped buffer the GL copies
+//    them from
+//
+GLboolean ESUTIL_API esTexImageProcedural ( ESThreadPool *pool, GLenum target, const ESProceduralTexture *texture,
+                                            int width, int height, int depth, GLenum format )
+{
+   static const GLenum internalFormats[5] = { GL_NONE, GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+   GLint      saved[UNPACK_STATE_COUNT];
+   int        pixelSize = esProceduralPixelSize ( format );
+   int        pitch = width * pixelSize;
+   GLsizeiptr size = ( GLsizeiptr ) pitch * height * depth;
+   GLuint     buffer;
+   void      *pixels;
+
+   if ( pixelSize == 0 || width <= 0 || height <= 0 || depth <= 0 ||
+         ( depth != 1 && target != GL_TEXTURE_3D && target != GL_TEXTURE_2D_ARRAY ) )
+   {
+      return GL_FALSE;
+   }
+
+   pixels = esMapUnpackBuffer ( size, saved, &buffer );
+
+   if ( pixels == NULL )
+   {
+      esLogMessage ( "esTexImageProcedural FAILED to map %d bytes\n", ( int ) size );
+      esRestoreUnpackState ( saved );
+      glDeleteBuffers ( 1, &buffer );
+      return GL_FALSE;
+   }
+
+   return esTexImageUnpackBuffer ( target, internalFormats[pixelSize], width, height, depth, format, pitch,
+                                   esGenTexture ( pool, texture, width, height, depth, format, pixels ),
+                                   saved, buffer );
+}
+
+///
+// Noise volumes
+//
+
+#define NOISE_CACHE_MAGIC    0x4C4F564E   // "NVOL"
+#define NOISE_CACHE_VERSION  1
+
+typedef struct
+{
+   /// Written last, a file cut short is never taken for a cache
+   GLuint             magic;
+   GLuint             version;
+   GLuint             headerSize;
+   GLuint             size;
+
+   /// esNoiseVolumeKey of the volume, also the name of the file
+   unsigned long long key;
+} ESNoiseCacheHeader;
+
+typedef struct
+{
+   /// Along every axis: lattice cell and the cell after it, both wrapped when the volume tiles,
+   /// fraction, fraction - 1 and fade weight of each coordinate, padded by 3 for the loads of the
+   /// last vector of a row
+   int           *cell;
+   int           *next;
+   GLfloat       *f0;
+   GLfloat       *f1;
+   GLfloat       *fade;
+
+   /// Runs of x inside one lattice cell, spanStart[spanCount] is size
+   int            spanCount;
+   int           *spanStart;
+
+   GLfloat        amplitude;
+} ESNoiseOctave;
+
+typedef struct
+{
+   const ESNoiseLattice *lattice;
+   int            size;
+   int            octaveCount;
+   ESNoiseOctave *octaves;
+
+   /// Noise of every voxel and the range of every slice, then of the volume
+   GLfloat       *values;
+   GLfloat       *minimum;
+   GLfloat       *maximum;
+   GLfloat        low;
+   GLfloat        range;
+
+   GLubyte       *texels;
+} ESNoiseVolumeJob;
+
+///
+// esLerp4()
+//
+//    a + t * ( b - a ), the order of the scalar lerp
+//
+static ESVec4 esLerp4 ( ESVec4 t, ESVec4 a, ESVec4 b )
+{
+   return esVecAdd ( a, esVecMul ( t, esVecSub ( b, a ) ) );
+}
+
+///
+// esNoiseOctaveTables()
+//
+//    The tables of an octave along an axis, shared by all three since every
+//    coordinate maps to the lattice the same way.  A period wraps the cells
+//    so the last voxel blends into the first one.
+//
+static void esNoiseOctaveTables ( ESNoiseOctave *octave, int size, GLfloat frequency, int period )
+{
+   int i;
+
+   octave->spanCount = 0;
+
+   for ( i = 0; i < size + 3; i++ )
+   {
+      // coordinates are never negative, truncation is the floor
+      float position = ( float ) i / ( float ) size * frequency;
+      float f = position - ( int ) position;
+      int   cell = ( int ) position;
+
+      octave->cell[i] = period > 0 ? cell % period : cell;
+      octave->next[i] = period > 0 ? ( cell + 1 ) % period : cell + 1;
+      octave->f0[i] = f;
+      octave->f1[i] = f - 1;
+      octave->fade[i] = f * f * f * ( f * ( f * 6.0f - 15.0f ) + 10.0f );
+
+      if ( i < size && ( i == 0 || octave->cell[i] != octave->cell[i - 1] ) )
+      {
+         octave->spanStart[octave->spanCount++] = i;
+      }
+   }
+
+   octave->spanStart[octave->spanCount] = size;
+}
+
+///
+// esNoiseVolumeSlice()
+//
+//    Task of esBuildFbmVolume: the noise of slice z and its range.  Every
+//    row sums its octaves while it is in the cache.  The 8 gradients of a
+//    lattice cell are looked up once for the run of x inside it, and their
+//    y and z terms are constant along the row.
+//
+static void ESCALLBACK esNoiseVolumeSlice ( void *userData, int z )
+{
+   ESNoiseVolumeJob *job = userData;
+   const GLubyte    *permutation = job->lattice->permutation;
+   int     size = job->size;
+   float   lowest = 1e30f;
+   float   highest = -1e30f;
+   ESVec4  low = esVecSet ( 1e30f );
+   ESVec4  high = esVecSet ( -1e30f );
+   float   lanes[4];
+   int     x, y, o, s, c, i;
+
+   for ( y = 0; y < size; y++ )
+   {
+      GLfloat *row = job->values + ( ( size_t ) z * size + y ) * size;
+
+      for ( o = 0; o < job->octaveCount; o++ )
+      {
+         const ESNoiseOctave *octave = job->octaves + o;
+         ESVec4  amplitude = esVecSet ( octave->amplitude );
+         ESVec4  wy = esVecSet ( octave->fade[y] );
+         ESVec4  wz = esVecSet ( octave->fade[z] );
+         int     iy[2], zHash[2], rowHash[4];
+         float   fy[2], fz[2];
+
+         iy[0] = octave->cell[y];
+         iy[1] = octave->next[y];
+         zHash[0] = permutation[octave->cell[z] & 255];
+         zHash[1] = permutation[octave->next[z] & 255];
+         fy[0] = octave->f0[y];
+         fy[1] = octave->f1[y];
+         fz[0] = octave->f0[z];
+         fz[1] = octave->f1[z];
+
+         // corners ( dy, dz ) of the row, dz major
+         for ( c = 0; c < 4; c++ )
+         {
+            rowHash[c] = permutation[( iy[c & 1] + zHash[c >> 1] ) & 255];
+         }
+
+         for ( s = 0; s < octave->spanCount; s++ )
+         {
+            int    x0 = octave->spanStart[s];
+            int    x1 = octave->spanStart[s + 1];
+            int    ix[2];
+            ESVec4 gx[8], gy[8], gz[8];
+
+            ix[0] = octave->cell[x0];
+            ix[1] = octave->next[x0];
+
+            // corner dx + 2 dy + 4 dz, the same order as in noise3D
+            for ( c = 0; c < 8; c++ )
+            {
+               const GLfloat *g = job->lattice->gradients[( ix[c & 1] + rowHash[c >> 1] ) & 255];
+
+               gx[c] = esVecSet ( g[0] );
+               gy[c] = esVecSet ( g[1] * fy[( c >> 1 ) & 1] );
+               gz[c] = esVecSet ( g[2] * fz[c >> 2] );
+            }
+
+            for ( x = x0; x < x1; x += 4 )
+            {
+               ESVec4 fx[2], wx, v[8], value;
+
+               fx[0] = esVecLoad ( octave->f0 + x );
+               fx[1] = esVecLoad ( octave->f1 + x );
+               wx = esVecLoad ( octave->fade + x );
+
+               for ( c = 0; c < 8; c++ )
+               {
+                  v[c] = esVecAdd ( esVecAdd ( esVecMul ( gx[c], fx[c & 1] ), gy[c] ), gz[c] );
+               }
+
+               value = esLerp4 ( wz, esLerp4 ( wy, esLerp4 ( wx, v[0], v[1] ), esLerp4 ( wx, v[2], v[3] ) ),
+                                     esLerp4 ( wy, esLerp4 ( wx, v[4], v[5] ), esLerp4 ( wx, v[6], v[7] ) ) );
+
+               // the first octave has an amplitude of 1 and is stored as it is
+               if ( x1 - x >= 4 )
+               {
+                  esVecStore ( row + x, o == 0 ? value : esVecAdd ( esVecLoad ( row + x ),
+                                                                    esVecMul ( amplitude, value ) ) );
+                  continue;
+               }
+
+               // the lanes past the run belong to the next cell
+               esVecStore ( lanes, value );
+
+               for ( i = 0; i < x1 - x; i++ )
+               {
+                  row[x + i] = o == 0 ? lanes[i] : row[x + i] + octave->amplitude * lanes[i];
+               }
+            }
+         }
+      }
+
+      for ( x = 0; x + 4 <= size; x += 4 )
+      {
+         ESVec4 value = esVecLoad ( row + x );
+
+         low = esVecMin ( low, value );
+         high = esVecMax ( high, value );
+      }
+
+      for ( ; x < size; x++ )
+      {
+         lowest = row[x] < lowest ? row[x] : lowest;
+         highest = row[x] > highest ? row[x] : highest;
+      }
+   }
+
+   esVecStore ( lanes, low );
+
+   for ( i = 0; i < 4; i++ )
+   {
+      lowest = lanes[i] < lowest ? lanes[i] : lowest;
+   }
+
+   esVecStore ( lanes, high );
+
+   for ( i = 0; i < 4; i++ )
+   {
+      highest = lanes[i] > highest ? lanes[i] : highest;
+   }
+
+   job->minimum[z] = lowest;
+   job->maximum[z] = highest;
+}
+
+///
+// esQuantizeNoiseSlice()
+//
+//    Task of esBuildFbmVolume: slice z from the range of the volume to
+//    0 - 255, truncated like the scalar ( GLubyte ) cast
+//
+static void ESCALLBACK esQuantizeNoiseSlice ( void *userData, int z )
+{
+   const ESNoiseVolumeJob *job = userData;
+   size_t         count = ( size_t ) job->size * job->size;
+   const GLfloat *src = job->values + z * count;
+   GLubyte       *dst = job->texels + z * count;
+   size_t         i = 0;
+
+#if defined(ES_SSE2)
+   const __m128 low = _mm_set1_ps ( job->low );
+   const __m128 range = _mm_set1_ps ( job->range );
+   const __m128 scale = _mm_set1_ps ( 255.0f );
+   __m128i      q[4];
+   int          k;
+
+   for ( ; i + 16 <= count; i += 16 )
+   {
+      for ( k = 0; k < 4; k++ )
+      {
+         __m128 v = _mm_div_ps ( _mm_sub_ps ( _mm_loadu_ps ( src + i + 4 * k ), low ), range );
+         q[k] = _mm_cvttps_epi32 ( _mm_mul_ps ( v, scale ) );
+      }
+
+      _mm_storeu_si128 ( ( __m128i * ) ( dst + i ), _mm_packus_epi16 ( _mm_packs_epi32 ( q[0], q[1] ),
+                         _mm_packs_epi32 ( q[2], q[3] ) ) );
+   }
+#elif defined(ES_NEON) && ( defined(__aarch64__) || defined(_M_ARM64) )
+   // a division, not a reciprocal estimate, so every value rounds the same as the scalar one
+   const float32x4_t low = vdupq_n_f32 ( job->low );
+   const float32x4_t range = vdupq_n_f32 ( job->range );
+   uint16x4_t        q[2];
+   int               k;
+
+   for ( ; i + 8 <= count; i += 8 )
+   {
+      for ( k = 0; k < 2; k++ )
+      {
+         float32x4_t v = vdivq_f32 ( vsubq_f32 ( vld1q_f32 ( src + i + 4 * k ), low ), range );
+         q[k] = vmovn_u32 ( vcvtq_u32_f32 ( vmulq_n_f32 ( v, 255.0f ) ) );
+      }
+
+      vst1_u8 ( dst + i, vmovn_u16 ( vcombine_u16 ( q[0], q[1] ) ) );
+   }
+#endif
+
+   for ( ; i < count; i++ )
+   {
+      dst[i] = ( GLubyte ) ( ( ( src[i] - job->low ) / job->range ) * 255.0f );
+   }
+}
+
+///
+// esBuildFbmVolume()
+//
+//    The slices are generated with their ranges first, then quantized with
+//    the range of the volume
+//
+GLboolean ESUTIL_API esBuildFbmVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice,
+                                        const ESNoiseVolume *volume, GLubyte *texels )
+{
+   ESNoiseVolumeJob job;
+   int      size = volume->size;
+   int      padded = size + 3;
+   size_t   tableBytes = ( 2 * padded + size + 1 ) * sizeof ( int ) + 3 * padded * sizeof ( GLfloat );
+   GLfloat  frequency = volume->frequency;
+   GLfloat  amplitude = 1.0f;
+   char    *tables;
+   int      i, o;
+   float    highest;
+
+   if ( size <= 0 || !( frequency > 0.0f ) || volume->octaves < 1 || !( volume->lacunarity > 0.0f ) ||
+        texels == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   job.lattice = lattice;
+   job.size = size;
+   job.octaveCount = volume->octaves;
+   job.texels = texels;
+   job.octaves = malloc ( job.octaveCount * ( sizeof ( ESNoiseOctave ) + tableBytes ) + 2 * size * sizeof ( GLfloat ) );
+   job.values = malloc ( ( size_t ) size * size * size * sizeof ( GLfloat ) );
+
+   if ( job.octaves == NULL || job.values == NULL )
+   {
+      free ( job.octaves );
+      free ( job.values );
+      return GL_FALSE;
+   }
+
+   tables = ( char * ) ( job.octaves + job.octaveCount );
+
+   for ( o = 0; o < job.octaveCount; o++ )
+   {
+      ESNoiseOctave *octave = job.octaves + o;
+      int            period = 0;
+
+      octave->cell = ( int * ) ( tables + o * tableBytes );
+      octave->next = octave->cell + padded;
+      octave->spanStart = octave->next + padded;
+      octave->f0 = ( GLfloat * ) ( octave->spanStart + size + 1 );
+      octave->f1 = octave->f0 + padded;
+      octave->fade = octave->f1 + padded;
+      octave->amplitude = amplitude;
+
+      // a whole number of cells across the volume, each octave rounded on its own
+      if ( volume->tileable )
+      {
+         period = ( int ) ( frequency + 0.5f );
+         period = period > 0 ? period : 1;
+      }
+
+      esNoiseOctaveTables ( octave, size, period > 0 ? ( GLfloat ) period : frequency, period );
+
+      frequency *= volume->lacunarity;
+      amplitude *= volume->gain;
+   }
+
+   job.minimum = ( GLfloat * ) ( tables + job.octaveCount * tableBytes );
+   job.maximum = job.minimum + size;
+
+   esRunTasks ( pool, size, esNoiseVolumeSlice, &job );
+
+   job.low = job.minimum[0];
+   highest = job.maximum[0];
+
+   for ( i = 1; i < size; i++ )
+   {
+      job.low = job.minimum[i] < job.low ? job.minimum[i] : job.low;
+      highest = job.maximum[i] > highest ? job.maximum[i] : highest;
+   }
+
+   job.range = highest - job.low;
+
+   esRunTasks ( pool, size, esQuantizeNoiseSlice, &job );
+
+   free ( job.octaves );
+   free ( job.values );
+
+   return GL_TRUE;
+}
+
+///
+// esBuildNoiseVolume()
+//
+//    A single octave
+//
+GLboolean ESUTIL_API esBuildNoiseVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice, int size,
+                                          GLfloat frequency, GLubyte *texels )
+{
+   ESNoiseVolume volume;
+
+   volume.size = size;
+   volume.frequency = frequency;
+   volume.octaves = 1;
+   volume.lacunarity = 2.0f;
+   volume.gain = 0.5f;
+   volume.tileable = GL_FALSE;
+
+   return esBuildFbmVolume ( pool, lattice, &volume, texels );
+}
+
+///
+// esNoiseVolumeKey()
+//
+//    64 bit FNV-1a of everything the texels depend on
+//
+static unsigned long long esNoiseVolumeKey ( const ESNoiseLattice *lattice, const ESNoiseVolume *volume )
+{
+   unsigned long long   key = 14695981039346656037ull;
+   GLuint               fields[7];
+   const unsigned char *bytes;
+   size_t               i;
+
+   fields[0] = NOISE_CACHE_VERSION;
+   fields[1] = ( GLuint ) volume->size;
+   fields[2] = ( GLuint ) volume->octaves;
+   fields[3] = volume->tileable ? 1 : 0;
+   memcpy ( &fields[4], &volume->frequency, sizeof ( GLfloat ) );
+   memcpy ( &fields[5], &volume->lacunarity, sizeof ( GLfloat ) );
+   memcpy ( &fields[6], &volume->gain, sizeof ( GLfloat ) );
+
+   for ( bytes = ( const unsigned char * ) fields, i = 0; i < sizeof ( fields ); i++ )
+   {
+      key = ( key ^ bytes[i] ) * 1099511628211ull;
+   }
+
+   for ( bytes = ( const unsigned char * ) lattice, i = 0; i < sizeof ( ESNoiseLattice ); i++ )
+   {
+      key = ( key ^ bytes[i] ) * 1099511628211ull;
+   }
+
+   return key;
+}
+
+///
+// esTexImageNoiseTexels()
+//
+//    Level 0 of the bound GL_TEXTURE_3D from a cube of texels in memory
+//
+static void esTexImageNoiseTexels ( int size, const GLubyte *texels )
+{
+   GLint saved[UNPACK_STATE_COUNT];
+
+   esSaveUnpackState ( saved );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, esUnpackAlignment ( size ) );
+   glTexImage3D ( GL_TEXTURE_3D, 0, GL_R8, size, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, texels );
+   esRestoreUnpackState ( saved );
+}
+
+///
+// esTexImageNoiseCache()
+//
+//    Upload the texels of a cache file straight from its mapping
+//
+static GLboolean esTexImageNoiseCache ( const char *fileName, unsigned long long key, int size )
+{
+   ESMappedFile              file;
+   const ESNoiseCacheHeader *header;
+
+   if ( !esMapFile ( NULL, fileName, &file ) )
+   {
+      return GL_FALSE;
+   }
+
+   header = ( const ESNoiseCacheHeader * ) file.data;
+
+   if ( file.size != sizeof ( ESNoiseCacheHeader ) + ( size_t ) size * size * size ||
+        header->magic != NOISE_CACHE_MAGIC || header->version != NOISE_CACHE_VERSION ||
+        header->headerSize != sizeof ( ESNoiseCacheHeader ) || header->size != ( GLuint ) size || header->key != key )
+   {
+      esUnmapFile ( &file );
+      return GL_FALSE;
+   }
+
+   esTexImageNoiseTexels ( size, file.data + sizeof ( ESNoiseCacheHeader ) );
+   esUnmapFile ( &file );
+
+   return GL_TRUE;
+}
+
+///
+// esWriteNoiseCache()
+//
+//    A failed write only costs the next run a rebuild
+//
+static void esWriteNoiseCache ( const char *fileName, unsigned long long key, int size, const GLubyte *texels )
+{
+   ESNoiseCacheHeader header;
+   FILE              *file;
+   GLboolean          ok;
+
+   memset ( &header, 0, sizeof ( ESNoiseCacheHeader ) );
+   header.version = NOISE_CACHE_VERSION;
+   header.headerSize = sizeof ( ESNoiseCacheHeader );
+   header.size = ( GLuint ) size;
+   header.key = key;
+
+   file = fopen ( fileName, "wb" );
+
+   if ( file == NULL )
+   {
+      esLogMessage ( "esTexImageFbmVolume: cannot write %s\n", fileName );
+      return;
+   }
+
+   ok = fwrite ( &header, sizeof ( ESNoiseCacheHeader ), 1, file ) == 1 &&
+        fwrite ( texels, ( size_t ) size * size * size, 1, file ) == 1 && fflush ( file ) == 0;
+
+   header.magic = NOISE_CACHE_MAGIC;
+   ok = ok && fseek ( file, 0, SEEK_SET ) == 0 && fwrite ( &header.magic, sizeof ( header.magic ), 1, file ) == 1;
+   ok = fclose ( file ) == 0 && ok;
+
+   if ( !ok )
+   {
+      esLogMessage ( "esTexImageFbmVolume: cannot write %s\n", fileName );
+      remove ( fileName );
+   }
+}
+
+///
+// esTexImageFbmVolume()
+//
+//    Without a cache directory the volume is built straight into a mapped
+//    pixel unpack buffer.  With one it is built in memory once, written to
+//    a file named after its key and mapped on every later run.
+//
+GLboolean ESUTIL_API esTexImageFbmVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice,
+                                           const ESNoiseVolume *volume, const char *cacheDir )
+{
+   GLint              saved[UNPACK_STATE_COUNT];
+   int                size = volume->size;
+   GLsizeiptr         bytes = ( GLsizeiptr ) size * size * size;
+   unsigned long long key;
+   char              *fileName;
+   GLuint             buffer;
+   GLubyte           *texels;
+   GLboolean          built;
+
+   if ( size <= 0 )
+   {
+      return GL_FALSE;
+   }
+
+   if ( cacheDir == NULL )
+   {
+      texels = esMapUnpackBuffer ( bytes, saved, &buffer );
+
+      if ( texels == NULL )
+      {
+         esLogMessage ( "esTexImageFbmVolume FAILED to map %d bytes\n", ( int ) bytes );
+         esRestoreUnpackState ( saved );
+         glDeleteBuffers ( 1, &buffer );
+         return GL_FALSE;
+      }
+
+      return esTexImageUnpackBuffer ( GL_TEXTURE_3D, GL_R8, size, size, size, GL_RED, size,
+                                      esBuildFbmVolume ( pool, lattice, volume, texels ), saved, buffer );
+   }
+
+   key = esNoiseVolumeKey ( lattice, volume );
+   fileName = malloc ( strlen ( cacheDir ) + 32 );
+
+   if ( fileName == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   sprintf ( fileName, "%s/noise-%08x%08x.vol", cacheDir, ( unsigned int ) ( key >> 32 ), ( unsigned int ) key );
+
+   if ( esTexImageNoiseCache ( fileName, key, size ) )
+   {
+      free ( fileName );
+      return GL_TRUE;
+   }
+
+   texels = malloc ( ( size_t ) bytes );
+   built = texels != NULL && esBuildFbmVolume ( pool, lattice, volume, texels );
+
+   if ( built )
+   {
+      esWriteNoiseCache ( fileName, key, size, texels );
+      esTexImageNoiseTexels ( size, texels );
+   }
+
+   free ( texels );
+   free ( fileName );
+
+   return built;
+}
+
+///
+// esTexImageNoiseVolume()
+//
+//    A single octave, straight into a mapped pixel unpack buffer
+//
+GLboolean ESUTIL_API esTexImageNoiseVolume ( ESThreadPool *pool, const ESNoiseLattice *lattice, int size,
+                                             GLfloat frequency )
+{
+   ESNoiseVolume volume;
+
+   volume.size = size;
+   volume.frequency = frequency;
+   volume.octaves = 1;
+   volume.lacunarity = 2.0f;
+   volume.gain = 0.5f;
+   volume.tileable = GL_FALSE;
+
+   return esTexImageFbmVolume ( pool, lattice, &volume, NULL );
+}
@@ -0,0 +1,110 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esUtil_private.h
+//
+//    Declarations shared by the source files of the Common library and
+//    not part of its interface: the SIMD paths of esVec4.h, the locks of
+//    the threads and the helpers of the texture uploads.
+
+#ifndef ESUTIL_PRIVATE_H
+#define ESUTIL_PRIVATE_H
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esVec4.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+///
+//  Macros
+//
+
+/// Lock and condition variables of a struct with lock and cond members
+#ifdef _WIN32
+#define esPoolLock(pool)    EnterCriticalSection ( &(pool)->lock )
+#define esPoolUnlock(pool)  LeaveCriticalSection ( &(pool)->lock )
+#define esPoolWait(pool, cond)  SleepConditionVariableCS ( &(pool)->cond, &(pool)->lock, INFINITE )
+#define esPoolWakeAll(pool, cond)  WakeAllConditionVariable ( &(pool)->cond )
+#else
+#define esPoolLock(pool)    pthread_mutex_lock ( &(pool)->lock )
+#define esPoolUnlock(pool)  pthread_mutex_unlock ( &(pool)->lock )
+#define esPoolWait(pool, cond)  pthread_cond_wait ( &(pool)->cond, &(pool)->lock )
+#define esPoolWakeAll(pool, cond)  pthread_cond_broadcast ( &(pool)->cond )
+#endif
+
+/// Values saved by esSaveUnpackState
+#define UNPACK_STATE_COUNT 6
+
+///
+//  Functions (esUtil.c)
+//
+
+/// GL format of the pixels of an image from esMapTGA and the swizzle putting its channels in RGBA order
+GLboolean esFormatTGA ( int bytesPerPixel, GLenum *internalFormat, GLenum *format, GLenum *type,
+                        GLint swizzle[4] );
+
+void esSwizzle ( GLenum target, const GLint swizzle[4] );
+
+/// Save the unpack state the uploads change and set tightly packed rows, esRestoreUnpackState puts it back
+void esSaveUnpackState ( GLint saved[UNPACK_STATE_COUNT] );
+void esRestoreUnpackState ( const GLint saved[UNPACK_STATE_COUNT] );
+
+/// Largest GL_UNPACK_ALIGNMENT rows of pitch bytes are aligned to
+GLint esUnpackAlignment ( int pitch );
+
+///
+//  Functions (esTextureKTX.c)
+//
+
+/// Little endian 32 bit value of a file
+GLuint esReadU32 ( const unsigned char *data );
+
+/// Upload one face of one level of a width x height texture from a mapped file, compressed when format is GL_NONE
+void esTexImageLevel ( GLenum target, GLint level, GLenum internalFormat, GLenum format, GLenum type,
+                       int width, int height, const unsigned char *data, size_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESUTIL_PRIVATE_H
@@ -0,0 +1,1495 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// CompressTexture.c
+//
+//    Build-time converter from TGA images to ETC2 / EAC compressed KTX
+//    files, mip levels included.  The blocks are encoded on every processor,
+//    then level 0 is decoded again to report its PSNR against the TGA.
+//
+//    CompressTexture [-format etc2|etc2a|r11] [-srgb] [-nomips] [-threads n] in.tga out.ktx|out.ktx2
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define FORMAT_ETC2     0
+#define FORMAT_ETC2A    1
+#define FORMAT_R11      2
+
+/// Intensity modifiers of ETC1 / ETC2, the small and the large one of each table
+static const int etcModifiers[8][2] =
+{
+   {  2,   8 }, {  5,  17 }, {  9,  29 }, { 13,  42 },
+   { 18,  60 }, { 24,  80 }, { 33, 106 }, { 47, 183 }
+};
+
+/// Distances of the T and H modes
+static const int etcDistances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+/// Modifiers of EAC alpha and R11
+static const int eacModifiers[16][8] =
+{
+   { -3, -6,  -9, -15, 2, 5, 8, 14 },
+   { -3, -7, -10, -13, 2, 6, 9, 12 },
+   { -2, -5,  -8, -13, 1, 4, 7, 12 },
+   { -2, -4,  -6, -13, 1, 3, 5, 12 },
+   { -3, -6,  -8, -12, 2, 5, 7, 11 },
+   { -3, -7,  -9, -11, 2, 6, 8, 10 },
+   { -4, -7,  -8, -11, 3, 6, 7, 10 },
+   { -3, -5,  -8, -11, 2, 4, 7, 10 },
+   { -2, -6,  -8, -10, 1, 5, 7,  9 },
+   { -2, -5,  -8, -10, 1, 4, 7,  9 },
+   { -2, -4,  -8, -10, 1, 3, 7,  9 },
+   { -2, -5,  -7, -10, 1, 4, 6,  9 },
+   { -3, -4,  -7, -10, 2, 3, 6,  9 },
+   { -1, -2,  -3, -10, 0, 1, 2,  9 },
+   { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+   { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+/// Pixels of the two subblocks, side by side (flip 0) or one above the other (flip 1).
+/// Pixels of a block are numbered down the columns, x * 4 + y.
+static const int subblockPixels[2][2][8] =
+{
+   { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } },
+   { { 0, 1, 4, 5, 8, 9, 12, 13 }, { 2, 3, 6, 7, 10, 11, 14, 15 } }
+};
+
+typedef unsigned long long Block;
+
+typedef struct
+{
+   // Base color of a subblock in 4 or 5 bits, its table, the index of each of its pixels and the error
+   int   color[3];
+   int   table;
+   int   indices[8];
+   int   error;
+} SubblockFit;
+
+typedef struct
+{
+   int   format;
+   const ESMipChain *chain;
+
+   // First block row of each level, the blocks of each level
+   int   levelCount;
+   int   firstRow[ES_MAX_MIP_LEVELS + 1];
+   unsigned char *blocks[ES_MAX_MIP_LEVELS];
+} EncodeJob;
+
+///
+// Seconds from an arbitrary point, for timing the encoder
+//
+static double Now ( void )
+{
+#ifdef _WIN32
+   LARGE_INTEGER frequency, counter;
+
+   QueryPerformanceFrequency ( &frequency );
+   QueryPerformanceCounter ( &counter );
+   return ( double ) counter.QuadPart / ( double ) frequency.QuadPart;
+#else
+   struct timespec now;
+
+   clock_gettime ( CLOCK_MONOTONIC, &now );
+   return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+static int Clamp ( int value, int low, int high )
+{
+   return value < low ? low : value > high ? high : value;
+}
+
+/// Expand 4, 5, 6 and 7-bit colors to 8 bits by replicating the high bits
+static int Expand ( int value, int bits )
+{
+   return value << ( 8 - bits ) | value >> ( 2 * bits - 8 );
+}
+
+/// Nearest color of 4 or 5 bits to an 8-bit one
+static int Quantize ( float value, int bits )
+{
+   int top = ( 1 << bits ) - 1;
+
+   return Clamp ( ( int ) ( value * top / 255.0f + 0.5f ), 0, top );
+}
+
+/// 3-bit two's complement differences of the differential mode
+static int Signed3 ( int value )
+{
+   return value >= 4 ? value - 8 : value;
+}
+
+/// Index bits of pixel i: the high bit in the upper half of the low 32 bits, the low bit in the lower half
+static Block PixelIndex ( int i, int index )
+{
+   return ( Block ) ( index >> 1 ) << ( 16 + i ) | ( Block ) ( index & 1 ) << i;
+}
+
+static int SquaredError ( const int color[3], const unsigned char *pixel )
+{
+   int r = color[0] - pixel[0], g = color[1] - pixel[1], b = color[2] - pixel[2];
+
+   return r * r + g * g + b * b;
+}
+
+///
+// DecodeEtc2()
+//
+//    Decode the 16 pixels of an ETC2 RGB block, every mode of it
+//
+static void DecodeEtc2 ( Block bits, unsigned char pixels[16][4] )
+{
+   int paint[4][3];
+   int colors[2][3];
+   int i, c;
+   int r = ( int ) ( bits >> 59 & 31 ), dr = Signed3 ( ( int ) ( bits >> 56 & 7 ) );
+   int g = ( int ) ( bits >> 51 & 31 ), dg = Signed3 ( ( int ) ( bits >> 48 & 7 ) );
+   int b = ( int ) ( bits >> 43 & 31 ), db = Signed3 ( ( int ) ( bits >> 40 & 7 ) );
+   int differential = ( int ) ( bits >> 33 & 1 );
+
+   if ( differential && ( r + dr < 0 || r + dr > 31 ) )
+   {
+      // T mode: one paint color is the first color, the others the second one and the distance
+      int d = etcDistances[( bits >> 34 & 3 ) << 1 | ( bits >> 32 & 1 )];
+
+      colors[0][0] = Expand ( ( int ) ( ( bits >> 59 & 3 ) << 2 | ( bits >> 56 & 3 ) ), 4 );
+      colors[0][1] = Expand ( ( int ) ( bits >> 52 & 15 ), 4 );
+      colors[0][2] = Expand ( ( int ) ( bits >> 48 & 15 ), 4 );
+      colors[1][0] = Expand ( ( int ) ( bits >> 44 & 15 ), 4 );
+      colors[1][1] = Expand ( ( int ) ( bits >> 40 & 15 ), 4 );
+      colors[1][2] = Expand ( ( int ) ( bits >> 36 & 15 ), 4 );
+
+      for ( c = 0; c < 3; c++ )
+      {
+         paint[0][c] = colors[0][c];
+         paint[1][c] = Clamp ( colors[1][c] + d, 0, 255 );
+         paint[2][c] = colors[1][c];
+         paint[3][c] = Clamp ( colors[1][c] - d, 0, 255 );
+      }
+   }
+   else if ( differential && ( g + dg < 0 || g + dg > 31 ) )
+   {
+      // H mode: two paint colors around each color, the order of the colors is the last bit of the distance
+      int red1 = ( int ) ( bits >> 59 & 15 );
+      int green1 = ( int ) ( ( bits >> 56 & 7 ) << 1 | ( bits >> 52 & 1 ) );
+      int blue1 = ( int ) ( ( bits >> 51 & 1 ) << 3 | ( bits >> 47 & 7 ) );
+      int red2 = ( int ) ( bits >> 43 & 15 ), green2 = ( int ) ( bits >> 39 & 15 ), blue2 = ( int ) ( bits >> 35 & 15 );
+      int order = ( red1 << 8 | green1 << 4 | blue1 ) >= ( red2 << 8 | green2 << 4 | blue2 );
+      int d = etcDistances[( bits >> 34 & 1 ) << 2 | ( bits >> 32 & 1 ) << 1 | order];
+
+      colors[0][0] = Expand ( red1, 4 );
+      colors[0][1] = Expand ( green1, 4 );
+      colors[0][2] = Expand ( blue1, 4 );
+      colors[1][0] = Expand ( red2, 4 );
+      colors[1][1] = Expand ( green2, 4 );
+      colors[1][2] = Expand ( blue2, 4 );
+
+      for ( c = 0; c < 3; c++ )
+      {
+         paint[0][c] = Clamp ( colors[0][c] + d, 0, 255 );
+         paint[1][c] = Clamp ( colors[0][c] - d, 0, 255 );
+         paint[2][c] = Clamp ( colors[1][c] + d, 0, 255 );
+         paint[3][c] = Clamp ( colors[1][c] - d, 0, 255 );
+      }
+   }
+   else if ( differential && ( b + db < 0 || b + db > 31 ) )
+   {
+      // planar mode: a gradient through the colors at the origin, right of the block and below it
+      int origin[3], horizontal[3], vertical[3];
+
+      origin[0] = Expand ( ( int ) ( bits >> 57 & 63 ), 6 );
+      origin[1] = Expand ( ( int ) ( ( bits >> 56 & 1 ) << 6 | ( bits >> 49 & 63 ) ), 7 );
+      origin[2] = Expand ( ( int ) ( ( bits >> 48 & 1 ) << 5 | ( bits >> 43 & 3 ) << 3 | ( bits >> 39 & 7 ) ), 6 );
+      horizontal[0] = Expand ( ( int ) ( ( bits >> 34 & 31 ) << 1 | ( bits >> 32 & 1 ) ), 6 );
+      horizontal[1] = Expand ( ( int ) ( bits >> 25 & 127 ), 7 );
+      horizontal[2] = Expand ( ( int ) ( bits >> 19 & 63 ), 6 );
+      vertical[0] = Expand ( ( int ) ( bits >> 13 & 63 ), 6 );
+      vertical[1] = Expand ( ( int ) ( bits >> 6 & 127 ), 7 );
+      vertical[2] = Expand ( ( int ) ( bits & 63 ), 6 );
+
+      for ( i = 0; i < 16; i++ )
+      {
+         int x = i >> 2, y = i & 3;
+
+         for ( c = 0; c < 3; c++ )
+         {
+            int value = x * ( horizontal[c] - origin[c] ) + y * ( vertical[c] - origin[c] ) + 4 * origin[c] + 2;
+
+            pixels[i][c] = ( unsigned char ) Clamp ( value < 0 ? 0 : value >> 2, 0, 255 );
+         }
+      }
+
+      return;
+   }
+   else
+   {
+      // individual or differential mode: a base color and a modifier table for each subblock
+      int flip = ( int ) ( bits >> 32 & 1 );
+      int tables[2];
+      int sub;
+
+      tables[0] = ( int ) ( bits >> 37 & 7 );
+      tables[1] = ( int ) ( bits >> 34 & 7 );
+
+      for ( c = 0; c < 3; c++ )
+      {
+         int shift = 56 - c * 8;
+
+         if ( differential )
+         {
+            colors[0][c] = ( int ) ( bits >> ( shift + 3 ) & 31 );
+            colors[1][c] = Expand ( colors[0][c] + Signed3 ( ( int ) ( bits >> shift & 7 ) ), 5 );
+            colors[0][c] = Expand ( colors[0][c], 5 );
+         }
+         else
+         {
+            colors[0][c] = Expand ( ( int ) ( bits >> ( shift + 4 ) & 15 ), 4 );
+            colors[1][c] = Expand ( ( int ) ( bits >> shift & 15 ), 4 );
+         }
+      }
+
+      for ( sub = 0; sub < 2; sub++ )
+      {
+         for ( i = 0; i < 8; i++ )
+         {
+            int pixel = subblockPixels[flip][sub][i];
+            int index = ( int ) ( ( bits >> ( 16 + pixel ) & 1 ) << 1 | ( bits >> pixel & 1 ) );
+            int modifier = etcModifiers[tables[sub]][index & 1] * ( index & 2 ? -1 : 1 );
+
+            for ( c = 0; c < 3; c++ )
+            {
+               pixels[pixel][c] = ( unsigned char ) Clamp ( colors[sub][c] + modifier, 0, 255 );
+            }
+         }
+      }
+
+      return;
+   }
+
+   for ( i = 0; i < 16; i++ )
+   {
+      int index = ( int ) ( ( bits >> ( 16 + i ) & 1 ) << 1 | ( bits >> i & 1 ) );
+
+      for ( c = 0; c < 3; c++ )
+      {
+         pixels[i][c] = ( unsigned char ) paint[index][c];
+      }
+   }
+}
+
+///
+// DecodeEac()
+//
+//    Decode an EAC block to 8-bit alpha, or to 11-bit red for R11
+//
+static void DecodeEac ( Block bits, int r11, int values[16] )
+{
+   int base = ( int ) ( bits >> 56 & 255 );
+   int multiplier = ( int ) ( bits >> 52 & 15 );
+   const int *modifiers = eacModifiers[bits >> 48 & 15];
+   int i;
+
+   for ( i = 0; i < 16; i++ )
+   {
+      int modifier = modifiers[bits >> ( 45 - 3 * i ) & 7];
+
+      if ( !r11 )
+      {
+         values[i] = Clamp ( base + modifier * multiplier, 0, 255 );
+      }
+      else
+      {
+         values[i] = Clamp ( base * 8 + 4 + ( multiplier > 0 ? modifier * multiplier * 8 : modifier ), 0, 2047 );
+      }
+   }
+}
+
+/// Squared error of the RGB of a block against its pixels
+static int BlockError ( Block bits, const unsigned char pixels[16][4] )
+{
+   unsigned char decoded[16][4];
+   int color[3];
+   int error = 0;
+   int i;
+
+   DecodeEtc2 ( bits, decoded );
+
+   for ( i = 0; i < 16; i++ )
+   {
+      color[0] = decoded[i][0];
+      color[1] = decoded[i][1];
+      color[2] = decoded[i][2];
+      error += SquaredError ( color, pixels[i] );
+   }
+
+   return error;
+}
+
+///
+// FitTable()
+//
+//    Index of each pixel of a subblock for a base color and a table, the error returned
+//
+static int FitTable ( const unsigned char pixels[16][4], const int *subblock, const int color[3], int table,
+                      int indices[8] )
+{
+   int paint[4][3];
+   int error = 0;
+   int i, index, c;
+
+   for ( index = 0; index < 4; index++ )
+   {
+      int modifier = etcModifiers[table][index & 1] * ( index & 2 ? -1 : 1 );
+
+      for ( c = 0; c < 3; c++ )
+      {
+         paint[index][c] = Clamp ( color[c] + modifier, 0, 255 );
+      }
+   }
+
+   for ( i = 0; i < 8; i++ )
+   {
+      const unsigned char *pixel = pixels[subblock[i]];
+      int best = 0x7fffffff;
+
+      for ( index = 0; index < 4; index++ )
+      {
+         int pixelError = SquaredError ( paint[index], pixel );
+
+         if ( pixelError < best )
+         {
+            best = pixelError;
+            indices[i] = index;
+         }
+      }
+
+      error += best;
+   }
+
+   return error;
+}
+
+///
+// FitSubblock()
+//
+//    Best base color of 4 or 5 bits and table for a subblock.  The base
+//    starts at the average color, then moves by the mean of the modifiers
+//    the pixels picked.  low and high bound the base color.
+//
+static void FitSubblock ( const unsigned char pixels[16][4], const int *subblock, int bits,
+                          const int low[3], const int high[3], SubblockFit *fit )
+{
+   float average[3] = { 0.0f, 0.0f, 0.0f };
+   int table, i, c, pass;
+
+   for ( i = 0; i < 8; i++ )
+   {
+      for ( c = 0; c < 3; c++ )
+      {
+         average[c] += pixels[subblock[i]][c] / 8.0f;
+      }
+   }
+
+   fit->error = 0x7fffffff;
+
+   for ( table = 0; table < 8; table++ )
+   {
+      float shift = 0.0f;
+      int   previous[3] = { -1, -1, -1 };
+
+      for ( pass = 0; pass < 2; pass++ )
+      {
+         int quantized[3], color[3], indices[8];
+         int error;
+
+         for ( c = 0; c < 3; c++ )
+         {
+            quantized[c] = Clamp ( Quantize ( average[c] - shift, bits ), low[c], high[c] );
+            color[c] = Expand ( quantized[c], bits );
+         }
+
+         if ( memcmp ( quantized, previous, sizeof ( quantized ) ) == 0 )
+         {
+            break;
+         }
+
+         error = FitTable ( pixels, subblock, color, table, indices );
+
+         if ( error < fit->error )
+         {
+            memcpy ( fit->color, quantized, sizeof ( quantized ) );
+            memcpy ( fit->indices, indices, sizeof ( indices ) );
+            fit->table = table;
+            fit->error = error;
+         }
+
+         shift = 0.0f;
+
+         for ( i = 0; i < 8; i++ )
+         {
+            shift += etcModifiers[table][indices[i] & 1] * ( indices[i] & 2 ? -1.0f : 1.0f ) / 8.0f;
+         }
+
+         memcpy ( previous, quantized, sizeof ( quantized ) );
+      }
+   }
+}
+
+///
+// PackSubblocks()
+//
+//    Block of the individual (4-bit colors) or differential mode (5-bit colors)
+//
+static Block PackSubblocks ( int flip, int differential, const SubblockFit fits[2] )
+{
+   Block bits = ( Block ) fits[0].table << 37 | ( Block ) fits[1].table << 34 | ( Block ) differential << 33 |
+                ( Block ) flip << 32;
+   int sub, i, c;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      int shift = 56 - c * 8;
+
+      if ( differential )
+      {
+         bits |= ( Block ) fits[0].color[c] << ( shift + 3 ) | ( Block ) ( ( fits[1].color[c] - fits[0].color[c] ) & 7 ) << shift;
+      }
+      else
+      {
+         bits |= ( Block ) fits[0].color[c] << ( shift + 4 ) | ( Block ) fits[1].color[c] << shift;
+      }
+   }
+
+   for ( sub = 0; sub < 2; sub++ )
+   {
+      for ( i = 0; i < 8; i++ )
+      {
+         bits |= PixelIndex ( subblockPixels[flip][sub][i], fits[sub].indices[i] );
+      }
+   }
+
+   return bits;
+}
+
+///
+// EncodeSubblocks()
+//
+//    Best block of the individual and differential modes, both flips
+//
+static Block EncodeSubblocks ( const unsigned char pixels[16][4], int *error )
+{
+   static const int zero[3] = { 0, 0, 0 };
+   static const int top4[3] = { 15, 15, 15 };
+   static const int top5[3] = { 31, 31, 31 };
+   Block best = 0;
+   int flip, first, c;
+
+   *error = 0x7fffffff;
+
+   for ( flip = 0; flip < 2; flip++ )
+   {
+      SubblockFit fits[2];
+
+      FitSubblock ( pixels, subblockPixels[flip][0], 4, zero, top4, &fits[0] );
+      FitSubblock ( pixels, subblockPixels[flip][1], 4, zero, top4, &fits[1] );
+
+      if ( fits[0].error + fits[1].error < *error )
+      {
+         *error = fits[0].error + fits[1].error;
+         best = PackSubblocks ( flip, 0, fits );
+      }
+
+      // differential: the second color is within [-4, 3] of the first, fit either one first
+      for ( first = 0; first < 2; first++ )
+      {
+         int low[3], high[3];
+
+         FitSubblock ( pixels, subblockPixels[flip][first], 5, zero, top5, &fits[first] );
+
+         for ( c = 0; c < 3; c++ )
+         {
+            low[c] = first == 0 ? fits[0].color[c] - 4 : fits[1].color[c] - 3;
+            high[c] = first == 0 ? fits[0].color[c] + 3 : fits[1].color[c] + 4;
+            low[c] = Clamp ( low[c], 0, 31 );
+            high[c] = Clamp ( high[c], 0, 31 );
+         }
+
+         FitSubblock ( pixels, subblockPixels[flip][1 - first], 5, low, high, &fits[1 - first] );
+
+         if ( fits[0].error + fits[1].error < *error )
+         {
+            *error = fits[0].error + fits[1].error;
+            best = PackSubblocks ( flip, 1, fits );
+         }
+      }
+   }
+
+   return best;
+}
+
+///
+// SplitColors()
+//
+//    Two clusters of the pixels for the T and H modes: k-means from the
+//    darkest and the brightest pixel.  Returns the mean of each, 8 bits.
+//
+static void SplitColors ( const unsigned char pixels[16][4], float means[2][3] )
+{
+   int darkest = 0, brightest = 0;
+   int i, c, iteration;
+
+   for ( i = 1; i < 16; i++ )
+   {
+      int luma = pixels[i][0] * 2 + pixels[i][1] * 4 + pixels[i][2];
+
+      if ( luma < pixels[darkest][0] * 2 + pixels[darkest][1] * 4 + pixels[darkest][2] )
+      {
+         darkest = i;
+      }
+
+      if ( luma > pixels[brightest][0] * 2 + pixels[brightest][1] * 4 + pixels[brightest][2] )
+      {
+         brightest = i;
+      }
+   }
+
+   for ( c = 0; c < 3; c++ )
+   {
+      means[0][c] = pixels[darkest][c];
+      means[1][c] = pixels[brightest][c];
+   }
+
+   for ( iteration = 0; iteration < 4; iteration++ )
+   {
+      float sums[2][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+      int   counts[2] = { 0, 0 };
+
+      for ( i = 0; i < 16; i++ )
+      {
+         float distances[2] = { 0.0f, 0.0f };
+         int   cluster;
+
+         for ( c = 0; c < 3; c++ )
+         {
+            distances[0] += ( pixels[i][c] - means[0][c] ) * ( pixels[i][c] - means[0][c] );
+            distances[1] += ( pixels[i][c] - means[1][c] ) * ( pixels[i][c] - means[1][c] );
+         }
+
+         cluster = distances[1] < distances[0];
+         counts[cluster]++;
+
+         for ( c = 0; c < 3; c++ )
+         {
+            sums[cluster][c] += pixels[i][c];
+         }
+      }
+
+      for ( c = 0; c < 3 && counts[0] > 0 && counts[1] > 0; c++ )
+      {
+         means[0][c] = sums[0][c] / counts[0];
+         means[1][c] = sums[1][c] / counts[1];
+      }
+   }
+}
+
+///
+// FitPaintColors()
+//
+//    Index of the nearest of 4 paint colors for every pixel, the error returned
+//
+static int FitPaintColors ( const unsigned char pixels[16][4], int paint[4][3], Block *bits )
+{
+   int error = 0;
+   int i, index;
+
+   for ( i = 0; i < 16; i++ )
+   {
+      int best = 0x7fffffff, bestIndex = 0;
+
+      for ( index = 0; index < 4; index++ )
+      {
+         int pixelError = SquaredError ( paint[index], pixels[i] );
+
+         if ( pixelError < best )
+         {
+            best = pixelError;
+            bestIndex = index;
+         }
+      }
+
+      *bits |= PixelIndex ( i, bestIndex );
+      error += best;
+   }
+
+   return error;
+}
+
+///
+// EncodeTH()
+//
+//    Best block of the T and H modes.  The R, G or B field of the
+//    differential mode overflows to select them, the bits they leave
+//    unused are set to make it overflow.
+//
+static Block EncodeTH ( const unsigned char pixels[16][4], int *error )
+{
+   float means[2][3];
+   int   colors[2][3];
+   Block best = 0;
+   int   single, d, c, swap;
+
+   *error = 0x7fffffff;
+   SplitColors ( pixels, means );
+
+   for ( single = 0; single < 2; single++ )
+   {
+      for ( c = 0; c < 3; c++ )
+      {
+         colors[0][c] = Quantize ( means[single][c], 4 );
+         colors[1][c] = Quantize ( means[1 - single][c], 4 );
+      }
+
+      // T mode, the first color alone
+      for ( d = 0; d < 8; d++ )
+      {
+         int   paint[4][3];
+         int   red1 = colors[0][0];
+         Block bits = ( Block ) ( red1 >> 2 ) << 59 | ( Block ) ( red1 & 3 ) << 56 | ( Block ) colors[0][1] << 52 |
+                      ( Block ) colors[0][2] << 48 | ( Block ) colors[1][0] << 44 | ( Block ) colors[1][1] << 40 |
+                      ( Block ) colors[1][2] << 36 | ( Block ) ( d >> 1 ) << 34 | ( Block ) 1 << 33 | ( Block ) ( d & 1 ) << 32;
+         int   blockError;
+
+         bits |= ( red1 >> 2 ) + ( red1 & 3 ) >= 4 ? ( Block ) 7 << 61 : ( Block ) 1 << 58;
+
+         for ( c = 0; c < 3; c++ )
+         {
+            paint[0][c] = Expand ( colors[0][c], 4 );
+            paint[1][c] = Clamp ( Expand ( colors[1][c], 4 ) + etcDistances[d], 0, 255 );
+            paint[2][c] = Expand ( colors[1][c], 4 );
+            paint[3][c] = Clamp ( Expand ( colors[1][c], 4 ) - etcDistances[d], 0, 255 );
+         }
+
+         blockError = FitPaintColors ( pixels, paint, &bits );
+
+         if ( blockError < *error )
+         {
+            *error = blockError;
+            best = bits;
+         }
+      }
+   }
+
+   // H mode, the last bit of the distance is whether the first color is the larger one
+   for ( d = 0; d < 8; d++ )
+   {
+      int paint[4][3];
+      int first = colors[0][0] << 8 | colors[0][1] << 4 | colors[0][2];
+      int second = colors[1][0] << 8 | colors[1][1] << 4 | colors[1][2];
+      int red1, green1, blue1;
+      int blockError;
+      Block bits;
+
+      if ( first == second && ( d & 1 ) == 0 )
+      {
+         continue;
+      }
+
+      swap = ( first >= second ) != ( d & 1 );
+      red1 = colors[swap][0];
+      green1 = colors[swap][1];
+      blue1 = colors[swap][2];
+      bits = ( Block ) red1 << 59 | ( Block ) ( green1 >> 1 ) << 56 | ( Block ) ( green1 & 1 ) << 52 |
+             ( Block ) ( blue1 >> 3 ) << 51 | ( Block ) ( blue1 & 7 ) << 47 | ( Block ) colors[1 - swap][0] << 43 |
+             ( Block ) colors[1 - swap][1] << 39 | ( Block ) colors[1 - swap][2] << 35 | ( Block ) ( d >> 2 ) << 34 |
+             ( Block ) 1 << 33 | ( Block ) ( d >> 1 & 1 ) << 32;
+
+      // R must not overflow, G must
+      if ( red1 + Signed3 ( green1 >> 1 ) < 0 )
+      {
+         bits |= ( Block ) 1 << 63;
+      }
+
+      bits |= ( ( green1 & 1 ) << 1 | blue1 >> 3 ) + ( ( blue1 & 7 ) >> 1 ) >= 4 ? ( Block ) 7 << 53 : ( Block ) 1 << 50;
+
+      for ( c = 0; c < 3; c++ )
+      {
+         paint[0][c] = Clamp ( Expand ( colors[swap][c], 4 ) + etcDistances[d], 0, 255 );
+         paint[1][c] = Clamp ( Expand ( colors[swap][c], 4 ) - etcDistances[d], 0, 255 );
+         paint[2][c] = Clamp ( Expand ( colors[1 - swap][c], 4 ) + etcDistances[d], 0, 255 );
+         paint[3][c] = Clamp ( Expand ( colors[1 - swap][c], 4 ) - etcDistances[d], 0, 255 );
+      }
+
+      blockError = FitPaintColors ( pixels, paint, &bits );
+
+      if ( blockError < *error )
+      {
+         *error = blockError;
+         best = bits;
+      }
+   }
+
+   return best;
+}
+
+///
+// EncodePlanar()
+//
+//    Block of the planar mode: the least squares plane through the pixels,
+//    colors at the origin, 4 pixels right and 4 pixels down of 6 / 7 / 6 bits
+//
+static Block EncodePlanar ( const unsigned char pixels[16][4] )
+{
+   static const int bits[3] = { 6, 7, 6 };
+   int   origin[3], horizontal[3], vertical[3];
+   Block block;
+   int   i, c;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      float mean = 0.0f, dx = 0.0f, dy = 0.0f;
+      int   top = ( 1 << bits[c] ) - 1;
+
+      for ( i = 0; i < 16; i++ )
+      {
+         mean += pixels[i][c] / 16.0f;
+         dx += ( ( i >> 2 ) - 1.5f ) * pixels[i][c] / 20.0f;
+         dy += ( ( i & 3 ) - 1.5f ) * pixels[i][c] / 20.0f;
+      }
+
+      // mean - 1.5 slopes at the origin, 4 slopes further at the other two
+      origin[c] = Clamp ( ( int ) ( ( mean - 1.5f * ( dx + dy ) ) * top / 255.0f + 0.5f ), 0, top );
+      horizontal[c] = Clamp ( ( int ) ( ( mean + 2.5f * dx - 1.5f * dy ) * top / 255.0f + 0.5f ), 0, top );
+      vertical[c] = Clamp ( ( int ) ( ( mean - 1.5f * dx + 2.5f * dy ) * top / 255.0f + 0.5f ), 0, top );
+   }
+
+   block = ( Block ) origin[0] << 57 | ( Block ) ( origin[1] >> 6 ) << 56 | ( Block ) ( origin[1] & 63 ) << 49 |
+           ( Block ) ( origin[2] >> 5 ) << 48 | ( Block ) ( origin[2] >> 3 & 3 ) << 43 | ( Block ) ( origin[2] & 7 ) << 39 |
+           ( Block ) ( horizontal[0] >> 1 ) << 34 | ( Block ) 1 << 33 | ( Block ) ( horizontal[0] & 1 ) << 32 |
+           ( Block ) horizontal[1] << 25 | ( Block ) horizontal[2] << 19 |
+           ( Block ) vertical[0] << 13 | ( Block ) vertical[1] << 6 | ( Block ) vertical[2];
+
+   // R and G must not overflow, B must
+   if ( ( origin[0] >> 2 ) + Signed3 ( ( origin[0] & 3 ) << 1 | origin[1] >> 6 ) < 0 )
+   {
+      block |= ( Block ) 1 << 63;
+   }
+
+   if ( ( origin[1] >> 2 & 15 ) + Signed3 ( ( origin[1] & 3 ) << 1 | origin[2] >> 5 ) < 0 )
+   {
+      block |= ( Block ) 1 << 55;
+   }
+
+   block |= ( origin[2] >> 3 & 3 ) + ( origin[2] >> 1 & 3 ) >= 4 ? ( Block ) 7 << 45 : ( Block ) 1 << 42;
+
+   return block;
+}
+
+///
+// EncodeEtc2()
+//
+//    Best ETC2 RGB block of every mode
+//
+static Block EncodeEtc2 ( const unsigned char pixels[16][4] )
+{
+   Block best, block;
+   int   error, bestError;
+
+   best = EncodeSubblocks ( pixels, &bestError );
+
+   if ( bestError > 0 )
+   {
+      block = EncodeTH ( pixels, &error );
+
+      if ( error < bestError )
+      {
+         best = block;
+         bestError = error;
+      }
+
+      block = EncodePlanar ( pixels );
+      error = BlockError ( block, pixels );
+
+      if ( error < bestError )
+      {
+         best = block;
+      }
+   }
+
+   return best;
+}
+
+///
+// EncodeEac()
+//
+//    EAC block of 16 values, 8-bit alpha or 11-bit red.  For each table the
+//    multiplier spreads its modifiers over the range of the values, the base
+//    starts centered and moves by the mean of the modifiers picked.
+//
+static Block EncodeEac ( const int values[16], int r11 )
+{
+   int   low = values[0], high = values[0];
+   int   bestError = 0x7fffffff;
+   Block best = 0;
+   int   table, multiplier, pass, i, index;
+
+   for ( i = 1; i < 16; i++ )
+   {
+      low = values[i] < low ? values[i] : low;
+      high = values[i] > high ? values[i] : high;
+   }
+
+   for ( table = 0; table < 16 && bestError > 0; table++ )
+   {
+      const int *modifiers = eacModifiers[table];
+      int span = ( modifiers[7] - modifiers[3] ) * ( r11 ? 8 : 1 );
+      int guess = ( high - low + span / 2 ) / span;
+
+      // 0 only scales the modifiers of R11 by 1, it is not allowed for alpha
+      for ( multiplier = guess - 1; multiplier <= guess + 1; multiplier++ )
+      {
+         int step = r11 ? ( multiplier > 0 ? multiplier * 8 : 1 ) : multiplier;
+         float center = ( low + high ) * 0.5f - ( modifiers[3] + modifiers[7] ) * step * 0.5f;
+         int base, previous = -1;
+
+         if ( multiplier < ( r11 ? 0 : 1 ) || multiplier > 15 )
+         {
+            continue;
+         }
+
+         base = Clamp ( ( int ) floorf ( ( r11 ? ( center - 4.0f ) / 8.0f : center ) + 0.5f ), 0, 255 );
+
+         for ( pass = 0; pass < 2 && base != previous; pass++ )
+         {
+            Block bits = ( Block ) base << 56 | ( Block ) multiplier << 52 | ( Block ) table << 48;
+            int   offset = r11 ? base * 8 + 4 : base;
+            int   error = 0;
+            float shift = 0.0f;
+
+            for ( i = 0; i < 16; i++ )
+            {
+               int bestIndex = 0, bestValue = 0x7fffffff;
+
+               for ( index = 0; index < 8; index++ )
+               {
+                  int decoded = Clamp ( offset + modifiers[index] * step, 0, r11 ? 2047 : 255 );
+                  int difference = ( decoded - values[i] ) * ( decoded - values[i] );
+
+                  if ( difference < bestValue )
+                  {
+                     bestValue = difference;
+                     bestIndex = index;
+                  }
+               }
+
+               bits |= ( Block ) bestIndex << ( 45 - 3 * i );
+               error += bestValue;
+               shift += modifiers[bestIndex] * step / 16.0f;
+            }
+
+            if ( error < bestError )
+            {
+               bestError = error;
+               best = bits;
+            }
+
+            previous = base;
+
+            for ( i = 0, center = 0.0f; i < 16; i++ )
+            {
+               center += values[i] / 16.0f;
+            }
+
+            center -= shift;
+            base = Clamp ( ( int ) floorf ( ( r11 ? ( center - 4.0f ) / 8.0f : center ) + 0.5f ), 0, 255 );
+         }
+      }
+   }
+
+   return best;
+}
+
+static void StoreBlock ( Block bits, unsigned char *data )
+{
+   int i;
+
+   // blocks are big endian
+   for ( i = 0; i < 8; i++ )
+   {
+      data[i] = ( unsigned char ) ( bits >> ( 56 - 8 * i ) );
+   }
+}
+
+static Block LoadBlock ( const unsigned char *data )
+{
+   Block bits = 0;
+   int   i;
+
+   for ( i = 0; i < 8; i++ )
+   {
+      bits = bits << 8 | data[i];
+   }
+
+   return bits;
+}
+
+static int BlockSize ( int format )
+{
+   return format == FORMAT_ETC2A ? 16 : 8;
+}
+
+///
+// EncodeBlockRow()
+//
+//    Task of the thread pool: one row of blocks of one level.  Pixels
+//    past the edge of levels that are not a multiple of 4 repeat the edge.
+//
+static void ESCALLBACK EncodeBlockRow ( void *userData, int row )
+{
+   EncodeJob *job = ( EncodeJob * ) userData;
+   const ESMipChain *chain = job->chain;
+   int level = 0;
+   int width, height, blocksX, blockX, i;
+   const unsigned char *levelPixels;
+
+   while ( row >= job->firstRow[level + 1] )
+   {
+      level++;
+   }
+
+   row -= job->firstRow[level];
+   width = chain->width[level];
+   height = chain->height[level];
+   blocksX = ( width + 3 ) / 4;
+   levelPixels = chain->pixels + chain->offset[level];
+
+   for ( blockX = 0; blockX < blocksX; blockX++ )
+   {
+      unsigned char  pixels[16][4];
+      unsigned char *block = job->blocks[level] + ( ( size_t ) row * blocksX + blockX ) * BlockSize ( job->format );
+      int            values[16];
+
+      for ( i = 0; i < 16; i++ )
+      {
+         int x = blockX * 4 + ( i >> 2 ), y = row * 4 + ( i & 3 );
+
+         x = x < width ? x : width - 1;
+         y = y < height ? y : height - 1;
+         memcpy ( pixels[i], levelPixels + ( ( size_t ) y * width + x ) * 4, 4 );
+      }
+
+      if ( job->format == FORMAT_R11 )
+      {
+         for ( i = 0; i < 16; i++ )
+         {
+            values[i] = ( pixels[i][0] * 2047 + 127 ) / 255;
+         }
+
+         StoreBlock ( EncodeEac ( values, 1 ), block );
+         continue;
+      }
+
+      if ( job->format == FORMAT_ETC2A )
+      {
+         // the alpha block comes first
+         for ( i = 0; i < 16; i++ )
+         {
+            values[i] = pixels[i][3];
+         }
+
+         StoreBlock ( EncodeEac ( values, 0 ), block );
+         block += 8;
+      }
+
+      StoreBlock ( EncodeEtc2 ( pixels ), block );
+   }
+}
+
+///
+// MeasurePSNR()
+//
+//    Decode level 0 and compare it with the image it was encoded from,
+//    over the channels the format keeps
+//
+static double MeasurePSNR ( int format, const ESMipChain *chain, const unsigned char *blocks )
+{
+   int    width = chain->width[0], height = chain->height[0];
+   int    blocksX = ( width + 3 ) / 4, blocksY = ( height + 3 ) / 4;
+   int    channels = format == FORMAT_ETC2 ? 3 : format == FORMAT_ETC2A ? 4 : 1;
+   double squaredError = 0.0;
+   int    blockX, blockY, i, c;
+
+   for ( blockY = 0; blockY < blocksY; blockY++ )
+   {
+      for ( blockX = 0; blockX < blocksX; blockX++ )
+      {
+         const unsigned char *block = blocks + ( ( size_t ) blockY * blocksX + blockX ) * BlockSize ( format );
+         unsigned char decoded[16][4];
+         int values[16];
+
+         if ( format == FORMAT_R11 )
+         {
+            DecodeEac ( LoadBlock ( block ), 1, values );
+
+            for ( i = 0; i < 16; i++ )
+            {
+               decoded[i][0] = ( unsigned char ) ( ( values[i] * 255 + 1023 ) / 2047 );
+            }
+         }
+         else
+         {
+            if ( format == FORMAT_ETC2A )
+            {
+               DecodeEac ( LoadBlock ( block ), 0, values );
+               block += 8;
+
+               for ( i = 0; i < 16; i++ )
+               {
+                  decoded[i][3] = ( unsigned char ) values[i];
+               }
+            }
+
+            DecodeEtc2 ( LoadBlock ( block ), decoded );
+         }
+
+         for ( i = 0; i < 16; i++ )
+         {
+            int x = blockX * 4 + ( i >> 2 ), y = blockY * 4 + ( i & 3 );
+            const unsigned char *pixel = chain->pixels + ( ( size_t ) y * width + x ) * 4;
+
+            if ( x >= width || y >= height )
+            {
+               continue;
+            }
+
+            for ( c = 0; c < channels; c++ )
+            {
+               squaredError += ( decoded[i][c] - pixel[c] ) * ( decoded[i][c] - pixel[c] );
+            }
+         }
+      }
+   }
+
+   squaredError /= ( double ) width * height * channels;
+
+   return squaredError > 0.0 ? 10.0 * log10 ( 255.0 * 255.0 / squaredError ) : HUGE_VAL;
+}
+
+static void WriteU32 ( FILE *file, GLuint value )
+{
+   unsigned char bytes[4];
+
+   bytes[0] = ( unsigned char ) value;
+   bytes[1] = ( unsigned char ) ( value >> 8 );
+   bytes[2] = ( unsigned char ) ( value >> 16 );
+   bytes[3] = ( unsigned char ) ( value >> 24 );
+   fwrite ( bytes, 1, 4, file );
+}
+
+static void WriteU64 ( FILE *file, size_t value )
+{
+   WriteU32 ( file, ( GLuint ) value );
+   WriteU32 ( file, ( GLuint ) ( ( unsigned long long ) value >> 32 ) );
+}
+
+/// A key / value pair of the KTX metadata, padded to 4 bytes.  Returns its size with the padding.
+static GLuint WriteKeyValue ( FILE *file, const char *key, const char *value )
+{
+   static const unsigned char padding[4] = { 0, 0, 0, 0 };
+   GLuint size = ( GLuint ) ( strlen ( key ) + strlen ( value ) + 2 );
+
+   if ( file != NULL )
+   {
+      WriteU32 ( file, size );
+      fwrite ( key, 1, strlen ( key ) + 1, file );
+      fwrite ( value, 1, strlen ( value ) + 1, file );
+      fwrite ( padding, 1, ( 4 - size % 4 ) % 4, file );
+   }
+
+   return 4 + ( ( size + 3 ) & ~3u );
+}
+
+///
+// WriteKTX()
+//
+//    KTX 1.1: the header, the orientation, then the size and blocks of each level
+//
+static GLboolean WriteKTX ( const char *fileName, int format, GLboolean srgb, const ESMipChain *chain,
+                            int levelCount, unsigned char *blocks[] )
+{
+   static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+   GLenum internalFormat = format == FORMAT_R11 ? GL_COMPRESSED_R11_EAC :
+                           format == FORMAT_ETC2A ? ( srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC : GL_COMPRESSED_RGBA8_ETC2_EAC ) :
+                           ( srgb ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2 );
+   GLenum baseFormat = format == FORMAT_R11 ? GL_RED : format == FORMAT_ETC2A ? GL_RGBA : GL_RGB;
+   FILE  *file = fopen ( fileName, "wb" );
+   int    level;
+
+   if ( file == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   fwrite ( identifier, 1, sizeof ( identifier ), file );
+
+   // endianness, glType, glTypeSize and glFormat of compressed data, the formats, the size, 1 face
+   WriteU32 ( file, 0x04030201 );
+   WriteU32 ( file, 0 );
+   WriteU32 ( file, 1 );
+   WriteU32 ( file, 0 );
+   WriteU32 ( file, internalFormat );
+   WriteU32 ( file, baseFormat );
+   WriteU32 ( file, chain->width[0] );
+   WriteU32 ( file, chain->height[0] );
+   WriteU32 ( file, 0 );
+   WriteU32 ( file, 0 );
+   WriteU32 ( file, 1 );
+   WriteU32 ( file, levelCount );
+   WriteU32 ( file, WriteKeyValue ( NULL, "KTXorientation", "S=r,T=u" ) );
+   WriteKeyValue ( file, "KTXorientation", "S=r,T=u" );
+
+   // blocks are 8 or 16 bytes, no padding is needed
+   for ( level = 0; level < levelCount; level++ )
+   {
+      size_t size = ( size_t ) ( ( chain->width[level] + 3 ) / 4 ) * ( ( chain->height[level] + 3 ) / 4 ) * BlockSize ( format );
+
+      WriteU32 ( file, ( GLuint ) size );
+      fwrite ( blocks[level], 1, size, file );
+   }
+
+   return fclose ( file ) == 0;
+}
+
+///
+// WriteKTX2()
+//
+//    KTX 2.0: the header, the index of the levels, the data format
+//    descriptor, the metadata, then the levels from the smallest one
+//
+static GLboolean WriteKTX2 ( const char *fileName, int format, GLboolean srgb, const ESMipChain *chain,
+                             int levelCount, unsigned char *blocks[] )
+{
+   static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+   static const unsigned char zeros[16] = { 0 };
+   GLuint vkFormat = format == FORMAT_R11 ? 153 : format == FORMAT_ETC2A ? ( srgb ? 152 : 151 ) : ( srgb ? 148 : 147 );
+   int    blockSize = BlockSize ( format );
+   int    sampleCount = format == FORMAT_ETC2A ? 2 : 1;
+   GLuint dfdOffset = 80 + 24 * levelCount;
+   GLuint dfdSize = 4 + 24 + 16 * sampleCount;
+   GLuint kvdOffset = dfdOffset + dfdSize;
+   GLuint kvdSize = WriteKeyValue ( NULL, "KTXorientation", "ru" ) + WriteKeyValue ( NULL, "KTXwriter", "CompressTexture" );
+   size_t levelOffsets[ES_MAX_MIP_LEVELS];
+   size_t levelSizes[ES_MAX_MIP_LEVELS];
+   size_t offset = kvdOffset + kvdSize;
+   FILE  *file;
+   int    level, sample;
+
+   for ( level = levelCount - 1; level >= 0; level-- )
+   {
+      offset = ( offset + blockSize - 1 ) / blockSize * blockSize;
+      levelOffsets[level] = offset;
+      levelSizes[level] = ( size_t ) ( ( chain->width[level] + 3 ) / 4 ) * ( ( chain->height[level] + 3 ) / 4 ) * blockSize;
+      offset += levelSizes[level];
+   }
+
+   file = fopen ( fileName, "wb" );
+
+   if ( file == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   // vkFormat, typeSize, the size, no layers, 1 face, the levels, no supercompression
+   fwrite ( identifier, 1, sizeof ( identifier ), file );
+   WriteU32 ( file, vkFormat );
+   WriteU32 ( file, 1 );
+   WriteU32 ( file, chain->width[0] );
+   WriteU32 ( file, chain->height[0] );
+   WriteU32 ( file, 0 );
+   WriteU32 ( file, 0 );
+   WriteU32 ( file, 1 );
+   WriteU32 ( file, levelCount );
+   WriteU32 ( file, 0 );
+
+   WriteU32 ( file, dfdOffset );
+   WriteU32 ( file, dfdSize );
+   WriteU32 ( file, kvdOffset );
+   WriteU32 ( file, kvdSize );
+   WriteU64 ( file, 0 );
+   WriteU64 ( file, 0 );
+
+   for ( level = 0; level < levelCount; level++ )
+   {
+      WriteU64 ( file, levelOffsets[level] );
+      WriteU64 ( file, levelSizes[level] );
+      WriteU64 ( file, levelSizes[level] );
+   }
+
+   // basic descriptor block: ETC2 color model, BT.709 primaries, linear or sRGB transfer,
+   // 4x4 blocks of 8 or 16 bytes, then a sample for each 64 bits of the blocks
+   WriteU32 ( file, dfdSize );
+   WriteU32 ( file, 0 );
+   WriteU32 ( file, 2 | ( 24 + 16 * sampleCount ) << 16 );
+   WriteU32 ( file, 161 | 1 << 8 | ( srgb ? 2 : 1 ) << 16 );
+   WriteU32 ( file, 3 | 3 << 8 );
+   WriteU32 ( file, blockSize );
+   WriteU32 ( file, 0 );
+
+   for ( sample = 0; sample < sampleCount; sample++ )
+   {
+      // channel ETC2 red for R11, alpha then color for RGBA, color otherwise
+      GLuint channel = format == FORMAT_R11 ? 0 : format == FORMAT_ETC2A && sample == 0 ? 15 : 2;
+
+      WriteU32 ( file, sample * 64 | 63 << 16 | channel << 24 );
+      WriteU32 ( file, 0 );
+      WriteU32 ( file, 0 );
+      WriteU32 ( file, 0xFFFFFFFF );
+   }
+
+   WriteKeyValue ( file, "KTXorientation", "ru" );
+   WriteKeyValue ( file, "KTXwriter", "CompressTexture" );
+   offset = kvdOffset + kvdSize;
+
+   for ( level = levelCount - 1; level >= 0; level-- )
+   {
+      fwrite ( zeros, 1, levelOffsets[level] - offset, file );
+      fwrite ( blocks[level], 1, levelSizes[level], file );
+      offset = levelOffsets[level] + levelSizes[level];
+   }
+
+   return fclose ( file ) == 0;
+}
+
+///
+// ToRGBA()
+//
+//    Pixels of a TGA as RGBA with the bottom row first, like the levels GL takes
+//
+static unsigned char *ToRGBA ( const ESImage *image )
+{
+   unsigned char *rgba = ( unsigned char * ) malloc ( ( size_t ) image->width * image->height * 4 );
+   int x, y;
+
+   if ( rgba == NULL )
+   {
+      return NULL;
+   }
+
+   for ( y = 0; y < image->height; y++ )
+   {
+      const unsigned char *src = image->pixels + ( size_t ) y * image->width * image->bytesPerPixel;
+      unsigned char *dst = rgba + ( size_t ) ( image->topDown ? image->height - 1 - y : y ) * image->width * 4;
+
+      for ( x = 0; x < image->width; x++, dst += 4, src += image->bytesPerPixel )
+      {
+         if ( image->bytesPerPixel == 1 )
+         {
+            dst[0] = dst[1] = dst[2] = src[0];
+            dst[3] = 255;
+         }
+         else if ( image->bytesPerPixel == 2 )
+         {
+            unsigned int value = * ( const GLushort * ) src;
+
+            dst[0] = ( unsigned char ) Expand ( value >> 11 & 31, 5 );
+            dst[1] = ( unsigned char ) Expand ( value >> 6 & 31, 5 );
+            dst[2] = ( unsigned char ) Expand ( value >> 1 & 31, 5 );
+            dst[3] = value & 1 ? 255 : 0;
+         }
+         else
+         {
+            // BGR(A) to RGBA
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = image->bytesPerPixel == 4 ? src[3] : 255;
+         }
+      }
+   }
+
+   return rgba;
+}
+
+static void Usage ( void )
+{
+   esLogMessage ( "usage: CompressTexture [-format etc2|etc2a|r11] [-srgb] [-nomips] [-threads n] in.tga out.ktx|out.ktx2\n" );
+}
+
+///
+// main()
+//
+//    A plain program, it never opens a window: Common's platform main() and its window loop are left out
+//
+int main ( int argc, char *argv[] )
+{
+   static const char *formatNames[3] = { "ETC2 RGB8", "ETC2 RGBA8 / EAC", "EAC R11" };
+   const char *input = NULL, *output = NULL;
+   int        format = FORMAT_ETC2;
+   GLboolean  srgb = GL_FALSE, mips = GL_TRUE;
+   int        threadCount = 0;
+   ESImage    image;
+   ESMipChain chain;
+   EncodeJob  job;
+   ESThreadPool *pool;
+   unsigned char *rgba;
+   unsigned char *blocks;
+   size_t     blockBytes = 0, pixelCount = 0;
+   double     start, seconds;
+   GLboolean  written;
+   int        i, level;
+
+   for ( i = 1; i < argc; i++ )
+   {
+      const char *argument = argv[i];
+
+      if ( strcmp ( argument, "-format" ) == 0 && i + 1 < argc )
+      {
+         argument = argv[++i];
+         format = strcmp ( argument, "etc2" ) == 0 ? FORMAT_ETC2 : strcmp ( argument, "etc2a" ) == 0 ? FORMAT_ETC2A :
+                  strcmp ( argument, "r11" ) == 0 ? FORMAT_R11 : -1;
+      }
+      else if ( strcmp ( argument, "-srgb" ) == 0 )
+      {
+         srgb = GL_TRUE;
+      }
+      else if ( strcmp ( argument, "-nomips" ) == 0 )
+      {
+         mips = GL_FALSE;
+      }
+      else if ( strcmp ( argument, "-threads" ) == 0 && i + 1 < argc )
+      {
+         threadCount = atoi ( argv[++i] );
+      }
+      else if ( argument[0] != '-' && input == NULL )
+      {
+         input = argument;
+      }
+      else if ( argument[0] != '-' && output == NULL )
+      {
+         output = argument;
+      }
+      else
+      {
+         format = -1;
+      }
+   }
+
+   if ( input == NULL || output == NULL || format < 0 || ( srgb && format == FORMAT_R11 ) )
+   {
+      Usage ();
+      return 1;
+   }
+
+   if ( !esMapTGA ( NULL, input, &image ) )
+   {
+      return 1;
+   }
+
+   rgba = ToRGBA ( &image );
+
+   if ( rgba == NULL || !esBuildMipChain ( &chain, rgba, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, srgb ) )
+   {
+      esLogMessage ( "CompressTexture: out of memory for %s\n", input );
+      free ( rgba );
+      esFreeTGA ( &image );
+      return 1;
+   }
+
+   free ( rgba );
+   esFreeTGA ( &image );
+
+   // every level in one allocation, one task per row of blocks of every level
+   memset ( &job, 0, sizeof ( EncodeJob ) );
+   job.format = format;
+   job.chain = &chain;
+   job.levelCount = mips ? chain.levelCount : 1;
+
+   for ( level = 0; level < job.levelCount; level++ )
+   {
+      job.firstRow[level + 1] = job.firstRow[level] + ( chain.height[level] + 3 ) / 4;
+      blockBytes += ( size_t ) ( ( chain.width[level] + 3 ) / 4 ) * ( ( chain.height[level] + 3 ) / 4 ) * BlockSize ( format );
+      pixelCount += ( size_t ) chain.width[level] * chain.height[level];
+   }
+
+   blocks = ( unsigned char * ) malloc ( blockBytes );
+
+   if ( blocks == NULL )
+   {
+      esLogMessage ( "CompressTexture: out of memory for %s\n", input );
+      esFreeMipChain ( &chain );
+      return 1;
+   }
+
+   for ( level = 0, job.blocks[0] = blocks; level + 1 < job.levelCount; level++ )
+   {
+      job.blocks[level + 1] = job.blocks[level] + ( size_t ) ( ( chain.width[level] + 3 ) / 4 ) *
+                              ( ( chain.height[level] + 3 ) / 4 ) * BlockSize ( format );
+   }
+
+   pool = esCreateThreadPool ( threadCount );
+   start = Now ();
+   esRunTasks ( pool, job.firstRow[job.levelCount], EncodeBlockRow, &job );
+   seconds = Now () - start;
+
+   esLogMessage ( "%s: %dx%d %s%s, %d level%s, %d thread%s\n", output, chain.width[0], chain.height[0],
+                  formatNames[format], srgb ? " sRGB" : "", job.levelCount, job.levelCount > 1 ? "s" : "",
+                  esGetThreadCount ( pool ), esGetThreadCount ( pool ) > 1 ? "s" : "" );
+   esLogMessage ( "   encoded in %.1f ms, %.2f Mpixels/s\n", seconds * 1000.0,
+                  seconds > 0.0 ? pixelCount / seconds / 1e6 : 0.0 );
+   esLogMessage ( "   level 0 PSNR %.2f dB\n", MeasurePSNR ( format, &chain, blocks ) );
+   esDestroyThreadPool ( pool );
+
+   i = ( int ) strlen ( output );
+   written = i > 5 && strcmp ( output + i - 5, ".ktx2" ) == 0 ?
+             WriteKTX2 ( output, format, srgb, &chain, job.levelCount, job.blocks ) :
+             WriteKTX ( output, format, srgb, &chain, job.levelCount, job.blocks );
+
+   free ( blocks );
+   esFreeMipChain ( &chain );
+
+   if ( !written )
+   {
+      esLogMessage ( "CompressTexture: can't write %s\n", output );
+      return 1;
+   }
+
+   return 0;
+}